@@ -1,4 +1,21 @@
 #include "esp32_ble_simple.h"
+#include "sdkconfig.h"
+
+// Compile-time Level (Kconfig "BeltWinder Logging"): gap_event_handler()
+// läuft für jedes empfangene Advertisement - alles oberhalb des Levels
+// wird gar nicht erst mitkompiliert. Obergrenze CONFIG_LOG_MAXIMUM_LEVEL.
+#if defined(CONFIG_BW_LOG_LEVEL_BLE_SCAN) && defined(CONFIG_LOG_MAXIMUM_LEVEL) && \
+    CONFIG_BW_LOG_LEVEL_BLE_SCAN > CONFIG_LOG_MAXIMUM_LEVEL
+#define BLE_SIMPLE_LOG_LEVEL CONFIG_LOG_MAXIMUM_LEVEL
+#elif defined(CONFIG_BW_LOG_LEVEL_BLE_SCAN)
+#define BLE_SIMPLE_LOG_LEVEL CONFIG_BW_LOG_LEVEL_BLE_SCAN
+#else
+#define BLE_SIMPLE_LOG_LEVEL 3  // ESP_LOG_INFO
+#endif
+
+#undef LOG_LOCAL_LEVEL
+#define LOG_LOCAL_LEVEL BLE_SIMPLE_LOG_LEVEL
+
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -47,17 +64,17 @@ bool SimpleBLEScanner::setup() {
     ESP_LOGI(TAG, "Setting up Simple BLE Scanner...");
     
     // NO NimBLE INIT HERE!
-    // Matter hat es bereits initialisiert!
+    // Der Owner (ShellyBLEManager::ensureBLEStarted) startet den Stack vorher.
     
     ESP_LOGI(TAG, "→ Verifying NimBLE Host...");
     
     if (!ble_hs_is_enabled()) {
         ESP_LOGE(TAG, "✗ NimBLE Host not enabled!");
-        ESP_LOGE(TAG, "  Matter should have initialized it");
+        ESP_LOGE(TAG, "  NimBLEDevice::init() must run before setup()");
         return false;
     }
     
-    ESP_LOGI(TAG, "✓ NimBLE Host is enabled by Matter");
+    ESP_LOGI(TAG, "✓ NimBLE Host is enabled");
     ESP_LOGI(TAG, "✓ Simple BLE Scanner setup complete");
     
     return true;
@@ -253,18 +270,25 @@ int SimpleBLEScanner::gap_event_handler(struct ble_gap_event *event) {
     switch (event->type) {
         case BLE_GAP_EVENT_DISC: {
             
+            // Rohdaten zuerst (Capture sieht auch ADVs, die unten verworfen werden)
+            if (raw_listener_) {
+                raw_listener_->on_raw_advertisement(event->disc);
+            }
+            
             uint8_t event_type = event->disc.event_type;
             
-            // MAC Address
-            char addr_str[18];
-            snprintf(addr_str, sizeof(addr_str), 
-                    "%02x:%02x:%02x:%02x:%02x:%02x",
-                    event->disc.addr.val[5],
-                    event->disc.addr.val[4],
-                    event->disc.addr.val[3],
-                    event->disc.addr.val[2],
-                    event->disc.addr.val[1],
-                    event->disc.addr.val[0]);
+            // MAC Address (nur für Logs)
+            char addr_str[18] = "";
+            if (BLE_SIMPLE_LOG_LEVEL >= ESP_LOG_INFO) {
+                snprintf(addr_str, sizeof(addr_str), 
+                        "%02x:%02x:%02x:%02x:%02x:%02x",
+                        event->disc.addr.val[5],
+                        event->disc.addr.val[4],
+                        event->disc.addr.val[3],
+                        event->disc.addr.val[2],
+                        event->disc.addr.val[1],
+                        event->disc.addr.val[0]);
+            }
             
             uint64_t mac_uint64 = 0;
             for (int i = 0; i < 6; i++) {
@@ -283,12 +307,14 @@ int SimpleBLEScanner::gap_event_handler(struct ble_gap_event *event) {
             
             // ════════════════════════════════════════════════════════════
             // SMART LOGGING: Nur interessante Devices detailliert loggen
+            // (Erkennung entfällt, wenn INFO nicht mitkompiliert ist)
             // ════════════════════════════════════════════════════════════
             
             bool is_interesting = false;
             
             // Check if Shelly BLU
-            if (name.length() >= 4 && 
+            if (BLE_SIMPLE_LOG_LEVEL >= ESP_LOG_INFO &&
+                name.length() >= 4 && 
                 (name.substr(0, 4) == "SBDW" || 
                  name.substr(0, 4) == "SBW-" ||
                  name.substr(0, 7) == "Shelly ")) {
@@ -296,7 +322,8 @@ int SimpleBLEScanner::gap_event_handler(struct ble_gap_event *event) {
             }
             
             // Check if has Service Data (might be relevant)
-            if (!is_interesting && device.get_service_datas().size() > 0) {
+            if (BLE_SIMPLE_LOG_LEVEL >= ESP_LOG_INFO &&
+                !is_interesting && device.get_service_datas().size() > 0) {
                 // Nur loggen wenn BTHome UUID
                 for (const auto& sd : device.get_service_datas()) {
                     if (sd.uuid.is_16bit() && sd.uuid.get_uuid16() == 0xFCD2) {
@@ -189,6 +189,17 @@ public:
     virtual bool on_device_found(const SimpleBLEDevice &device) = 0;
 };
 
+// ═══════════════════════════════════════════════════════════════════════
+// Raw Advertisement Listener (Capture/Diagnose - vor jedem Parsing)
+// ═══════════════════════════════════════════════════════════════════════
+
+class SimpleBLERawListener {
+public:
+    virtual ~SimpleBLERawListener() {}
+    // Läuft im NimBLE Host Task - kurz halten, nicht blockieren!
+    virtual void on_raw_advertisement(const ble_gap_disc_desc &disc) = 0;
+};
+
 // ═══════════════════════════════════════════════════════════════════════
 // Simple BLE Scanner
 // ═══════════════════════════════════════════════════════════════════════
@@ -217,6 +228,9 @@ public:
     void register_listener(SimpleBLEDeviceListener *listener) {
         listener_ = listener;
     }
+    void register_raw_listener(SimpleBLERawListener *listener) {
+        raw_listener_ = listener;
+    }
 
     struct WhitelistEntry {
         std::string mac_address;
@@ -260,6 +274,7 @@ private:
     uint32_t scan_start_time_;
     
     SimpleBLEDeviceListener *listener_;
+    SimpleBLERawListener *raw_listener_ = nullptr;
     
     static SimpleBLEScanner *instance_;
 
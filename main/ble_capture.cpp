@@ -0,0 +1,197 @@
+// ble_capture.cpp
+
+#include "ble_capture.h"
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <string.h>
+
+static const char* TAG = "BLECapture";
+
+BLECaptureRing::BLECaptureRing()
+    : buffer_(nullptr),
+      capacity_(0),
+      head_(0),
+      tail_(0),
+      used_(0),
+      records_(0),
+      dropped_(0),
+      active_(false),
+      lock_(portMUX_INITIALIZER_UNLOCKED) {
+}
+
+BLECaptureRing::~BLECaptureRing() {
+    release();
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// Control
+// ═══════════════════════════════════════════════════════════════════════
+
+bool BLECaptureRing::start(size_t capacity) {
+    if (!buffer_ || capacity != capacity_) {
+        release();
+
+        // PSRAM bevorzugen, sonst interner Heap
+        buffer_ = (uint8_t*)heap_caps_malloc(capacity, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!buffer_) {
+            buffer_ = (uint8_t*)heap_caps_malloc(capacity, MALLOC_CAP_8BIT);
+        }
+        if (!buffer_) {
+            ESP_LOGE(TAG, "✗ Capture buffer allocation failed (%u bytes)", (unsigned)capacity);
+            return false;
+        }
+        capacity_ = capacity;
+        clear();
+    }
+
+    active_ = true;
+    ESP_LOGI(TAG, "✓ Capture started (%u bytes ring, %u records kept)",
+             (unsigned)capacity_, records_);
+    return true;
+}
+
+void BLECaptureRing::stop() {
+    if (active_) {
+        active_ = false;
+        ESP_LOGI(TAG, "Capture stopped: %u records, %u dropped", records_, dropped_);
+    }
+}
+
+void BLECaptureRing::clear() {
+    taskENTER_CRITICAL(&lock_);
+    head_ = 0;
+    tail_ = 0;
+    used_ = 0;
+    records_ = 0;
+    dropped_ = 0;
+    taskEXIT_CRITICAL(&lock_);
+}
+
+void BLECaptureRing::release() {
+    active_ = false;
+
+    taskENTER_CRITICAL(&lock_);
+    uint8_t* old = buffer_;
+    buffer_ = nullptr;
+    capacity_ = 0;
+    head_ = tail_ = used_ = 0;
+    records_ = dropped_ = 0;
+    taskEXIT_CRITICAL(&lock_);
+
+    if (old) {
+        heap_caps_free(old);
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// Recording (NimBLE Host Task)
+// ═══════════════════════════════════════════════════════════════════════
+
+void BLECaptureRing::writeBytes(const uint8_t* src, size_t len) {
+    size_t first = capacity_ - head_;
+    if (first > len) first = len;
+
+    memcpy(buffer_ + head_, src, first);
+    memcpy(buffer_, src + first, len - first);
+    head_ = (head_ + len) % capacity_;
+    used_ += len;
+}
+
+void BLECaptureRing::dropOldest() {
+    // data_len liegt an Offset 13 des Records
+    size_t lenPos = (tail_ + BLE_CAPTURE_RECORD_OVERHEAD - 1) % capacity_;
+    size_t recordLen = BLE_CAPTURE_RECORD_OVERHEAD + buffer_[lenPos];
+
+    tail_ = (tail_ + recordLen) % capacity_;
+    used_ -= recordLen;
+    records_--;
+    dropped_++;
+}
+
+void BLECaptureRing::on_raw_advertisement(const ble_gap_disc_desc &disc) {
+    if (!active_ || !buffer_) {
+        return;
+    }
+
+    uint8_t header[BLE_CAPTURE_RECORD_OVERHEAD];
+    uint32_t ts = millis();
+
+    header[0] = ts & 0xFF;
+    header[1] = (ts >> 8) & 0xFF;
+    header[2] = (ts >> 16) & 0xFF;
+    header[3] = (ts >> 24) & 0xFF;
+    memcpy(header + 4, disc.addr.val, 6);
+    header[10] = disc.addr.type;
+    header[11] = (uint8_t)disc.rssi;
+    header[12] = disc.event_type;
+    header[13] = disc.length_data;
+
+    size_t recordLen = BLE_CAPTURE_RECORD_OVERHEAD + disc.length_data;
+    if (recordLen > capacity_) {
+        return;
+    }
+
+    taskENTER_CRITICAL(&lock_);
+    if (!active_ || !buffer_) {
+        // sendHttp()/release() hat zwischenzeitlich pausiert
+        taskEXIT_CRITICAL(&lock_);
+        return;
+    }
+    while (capacity_ - used_ < recordLen) {
+        dropOldest();
+    }
+    writeBytes(header, sizeof(header));
+    writeBytes(disc.data, disc.length_data);
+    records_++;
+    taskEXIT_CRITICAL(&lock_);
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// Export (HTTP)
+// ═══════════════════════════════════════════════════════════════════════
+
+esp_err_t BLECaptureRing::sendHttp(httpd_req_t* req) {
+    // Schreiber anhalten: Ring bleibt während des Streamens konsistent
+    bool wasActive = active_;
+    active_ = false;
+
+    taskENTER_CRITICAL(&lock_);
+    size_t tail = tail_;
+    size_t used = used_;
+    uint32_t records = records_;
+    uint32_t dropped = dropped_;
+    taskEXIT_CRITICAL(&lock_);
+
+    uint8_t header[BLE_CAPTURE_HEADER_SIZE] = {0};
+    memcpy(header, BLE_CAPTURE_MAGIC, 4);
+    header[4] = BLE_CAPTURE_VERSION;
+    header[5] = BLE_CAPTURE_HEADER_SIZE;
+    memcpy(header + 8, &records, 4);
+    memcpy(header + 12, &dropped, 4);
+
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"ble_capture.bwcap\"");
+
+    esp_err_t err = httpd_resp_send_chunk(req, (const char*)header, sizeof(header));
+
+    // Ring in max. zwei zusammenhängenden Stücken
+    if (err == ESP_OK && used > 0) {
+        size_t first = capacity_ - tail;
+        if (first > used) first = used;
+
+        err = httpd_resp_send_chunk(req, (const char*)buffer_ + tail, first);
+        if (err == ESP_OK && used > first) {
+            err = httpd_resp_send_chunk(req, (const char*)buffer_, used - first);
+        }
+    }
+
+    if (err == ESP_OK) {
+        err = httpd_resp_send_chunk(req, nullptr, 0);
+    }
+
+    ESP_LOGI(TAG, "Capture download: %u records, %u bytes (%s)",
+             records, (unsigned)(used + sizeof(header)), err == ESP_OK ? "OK" : "FAILED");
+
+    active_ = wasActive;
+    return err;
+}
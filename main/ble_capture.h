@@ -0,0 +1,86 @@
+// ble_capture.h
+
+#ifndef BLE_CAPTURE_H
+#define BLE_CAPTURE_H
+
+#pragma once
+
+#include <Arduino.h>
+#include <esp_http_server.h>
+#include <freertos/FreeRTOS.h>
+#include "esp32_ble_simple.h"
+
+// ═══════════════════════════════════════════════════════════════════════
+// BLE Advertisement Capture (.bwcap)
+// ═══════════════════════════════════════════════════════════════════════
+//
+// Datei = Header + Records, alles Little Endian:
+//
+//   Header (16 Bytes)
+//     char     magic[4]      "BWAC"
+//     uint8_t  version       BLE_CAPTURE_VERSION
+//     uint8_t  header_len    16
+//     uint16_t reserved
+//     uint32_t record_count
+//     uint32_t dropped       wegen vollem Ring überschriebene Records
+//
+//   Record (14 + data_len Bytes)
+//     uint32_t timestamp_ms  millis() beim Empfang
+//     uint8_t  mac[6]        wie ble_addr_t.val (LSB zuerst)
+//     uint8_t  addr_type     BLE_ADDR_PUBLIC / BLE_ADDR_RANDOM
+//     int8_t   rssi
+//     uint8_t  event_type    ADV_IND, SCAN_RSP, ...
+//     uint8_t  data_len
+//     uint8_t  data[data_len] rohe AD-Strukturen
+//
+// scripts/ble_replay.py liest das Format.
+
+#define BLE_CAPTURE_MAGIC           "BWAC"
+#define BLE_CAPTURE_VERSION         1
+#define BLE_CAPTURE_HEADER_SIZE     16
+#define BLE_CAPTURE_RECORD_OVERHEAD 14
+#define BLE_CAPTURE_DEFAULT_SIZE    (16 * 1024)
+
+class BLECaptureRing : public esp32_ble_simple::SimpleBLERawListener {
+public:
+    BLECaptureRing();
+    ~BLECaptureRing();
+
+    // Nicht kopierbar (besitzt den Ring-Puffer)
+    BLECaptureRing(const BLECaptureRing&) = delete;
+    BLECaptureRing& operator=(const BLECaptureRing&) = delete;
+
+    // Puffer wird erst beim Start angelegt - ohne Capture kein RAM-Verbrauch
+    bool start(size_t capacity = BLE_CAPTURE_DEFAULT_SIZE);
+    void stop();
+    void clear();
+    void release();
+
+    bool isActive() const { return active_; }
+    size_t capacity() const { return capacity_; }
+    size_t bytesUsed() const { return used_; }
+    uint32_t recordCount() const { return records_; }
+    uint32_t droppedCount() const { return dropped_; }
+
+    // NimBLE Host Task
+    void on_raw_advertisement(const ble_gap_disc_desc &disc) override;
+
+    // Streamt Header + Records als Chunked Response (Capture pausiert währenddessen)
+    esp_err_t sendHttp(httpd_req_t* req);
+
+private:
+    void writeBytes(const uint8_t* src, size_t len);
+    void dropOldest();
+
+    uint8_t* buffer_;
+    size_t capacity_;
+    size_t head_;               // Schreibposition
+    size_t tail_;               // ältester Record
+    size_t used_;
+    uint32_t records_;
+    uint32_t dropped_;
+    volatile bool active_;
+    portMUX_TYPE lock_;
+};
+
+#endif // BLE_CAPTURE_H
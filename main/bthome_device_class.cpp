@@ -0,0 +1,234 @@
+// bthome_device_class.cpp
+
+#include "bthome_device_class.h"
+#include "bthome_packet.h"
+#include <esp_log.h>
+#include <string.h>
+
+static const char* TAG = "BTHome";
+
+// ═══════════════════════════════════════════════════════════════════════
+// Objekt-Tabelle (BTHome v2, nach ID sortiert!)
+// ═══════════════════════════════════════════════════════════════════════
+
+static const BTHomeObjectDef OBJECT_DEFS[] = {
+    // id    len  signed  field                     divisor
+    { 0x00,  1,   false,  BTHOME_FIELD_PACKET_ID,   1   },
+    { 0x01,  1,   false,  BTHOME_FIELD_BATTERY,     1   },  // %
+    { 0x02,  2,   true,   BTHOME_FIELD_TEMPERATURE, 10  },  // 0.01 °C → 0.1 °C
+    { 0x03,  2,   false,  BTHOME_FIELD_HUMIDITY,    100 },  // 0.01 % → %
+    { 0x05,  3,   false,  BTHOME_FIELD_ILLUMINANCE, 100 },  // 0.01 lx → lx
+    { 0x0C,  2,   false,  BTHOME_FIELD_NONE,        1   },  // Spannung (mV)
+    { 0x0F,  1,   false,  BTHOME_FIELD_NONE,        1   },  // Generic Boolean
+    { 0x1A,  1,   false,  BTHOME_FIELD_NONE,        1   },  // Door
+    { 0x21,  1,   false,  BTHOME_FIELD_MOTION,      1   },
+    { 0x2D,  1,   false,  BTHOME_FIELD_WINDOW,      1   },
+    { 0x2E,  1,   false,  BTHOME_FIELD_HUMIDITY,    1   },  // % (uint8)
+    { 0x3A,  1,   false,  BTHOME_FIELD_BUTTON,      1   },
+    { 0x3F,  2,   true,   BTHOME_FIELD_ROTATION,    10  },  // 0.1 ° → °
+    { 0x45,  2,   true,   BTHOME_FIELD_TEMPERATURE, 1   },  // 0.1 °C
+    { 0xF0,  2,   false,  BTHOME_FIELD_DEVICE_TYPE, 1   },
+    { 0xF1,  4,   false,  BTHOME_FIELD_NONE,        1   },  // Firmware Version
+    { 0xF2,  3,   false,  BTHOME_FIELD_NONE,        1   },  // Firmware Version (kurz)
+};
+
+static const size_t OBJECT_DEF_COUNT = sizeof(OBJECT_DEFS) / sizeof(OBJECT_DEFS[0]);
+
+// ═══════════════════════════════════════════════════════════════════════
+// Geräteklassen
+// Neue Sensoren = neue Zeile. on_device_found() kennt keine Präfixe mehr.
+// Device Type IDs laut Shelly BTHome Objekt 0xF0.
+// ═══════════════════════════════════════════════════════════════════════
+
+static const BTHomeDeviceClass DEVICE_CLASSES[] = {
+    { "door_window", "BLU Door/Window", { "SBDW-", "SBW-002C-" }, 0x0002,
+      ShellySensorRole::WINDOW_CONTACT,
+      BTHOME_FIELD_BATTERY | BTHOME_FIELD_ILLUMINANCE | BTHOME_FIELD_WINDOW |
+      BTHOME_FIELD_ROTATION | BTHOME_FIELD_BUTTON },
+
+    { "button", "BLU Button", { "SBBT-", nullptr }, 0x0001,
+      ShellySensorRole::BUTTON,
+      BTHOME_FIELD_BATTERY | BTHOME_FIELD_BUTTON },
+
+    { "ht", "BLU H&T", { "SBHT-", nullptr }, 0x0003,
+      ShellySensorRole::CLIMATE,
+      BTHOME_FIELD_BATTERY | BTHOME_FIELD_TEMPERATURE | BTHOME_FIELD_HUMIDITY |
+      BTHOME_FIELD_BUTTON },
+
+    { "motion", "BLU Motion", { "SBMO-", nullptr }, 0x0005,
+      ShellySensorRole::MOTION,
+      BTHOME_FIELD_BATTERY | BTHOME_FIELD_ILLUMINANCE | BTHOME_FIELD_MOTION |
+      BTHOME_FIELD_BUTTON },
+};
+
+static const size_t DEVICE_CLASS_COUNT = sizeof(DEVICE_CLASSES) / sizeof(DEVICE_CLASSES[0]);
+
+// ═══════════════════════════════════════════════════════════════════════
+// Objekte
+// ═══════════════════════════════════════════════════════════════════════
+
+const BTHomeObjectDef* bthomeObjectDef(uint8_t objectId) {
+    size_t lo = 0;
+    size_t hi = OBJECT_DEF_COUNT;
+
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (OBJECT_DEFS[mid].id == objectId) {
+            return &OBJECT_DEFS[mid];
+        }
+        if (OBJECT_DEFS[mid].id < objectId) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return nullptr;
+}
+
+static int32_t readObjectValue(const uint8_t* p, const BTHomeObjectDef& def) {
+    uint32_t raw = 0;
+    for (uint8_t i = 0; i < def.length; i++) {
+        raw |= (uint32_t)p[i] << (8 * i);  // Little Endian
+    }
+
+    if (def.isSigned && def.length < 4) {
+        uint32_t signBit = 1UL << (def.length * 8 - 1);
+        if (raw & signBit) {
+            raw |= ~((signBit << 1) - 1);  // Sign-Extend
+        }
+    }
+
+    return (int32_t)raw;
+}
+
+bool bthomeDecodeObjects(const uint8_t* payload, size_t length, ShellyBLESensorData& out) {
+    size_t offset = 0;
+    out.fields = BTHOME_FIELD_NONE;
+    out.hasButtonEvent = false;
+
+    while (offset < length) {
+        uint8_t objectId = payload[offset++];
+        const BTHomeObjectDef* def = bthomeObjectDef(objectId);
+
+        if (!def) {
+            // Länge unbekannt → Rest nicht parsebar
+            ESP_LOGW(TAG, "Unknown Object ID: 0x%02X at offset %d", objectId, (int)(offset - 1));
+            break;
+        }
+
+        if (offset + def->length > length) {
+            ESP_LOGW(TAG, "Insufficient data for Object 0x%02X", objectId);
+            break;
+        }
+
+        int32_t value = readObjectValue(payload + offset, *def) / def->divisor;
+        offset += def->length;
+
+        switch (def->field) {
+            case BTHOME_FIELD_PACKET_ID:   out.packetId = (uint8_t)value;          break;
+            case BTHOME_FIELD_BATTERY:     out.battery = (uint8_t)value;           break;
+            case BTHOME_FIELD_ILLUMINANCE: out.illuminance = (uint32_t)value;      break;
+            case BTHOME_FIELD_WINDOW:      out.windowOpen = (value != 0);          break;
+            case BTHOME_FIELD_ROTATION:    out.rotation = (int16_t)value;          break;
+            case BTHOME_FIELD_TEMPERATURE: out.temperature = (int16_t)value;       break;
+            case BTHOME_FIELD_HUMIDITY:    out.humidity = (uint8_t)value;          break;
+            case BTHOME_FIELD_MOTION:      out.motion = (value != 0);              break;
+            case BTHOME_FIELD_DEVICE_TYPE: out.deviceTypeId = (uint16_t)value;     break;
+
+            case BTHOME_FIELD_BUTTON:
+                // 0x00 = kein Event (Heartbeat), 0x80 = Hold
+                if (value == 0) {
+                    continue;
+                }
+                out.buttonEvent = (value == 0x80) ? BUTTON_HOLD
+                                                  : static_cast<ShellyButtonEvent>(value);
+                out.hasButtonEvent = true;
+                break;
+
+            default:
+                ESP_LOGD(TAG, "Skipping Object 0x%02X", objectId);
+                continue;
+        }
+
+        out.fields |= def->field;
+    }
+
+    return out.fields != BTHOME_FIELD_NONE;
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// Geräteklassen
+// ═══════════════════════════════════════════════════════════════════════
+
+size_t bthomeDeviceClassCount() {
+    return DEVICE_CLASS_COUNT;
+}
+
+const BTHomeDeviceClass& bthomeDeviceClass(size_t index) {
+    return DEVICE_CLASSES[index < DEVICE_CLASS_COUNT ? index : 0];
+}
+
+const BTHomeDeviceClass* bthomeClassByName(const char* name) {
+    if (!name || !name[0]) {
+        return nullptr;
+    }
+
+    for (size_t i = 0; i < DEVICE_CLASS_COUNT; i++) {
+        for (const char* prefix : DEVICE_CLASSES[i].namePrefixes) {
+            if (prefix && strncmp(name, prefix, strlen(prefix)) == 0) {
+                return &DEVICE_CLASSES[i];
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+const BTHomeDeviceClass* bthomeClassByTypeId(uint16_t deviceTypeId) {
+    if (deviceTypeId == 0) {
+        return nullptr;
+    }
+
+    for (size_t i = 0; i < DEVICE_CLASS_COUNT; i++) {
+        if (DEVICE_CLASSES[i].deviceTypeId == deviceTypeId) {
+            return &DEVICE_CLASSES[i];
+        }
+    }
+
+    return nullptr;
+}
+
+const BTHomeDeviceClass* bthomeClassById(const char* id) {
+    for (size_t i = 0; i < DEVICE_CLASS_COUNT; i++) {
+        if (strcmp(DEVICE_CLASSES[i].id, id) == 0) {
+            return &DEVICE_CLASSES[i];
+        }
+    }
+
+    return nullptr;
+}
+
+const BTHomeDeviceClass* bthomeMatchDeviceClass(const char* name,
+                                                const uint8_t* serviceData,
+                                                size_t length) {
+    const BTHomeDeviceClass* cls = bthomeClassByName(name);
+    if (cls) {
+        return cls;
+    }
+
+    // Ohne Namen (passiver Scan / kein SCAN_RSP): Device Type aus dem Payload.
+    // Verschlüsselte Pakete sind ohne Bindkey nicht lesbar.
+    if (!serviceData || length < 2 || (serviceData[0] & 0x01)) {
+        return nullptr;
+    }
+
+    ShellyBLESensorData probe;
+    bthomeDecodeObjects(serviceData + 1, length - 1, probe);
+
+    if (probe.fields & BTHOME_FIELD_DEVICE_TYPE) {
+        return bthomeClassByTypeId(probe.deviceTypeId);
+    }
+
+    return nullptr;
+}
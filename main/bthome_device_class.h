@@ -0,0 +1,79 @@
+// bthome_device_class.h
+
+#ifndef BTHOME_DEVICE_CLASS_H
+#define BTHOME_DEVICE_CLASS_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Definiert in bthome_packet.h
+enum class ShellySensorRole : uint8_t;
+struct ShellyBLESensorData;
+
+// ═══════════════════════════════════════════════════════════════════════
+// BTHome v2 Objekte → kompakter Sensor-Record
+// ═══════════════════════════════════════════════════════════════════════
+
+// Welche Felder ein Paket enthalten hat (ShellyBLESensorData::fields)
+enum BTHomeField : uint16_t {
+    BTHOME_FIELD_NONE        = 0,
+    BTHOME_FIELD_PACKET_ID   = 1 << 0,
+    BTHOME_FIELD_BATTERY     = 1 << 1,
+    BTHOME_FIELD_ILLUMINANCE = 1 << 2,
+    BTHOME_FIELD_WINDOW      = 1 << 3,
+    BTHOME_FIELD_ROTATION    = 1 << 4,
+    BTHOME_FIELD_BUTTON      = 1 << 5,
+    BTHOME_FIELD_TEMPERATURE = 1 << 6,
+    BTHOME_FIELD_HUMIDITY    = 1 << 7,
+    BTHOME_FIELD_MOTION      = 1 << 8,
+    BTHOME_FIELD_DEVICE_TYPE = 1 << 9
+};
+
+/**
+ * @brief Ein BTHome Objekt: Länge, Vorzeichen und Ziel-Feld im Record
+ *
+ * Objekte ohne Ziel-Feld (BTHOME_FIELD_NONE) werden nur übersprungen -
+ * ihre Länge muss trotzdem bekannt sein, sonst bricht der Parser ab.
+ */
+struct BTHomeObjectDef {
+    uint8_t id;
+    uint8_t length;
+    bool isSigned;
+    uint16_t field;
+    uint16_t divisor;           // Rohwert / divisor = Einheit im Record
+};
+
+/**
+ * @brief Geräteklasse: Erkennung per Namenspräfix oder BTHome Device Type (0xF0)
+ */
+struct BTHomeDeviceClass {
+    const char* id;             // "door_window", "button", ...
+    const char* label;          // Anzeige im WebUI/Log
+    const char* namePrefixes[2];
+    uint16_t deviceTypeId;      // Wert von Objekt 0xF0 (0 = unbekannt)
+    ShellySensorRole defaultRole;
+    uint16_t fields;            // Felder, die diese Klasse liefert
+};
+
+// Objekt-Tabelle (nach ID sortiert, Binärsuche)
+const BTHomeObjectDef* bthomeObjectDef(uint8_t objectId);
+
+// Dekodiert alle Objekte eines (entschlüsselten) Payloads ohne DevInfo-Byte.
+// Setzt die gefundenen Felder in out und out.fields. Abbruch bei unbekannter ID.
+bool bthomeDecodeObjects(const uint8_t* payload, size_t length, ShellyBLESensorData& out);
+
+// Geräteklassen
+size_t bthomeDeviceClassCount();
+const BTHomeDeviceClass& bthomeDeviceClass(size_t index);
+const BTHomeDeviceClass* bthomeClassByName(const char* name);
+const BTHomeDeviceClass* bthomeClassByTypeId(uint16_t deviceTypeId);
+const BTHomeDeviceClass* bthomeClassById(const char* id);
+
+// Name zuerst, dann Device Type aus unverschlüsselter Service Data (DevInfo + Objekte)
+const BTHomeDeviceClass* bthomeMatchDeviceClass(const char* name,
+                                                const uint8_t* serviceData,
+                                                size_t length);
+
+#endif // BTHOME_DEVICE_CLASS_H
@@ -0,0 +1,212 @@
+// bthome_packet.cpp
+
+#include "bthome_packet.h"
+#include <esp_log.h>
+#include <string.h>
+
+static const char* TAG = "BTHome";
+
+// ════════════════════════════════════════════════════════════════════════
+// Duplicate / Replay Filter
+// ════════════════════════════════════════════════════════════════════════
+
+static inline uint32_t readBTHomeCounter(const uint8_t* data) {
+    return (uint32_t)data[1] |
+           ((uint32_t)data[2] << 8) |
+           ((uint32_t)data[3] << 16) |
+           ((uint32_t)data[4] << 24);
+}
+
+BTHomePacketVerdict bthomeCheckPacketFilter(const uint8_t* data, size_t length,
+                                            const BTHomePacketFilter& filter,
+                                            uint32_t nowMs) {
+    
+    if (length < 2) {
+        return PACKET_NEW;  // Parser verwirft das Paket ohnehin
+    }
+    
+    bool encrypted = (data[0] & 0x01) != 0;
+    
+    if (!encrypted) {
+        // BTHome v2: Objekte nach ID sortiert → Packet ID (0x00) steht direkt nach DevInfo
+        if (length >= 3 && data[1] == BTHOME_OBJ_PACKET_ID &&
+            filter.hasPacketId && data[2] == filter.lastPacketId) {
+            return PACKET_DUPLICATE;
+        }
+        return PACKET_NEW;
+    }
+    
+    if (length < 13 || !filter.hasCounter) {
+        return PACKET_NEW;
+    }
+    
+    uint32_t counter = readBTHomeCounter(data);
+    
+    if (counter > filter.highestCounter) {
+        return PACKET_NEW;
+    }
+    
+    uint32_t age = filter.highestCounter - counter;
+    if (age < BTHOME_REPLAY_WINDOW) {
+        return (filter.counterWindow & (1UL << age)) ? PACKET_DUPLICATE : PACKET_NEW;
+    }
+    
+    // Counter weit hinter dem Fenster: Replay oder Sensor-Neustart (Batteriewechsel).
+    // Nach längerer Funkstille werden solche Pakete als Resync-Kandidaten
+    // entschlüsselt - das Fenster springt erst nach BTHOME_REPLAY_RESYNC_PACKETS
+    // aufeinanderfolgenden, steigenden Countern mit gültigem MIC zurück.
+    if (filter.resyncCandidates > 0 && counter == filter.resyncCounter) {
+        return PACKET_DUPLICATE;  // Burst-Kopie des letzten Kandidaten
+    }
+    
+    if (nowMs - filter.lastAcceptMs > BTHOME_REPLAY_RESYNC_MS) {
+        return PACKET_RESYNC;
+    }
+    
+    return PACKET_REPLAY;
+}
+
+bool bthomeCommitPacketFilter(const uint8_t* data, size_t length,
+                              BTHomePacketVerdict verdict,
+                              BTHomePacketFilter& filter,
+                              uint32_t nowMs) {
+    bool encrypted = (data[0] & 0x01) != 0;
+    
+    if (encrypted && length >= 13) {
+        uint32_t counter = readBTHomeCounter(data);
+        
+        if (verdict == PACKET_RESYNC) {
+            // Ein einzelnes altes Paket mit gültigem MIC darf das Fenster nie
+            // zurücksetzen - sonst wäre nach 60 s Stille jeder Mitschnitt abspielbar.
+            if (filter.resyncCandidates > 0 && counter > filter.resyncCounter) {
+                filter.resyncCandidates++;
+            } else {
+                filter.resyncCandidates = 1;
+            }
+            filter.resyncCounter = counter;
+            
+            if (filter.resyncCandidates < BTHOME_REPLAY_RESYNC_PACKETS) {
+                ESP_LOGW(TAG, "Resync candidate %u/%u: counter %u (highest %u)",
+                         filter.resyncCandidates, BTHOME_REPLAY_RESYNC_PACKETS,
+                         counter, filter.highestCounter);
+                return false;
+            }
+        }
+        
+        filter.resyncCandidates = 0;
+        
+        if (verdict == PACKET_RESYNC || !filter.hasCounter) {
+            if (verdict == PACKET_RESYNC) {
+                filter.resyncs++;
+                ESP_LOGW(TAG, "Replay window resynced: %u → %u", filter.highestCounter, counter);
+            }
+            filter.highestCounter = counter;
+            filter.counterWindow = 1;
+            filter.hasCounter = true;
+        } else if (counter > filter.highestCounter) {
+            uint32_t shift = counter - filter.highestCounter;
+            filter.counterWindow = (shift >= BTHOME_REPLAY_WINDOW)
+                                   ? 1 : ((filter.counterWindow << shift) | 1);
+            filter.highestCounter = counter;
+        } else {
+            filter.counterWindow |= (1UL << (filter.highestCounter - counter));
+        }
+    } else if (!encrypted && length >= 3 && data[1] == BTHOME_OBJ_PACKET_ID) {
+        filter.lastPacketId = data[2];
+        filter.hasPacketId = true;
+    }
+    
+    filter.lastAcceptMs = nowMs;
+    filter.accepted++;
+    return true;
+}
+
+// ============================================================================
+// AES-CCM Decryption (BTHome v2)
+// ============================================================================
+
+bool bthomeDecrypt(const uint8_t* encryptedData, size_t length,
+                   mbedtls_ccm_context* ccm,
+                   uint64_t mac,
+                   uint8_t* decrypted,
+                   size_t& decryptedLen) {
+    
+    // ════════════════════════════════════════════════════════════════════
+    // Input Validation
+    // ════════════════════════════════════════════════════════════════════
+    
+    if (length < 13) {  // Min: 1 DevInfo + 4 Counter + 4 Payload + 4 MIC
+        ESP_LOGW(TAG, "Encrypted packet too short: %d bytes (min 13)", (int)length);
+        return false;
+    }
+    
+
+    // ════════════════════════════════════════════════════════════════════
+    // Parse Packet Structure
+    // ════════════════════════════════════════════════════════════════════
+    
+    uint8_t deviceInfo = encryptedData[0];
+    const uint8_t* counter = encryptedData + 1;
+    const uint8_t* payload = encryptedData + 5;
+    size_t payloadLen = length - 9;  // Total - (1 DevInfo + 4 Counter + 4 MIC)
+    const uint8_t* mic = encryptedData + length - 4;
+    
+    // ════════════════════════════════════════════════════════════════════
+    // Build Nonce (BTHome v2 Standard: 13 bytes)
+    // Key-Schedule steckt bereits im gecachten CCM-Kontext der Registry
+    // ════════════════════════════════════════════════════════════════════
+    
+    uint8_t nonce[13];
+    
+    // MAC Little-Endian (niederwertigstes Byte zuerst)
+    for (int i = 0; i < 6; i++) {
+        nonce[i] = (uint8_t)(mac >> (i * 8));
+    }
+    
+    // UUID 0xFCD2 in Little-Endian
+    nonce[6] = 0xD2;
+    nonce[7] = 0xFC;
+    
+    // Device Info WITHOUT encryption flag
+    nonce[8] = deviceInfo & 0xFE;
+    
+    // Counter (already Little-Endian)
+    memcpy(nonce + 9, counter, 4);
+    
+    // ════════════════════════════════════════════════════════════════════
+    // AES-CCM Decryption (mbedTLS)
+    // ════════════════════════════════════════════════════════════════════
+    
+    // Decrypt with AAD (Additional Authenticated Data = Device Info byte)
+    int ret = mbedtls_ccm_auth_decrypt(
+        ccm,
+        payloadLen,              // Ciphertext length
+        nonce, 13,               // Nonce (13 bytes)
+        &deviceInfo, 1,          // AAD: Device Info byte WITH encryption flag
+        payload,                 // Input: encrypted payload
+        decrypted + 1,           // Output: decrypted payload (skip first byte)
+        mic, 4                   // MIC/Tag (4 bytes)
+    );
+    
+    // ════════════════════════════════════════════════════════════════════
+    // Handle Result
+    // ════════════════════════════════════════════════════════════════════
+    
+    if (ret != 0) {
+        ESP_LOGE(TAG, "CCM decrypt failed: -0x%04X", -ret);
+        
+        if (ret == MBEDTLS_ERR_CCM_AUTH_FAILED) {
+            ESP_LOGE(TAG, "  → Authentication failed (MIC mismatch)");
+            ESP_LOGE(TAG, "  → Wrong bindkey or corrupted packet");
+        }
+        
+        return false;
+    }
+    
+    // Success: Build output (Device Info without encryption flag + decrypted payload)
+    decrypted[0] = deviceInfo & 0xFE;
+    decryptedLen = payloadLen + 1;
+    
+    return true;
+}
+
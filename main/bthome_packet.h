@@ -0,0 +1,167 @@
+// bthome_packet.h
+
+#ifndef BTHOME_PACKET_H
+#define BTHOME_PACKET_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// AES-CCM (BTHome v2 Decryption)
+#include <mbedtls/ccm.h>
+
+// ═══════════════════════════════════════════════════════════════════════
+// BTHome v2 Paketpfad: Sensor-Record, Replay-Filter, Entschlüsselung
+// ═══════════════════════════════════════════════════════════════════════
+//
+// Bewusst ohne Arduino/NimBLE/FreeRTOS: scripts/ble_replay.py baut dieses
+// Modul zusammen mit bthome_device_class.cpp für den Host und spielt
+// Captures durch exakt denselben Code.
+
+// BTHome Object IDs
+#define BTHOME_OBJ_PACKET_ID    0x00
+#define BTHOME_OBJ_BATTERY      0x01
+#define BTHOME_OBJ_ILLUMINANCE  0x05
+#define BTHOME_OBJ_WINDOW       0x2D
+#define BTHOME_OBJ_BUTTON       0x3A
+#define BTHOME_OBJ_ROTATION     0x3F
+
+// Duplicate / Replay Filter
+#define BTHOME_REPLAY_WINDOW       32       // Encryption counters tracked below the highest seen
+#define BTHOME_REPLAY_RESYNC_MS    60000    // Silence after which an out-of-window counter may resync
+#define BTHOME_REPLAY_RESYNC_PACKETS 3      // Consecutive increasing MIC-valid counters needed to resync
+
+// ═══════════════════════════════════════════════════════════════════════
+// Data Structures
+// ═══════════════════════════════════════════════════════════════════════
+
+enum ShellyButtonEvent {
+    BUTTON_NONE = 0,
+    BUTTON_SINGLE_PRESS = 0x01,
+    BUTTON_DOUBLE_PRESS = 0x02,
+    BUTTON_TRIPLE_PRESS = 0x03,
+    BUTTON_LONG_PRESS = 0x04,
+    BUTTON_LONG_DOUBLE_PRESS = 0x05,
+    BUTTON_LONG_TRIPLE_PRESS = 0x06,
+    BUTTON_HOLD = 0x8001
+};
+
+/**
+ * @brief Herkunft des Sensorzustands (gültig nur mit dataValid bzw. Restore)
+ */
+enum class SensorStateConfidence : uint8_t {
+    NONE,           // Noch kein Zustand bekannt
+    LIVE,           // Advertisement seit diesem Boot
+    RESTORED,       // Aus RTC, Alter bekannt und < BLE_STATE_TRUST_MS
+    UNCERTAIN       // Aus RTC/NVS, zu alt oder Alter unbekannt (Stromausfall)
+};
+
+enum class ShellySensorRole : uint8_t {
+    WINDOW_CONTACT = 0,     // Fensterkontakt → Rolladen-Logik + Matter Contact Sensor
+    BUTTON         = 1,     // BLU Button → Events
+    ILLUMINANCE    = 2,     // Nur Helligkeit
+    CLIMATE        = 3,     // BLU H&T
+    MOTION         = 4      // BLU Motion
+};
+
+struct ShellyBLESensorData {
+    uint8_t packetId;
+    uint8_t battery;
+    uint32_t illuminance;
+    bool windowOpen;
+    int16_t rotation;
+    int8_t rssi;
+    
+    int16_t temperature;        // 0.1 °C (BLU H&T)
+    uint8_t humidity;           // %
+    bool motion;                // BLU Motion
+    uint16_t deviceTypeId;      // BTHome 0xF0, falls gesendet
+    uint16_t fields;            // BTHomeField-Bitmaske: im letzten Paket enthalten
+    
+    bool hasButtonEvent;
+    ShellyButtonEvent buttonEvent;
+    
+    uint32_t lastUpdate;
+    bool dataValid;
+    bool wasEncrypted; 
+    SensorStateConfidence confidence;
+    
+    ShellyBLESensorData() : 
+        packetId(0), battery(0), illuminance(0), windowOpen(false),
+        rotation(0), rssi(0), temperature(0), humidity(0), motion(false),
+        deviceTypeId(0), fields(0), hasButtonEvent(false),
+        buttonEvent(BUTTON_NONE), lastUpdate(0), dataValid(false), wasEncrypted(false),
+        confidence(SensorStateConfidence::NONE) {}
+};
+
+/**
+ * @brief Per-Device Duplikat-/Replay-Filter (nur RAM)
+ *
+ * Shelly BLU wiederholt jedes Advertisement mehrfach. Duplikate werden anhand
+ * der Packet ID (unverschlüsselt) bzw. des Encryption Counters (verschlüsselt)
+ * verworfen, BEVOR AES-CCM läuft. Für verschlüsselte Pakete zusätzlich ein
+ * Sliding-Window (Bit n = Counter highestCounter-n bereits akzeptiert).
+ * Counter hinter dem Fenster (Sensor-Neustart) setzen das Fenster erst nach
+ * BTHOME_REPLAY_RESYNC_PACKETS steigenden, authentischen Paketen zurück.
+ */
+struct BTHomePacketFilter {
+    bool hasPacketId;
+    uint8_t lastPacketId;
+    
+    bool hasCounter;
+    uint32_t highestCounter;
+    uint32_t counterWindow;
+    uint32_t lastAcceptMs;
+    
+    // Resync-Kandidaten (Counter hinter dem Fenster, MIC gültig)
+    uint32_t resyncCounter;
+    uint8_t resyncCandidates;
+    
+    // Statistik
+    uint32_t accepted;
+    uint32_t duplicates;
+    uint32_t replays;
+    uint32_t resyncs;
+    
+    BTHomePacketFilter() :
+        hasPacketId(false), lastPacketId(0),
+        hasCounter(false), highestCounter(0), counterWindow(0), lastAcceptMs(0),
+        resyncCounter(0), resyncCandidates(0),
+        accepted(0), duplicates(0), replays(0), resyncs(0) {}
+};
+
+enum BTHomePacketVerdict {
+    PACKET_NEW,
+    PACKET_DUPLICATE,
+    PACKET_REPLAY,
+    PACKET_RESYNC
+};
+
+// ═══════════════════════════════════════════════════════════════════════
+// Duplicate / Replay Filter (nowMs = millis() bzw. Capture-Zeitstempel)
+// ═══════════════════════════════════════════════════════════════════════
+
+BTHomePacketVerdict bthomeCheckPacketFilter(const uint8_t* data, size_t length,
+                                            const BTHomePacketFilter& filter,
+                                            uint32_t nowMs);
+
+// false → Paket nur als Resync-Kandidat gezählt, Daten verwerfen
+bool bthomeCommitPacketFilter(const uint8_t* data, size_t length,
+                              BTHomePacketVerdict verdict,
+                              BTHomePacketFilter& filter,
+                              uint32_t nowMs);
+
+// ═══════════════════════════════════════════════════════════════════════
+// AES-CCM Decryption
+// ═══════════════════════════════════════════════════════════════════════
+
+// DevInfo | Counter(4) | Payload | MIC(4) → DevInfo (ohne Flag) | Payload
+// mac: MSB zuerst (wie get_address_uint64()), ccm: Key bereits gesetzt
+bool bthomeDecrypt(const uint8_t* encryptedData, size_t length,
+                   mbedtls_ccm_context* ccm,
+                   uint64_t mac,
+                   uint8_t* decrypted,
+                   size_t& decryptedLen);
+
+#endif // BTHOME_PACKET_H
@@ -56,6 +56,39 @@ struct WindowLogicConfig {
     uint8_t  ventPosition  = 15;     // %  ventilation target position
 };
 
+// --- BLU Button → Shutter Binding ---
+// Button-Events (BTHome) werden direkt aus dem BLE-Decode-Pfad in die
+// Shutter-Command-Queue gelegt - ohne Matter-Controller-Umweg.
+enum class ShutterAction : uint8_t {
+    NONE,      // Event ignorieren
+    UP,        // 0%   (wie Web-UI "up" / Matter UpOrOpen)
+    DOWN,      // 100% (wie Web-UI "down" / Matter DownOrClose)
+    STOP,
+    TOGGLE,    // fährt → Stop, steht → in die entferntere Endlage
+    PRESET     // presetPercent
+};
+
+enum ButtonBindingSlot : uint8_t {
+    BUTTON_BIND_SINGLE,
+    BUTTON_BIND_DOUBLE,
+    BUTTON_BIND_TRIPLE,
+    BUTTON_BIND_LONG,
+    BUTTON_BIND_HOLD,
+    BUTTON_BIND_COUNT
+};
+
+struct ButtonBindingConfig {
+    bool          enabled       = false;  // Master enable/disable
+    ShutterAction actions[BUTTON_BIND_COUNT] = {
+        ShutterAction::TOGGLE,   // single
+        ShutterAction::PRESET,   // double
+        ShutterAction::NONE,     // triple
+        ShutterAction::STOP,     // long
+        ShutterAction::NONE      // hold
+    };
+    uint8_t       presetPercent = 50;     // %  Ziel für PRESET (Lift-Skala wie Slider)
+};
+
 #define DEVICE_IP_MAX_LENGTH 16
 
 #endif // CONFIG_H
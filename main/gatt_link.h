@@ -0,0 +1,79 @@
+// gatt_link.h
+
+#ifndef GATT_LINK_H
+#define GATT_LINK_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// ═══════════════════════════════════════════════════════════════════════
+// GATT Link: NimBLE-Client hinter einer Schnittstelle
+// ═══════════════════════════════════════════════════════════════════════
+//
+// GattSession kennt nur GattLink und bekommt die Callback-Ereignisse über
+// GattLinkListener. Auf dem Gerät steckt NimBLEGattLink dahinter
+// (gatt_link_nimble.cpp), in test/host ein Fake, der Ereignisse gezielt
+// verzögert, verwirft oder doppelt liefert.
+
+enum GattCharProps : uint8_t {
+    GATT_PROP_READ      = 1 << 0,
+    GATT_PROP_WRITE     = 1 << 1,
+    GATT_PROP_WRITE_NR  = 1 << 2    // Write without Response
+};
+
+/**
+ * @brief Ereignisse des Links (auf dem Gerät aus dem NimBLE Host Task)
+ */
+class GattLinkListener {
+public:
+    virtual ~GattLinkListener() {}
+
+    virtual void onLinkConnected() = 0;
+    virtual void onLinkConnectFailed(int reason) = 0;
+    virtual void onLinkDisconnected(const std::string& peer, int reason) = 0;
+    virtual void onLinkMtu(uint16_t mtu) = 0;
+    virtual void onLinkAuthComplete(bool bonded, bool encrypted) = 0;
+};
+
+// service, characteristic, GattCharProps
+using GattCharVisitor = std::function<void(const std::string& service,
+                                           const std::string& uuid,
+                                           uint8_t props)>;
+
+class GattLink {
+public:
+    virtual ~GattLink() {}
+
+    // Asynchron: Ergebnis über onLinkConnected() / onLinkConnectFailed()
+    virtual bool connect(const char* address, uint8_t addressType, uint32_t timeoutMs) = 0;
+    virtual void cancelConnect() = 0;
+    // Asynchron: Ergebnis über onLinkAuthComplete()
+    virtual bool secure() = 0;
+    // Asynchron: Ergebnis über onLinkDisconnected()
+    virtual void disconnect() = 0;
+
+    virtual bool isConnected() const = 0;
+    virtual bool isEncrypted() const = 0;
+    virtual uint16_t mtu() const = 0;
+    virtual std::string peerAddress() const = 0;
+
+    // Blockierend (NimBLE wartet intern auf das GATT-Complete-Event)
+    virtual size_t discover() = 0;                          // Anzahl Services
+    virtual uint8_t properties(const char* uuid) = 0;       // GattCharProps, 0 = nicht gefunden
+    virtual bool read(const char* uuid, std::string& value) = 0;
+    virtual bool write(const char* uuid, const uint8_t* data, size_t length,
+                       bool response) = 0;
+    virtual void visit(const GattCharVisitor& visitor) = 0; // gecachte Discovery
+};
+
+// Erzeugt einen Link, der an listener meldet. nullptr = kein Client frei.
+using GattLinkFactory = std::function<GattLink*(GattLinkListener& listener)>;
+
+// NimBLE-Backend (gatt_link_nimble.cpp)
+GattLink* gattCreateNimBLELink(GattLinkListener& listener);
+
+#endif // GATT_LINK_H
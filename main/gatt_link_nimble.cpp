@@ -0,0 +1,196 @@
+// gatt_link_nimble.cpp
+
+#include "gatt_link.h"
+#include <esp_log.h>
+#include <NimBLEDevice.h>
+#include <NimBLEClient.h>
+
+// Compile-time Level (Kconfig "BeltWinder Logging")
+#ifdef CONFIG_BW_LOG_LEVEL_GATT
+#undef LOG_LOCAL_LEVEL
+#if defined(CONFIG_LOG_MAXIMUM_LEVEL) && CONFIG_BW_LOG_LEVEL_GATT > CONFIG_LOG_MAXIMUM_LEVEL
+#define LOG_LOCAL_LEVEL CONFIG_LOG_MAXIMUM_LEVEL    // mehr lässt esp_log nicht durch
+#else
+#define LOG_LOCAL_LEVEL CONFIG_BW_LOG_LEVEL_GATT
+#endif
+#endif
+
+static const char* TAG = "GattSession";
+
+// ═══════════════════════════════════════════════════════════════════════
+// NimBLEGattLink: ein NimBLEClient pro Link
+// ═══════════════════════════════════════════════════════════════════════
+
+class NimBLEGattLink : public GattLink, public NimBLEClientCallbacks {
+public:
+    explicit NimBLEGattLink(GattLinkListener& listener)
+        : listener_(listener),
+          client_(NimBLEDevice::createClient()) {
+        if (client_) {
+            client_->setClientCallbacks(this, false);
+            client_->setConnectionParams(12, 12, 0, 100);
+        }
+    }
+
+    ~NimBLEGattLink() override {
+        if (client_) {
+            NimBLEDevice::deleteClient(client_);
+        }
+    }
+
+    bool valid() const { return client_ != nullptr; }
+
+    // ── GattLink ─────────────────────────────────────────────────────
+
+    bool connect(const char* address, uint8_t addressType, uint32_t timeoutMs) override {
+        client_->setConnectTimeout(timeoutMs);
+        NimBLEAddress peer(address, addressType);
+        // asyncConnect: Ergebnis kommt über onConnect()/onConnectFail()
+        return client_->connect(peer, true, true, true);
+    }
+
+    void cancelConnect() override {
+        client_->cancelConnect();
+    }
+
+    bool secure() override {
+        return client_->secureConnection(true);
+    }
+
+    void disconnect() override {
+        client_->disconnect();
+    }
+
+    bool isConnected() const override {
+        return client_->isConnected();
+    }
+
+    bool isEncrypted() const override {
+        return client_->isConnected() && client_->getConnInfo().isEncrypted();
+    }
+
+    uint16_t mtu() const override {
+        return client_->getMTU();
+    }
+
+    std::string peerAddress() const override {
+        return client_->getPeerAddress().toString();
+    }
+
+    size_t discover() override {
+        return client_->getServices(true).size();
+    }
+
+    uint8_t properties(const char* uuid) override {
+        NimBLERemoteCharacteristic* ch = find(uuid);
+        if (!ch) {
+            return 0;
+        }
+        return (ch->canRead() ? GATT_PROP_READ : 0) |
+               (ch->canWrite() ? GATT_PROP_WRITE : 0) |
+               (ch->canWriteNoResponse() ? GATT_PROP_WRITE_NR : 0);
+    }
+
+    bool read(const char* uuid, std::string& value) override {
+        NimBLERemoteCharacteristic* ch = find(uuid);
+        if (!ch) {
+            return false;
+        }
+        value = ch->readValue();
+        return !value.empty();
+    }
+
+    bool write(const char* uuid, const uint8_t* data, size_t length, bool response) override {
+        NimBLERemoteCharacteristic* ch = find(uuid);
+        return ch && ch->writeValue(data, length, response);
+    }
+
+    void visit(const GattCharVisitor& visitor) override {
+        for (auto* service : client_->getServices(false)) {
+            std::string serviceUuid = service->getUUID().toString();
+            for (auto* ch : service->getCharacteristics(true)) {
+                visitor(serviceUuid, ch->getUUID().toString(),
+                        (ch->canRead() ? GATT_PROP_READ : 0) |
+                        (ch->canWrite() ? GATT_PROP_WRITE : 0) |
+                        (ch->canWriteNoResponse() ? GATT_PROP_WRITE_NR : 0));
+            }
+        }
+    }
+
+    // ── NimBLEClientCallbacks (NimBLE Host Task) ─────────────────────
+
+    void onConnect(NimBLEClient* pClient) override {
+        ESP_LOGI(TAG, "CLIENT CONNECTED: %s (MTU %d)",
+                 pClient->getPeerAddress().toString().c_str(), pClient->getMTU());
+        // NOTE: Do NOT call updateConnParams() here.
+        // Changing connection parameters during the initial setup phase (before MTU
+        // exchange and pairing are complete) causes the Shelly device to disconnect.
+        listener_.onLinkConnected();
+    }
+
+    void onConnectFail(NimBLEClient* pClient, int reason) override {
+        listener_.onLinkConnectFailed(reason);
+    }
+
+    void onDisconnect(NimBLEClient* pClient, int reason) override {
+        listener_.onLinkDisconnected(pClient->getPeerAddress().toString(), reason);
+    }
+
+    bool onConnParamsUpdateRequest(NimBLEClient* pClient,
+                                   const ble_gap_upd_params* params) override {
+        ESP_LOGI(TAG, "→ Conn params update request: interval %d-%d, latency %d, timeout %d",
+                 params->itvl_min, params->itvl_max, params->latency, params->supervision_timeout);
+        return true;
+    }
+
+    void onMTUChange(NimBLEClient* pClient, uint16_t mtu) override {
+        listener_.onLinkMtu(mtu);
+    }
+
+    void onAuthenticationComplete(NimBLEConnInfo& connInfo) override {
+        ESP_LOGI(TAG, "AUTHENTICATION COMPLETE");
+        ESP_LOGI(TAG, "  Encrypted:     %s", connInfo.isEncrypted() ? "YES ✓" : "NO ✗");
+        ESP_LOGI(TAG, "  Bonded:        %s", connInfo.isBonded() ? "YES ✓" : "NO ✗");
+        ESP_LOGI(TAG, "  Authenticated: %s", connInfo.isAuthenticated() ? "YES ✓" : "NO ✗");
+        ESP_LOGI(TAG, "  Key Size:      %d bytes", connInfo.getSecKeySize());
+
+        listener_.onLinkAuthComplete(connInfo.isBonded(), connInfo.isEncrypted());
+    }
+
+    void onPassKeyEntry(NimBLEConnInfo& connInfo) override {
+        ESP_LOGW(TAG, "⚠ Passkey entry requested (should NOT happen with Just Works) → injecting 0");
+        NimBLEDevice::injectPassKey(connInfo, 0);
+    }
+
+    void onConfirmPasskey(NimBLEConnInfo& connInfo, uint32_t pass_key) override {
+        ESP_LOGI(TAG, "⚠ Numeric comparison %06u (should NOT happen with Just Works) → confirming",
+                 pass_key);
+        NimBLEDevice::injectConfirmPasskey(connInfo, true);
+    }
+
+private:
+    NimBLERemoteCharacteristic* find(const char* uuid) {
+        NimBLEUUID target(uuid);
+
+        for (auto* service : client_->getServices(false)) {
+            NimBLERemoteCharacteristic* ch = service->getCharacteristic(target);
+            if (ch) {
+                return ch;
+            }
+        }
+
+        return nullptr;
+    }
+
+    GattLinkListener& listener_;
+    NimBLEClient* client_;
+};
+
+GattLink* gattCreateNimBLELink(GattLinkListener& listener) {
+    NimBLEGattLink* link = new NimBLEGattLink(listener);
+    if (!link->valid()) {
+        delete link;
+        return nullptr;
+    }
+    return link;
+}
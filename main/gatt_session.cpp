@@ -0,0 +1,483 @@
+// gatt_session.cpp
+
+#include "gatt_session.h"
+#include <esp_log.h>
+#include <host/ble_hs.h>
+
+// Compile-time Level (Kconfig "BeltWinder Logging")
+#ifdef CONFIG_BW_LOG_LEVEL_GATT
+#undef LOG_LOCAL_LEVEL
+#if defined(CONFIG_LOG_MAXIMUM_LEVEL) && CONFIG_BW_LOG_LEVEL_GATT > CONFIG_LOG_MAXIMUM_LEVEL
+#define LOG_LOCAL_LEVEL CONFIG_LOG_MAXIMUM_LEVEL    // mehr lässt esp_log nicht durch
+#else
+#define LOG_LOCAL_LEVEL CONFIG_BW_LOG_LEVEL_GATT
+#endif
+#endif
+
+static const char* TAG = "GattSession";
+
+// Event Group Bits (gesetzt aus den NimBLE Callbacks)
+#define GATT_EVT_CONNECTED      BIT0
+#define GATT_EVT_CONNECT_FAILED BIT1
+#define GATT_EVT_DISCONNECTED   BIT2
+#define GATT_EVT_AUTH_DONE      BIT3
+#define GATT_EVT_MTU            BIT4
+#define GATT_EVT_ALL            (GATT_EVT_CONNECTED | GATT_EVT_CONNECT_FAILED | \
+                                 GATT_EVT_DISCONNECTED | GATT_EVT_AUTH_DONE | GATT_EVT_MTU)
+
+const char* gattStepName(GattStep step) {
+    switch (step) {
+        case GATT_STEP_IDLE:       return "IDLE";
+        case GATT_STEP_CONNECT:    return "CONNECT";
+        case GATT_STEP_MTU:        return "MTU";
+        case GATT_STEP_SECURE:     return "SECURE";
+        case GATT_STEP_DISCOVER:   return "DISCOVER";
+        case GATT_STEP_READ:       return "READ";
+        case GATT_STEP_WRITE:      return "WRITE";
+        case GATT_STEP_DISCONNECT: return "DISCONNECT";
+        case GATT_STEP_READY:      return "READY";
+        case GATT_STEP_FAILED:     return "FAILED";
+        default:                   return "UNKNOWN";
+    }
+}
+
+GattSession::GattSession(GattLinkFactory factory)
+    : factory_(factory),
+      link_(nullptr),
+      events_(xEventGroupCreate()),
+      disconnectHook_(nullptr),
+      addressType_(BLE_ADDR_RANDOM),
+      discovered_(false),
+      authSuccess_(false),
+      lastReason_(0),
+      connectAttempts_(0),
+      connectResolved_(0),
+      openedAt_(0),
+      stepStart_(0),
+      step_(GATT_STEP_IDLE),
+      failedStep_(GATT_STEP_IDLE) {
+}
+
+GattSession::~GattSession() {
+    close();
+    if (events_) {
+        vEventGroupDelete(events_);
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// Schritt-Verwaltung
+// ═══════════════════════════════════════════════════════════════════════
+
+EventBits_t GattSession::waitFor(EventBits_t bits, uint32_t deadlineMs) {
+    // Bits bleiben gesetzt - gelöscht wird nur beim Start eines Schritts
+    return xEventGroupWaitBits(events_, bits, pdFALSE, pdFALSE,
+                               pdMS_TO_TICKS(deadlineMs)) & bits;
+}
+
+void GattSession::beginStep(GattStep step) {
+    step_ = step;
+    stepStart_ = millis();
+}
+
+void GattSession::endStep() {
+    ESP_LOGI(TAG, "  ✓ %s (%u ms)", gattStepName(step_), millis() - stepStart_);
+    step_ = GATT_STEP_READY;
+}
+
+bool GattSession::failStep(const char* reason) {
+    ESP_LOGE(TAG, "  ✗ %s failed after %u ms: %s",
+             gattStepName(step_), millis() - stepStart_, reason);
+    failedStep_ = step_;
+    step_ = GATT_STEP_FAILED;
+    return false;
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// CONNECT + MTU
+// ═══════════════════════════════════════════════════════════════════════
+
+bool GattSession::open(const String& address, uint8_t addressType,
+                       const GattStepPolicy& policy) {
+    close();
+
+    if (!events_) {
+        ESP_LOGE(TAG, "✗ No event group");
+        return false;
+    }
+
+    failedStep_ = GATT_STEP_IDLE;
+    address_ = address;
+    authSuccess_ = false;
+    lastReason_ = 0;
+    connectAttempts_ = 0;
+    connectResolved_ = 0;
+
+    link_ = factory_ ? factory_(*this) : nullptr;
+    if (!link_) {
+        beginStep(GATT_STEP_CONNECT);
+        return failStep("no GATT client available");
+    }
+
+    uint8_t type = addressType;
+    bool connected = false;
+
+    for (uint8_t attempt = 1; attempt <= policy.attempts && !connected; attempt++) {
+        beginStep(GATT_STEP_CONNECT);
+        xEventGroupClearBits(events_, GATT_EVT_ALL);
+
+        ESP_LOGI(TAG, "→ Connect %d/%d: %s (%s)", attempt, policy.attempts,
+                 address.c_str(), type == BLE_ADDR_PUBLIC ? "PUBLIC" : "RANDOM");
+
+        // Zählt vor connect(): das Ergebnis kann schon währenddessen kommen
+        connectAttempts_++;
+
+        if (link_->connect(address.c_str(), type, policy.deadlineMs)) {
+            EventBits_t bits = waitFor(GATT_EVT_CONNECTED | GATT_EVT_CONNECT_FAILED,
+                                       policy.deadlineMs + GATT_DEADLINE_SLACK_MS);
+
+            if (bits & GATT_EVT_CONNECTED) {
+                connected = true;
+                addressType_ = type;
+                endStep();
+                break;
+            }
+
+            if (!bits) {
+                // Das Fail-Event des Abbruchs kann erst im nächsten Versuch
+                // ankommen - resolveConnectAttempt() ordnet es diesem zu
+                link_->cancelConnect();
+                ESP_LOGW(TAG, "  ⚠ No connection within %u ms", policy.deadlineMs);
+            } else {
+                ESP_LOGW(TAG, "  ⚠ Connect failed (reason 0x%02X)", lastReason_);
+            }
+        } else {
+            // Nicht gestartet → es kommt auch kein Ergebnis
+            connectAttempts_--;
+            ESP_LOGW(TAG, "  ⚠ connect() could not be initiated");
+        }
+
+        type = (type == BLE_ADDR_PUBLIC) ? BLE_ADDR_RANDOM : BLE_ADDR_PUBLIC;
+    }
+
+    if (!connected) {
+        failStep("all connect attempts failed");
+        delete link_;
+        link_ = nullptr;
+        return false;
+    }
+
+    // MTU Exchange läuft automatisch nach dem Connect
+    beginStep(GATT_STEP_MTU);
+    EventBits_t bits = waitFor(GATT_EVT_MTU | GATT_EVT_DISCONNECTED, GATT_MTU_DEADLINE_MS);
+
+    if (bits & GATT_EVT_DISCONNECTED) {
+        failStep("peer disconnected during MTU exchange");
+        close();
+        return false;
+    }
+
+    if (bits & GATT_EVT_MTU) {
+        endStep();
+    } else {
+        ESP_LOGW(TAG, "  ⚠ No MTU update - continuing with %d bytes", mtu());
+        step_ = GATT_STEP_READY;
+    }
+
+    openedAt_ = millis();
+    return true;
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// SECURE
+// ═══════════════════════════════════════════════════════════════════════
+
+bool GattSession::secure(uint32_t deadlineMs) {
+    beginStep(GATT_STEP_SECURE);
+
+    if (!isConnected()) {
+        return failStep("not connected");
+    }
+
+    // Peer kann das Bonding selbst gestartet haben → AUTH_DONE evtl. schon da
+    if (!(xEventGroupGetBits(events_) & GATT_EVT_AUTH_DONE)) {
+        if (isEncrypted()) {
+            authSuccess_ = true;
+        } else if (!link_->secure()) {
+            return failStep("secureConnection() rejected");
+        } else {
+            EventBits_t bits = waitFor(GATT_EVT_AUTH_DONE | GATT_EVT_DISCONNECTED, deadlineMs);
+
+            if (!(bits & GATT_EVT_AUTH_DONE)) {
+                return failStep(bits ? "peer disconnected" : "timeout");
+            }
+        }
+    }
+
+    if (!authSuccess_) {
+        return failStep("bonding rejected");
+    }
+
+    endStep();
+    return true;
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// DISCOVER / READ / WRITE
+// ═══════════════════════════════════════════════════════════════════════
+
+bool GattSession::discover(bool refresh) {
+    if (discovered_ && !refresh) {
+        return true;
+    }
+
+    beginStep(GATT_STEP_DISCOVER);
+    discovered_ = false;
+
+    for (uint8_t attempt = 1; attempt <= GATT_IO_ATTEMPTS; attempt++) {
+        if (!isConnected()) {
+            return failStep("not connected");
+        }
+
+        size_t count = link_->discover();
+        if (count > 0) {
+            discovered_ = true;
+            ESP_LOGI(TAG, "  Found %d services", (int)count);
+            endStep();
+            return true;
+        }
+    }
+
+    return failStep("no services");
+}
+
+bool GattSession::hasCharacteristic(const char* uuid) {
+    return discover() && link_->properties(uuid) != 0;
+}
+
+void GattSession::visitCharacteristics(const GattCharVisitor& visitor) {
+    if (link_ && discovered_) {
+        link_->visit(visitor);
+    }
+}
+
+bool GattSession::read(const char* uuid, std::string& value) {
+    uint8_t props = discover() ? link_->properties(uuid) : 0;
+
+    beginStep(GATT_STEP_READ);
+
+    if (!props) {
+        return failStep("characteristic not found");
+    }
+    if (!(props & GATT_PROP_READ)) {
+        return failStep("characteristic not readable");
+    }
+
+    for (uint8_t attempt = 1; attempt <= GATT_IO_ATTEMPTS; attempt++) {
+        if (!isConnected()) {
+            return failStep("not connected");
+        }
+
+        if (link_->read(uuid, value)) {
+            endStep();
+            return true;
+        }
+    }
+
+    return failStep("no data");
+}
+
+bool GattSession::write(const char* uuid, const uint8_t* data, size_t length) {
+    uint8_t props = discover() ? link_->properties(uuid) : 0;
+
+    beginStep(GATT_STEP_WRITE);
+
+    if (!props) {
+        return failStep("characteristic not found");
+    }
+    if (!(props & (GATT_PROP_WRITE | GATT_PROP_WRITE_NR))) {
+        return failStep("characteristic not writable");
+    }
+
+    for (uint8_t attempt = 1; attempt <= GATT_IO_ATTEMPTS; attempt++) {
+        if (!isConnected()) {
+            return failStep("not connected");
+        }
+
+        // Mit Response bevorzugt: Bestätigung kommt als GATT-Event
+        if ((props & GATT_PROP_WRITE) && link_->write(uuid, data, length, true)) {
+            endStep();
+            return true;
+        }
+        if ((props & GATT_PROP_WRITE_NR) && link_->write(uuid, data, length, false)) {
+            endStep();
+            return true;
+        }
+    }
+
+    return failStep("write rejected");
+}
+
+size_t GattSession::run(GattOp* ops, size_t count) {
+    size_t succeeded = 0;
+    uint32_t start = millis();
+
+    for (size_t i = 0; i < count; i++) {
+        GattOp& op = ops[i];
+
+        if (op.type == GattOp::READ) {
+            std::string data;
+            op.ok = read(op.uuid, data);
+            if (op.ok) {
+                op.value = (uint8_t)data[0];
+            }
+        } else {
+            op.ok = write(op.uuid, &op.value, 1);
+        }
+
+        ESP_LOGI(TAG, "  [%d/%d] %s %s = %d %s", (int)(i + 1), (int)count,
+                 op.type == GattOp::READ ? "READ " : "WRITE", op.uuid, op.value,
+                 op.ok ? "✓" : "✗");
+
+        if (op.ok) {
+            succeeded++;
+        } else if (!isConnected()) {
+            // Link weg → restliche Operationen scheitern ebenfalls
+            for (size_t j = i + 1; j < count; j++) {
+                ops[j].ok = false;
+            }
+            break;
+        }
+    }
+
+    ESP_LOGI(TAG, "✓ Transaction: %d/%d ops in %u ms", (int)succeeded, (int)count,
+             millis() - start);
+    return succeeded;
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// DISCONNECT
+// ═══════════════════════════════════════════════════════════════════════
+
+bool GattSession::waitForDisconnect(uint32_t deadlineMs) {
+    if (!isConnected()) {
+        return true;
+    }
+    return waitFor(GATT_EVT_DISCONNECTED, deadlineMs) != 0;
+}
+
+void GattSession::close() {
+    if (!link_) {
+        return;
+    }
+
+    beginStep(GATT_STEP_DISCONNECT);
+
+    if (link_->isConnected()) {
+        xEventGroupClearBits(events_, GATT_EVT_DISCONNECTED);
+        link_->disconnect();
+
+        if (!waitFor(GATT_EVT_DISCONNECTED, GATT_DISCONNECT_DEADLINE_MS)) {
+            ESP_LOGW(TAG, "  ⚠ No disconnect event after %d ms", GATT_DISCONNECT_DEADLINE_MS);
+        } else {
+            endStep();
+        }
+    }
+
+    delete link_;
+    link_ = nullptr;
+    discovered_ = false;
+    openedAt_ = 0;
+    step_ = GATT_STEP_IDLE;
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// Status
+// ═══════════════════════════════════════════════════════════════════════
+
+bool GattSession::isConnected() const {
+    return link_ && link_->isConnected();
+}
+
+bool GattSession::isConnectedTo(const String& address) const {
+    return isConnected() && address_.equalsIgnoreCase(address);
+}
+
+bool GattSession::isEncrypted() const {
+    return isConnected() && link_->isEncrypted();
+}
+
+uint16_t GattSession::mtu() const {
+    return link_ ? link_->mtu() : 0;
+}
+
+String GattSession::peerAddress() const {
+    return link_ ? String(link_->peerAddress().c_str()) : address_;
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// Link Callbacks (NimBLE Host Task) → Event Bits
+// ═══════════════════════════════════════════════════════════════════════
+
+// Ordnet ein CONNECTED/CONNECT_FAILED dem ältesten offenen Versuch zu.
+// false = Ergebnis eines bereits abgebrochenen Versuchs (cancelConnect()
+// liefert sein Fail-Event asynchron) - darf den laufenden nicht beenden.
+bool GattSession::resolveConnectAttempt() {
+    uint32_t attempt = ++connectResolved_;
+    uint32_t started = connectAttempts_;
+
+    if (attempt > started) {
+        // Kein Versuch offen (z.B. Ergebnis nach dem letzten Abbruch)
+        connectResolved_ = started;
+        return false;
+    }
+    return attempt == started;
+}
+
+void GattSession::onLinkConnected() {
+    if (!resolveConnectAttempt()) {
+        ESP_LOGW(TAG, "Connect event of an earlier attempt - link is up anyway");
+    }
+    // Verbunden ist verbunden - auch wenn der Abbruch zu spät kam
+    xEventGroupSetBits(events_, GATT_EVT_CONNECTED);
+}
+
+void GattSession::onLinkConnectFailed(int reason) {
+    if (!resolveConnectAttempt()) {
+        ESP_LOGD(TAG, "Ignoring stale connect failure (reason 0x%02X)", reason);
+        return;
+    }
+    lastReason_ = reason;
+    xEventGroupSetBits(events_, GATT_EVT_CONNECT_FAILED);
+}
+
+void GattSession::onLinkDisconnected(const std::string& peer, int reason) {
+    lastReason_ = reason;
+
+    const char* text;
+    switch (reason) {
+        case 0x08:  text = "Connection timeout"; break;
+        case 0x13:  text = "Remote terminated"; break;
+        case 0x16:  text = "Local terminated"; break;
+        case 0x3E:  text = "Connection failed"; break;
+        default:    text = "Other"; break;
+    }
+    ESP_LOGI(TAG, "CLIENT DISCONNECTED: reason 0x%02X (%s)", reason, text);
+
+    if (disconnectHook_) {
+        disconnectHook_(String(peer.c_str()), reason);
+    }
+
+    // Ein Disconnect beendet auch ein ausstehendes Connect
+    xEventGroupSetBits(events_, GATT_EVT_DISCONNECTED | GATT_EVT_CONNECT_FAILED);
+}
+
+void GattSession::onLinkMtu(uint16_t mtu) {
+    ESP_LOGI(TAG, "MTU: %d bytes", mtu);
+    xEventGroupSetBits(events_, GATT_EVT_MTU);
+}
+
+void GattSession::onLinkAuthComplete(bool bonded, bool encrypted) {
+    authSuccess_ = bonded && encrypted;
+    xEventGroupSetBits(events_, GATT_EVT_AUTH_DONE);
+}
@@ -0,0 +1,165 @@
+// gatt_session.h
+
+#ifndef GATT_SESSION_H
+#define GATT_SESSION_H
+
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include "gatt_link.h"
+
+// ═══════════════════════════════════════════════════════════════════════
+// GATT Session: ereignisgesteuerte Verbindung statt fester Wartezeiten
+// ═══════════════════════════════════════════════════════════════════════
+//
+// Jeder Schritt startet eine NimBLE-Operation und wartet auf das
+// zugehörige Callback-Ereignis (Event Group). Die Deadline ist nur die
+// Obergrenze - im Normalfall geht es weiter, sobald das Radio fertig ist.
+//
+//   CONNECT → MTU → SECURE → DISCOVER → READ/WRITE → DISCONNECT
+//
+// Discovery und Read/Write laufen über die blockierenden NimBLE-Aufrufe,
+// die intern bereits auf das GATT-Complete-Event warten. Die NimBLE-
+// Aufrufe selbst stecken hinter GattLink (gatt_link.h), die Schritte sind
+// so in test/host gegen einen Fake testbar.
+
+#define GATT_CONNECT_DEADLINE_MS     10000   // pro Verbindungsversuch
+#define GATT_CONNECT_ATTEMPTS        2       // wechselt PUBLIC/RANDOM
+#define GATT_MTU_DEADLINE_MS         2000    // nicht fatal (Default-MTU)
+#define GATT_SECURE_DEADLINE_MS      15000   // Bonding (Just Works)
+#define GATT_DISCONNECT_DEADLINE_MS  2000
+#define GATT_IO_ATTEMPTS             2       // Discovery / Read / Write
+#define GATT_DEADLINE_SLACK_MS       500     // Reserve über dem Stack-Timeout
+
+enum GattStep : uint8_t {
+    GATT_STEP_IDLE,
+    GATT_STEP_CONNECT,
+    GATT_STEP_MTU,
+    GATT_STEP_SECURE,
+    GATT_STEP_DISCOVER,
+    GATT_STEP_READ,
+    GATT_STEP_WRITE,
+    GATT_STEP_DISCONNECT,
+    GATT_STEP_READY,
+    GATT_STEP_FAILED
+};
+
+/**
+ * @brief Deadline und Versuche eines Schritts
+ */
+struct GattStepPolicy {
+    uint32_t deadlineMs;
+    uint8_t attempts;
+};
+
+/**
+ * @brief Eine Operation einer GATT-Transaktion
+ *
+ * READ trägt das erste gelesene Byte in value ein, WRITE schreibt value.
+ * ok wird von GattSession::run() gesetzt.
+ */
+struct GattOp {
+    enum Type : uint8_t { READ, WRITE };
+
+    Type type;
+    const char* uuid;
+    uint8_t value;
+    bool ok;
+
+    static GattOp read(const char* uuid) { return { READ, uuid, 0, false }; }
+    static GattOp write(const char* uuid, uint8_t value) { return { WRITE, uuid, value, false }; }
+};
+
+const char* gattStepName(GattStep step);
+
+class GattSession : public GattLinkListener {
+public:
+    using DisconnectHook = std::function<void(const String& address, int reason)>;
+
+    explicit GattSession(GattLinkFactory factory = gattCreateNimBLELink);
+    ~GattSession();
+
+    // Nicht kopierbar (besitzt Link + Event Group)
+    GattSession(const GattSession&) = delete;
+    GattSession& operator=(const GattSession&) = delete;
+
+    void setDisconnectHook(DisconnectHook hook) { disconnectHook_ = hook; }
+
+    // CONNECT (+ MTU). Fehlversuche wechseln den Address Type.
+    bool open(const String& address, uint8_t addressType,
+              const GattStepPolicy& policy = { GATT_CONNECT_DEADLINE_MS, GATT_CONNECT_ATTEMPTS });
+
+    // SECURE: Bonding anfordern bzw. vom Peer gestartetes Bonding abwarten
+    bool secure(uint32_t deadlineMs = GATT_SECURE_DEADLINE_MS);
+
+    // DISCOVER: einmal pro Verbindung, danach gecacht
+    bool discover(bool refresh = false);
+    bool hasCharacteristic(const char* uuid);
+    // Alle Characteristics der gecachten Discovery (Logging)
+    void visitCharacteristics(const GattCharVisitor& visitor);
+
+    bool read(const char* uuid, std::string& value);
+    bool write(const char* uuid, const uint8_t* data, size_t length);
+
+    // Alle Operationen auf dieser Verbindung, eine Discovery.
+    // Liefert die Anzahl erfolgreicher Operationen.
+    size_t run(GattOp* ops, size_t count);
+
+    // Wartet auf einen vom Peer ausgelösten Disconnect (z.B. Reboot)
+    bool waitForDisconnect(uint32_t deadlineMs);
+
+    // DISCONNECT + Link freigeben
+    void close();
+
+    bool isOpen() const { return link_ != nullptr; }
+    bool isConnected() const;
+    bool isConnectedTo(const String& address) const;
+    bool isEncrypted() const;
+    uint32_t age() const { return openedAt_ ? millis() - openedAt_ : 0; }
+    uint8_t addressType() const { return addressType_; }
+    uint16_t mtu() const;
+    String peerAddress() const;
+
+    GattStep step() const { return step_; }
+    GattStep failedStep() const { return failedStep_; }
+    int lastReason() const { return lastReason_; }
+
+    // GattLinkListener (NimBLE Host Task)
+    void onLinkConnected() override;
+    void onLinkConnectFailed(int reason) override;
+    void onLinkDisconnected(const std::string& peer, int reason) override;
+    void onLinkMtu(uint16_t mtu) override;
+    void onLinkAuthComplete(bool bonded, bool encrypted) override;
+
+private:
+    EventBits_t waitFor(EventBits_t bits, uint32_t deadlineMs);
+    void beginStep(GattStep step);
+    void endStep();
+    bool failStep(const char* reason);
+    bool resolveConnectAttempt();
+
+    GattLinkFactory factory_;
+    GattLink* link_;
+    EventGroupHandle_t events_;
+    DisconnectHook disconnectHook_;
+    String address_;
+    uint8_t addressType_;
+    bool discovered_;
+    volatile bool authSuccess_;
+    volatile int lastReason_;
+    // Connect-Versuche: gestartet / mit CONNECTED bzw. CONNECT_FAILED beendet.
+    // Ein Ergebnis gehört immer zum ältesten offenen Versuch.
+    std::atomic<uint32_t> connectAttempts_;
+    std::atomic<uint32_t> connectResolved_;
+    uint32_t openedAt_;
+    uint32_t stepStart_;
+    GattStep step_;
+    GattStep failedStep_;
+};
+
+#endif // GATT_SESSION_H
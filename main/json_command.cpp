@@ -0,0 +1,414 @@
+// json_command.cpp
+
+#include "json_command.h"
+#include <string.h>
+
+static JsonToken json_token_pool[JSON_CMD_MAX_TOKENS];
+static bool json_token_pool_busy = false;
+
+// ═══════════════════════════════════════════════════════════════════════
+// Parser (rekursiver Abstieg, Tiefe begrenzt)
+// ═══════════════════════════════════════════════════════════════════════
+
+namespace {
+
+struct JsonParser {
+    char* s;
+    size_t len;
+    size_t pos;
+    uint8_t count;
+    const char* error;
+
+    bool fail(const char* msg) {
+        if (!error) error = msg;
+        return false;
+    }
+
+    void skipWhitespace() {
+        while (pos < len && (s[pos] == ' ' || s[pos] == '\t' ||
+                             s[pos] == '\n' || s[pos] == '\r')) {
+            pos++;
+        }
+    }
+
+    int alloc(JsonTokenType type, size_t start) {
+        if (count >= JSON_CMD_MAX_TOKENS) {
+            fail("too many tokens");
+            return -1;
+        }
+        JsonToken& t = json_token_pool[count];
+        t.type = type;
+        t.start = (uint16_t)start;
+        t.end = (uint16_t)start;
+        t.next = count + 1;
+        return count++;
+    }
+
+    static int hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    // Entescaped in place: out läuft nie vor pos
+    bool parseString() {
+        size_t start = ++pos;
+        size_t out = start;
+
+        while (pos < len) {
+            char c = s[pos++];
+
+            if (c == '"') {
+                int idx = alloc(JSON_TOKEN_STRING, start);
+                if (idx < 0) return false;
+                s[out] = '\0';
+                json_token_pool[idx].end = (uint16_t)out;
+                return true;
+            }
+            if ((uint8_t)c < 0x20) {
+                return fail("control character in string");
+            }
+            if (c != '\\') {
+                s[out++] = c;
+                continue;
+            }
+
+            if (pos >= len) break;
+            char e = s[pos++];
+            switch (e) {
+                case '"':  s[out++] = '"';  break;
+                case '\\': s[out++] = '\\'; break;
+                case '/':  s[out++] = '/';  break;
+                case 'b':  s[out++] = '\b'; break;
+                case 'f':  s[out++] = '\f'; break;
+                case 'n':  s[out++] = '\n'; break;
+                case 'r':  s[out++] = '\r'; break;
+                case 't':  s[out++] = '\t'; break;
+                case 'u': {
+                    if (pos + 4 > len) return fail("short \\u escape");
+                    uint32_t cp = 0;
+                    for (int i = 0; i < 4; i++) {
+                        int h = hexValue(s[pos++]);
+                        if (h < 0) return fail("bad \\u escape");
+                        cp = (cp << 4) | h;
+                    }
+                    // UTF-8 (max. 3 Bytes aus 6 Zeichen Escape)
+                    if (cp >= 0xD800 && cp <= 0xDFFF) {
+                        s[out++] = '?';             // Surrogates nicht unterstützt
+                    } else if (cp < 0x80) {
+                        s[out++] = (char)cp;
+                    } else if (cp < 0x800) {
+                        s[out++] = (char)(0xC0 | (cp >> 6));
+                        s[out++] = (char)(0x80 | (cp & 0x3F));
+                    } else {
+                        s[out++] = (char)(0xE0 | (cp >> 12));
+                        s[out++] = (char)(0x80 | ((cp >> 6) & 0x3F));
+                        s[out++] = (char)(0x80 | (cp & 0x3F));
+                    }
+                    break;
+                }
+                default:
+                    return fail("bad escape");
+            }
+        }
+        return fail("unterminated string");
+    }
+
+    bool parsePrimitive() {
+        size_t start = pos;
+        while (pos < len) {
+            char c = s[pos];
+            if (c == ',' || c == '}' || c == ']' || c == ' ' ||
+                c == '\t' || c == '\n' || c == '\r') {
+                break;
+            }
+            if ((uint8_t)c < 0x20 || c == '"' || c == '{' || c == '[' || c == ':') {
+                return fail("unexpected character");
+            }
+            pos++;
+        }
+
+        size_t n = pos - start;
+        const char* p = s + start;
+        bool valid;
+        if ((n == 4 && memcmp(p, "true", 4) == 0) ||
+            (n == 5 && memcmp(p, "false", 5) == 0) ||
+            (n == 4 && memcmp(p, "null", 4) == 0)) {
+            valid = true;
+        } else {
+            // Zahl: -?[0-9]+(.[0-9]+)?([eE][+-]?[0-9]+)?
+            size_t i = 0;
+            if (i < n && p[i] == '-') i++;
+            size_t digits = i;
+            while (i < n && p[i] >= '0' && p[i] <= '9') i++;
+            valid = i > digits;
+            if (valid && i < n && p[i] == '.') {
+                size_t frac = ++i;
+                while (i < n && p[i] >= '0' && p[i] <= '9') i++;
+                valid = i > frac;
+            }
+            if (valid && i < n && (p[i] == 'e' || p[i] == 'E')) {
+                i++;
+                if (i < n && (p[i] == '+' || p[i] == '-')) i++;
+                size_t exp = i;
+                while (i < n && p[i] >= '0' && p[i] <= '9') i++;
+                valid = i > exp;
+            }
+            valid = valid && i == n;
+        }
+        if (!valid) return fail("invalid literal");
+
+        int idx = alloc(JSON_TOKEN_PRIMITIVE, start);
+        if (idx < 0) return false;
+        json_token_pool[idx].end = (uint16_t)pos;
+        return true;
+    }
+
+    bool parseContainer(bool object, uint8_t depth) {
+        if (depth >= JSON_CMD_MAX_DEPTH) return fail("nesting too deep");
+
+        int idx = alloc(object ? JSON_TOKEN_OBJECT : JSON_TOKEN_ARRAY, pos);
+        if (idx < 0) return false;
+        char close = object ? '}' : ']';
+        pos++;
+
+        skipWhitespace();
+        if (pos < len && s[pos] == close) {
+            pos++;
+        } else {
+            while (true) {
+                skipWhitespace();
+                if (object) {
+                    if (pos >= len || s[pos] != '"') return fail("expected key");
+                    if (!parseString()) return false;
+                    skipWhitespace();
+                    if (pos >= len || s[pos] != ':') return fail("expected ':'");
+                    pos++;
+                    skipWhitespace();
+                }
+                if (!parseValue(depth + 1)) return false;
+
+                skipWhitespace();
+                if (pos >= len) return fail("unterminated container");
+                if (s[pos] == ',') {
+                    pos++;
+                    continue;
+                }
+                if (s[pos] == close) {
+                    pos++;
+                    break;
+                }
+                return fail(object ? "expected ',' or '}'" : "expected ',' or ']'");
+            }
+        }
+
+        json_token_pool[idx].end = (uint16_t)pos;
+        json_token_pool[idx].next = count;
+        return true;
+    }
+
+    bool parseValue(uint8_t depth) {
+        if (pos >= len) return fail("unexpected end");
+        switch (s[pos]) {
+            case '{': return parseContainer(true, depth);
+            case '[': return parseContainer(false, depth);
+            case '"': return parseString();
+            default:  return parsePrimitive();
+        }
+    }
+};
+
+// Ganzzahl aus [p, p+n) - Nachkommastellen werden abgeschnitten
+bool parse_integer(const char* p, size_t n, int64_t& out) {
+    size_t i = 0;
+    bool negative = false;
+    if (i < n && p[i] == '-') {
+        negative = true;
+        i++;
+    }
+    if (i >= n || p[i] < '0' || p[i] > '9') return false;
+
+    int64_t value = 0;
+    while (i < n && p[i] >= '0' && p[i] <= '9') {
+        value = value * 10 + (p[i] - '0');
+        if (value > 0xFFFFFFFFLL) return false;
+        i++;
+    }
+    if (i < n && p[i] == '.') {
+        i++;
+        while (i < n && p[i] >= '0' && p[i] <= '9') i++;
+    }
+    if (i != n) return false;       // Exponent o.ä. nicht als Ganzzahl
+
+    out = negative ? -value : value;
+    return true;
+}
+
+} // namespace
+
+// ═══════════════════════════════════════════════════════════════════════
+// json_escape
+// ═══════════════════════════════════════════════════════════════════════
+
+size_t json_escape(char* out, size_t size, const char* in) {
+    if (size == 0) return 0;
+
+    static const char hex[] = "0123456789abcdef";
+    size_t n = 0;
+    for (; in && *in; in++) {
+        uint8_t c = (uint8_t)*in;
+        char seq[6];
+        size_t len;
+
+        if (c == '"' || c == '\\') {
+            seq[0] = '\\';
+            seq[1] = (char)c;
+            len = 2;
+        } else if (c == '\n') {
+            seq[0] = '\\'; seq[1] = 'n'; len = 2;
+        } else if (c == '\r') {
+            seq[0] = '\\'; seq[1] = 'r'; len = 2;
+        } else if (c == '\t') {
+            seq[0] = '\\'; seq[1] = 't'; len = 2;
+        } else if (c < 0x20) {
+            memcpy(seq, "\\u00", 4);
+            seq[4] = hex[c >> 4];
+            seq[5] = hex[c & 0x0F];
+            len = 6;
+        } else {
+            seq[0] = (char)c;
+            len = 1;
+        }
+
+        if (n + len >= size) break;         // Escape nie zerteilen
+        memcpy(out + n, seq, len);
+        n += len;
+    }
+    out[n] = '\0';
+    return n;
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// JsonCommand
+// ═══════════════════════════════════════════════════════════════════════
+
+JsonCommand::JsonCommand() : buf_(nullptr), count_(0), error_(nullptr) {
+}
+
+JsonCommand::~JsonCommand() {
+    if (buf_) {
+        json_token_pool_busy = false;
+    }
+}
+
+bool JsonCommand::parse(char* buf, size_t len) {
+    if (!buf_ && json_token_pool_busy) {
+        error_ = "token pool busy";
+        return false;
+    }
+    if (!buf || len == 0 || len > 0xFFFF) {
+        error_ = "invalid buffer";
+        return false;
+    }
+
+    buf_ = buf;
+    json_token_pool_busy = true;
+    count_ = 0;
+    error_ = nullptr;
+
+    JsonParser p = { buf, len, 0, 0, nullptr };
+    p.skipWhitespace();
+    if (p.pos >= len || buf[p.pos] != '{') {
+        error_ = "expected object";
+        return false;
+    }
+    if (!p.parseContainer(true, 0)) {
+        error_ = p.error;
+        return false;
+    }
+
+    p.skipWhitespace();
+    if (p.pos < len && buf[p.pos] != '\0') {
+        error_ = "trailing data";
+        return false;
+    }
+
+    count_ = p.count;
+    return true;
+}
+
+int JsonCommand::find(const char* key) const {
+    if (count_ == 0 || !key) return -1;
+
+    // Oberstes Objekt: abwechselnd Key, Value
+    int i = 1;
+    while (i + 1 < json_token_pool[0].next) {
+        const JsonToken& k = json_token_pool[i];
+        if (strcmp(buf_ + k.start, key) == 0) {
+            return i + 1;
+        }
+        i = json_token_pool[i + 1].next;
+    }
+    return -1;
+}
+
+bool JsonCommand::has(const char* key) const {
+    return find(key) >= 0;
+}
+
+bool JsonCommand::isNull(const char* key) const {
+    int v = find(key);
+    if (v < 0) return false;
+    const JsonToken& t = json_token_pool[v];
+    return t.type == JSON_TOKEN_PRIMITIVE && buf_[t.start] == 'n';
+}
+
+const char* JsonCommand::getString(const char* key, const char* def) const {
+    int v = find(key);
+    if (v < 0 || json_token_pool[v].type != JSON_TOKEN_STRING) return def;
+    return buf_ + json_token_pool[v].start;
+}
+
+bool JsonCommand::readInt(const char* key, int32_t& out) const {
+    int v = find(key);
+    if (v < 0) return false;
+
+    // Zahl oder Zahl als String ("123456" aus Eingabefeldern)
+    const JsonToken& t = json_token_pool[v];
+    if (t.type != JSON_TOKEN_PRIMITIVE && t.type != JSON_TOKEN_STRING) return false;
+
+    int64_t value;
+    if (!parse_integer(buf_ + t.start, t.end - t.start, value)) return false;
+    if (value < INT32_MIN || value > INT32_MAX) return false;
+    out = (int32_t)value;
+    return true;
+}
+
+int32_t JsonCommand::getInt(const char* key, int32_t def) const {
+    int32_t value;
+    return readInt(key, value) ? value : def;
+}
+
+uint32_t JsonCommand::getUInt(const char* key, uint32_t def) const {
+    int v = find(key);
+    if (v < 0) return def;
+
+    const JsonToken& t = json_token_pool[v];
+    if (t.type != JSON_TOKEN_PRIMITIVE && t.type != JSON_TOKEN_STRING) return def;
+
+    int64_t value;
+    if (!parse_integer(buf_ + t.start, t.end - t.start, value) || value < 0) return def;
+    return (uint32_t)value;
+}
+
+bool JsonCommand::getBool(const char* key, bool def) const {
+    int v = find(key);
+    if (v < 0) return def;
+
+    const JsonToken& t = json_token_pool[v];
+    if (t.type != JSON_TOKEN_PRIMITIVE) return def;
+    if (buf_[t.start] == 't') return true;
+    if (buf_[t.start] == 'f') return false;
+    return def;
+}
@@ -0,0 +1,82 @@
+// json_command.h
+
+#ifndef JSON_COMMAND_H
+#define JSON_COMMAND_H
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ═══════════════════════════════════════════════════════════════════════
+// JSON Command: In-Place Tokenizer für WebSocket-Kommandos
+// ═══════════════════════════════════════════════════════════════════════
+//
+// parse() zerlegt den Empfangspuffer direkt (kein Kopieren, kein Heap):
+// Strings werden im Puffer entescaped und 0-terminiert, die Accessoren
+// liefern Zeiger hinein. Token liegen in einem statischen Pool
+// (JSON_CMD_MAX_TOKENS) - es darf immer nur ein JsonCommand gleichzeitig
+// aktiv sein. Alle WebSocket-Kommandos laufen im httpd-Task, das passt.
+//
+//   JsonCommand json;
+//   if (!json.parse(cmd, strlen(cmd))) → json.error()
+//   const char* address = json.getString("address");     // nullptr = fehlt
+//   uint32_t passkey    = json.getUInt("passkey", 0);
+//
+// Nur das oberste Objekt wird per Key abgefragt; verschachtelte Werte
+// werden validiert und übersprungen.
+
+#define JSON_CMD_MAX_TOKENS   32
+#define JSON_CMD_MAX_DEPTH    8
+
+enum JsonTokenType : uint8_t {
+    JSON_TOKEN_OBJECT,
+    JSON_TOKEN_ARRAY,
+    JSON_TOKEN_STRING,
+    JSON_TOKEN_PRIMITIVE        // Zahl, true, false, null
+};
+
+struct JsonToken {
+    JsonTokenType type;
+    uint8_t next;               // Index des nächsten Geschwister-Tokens
+    uint16_t start;             // Offset im Puffer
+    uint16_t end;               // exklusiv (String: Position der 0)
+};
+
+class JsonCommand {
+public:
+    JsonCommand();
+    ~JsonCommand();
+
+    // Nicht kopierbar (teilt sich den statischen Token-Pool)
+    JsonCommand(const JsonCommand&) = delete;
+    JsonCommand& operator=(const JsonCommand&) = delete;
+
+    // buf muss beschreibbar sein und bleibt für die Accessoren gültig
+    bool parse(char* buf, size_t len);
+    const char* error() const { return error_; }
+
+    bool has(const char* key) const;
+    bool isNull(const char* key) const;
+
+    const char* getString(const char* key, const char* def = nullptr) const;
+    bool readInt(const char* key, int32_t& out) const;     // false = fehlt/ungültig
+    int32_t getInt(const char* key, int32_t def) const;
+    uint32_t getUInt(const char* key, uint32_t def) const;
+    bool getBool(const char* key, bool def) const;
+
+private:
+    int find(const char* key) const;
+
+    char* buf_;
+    uint8_t count_;
+    const char* error_;
+};
+
+// Gegenstück für ausgehende Nachrichten: schreibt in als JSON-String-Inhalt
+// (ohne Anführungszeichen) nach out. ", \ und Steuerzeichen werden escaped,
+// gekürzt wird nur an Zeichengrenzen. out ist immer 0-terminiert (size > 0),
+// Rückgabe = geschriebene Länge.
+size_t json_escape(char* out, size_t size, const char* in);
+
+#endif // JSON_COMMAND_H
@@ -25,6 +25,7 @@
 #include "rollershutter.h"
 #include "matter_cluster_defs.h"
 #include "web_ui_handler.h"
+#include "status_publisher.h"
 #include "shelly_ble_manager.h"
 #include "device_naming.h"
 #include "wifi_manager.h"
@@ -47,6 +48,7 @@ const uint16_t INSTALLED_CLOSED_LIMIT_LIFT_CM = 200;
 
 static app_driver_handle_t shutter_handle = nullptr;
 static WebUIHandler* webUI = nullptr;
+static StatusPublisher* statusPublisher = nullptr;
 static ShellyBLEManager* bleManager = nullptr;
 DeviceNaming* deviceNaming = nullptr;
 static Preferences matterPref;
@@ -222,16 +224,6 @@ void onShutterStateChanged(RollerShutter::State state) {
 }
 
 
-// ============================================================================
-// Last BLE sensor data — kept so the main loop can re-broadcast when window
-// state changes asynchronously (e.g. PENDING → TILTED after the delay timer).
-// Written from NimBLE task, read from loop() — protected by s_ble_cache_mutex.
-// ============================================================================
-static SemaphoreHandle_t   s_ble_cache_mutex = nullptr;
-static String              lastBLEAddress;
-static ShellyBLESensorData lastBLEData;
-static bool                lastBLEDataValid = false;
-
 // ============================================================================
 // BLE Sensor Data Callback
 // ============================================================================
@@ -258,6 +250,22 @@ void onBLESensorData(const String& address, const ShellyBLESensorData& data) {
         webUI->broadcastSensorDataUpdate(address, data);
     }
 
+    // ════════════════════════════════════════════════════════════════
+    // Rolle bestimmen: Matter-Contact + Rolladen-Logik nur für den
+    // Fensterkontakt. Button/Illuminance-Sensoren laufen nur ins WebUI.
+    // ════════════════════════════════════════════════════════════════
+
+    ShellySensorRole role = ShellySensorRole::WINDOW_CONTACT;
+    if (bleManager) {
+        const PairedShellyDevice* dev = bleManager->findPairedDevice(address);
+        if (dev) role = dev->role;
+    }
+
+    if (role != ShellySensorRole::WINDOW_CONTACT) {
+        ESP_LOGI(TAG, "  Role: %s → WebUI only", sensorRoleToString(role));
+        return;
+    }
+
         // ════════════════════════════════════════════════════════════════
     // Matter Update (nur wenn commissioned UND Matter läuft!)
     // ════════════════════════════════════════════════════════════════
@@ -346,14 +354,57 @@ void onBLESensorData(const String& address, const ShellyBLESensorData& data) {
     // ════════════════════════════════════════════════════════════════
     
     shutter_driver_set_window_sensor_data(shutter_handle, data.windowOpen, data.rotation);
+}
+
+// ============================================================================
+// BLU Button → Shutter (Fast Path)
+// ============================================================================
+
+// NimBLE Task: nur einreihen, der Main Loop fährt den Motor
+void onBLEButtonEvent(const String& address, ShellySensorRole role, ShellyButtonEvent event) {
+    if (role != ShellySensorRole::BUTTON) {
+        return;  // z.B. Taster am Fensterkontakt - kein Rolladen-Kommando
+    }
+
+    ButtonBindingSlot slot;
+    switch (event) {
+        case BUTTON_SINGLE_PRESS: slot = BUTTON_BIND_SINGLE; break;
+        case BUTTON_DOUBLE_PRESS: slot = BUTTON_BIND_DOUBLE; break;
+        case BUTTON_TRIPLE_PRESS: slot = BUTTON_BIND_TRIPLE; break;
+        case BUTTON_LONG_PRESS:   slot = BUTTON_BIND_LONG;   break;
+        case BUTTON_HOLD:         slot = BUTTON_BIND_HOLD;   break;
+        default:                  return;
+    }
 
-    // Cache for async re-broadcast when window state changes via loop() timer.
-    // Protect with mutex: this write is from the NimBLE task; reads are from loop().
-    if (s_ble_cache_mutex && xSemaphoreTake(s_ble_cache_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-        lastBLEAddress   = address;
-        lastBLEData      = data;
-        lastBLEDataValid = true;
-        xSemaphoreGive(s_ble_cache_mutex);
+    if (shutter_driver_post_button_event(shutter_handle, slot)) {
+        ESP_LOGI(TAG, "→ BLU Button %s: event 0x%04X queued for shutter",
+                 address.c_str(), (unsigned)event);
+    }
+}
+
+// ============================================================================
+// Restored Window State (Boot)
+// ============================================================================
+
+static void applyRestoredWindowState() {
+    String address;
+    ShellyBLESensorData data;
+    if (!bleManager ||
+        !bleManager->getRestoredSensorState(ShellySensorRole::WINDOW_CONTACT, address, data)) {
+        return;
+    }
+    
+    // RESTORED (RTC, jung genug): wie ein echtes Paket übernehmen.
+    // UNCERTAIN (Alter unbekannt/zu alt): nur "offen" - Schließen bleibt
+    // gesperrt, bis das nächste Advertisement den Zustand bestätigt.
+    if (data.confidence == SensorStateConfidence::RESTORED || data.windowOpen) {
+        shutter_driver_restore_window_state(shutter_handle, data.windowOpen, data.rotation);
+        ESP_LOGI(TAG, "✓ Window state restored: %s (%s)",
+                 data.windowOpen ? "OPEN" : "CLOSED",
+                 sensorStateConfidenceToString(data.confidence));
+    } else {
+        ESP_LOGI(TAG, "Restored window state ignored: CLOSED (%s)",
+                 sensorStateConfidenceToString(data.confidence));
     }
 }
 
@@ -397,7 +448,16 @@ void onBLESensorData(const String& address, const ShellyBLESensorData& data) {
     cluster_t* boolean_cluster = cluster::get(contact_sensor_endpoint, 
                                              chip::app::Clusters::BooleanState::Id);
     if (boolean_cluster) {
-        esp_matter_attr_val_t contact_val = esp_matter_bool(false);
+        // Letzter gültiger Zustand (live oder beim Boot wiederhergestellt),
+        // sonst "offen" bis zum ersten Advertisement
+        bool contact = false;
+        String address;
+        ShellyBLESensorData data;
+        if (bleManager &&
+            bleManager->getSensorDataByRole(ShellySensorRole::WINDOW_CONTACT, address, data)) {
+            contact = !data.windowOpen;
+        }
+        esp_matter_attr_val_t contact_val = esp_matter_bool(contact);
         attribute::update(contact_sensor_endpoint_id, 
                          chip::app::Clusters::BooleanState::Id,
                          chip::app::Clusters::BooleanState::Attributes::StateValue::Id, 
@@ -1218,7 +1278,6 @@ MatterStartResult initializeAndStartMatter() {
 
 void setup() {
     Serial.begin(115200);
-    s_ble_cache_mutex = xSemaphoreCreateMutex();
 
     esp_log_level_set("*", ESP_LOG_INFO);               // Global: INFO
 
@@ -1306,28 +1365,29 @@ void setup() {
     esp_task_wdt_add(loop_task_handle);
 
     // ═══════════════════════════════════════════════════════════════════
-    // PHASE 2: NimBLE Initialization (ALWAYS FIRST)
+    // PHASE 2: NimBLE (LAZY)
     //
-    // CRITICAL ARCHITECTURE RULE (ESP-IDF 5.x, CONFIG_NIMBLE_CPP_IDF=1):
+    // ARCHITECTURE RULE (ESP-IDF 5.x, CONFIG_NIMBLE_CPP_IDF=1):
     //   NimBLEDevice::init() calls nimble_port_init() which calls
     //   esp_bt_controller_init(). Matter's BLEManagerImpl::InitESPBleLayer()
     //   calls the SAME function. Whoever runs SECOND gets
     //   ESP_ERR_INVALID_STATE → crash (if NimBLEDevice) or graceful exit
     //   (if Matter, which uses SuccessOrExit).
     //
-    //   Solution: NimBLE MUST be initialized first, always.
-    //   When matter_enabled=true: Matter's BLE init then fails cleanly and
-    //   BLE advertising is skipped. Matter continues via WiFi commissioning,
-    //   which is the only path available on D1 Mini anyway.
+    //   With CONFIG_ENABLE_CHIPOBLE=n (sdkconfig.defaults) Matter never
+    //   touches the controller, so NimBLE is started on demand by
+    //   ShellyBLEManager::ensureBLEStarted() (first scan / pairing) and
+    //   released again by shutdownBLE() when no sensor is paired.
+    //   Devices without a sensor never reserve the controller + host heap.
+    //
+    //   Only a CHIPoBLE build still has to claim NimBLE before Matter.
     // ═══════════════════════════════════════════════════════════════════
 
     ESP_LOGI(TAG, "═══════════════════════════════════");
-    ESP_LOGI(TAG, "  PHASE 2: NimBLE Initialization");
+    ESP_LOGI(TAG, "  PHASE 2: NimBLE (lazy)");
     ESP_LOGI(TAG, "═══════════════════════════════════");
     ESP_LOGI(TAG, "");
 
-    ESP_LOGI(TAG, "→ Initializing NimBLE (must precede Matter start)...");
-
     #ifdef CONFIG_BT_ENABLED
     {
         esp_err_t ret = esp_bt_controller_mem_release(ESP_BT_MODE_CLASSIC_BT);
@@ -1337,17 +1397,21 @@ void setup() {
     }
     #endif
 
+    #if CONFIG_ENABLE_CHIPOBLE
     if (!NimBLEDevice::isInitialized()) {
-        NimBLEDevice::init("BeltWinder");
+        ESP_LOGI(TAG, "→ Initializing NimBLE (CHIPoBLE build - must precede Matter start)...");
+        NimBLEDevice::init(BLE_DEVICE_NAME);
         if (NimBLEDevice::isInitialized()) {
             ESP_LOGI(TAG, "✓ NimBLE initialized");
             ESP_LOGI(TAG, "  MTU: %d", NimBLEDevice::getMTU());
         } else {
             ESP_LOGE(TAG, "✗ CRITICAL: NimBLE init failed!");
         }
-    } else {
-        ESP_LOGI(TAG, "✓ NimBLE already initialized");
     }
+    #else
+    ESP_LOGI(TAG, "ℹ NimBLE deferred - started on first scan/pairing");
+    ESP_LOGI(TAG, "  Free heap without BLE stack: %u bytes", esp_get_free_heap_size());
+    #endif
 
     ESP_LOGI(TAG, "");
     
@@ -1527,6 +1591,7 @@ void setup() {
     
     bleManager = new ShellyBLEManager();
     bleManager->setSensorDataCallback(onBLESensorData);
+    bleManager->setButtonEventCallback(onBLEButtonEvent);
     
     if (!bleManager->begin()) {
         ESP_LOGE(TAG, "✗ Shelly BLE Manager init failed");
@@ -1535,6 +1600,9 @@ void setup() {
     } else {
         ESP_LOGI(TAG, "✓ Shelly BLE Manager initialized (lazy mode)");
         ESP_LOGI(TAG, "  BLE scanner will start on-demand");
+        
+        // Fensterzustand vor dem ersten Scan (Sicherheitslogik ab Sekunde 0)
+        applyRestoredWindowState();
     }
     
     ESP_LOGI(TAG, "");
@@ -1595,6 +1663,7 @@ void setup() {
 
     webUI = new WebUIHandler(shutter_handle, bleManager);
     webUI->begin();
+    statusPublisher = new StatusPublisher(shutter_handle, bleManager, webUI);
 
     ESP_LOGI(TAG, "✓ Web UI started");
     ESP_LOGI(TAG, "  Access: http://%s.local", names.hostname.c_str());
@@ -1694,18 +1763,15 @@ void setup() {
                 }
                 
                 // ════════════════════════════════════════════════════════════════
-                // NimBLE was already initialized in PHASE 2 (before Matter).
-                // Matter's BLEManagerImpl::InitESPBleLayer() will fail gracefully
-                // because the controller is already owned by NimBLE. That is
-                // intentional: we need WiFi commissioning only (no CHIPoBLE).
-                // The scanner (ShellyBLEManager) uses the NimBLE stack from Phase 2.
+                // Matter uses WiFi commissioning only (no CHIPoBLE), so the BT
+                // controller stays free. ShellyBLEManager starts NimBLE lazily.
                 // ════════════════════════════════════════════════════════════════
 
                 ESP_LOGI(TAG, "");
                 if (NimBLEDevice::isInitialized()) {
-                    ESP_LOGI(TAG, "✓ NimBLE already initialized (Phase 2) — scanner ready");
+                    ESP_LOGI(TAG, "✓ NimBLE running — scanner ready");
                 } else {
-                    ESP_LOGW(TAG, "⚠ NimBLE not initialized — BLE sensor scanning unavailable");
+                    ESP_LOGI(TAG, "ℹ NimBLE not started yet — starts with the first BLE scan");
                 }
             }  // end startMatterStack else
         }  // end createMatterNode else
@@ -1829,15 +1895,14 @@ void loop() {
         // ────────────────────────────────────────────────────────────
         // Window state async re-broadcast (PENDING → TILTED/OPEN after delay)
         // classifyWindowAngle() sets windowStateChanged when called from loop().
-        // We re-broadcast the last cached BLE data with the updated window_state.
+        // We re-broadcast the window contact's registry data with the updated window_state.
         // ────────────────────────────────────────────────────────────
         if (shutter_driver_consume_window_state_changed(shutter_handle)) {
-            if (s_ble_cache_mutex && xSemaphoreTake(s_ble_cache_mutex, 0) == pdTRUE) {
-                bool valid = lastBLEDataValid;
-                String addr = lastBLEAddress;
-                ShellyBLESensorData cached = lastBLEData;
-                xSemaphoreGive(s_ble_cache_mutex);
-                if (valid && webUI) webUI->broadcastSensorDataUpdate(addr, cached);
+            String addr;
+            ShellyBLESensorData cached;
+            if (webUI && bleManager &&
+                bleManager->getSensorDataByRole(ShellySensorRole::WINDOW_CONTACT, addr, cached)) {
+                webUI->broadcastSensorDataUpdate(addr, cached);
             }
         }
 
@@ -1981,12 +2046,11 @@ void loop() {
 
         // Window state async re-broadcast (same as in commissioned branch)
         if (shutter_driver_consume_window_state_changed(shutter_handle)) {
-            if (s_ble_cache_mutex && xSemaphoreTake(s_ble_cache_mutex, 0) == pdTRUE) {
-                bool valid = lastBLEDataValid;
-                String addr = lastBLEAddress;
-                ShellyBLESensorData cached = lastBLEData;
-                xSemaphoreGive(s_ble_cache_mutex);
-                if (valid && webUI) webUI->broadcastSensorDataUpdate(addr, cached);
+            String addr;
+            ShellyBLESensorData cached;
+            if (webUI && bleManager &&
+                bleManager->getSensorDataByRole(ShellySensorRole::WINDOW_CONTACT, addr, cached)) {
+                webUI->broadcastSensorDataUpdate(addr, cached);
             }
         }
 
@@ -2000,19 +2064,9 @@ void loop() {
     // IMMER aktiv (unabhängig von Matter):
     // ════════════════════════════════════════════════════════════════
 
-    // Web UI Updates
-    static uint32_t last_web = 0;
-    if (millis() - last_web >= 2000) {
-        last_web = millis();
-        if (webUI) {
-            char status_msg[128];
-            snprintf(status_msg, sizeof(status_msg),
-                     "{\"type\":\"status\",\"pos\":%d,\"cal\":%s,\"inv\":%s}",
-                     shutter_driver_get_current_percent(shutter_handle),
-                     shutter_driver_is_calibrated(shutter_handle) ? "true" : "false",
-                     shutter_driver_get_direction_inverted(shutter_handle) ? "true" : "false");
-            webUI->broadcast_to_all_clients(status_msg);
-        }
+    // Web UI Updates (nur Änderungen, Keepalive alle 30s)
+    if (statusPublisher) {
+        statusPublisher->loop();
     }
 
     // BLE Manager Loop
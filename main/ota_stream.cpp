@@ -0,0 +1,688 @@
+// ota_stream.cpp
+
+#include "ota_stream.h"
+#include <string.h>
+#include <strings.h>
+#include <miniz.h>                  // tinfl im ROM (Host: test/host/include)
+
+// ═══════════════════════════════════════════════════════════════════════
+// Boundary aus Content-Type
+// ═══════════════════════════════════════════════════════════════════════
+
+bool multipart_boundary(const char* content_type, char* out, size_t size) {
+    if (!content_type || !out || size == 0) return false;
+
+    const char* p = content_type;
+    while (*p && strncasecmp(p, "boundary=", 9) != 0) p++;
+    if (!*p) return false;
+    p += 9;
+
+    const char* start = p;
+    const char* end;
+    if (*p == '"') {
+        start = ++p;
+        end = strchr(start, '"');
+        if (!end) return false;
+    } else {
+        end = start;
+        while (*end && *end != ';' && *end != ' ' && *end != '\t') end++;
+    }
+
+    size_t len = end - start;
+    if (len == 0 || len > OTA_MULTIPART_BOUNDARY_MAX || len >= size) return false;
+
+    memcpy(out, start, len);
+    out[len] = '\0';
+    return true;
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// MultipartParser
+// ═══════════════════════════════════════════════════════════════════════
+//
+// Suche nach "\r\n--<boundary>": '\r' kommt im Delimiter nur an erster
+// Stelle vor (CR ist kein gültiges Boundary-Zeichen), daher reicht bei
+// einem Fehlvergleich ein Neustart ohne KMP-Tabelle. Bereits erkannte
+// Zeichen sind genau delim_[0..matched_) und werden bei Fehlvergleich
+// aus delim_ nachgeliefert - es muss nichts zwischengepuffert werden.
+
+static const char HEADER_END[] = "\r\n\r\n";
+
+MultipartParser::MultipartParser()
+    : delim_{},
+      delimLen_(0),
+      matched_(0),
+      skipped_(0),
+      state_(FAILED),
+      sink_(nullptr),
+      ctx_(nullptr),
+      bodyBytes_(0),
+      error_("not started") {
+}
+
+bool MultipartParser::begin(const char* boundary, MultipartDataFn sink, void* ctx) {
+    size_t len = boundary ? strlen(boundary) : 0;
+    if (len == 0 || len > OTA_MULTIPART_BOUNDARY_MAX ||
+        strpbrk(boundary, "\r\n") != nullptr || !sink) {
+        state_ = FAILED;
+        error_ = "invalid boundary";
+        return false;
+    }
+
+    memcpy(delim_, "\r\n--", 4);
+    memcpy(delim_ + 4, boundary, len + 1);
+    delimLen_ = (uint8_t)(len + 4);
+
+    // Der Body beginnt direkt mit "--<boundary>" → CRLF als gelesen werten
+    matched_ = 2;
+    skipped_ = 0;
+    state_ = PREAMBLE;
+    sink_ = sink;
+    ctx_ = ctx;
+    bodyBytes_ = 0;
+    error_ = nullptr;
+    return true;
+}
+
+bool MultipartParser::fail(const char* msg) {
+    state_ = FAILED;
+    if (!error_) error_ = msg;
+    return false;
+}
+
+bool MultipartParser::emit(const uint8_t* data, size_t len) {
+    if (len == 0) return true;
+    if (!sink_(ctx_, data, len)) {
+        return fail("write failed");
+    }
+    bodyBytes_ += len;
+    return true;
+}
+
+bool MultipartParser::feed(const uint8_t* data, size_t len) {
+    size_t i = 0;
+
+    while (i < len) {
+        switch (state_) {
+            case PREAMBLE: {
+                char c = (char)data[i++];
+                if (c == delim_[matched_]) {
+                    if (++matched_ == delimLen_) {
+                        state_ = BOUNDARY_LINE;
+                        matched_ = 0;
+                    }
+                } else {
+                    matched_ = (c == '\r') ? 1 : 0;
+                }
+                if (++skipped_ > OTA_MULTIPART_HEADER_MAX) {
+                    return fail("boundary not found");
+                }
+                break;
+            }
+
+            case BOUNDARY_LINE: {
+                // Rest der Boundary-Zeile: optionales Padding, dann CRLF
+                char c = (char)data[i++];
+                if (c == '\n') {
+                    state_ = HEADERS;
+                    matched_ = 2;           // CRLF zählt für "\r\n\r\n"
+                    skipped_ = 0;
+                } else if (c == '-') {
+                    return fail("no file part");
+                } else if (c != '\r' && c != ' ' && c != '\t') {
+                    return fail("malformed boundary line");
+                }
+                break;
+            }
+
+            case HEADERS: {
+                char c = (char)data[i++];
+                if (c == HEADER_END[matched_]) {
+                    if (++matched_ == 4) {
+                        state_ = BODY;
+                        matched_ = 0;
+                    }
+                } else {
+                    matched_ = (c == '\r') ? 1 : 0;
+                }
+                if (++skipped_ > OTA_MULTIPART_HEADER_MAX) {
+                    return fail("part header too long");
+                }
+                break;
+            }
+
+            case BODY: {
+                if (matched_ == 0) {
+                    // Schnellpfad: alles bis zum nächsten '\r' ist Nutzdaten
+                    const uint8_t* cr = (const uint8_t*)memchr(data + i, '\r', len - i);
+                    size_t n = cr ? (size_t)(cr - (data + i)) : len - i;
+                    if (!emit(data + i, n)) return false;
+                    i += n;
+                    if (cr) {
+                        matched_ = 1;
+                        i++;
+                    }
+                    break;
+                }
+
+                if ((char)data[i] == delim_[matched_]) {
+                    i++;
+                    if (++matched_ == delimLen_) {
+                        state_ = DONE;      // Rest (weitere Parts, Epilog) ignorieren
+                        return true;
+                    }
+                } else {
+                    // Kein Delimiter: vorgehaltene Zeichen sind Nutzdaten,
+                    // aktuelles Zeichen neu bewerten (könnte '\r' sein)
+                    if (!emit((const uint8_t*)delim_, matched_)) return false;
+                    matched_ = 0;
+                }
+                break;
+            }
+
+            case DONE:
+                return true;
+
+            case FAILED:
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// OtaImageInflater
+// ═══════════════════════════════════════════════════════════════════════
+//
+// packedSize wird zweimal geprüft: mehr Bytes als angekündigt brechen
+// sofort ab, und in finish() muss tinfl bis TINFL_STATUS_DONE genau
+// packedSize Bytes gelesen haben. Am Stream-Ende gibt tinfl nicht
+// benötigte ganze Bytes zurück - consumed_ ist die exakte Stream-Länge.
+
+OtaImageInflater::OtaImageInflater()
+    : header_{},
+      headerFill_(0),
+      decomp_(nullptr),
+      dict_(nullptr),
+      dictOfs_(0),
+      maxRawSize_(0),
+      packedBytes_(0),
+      consumed_(0),
+      rawBytes_(0),
+      status_(TINFL_STATUS_NEEDS_MORE_INPUT),
+      done_(false),
+      sink_(nullptr),
+      ctx_(nullptr),
+      error_("not started") {
+}
+
+void OtaImageInflater::begin(struct tinfl_decompressor_tag* decomp, uint8_t* dict,
+                             size_t maxRawSize, OtaDataFn sink, void* ctx) {
+    memset(&header_, 0, sizeof(header_));
+    headerFill_ = 0;
+    decomp_ = decomp;
+    dict_ = dict;
+    dictOfs_ = 0;
+    maxRawSize_ = maxRawSize;
+    packedBytes_ = 0;
+    consumed_ = 0;
+    rawBytes_ = 0;
+    status_ = TINFL_STATUS_NEEDS_MORE_INPUT;
+    done_ = false;
+    sink_ = sink;
+    ctx_ = ctx;
+    error_ = (decomp && dict && sink) ? nullptr : "out of memory";
+}
+
+bool OtaImageInflater::fail(const char* msg) {
+    if (!error_) error_ = msg;
+    return false;
+}
+
+bool OtaImageInflater::feed(const uint8_t* data, size_t len) {
+    if (error_) return false;
+
+    if (!headerComplete()) {
+        if (!readHeader(data, len)) return false;
+        if (len == 0) return true;      // Rest kommt mit dem nächsten recv()
+    }
+
+    // Mehr als im Header angekündigt: Müll hinter dem Stream oder falscher Header
+    if (len > header_.packedSize - packedBytes_) {
+        return fail("compressed size mismatch");
+    }
+    packedBytes_ += len;
+
+    return done_ ? true : inflate(data, len);
+}
+
+bool OtaImageInflater::readHeader(const uint8_t*& data, size_t& len) {
+    size_t n = sizeof(header_) - headerFill_;
+    if (n > len) n = len;
+    memcpy((uint8_t*)&header_ + headerFill_, data, n);
+    headerFill_ += n;
+    data += n;
+    len -= n;
+
+    if (!headerComplete()) return true;
+
+    if (memcmp(header_.magic, OTA_IMAGE_MAGIC, 4) != 0) {
+        return fail("not an ESP32 firmware image");
+    }
+    if (header_.version != OTA_IMAGE_VERSION || header_.algorithm != OTA_IMAGE_ALGO_DEFLATE) {
+        return fail("unsupported compressed image");
+    }
+    if (header_.windowBits > OTA_INFLATE_WINDOW_BITS) {
+        return fail("compression window too large");
+    }
+    if (header_.rawSize == 0 || header_.rawSize > maxRawSize_) {
+        return fail("image too large for partition");
+    }
+
+    tinfl_init(decomp_);
+    return true;
+}
+
+bool OtaImageInflater::inflate(const uint8_t* data, size_t len) {
+    while (true) {
+        // dict_ ist Ringpuffer und Deflate-Fenster zugleich
+        size_t in_bytes = len;
+        size_t out_bytes = OTA_INFLATE_DICT - dictOfs_;
+        tinfl_status status = tinfl_decompress(decomp_, data, &in_bytes,
+                                               dict_, dict_ + dictOfs_, &out_bytes,
+                                               TINFL_FLAG_HAS_MORE_INPUT);
+        status_ = status;
+        data += in_bytes;
+        len -= in_bytes;
+        consumed_ += in_bytes;
+
+        if (out_bytes > 0) {
+            rawBytes_ += out_bytes;
+            if (rawBytes_ > header_.rawSize) {
+                return fail("decompressed size mismatch");
+            }
+            if (!sink_(ctx_, dict_ + dictOfs_, out_bytes)) {
+                return fail("write failed");
+            }
+            dictOfs_ = (dictOfs_ + out_bytes) & (OTA_INFLATE_DICT - 1);
+        }
+
+        if (status < TINFL_STATUS_DONE) {
+            return fail("decompression failed");
+        }
+        if (status == TINFL_STATUS_DONE) {
+            done_ = true;
+            return true;                // Bytes danach prüft finish()
+        }
+        if (status == TINFL_STATUS_NEEDS_MORE_INPUT) {
+            return true;                // Eingabe vollständig verbraucht
+        }
+        // TINFL_STATUS_HAS_MORE_OUTPUT: Fenster voll → nächste Runde
+    }
+}
+
+bool OtaImageInflater::finish() {
+    if (error_) return false;
+
+    if (!headerComplete() || !done_) {
+        return fail("compressed image truncated");
+    }
+    if (rawBytes_ != header_.rawSize) {
+        return fail("decompressed size mismatch");
+    }
+    if (consumed_ != header_.packedSize || packedBytes_ != header_.packedSize) {
+        return fail("compressed size mismatch");
+    }
+    return true;
+}
+
+#ifdef ESP_PLATFORM
+
+#include <esp_app_format.h>
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+
+static const char* TAG = "OtaStream";
+
+#define OTA_STREAM_WAIT_MS    10000   // Writer hängt → abbrechen
+
+// ═══════════════════════════════════════════════════════════════════════
+// OtaStreamWriter
+// ═══════════════════════════════════════════════════════════════════════
+
+OtaStreamWriter::OtaStreamWriter()
+    : partition_(nullptr),
+      handle_(0),
+      otaStarted_(false),
+      mode_(MODE_DETECT),
+      inflater_(nullptr),
+      dict_(nullptr),
+      buffers_{nullptr, nullptr},
+      active_(0),
+      fill_(0),
+      filled_(nullptr),
+      free_(nullptr),
+      done_(nullptr),
+      task_(nullptr),
+      failed_(false),
+      writeErr_(ESP_OK),
+      error_(nullptr),
+      received_(0),
+      rawBytes_(0),
+      written_(0),
+      stallMs_(0) {
+    mbedtls_sha256_init(&sha_);
+}
+
+OtaStreamWriter::~OtaStreamWriter() {
+    abort();
+    mbedtls_sha256_free(&sha_);
+}
+
+esp_err_t OtaStreamWriter::begin() {
+    partition_ = esp_ota_get_next_update_partition(NULL);
+    if (!partition_) {
+        error_ = "no OTA partition";
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        buffers_[i] = (uint8_t*)heap_caps_malloc(OTA_STREAM_CHUNK,
+                                                 MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (!buffers_[i]) {
+            error_ = "out of memory";
+            release();
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    filled_ = xQueueCreate(2, sizeof(Chunk));
+    free_ = xQueueCreate(2, sizeof(uint8_t));
+    done_ = xSemaphoreCreateBinary();
+    if (!filled_ || !free_ || !done_) {
+        error_ = "out of memory";
+        release();
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Puffer 0 wird gefüllt, Puffer 1 wartet
+    active_ = 0;
+    fill_ = 0;
+    uint8_t spare = 1;
+    xQueueSend(free_, &spare, 0);
+
+    mbedtls_sha256_starts(&sha_, 0);
+
+    // Sequentiell: Sektoren werden beim Schreiben gelöscht statt vorab
+    // die ganze Partition (spart mehrere Sekunden vor dem ersten Byte)
+    esp_err_t err = esp_ota_begin(partition_, OTA_WITH_SEQUENTIAL_WRITES, &handle_);
+    if (err != ESP_OK) {
+        error_ = "esp_ota_begin failed";
+        release();
+        return err;
+    }
+    otaStarted_ = true;
+
+    if (xTaskCreate(writer_task, "ota_writer", OTA_STREAM_WRITER_STACK, this,
+                    OTA_STREAM_WRITER_PRIO, &task_) != pdPASS) {
+        task_ = nullptr;
+        error_ = "writer task failed";
+        abort();
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "✓ Streaming to %s @ 0x%x (2 x %u byte buffers)",
+             partition_->label, partition_->address, OTA_STREAM_CHUNK);
+    return ESP_OK;
+}
+
+bool OtaStreamWriter::fail(const char* msg) {
+    if (!error_) error_ = msg;
+    failed_ = true;
+    return false;
+}
+
+bool OtaStreamWriter::write(const uint8_t* data, size_t len) {
+    if (failed_) return false;
+    if (!task_) {
+        error_ = "writer not started";
+        return false;
+    }
+    if (len == 0) return true;
+
+    // Erstes Byte: Firmware (0xE9) oder komprimiertes Image ("BWZ1")
+    if (mode_ == MODE_DETECT) {
+        if (data[0] == ESP_IMAGE_HEADER_MAGIC) {
+            mode_ = MODE_RAW;
+        } else if (data[0] == (uint8_t)OTA_IMAGE_MAGIC[0]) {
+            inflater_ = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+            dict_ = (uint8_t*)heap_caps_malloc(OTA_INFLATE_DICT,
+                                               MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+            if (!inflater_ || !dict_) {
+                return fail("out of memory");
+            }
+            image_.begin(inflater_, dict_, partition_->size, inflate_sink, this);
+            mode_ = MODE_COMPRESSED;
+        } else {
+            return fail("not an ESP32 firmware image");
+        }
+    }
+    received_ += len;
+
+    switch (mode_) {
+        case MODE_RAW:
+            return writeRaw(data, len);
+
+        case MODE_COMPRESSED: {
+            bool hadHeader = image_.headerComplete();
+            if (!image_.feed(data, len)) {
+                if (image_.status() < TINFL_STATUS_DONE) {
+                    ESP_LOGE(TAG, "✗ tinfl_decompress failed: %d", image_.status());
+                }
+                return fail(image_.error());
+            }
+            if (!hadHeader && image_.headerComplete()) {
+                const OtaImageHeader& header = image_.header();
+                ESP_LOGI(TAG, "✓ Compressed image: %u → %u bytes (window %u, RAM %u)",
+                         header.packedSize, header.rawSize, 1u << header.windowBits,
+                         (unsigned)(sizeof(tinfl_decompressor) + OTA_INFLATE_DICT));
+            }
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
+bool OtaStreamWriter::inflate_sink(void* ctx, const uint8_t* data, size_t len) {
+    return static_cast<OtaStreamWriter*>(ctx)->writeRaw(data, len);
+}
+
+bool OtaStreamWriter::writeRaw(const uint8_t* data, size_t len) {
+    // Erstes Byte prüfen, bevor Flash gelöscht wird (auch nach dem Entpacken)
+    if (rawBytes_ == 0 && data[0] != ESP_IMAGE_HEADER_MAGIC) {
+        return fail("not an ESP32 firmware image");
+    }
+    rawBytes_ += len;
+    if (rawBytes_ > partition_->size) {
+        return fail("image too large for partition");
+    }
+
+    while (len > 0) {
+        size_t n = OTA_STREAM_CHUNK - fill_;
+        if (n > len) n = len;
+
+        memcpy(buffers_[active_] + fill_, data, n);
+        fill_ += n;
+        data += n;
+        len -= n;
+
+        if (fill_ == OTA_STREAM_CHUNK) {
+            if (!submit(active_, fill_)) return false;
+
+            // Nächsten freien Puffer holen - wartet nur, wenn Flash langsamer ist
+            TickType_t start = xTaskGetTickCount();
+            if (xQueueReceive(free_, &active_, pdMS_TO_TICKS(OTA_STREAM_WAIT_MS)) != pdTRUE) {
+                return fail("flash writer timeout");
+            }
+            stallMs_ += pdTICKS_TO_MS(xTaskGetTickCount() - start);
+            fill_ = 0;
+        }
+    }
+    return !failed_;
+}
+
+bool OtaStreamWriter::submit(uint8_t index, size_t len) {
+    Chunk chunk = { index, (uint16_t)len };
+    if (xQueueSend(filled_, &chunk, pdMS_TO_TICKS(OTA_STREAM_WAIT_MS)) != pdTRUE) {
+        return fail("flash writer timeout");
+    }
+    return true;
+}
+
+esp_err_t OtaStreamWriter::finish(uint8_t sha256[32]) {
+    if (!task_) {
+        if (!error_) error_ = "writer not started";
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Restpuffer + Ende-Marker, dann auf den Writer warten
+    if (fill_ > 0 && !failed_) {
+        submit(active_, fill_);
+        fill_ = 0;
+    }
+    submit(0, 0);
+
+    if (xSemaphoreTake(done_, pdMS_TO_TICKS(OTA_STREAM_WAIT_MS)) != pdTRUE) {
+        error_ = "flash writer timeout";
+        failed_ = true;
+        abort();
+        return ESP_ERR_TIMEOUT;
+    }
+    task_ = nullptr;
+
+    if (failed_) {
+        esp_err_t err = writeErr_ != ESP_OK ? writeErr_ : ESP_FAIL;
+        abort();
+        return err;
+    }
+
+    mbedtls_sha256_finish(&sha_, sha256);
+
+    // Komprimiert: Stream genau packedSize lang, vollständig entpackt und
+    // identisch mit dem Original?
+    if (mode_ == MODE_COMPRESSED) {
+        const OtaImageHeader& header = image_.header();
+        if (!image_.finish() || written_ != header.rawSize) {
+            ESP_LOGE(TAG, "✗ Decompressed %u of %u bytes from %u of %u packed bytes",
+                     written_, header.rawSize, image_.packedBytes(), header.packedSize);
+            fail(image_.error() ? image_.error() : "compressed image truncated");
+            abort();
+            return ESP_ERR_INVALID_SIZE;
+        }
+        if (memcmp(sha256, header.rawSha256, 32) != 0) {
+            fail("decompressed SHA-256 mismatch");
+            abort();
+            return ESP_ERR_INVALID_CRC;
+        }
+        ESP_LOGI(TAG, "✓ Decompressed image verified (%u bytes)", written_);
+    }
+
+    // Prüft Image-Header, Segmente und angehängte SHA-256 des Images
+    esp_err_t err = esp_ota_end(handle_);
+    otaStarted_ = false;
+    if (err != ESP_OK) {
+        error_ = (err == ESP_ERR_OTA_VALIDATE_FAILED) ? "image validation failed"
+                                                      : "esp_ota_end failed";
+    }
+
+    release();
+    return err;
+}
+
+void OtaStreamWriter::abort() {
+    if (task_) {
+        // Ausstehende Chunks verwerfen, Task beenden lassen
+        failed_ = true;
+        Chunk stop = { 0, 0 };
+        if (xQueueSend(filled_, &stop, pdMS_TO_TICKS(OTA_STREAM_WAIT_MS)) == pdTRUE &&
+            xSemaphoreTake(done_, pdMS_TO_TICKS(OTA_STREAM_WAIT_MS)) == pdTRUE) {
+            task_ = nullptr;
+        } else {
+            // Task hängt im Flash-Treiber - Puffer nicht freigeben
+            ESP_LOGE(TAG, "✗ Writer task did not stop - leaking buffers");
+            return;
+        }
+    }
+
+    if (otaStarted_) {
+        esp_ota_abort(handle_);
+        otaStarted_ = false;
+        ESP_LOGW(TAG, "OTA aborted after %u bytes", written_);
+    }
+
+    release();
+}
+
+void OtaStreamWriter::release() {
+    if (inflater_) {
+        free(inflater_);
+        inflater_ = nullptr;
+    }
+    if (dict_) {
+        free(dict_);
+        dict_ = nullptr;
+    }
+    for (int i = 0; i < 2; i++) {
+        if (buffers_[i]) {
+            free(buffers_[i]);
+            buffers_[i] = nullptr;
+        }
+    }
+    if (filled_) {
+        vQueueDelete(filled_);
+        filled_ = nullptr;
+    }
+    if (free_) {
+        vQueueDelete(free_);
+        free_ = nullptr;
+    }
+    if (done_) {
+        vSemaphoreDelete(done_);
+        done_ = nullptr;
+    }
+}
+
+void OtaStreamWriter::writer_task(void* arg) {
+    OtaStreamWriter* self = static_cast<OtaStreamWriter*>(arg);
+    Chunk chunk;
+
+    while (xQueueReceive(self->filled_, &chunk, portMAX_DELAY) == pdTRUE) {
+        if (chunk.len == 0) break;
+
+        if (!self->failed_) {
+            const uint8_t* buf = self->buffers_[chunk.index];
+            esp_err_t err = esp_ota_write(self->handle_, buf, chunk.len);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "✗ esp_ota_write failed at %u: %s",
+                         self->written_, esp_err_to_name(err));
+                self->writeErr_ = err;
+                self->error_ = "flash write failed";
+                self->failed_ = true;
+            } else {
+                mbedtls_sha256_update(&self->sha_, buf, chunk.len);
+                self->written_ += chunk.len;
+            }
+        }
+
+        // Puffer zurück an den Empfang (auch nach Fehler, damit er nicht blockiert)
+        xQueueSend(self->free_, &chunk.index, 0);
+    }
+
+    xSemaphoreGive(self->done_);
+    vTaskDelete(NULL);
+}
+
+#endif // ESP_PLATFORM
@@ -0,0 +1,259 @@
+// ota_stream.h
+
+#ifndef OTA_STREAM_H
+#define OTA_STREAM_H
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ═══════════════════════════════════════════════════════════════════════
+// OTA Stream: inkrementeller Multipart-Parser + doppelt gepufferter Writer
+// ═══════════════════════════════════════════════════════════════════════
+//
+// Empfang und Flash-Schreiben laufen überlappend:
+//
+//   httpd-Task:   recv → MultipartParser → OtaStreamWriter::write()
+//                                              │ (voller Puffer)
+//   Writer-Task:                               └→ esp_ota_write + SHA-256
+//
+// Der Parser arbeitet auf beliebig zerteilten Eingaben - Boundary und
+// Header dürfen über recv()-Grenzen hinweg liegen. Er liefert nur den
+// Inhalt des ersten Parts (die Firmware-Datei).
+//
+// Der Writer sammelt in zwei Puffern à OTA_STREAM_CHUNK (Vielfaches der
+// Flash-Sektorgröße). Während der eine geschrieben wird, füllt der
+// Empfang den anderen. Die SHA-256 wird im Writer-Task mitgerechnet und
+// optional mit X-Firmware-SHA256 des Clients verglichen.
+//
+// Komprimierte Images (.bwz, scripts/compress_ota.py) erkennt der Writer
+// am ersten Byte: OtaImageHeader + Raw-Deflate-Stream. Entpackt wird
+// beim Empfang mit tinfl aus dem ESP32-ROM in ein Fenster von
+// OTA_INFLATE_DICT Bytes; Größe und SHA-256 des entpackten Images werden
+// vor esp_ota_end() gegen den Header geprüft.
+
+#define OTA_STREAM_CHUNK          8192    // 2 Flash-Sektoren
+#define OTA_STREAM_RECV_SIZE      4096
+#define OTA_STREAM_WRITER_STACK   4096
+#define OTA_STREAM_WRITER_PRIO    5
+#define OTA_MULTIPART_BOUNDARY_MAX  70    // RFC 2046
+#define OTA_MULTIPART_HEADER_MAX  1024    // Preamble bzw. Part-Header
+
+#define OTA_INFLATE_WINDOW_BITS   13      // compress_ota.py WINDOW_BITS
+#define OTA_INFLATE_DICT          (1 << OTA_INFLATE_WINDOW_BITS)
+
+// ═══════════════════════════════════════════════════════════════════════
+// Komprimiertes OTA-Image (Little Endian)
+// ═══════════════════════════════════════════════════════════════════════
+
+#define OTA_IMAGE_MAGIC           "BWZ1"
+#define OTA_IMAGE_VERSION         1
+#define OTA_IMAGE_ALGO_DEFLATE    1
+
+struct __attribute__((packed)) OtaImageHeader {
+    char magic[4];              // "BWZ1"
+    uint8_t version;
+    uint8_t algorithm;          // OTA_IMAGE_ALGO_DEFLATE
+    uint8_t windowBits;         // <= OTA_INFLATE_WINDOW_BITS
+    uint8_t reserved;
+    uint32_t rawSize;           // entpackte Firmware
+    uint32_t packedSize;        // Deflate-Stream nach dem Header
+    uint8_t rawSha256[32];
+};
+
+static_assert(sizeof(OtaImageHeader) == 48, "OtaImageHeader layout changed");
+
+// ═══════════════════════════════════════════════════════════════════════
+// MultipartParser (ohne IDF-Abhängigkeiten)
+// ═══════════════════════════════════════════════════════════════════════
+
+// Body-Daten des ersten Parts
+typedef bool (*MultipartDataFn)(void* ctx, const uint8_t* data, size_t len);
+
+// Boundary aus "multipart/form-data; boundary=..." (auch in Anführungszeichen)
+bool multipart_boundary(const char* content_type, char* out, size_t size);
+
+class MultipartParser {
+public:
+    MultipartParser();
+
+    // false = Boundary leer oder zu lang
+    bool begin(const char* boundary, MultipartDataFn sink, void* ctx);
+
+    // false = Formatfehler oder Sink hat abgelehnt (→ error())
+    bool feed(const uint8_t* data, size_t len);
+
+    bool done() const { return state_ == DONE; }
+    const char* error() const { return error_; }
+    size_t bodyBytes() const { return bodyBytes_; }
+
+private:
+    enum State : uint8_t { PREAMBLE, BOUNDARY_LINE, HEADERS, BODY, DONE, FAILED };
+
+    bool fail(const char* msg);
+    bool emit(const uint8_t* data, size_t len);
+
+    // "\r\n--" + Boundary
+    char delim_[4 + OTA_MULTIPART_BOUNDARY_MAX + 1];
+    uint8_t delimLen_;
+    uint8_t matched_;           // Zeichen von delim_ bzw. "\r\n\r\n" erkannt
+    uint16_t skipped_;          // Preamble/Header-Bytes (begrenzt)
+    State state_;
+
+    MultipartDataFn sink_;
+    void* ctx_;
+    size_t bodyBytes_;
+    const char* error_;
+};
+
+// ═══════════════════════════════════════════════════════════════════════
+// OtaImageInflater (ohne IDF-Abhängigkeiten)
+// ═══════════════════════════════════════════════════════════════════════
+//
+// OtaImageHeader + Raw-Deflate-Stream, beliebig zerteilt. tinfl entpackt
+// direkt in dict (Ringpuffer und Deflate-Fenster zugleich), jeder
+// entpackte Abschnitt geht an den Sink. Decompressor und Fenster stellt
+// der Aufrufer - auf dem Gerät aus dem internen RAM.
+
+struct tinfl_decompressor_tag;
+
+// Entpackte Firmware-Daten
+typedef bool (*OtaDataFn)(void* ctx, const uint8_t* data, size_t len);
+
+class OtaImageInflater {
+public:
+    OtaImageInflater();
+
+    // decomp: sizeof(tinfl_decompressor), dict: OTA_INFLATE_DICT Bytes
+    void begin(struct tinfl_decompressor_tag* decomp, uint8_t* dict,
+               size_t maxRawSize, OtaDataFn sink, void* ctx);
+
+    // false = ungültiger Header, Deflate-Fehler, mehr als packedSize
+    // Bytes oder Sink hat abgelehnt (→ error())
+    bool feed(const uint8_t* data, size_t len);
+
+    // Stream vollständig, genau packedSize Bytes, rawSize Bytes entpackt?
+    bool finish();
+
+    bool headerComplete() const { return headerFill_ == sizeof(header_); }
+    const OtaImageHeader& header() const { return header_; }
+    size_t packedBytes() const { return packedBytes_; }   // nach dem Header empfangen
+    size_t rawBytes() const { return rawBytes_; }
+    int status() const { return status_; }             // letzter tinfl_status
+    const char* error() const { return error_; }
+
+private:
+    bool readHeader(const uint8_t*& data, size_t& len);
+    bool inflate(const uint8_t* data, size_t len);
+    bool fail(const char* msg);
+
+    OtaImageHeader header_;
+    uint8_t headerFill_;
+    struct tinfl_decompressor_tag* decomp_;
+    uint8_t* dict_;
+    size_t dictOfs_;
+    size_t maxRawSize_;
+    size_t packedBytes_;
+    size_t consumed_;           // von tinfl gelesen (ohne Bytes nach dem Stream)
+    size_t rawBytes_;
+    int status_;
+    bool done_;
+
+    OtaDataFn sink_;
+    void* ctx_;
+    const char* error_;
+};
+
+#ifdef ESP_PLATFORM
+
+#include <esp_err.h>
+#include <esp_ota_ops.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <mbedtls/sha256.h>
+
+// ═══════════════════════════════════════════════════════════════════════
+// OtaStreamWriter
+// ═══════════════════════════════════════════════════════════════════════
+
+class OtaStreamWriter {
+public:
+    OtaStreamWriter();
+    ~OtaStreamWriter();                 // bricht ein unfertiges Update ab
+
+    OtaStreamWriter(const OtaStreamWriter&) = delete;
+    OtaStreamWriter& operator=(const OtaStreamWriter&) = delete;
+
+    // Partition wählen, Puffer + Writer-Task anlegen, esp_ota_begin()
+    esp_err_t begin();
+
+    // Firmware oder komprimiertes Image (erkannt am ersten Byte).
+    // Kopiert in den aktiven Puffer; false = Writer-Fehler (→ error())
+    bool write(const uint8_t* data, size_t len);
+
+    // Restpuffer schreiben, auf den Writer warten, esp_ota_end().
+    // sha256 = Hash über alle geschriebenen Bytes
+    esp_err_t finish(uint8_t sha256[32]);
+
+    void abort();
+
+    bool compressed() const { return mode_ == MODE_COMPRESSED; }
+    size_t received() const { return received_; }      // hochgeladene Bytes
+    size_t written() const { return written_; }         // Bytes im Flash
+    const char* error() const { return error_; }
+    const esp_partition_t* partition() const { return partition_; }
+
+    // Writer-Wartezeit (Empfang musste auf Flash warten)
+    uint32_t stallMs() const { return stallMs_; }
+
+private:
+    struct Chunk {
+        uint8_t index;
+        uint16_t len;           // 0 = Ende
+    };
+
+    enum Mode : uint8_t { MODE_DETECT, MODE_RAW, MODE_COMPRESSED };
+
+    static void writer_task(void* arg);
+    static bool inflate_sink(void* ctx, const uint8_t* data, size_t len);
+    bool writeRaw(const uint8_t* data, size_t len);
+    bool submit(uint8_t index, size_t len);
+    bool fail(const char* msg);
+    void release();
+
+    const esp_partition_t* partition_;
+    esp_ota_handle_t handle_;
+    bool otaStarted_;
+
+    // Komprimiertes Image
+    Mode mode_;
+    OtaImageInflater image_;
+    struct tinfl_decompressor_tag* inflater_;
+    uint8_t* dict_;
+
+    uint8_t* buffers_[2];
+    uint8_t active_;
+    size_t fill_;
+
+    QueueHandle_t filled_;      // Chunk → Writer
+    QueueHandle_t free_;        // freie Puffer-Indizes → Empfang
+    SemaphoreHandle_t done_;
+    TaskHandle_t task_;
+
+    mbedtls_sha256_context sha_;
+
+    volatile bool failed_;
+    esp_err_t writeErr_;
+    const char* error_;
+    size_t received_;
+    size_t rawBytes_;           // an die Puffer übergeben (ggf. entpackt)
+    size_t written_;            // vom Writer-Task geschrieben
+    uint32_t stallMs_;
+};
+
+#endif // ESP_PLATFORM
+
+#endif // OTA_STREAM_H
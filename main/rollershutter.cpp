@@ -129,6 +129,29 @@ void RollerShutter::loadStateFromKVS() {
              windowLogicCfg.tiltThreshold,
              windowLogicCfg.ventPosition);
 
+    // Button Binding Config
+    uint8_t bb_enabled = 0;
+    err = chip::DeviceLayer::PersistedStorage::KeyValueStoreMgr().Get("bb_enabled", &bb_enabled, sizeof(bb_enabled), &len);
+    buttonBindingCfg.enabled = (bb_enabled != 0);
+
+    uint8_t bb_actions[BUTTON_BIND_COUNT];
+    err = chip::DeviceLayer::PersistedStorage::KeyValueStoreMgr().Get("bb_actions", bb_actions, sizeof(bb_actions), &len);
+    if (err == CHIP_NO_ERROR && len == sizeof(bb_actions)) {
+        for (int i = 0; i < BUTTON_BIND_COUNT; i++) {
+            if (bb_actions[i] <= (uint8_t)ShutterAction::PRESET) {
+                buttonBindingCfg.actions[i] = static_cast<ShutterAction>(bb_actions[i]);
+            }
+        }
+    }
+
+    uint8_t bb_preset = 50;
+    err = chip::DeviceLayer::PersistedStorage::KeyValueStoreMgr().Get("bb_preset", &bb_preset, sizeof(bb_preset), &len);
+    if (err == CHIP_NO_ERROR && bb_preset <= 100) buttonBindingCfg.presetPercent = bb_preset;
+
+    ESP_LOGI(TAG, "  Button Binding:     enabled=%s, preset=%d%%",
+             buttonBindingCfg.enabled ? "YES" : "NO",
+             buttonBindingCfg.presetPercent);
+
     err = chip::DeviceLayer::PersistedStorage::KeyValueStoreMgr().Get("top_history", topLimitHistory, sizeof(topLimitHistory), &len);
     if (err != CHIP_NO_ERROR) {
         memset(topLimitHistory, 0, sizeof(topLimitHistory));
@@ -182,6 +205,16 @@ void RollerShutter::saveStateToKVS() {
     chip::DeviceLayer::PersistedStorage::KeyValueStoreMgr().Put("wl_tilt_thresh", &windowLogicCfg.tiltThreshold,  sizeof(windowLogicCfg.tiltThreshold));
     chip::DeviceLayer::PersistedStorage::KeyValueStoreMgr().Put("wl_vent_pos",    &windowLogicCfg.ventPosition,   sizeof(windowLogicCfg.ventPosition));
 
+    // Button Binding Config
+    uint8_t bb_enabled = buttonBindingCfg.enabled ? 1 : 0;
+    uint8_t bb_actions[BUTTON_BIND_COUNT];
+    for (int i = 0; i < BUTTON_BIND_COUNT; i++) {
+        bb_actions[i] = static_cast<uint8_t>(buttonBindingCfg.actions[i]);
+    }
+    chip::DeviceLayer::PersistedStorage::KeyValueStoreMgr().Put("bb_enabled", &bb_enabled,                     sizeof(bb_enabled));
+    chip::DeviceLayer::PersistedStorage::KeyValueStoreMgr().Put("bb_actions", bb_actions,                      sizeof(bb_actions));
+    chip::DeviceLayer::PersistedStorage::KeyValueStoreMgr().Put("bb_preset",  &buttonBindingCfg.presetPercent, sizeof(buttonBindingCfg.presetPercent));
+
     chip::DeviceLayer::PersistedStorage::KeyValueStoreMgr().Put("top_history", topLimitHistory, sizeof(topLimitHistory));
     chip::DeviceLayer::PersistedStorage::KeyValueStoreMgr().Put("bottom_history", bottomLimitHistory, sizeof(bottomLimitHistory));
     chip::DeviceLayer::PersistedStorage::KeyValueStoreMgr().Put("top_idx", &topLimitHistoryIndex, sizeof(topLimitHistoryIndex));
@@ -412,6 +445,16 @@ void RollerShutter::setWindowLogicConfig(const WindowLogicConfig& cfg) {
              cfg.tiltThreshold, cfg.ventPosition);
 }
 
+void RollerShutter::setButtonBindingConfig(const ButtonBindingConfig& cfg) {
+    buttonBindingCfg = cfg;
+    saveStateToKVS();  // saveState() schreibt nur bei Kalibrier-/Richtungsänderung
+    ESP_LOGI(TAG, "Button binding cfg saved: enabled=%s single=%d double=%d triple=%d long=%d hold=%d preset=%d%%",
+             cfg.enabled ? "YES" : "NO",
+             (int)cfg.actions[BUTTON_BIND_SINGLE], (int)cfg.actions[BUTTON_BIND_DOUBLE],
+             (int)cfg.actions[BUTTON_BIND_TRIPLE], (int)cfg.actions[BUTTON_BIND_LONG],
+             (int)cfg.actions[BUTTON_BIND_HOLD], cfg.presetPercent);
+}
+
 void RollerShutter::setWindowSensorData(bool reedOpen, int16_t rotation) {
     lastRotation = rotation;
 
@@ -457,6 +500,25 @@ void RollerShutter::setWindowSensorData(bool reedOpen, int16_t rotation) {
     classifyWindowAngle();
 }
 
+void RollerShutter::restoreWindowState(bool reedOpen, int16_t rotation) {
+    lastRotation  = rotation;
+    autoVentFired = false;
+
+    if (!reedOpen) {
+        windowState  = WindowState::CLOSED;
+        reedOpenTime = 0;
+    } else {
+        windowState  = (rotation > windowLogicCfg.tiltThreshold) ? WindowState::TILTED
+                                                                 : WindowState::OPEN;
+        // Reed delay counts as elapsed: the next packet classifies immediately
+        reedOpenTime = millis() - windowLogicCfg.reedDelayMs;
+        if (reedOpenTime == 0) reedOpenTime = 1;
+    }
+
+    windowStateChanged = true;
+    ESP_LOGI(TAG, "Window → %s (restored, rotation=%d°)", windowStateStr(windowState), rotation);
+}
+
 void RollerShutter::classifyWindowAngle() {
     // Sensor: reed open + rotation <= tiltThreshold → OPEN (flat, fully open)
     //         reed open + rotation >  tiltThreshold → TILTED
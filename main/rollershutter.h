@@ -50,6 +50,9 @@ public:
 
     // New window logic API
     void setWindowSensorData(bool reedOpen, int16_t rotation);
+    // Boot: last persisted sensor state. Sets windowState directly (no PENDING
+    // delay) and never moves the motor - the next live packet runs the normal logic.
+    void restoreWindowState(bool reedOpen, int16_t rotation);
     WindowState              getWindowState()          const { return windowState; }
     const WindowLogicConfig& getWindowLogicConfig()    const { return windowLogicCfg; }
     void setWindowLogicConfig(const WindowLogicConfig& cfg);
@@ -60,6 +63,10 @@ public:
         return v;
     }
 
+    // BLU Button binding (ausgeführt von shutter_driver_loop)
+    const ButtonBindingConfig& getButtonBindingConfig() const { return buttonBindingCfg; }
+    void setButtonBindingConfig(const ButtonBindingConfig& cfg);
+
     // ════════════════════════════════════════════════════════════════
     // Intelligente Update-Strategie
     // ════════════════════════════════════════════════════════════════
@@ -217,6 +224,8 @@ private:
     bool              autoVentFired      = false; // prevent repeated auto-vent for same tilt event
     bool              windowStateChanged = false; // set when state transitions; cleared by caller
 
+    ButtonBindingConfig buttonBindingCfg;
+
     unsigned long calibrationStartTime = 0;
     const unsigned long CALIBRATION_TIMEOUT = 90000; // 90 Sekunden
     bool calibrationFromBottom = false; // true = DOWN phase is first (shutter starts near top)
@@ -3,12 +3,116 @@
 
 #include <app-common/zap-generated/cluster-objects.h>
 #include <app/clusters/window-covering-server/window-covering-server.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <esp_timer.h>
+#include <string.h>
 
 static const char* TAG = "ShutterDriver";
 
 static RollerShutter* shutter_instance = nullptr;
 static operational_state_callback_t operational_state_callback = nullptr;
 
+// ============================================================================
+// Command Queue (BLU Button → Shutter)
+// ============================================================================
+//
+// Der NimBLE Task legt Button-Events nur ab (nicht blockierend); Motor und
+// Zustandsmaschine werden weiterhin ausschließlich vom Main Loop bedient.
+// Die Aktion wird erst beim Ausführen aus der aktuellen Config gelesen.
+
+#define SHUTTER_CMD_QUEUE_LEN 4
+
+struct ShutterCommand {
+    ButtonBindingSlot slot;
+    int64_t postedAtUs;
+};
+
+static QueueHandle_t command_queue = nullptr;
+
+static const char* button_slot_to_string(ButtonBindingSlot slot) {
+    switch (slot) {
+        case BUTTON_BIND_SINGLE: return "SINGLE";
+        case BUTTON_BIND_DOUBLE: return "DOUBLE";
+        case BUTTON_BIND_TRIPLE: return "TRIPLE";
+        case BUTTON_BIND_LONG:   return "LONG";
+        case BUTTON_BIND_HOLD:   return "HOLD";
+        default:                 return "?";
+    }
+}
+
+const char* shutter_action_to_string(ShutterAction action) {
+    switch (action) {
+        case ShutterAction::NONE:   return "none";
+        case ShutterAction::UP:     return "up";
+        case ShutterAction::DOWN:   return "down";
+        case ShutterAction::STOP:   return "stop";
+        case ShutterAction::TOGGLE: return "toggle";
+        case ShutterAction::PRESET: return "preset";
+        default:                    return "none";
+    }
+}
+
+bool shutter_action_from_string(const char* str, ShutterAction& action) {
+    static const ShutterAction all[] = {
+        ShutterAction::NONE, ShutterAction::UP, ShutterAction::DOWN,
+        ShutterAction::STOP, ShutterAction::TOGGLE, ShutterAction::PRESET
+    };
+    for (ShutterAction a : all) {
+        if (strcmp(str, shutter_action_to_string(a)) == 0) {
+            action = a;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void execute_button_command(RollerShutter* shutter, const ShutterCommand& cmd) {
+    const ButtonBindingConfig& cfg = shutter->getButtonBindingConfig();
+    if (!cfg.enabled || cmd.slot >= BUTTON_BIND_COUNT) return;
+
+    ShutterAction action = cfg.actions[cmd.slot];
+    if (action == ShutterAction::NONE) return;
+
+    RollerShutter::State state = shutter->getCurrentState();
+    bool moving = (state == RollerShutter::State::MOVING_UP ||
+                   state == RollerShutter::State::MOVING_DOWN);
+    bool calibrating = !moving && state != RollerShutter::State::STOPPED;
+
+    if (calibrating && action != ShutterAction::STOP) {
+        ESP_LOGW(TAG, "BLU Button %s ignored: calibration running", button_slot_to_string(cmd.slot));
+        return;
+    }
+
+    uint32_t latencyUs = (uint32_t)(esp_timer_get_time() - cmd.postedAtUs);
+    ESP_LOGI(TAG, "BLU Button %s → %s (queued %u us)",
+             button_slot_to_string(cmd.slot), shutter_action_to_string(action), latencyUs);
+
+    switch (action) {
+        case ShutterAction::UP:
+            shutter->moveToPercent(0);
+            break;
+        case ShutterAction::DOWN:
+            shutter->moveToPercent(100);
+            break;
+        case ShutterAction::STOP:
+            shutter->stop();
+            break;
+        case ShutterAction::TOGGLE:
+            if (moving) {
+                shutter->stop();
+            } else {
+                shutter->moveToPercent(shutter->getCurrentPercent() >= 50 ? 0 : 100);
+            }
+            break;
+        case ShutterAction::PRESET:
+            shutter->moveToPercent(cfg.presetPercent);
+            break;
+        default:
+            break;
+    }
+}
+
 // ============================================================================
 // Window Covering Delegate (Matter Command Handler)
 // ============================================================================
@@ -106,6 +210,9 @@ void shutter_driver_set_covering_delegate_endpoint(uint16_t endpoint_id) {
 app_driver_handle_t shutter_driver_init() {
     if (shutter_instance) delete shutter_instance;
     shutter_instance = new RollerShutter();
+    if (!command_queue) {
+        command_queue = xQueueCreate(SHUTTER_CMD_QUEUE_LEN, sizeof(ShutterCommand));
+    }
     return (app_driver_handle_t)shutter_instance;
 }
 
@@ -120,6 +227,11 @@ void shutter_driver_loop(app_driver_handle_t handle) {
     
     RollerShutter* shutter = (RollerShutter*)handle;
     
+    ShutterCommand cmd;
+    while (command_queue && xQueueReceive(command_queue, &cmd, 0) == pdTRUE) {
+        execute_button_command(shutter, cmd);
+    }
+    
     static RollerShutter::State last_state = RollerShutter::State::STOPPED;
     RollerShutter::State current_state = shutter->getCurrentState();
     
@@ -197,6 +309,11 @@ void shutter_driver_set_window_sensor_data(app_driver_handle_t handle, bool reed
     ((RollerShutter*)handle)->setWindowSensorData(reedOpen, rotation);
 }
 
+void shutter_driver_restore_window_state(app_driver_handle_t handle, bool reedOpen, int16_t rotation) {
+    if (!handle) return;
+    ((RollerShutter*)handle)->restoreWindowState(reedOpen, rotation);
+}
+
 WindowState shutter_driver_get_window_state(app_driver_handle_t handle) {
     if (!handle) return WindowState::CLOSED;
     return ((RollerShutter*)handle)->getWindowState();
@@ -217,6 +334,31 @@ bool shutter_driver_consume_window_state_changed(app_driver_handle_t handle) {
     return ((RollerShutter*)handle)->consumeWindowStateChanged();
 }
 
+const ButtonBindingConfig shutter_driver_get_button_binding_config(app_driver_handle_t handle) {
+    if (!handle) return ButtonBindingConfig{};
+    return ((RollerShutter*)handle)->getButtonBindingConfig();
+}
+
+void shutter_driver_set_button_binding_config(app_driver_handle_t handle, const ButtonBindingConfig& cfg) {
+    if (!handle) return;
+    ((RollerShutter*)handle)->setButtonBindingConfig(cfg);
+}
+
+bool shutter_driver_post_button_event(app_driver_handle_t handle, ButtonBindingSlot slot) {
+    if (!handle || !command_queue || slot >= BUTTON_BIND_COUNT) return false;
+
+    // Deaktiviert oder nicht belegt: gar nicht erst einreihen
+    const ButtonBindingConfig& cfg = ((RollerShutter*)handle)->getButtonBindingConfig();
+    if (!cfg.enabled || cfg.actions[slot] == ShutterAction::NONE) return false;
+
+    ShutterCommand cmd = { slot, esp_timer_get_time() };
+    if (xQueueSend(command_queue, &cmd, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "⚠ Shutter command queue full - button event dropped");
+        return false;
+    }
+    return true;
+}
+
 RollerShutter::State shutter_driver_get_current_state(app_driver_handle_t handle) {
     if (!handle) return RollerShutter::State::STOPPED;
     return ((RollerShutter*)handle)->getCurrentState();
@@ -56,12 +56,21 @@ void shutter_driver_set_window_open_logic(app_driver_handle_t handle, WindowOpen
 
 // Window Sensor (new granular API)
 void shutter_driver_set_window_sensor_data(app_driver_handle_t handle, bool reedOpen, int16_t rotation);
+void shutter_driver_restore_window_state(app_driver_handle_t handle, bool reedOpen, int16_t rotation);
 WindowState             shutter_driver_get_window_state(app_driver_handle_t handle);
 const WindowLogicConfig shutter_driver_get_window_logic_config(app_driver_handle_t handle);
 void shutter_driver_set_window_logic_config(app_driver_handle_t handle, const WindowLogicConfig& cfg);
 // Returns true (and clears internal flag) if window state changed since last call
 bool shutter_driver_consume_window_state_changed(app_driver_handle_t handle);
 
+// BLU Button Binding
+const ButtonBindingConfig shutter_driver_get_button_binding_config(app_driver_handle_t handle);
+void shutter_driver_set_button_binding_config(app_driver_handle_t handle, const ButtonBindingConfig& cfg);
+// Aus beliebigem Task (NimBLE): nur einreihen, ausgeführt im nächsten shutter_driver_loop()
+bool shutter_driver_post_button_event(app_driver_handle_t handle, ButtonBindingSlot slot);
+const char* shutter_action_to_string(ShutterAction action);
+bool shutter_action_from_string(const char* str, ShutterAction& action);
+
 // Operational State Callback
 typedef void (*operational_state_callback_t)(RollerShutter::State state);
 void shutter_driver_set_operational_state_callback(app_driver_handle_t handle, 
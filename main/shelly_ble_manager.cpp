@@ -3,6 +3,11 @@
 #include <esp_log.h>
 #include <mbedtls/ccm.h>
 #include <esp_task_wdt.h>
+#include <esp_attr.h>
+#include <esp_rom_crc.h>
+#include <esp_system.h>
+#include <sys/time.h>
+#include <math.h>
 
 // Für Low-Level NimBLE Bond-Key Extraktion
 #ifdef ESP_PLATFORM
@@ -15,28 +20,86 @@ extern "C" {
 // Für AES/CCM Decryption
 #include <mbedtls/aes.h>
 #include <mbedtls/ccm.h>
+#include <mbedtls/platform_util.h>
 
 static const char* TAG = "ShellyBLE";
 
+// ═══════════════════════════════════════════════════════════════════════
+// Compile-time Log Levels (Kconfig "BeltWinder Logging")
+// ═══════════════════════════════════════════════════════════════════════
+//
+// LOG_LOCAL_LEVEL aus platformio.ini gilt global - hier pro Subsystem
+// überschreiben. Alles oberhalb des Levels wird nicht mitkompiliert
+// (Format-Strings, Argumente, Hex-Dump), esp_log_level_set() zur
+// Laufzeit kann nur noch weiter einschränken. Obergrenze ist
+// CONFIG_LOG_MAXIMUM_LEVEL - darüber filtert esp_log ohnehin alles weg.
+//
+// ADV_LOGx: Pfad pro Advertisement (on_device_found, Parse, Decrypt).
+
+#ifdef CONFIG_BW_LOG_LEVEL_SHELLY_BLE
+#undef LOG_LOCAL_LEVEL
+#if defined(CONFIG_LOG_MAXIMUM_LEVEL) && CONFIG_BW_LOG_LEVEL_SHELLY_BLE > CONFIG_LOG_MAXIMUM_LEVEL
+#define LOG_LOCAL_LEVEL CONFIG_LOG_MAXIMUM_LEVEL    // mehr lässt esp_log nicht durch
+#else
+#define LOG_LOCAL_LEVEL CONFIG_BW_LOG_LEVEL_SHELLY_BLE
+#endif
+#endif
+
+#if defined(CONFIG_BW_LOG_LEVEL_BLE_ADV) && defined(CONFIG_LOG_MAXIMUM_LEVEL) && \
+    CONFIG_BW_LOG_LEVEL_BLE_ADV > CONFIG_LOG_MAXIMUM_LEVEL
+#define BLE_ADV_LOG_LEVEL CONFIG_LOG_MAXIMUM_LEVEL
+#elif defined(CONFIG_BW_LOG_LEVEL_BLE_ADV)
+#define BLE_ADV_LOG_LEVEL CONFIG_BW_LOG_LEVEL_BLE_ADV
+#else
+#define BLE_ADV_LOG_LEVEL ESP_LOG_INFO
+#endif
+
+#define ADV_LOG_ENABLED(level) (BLE_ADV_LOG_LEVEL >= (level))
+
+#define ADV_LOG_AT(level, format, ...) do { \
+        if (ADV_LOG_ENABLED(level)) ESP_LOG_LEVEL(level, TAG, format, ##__VA_ARGS__); \
+    } while (0)
+
+#define ADV_LOGE(format, ...) ADV_LOG_AT(ESP_LOG_ERROR,   format, ##__VA_ARGS__)
+#define ADV_LOGW(format, ...) ADV_LOG_AT(ESP_LOG_WARN,    format, ##__VA_ARGS__)
+#define ADV_LOGI(format, ...) ADV_LOG_AT(ESP_LOG_INFO,    format, ##__VA_ARGS__)
+#define ADV_LOGD(format, ...) ADV_LOG_AT(ESP_LOG_DEBUG,   format, ##__VA_ARGS__)
+#define ADV_LOGV(format, ...) ADV_LOG_AT(ESP_LOG_VERBOSE, format, ##__VA_ARGS__)
+
 // ═══════════════════════════════════════════════════════════════════════
 // Constructor / Destructor
 // ═══════════════════════════════════════════════════════════════════════
 
 ShellyBLEManager::ShellyBLEManager() 
     : bleScanner(nullptr),
-      activeClient(nullptr),
-      activeClientCallbacks(nullptr),
-      activeClientTimestamp(0),
+      wakeSignal(nullptr),
+      wakeTargetMac(0),
       initialized(false),
       scanning(false),
       continuousScan(false),
       stopOnFirstMatch(false),
+      sensorDataLock(portMUX_INITIALIZER_UNLOCKED),
       sensorDataCallback(nullptr),
-      deviceState(STATE_NOT_PAIRED) {
+      deviceState(STATE_NOT_PAIRED),
+      scanProfile(SCAN_PROFILE_DISCOVERY),
+      scanEventCount(0),
+      scanEventsPerMinute(0),
+      scanRateWindowStart(0),
+      scanDutyPercent(BLE_SCAN_DUTY_MAX_PERCENT),
+      scanMissPermille(0),
+      lastStaleCheck(0),
+      stateNvsDirty(false),
+      stateWindowChanged(false),
+      lastStateNvsWrite(0),
+      bleStackHeapBytes(0) {
 }
 
 ShellyBLEManager::~ShellyBLEManager() {
     end();
+    
+    if (wakeSignal) {
+        vSemaphoreDelete(wakeSignal);
+    }
 }
 
 // ═══════════════════════════════════════════════════════════════════════
@@ -60,6 +123,13 @@ bool ShellyBLEManager::begin() {
     // ════════════════════════════════════════════════════════════════════
     
     loadPairedDevice();
+    restoreSensorState();
+    
+    // Vor dem NimBLE Stack anlegen - langlebige Allokationen sollen nicht
+    // zwischen Stack-Blöcken landen (Fragmentierung bei Start/Stop)
+    if (!wakeSignal) {
+        wakeSignal = xSemaphoreCreateBinary();
+    }
     
     initialized = true;
     
@@ -81,11 +151,50 @@ bool ShellyBLEManager::ensureBLEStarted() {
         return true;
     }
 
-    // Guard: NimBLE scanner setup needs ~20KB. Abort before NimBLE can call
-    // its own abort() on allocation failure (which crashes the whole device).
+    // ════════════════════════════════════════════════════════════════════
+    // 1. NimBLE Stack (Controller + Host) - erst bei Bedarf
+    // ════════════════════════════════════════════════════════════════════
+    // Geräte ohne Sensor reservieren so nie den BT-Controller-Heap.
+    // Reihenfolge Stack → Scanner, Freigabe umgekehrt (shutdownBLE), damit
+    // Start/Stop-Zyklen immer denselben Heap-Bereich belegen.
+    
+    bool stackStarted = false;
+    
+    if (!NimBLEDevice::isInitialized()) {
+        uint32_t heapBefore = esp_get_free_heap_size();
+        if (heapBefore < BLE_STACK_MIN_FREE_HEAP) {
+            ESP_LOGE(TAG, "✗ Insufficient heap for NimBLE: %u bytes (need ≥%u)",
+                     heapBefore, BLE_STACK_MIN_FREE_HEAP);
+            return false;
+        }
+        
+        ESP_LOGI(TAG, "→ Starting NimBLE stack... (free heap: %u)", heapBefore);
+        
+        if (!NimBLEDevice::init(BLE_DEVICE_NAME) || !NimBLEDevice::isInitialized()) {
+            ESP_LOGE(TAG, "✗ NimBLE init failed");
+            return false;
+        }
+        
+        uint32_t heapAfter = esp_get_free_heap_size();
+        bleStackHeapBytes = heapBefore > heapAfter ? heapBefore - heapAfter : 0;
+        stackStarted = true;
+        
+        ESP_LOGI(TAG, "✓ NimBLE started: %u bytes (free heap: %u, largest block: %u)",
+                 bleStackHeapBytes, heapAfter,
+                 heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+    }
+
+    // ════════════════════════════════════════════════════════════════════
+    // 2. Scanner
+    // ════════════════════════════════════════════════════════════════════
+
+    // Guard: Abort before NimBLE can call its own abort() on allocation
+    // failure (which crashes the whole device).
     uint32_t free_heap = esp_get_free_heap_size();
-    if (free_heap < 20000) {
-        ESP_LOGE(TAG, "✗ Insufficient heap for BLE scanner: %u bytes (need ≥20KB)", free_heap);
+    if (free_heap < BLE_SCANNER_MIN_FREE_HEAP) {
+        ESP_LOGE(TAG, "✗ Insufficient heap for BLE scanner: %u bytes (need ≥%u)",
+                 free_heap, BLE_SCANNER_MIN_FREE_HEAP);
+        if (stackStarted) shutdownBLE();
         return false;
     }
 
@@ -95,6 +204,7 @@ bool ShellyBLEManager::ensureBLEStarted() {
     auto* raw = new (std::nothrow) esp32_ble_simple::SimpleBLEScanner();
     if (!raw) {
         ESP_LOGE(TAG, "✗ Scanner allocation failed (OOM)");
+        if (stackStarted) shutdownBLE();
         return false;
     }
     auto scanner = std::unique_ptr<esp32_ble_simple::SimpleBLEScanner>(raw);
@@ -103,46 +213,1092 @@ bool ShellyBLEManager::ensureBLEStarted() {
     scanner->set_scan_active(true);
     scanner->set_scan_continuous(false);
     scanner->register_listener(this);
+    scanner->register_raw_listener(&capture);
     
     // Setup (kann fehlschlagen)
     if (!scanner->setup()) {
         ESP_LOGE(TAG, "✗ Scanner setup failed");
-        return false;  // ← scanner wird automatisch freigegeben!
+        scanner.reset();
+        if (stackStarted) shutdownBLE();
+        return false;
+    }
+    
+    // Erfolg: Übernehme Ownership
+    bleScanner = std::move(scanner);
+    
+    ESP_LOGI(TAG, "✓ Scanner ready");
+    return true;
+}
+
+// ════════════════════════════════════════════════════════════════════════
+// Shutdown BLE (Scanner + NimBLE Stack freigeben)
+// ════════════════════════════════════════════════════════════════════════
+
+void ShellyBLEManager::shutdownBLE() {
+    if (!bleScanner && !NimBLEDevice::isInitialized()) {
+        return;
+    }
+    
+    uint32_t heapBefore = esp_get_free_heap_size();
+    uint32_t blockBefore = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    
+    ESP_LOGI(TAG, "→ Shutting down BLE... (free heap: %u)", heapBefore);
+    
+    // Kein Auto-Restart aus stopScan(); NVS bleibt unverändert,
+    // nach einem Reboot startet der Continuous Scan wie gewohnt.
+    continuousScan = false;
+    if (scanning || (bleScanner && bleScanner->is_scanning())) {
+        stopScan();
+    }
+    
+    // Umgekehrte Reihenfolge zu ensureBLEStarted()
+    closeActiveConnection();
+    bleScanner.reset();
+    
+    if (NimBLEDevice::isInitialized()) {
+        if (!NimBLEDevice::deinit(true)) {
+            ESP_LOGE(TAG, "✗ NimBLE deinit failed - stack stays resident");
+            return;
+        }
+    }
+    
+    uint32_t heapAfter = esp_get_free_heap_size();
+    uint32_t blockAfter = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    
+    ESP_LOGI(TAG, "✓ BLE shut down: %d bytes freed (stack took %u at start)",
+             (int)(heapAfter - heapBefore), bleStackHeapBytes);
+    ESP_LOGI(TAG, "  Free heap: %u → %u, largest block: %u → %u",
+             heapBefore, heapAfter, blockBefore, blockAfter);
+    
+    bleStackHeapBytes = 0;
+}
+
+void ShellyBLEManager::end() {
+    if (!initialized) return;
+    
+    flushSensorState(true);
+    shutdownBLE();
+    capture.release();
+    
+    initialized = false;
+    ESP_LOGI(TAG, "Shut down");
+}
+
+void ShellyBLEManager::loop() {
+    if (!initialized) return;
+    
+    if (bleScanner) {
+                bleScanner->loop();
+    }
+    
+    if (bleScanner) {
+        cleanupOldDiscoveries();
+    }
+    
+    // Host Event Rate - zeigt, ob die Controller-Whitelist greift
+    uint32_t now = millis();
+    if (now - scanRateWindowStart >= BLE_SCAN_RATE_WINDOW_MS) {
+        uint32_t count = scanEventCount;
+        scanEventCount = 0;
+        scanEventsPerMinute = (uint32_t)((uint64_t)count * 60000 / (now - scanRateWindowStart));
+        scanRateWindowStart = now;
+        
+        if (scanning) {
+            ESP_LOGD(TAG, "Scan profile %s: %u host events/min",
+                     getScanProfileName(), scanEventsPerMinute);
+        }
+        
+        adaptScanDutyCycle();
+    }
+    
+    if (now - lastStaleCheck >= BLE_LINK_STALE_CHECK_MS) {
+        lastStaleCheck = now;
+        checkStaleSensors();
+    }
+    
+    flushSensorState(false);
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// Scan Profiles
+// ═══════════════════════════════════════════════════════════════════════
+
+bool ShellyBLEManager::applyScanProfile(ScanProfile profile) {
+    if (!bleScanner) {
+        return false;
+    }
+    
+    if (profile == SCAN_PROFILE_DISCOVERY || registry.count() == 0) {
+        // ════════════════════════════════════════════════════════════════
+        // DISCOVERY: offen + aktiv (Namen kommen erst per SCAN_RSP)
+        // ════════════════════════════════════════════════════════════════
+        
+        if (bleScanner->is_whitelist_active()) {
+            ESP_LOGI(TAG, "→ Clearing whitelist...");
+            
+            if (bleScanner->clear_scan_whitelist()) {
+                ESP_LOGI(TAG, "✓ Whitelist cleared successfully");
+                ESP_LOGI(TAG, "  → Discovery scan will see ALL devices");
+            } else {
+                ESP_LOGE(TAG, "✗ Failed to clear whitelist!");
+                ESP_LOGE(TAG, "  Discovery scan might be limited!");
+            }
+        }
+        
+        bleScanner->set_scan_active(true);
+        bleScanner->set_scan_interval_ms(BLE_DISCOVERY_SCAN_INTERVAL_MS);
+        bleScanner->set_scan_window_ms(BLE_DISCOVERY_SCAN_WINDOW_MS);
+        scanProfile = SCAN_PROFILE_DISCOVERY;
+        
+        ESP_LOGI(TAG, "✓ Scan profile: DISCOVERY (active, open, %d/%d ms)",
+                 BLE_DISCOVERY_SCAN_INTERVAL_MS, BLE_DISCOVERY_SCAN_WINDOW_MS);
+        return true;
+    }
+    
+    // ════════════════════════════════════════════════════════════════════
+    // PAIRED: Controller-Whitelist, BEIDE ADDRESS TYPES pro Sensor
+    // ════════════════════════════════════════════════════════════════════
+    
+    std::vector<esp32_ble_simple::SimpleBLEScanner::WhitelistEntry> whitelist;
+    whitelist.reserve(registry.count() * 2);
+    
+    ESP_LOGI(TAG, "  Whitelist entries:");
+    
+    for (size_t i = 0; i < registry.count(); i++) {
+        const PairedShellyDevice& dev = registry[i];
+        
+        // Entry 1: Mit gespeichertem Address Type
+        whitelist.push_back(esp32_ble_simple::SimpleBLEScanner::WhitelistEntry(
+            dev.address.c_str(), dev.addressType));
+        
+        // Entry 2: Mit alternativem Address Type
+        uint8_t altType = (dev.addressType == BLE_ADDR_PUBLIC) 
+                          ? BLE_ADDR_RANDOM 
+                          : BLE_ADDR_PUBLIC;
+        whitelist.push_back(esp32_ble_simple::SimpleBLEScanner::WhitelistEntry(
+            dev.address.c_str(), altType));
+        
+        ESP_LOGI(TAG, "    [%d] %s (type: %s + %s)", (int)i + 1,
+                 dev.address.c_str(),
+                 dev.addressType == BLE_ADDR_PUBLIC ? "PUBLIC" : "RANDOM",
+                 altType == BLE_ADDR_PUBLIC ? "PUBLIC" : "RANDOM");
+    }
+    
+    if (!bleScanner->set_scan_whitelist(whitelist)) {
+        // Ohne Whitelist würde ein passiver Scan alles an den Host liefern -
+        // dann lieber beim bisherigen Profil bleiben
+        ESP_LOGE(TAG, "✗ Failed to configure whitelist!");
+        ESP_LOGE(TAG, "  Continuous scan will see ALL devices");
+        bleScanner->set_scan_active(true);
+        scanProfile = SCAN_PROFILE_DISCOVERY;
+        return false;
+    }
+    
+    // Passiv: BTHome steckt komplett im ADV, SCAN_REQ/RSP kostet nur Airtime.
+    // Namen fehlen dann - on_device_found() erkennt gepairte Sensoren per MAC.
+    // Window folgt dem adaptiven Duty Cycle (adaptScanDutyCycle()).
+    uint32_t window = (uint32_t)BLE_PAIRED_SCAN_INTERVAL_MS * scanDutyPercent / 100;
+    
+    bleScanner->set_scan_active(false);
+    bleScanner->set_scan_interval_ms(BLE_PAIRED_SCAN_INTERVAL_MS);
+    bleScanner->set_scan_window_ms(window);
+    scanProfile = SCAN_PROFILE_PAIRED;
+    
+    ESP_LOGI(TAG, "✓ Scan profile: PAIRED (passive, whitelist %d MAC(s), %d/%u ms, duty %u%%)",
+             (int)registry.count(), BLE_PAIRED_SCAN_INTERVAL_MS, window, scanDutyPercent);
+    ESP_LOGI(TAG, "  → All other devices ignored by BLE hardware");
+    return true;
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// Adaptive Duty Cycle
+// ═══════════════════════════════════════════════════════════════════════
+
+// Aufruf aus on_device_found() unter sensorDataLock
+void ShellyBLEManager::recordAdvertisement(BTHomeAdvStats& stats, bool duplicate,
+                                           uint8_t packetId, int8_t rssi) {
+    // RSSI: jede Kopie ist eine Messung (EWMA + Varianz, α = 1/8)
+    int32_t sampleX16 = (int32_t)rssi * 16;
+    if (stats.rssiAvgX16 == 0) {
+        stats.rssiAvgX16 = sampleX16;
+    } else {
+        int32_t diff = sampleX16 - stats.rssiAvgX16;
+        stats.rssiAvgX16 += diff / 8;
+        stats.rssiVarX16 = (stats.rssiVarX16 * 7 + (uint32_t)(diff * diff) / 16) / 8;
+    }
+    
+    if (duplicate) {
+        if (stats.burstCopies < UINT16_MAX) {
+            stats.burstCopies++;
+        }
+        return;
+    }
+    
+    uint32_t now = millis();
+    
+    if (stats.hasPacketId) {
+        // Packet ID Lücke = komplett verpasste Bursts
+        uint8_t gap = (uint8_t)(packetId - stats.lastPacketId - 1);
+        if (gap > BLE_ADV_MAX_PACKET_ID_GAP) {
+            gap = 0;  // Sensor-Neustart oder lange außer Reichweite
+        }
+        stats.missed += gap;
+        stats.windowMissed += gap;
+        
+        // Burst des vorherigen Pakets abschließen (EWMA, α = 1/8)
+        uint32_t copiesX10 = (uint32_t)stats.burstCopies * 10;
+        stats.avgBurstX10 = stats.avgBurstX10 == 0
+            ? copiesX10
+            : (uint16_t)(((uint32_t)stats.avgBurstX10 * 7 + copiesX10) / 8);
+        
+        // Inter-Arrival-Histogramm (roh, inkl. verpasster Pakete)
+        uint32_t seconds = (now - stats.lastNewMs) / 1000;
+        int bucket = seconds < 2 ? 0 : 31 - __builtin_clz(seconds);
+        if (bucket >= BLE_LINK_HIST_BUCKETS) bucket = BLE_LINK_HIST_BUCKETS - 1;
+        if (stats.intervalHist[bucket] == UINT16_MAX) {
+            // Sättigung: alle halbieren, Verteilung bleibt erhalten
+            for (auto& h : stats.intervalHist) h /= 2;
+        }
+        stats.intervalHist[bucket]++;
+        
+        // Kadenz: verpasste Pakete herausrechnen
+        uint32_t interval = (now - stats.lastNewMs) / (gap + 1);
+        stats.avgIntervalMs = stats.avgIntervalMs == 0
+            ? interval
+            : (stats.avgIntervalMs * 7 + interval) / 8;
+    }
+    
+    stats.hasPacketId = true;
+    stats.lastPacketId = packetId;
+    stats.lastNewMs = now;
+    stats.burstCopies = 1;
+    stats.received++;
+    stats.windowReceived++;
+    stats.stale = false;
+}
+
+void ShellyBLEManager::adaptScanDutyCycle() {
+    uint32_t received = 0;
+    uint32_t missed = 0;
+    uint16_t minBurstX10 = UINT16_MAX;
+    
+    taskENTER_CRITICAL(&sensorDataLock);
+    for (size_t i = 0; i < registry.count(); i++) {
+        const BTHomeAdvStats& s = registry[i].advStats;
+        received += s.windowReceived;
+        missed += s.windowMissed;
+        if (s.avgBurstX10 > 0 && s.avgBurstX10 < minBurstX10) {
+            minBurstX10 = s.avgBurstX10;
+        }
+    }
+    
+    bool enoughSamples = (received + missed) >= BLE_SCAN_ADAPT_MIN_SAMPLES;
+    if (enoughSamples) {
+        for (size_t i = 0; i < registry.count(); i++) {
+            registry[i].advStats.windowReceived = 0;
+            registry[i].advStats.windowMissed = 0;
+        }
+    }
+    taskEXIT_CRITICAL(&sensorDataLock);
+    
+    if (!enoughSamples) {
+        return;  // Sensoren senden selten - weiter sammeln
+    }
+    
+    scanMissPermille = (uint16_t)(missed * 1000 / (received + missed));
+    
+    // ════════════════════════════════════════════════════════════════════
+    // Untergrenze aus dem Burst-Modell: ein Burst mit k Kopien geht nur
+    // verloren, wenn alle Kopien außerhalb des Windows liegen → (1-d)^k.
+    // Der schlechteste Sensor (kleinster Burst) bestimmt die Grenze.
+    // ════════════════════════════════════════════════════════════════════
+    
+    float k = (minBurstX10 == UINT16_MAX) ? 1.0f : minBurstX10 / 10.0f;
+    if (k < 1.0f) k = 1.0f;
+    float target = BLE_SCAN_TARGET_MISS_PERMILLE / 1000.0f;
+    int floorDuty = (int)ceilf((1.0f - powf(target, 1.0f / k)) * 100.0f);
+    
+    // Regelung: schnell hoch bei Verlusten, langsam runter bei Reserve
+    int duty = scanDutyPercent;
+    if (scanMissPermille > BLE_SCAN_TARGET_MISS_PERMILLE) {
+        duty += BLE_SCAN_DUTY_STEP_UP;
+    } else if (scanMissPermille < BLE_SCAN_TARGET_MISS_PERMILLE / 2) {
+        duty -= BLE_SCAN_DUTY_STEP_DOWN;
+    }
+    
+    if (duty < floorDuty) duty = floorDuty;
+    if (duty < BLE_SCAN_DUTY_MIN_PERCENT) duty = BLE_SCAN_DUTY_MIN_PERCENT;
+    if (duty > BLE_SCAN_DUTY_MAX_PERCENT) duty = BLE_SCAN_DUTY_MAX_PERCENT;
+    
+    if (duty != scanDutyPercent) {
+        ESP_LOGI(TAG, "Scan duty cycle: %u%% → %d%% (miss %u‰ of %u, burst %.1f, floor %d%%)",
+                 scanDutyPercent, duty, scanMissPermille, received + missed, k, floorDuty);
+        // Wirksam ab dem nächsten Continuous-Zyklus (applyScanProfile in startScan)
+        scanDutyPercent = (uint8_t)duty;
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// Link Quality / Stale Alarm
+// ═══════════════════════════════════════════════════════════════════════
+
+void ShellyBLEManager::checkStaleSensors() {
+    // Außerhalb des Paired-Scans kommen zwangsläufig keine Pakete an
+    if (!scanning || scanProfile != SCAN_PROFILE_PAIRED) {
+        return;
+    }
+    
+    struct Transition {
+        size_t index;
+        bool stale;
+        uint32_t silentMs;
+    };
+    Transition transitions[BLE_MAX_PAIRED_DEVICES];
+    size_t transitionCount = 0;
+    uint32_t now = millis();
+    
+    taskENTER_CRITICAL(&sensorDataLock);
+    for (size_t i = 0; i < registry.count(); i++) {
+        BTHomeAdvStats& s = registry[i].advStats;
+        if (!s.hasPacketId) {
+            continue;  // Seit Boot noch nie gehört - keine Kadenz bekannt
+        }
+        
+        uint32_t silent = now - s.lastNewMs;
+        if (!s.stale && silent > s.staleAfterMs()) {
+            s.stale = true;
+        }
+        
+        if (s.stale != s.staleReported) {
+            s.staleReported = s.stale;
+            if (s.stale) {
+                s.staleAlarms++;
+            }
+            transitions[transitionCount++] = { i, s.stale, silent };
+        }
+    }
+    taskEXIT_CRITICAL(&sensorDataLock);
+    
+    for (size_t t = 0; t < transitionCount; t++) {
+        const PairedShellyDevice& dev = registry[transitions[t].index];
+        
+        if (transitions[t].stale) {
+            ESP_LOGW(TAG, "⚠ Sensor %s (%s) silent for %u s - heartbeat overdue (limit %u s)",
+                     dev.address.c_str(), sensorRoleToString(dev.role),
+                     transitions[t].silentMs / 1000, dev.advStats.staleAfterMs() / 1000);
+        } else {
+            ESP_LOGI(TAG, "✓ Sensor %s (%s) is back", 
+                     dev.address.c_str(), sensorRoleToString(dev.role));
+        }
+        
+        if (staleSensorCallback) {
+            staleSensorCallback(dev.address, transitions[t].stale, transitions[t].silentMs);
+        }
+    }
+}
+
+String ShellyBLEManager::getLinkStatsJson() const {
+    uint32_t now = millis();
+    char buf[512];
+    String json;
+    json.reserve(192 + registry.count() * 480);
+    
+    snprintf(buf, sizeof(buf),
+             "{\"scan_profile\":\"%s\",\"scanning\":%s,\"duty\":%u,\"miss_permille\":%u,"
+             "\"hist_upper_s\":[",
+             getScanProfileName(),
+             scanning ? "true" : "false",
+             scanDutyPercent,
+             scanMissPermille);
+    json += buf;
+    for (int b = 0; b < BLE_LINK_HIST_BUCKETS - 1; b++) {
+        snprintf(buf, sizeof(buf), "%s%d", b > 0 ? "," : "", 2 << b);
+        json += buf;
+    }
+    json += "],\"sensors\":[";
+    
+    for (size_t i = 0; i < registry.count(); i++) {
+        const PairedShellyDevice& dev = registry[i];
+        
+        // Konsistente Kopie - der NimBLE Host Task schreibt parallel
+        taskENTER_CRITICAL(&sensorDataLock);
+        BTHomeAdvStats s = dev.advStats;
+        BTHomePacketFilter f = dev.packetFilter;
+        taskEXIT_CRITICAL(&sensorDataLock);
+        
+        uint32_t expected = s.received + s.missed;
+        
+        snprintf(buf, sizeof(buf),
+                 "%s{\"address\":\"%s\",\"name\":\"%s\",\"role\":\"%s\","
+                 "\"received\":%u,\"missed\":%u,\"loss_permille\":%u,"
+                 "\"duplicates\":%u,\"replays\":%u,"
+                 "\"decrypt_failures\":%u,\"parse_failures\":%u,"
+                 "\"rssi_avg\":%d,\"rssi_sd\":%.1f,"
+                 "\"adv_interval_ms\":%u,\"burst\":%.1f,"
+                 "\"silent_ms\":%ld,\"stale_after_ms\":%u,\"stale\":%s,\"stale_alarms\":%u,"
+                 "\"interval_hist\":[",
+                 i > 0 ? "," : "",
+                 dev.address.c_str(),
+                 dev.name.c_str(),
+                 sensorRoleToString(dev.role),
+                 s.received,
+                 s.missed,
+                 expected > 0 ? s.missed * 1000 / expected : 0,
+                 f.duplicates,
+                 f.replays,
+                 s.decryptFailures,
+                 s.parseFailures,
+                 s.rssiAvg(),
+                 s.rssiStdDev(),
+                 s.avgIntervalMs,
+                 s.avgBurstX10 / 10.0f,
+                 s.hasPacketId ? (long)(now - s.lastNewMs) : -1L,
+                 s.staleAfterMs(),
+                 s.stale ? "true" : "false",
+                 s.staleAlarms);
+        json += buf;
+        
+        for (int b = 0; b < BLE_LINK_HIST_BUCKETS; b++) {
+            snprintf(buf, sizeof(buf), "%s%u", b > 0 ? "," : "", s.intervalHist[b]);
+            json += buf;
+        }
+        json += "]}";
+    }
+    
+    json += "]}";
+    return json;
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// Sensor Roles
+// ═══════════════════════════════════════════════════════════════════════
+
+const char* sensorStateConfidenceToString(SensorStateConfidence confidence) {
+    switch (confidence) {
+        case SensorStateConfidence::LIVE:      return "live";
+        case SensorStateConfidence::RESTORED:  return "restored";
+        case SensorStateConfidence::UNCERTAIN: return "uncertain";
+        default:                               return "none";
+    }
+}
+
+const char* sensorRoleToString(ShellySensorRole role) {
+    switch (role) {
+        case ShellySensorRole::WINDOW_CONTACT: return "window_contact";
+        case ShellySensorRole::BUTTON:         return "button";
+        case ShellySensorRole::ILLUMINANCE:    return "illuminance";
+        case ShellySensorRole::CLIMATE:        return "climate";
+        case ShellySensorRole::MOTION:         return "motion";
+        default:                               return "unknown";
+    }
+}
+
+bool sensorRoleFromString(const String& str, ShellySensorRole& role) {
+    if (str == "window_contact") { role = ShellySensorRole::WINDOW_CONTACT; return true; }
+    if (str == "button")         { role = ShellySensorRole::BUTTON;         return true; }
+    if (str == "illuminance")    { role = ShellySensorRole::ILLUMINANCE;    return true; }
+    if (str == "climate")        { role = ShellySensorRole::CLIMATE;        return true; }
+    if (str == "motion")         { role = ShellySensorRole::MOTION;         return true; }
+    return false;
+}
+
+ShellySensorRole ShellyBLEManager::roleFromName(const String& name) {
+    const BTHomeDeviceClass* cls = bthomeClassByName(name.c_str());
+    return cls ? cls->defaultRole : ShellySensorRole::WINDOW_CONTACT;
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// Sensor Registry
+// ═══════════════════════════════════════════════════════════════════════
+
+// NVS-Blob Layout (packed, Version im ersten Byte)
+struct __attribute__((packed)) StoredSensor {
+    uint8_t mac[6];          // MSB zuerst (wie Anzeige-String)
+    uint8_t addressType;
+    uint8_t role;
+    uint8_t hasBindkey;
+    uint8_t bindkey[16];
+    char name[24];
+};
+
+struct __attribute__((packed)) StoredRegistry {
+    uint8_t version;
+    uint8_t count;
+    StoredSensor sensors[BLE_MAX_PAIRED_DEVICES];
+};
+
+static const size_t STORED_REGISTRY_HEADER = 2;
+
+static int hexNibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// Bindkey
+// ═══════════════════════════════════════════════════════════════════════
+
+ShellyBindkey& ShellyBindkey::operator=(const ShellyBindkey& other) {
+    if (this != &other) {
+        memcpy(bytes_, other.bytes_, SIZE);
+        set_ = other.set_;
+    }
+    return *this;
+}
+
+void ShellyBindkey::set(const uint8_t* key) {
+    memcpy(bytes_, key, SIZE);
+    set_ = true;
+}
+
+void ShellyBindkey::clear() {
+    mbedtls_platform_zeroize(bytes_, SIZE);
+    set_ = false;
+}
+
+bool ShellyBindkey::fromHex(const char* hex, size_t len) {
+    if (len == 0) {
+        clear();
+        return true;
+    }
+    if (len != HEX_LEN) {
+        return false;
+    }
+    
+    uint8_t key[SIZE];
+    for (size_t i = 0; i < SIZE; i++) {
+        int hi = hexNibble(hex[i * 2]);
+        int lo = hexNibble(hex[i * 2 + 1]);
+        if (hi < 0 || lo < 0) {
+            mbedtls_platform_zeroize(key, sizeof(key));
+            return false;
+        }
+        key[i] = (uint8_t)((hi << 4) | lo);
+    }
+    
+    set(key);
+    mbedtls_platform_zeroize(key, sizeof(key));
+    return true;
+}
+
+void ShellyBindkey::toHex(char* out) const {
+    static const char digits[] = "0123456789abcdef";
+    if (!set_) {
+        out[0] = '\0';
+        return;
+    }
+    for (size_t i = 0; i < SIZE; i++) {
+        out[i * 2] = digits[bytes_[i] >> 4];
+        out[i * 2 + 1] = digits[bytes_[i] & 0x0F];
+    }
+    out[HEX_LEN] = '\0';
+}
+
+String ShellyBindkey::toHex() const {
+    char hex[HEX_LEN + 1];
+    toHex(hex);
+    String result(hex);
+    mbedtls_platform_zeroize(hex, sizeof(hex));
+    return result;
+}
+
+bool ShellyBindkey::operator==(const ShellyBindkey& other) const {
+    uint8_t diff = (uint8_t)(set_ ^ other.set_);
+    for (size_t i = 0; i < SIZE; i++) {
+        diff |= bytes_[i] ^ other.bytes_[i];
+    }
+    return diff == 0;
+}
+
+ShellySensorRegistry::ShellySensorRegistry() : count_(0) {
+    for (auto& slot : slots_) {
+        mbedtls_ccm_init(&slot.ccm);
+        slot.ccmReady = false;
+    }
+    memset(index_, -1, sizeof(index_));
+}
+
+ShellySensorRegistry::~ShellySensorRegistry() {
+    for (auto& slot : slots_) {
+        mbedtls_ccm_free(&slot.ccm);
+    }
+}
+
+bool ShellySensorRegistry::parseMac(const String& address, uint64_t& mac) {
+    if (address.length() != 17) {
+        return false;
+    }
+    
+    uint64_t value = 0;
+    for (int i = 0; i < 6; i++) {
+        if (i < 5 && address[i * 3 + 2] != ':') {
+            return false;
+        }
+        int hi = hexNibble(address[i * 3]);
+        int lo = hexNibble(address[i * 3 + 1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        value = (value << 8) | (uint64_t)((hi << 4) | lo);
+    }
+    
+    mac = value;
+    return true;
+}
+
+int ShellySensorRegistry::slotOf(uint64_t mac) const {
+    size_t pos = hashMac(mac);
+    for (size_t probe = 0; probe < BLE_REGISTRY_INDEX_SIZE; probe++) {
+        int8_t slot = index_[pos];
+        if (slot < 0) {
+            return -1;
+        }
+        if (slots_[slot].device.mac == mac) {
+            return slot;
+        }
+        pos = (pos + 1) & (BLE_REGISTRY_INDEX_SIZE - 1);
+    }
+    return -1;
+}
+
+void ShellySensorRegistry::rebuildIndex() {
+    memset(index_, -1, sizeof(index_));
+    for (size_t i = 0; i < count_; i++) {
+        size_t pos = hashMac(slots_[i].device.mac);
+        while (index_[pos] >= 0) {
+            pos = (pos + 1) & (BLE_REGISTRY_INDEX_SIZE - 1);
+        }
+        index_[pos] = (int8_t)i;
+    }
+}
+
+void ShellySensorRegistry::resetCrypto(Slot& slot) {
+    if (slot.ccmReady) {
+        mbedtls_ccm_free(&slot.ccm);
+        mbedtls_ccm_init(&slot.ccm);
+        slot.ccmReady = false;
+    }
+}
+
+PairedShellyDevice* ShellySensorRegistry::find(uint64_t mac) {
+    int slot = slotOf(mac);
+    return slot >= 0 ? &slots_[slot].device : nullptr;
+}
+
+const PairedShellyDevice* ShellySensorRegistry::find(uint64_t mac) const {
+    int slot = slotOf(mac);
+    return slot >= 0 ? &slots_[slot].device : nullptr;
+}
+
+PairedShellyDevice* ShellySensorRegistry::find(const String& address) {
+    uint64_t mac;
+    return parseMac(address, mac) ? find(mac) : nullptr;
+}
+
+const PairedShellyDevice* ShellySensorRegistry::find(const String& address) const {
+    uint64_t mac;
+    return parseMac(address, mac) ? find(mac) : nullptr;
+}
+
+const PairedShellyDevice* ShellySensorRegistry::findByRole(ShellySensorRole role) const {
+    for (size_t i = 0; i < count_; i++) {
+        if (slots_[i].device.role == role) {
+            return &slots_[i].device;
+        }
+    }
+    return nullptr;
+}
+
+PairedShellyDevice* ShellySensorRegistry::add(const String& address, const String& name,
+                                              const ShellyBindkey& bindkey, ShellySensorRole role,
+                                              uint8_t addressType) {
+    uint64_t mac;
+    if (!parseMac(address, mac)) {
+        ESP_LOGE(TAG, "Registry: invalid MAC '%s'", address.c_str());
+        return nullptr;
+    }
+    
+    int slot = slotOf(mac);
+    if (slot < 0) {
+        if (isFull()) {
+            ESP_LOGE(TAG, "Registry full (%d/%d)", (int)count_, BLE_MAX_PAIRED_DEVICES);
+            return nullptr;
+        }
+        slot = (int)count_++;
+        resetCrypto(slots_[slot]);
+        slots_[slot].device = PairedShellyDevice();
+        slots_[slot].device.mac = mac;
+        rebuildIndex();
+    }
+    
+    PairedShellyDevice& dev = slots_[slot].device;
+    dev.address = address;
+    dev.address.toUpperCase();  // NimBLE liefert Kleinbuchstaben
+    dev.name = name;
+    dev.role = role;
+    dev.addressType = addressType;
+    if (dev.bindkey != bindkey) {
+        setBindkey(dev, bindkey);
+    }
+    
+    return &dev;
+}
+
+bool ShellySensorRegistry::remove(uint64_t mac) {
+    int slot = slotOf(mac);
+    if (slot < 0) {
+        return false;
+    }
+    
+    // Nachfolgende Slots rücken auf; deren CCM-Kontexte werden lazily neu aufgesetzt
+    for (size_t i = slot; i < count_; i++) {
+        resetCrypto(slots_[i]);
+    }
+    for (size_t i = slot; i + 1 < count_; i++) {
+        slots_[i].device = slots_[i + 1].device;
+    }
+    count_--;
+    slots_[count_].device = PairedShellyDevice();
+    rebuildIndex();
+    
+    return true;
+}
+
+void ShellySensorRegistry::clear() {
+    for (size_t i = 0; i < count_; i++) {
+        resetCrypto(slots_[i]);
+        slots_[i].device = PairedShellyDevice();
+    }
+    count_ = 0;
+    rebuildIndex();
+}
+
+void ShellySensorRegistry::setBindkey(PairedShellyDevice& device, const ShellyBindkey& bindkey) {
+    int slot = slotOf(device.mac);
+    if (slot < 0) {
+        return;
+    }
+    
+    device.bindkey = bindkey;
+    device.packetFilter = BTHomePacketFilter();  // Neuer Key → Counter beginnt neu
+    resetCrypto(slots_[slot]);
+}
+
+mbedtls_ccm_context* ShellySensorRegistry::cryptoContext(const PairedShellyDevice& device) {
+    int slot = slotOf(device.mac);
+    if (slot < 0) {
+        return nullptr;
+    }
+    
+    Slot& s = slots_[slot];
+    if (s.ccmReady) {
+        return &s.ccm;
+    }
+    
+    if (!s.device.bindkey.isSet()) {
+        return nullptr;
+    }
+    
+    int ret = mbedtls_ccm_setkey(&s.ccm, MBEDTLS_CIPHER_ID_AES, s.device.bindkey.data(), 128);
+    
+    if (ret != 0) {
+        ESP_LOGE(TAG, "CCM setkey failed: -0x%04X", -ret);
+        mbedtls_ccm_free(&s.ccm);
+        mbedtls_ccm_init(&s.ccm);
+        return nullptr;
+    }
+    
+    s.ccmReady = true;
+    return &s.ccm;
+}
+
+bool ShellySensorRegistry::load() {
+    Preferences prefs;
+    if (!prefs.begin("ShellyBLE", true)) {
+        ESP_LOGW(TAG, "ShellyBLE namespace not found");
+        return false;
+    }
+    
+    size_t len = prefs.getBytesLength(BLE_REGISTRY_NVS_KEY);
+    if (len == 0) {
+        prefs.end();
+        return migrateLegacy();
+    }
+    
+    StoredRegistry blob;
+    memset(&blob, 0, sizeof(blob));
+    
+    if (len < STORED_REGISTRY_HEADER || len > sizeof(blob)) {
+        ESP_LOGE(TAG, "Registry blob has invalid size: %u", (unsigned)len);
+        prefs.end();
+        return false;
+    }
+    
+    prefs.getBytes(BLE_REGISTRY_NVS_KEY, &blob, len);
+    prefs.end();
+    
+    if (blob.version != BLE_REGISTRY_VERSION ||
+        blob.count > BLE_MAX_PAIRED_DEVICES ||
+        len < STORED_REGISTRY_HEADER + blob.count * sizeof(StoredSensor)) {
+        ESP_LOGE(TAG, "Registry blob rejected (version %d, count %d)", blob.version, blob.count);
+        return false;
+    }
+    
+    clear();
+    
+    for (uint8_t i = 0; i < blob.count; i++) {
+        const StoredSensor& s = blob.sensors[i];
+        
+        char address[18];
+        snprintf(address, sizeof(address), "%02X:%02X:%02X:%02X:%02X:%02X",
+                 s.mac[0], s.mac[1], s.mac[2], s.mac[3], s.mac[4], s.mac[5]);
+        
+        String name(s.name, strnlen(s.name, sizeof(s.name)));
+        ShellyBindkey bindkey;
+        if (s.hasBindkey) {
+            bindkey.set(s.bindkey);
+        }
+        
+        add(address, name, bindkey, (ShellySensorRole)s.role, s.addressType);
+    }
+    
+    mbedtls_platform_zeroize(&blob, sizeof(blob));
+    return true;
+}
+
+bool ShellySensorRegistry::save() const {
+    Preferences prefs;
+    if (!prefs.begin("ShellyBLE", false)) {
+        return false;
+    }
+    
+    if (count_ == 0) {
+        prefs.remove(BLE_REGISTRY_NVS_KEY);
+        prefs.end();
+        return true;
+    }
+    
+    StoredRegistry blob;
+    memset(&blob, 0, sizeof(blob));
+    blob.version = BLE_REGISTRY_VERSION;
+    blob.count = (uint8_t)count_;
+    
+    for (size_t i = 0; i < count_; i++) {
+        const PairedShellyDevice& dev = slots_[i].device;
+        StoredSensor& s = blob.sensors[i];
+        
+        for (int b = 0; b < 6; b++) {
+            s.mac[b] = (uint8_t)(dev.mac >> (40 - b * 8));
+        }
+        s.addressType = dev.addressType;
+        s.role = (uint8_t)dev.role;
+        s.hasBindkey = dev.bindkey.isSet() ? 1 : 0;
+        if (s.hasBindkey) {
+            memcpy(s.bindkey, dev.bindkey.data(), sizeof(s.bindkey));
+        }
+        strncpy(s.name, dev.name.c_str(), sizeof(s.name));  // nicht zwingend nullterminiert
+    }
+    
+    size_t len = STORED_REGISTRY_HEADER + count_ * sizeof(StoredSensor);
+    bool ok = prefs.putBytes(BLE_REGISTRY_NVS_KEY, &blob, len) == len;
+    prefs.end();
+    
+    mbedtls_platform_zeroize(&blob, sizeof(blob));
+    
+    if (!ok) {
+        ESP_LOGE(TAG, "✗ Failed to write registry blob (%u bytes)", (unsigned)len);
+    }
+    return ok;
+}
+
+bool ShellySensorRegistry::migrateLegacy() {
+    Preferences prefs;
+    if (!prefs.begin("ShellyBLE", false)) {
+        return false;
+    }
+    
+    String address = prefs.getString("address", "");
+    if (address.length() == 0) {
+        prefs.end();
+        return true;  // Nichts gespeichert
+    }
+    
+    String name = prefs.getString("name", "Unknown");
+    ShellyBindkey bindkey;
+    if (!bindkey.fromHex(prefs.getString("bindkey", ""))) {
+        ESP_LOGW(TAG, "Legacy bindkey invalid - migrating without encryption");
+    }
+    prefs.end();
+    
+    // Legacy-Keys bleiben stehen, bis die Registry sicher im NVS liegt -
+    // ein Fehler hier darf das Pairing nicht verlieren (nächster Boot versucht es erneut)
+    clear();
+    if (!add(address, name, bindkey, ShellySensorRole::WINDOW_CONTACT)) {
+        return false;
+    }
+    
+    if (!save()) {
+        ESP_LOGE(TAG, "✗ Saving migrated registry failed - legacy pairing kept");
+        return false;
+    }
+    
+    if (prefs.begin("ShellyBLE", false)) {
+        prefs.remove("address");
+        prefs.remove("name");
+        prefs.remove("bindkey");
+        prefs.end();
+    }
+    
+    ESP_LOGI(TAG, "✓ Migrated legacy pairing %s into sensor registry", address.c_str());
+    return true;
+}
+
+bool ShellySensorRegistry::hasStoredDevices() {
+    Preferences prefs;
+    if (!prefs.begin("ShellyBLE", true)) {  // Read-only
+        return false;
+    }
+    
+    bool found = prefs.getBytesLength(BLE_REGISTRY_NVS_KEY) > STORED_REGISTRY_HEADER ||
+                 prefs.getString("address", "").length() > 0;
+    prefs.end();
+    
+    return found;
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// Discovery Table
+// ═══════════════════════════════════════════════════════════════════════
+
+void ShellyBLEDevice::formatAddress(char* out) const {
+    snprintf(out, 18, "%02X:%02X:%02X:%02X:%02X:%02X",
+             (uint8_t)(mac >> 40), (uint8_t)(mac >> 32), (uint8_t)(mac >> 24),
+             (uint8_t)(mac >> 16), (uint8_t)(mac >> 8), (uint8_t)mac);
+}
+
+String ShellyBLEDevice::address() const {
+    char buf[18];
+    formatAddress(buf);
+    return String(buf);
+}
+
+ShellyDiscoveryTable::ShellyDiscoveryTable() : count_(0) {
+    memset(slots_, 0, sizeof(slots_));
+    memset(index_, -1, sizeof(index_));
+}
+
+int ShellyDiscoveryTable::slotOf(uint64_t mac) const {
+    size_t pos = hashMac(mac);
+    for (size_t probe = 0; probe < BLE_DISCOVERY_INDEX_SIZE; probe++) {
+        int8_t slot = index_[pos];
+        if (slot < 0) {
+            return -1;
+        }
+        if (slots_[slot].mac == mac) {
+            return slot;
+        }
+        pos = (pos + 1) & (BLE_DISCOVERY_INDEX_SIZE - 1);
     }
-    
-    // Erfolg: Übernehme Ownership
-    bleScanner = std::move(scanner);
-    
-    ESP_LOGI(TAG, "✓ Scanner ready");
-    return true;
+    return -1;
 }
 
-void ShellyBLEManager::end() {
-    if (!initialized) return;
-    
-    stopScan();
+void ShellyDiscoveryTable::rebuildIndex() {
+    memset(index_, -1, sizeof(index_));
+    for (size_t i = 0; i < count_; i++) {
+        size_t pos = hashMac(slots_[i].mac);
+        while (index_[pos] >= 0) {
+            pos = (pos + 1) & (BLE_DISCOVERY_INDEX_SIZE - 1);
+        }
+        index_[pos] = (int8_t)i;
+    }
+}
+
+const ShellyBLEDevice* ShellyDiscoveryTable::find(uint64_t mac) const {
+    int slot = slotOf(mac);
+    return slot >= 0 ? &slots_[slot] : nullptr;
+}
+
+const ShellyBLEDevice* ShellyDiscoveryTable::find(const String& address) const {
+    uint64_t mac;
+    return ShellySensorRegistry::parseMac(address, mac) ? find(mac) : nullptr;
+}
+
+const ShellyBLEDevice* ShellyDiscoveryTable::update(uint64_t mac, const char* name, int8_t rssi,
+                                                    bool isEncrypted, uint8_t addressType,
+                                                    bool* added) {
+    if (added) *added = false;
     
-    bleScanner.reset();
+    int slot = slotOf(mac);
+    if (slot < 0) {
+        // Gepairte Sensoren im Passiv-Scan liefern keinen Namen → nicht als neu listen
+        if (!name || name[0] == '\0') {
+            return nullptr;
+        }
+        
+        if (count_ < BLE_MAX_DISCOVERED_DEVICES) {
+            slot = (int)count_++;
+        } else {
+            // Voll: am längsten nicht gesehenen Eintrag verdrängen
+            uint32_t now = millis();
+            slot = 0;
+            for (size_t i = 1; i < count_; i++) {
+                if (now - slots_[i].lastSeen > now - slots_[slot].lastSeen) {
+                    slot = (int)i;
+                }
+            }
+            ESP_LOGD(TAG, "Discovery table full - evicting %012llX",
+                     (unsigned long long)slots_[slot].mac);
+        }
+        
+        ShellyBLEDevice& dev = slots_[slot];
+        memset(&dev, 0, sizeof(dev));
+        dev.mac = mac;
+        dev.rssiAvg = rssi;
+        rebuildIndex();
+        if (added) *added = true;
+    }
     
-    if (activeClientCallbacks) {
-        delete activeClientCallbacks;
-        activeClientCallbacks = nullptr;
+    ShellyBLEDevice& dev = slots_[slot];
+    if (name && name[0] != '\0') {
+        strlcpy(dev.name, name, sizeof(dev.name));
     }
+    dev.rssi = rssi;
+    dev.rssiAvg += (rssi - dev.rssiAvg) / (1 << BLE_DISCOVERY_RSSI_SHIFT);
+    dev.isEncrypted = isEncrypted;
+    dev.addressType = addressType;
+    dev.lastSeen = millis();
     
-    initialized = false;
-    ESP_LOGI(TAG, "Shut down");
+    return &dev;
 }
 
-void ShellyBLEManager::loop() {
-    if (!initialized) return;
-    
-    if (bleScanner) {
-                bleScanner->loop();
+size_t ShellyDiscoveryTable::expire(uint32_t maxAgeMs) {
+    uint32_t now = millis();
+    size_t removed = 0;
+    
+    for (size_t i = 0; i < count_; ) {
+        if (now - slots_[i].lastSeen > maxAgeMs) {
+            ESP_LOGI(TAG, "Removing stale discovery: %s", slots_[i].address().c_str());
+            // Reihenfolge egal: letzten Eintrag in die Lücke ziehen
+            slots_[i] = slots_[--count_];
+            memset(&slots_[count_], 0, sizeof(slots_[count_]));
+            removed++;
+        } else {
+            i++;
+        }
     }
     
-    if (bleScanner) {
-        cleanupOldDiscoveries();
+    if (removed > 0) {
+        rebuildIndex();
     }
+    return removed;
+}
+
+void ShellyDiscoveryTable::clear() {
+    memset(slots_, 0, sizeof(slots_));
+    count_ = 0;
+    rebuildIndex();
 }
 
 // ═══════════════════════════════════════════════════════════════════════
@@ -150,63 +1306,328 @@ void ShellyBLEManager::loop() {
 // ═══════════════════════════════════════════════════════════════════════
 
 void ShellyBLEManager::loadPairedDevice() {
-    Preferences prefs;
-    if (!prefs.begin("ShellyBLE", true)) {
-        ESP_LOGW(TAG, "ShellyBLE namespace not found");
+    if (!registry.load() || registry.count() == 0) {
         return;
     }
     
-    String address = prefs.getString("address", "");
-    if (address.length() > 0) {
-        pairedDevice.address = address;
-        pairedDevice.name = prefs.getString("name", "Unknown");
-        pairedDevice.bindkey = prefs.getString("bindkey", "");
-        
-        ESP_LOGI(TAG, "═══════════════════════════════════");
-        ESP_LOGI(TAG, "LOADED PAIRED DEVICE FROM NVS");
-        ESP_LOGI(TAG, "═══════════════════════════════════");
-        ESP_LOGI(TAG, "Address: %s", pairedDevice.address.c_str());
-        ESP_LOGI(TAG, "Name: %s", pairedDevice.name.c_str());
-        ESP_LOGI(TAG, "Bindkey: %s", pairedDevice.bindkey.length() > 0 ? "SET (32 chars)" : "EMPTY");
-        
+    ESP_LOGI(TAG, "═══════════════════════════════════");
+    ESP_LOGI(TAG, "LOADED %d PAIRED DEVICE(S) FROM NVS", (int)registry.count());
+    ESP_LOGI(TAG, "═══════════════════════════════════");
+    
+    for (size_t i = 0; i < registry.count(); i++) {
+        const PairedShellyDevice& dev = registry[i];
+        ESP_LOGI(TAG, "[%d] %s (%s)", (int)i + 1, dev.name.c_str(), dev.address.c_str());
+        ESP_LOGI(TAG, "    Role: %s", sensorRoleToString(dev.role));
+        ESP_LOGI(TAG, "    Bindkey: %s", dev.bindkey.isSet() ? "SET (16 bytes)" : "EMPTY");
+    }
+    
+    Preferences prefs;
+    if (prefs.begin("ShellyBLE", true)) {
         bool shouldScan = prefs.getBool("continuous_scan", true);
         continuousScan = shouldScan;  // Apply NVS flag to member variable
         ESP_LOGI(TAG, "Continuous Scan: %s", shouldScan ? "ENABLED" : "DISABLED");
-        ESP_LOGI(TAG, "═══════════════════════════════════");
+        prefs.end();
     }
-    
-    prefs.end();
+    ESP_LOGI(TAG, "═══════════════════════════════════");
 }
 
 void ShellyBLEManager::savePairedDevice() {
-    Preferences prefs;
-    prefs.begin("ShellyBLE", false);
-    
-    if (pairedDevice.address.length() > 0) {
-        prefs.putString("address", pairedDevice.address);
-        prefs.putString("name", pairedDevice.name);
-        prefs.putString("bindkey", pairedDevice.bindkey);
+    if (registry.count() > 0) {
+        registry.save();
         
+        Preferences prefs;
+        prefs.begin("ShellyBLE", false);
         prefs.putBool("continuous_scan", true);
+        prefs.end();
         
-        ESP_LOGI(TAG, "Saved paired device: %s", pairedDevice.address.c_str());
-        ESP_LOGI(TAG, "  Name: %s", pairedDevice.name.c_str());
-        ESP_LOGI(TAG, "  Bindkey: %s", pairedDevice.bindkey.length() > 0 ? "SET" : "EMPTY");
+        ESP_LOGI(TAG, "Saved %d paired device(s)", (int)registry.count());
         ESP_LOGI(TAG, "  Continuous Scan: ENABLED");
     } else {
+        Preferences prefs;
+        prefs.begin("ShellyBLE", false);
         prefs.clear();
-        ESP_LOGI(TAG, "Cleared paired device");
+        prefs.end();
+        ESP_LOGI(TAG, "Cleared paired devices");
     }
-    
-    prefs.end();
 }
 
 
 void ShellyBLEManager::clearPairedDevice() {
-    pairedDevice = PairedShellyDevice();
+    registry.clear();
+    persistSensorState(false);  // leere RTC-Kopie, NVS-Key löscht prefs.clear()
+    stateNvsDirty = false;
     savePairedDevice();
 }
 
+const PairedShellyDevice& ShellyBLEManager::getPairedDevice() const {
+    static const PairedShellyDevice noDevice;
+    
+    const PairedShellyDevice* contact = registry.findByRole(ShellySensorRole::WINDOW_CONTACT);
+    if (contact) {
+        return *contact;
+    }
+    
+    return registry.count() > 0 ? registry[0] : noDevice;
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// Sensor State Persistence (letzter Zustand über Reboots)
+// ═══════════════════════════════════════════════════════════════════════
+//
+// Ohne Restore startet RollerShutter nach jedem Reboot mit CLOSED und
+// Matter meldet den Default, bis das nächste Advertisement kommt (bei
+// BLU Door/Window bis zu ~1 min Heartbeat). Deshalb:
+//
+//   RTC (RTC_NOINIT) - bei jedem neuen Paket, kein Flash-Verschleiß.
+//                      Überlebt Soft-Reset, Panic, WDT, OTA-Neustart.
+//   NVS              - gedrosselt aus loop(): Fensterwechsel nach
+//                      BLE_STATE_NVS_MIN_INTERVAL_MS, Rest stündlich.
+//
+// Das Alter ist nur über die RTC-Kopie bestimmbar: die Systemzeit läuft
+// über Soft-Resets weiter, nach einem Power-On beginnt sie wieder bei 0.
+
+#define BLE_STATE_MAGIC         0x42575353   // "BWSS"
+#define BLE_STATE_FLAG_WINDOW   0x01
+#define BLE_STATE_FLAG_MOTION   0x02
+#define BLE_STATE_FLAG_ENCRYPT  0x04
+
+struct __attribute__((packed)) StoredSensorState {
+    uint8_t mac[6];          // MSB zuerst (wie StoredSensor)
+    uint8_t packetId;
+    uint8_t battery;
+    uint8_t humidity;
+    uint8_t flags;           // BLE_STATE_FLAG_*
+    int16_t rotation;
+    int16_t temperature;
+    uint16_t fields;
+    uint16_t deviceTypeId;
+    uint32_t illuminance;
+    int64_t readAtUs;        // Systemzeit des Pakets, 0 = unbekannt
+};
+
+struct __attribute__((packed)) StoredStateBlob {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t count;
+    StoredSensorState sensors[BLE_MAX_PAIRED_DEVICES];
+    uint32_t crc;            // über alles davor
+};
+
+RTC_NOINIT_ATTR static StoredStateBlob rtcSensorState;
+
+static int64_t systemTimeUs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+static uint32_t stateBlobCrc(const StoredStateBlob& blob) {
+    return esp_rom_crc32_le(0, (const uint8_t*)&blob, offsetof(StoredStateBlob, crc));
+}
+
+static bool stateBlobValid(const StoredStateBlob& blob) {
+    return blob.magic == BLE_STATE_MAGIC &&
+           blob.version == BLE_STATE_VERSION &&
+           blob.count <= BLE_MAX_PAIRED_DEVICES &&
+           blob.crc == stateBlobCrc(blob);
+}
+
+void ShellyBLEManager::persistSensorState(bool windowChanged) {
+    StoredStateBlob blob;
+    memset(&blob, 0, sizeof(blob));
+    blob.magic = BLE_STATE_MAGIC;
+    blob.version = BLE_STATE_VERSION;
+    
+    int64_t nowUs = systemTimeUs();
+    
+    taskENTER_CRITICAL(&sensorDataLock);
+    uint32_t nowMs = millis();
+    for (size_t i = 0; i < registry.count(); i++) {
+        const PairedShellyDevice& dev = registry[i];
+        const ShellyBLESensorData& d = dev.sensorData;
+        if (d.confidence == SensorStateConfidence::NONE) {
+            continue;
+        }
+        
+        StoredSensorState& s = blob.sensors[blob.count++];
+        for (int b = 0; b < 6; b++) {
+            s.mac[b] = (uint8_t)(dev.mac >> (40 - b * 8));
+        }
+        s.packetId = d.packetId;
+        s.battery = d.battery;
+        s.humidity = d.humidity;
+        s.flags = (d.windowOpen ? BLE_STATE_FLAG_WINDOW : 0) |
+                  (d.motion ? BLE_STATE_FLAG_MOTION : 0) |
+                  (d.wasEncrypted ? BLE_STATE_FLAG_ENCRYPT : 0);
+        s.rotation = d.rotation;
+        s.temperature = d.temperature;
+        s.fields = d.fields;
+        s.deviceTypeId = d.deviceTypeId;
+        s.illuminance = d.illuminance;
+        // UNCERTAIN bleibt unbekannt, bis ein echtes Paket kommt
+        s.readAtUs = (d.confidence == SensorStateConfidence::UNCERTAIN || d.lastUpdate == 0)
+                   ? 0 : nowUs - (int64_t)(uint32_t)(nowMs - d.lastUpdate) * 1000;
+    }
+    taskEXIT_CRITICAL(&sensorDataLock);
+    
+    blob.crc = stateBlobCrc(blob);
+    
+    taskENTER_CRITICAL(&sensorDataLock);
+    memcpy(&rtcSensorState, &blob, sizeof(blob));
+    taskEXIT_CRITICAL(&sensorDataLock);
+    
+    if (windowChanged) {
+        stateWindowChanged = true;
+    }
+    stateNvsDirty = true;
+}
+
+void ShellyBLEManager::flushSensorState(bool force) {
+    if (!stateNvsDirty) {
+        return;
+    }
+    
+    uint32_t elapsed = millis() - lastStateNvsWrite;
+    uint32_t interval = stateWindowChanged ? BLE_STATE_NVS_MIN_INTERVAL_MS : BLE_STATE_NVS_REFRESH_MS;
+    if (!force && lastStateNvsWrite != 0 && elapsed < interval) {
+        return;
+    }
+    
+    // Flags vor der Kopie löschen - ein parallel eintreffendes Paket
+    // markiert erneut und wird beim nächsten Durchlauf geschrieben
+    stateNvsDirty = false;
+    stateWindowChanged = false;
+    
+    StoredStateBlob blob;
+    taskENTER_CRITICAL(&sensorDataLock);
+    memcpy(&blob, &rtcSensorState, sizeof(blob));
+    taskEXIT_CRITICAL(&sensorDataLock);
+    
+    if (!stateBlobValid(blob)) {
+        return;
+    }
+    
+    Preferences prefs;
+    if (!prefs.begin("ShellyBLE", false)) {
+        return;
+    }
+    bool ok = prefs.putBytes(BLE_STATE_NVS_KEY, &blob, sizeof(blob)) == sizeof(blob);
+    prefs.end();
+    
+    lastStateNvsWrite = millis();
+    if (lastStateNvsWrite == 0) lastStateNvsWrite = 1;
+    
+    if (ok) {
+        ESP_LOGD(TAG, "Sensor state saved to NVS (%d sensor(s))", blob.count);
+    } else {
+        ESP_LOGW(TAG, "✗ Failed to save sensor state to NVS");
+    }
+}
+
+void ShellyBLEManager::restoreSensorState() {
+    if (registry.count() == 0) {
+        return;
+    }
+    
+    // RTC-Inhalt ist nach Power-On/Brownout zufällig (CRC fängt das),
+    // und die Systemzeit beginnt neu - dann zählt nur noch NVS
+    esp_reset_reason_t reason = esp_reset_reason();
+    bool clockContinuous = reason != ESP_RST_POWERON &&
+                           reason != ESP_RST_BROWNOUT &&
+                           reason != ESP_RST_UNKNOWN;
+    
+    StoredStateBlob blob;
+    const char* source = "RTC";
+    
+    memcpy(&blob, &rtcSensorState, sizeof(blob));
+    if (!clockContinuous || !stateBlobValid(blob)) {
+        source = "NVS";
+        clockContinuous = false;
+        memset(&blob, 0, sizeof(blob));
+        
+        Preferences prefs;
+        if (!prefs.begin("ShellyBLE", true)) {
+            return;
+        }
+        size_t len = prefs.getBytesLength(BLE_STATE_NVS_KEY);
+        if (len == sizeof(blob)) {
+            prefs.getBytes(BLE_STATE_NVS_KEY, &blob, len);
+        }
+        prefs.end();
+        
+        if (!stateBlobValid(blob)) {
+            ESP_LOGI(TAG, "No stored sensor state (waiting for first advertisement)");
+            return;
+        }
+    }
+    
+    int64_t nowUs = systemTimeUs();
+    uint32_t nowMs = millis();
+    
+    ESP_LOGI(TAG, "═══════════════════════════════════");
+    ESP_LOGI(TAG, "RESTORED SENSOR STATE FROM %s", source);
+    ESP_LOGI(TAG, "═══════════════════════════════════");
+    
+    for (uint8_t i = 0; i < blob.count; i++) {
+        const StoredSensorState& s = blob.sensors[i];
+        
+        uint64_t mac = 0;
+        for (int b = 0; b < 6; b++) {
+            mac = (mac << 8) | s.mac[b];
+        }
+        
+        PairedShellyDevice* dev = registry.find(mac);
+        if (!dev) {
+            continue;  // inzwischen entpairt
+        }
+        
+        bool ageKnown = clockContinuous && s.readAtUs > 0 && nowUs >= s.readAtUs;
+        int64_t ageMs64 = ageKnown ? (nowUs - s.readAtUs) / 1000 : 0;
+        uint32_t ageMs = ageMs64 > UINT32_MAX ? UINT32_MAX : (uint32_t)ageMs64;
+        
+        ShellyBLESensorData data;
+        data.packetId = s.packetId;
+        data.battery = s.battery;
+        data.humidity = s.humidity;
+        data.windowOpen = (s.flags & BLE_STATE_FLAG_WINDOW) != 0;
+        data.motion = (s.flags & BLE_STATE_FLAG_MOTION) != 0;
+        data.wasEncrypted = (s.flags & BLE_STATE_FLAG_ENCRYPT) != 0;
+        data.rotation = s.rotation;
+        data.temperature = s.temperature;
+        data.fields = s.fields;
+        data.deviceTypeId = s.deviceTypeId;
+        data.illuminance = s.illuminance;
+        data.confidence = (ageKnown && ageMs < BLE_STATE_TRUST_MS)
+                        ? SensorStateConfidence::RESTORED
+                        : SensorStateConfidence::UNCERTAIN;
+        // Nur RESTORED gilt als aktueller Messwert (getSensorData, Matter)
+        data.dataValid = data.confidence == SensorStateConfidence::RESTORED;
+        if (ageKnown) {
+            data.lastUpdate = nowMs - ageMs;
+            if (data.lastUpdate == 0) data.lastUpdate = 1;
+        }
+        
+        taskENTER_CRITICAL(&sensorDataLock);
+        dev->sensorData = data;
+        taskEXIT_CRITICAL(&sensorDataLock);
+        
+        ESP_LOGI(TAG, "[%s] %s: %s, packet %d, %s",
+                 sensorRoleToString(dev->role), dev->address.c_str(),
+                 data.windowOpen ? "OPEN" : "CLOSED", data.packetId,
+                 sensorStateConfidenceToString(data.confidence));
+        if (ageKnown) {
+            ESP_LOGI(TAG, "    Age: %u s", ageMs / 1000);
+        } else {
+            ESP_LOGI(TAG, "    Age: unknown (power loss)");
+        }
+    }
+    ESP_LOGI(TAG, "═══════════════════════════════════");
+    
+    // RTC-Kopie auffrischen (Alter bleibt für NVS-Restore unbekannt)
+    persistSensorState(false);
+    stateNvsDirty = false;
+}
+
 // ═══════════════════════════════════════════════════════════════════════
 // Discovery / Scanning
 // ═══════════════════════════════════════════════════════════════════════
@@ -272,20 +1693,7 @@ void ShellyBLEManager::startScan(uint16_t durationSeconds, bool stopOnFirst) {
         ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
         ESP_LOGI(TAG, "");
         
-        if (bleScanner->is_whitelist_active()) {
-            ESP_LOGW(TAG, "⚠ Whitelist is ACTIVE - must clear for discovery!");
-            ESP_LOGI(TAG, "→ Clearing whitelist...");
-            
-            if (bleScanner->clear_scan_whitelist()) {
-                ESP_LOGI(TAG, "✓ Whitelist cleared successfully");
-                ESP_LOGI(TAG, "  → Discovery scan will see ALL devices");
-            } else {
-                ESP_LOGE(TAG, "✗ Failed to clear whitelist!");
-                ESP_LOGE(TAG, "  Discovery scan might be limited!");
-            }
-        } else {
-            ESP_LOGI(TAG, "✓ No whitelist active");
-        }
+        applyScanProfile(SCAN_PROFILE_DISCOVERY);
         
         ESP_LOGI(TAG, "");
         
@@ -296,7 +1704,8 @@ void ShellyBLEManager::startScan(uint16_t durationSeconds, bool stopOnFirst) {
         
     } else {
         // ═════════════════════════════════════════════════════════════════
-        // CONTINUOUS SCAN: Whitelist sollte bereits gesetzt sein
+        // CONTINUOUS SCAN: Paired-Profil (Whitelist + passiv) je Zyklus
+        // neu anwenden - eine Discovery dazwischen hat es zurückgesetzt
         // ═════════════════════════════════════════════════════════════════
         
         ESP_LOGI(TAG, "");
@@ -305,10 +1714,7 @@ void ShellyBLEManager::startScan(uint16_t durationSeconds, bool stopOnFirst) {
         ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
         ESP_LOGI(TAG, "");
         
-        if (bleScanner->is_whitelist_active()) {
-            ESP_LOGI(TAG, "✓ Whitelist active");
-            ESP_LOGI(TAG, "  → Only paired device will be scanned");
-        } else {
+        if (!applyScanProfile(SCAN_PROFILE_PAIRED)) {
             ESP_LOGW(TAG, "⚠ Whitelist NOT active!");
             ESP_LOGW(TAG, "  → This continuous scan will see ALL devices");
             ESP_LOGW(TAG, "  → Performance will be lower!");
@@ -333,9 +1739,10 @@ void ShellyBLEManager::startScan(uint16_t durationSeconds, bool stopOnFirst) {
     
     ESP_LOGI(TAG, "Target devices: Shelly BLU Door/Window (SBDW-*)");
     
-    if (isPaired()) {
-        ESP_LOGI(TAG, "Paired device: %s (%s)", 
-                 pairedDevice.name.c_str(), pairedDevice.address.c_str());
+    for (size_t i = 0; i < registry.count(); i++) {
+        ESP_LOGI(TAG, "Paired device: %s (%s, %s)", 
+                 registry[i].name.c_str(), registry[i].address.c_str(),
+                 sensorRoleToString(registry[i].role));
     }
     
     ESP_LOGI(TAG, "═══════════════════════════════════");
@@ -470,17 +1877,20 @@ void ShellyBLEManager::stopScan(bool manualStop) {  // ← Parameter hinzugefüg
     ESP_LOGI(TAG, "═══════════════════════════════════");
     ESP_LOGI(TAG, "BLE SCAN STOPPED");
     ESP_LOGI(TAG, "═══════════════════════════════════");
-    ESP_LOGI(TAG, "Total Shelly BLU devices found: %d", discoveredDevices.size());
+    ESP_LOGI(TAG, "Total Shelly BLU devices found: %d", (int)discoveredDevices.count());
     
-    if (discoveredDevices.size() > 0) {
+    if (discoveredDevices.count() > 0) {
         ESP_LOGI(TAG, "");
         ESP_LOGI(TAG, "Discovered devices:");
-        for (size_t i = 0; i < discoveredDevices.size(); i++) {
+        for (size_t i = 0; i < discoveredDevices.count(); i++) {
             const auto& dev = discoveredDevices[i];
-            ESP_LOGI(TAG, "  [%d] %s", i+1, dev.name.c_str());
-            ESP_LOGI(TAG, "      MAC: %s | RSSI: %d dBm | Encrypted: %s",
-                     dev.address.c_str(), 
+            char mac[18];
+            dev.formatAddress(mac);
+            ESP_LOGI(TAG, "  [%d] %s", i+1, dev.name);
+            ESP_LOGI(TAG, "      MAC: %s | RSSI: %d dBm (avg %d) | Encrypted: %s",
+                     mac, 
                      dev.rssi, 
+                     dev.rssiAvg,
                      dev.isEncrypted ? "Yes" : "No");
         }
     } else {
@@ -536,7 +1946,7 @@ void ShellyBLEManager::stopScan(bool manualStop) {  // ← Parameter hinzugefüg
             bool shouldContinue = prefs.getBool("continuous_scan", true);
             prefs.end();
             
-            if (shouldContinue && p->manager->isPaired()) {
+            if (shouldContinue && p->manager->isPaired() && p->manager->initialized) {
                 ESP_LOGI(TAG, "");
                 ESP_LOGI(TAG, "🔄 Auto-restarting Continuous Scan...");
                 ESP_LOGI(TAG, "   (Cycle continues - monitoring for events)");
@@ -628,13 +2038,17 @@ void ShellyBLEManager::startContinuousScan() {
     ESP_LOGI(TAG, "║  CONTINUOUS BLE SCAN              ║");
     ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
     ESP_LOGI(TAG, "");
-    ESP_LOGI(TAG, "Paired device: %s (%s)", 
-             pairedDevice.name.c_str(), pairedDevice.address.c_str());
-    ESP_LOGI(TAG, "Stored Address Type: %s (%d)",
-             pairedDevice.addressType == BLE_ADDR_PUBLIC ? "PUBLIC" : "RANDOM",
-             pairedDevice.addressType);
-    ESP_LOGI(TAG, "Encryption: %s", 
-             pairedDevice.bindkey.length() > 0 ? "ENABLED" : "DISABLED");
+    for (size_t i = 0; i < registry.count(); i++) {
+        const PairedShellyDevice& dev = registry[i];
+        ESP_LOGI(TAG, "Paired device [%d]: %s (%s)", (int)i + 1,
+                 dev.name.c_str(), dev.address.c_str());
+        ESP_LOGI(TAG, "  Role: %s", sensorRoleToString(dev.role));
+        ESP_LOGI(TAG, "  Stored Address Type: %s (%d)",
+                 dev.addressType == BLE_ADDR_PUBLIC ? "PUBLIC" : "RANDOM",
+                 dev.addressType);
+        ESP_LOGI(TAG, "  Encryption: %s", 
+                 dev.bindkey.isSet() ? "ENABLED" : "DISABLED");
+    }
     ESP_LOGI(TAG, "");
     
     // ════════════════════════════════════════════════════════════════════
@@ -642,66 +2056,16 @@ void ShellyBLEManager::startContinuousScan() {
     // the sensorDataCallback, regardless of any packetId cached by a prior
     // readSampleBTHomeData() GATT call during the pairing workflow.
     // ════════════════════════════════════════════════════════════════════
-    pairedDevice.sensorData.dataValid = false;
-
-    // ════════════════════════════════════════════════════════════════════
-    // WHITELIST: BEIDE ADDRESS TYPES HINZUFÜGEN!
-    // ════════════════════════════════════════════════════════════════════
-    
-    ESP_LOGI(TAG, "→ Configuring scan whitelist...");
-    ESP_LOGI(TAG, "  Strategy: Add BOTH address types for maximum compatibility");
-    ESP_LOGI(TAG, "");
-    
-    std::vector<esp32_ble_simple::SimpleBLEScanner::WhitelistEntry> whitelist;
-    
-    // Entry 1: Mit gespeichertem Address Type
-    esp32_ble_simple::SimpleBLEScanner::WhitelistEntry entry1(
-        pairedDevice.address.c_str(),
-        pairedDevice.addressType
-    );
-    whitelist.push_back(entry1);
-    
-    // Entry 2: Mit alternativem Address Type
-    uint8_t altType = (pairedDevice.addressType == BLE_ADDR_PUBLIC) 
-                      ? BLE_ADDR_RANDOM 
-                      : BLE_ADDR_PUBLIC;
-    
-    esp32_ble_simple::SimpleBLEScanner::WhitelistEntry entry2(
-        pairedDevice.address.c_str(),
-        altType
-    );
-    whitelist.push_back(entry2);
-    
-    ESP_LOGI(TAG, "  Whitelist entries:");
-    ESP_LOGI(TAG, "    [1] %s (type: %s)", 
-             pairedDevice.address.c_str(),
-             pairedDevice.addressType == BLE_ADDR_PUBLIC ? "PUBLIC" : "RANDOM");
-    ESP_LOGI(TAG, "    [2] %s (type: %s)", 
-             pairedDevice.address.c_str(),
-             altType == BLE_ADDR_PUBLIC ? "PUBLIC" : "RANDOM");
-    ESP_LOGI(TAG, "");
-    
-    if (!bleScanner->set_scan_whitelist(whitelist)) {
-        ESP_LOGE(TAG, "✗ Failed to configure whitelist!");
-        ESP_LOGE(TAG, "  Continuous scan will see ALL devices");
-        ESP_LOGE(TAG, "");
-    } else {
-        ESP_LOGI(TAG, "✓ Whitelist configured successfully");
-        ESP_LOGI(TAG, "  → MAC %s with BOTH address types", pairedDevice.address.c_str());
-        ESP_LOGI(TAG, "  → This ensures the device is found regardless of type");
-        ESP_LOGI(TAG, "  → All other devices ignored by BLE hardware");
-        ESP_LOGI(TAG, "");
+    taskENTER_CRITICAL(&sensorDataLock);
+    for (size_t i = 0; i < registry.count(); i++) {
+        registry[i].sensorData.dataValid = false;
     }
+    taskEXIT_CRITICAL(&sensorDataLock);
 
     // ════════════════════════════════════════════════════════════════════
-    // 100% DUTY CYCLE for continuous scan (interval = window = 160ms)
-    // Default 300ms/100ms = 33% duty cycle misses ~2/3 of advertisement
-    // windows. With 160ms/160ms, every advertisement is received.
+    // Whitelist + passiver Scan werden in startScan() pro Zyklus über
+    // applyScanProfile(SCAN_PROFILE_PAIRED) gesetzt
     // ════════════════════════════════════════════════════════════════════
-    bleScanner->set_scan_interval_ms(160);
-    bleScanner->set_scan_window_ms(160);
-    ESP_LOGI(TAG, "✓ Scan duty cycle: 100%% (160ms/160ms)");
-    ESP_LOGI(TAG, "");
 
     continuousScan = true;
     
@@ -727,58 +2091,68 @@ String ShellyBLEManager::getScanStatus() const {
 
 bool ShellyBLEManager::on_device_found(const esp32_ble_simple::SimpleBLEDevice &device) {
     std::string name = device.get_name();
-    std::string address = device.get_address_str();
     
     // ════════════════════════════════════════════════════════════════════
     // WICHTIG: return true = "Continue scanning"
     //             return false = "Stop scanning"
     // ════════════════════════════════════════════════════════════════════
     
-    // Filter: Nur Shelly BLU Door/Window
-    if (name.empty() || name.length() < 9) {
-        return true;  // GEÄNDERT: Continue scanning (nicht interessiert)
+    scanEventCount = scanEventCount + 1;
+    
+    if (wakeTargetMac && device.get_address_uint64() == wakeTargetMac) {
+        xSemaphoreGive(wakeSignal);
     }
     
-    // UNTERSTÜTZT BEIDE FORMATE:
-    // - SBDW-XXXX (alte Firmware)
-    // - SBW-002C-XXXX (neue Firmware)
-    bool isShellyBLU = false;
+    // O(1) Registry-Lookup: gepairte Sensoren werden auch ohne Namen
+    // verarbeitet (ADV ohne SCAN_RSP liefert keinen Namen)
+    PairedShellyDevice* paired = registry.find(device.get_address_uint64());
     
-    if (name.length() >= 5 && name.substr(0, 5) == "SBDW-") {
-        isShellyBLU = true;
-        ESP_LOGI(TAG, "→ Device Type: SBDW (Door/Window Sensor, old format)");
-    } else if (name.length() >= 9 && name.substr(0, 9) == "SBW-002C-") {
-        isShellyBLU = true;
-        ESP_LOGI(TAG, "→ Device Type: SBW-002C (Door/Window Sensor, new format)");
+    if (!paired) {
+        // Filter: Geräteklassen-Tabelle (Namenspräfix, sonst BTHome Device Type)
+        const uint8_t* serviceData = nullptr;
+        size_t serviceLen = 0;
         
-        String deviceId = name.substr(9, 4).c_str();
-        ESP_LOGI(TAG, "→ Device ID: %s", deviceId.c_str());
-    }
-    
-    if (!isShellyBLU) {
-        return true;  // GEÄNDERT: Continue scanning (kein Shelly)
+        if (!bthomeClassByName(name.c_str())) {
+            for (const auto& sd : device.get_service_datas()) {
+                if (sd.uuid.is_16bit() && sd.uuid.get_uuid16() == BTHOME_UUID_UINT16) {
+                    serviceData = sd.data.data();
+                    serviceLen = sd.data.size();
+                    break;
+                }
+            }
+        }
+        
+        const BTHomeDeviceClass* deviceClass =
+            bthomeMatchDeviceClass(name.c_str(), serviceData, serviceLen);
+        
+        if (!deviceClass) {
+            return true;  // Continue scanning (kein unterstützter Shelly BLU)
+        }
+        
+        ADV_LOGI("→ Device Class: %s (%s)", deviceClass->label,
+                 name.empty() ? "via BTHome device type" : name.c_str());
     }
     
     int8_t rssi = device.get_rssi();
 
     uint8_t addressType = device.get_address_type();
     
-    ESP_LOGI(TAG, "═══════════════════════════════════");
-    ESP_LOGI(TAG, "🔍 SHELLY BLU DETECTED");
-    ESP_LOGI(TAG, "═══════════════════════════════════");
-    ESP_LOGI(TAG, "Name: %s", name.c_str());
-    ESP_LOGI(TAG, "Address: %s", address.c_str());
-    ESP_LOGI(TAG, "Address Type: %s (%d)",
+    ADV_LOGI("═══════════════════════════════════");
+    ADV_LOGI("🔍 SHELLY BLU DETECTED");
+    ADV_LOGI("═══════════════════════════════════");
+    ADV_LOGI("Name: %s", name.c_str());
+    ADV_LOGI("Address: %s", device.get_address_str().c_str());
+    ADV_LOGI("Address Type: %s (%d)",
              addressType == BLE_ADDR_PUBLIC ? "PUBLIC" : "RANDOM",
              addressType);
-    ESP_LOGI(TAG, "RSSI: %d dBm", rssi);
-    ESP_LOGI(TAG, "");
+    ADV_LOGI("RSSI: %d dBm", rssi);
+    ADV_LOGI("");
     
     // Get service datas
     const auto& service_datas = device.get_service_datas();
     
-    ESP_LOGI(TAG, "→ Service Data check:");
-    ESP_LOGI(TAG, "  Total service datas: %d", service_datas.size());
+    ADV_LOGI("→ Service Data check:");
+    ADV_LOGI("  Total service datas: %d", service_datas.size());
     
     // Suche BTHome Service Data (UUID 0xFCD2)
     bool foundBTHome = false;
@@ -791,72 +2165,72 @@ bool ShellyBLEManager::on_device_found(const esp32_ble_simple::SimpleBLEDevice &
             bthomeData = sd.data.data();
             bthomeLen = sd.data.size();
             
-            ESP_LOGI(TAG, "");
-            ESP_LOGI(TAG, "✓ BTHome Service Data found!");
-            ESP_LOGI(TAG, "  UUID: 0xFCD2");
-            ESP_LOGI(TAG, "  Length: %d bytes", bthomeLen);
+            ADV_LOGI("");
+            ADV_LOGI("✓ BTHome Service Data found!");
+            ADV_LOGI("  UUID: 0xFCD2");
+            ADV_LOGI("  Length: %d bytes", bthomeLen);
             
-            // Hex dump
-            char hex[128];
-            int offset = 0;
-            offset += snprintf(hex, sizeof(hex), "  Data: ");
-            for (size_t i = 0; i < bthomeLen && i < 32; i++) {
-                offset += snprintf(hex + offset, sizeof(hex) - offset, 
-                                 "%02X ", bthomeData[i]);
+            // Hex dump (nur wenn INFO mitkompiliert ist)
+            if (ADV_LOG_ENABLED(ESP_LOG_INFO)) {
+                char hex[128];
+                int offset = 0;
+                offset += snprintf(hex, sizeof(hex), "  Data: ");
+                for (size_t i = 0; i < bthomeLen && i < 32; i++) {
+                    offset += snprintf(hex + offset, sizeof(hex) - offset, 
+                                     "%02X ", bthomeData[i]);
+                }
+                ADV_LOGI("%s", hex);
             }
-            ESP_LOGI(TAG, "%s", hex);
             
             break;
         }
     }
     
     if (!foundBTHome) {
-        ESP_LOGW(TAG, "");
-        ESP_LOGW(TAG, "⚠ No BTHome Service Data!");
-        ESP_LOGW(TAG, "  Device found but no event data");
-        ESP_LOGW(TAG, "  → Device might be sleeping");
-        ESP_LOGW(TAG, "  → Or no event occurred yet");
-        ESP_LOGW(TAG, "");
-        ESP_LOGI(TAG, "═══════════════════════════════════");
+        ADV_LOGW("");
+        ADV_LOGW("⚠ No BTHome Service Data!");
+        ADV_LOGW("  Device found but no event data");
+        ADV_LOGW("  → Device might be sleeping");
+        ADV_LOGW("  → Or no event occurred yet");
+        ADV_LOGW("");
+        ADV_LOGI("═══════════════════════════════════");
         
         // Update discovered devices (ohne Service Data)
         updateDiscoveredDevice(
-        String(address.c_str()), 
-        String(name.c_str()), 
-        rssi, 
-        false, 
-        device.get_address_uint64(),
-        addressType
-    );
+            device.get_address_uint64(),
+            name.c_str(), 
+            rssi, 
+            false, 
+            addressType
+        );
         
         // Continue scanning (falls stopOnFirstMatch nicht aktiv)
         // Stop nur wenn stopOnFirstMatch UND Shelly gefunden
         if (stopOnFirstMatch) {
-            ESP_LOGI(TAG, "✓ Shelly BLU found - stopping scan (stopOnFirstMatch)");
+            ADV_LOGI("✓ Shelly BLU found - stopping scan (stopOnFirstMatch)");
             return false;  // Stop scan
         }
         
         return true;  // Continue scanning
     }
     
-    ESP_LOGI(TAG, "");
+    ADV_LOGI("");
     
     // Device Info Byte
     uint8_t deviceInfo = bthomeData[0];
     bool isEncrypted = (deviceInfo & 0x01) != 0;
     
-    ESP_LOGI(TAG, "  Device Info: 0x%02X", deviceInfo);
-    ESP_LOGI(TAG, "  Encrypted: %s", isEncrypted ? "YES 🔒" : "NO");
-    ESP_LOGI(TAG, "  BTHome Version: %d", (deviceInfo >> 5) & 0x07);
-    ESP_LOGI(TAG, "");
+    ADV_LOGI("  Device Info: 0x%02X", deviceInfo);
+    ADV_LOGI("  Encrypted: %s", isEncrypted ? "YES 🔒" : "NO");
+    ADV_LOGI("  BTHome Version: %d", (deviceInfo >> 5) & 0x07);
+    ADV_LOGI("");
     
     // Update Discovered Devices
     updateDiscoveredDevice(
-        String(address.c_str()), 
-        String(name.c_str()), 
+        device.get_address_uint64(),
+        name.c_str(), 
         rssi, 
         isEncrypted, 
-        device.get_address_uint64(),
         addressType
     );
     
@@ -864,32 +2238,44 @@ bool ShellyBLEManager::on_device_found(const esp32_ble_simple::SimpleBLEDevice &
     // Check if paired device
     // ════════════════════════════════════════════════════════════════════
     
-    if (!isPaired()) {
-        ESP_LOGI(TAG, "ℹ Device not paired - skipping data parse");
-        ESP_LOGI(TAG, "═══════════════════════════════════");
+    if (!paired) {
+        ADV_LOGI("ℹ Device not paired - skipping data parse");
+        ADV_LOGI("  Paired sensors: %d/%d", (int)registry.count(), BLE_MAX_PAIRED_DEVICES);
+        ADV_LOGI("═══════════════════════════════════");
         
         // Stop scan if stopOnFirstMatch aktiv
         if (stopOnFirstMatch) {
-            ESP_LOGI(TAG, "✓ Shelly BLU found - stopping scan (stopOnFirstMatch)");
+            ADV_LOGI("✓ Shelly BLU found - stopping scan (stopOnFirstMatch)");
             return false;  // Stop scan
         }
         
         return true;  // Continue scanning
     }
     
-    String addrString(address.c_str());
-    if (pairedDevice.address != addrString) {
-        ESP_LOGI(TAG, "ℹ Not the paired device - skipping");
-        ESP_LOGI(TAG, "  Paired: %s", pairedDevice.address.c_str());
-        ESP_LOGI(TAG, "  This:   %s", address.c_str());
-        ESP_LOGI(TAG, "═══════════════════════════════════");
-        
-        // Stop scan if stopOnFirstMatch aktiv
-        if (stopOnFirstMatch) {
-            ESP_LOGI(TAG, "✓ Shelly BLU found - stopping scan (stopOnFirstMatch)");
-            return false;  // Stop scan
+    // ════════════════════════════════════════════════════════════════════
+    // Duplicate / Replay Filter (vor jeglicher Kryptografie)
+    // ════════════════════════════════════════════════════════════════════
+    
+    BTHomePacketFilter& filter = paired->packetFilter;
+    BTHomePacketVerdict verdict = bthomeCheckPacketFilter(bthomeData, bthomeLen, filter, millis());
+    
+    if (verdict == PACKET_DUPLICATE) {
+        // Same BTHome event repeated by the sensor — refresh RSSI/timestamp only
+        filter.duplicates++;
+        taskENTER_CRITICAL(&sensorDataLock);
+        recordAdvertisement(paired->advStats, true, 0, rssi);
+        if (paired->sensorData.dataValid) {
+            paired->sensorData.rssi = rssi;
+            paired->sensorData.lastUpdate = millis();
         }
-        
+        taskEXIT_CRITICAL(&sensorDataLock);
+        return true;  // Continue scanning
+    }
+    
+    if (verdict == PACKET_REPLAY) {
+        filter.replays++;
+        ADV_LOGW("⚠ Encryption counter outside replay window - packet dropped");
+        ADV_LOGW("  Highest accepted: %u", filter.highestCounter);
         return true;  // Continue scanning
     }
     
@@ -897,55 +2283,59 @@ bool ShellyBLEManager::on_device_found(const esp32_ble_simple::SimpleBLEDevice &
     // Paired Device - Parse Data
     // ════════════════════════════════════════════════════════════════════
     
-    ESP_LOGI(TAG, "┌─────────────────────────────────");
-    ESP_LOGI(TAG, "│ PAIRED DEVICE DATA UPDATE");
-    ESP_LOGI(TAG, "├─────────────────────────────────");
-    ESP_LOGI(TAG, "│");
+    ADV_LOGI("┌─────────────────────────────────");
+    ADV_LOGI("│ PAIRED DEVICE DATA UPDATE (%s)", sensorRoleToString(paired->role));
+    ADV_LOGI("├─────────────────────────────────");
+    ADV_LOGI("│");
     
     ShellyBLESensorData sensorData;
     sensorData.rssi = rssi;
-
-    String addressStr = String(device.get_address_str().c_str());
     
     bool parseSuccess = parseBTHomePacket(
         bthomeData, 
         bthomeLen,
-        pairedDevice.bindkey,  // Bindkey für Decryption
-        addressStr,
+        paired,  // Bindkey + gecachter CCM-Kontext
         sensorData
     );
     
     if (parseSuccess) {
-        // ════════════════════════════════════════════════════════════════
-        // PACKET ID DEDUPLICATION
-        // Same Packet ID = same BTHome event. Update RSSI/timestamp only,
-        // skip the callback to avoid flooding WebSocket every 500ms.
-        // ════════════════════════════════════════════════════════════════
-
-        bool isNewPacket = !pairedDevice.sensorData.dataValid ||
-                           (sensorData.packetId != pairedDevice.sensorData.packetId);
+        // Only authenticated/parsed packets advance the filter, so a forged
+        // counter can never push the replay window forward.
+        if (!bthomeCommitPacketFilter(bthomeData, bthomeLen, verdict, filter, millis())) {
+            ADV_LOGW("⚠ Counter behind replay window - waiting for resync confirmation");
+            return true;  // Continue scanning
+        }
 
         sensorData.lastUpdate = millis();  // Set BEFORE storing or calling callback
+        sensorData.dataValid = true;
+        sensorData.confidence = SensorStateConfidence::LIVE;
 
-        pairedDevice.sensorData       = sensorData;
-        pairedDevice.sensorData.dataValid = true;
-
-        if (!isNewPacket) {
-            // Duplicate — silently update RSSI/timestamp, no callback
-            return true;  // Continue scanning
+        taskENTER_CRITICAL(&sensorDataLock);
+        bool windowChanged = paired->sensorData.confidence != SensorStateConfidence::LIVE ||
+                             paired->sensorData.windowOpen != sensorData.windowOpen;
+        paired->sensorData = sensorData;
+        recordAdvertisement(paired->advStats, false, sensorData.packetId, rssi);
+        taskEXIT_CRITICAL(&sensorDataLock);
+        
+        // Button-Fast-Path: vor allem anderen, der Duplicate-Filter oben
+        // garantiert genau einen Aufruf pro Tastendruck
+        if (sensorData.hasButtonEvent && buttonEventCallback) {
+            buttonEventCallback(paired->address, paired->role, sensorData.buttonEvent);
         }
+        
+        persistSensorState(windowChanged);
 
         // New packet: log it and notify
-        ESP_LOGI(TAG, "");
-        ESP_LOGI(TAG, "DATA SUCCESSFULLY PARSED & DECRYPTED!");
-        ESP_LOGI(TAG, "│");
-        ESP_LOGI(TAG, "│ Sensor Data:");
-        ESP_LOGI(TAG, "│   Packet ID:    %d", sensorData.packetId);
-        ESP_LOGI(TAG, "│   Battery:      %d%%", sensorData.battery);
-        ESP_LOGI(TAG, "│   Window:       %s",
+        ADV_LOGI("");
+        ADV_LOGI("DATA SUCCESSFULLY PARSED & DECRYPTED!");
+        ADV_LOGI("│");
+        ADV_LOGI("│ Sensor Data:");
+        ADV_LOGI("│   Packet ID:    %d", sensorData.packetId);
+        ADV_LOGI("│   Battery:      %d%%", sensorData.battery);
+        ADV_LOGI("│   Window:       %s",
                  sensorData.windowOpen ? "OPEN 🔓" : "CLOSED 🔒");
-        ESP_LOGI(TAG, "│   Illuminance:  %d lux", sensorData.illuminance);
-        ESP_LOGI(TAG, "│   Rotation:     %d°", sensorData.rotation);
+        ADV_LOGI("│   Illuminance:  %d lux", sensorData.illuminance);
+        ADV_LOGI("│   Rotation:     %d°", sensorData.rotation);
 
         if (sensorData.hasButtonEvent) {
             const char* eventName;
@@ -957,42 +2347,44 @@ bool ShellyBLEManager::on_device_found(const esp32_ble_simple::SimpleBLEDevice &
                 case BUTTON_HOLD: eventName = "HOLD ⏸️"; break;
                 default: eventName = "UNKNOWN";
             }
-            ESP_LOGI(TAG, "│   Button:       %s", eventName);
+            ADV_LOGI("│   Button:       %s", eventName);
         }
 
-        ESP_LOGI(TAG, "│");
-        ESP_LOGI(TAG, "└─────────────────────────────────");
-        ESP_LOGI(TAG, "");
+        ADV_LOGI("│");
+        ADV_LOGI("└─────────────────────────────────");
+        ADV_LOGI("");
 
         // ════════════════════════════════════════════════════════════════
         // TRIGGER CALLBACK → WebUI + Matter Update
         // ════════════════════════════════════════════════════════════════
 
         if (sensorDataCallback) {
-            ESP_LOGI(TAG, "→ Triggering sensor data callback for WebUI...");
-            sensorDataCallback(String(address.c_str()), sensorData);
-            ESP_LOGI(TAG, "✓ WebUI notified of sensor data update");
+            ADV_LOGI("→ Triggering sensor data callback for WebUI...");
+            sensorDataCallback(paired->address, sensorData);
+            ADV_LOGI("✓ WebUI notified of sensor data update");
         } else {
-            ESP_LOGW(TAG, "⚠ No sensor data callback registered!");
-            ESP_LOGW(TAG, "  WebUI will NOT be updated!");
+            ADV_LOGW("⚠ No sensor data callback registered!");
+            ADV_LOGW("  WebUI will NOT be updated!");
         }
 
-        ESP_LOGI(TAG, "");
+        ADV_LOGI("");
         
     } else {
-        ESP_LOGE(TAG, "");
-        ESP_LOGE(TAG, "✗ FAILED TO PARSE DATA!");
-        ESP_LOGE(TAG, "│");
-        ESP_LOGE(TAG, "│ Possible reasons:");
-        ESP_LOGE(TAG, "│   • Decryption failed (wrong bindkey?)");
-        ESP_LOGE(TAG, "│   • Invalid BTHome packet structure");
-        ESP_LOGE(TAG, "│   • Corrupted data");
-        ESP_LOGE(TAG, "│");
-        ESP_LOGE(TAG, "└─────────────────────────────────");
-        ESP_LOGE(TAG, "");
+        ADV_LOGE("");
+        ADV_LOGE("✗ FAILED TO PARSE DATA!");
+        ADV_LOGE("│");
+        ADV_LOGE("│ Possible reasons:");
+        ADV_LOGE("│   • Decryption failed (wrong bindkey?)");
+        ADV_LOGE("│   • Invalid BTHome packet structure");
+        ADV_LOGE("│   • Corrupted data");
+        ADV_LOGE("│");
+        ADV_LOGE("└─────────────────────────────────");
+        ADV_LOGE("");
 
-        pairedDevice.sensorData.lastUpdate = 0;
-        pairedDevice.sensorData.dataValid = false;
+        taskENTER_CRITICAL(&sensorDataLock);
+        paired->sensorData.lastUpdate = 0;
+        paired->sensorData.dataValid = false;
+        taskEXIT_CRITICAL(&sensorDataLock);
     }
     
     // ════════════════════════════════════════════════════════════════════
@@ -1000,7 +2392,7 @@ bool ShellyBLEManager::on_device_found(const esp32_ble_simple::SimpleBLEDevice &
     // ════════════════════════════════════════════════════════════════════
     
     if (stopOnFirstMatch) {
-        ESP_LOGI(TAG, "✓ Paired device found - stopping scan (stopOnFirstMatch)");
+        ADV_LOGI("✓ Paired device found - stopping scan (stopOnFirstMatch)");
         return false;  // Stop scan
     }
     
@@ -1046,12 +2438,23 @@ bool ShellyBLEManager::smartConnectDevice(const String& address, uint32_t passke
     // Die Liste enthält bereits das Device vom Discovery Scan
     
     if (bleScanner) {
-        bleScanner->clear_scan_whitelist();
+        uint64_t targetMac = 0;
+        if (wakeSignal && ShellySensorRegistry::parseMac(address, targetMac)) {
+            xSemaphoreTake(wakeSignal, 0);  // altes Signal verwerfen
+            wakeTargetMac = targetMac;
+        }
+        
+        applyScanProfile(SCAN_PROFILE_DISCOVERY);
         bleScanner->set_scan_continuous(false);
-        bleScanner->start_scan(2);  // 2 Sekunden
+        bleScanner->start_scan(GATT_WAKEUP_SCAN_MS / 1000 + 1);
         
         scanning = true;
-        vTaskDelay(pdMS_TO_TICKS(2500));
+        uint32_t wakeStart = millis();
+        
+        // Endet beim ersten Advertisement des Ziels, spätestens nach der Deadline
+        bool targetSeen = wakeTargetMac &&
+            xSemaphoreTake(wakeSignal, pdMS_TO_TICKS(GATT_WAKEUP_SCAN_MS)) == pdTRUE;
+        wakeTargetMac = 0;
         
         if (bleScanner->is_scanning()) {
             bleScanner->stop_scan();
@@ -1059,30 +2462,24 @@ bool ShellyBLEManager::smartConnectDevice(const String& address, uint32_t passke
         
         scanning = false;
         
-        ESP_LOGI(TAG, "✓ Wake-up scan complete");
-        ESP_LOGI(TAG, "  Total devices in list: %d", discoveredDevices.size());
+        ESP_LOGI(TAG, "✓ Wake-up scan complete (%u ms)", millis() - wakeStart);
+        ESP_LOGI(TAG, "  Total devices in list: %d", (int)discoveredDevices.count());
         
         // Debug Output
-        bool targetPresent = false;
         for (const auto& dev : discoveredDevices) {
-            ESP_LOGI(TAG, "    - %s (%s) | RSSI: %d dBm", 
-                     dev.name.c_str(), dev.address.c_str(), dev.rssi);
-            
-            if (dev.address.equalsIgnoreCase(address)) {
-                targetPresent = true;
-            }
+            char mac[18];
+            dev.formatAddress(mac);
+            ESP_LOGI(TAG, "    - %s (%s) | RSSI: %d dBm", dev.name, mac, dev.rssi);
         }
+        bool targetPresent = targetSeen || discoveredDevices.find(address) != nullptr;
         
         if (targetPresent) {
-            ESP_LOGI(TAG, "  ✓ Target device present");
+            ESP_LOGI(TAG, "  ✓ Target device present%s", targetSeen ? " (advertising now)" : "");
         } else {
             ESP_LOGW(TAG, "  ⚠ Target NOT in list (continuing anyway)");
         }
         
         ESP_LOGI(TAG, "");
-        ESP_LOGI(TAG, "→ Waiting 500ms before GATT connection...");
-        vTaskDelay(pdMS_TO_TICKS(500));
-        ESP_LOGI(TAG, "");
     }
     
     // ════════════════════════════════════════════════════════════════════
@@ -1107,8 +2504,7 @@ bool ShellyBLEManager::smartConnectDevice(const String& address, uint32_t passke
             updateDeviceState(STATE_CONNECTED_UNENCRYPTED);
             
             // Continuous Scan erst NACH Connection starten
-            ESP_LOGI(TAG, "→ Starting Continuous Scan (after 2 second delay)...");
-            vTaskDelay(pdMS_TO_TICKS(2000));
+            ESP_LOGI(TAG, "→ Starting Continuous Scan...");
             startContinuousScan();
         }
         
@@ -1154,9 +2550,6 @@ bool ShellyBLEManager::smartConnectDevice(const String& address, uint32_t passke
         ESP_LOGI(TAG, "   → NO button press needed!");
         ESP_LOGI(TAG, "");
         
-        // Kurze Pause, damit Connection stabilisiert
-        vTaskDelay(pdMS_TO_TICKS(500));
-        
         bool encryptionSuccess = enableEncryption(address, passkey);
         
         if (!encryptionSuccess) {
@@ -1182,9 +2575,6 @@ bool ShellyBLEManager::smartConnectDevice(const String& address, uint32_t passke
         ESP_LOGI(TAG, "   (Provides immediate data without waiting for events)");
         ESP_LOGI(TAG, "");
         
-        // Warte kurz damit Device sich stabilisiert
-        vTaskDelay(pdMS_TO_TICKS(1000));
-        
         ShellyBLESensorData initialData;
         bool readSuccess = readSampleBTHomeData(address, initialData);
         
@@ -1198,9 +2588,16 @@ bool ShellyBLEManager::smartConnectDevice(const String& address, uint32_t passke
             ESP_LOGI(TAG, "");
             
             // Update paired device data
-            pairedDevice.sensorData = initialData;
-            pairedDevice.sensorData.lastUpdate = millis();
-            pairedDevice.sensorData.dataValid = true;
+            PairedShellyDevice* dev = registry.find(address);
+            if (dev) {
+                initialData.lastUpdate = millis();
+                initialData.dataValid = true;
+                initialData.confidence = SensorStateConfidence::LIVE;
+                taskENTER_CRITICAL(&sensorDataLock);
+                dev->sensorData = initialData;
+                taskEXIT_CRITICAL(&sensorDataLock);
+                persistSensorState(true);
+            }
             
             // Trigger Callback für WebUI Update
             if (sensorDataCallback) {
@@ -1230,8 +2627,6 @@ bool ShellyBLEManager::smartConnectDevice(const String& address, uint32_t passke
         ESP_LOGI(TAG, "   (Will monitor door open/close, button press, etc.)");
         ESP_LOGI(TAG, "");
         
-        vTaskDelay(pdMS_TO_TICKS(2000));
-        
         startContinuousScan();
         
         ESP_LOGI(TAG, "");
@@ -1285,7 +2680,6 @@ bool ShellyBLEManager::connectDevice(const String& address) {
         }
         
         ESP_LOGI(TAG, "✓ BLE started");
-        vTaskDelay(pdMS_TO_TICKS(1000));
     }
     
     // PRE-CHECK: NimBLE & Scanner Status
@@ -1304,33 +2698,22 @@ bool ShellyBLEManager::connectDevice(const String& address) {
         // after the GATT workflow completes successfully.
         stopScan(true);
 
-        // Warte bis Scanner wirklich gestoppt ist
-        uint32_t wait_start = millis();
-        while ((bleScanner && bleScanner->is_scanning()) && 
-               (millis() - wait_start < 3000)) {
-            vTaskDelay(pdMS_TO_TICKS(100));
-        }
-        
+        // ble_gap_disc_cancel() ist synchron - danach ist der Controller frei
         if (bleScanner && bleScanner->is_scanning()) {
-            ESP_LOGE(TAG, "✗ Failed to stop scanner after 3 seconds!");
+            ESP_LOGE(TAG, "✗ Failed to stop scanner!");
             ESP_LOGE(TAG, "  Cannot proceed with GATT connection");
             return false;
         }
         
         ESP_LOGI(TAG, "✓ Scanner stopped successfully");
         ESP_LOGI(TAG, "");
-        
-        // Zusätzliche Pause für NimBLE Stack
-        ESP_LOGI(TAG, "→ Waiting 1 second for NimBLE stack to settle...");
-        vTaskDelay(pdMS_TO_TICKS(1000));
     }
     
     // Prüfe ob bereits eine aktive Connection existiert
-    if (activeClient && activeClient->isConnected()) {
+    if (activeSession.isOpen()) {
         ESP_LOGW(TAG, "⚠ Already connected to a device");
         ESP_LOGI(TAG, "→ Disconnecting current device first...");
         closeActiveConnection();
-        vTaskDelay(pdMS_TO_TICKS(1000));
     }
     
     // ════════════════════════════════════════════════════════════════════
@@ -1346,17 +2729,14 @@ bool ShellyBLEManager::connectDevice(const String& address) {
     uint8_t addressType = BLE_ADDR_RANDOM;  // Default für Shelly
     bool deviceFound = false;
     
-    for (const auto& dev : discoveredDevices) {
-        if (dev.address.equalsIgnoreCase(address)) {
-            deviceName = dev.name;
-            addressType = dev.addressType;
-            deviceFound = true;
-            ESP_LOGI(TAG, "✓ Device found in scan results:");
-            ESP_LOGI(TAG, "  Name: %s", deviceName.c_str());
-            ESP_LOGI(TAG, "  Address: %s", address.c_str());
-            ESP_LOGI(TAG, "  Type: %s", addressType == BLE_ADDR_PUBLIC ? "PUBLIC" : "RANDOM");
-            break;
-        }
+    if (const ShellyBLEDevice* dev = discoveredDevices.find(address)) {
+        deviceName = dev->name;
+        addressType = dev->addressType;
+        deviceFound = true;
+        ESP_LOGI(TAG, "✓ Device found in scan results:");
+        ESP_LOGI(TAG, "  Name: %s", deviceName.c_str());
+        ESP_LOGI(TAG, "  Address: %s", address.c_str());
+        ESP_LOGI(TAG, "  Type: %s", addressType == BLE_ADDR_PUBLIC ? "PUBLIC" : "RANDOM");
     }
     
     if (!deviceFound) {
@@ -1368,151 +2748,38 @@ bool ShellyBLEManager::connectDevice(const String& address) {
     ESP_LOGI(TAG, "");
     
     // ════════════════════════════════════════════════════════════════════
-    // SECURITY SETUP
+    // GATT SESSION: CONNECT → MTU → SECURE → DISCOVER
     // ════════════════════════════════════════════════════════════════════
     
     ESP_LOGI(TAG, "╔═══════════════════════════════════╗");
-    ESP_LOGI(TAG, "║   SECURITY SETUP FOR BONDING      ║");
+    ESP_LOGI(TAG, "║   GATT CONNECTION + BONDING       ║");
     ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
     ESP_LOGI(TAG, "");
-    
-    NimBLEDevice::setSecurityAuth(true, false, true);  // Bonding, No MITM, SC
-    NimBLEDevice::setSecurityIOCap(BLE_HS_IO_NO_INPUT_OUTPUT);  // Just Works
-    
-    ESP_LOGI(TAG, "✓ Security configured:");
-    ESP_LOGI(TAG, "  Bonding: ENABLED");
-    ESP_LOGI(TAG, "  MITM: Disabled");
-    ESP_LOGI(TAG, "  I/O Capability: No Input/Output (Just Works)");
-    ESP_LOGI(TAG, "  → Pairing will be AUTO-CONFIRMED by ESP32");
-    ESP_LOGI(TAG, "");
-    
-    // ════════════════════════════════════════════════════════════════════
-    // GATT CONNECTION
-    // ════════════════════════════════════════════════════════════════════
-    
-    ESP_LOGI(TAG, "╔═══════════════════════════════════╗");
-    ESP_LOGI(TAG, "║   GATT CONNECTION                 ║");
-    ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
+    ESP_LOGI(TAG, "  Security: Bonding, No MITM, Just Works (AUTO-CONFIRMED)");
     ESP_LOGI(TAG, "");
     
-    activeClient = NimBLEDevice::createClient();
-    if (!activeClient) {
-        ESP_LOGE(TAG, "✗ Failed to create BLE client!");
-        return false;
-    }
-    
-    // Callbacks
-    activeClientCallbacks = new PairingCallbacks(this);
-    activeClient->setClientCallbacks(activeClientCallbacks, false);
-    
-    activeClient->setConnectionParams(12, 12, 0, 100);
-    activeClient->setConnectTimeout(10000);  // 10 Sekunden pro Versuch
-    
-    ESP_LOGI(TAG, "→ Connecting...");
-    
-    NimBLEAddress peerAddress(address.c_str(), addressType);
-    
-    bool connected = false;
-    
-    ESP_LOGI(TAG, "→ Attempt 1/2: %s address type...",
-             addressType == BLE_ADDR_PUBLIC ? "PUBLIC" : "RANDOM");
-    
-    if (activeClient->connect(peerAddress, false) || activeClient->isConnected()) {
-        connected = true;
-        ESP_LOGI(TAG, "✓ Connected with %s address",
-                 addressType == BLE_ADDR_PUBLIC ? "PUBLIC" : "RANDOM");
-    } else {
-        ESP_LOGW(TAG, "  Failed, trying alternative address type...");
-
-        // Only try the alternative address type if we are truly not connected.
-        // (connect() can return false even when the link is up due to a race
-        // between the NimBLE GAP event and the connect() return path.)
-        uint8_t altType = (addressType == BLE_ADDR_PUBLIC) ? BLE_ADDR_RANDOM : BLE_ADDR_PUBLIC;
-        peerAddress = NimBLEAddress(address.c_str(), altType);
-
-        ESP_LOGI(TAG, "→ Attempt 2/2: %s address type...",
-                 altType == BLE_ADDR_PUBLIC ? "PUBLIC" : "RANDOM");
-
-        if (activeClient->connect(peerAddress, false) || activeClient->isConnected()) {
-            connected = true;
-            ESP_LOGI(TAG, "✓ Connected with %s address",
-                     altType == BLE_ADDR_PUBLIC ? "PUBLIC" : "RANDOM");
-        }
-    }
+    uint32_t flowStart = millis();
+    prepareSession(activeSession);
     
-    if (!connected) {
+    if (!activeSession.open(address, addressType)) {
         ESP_LOGE(TAG, "");
         ESP_LOGE(TAG, "✗ GATT connection failed");
         ESP_LOGE(TAG, "");
-        closeActiveConnection();
         return false;
     }
     
-    ESP_LOGI(TAG, "");
     ESP_LOGI(TAG, "✓ GATT connected");
-    ESP_LOGI(TAG, "  Peer: %s", activeClient->getPeerAddress().toString().c_str());
-    ESP_LOGI(TAG, "  MTU: %d bytes", activeClient->getMTU());
+    ESP_LOGI(TAG, "  Peer: %s", activeSession.peerAddress().c_str());
+    ESP_LOGI(TAG, "  MTU: %d bytes", activeSession.mtu());
     ESP_LOGI(TAG, "");
     
-    // ════════════════════════════════════════════════════════════════════
-    // EXPLICIT PAIRING ANFORDERN
-    // ════════════════════════════════════════════════════════════════════
-    
-    ESP_LOGI(TAG, "╔═══════════════════════════════════╗");
-    ESP_LOGI(TAG, "║   INITIATE PAIRING                ║");
-    ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
-    ESP_LOGI(TAG, "");
     ESP_LOGI(TAG, "→ Requesting secure connection (bonding)...");
-    ESP_LOGI(TAG, "  This will be AUTO-CONFIRMED (Just Works)");
-    ESP_LOGI(TAG, "");
-    
-    // EXPLICIT Pairing anfordern!
-    bool secureResult = activeClient->secureConnection();
-    
-    if (!secureResult) {
-        ESP_LOGE(TAG, "✗ secureConnection() returned false!");
-        ESP_LOGE(TAG, "  Pairing was rejected or failed");
-        ESP_LOGE(TAG, "");
-        closeActiveConnection();
-        return false;
-    }
-    
-    ESP_LOGI(TAG, "✓ secureConnection() returned true");
-    ESP_LOGI(TAG, "  Pairing initiated successfully");
-    ESP_LOGI(TAG, "");
-    
-    // ════════════════════════════════════════════════════════════════════
-    // WARTE AUF BONDING COMPLETE
-    // ════════════════════════════════════════════════════════════════════
-    
-    ESP_LOGI(TAG, "⏳ Waiting for bonding to complete...");
-    ESP_LOGI(TAG, "");
-    
-    uint32_t wait_start = millis();
-    uint32_t last_log = 0;
     
-    while (millis() - wait_start < 15000) {
-        if (activeClientCallbacks->pairingComplete) {
-            break;
-        }
-        
-        if (millis() - last_log > 2000) {
-            uint32_t elapsed = (millis() - wait_start) / 1000;
-            ESP_LOGI(TAG, "  Waiting... %u seconds", elapsed);
-            last_log = millis();
-        }
-        
-        vTaskDelay(pdMS_TO_TICKS(500));
-    }
-    
-    if (!activeClientCallbacks->pairingComplete) {
+    if (!activeSession.secure()) {
         ESP_LOGE(TAG, "");
-        ESP_LOGE(TAG, "✗ Bonding timeout after 15 seconds!");
-        ESP_LOGE(TAG, "");
-        ESP_LOGE(TAG, "Debug info:");
-        ESP_LOGI(TAG, "  - GATT connected: %s", activeClient->isConnected() ? "YES" : "NO");
-        ESP_LOGI(TAG, "  - secureConnection() returned: true");
-        ESP_LOGI(TAG, "  - Pairing callbacks registered: YES");
+        ESP_LOGE(TAG, "✗ Bonding failed (%s after %d ms)",
+                 activeSession.isConnected() ? "rejected or timeout" : "disconnected",
+                 GATT_SECURE_DEADLINE_MS);
         ESP_LOGE(TAG, "");
         ESP_LOGE(TAG, "Possible reasons:");
         ESP_LOGE(TAG, "  1. Device not in pairing mode (button not held 10+ sec)");
@@ -1523,50 +2790,31 @@ bool ShellyBLEManager::connectDevice(const String& address) {
         return false;
     }
     
-    if (!activeClientCallbacks->pairingSuccess) {
-        ESP_LOGE(TAG, "");
-        ESP_LOGE(TAG, "✗ Bonding failed!");
-        ESP_LOGE(TAG, "");
-        closeActiveConnection();
-        return false;
-    }
-    
     ESP_LOGI(TAG, "");
     ESP_LOGI(TAG, "╔═══════════════════════════════════╗");
     ESP_LOGI(TAG, "║  ✓ BONDING SUCCESSFUL             ║");
     ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
     ESP_LOGI(TAG, "");
-    ESP_LOGI(TAG, "✓ Device is now bonded (trusted)");
-    ESP_LOGI(TAG, "✓ Pairing was AUTO-CONFIRMED by ESP32");
-    ESP_LOGI(TAG, "✓ Protected characteristics are now accessible");
-    ESP_LOGI(TAG, "");
     
-    // ════════════════════════════════════════════════════════════════════
-    // SERVICE DISCOVERY
-    // ════════════════════════════════════════════════════════════════════
-    
-    ESP_LOGI(TAG, "→ Discovering services...");
-    
-    std::vector<NimBLERemoteService*> services = activeClient->getServices(true);
-    
-    if (services.empty()) {
+    if (!activeSession.discover()) {
         ESP_LOGE(TAG, "✗ No services found");
         closeActiveConnection();
         return false;
     }
     
-    ESP_LOGI(TAG, "✓ Found %d services", services.size());
-    ESP_LOGI(TAG, "");
-    
     // ════════════════════════════════════════════════════════════════════
     // CONNECTION BLEIBT AKTIV (für Phase 2)
     // ════════════════════════════════════════════════════════════════════
     
-    activeClientTimestamp = millis();
+    const PairedShellyDevice* existing = registry.find(address);
+    ShellySensorRole role = existing ? existing->role : roleFromName(deviceName);
     
-    pairedDevice.address = address;
-    pairedDevice.name = deviceName;
-    pairedDevice.bindkey = "";  // Noch nicht encrypted
+    // Noch nicht encrypted → Bindkey leer
+    if (!registry.add(address, deviceName, ShellyBindkey(), role, activeSession.addressType())) {
+        ESP_LOGE(TAG, "✗ Cannot register device (max %d paired sensors)", BLE_MAX_PAIRED_DEVICES);
+        closeActiveConnection();
+        return false;
+    }
     
     savePairedDevice();
     updateDeviceState(STATE_CONNECTED_UNENCRYPTED);
@@ -1577,7 +2825,7 @@ bool ShellyBLEManager::connectDevice(const String& address) {
     ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
     ESP_LOGI(TAG, "");
     ESP_LOGI(TAG, "Device: %s (%s)", deviceName.c_str(), address.c_str());
-    ESP_LOGI(TAG, "Status: Bonded + Connected");
+    ESP_LOGI(TAG, "Status: Bonded + Connected (%u ms)", millis() - flowStart);
     ESP_LOGI(TAG, "");
     ESP_LOGI(TAG, "⚠ Connection kept ACTIVE for Phase 2");
     ESP_LOGI(TAG, "  → Encryption can be enabled immediately");
@@ -1603,44 +2851,41 @@ bool ShellyBLEManager::connectDevice(const String& address) {
     // VARIABLEN DEKLARIEREN
     // ========================================================================
     
-    uint8_t addressType = BLE_ADDR_PUBLIC;  // Default
+    if (!ensureBLEStarted()) {
+        ESP_LOGE(TAG, "✗ Failed to start BLE");
+        return false;
+    }
+    
     bool wasScanning = scanning;
     bool wasContinuous = continuousScan;  // capture BEFORE any stopScan call
-    bool needNewConnection = true;
-    NimBLEClient* pClient = nullptr;
+    uint32_t flowStart = millis();
     
-    // Device Info aus discoveredDevices holen
-    for (const auto& dev : discoveredDevices) {
-        if (dev.address.equalsIgnoreCase(address)) {
-            addressType = dev.addressType;
-            break;
-        }
-    }
+    const PairedShellyDevice* target = registry.find(address);
+    String targetName = target ? target->name : String("");
+    uint8_t addressType = lookupAddressType(address, BLE_ADDR_PUBLIC);
     
     // ========================================================================
     // PRÜFE BESTEHENDE CONNECTION
     // ========================================================================
     
-    if (activeClient && activeClient->isConnected()) {
-        String connectedAddr = String(activeClient->getPeerAddress().toString().c_str());
-        
-        if (connectedAddr.equalsIgnoreCase(address)) {
-            uint32_t connectionAge = millis() - activeClientTimestamp;
+    bool needNewConnection = true;
+    
+    if (activeSession.isOpen()) {
+        if (activeSession.isConnectedTo(address)) {
+            uint32_t connectionAge = activeSession.age();
             
-            if (connectionAge < 60000) {
+            if (connectionAge < GATT_SESSION_REUSE_MS) {
                 ESP_LOGI(TAG, "✓ Using existing BONDED connection from Phase 1");
                 ESP_LOGI(TAG, "  Connection age: %u ms", connectionAge);
                 ESP_LOGI(TAG, "  This connection has write permissions!");
                 ESP_LOGI(TAG, "");
-                
-                pClient = activeClient;
                 needNewConnection = false;
             } else {
                 ESP_LOGW(TAG, "⚠ Connection too old, will reconnect");
                 closeActiveConnection();
             }
         } else {
-            ESP_LOGW(TAG, "⚠ Wrong device, disconnecting");
+            ESP_LOGW(TAG, "⚠ Wrong device or link lost, disconnecting");
             closeActiveConnection();
         }
     }
@@ -1658,91 +2903,35 @@ bool ShellyBLEManager::connectDevice(const String& address) {
         if (wasScanning) {
             ESP_LOGI(TAG, "→ Stopping scan...");
             // manualStop=true: prevents auto-restart task from firing during the
-            // GATT operation (bonding + passkey write + device reboot + reconnect
-            // can take 30-60s). Scan is restored on every exit path below.
+            // GATT operation. Scan is restored on every exit path below.
             stopScan(true);
-            vTaskDelay(pdMS_TO_TICKS(1500));
         }
-
-        NimBLEDevice::setSecurityAuth(true, false, true);
-        NimBLEDevice::setSecurityIOCap(BLE_HS_IO_NO_INPUT_OUTPUT);
         
-        pClient = NimBLEDevice::createClient();
-        if (!pClient) {
-            ESP_LOGE(TAG, "✗ Failed to create client");
-            if (wasContinuous) startContinuousScan(); else if (wasScanning) startScan(30);
-            return false;
-        }
-
-        PairingCallbacks* callbacks = new PairingCallbacks(this);
-        pClient->setClientCallbacks(callbacks, false);
-        pClient->setConnectTimeout(25000);
-
-        ESP_LOGI(TAG, "→ Connecting...");
-
-        NimBLEAddress bleAddr(address.c_str(), addressType);
-        bool connected = pClient->connect(bleAddr, false);
-
-        if (!connected) {
-            uint8_t altType = (addressType == BLE_ADDR_PUBLIC) ? BLE_ADDR_RANDOM : BLE_ADDR_PUBLIC;
-            bleAddr = NimBLEAddress(address.c_str(), altType);
-            connected = pClient->connect(bleAddr, false);
-        }
-
-        if (!connected) {
-            ESP_LOGE(TAG, "✗ Connection failed");
-            delete callbacks;
-            NimBLEDevice::deleteClient(pClient);
-            if (wasContinuous) startContinuousScan(); else if (wasScanning) startScan(30);
-            return false;
-        }
-
-        ESP_LOGI(TAG, "✓ Connected");
-
-        // Warte auf Bonding
-        uint32_t wait_start = millis();
-        while (millis() - wait_start < 15000) {
-            if (callbacks->pairingComplete) break;
-            vTaskDelay(pdMS_TO_TICKS(500));
-        }
-
-        if (!callbacks->pairingSuccess) {
-            ESP_LOGE(TAG, "✗ Bonding failed");
-            delete callbacks;
-            pClient->disconnect();
-            NimBLEDevice::deleteClient(pClient);
+        prepareSession(activeSession);
+        
+        if (!activeSession.open(address, addressType) || !activeSession.secure()) {
+            ESP_LOGE(TAG, "✗ Bonded connection failed (%s)",
+                     gattStepName(activeSession.failedStep()));
+            closeActiveConnection();
             if (wasContinuous) startContinuousScan(); else if (wasScanning) startScan(30);
             return false;
         }
         
-        delete callbacks;
+        ESP_LOGI(TAG, "✓ Connected + bonded");
         ESP_LOGI(TAG, "");
     }
     
     // ========================================================================
-    // SERVICE DISCOVERY
+    // SERVICE DISCOVERY (gecacht aus Phase 1)
     // ========================================================================
     
-    ESP_LOGI(TAG, "╔═══════════════════════════════════╗");
-    ESP_LOGI(TAG, "║   SERVICE DISCOVERY               ║");
-    ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
-    ESP_LOGI(TAG, "");
-    ESP_LOGI(TAG, "→ Refreshing services...");
-    
-    std::vector<NimBLERemoteService*> services = pClient->getServices(true);
-    
-    if (services.empty()) {
+    if (!activeSession.discover()) {
         ESP_LOGE(TAG, "✗ No services found");
-        if (needNewConnection) {
-            pClient->disconnect();
-            NimBLEDevice::deleteClient(pClient);
-        }
+        closeActiveConnection();
+        if (wasContinuous) startContinuousScan(); else if (wasScanning) startScan(30);
         return false;
     }
     
-    ESP_LOGI(TAG, "✓ Found %d services", services.size());
-    ESP_LOGI(TAG, "");
-    
     // ========================================================================
     // PASSKEY SCHREIBEN
     // ========================================================================
@@ -1758,51 +2947,25 @@ bool ShellyBLEManager::connectDevice(const String& address) {
     ESP_LOGI(TAG, "");
     ESP_LOGI(TAG, "Available services:");
     
-    for (size_t i = 0; i < services.size(); i++) {
-        auto* pService = services[i];
-        ESP_LOGI(TAG, "  [%d] Service: %s", i, pService->getUUID().toString().c_str());
-        
-        // KORRIGIERT: getCharacteristics() gibt const vector& zurück
-        const std::vector<NimBLERemoteCharacteristic*>& charVec = pService->getCharacteristics(true);
-        
-        if (charVec.size() > 0) {
-            ESP_LOGI(TAG, "      Characteristics: %d", charVec.size());
-            
-            for (auto* pChar : charVec) {
-                ESP_LOGI(TAG, "        - %s (Props: %s%s%s)", 
-                         pChar->getUUID().toString().c_str(),
-                         pChar->canRead() ? "R" : "",
-                         pChar->canWrite() ? "W" : "",
-                         pChar->canWriteNoResponse() ? "w" : "");
-            }
-        } else {
-            ESP_LOGI(TAG, "      Characteristics: 0");
+    std::string lastService;
+    size_t serviceCount = 0;
+    activeSession.visitCharacteristics([&](const std::string& service,
+                                           const std::string& uuid, uint8_t props) {
+        if (service != lastService) {
+            ESP_LOGI(TAG, "  [%d] Service: %s", (int)serviceCount++, service.c_str());
+            lastService = service;
         }
-    }
+        ESP_LOGI(TAG, "        - %s (Props: %s%s%s)",
+                 uuid.c_str(),
+                 (props & GATT_PROP_READ) ? "R" : "",
+                 (props & GATT_PROP_WRITE) ? "W" : "",
+                 (props & GATT_PROP_WRITE_NR) ? "w" : "");
+    });
     
     ESP_LOGI(TAG, "");
     
-    NimBLEUUID passkeyUUID(GATT_UUID_PASSKEY);
-    NimBLERemoteCharacteristic* pPasskeyChar = nullptr;
-    
-    ESP_LOGI(TAG, "→ Looking for UUID: %s", passkeyUUID.toString().c_str());
-    
-    for (auto* pService : services) {
-        pPasskeyChar = pService->getCharacteristic(passkeyUUID);
-        if (pPasskeyChar) {
-            ESP_LOGI(TAG, "");
-            ESP_LOGI(TAG, "✓ Passkey characteristic FOUND!");
-            ESP_LOGI(TAG, "  Service: %s", pService->getUUID().toString().c_str());
-            ESP_LOGI(TAG, "  UUID: %s", pPasskeyChar->getUUID().toString().c_str());
-            ESP_LOGI(TAG, "  Can Write: %s", pPasskeyChar->canWrite() ? "YES" : "NO");
-            ESP_LOGI(TAG, "  Can Write NoResponse: %s", pPasskeyChar->canWriteNoResponse() ? "YES" : "NO");
-            ESP_LOGI(TAG, "");
-            break;
-        }
-    }
-    
     // ✅✅KRITISCHER NULL-CHECK! ✅✅✅
-    if (!pPasskeyChar) {
+    if (!activeSession.hasCharacteristic(GATT_UUID_PASSKEY)) {
         ESP_LOGE(TAG, "");
         ESP_LOGE(TAG, "╔═══════════════════════════════════╗");
         ESP_LOGE(TAG, "║  ✗ PASSKEY CHAR NOT FOUND!        ║");
@@ -1814,330 +2977,135 @@ bool ShellyBLEManager::connectDevice(const String& address) {
         ESP_LOGE(TAG, "  3. Or: Wrong device type");
         ESP_LOGE(TAG, "");
         ESP_LOGE(TAG, "Expected UUID: %s", GATT_UUID_PASSKEY);
-        ESP_LOGE(TAG, "Searched in %d services", services.size());
-        ESP_LOGE(TAG, "");
-        
-        if (needNewConnection) {
-            pClient->disconnect();
-            NimBLEDevice::deleteClient(pClient);
-        } else {
-            closeActiveConnection();
-        }
-        return false;
-    }
-    
-    // CHECK: Ist Characteristic wirklich beschreibbar?
-    if (!pPasskeyChar->canWrite() && !pPasskeyChar->canWriteNoResponse()) {
-        ESP_LOGE(TAG, "");
-        ESP_LOGE(TAG, "╔═══════════════════════════════════╗");
-        ESP_LOGE(TAG, "║  ✗ PASSKEY CHAR NOT WRITABLE!     ║");
-        ESP_LOGE(TAG, "╚═══════════════════════════════════╝");
-        ESP_LOGE(TAG, "");
-        ESP_LOGE(TAG, "Properties:");
-        ESP_LOGE(TAG, "  Can Read: %s", pPasskeyChar->canRead() ? "YES" : "NO");
-        ESP_LOGE(TAG, "  Can Write: %s", pPasskeyChar->canWrite() ? "YES" : "NO");
-        ESP_LOGE(TAG, "  Can Write NoResponse: %s", pPasskeyChar->canWriteNoResponse() ? "YES" : "NO");
+        ESP_LOGE(TAG, "Searched in %d services", (int)serviceCount);
         ESP_LOGE(TAG, "");
         
-        if (needNewConnection) {
-            pClient->disconnect();
-            NimBLEDevice::deleteClient(pClient);
-        } else {
-            closeActiveConnection();
-        }
+        closeActiveConnection();
+        if (wasContinuous) startContinuousScan(); else if (wasScanning) startScan(30);
         return false;
     }
     
-    // AB HIER IST pPasskeyChar GARANTIERT != NULL UND WRITABLE!
-    
     uint8_t passkeyBytes[4];
     passkeyBytes[0] = (passkey) & 0xFF;
     passkeyBytes[1] = (passkey >> 8) & 0xFF;
     passkeyBytes[2] = (passkey >> 16) & 0xFF;
     passkeyBytes[3] = (passkey >> 24) & 0xFF;
     
-    ESP_LOGI(TAG, "╔═══════════════════════════════════╗");
-    ESP_LOGI(TAG, "║   WRITE PASSKEY TO DEVICE         ║");
-    ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
-    ESP_LOGI(TAG, "");
     ESP_LOGI(TAG, "→ Writing Passkey: %u", passkey);
     ESP_LOGI(TAG, "  Bytes: 0x%02X 0x%02X 0x%02X 0x%02X", 
              passkeyBytes[0], passkeyBytes[1], passkeyBytes[2], passkeyBytes[3]);
-    ESP_LOGI(TAG, "");
-    
-    // Watchdog feed
-    esp_task_wdt_reset();
-    
-    bool writeSuccess = false;
-    
-    ESP_LOGI(TAG, "→ Attempting write with response...");
-    
-    // JETZT ist canWrite() sicher (pPasskeyChar != NULL)
-    if (pPasskeyChar->canWrite()) {
-        writeSuccess = pPasskeyChar->writeValue(passkeyBytes, 4, true);
-        
-        if (writeSuccess) {
-            ESP_LOGI(TAG, "  ✓ Write with response: SUCCESS");
-            savePasskey(passkey);
-        } else {
-            ESP_LOGW(TAG, "  ✗ Write with response: FAILED");
-        }
-    }
-    
-    if (!writeSuccess && pPasskeyChar->canWriteNoResponse()) {
-        ESP_LOGI(TAG, "→ Attempting write without response...");
-        writeSuccess = pPasskeyChar->writeValue(passkeyBytes, 4, false);
-        
-        if (writeSuccess) {
-            ESP_LOGI(TAG, "  ✓ Write without response: SUCCESS");
-            savePasskey(passkey);
-            vTaskDelay(pdMS_TO_TICKS(500));
-        } else {
-            ESP_LOGW(TAG, "  ✗ Write without response: FAILED");
-        }
-    }
-    
-    // Watchdog feed
-    esp_task_wdt_reset();
-    
-    ESP_LOGI(TAG, "✓ Passkey written successfully!");
-    ESP_LOGI(TAG, "");
-    ESP_LOGI(TAG, "→ Device will reboot and enable encryption...");
-    ESP_LOGI(TAG, "");
-    
-    // ========================================================================
-    // DISCONNECT
-    // ========================================================================
-    
-    ESP_LOGI(TAG, "→ Disconnecting...");
-    pClient->disconnect();
-    
-    uint8_t retries = 0;
-    while (pClient->isConnected() && retries < 20) {
-        vTaskDelay(pdMS_TO_TICKS(100));
-        retries++;
-    }
-    
-    if (needNewConnection) {
-        NimBLEDevice::deleteClient(pClient);
-    } else {
-        NimBLEDevice::deleteClient(activeClient);
-        activeClient = nullptr;
-        activeClientTimestamp = 0;
-    }
-    
-    ESP_LOGI(TAG, "✓ Disconnected");
-    ESP_LOGI(TAG, "");
-    
-    // ========================================================================
-    // REBOOT WAIT
-    // ========================================================================
-    
-    ESP_LOGI(TAG, "╔═══════════════════════════════════╗");
-    ESP_LOGI(TAG, "║   WAITING FOR REBOOT              ║");
-    ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
-    ESP_LOGI(TAG, "");
-    ESP_LOGI(TAG, "⏳ Device is rebooting...");
-    
-    for (int i = 0; i < 8; i++) {
-        vTaskDelay(pdMS_TO_TICKS(1000));
-        if (i % 2 == 0 || i >= 6) {
-            ESP_LOGI(TAG, "  %d/8 seconds...", i + 1);
-        }
-    }
-    
-    ESP_LOGI(TAG, "");
-    
-    // ========================================================================
-    // RE-DISCOVERY
-    // ========================================================================
-    
-    ESP_LOGI(TAG, "╔═══════════════════════════════════╗");
-    ESP_LOGI(TAG, "║   RE-DISCOVERY AFTER REBOOT       ║");
-    ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
-    ESP_LOGI(TAG, "");
-    
-    // WICHTIG: Laufenden Scan stoppen!
-    if (scanning) {
-        ESP_LOGI(TAG, "→ Stopping active continuous scan...");
-        NimBLEScan* pActiveScan = NimBLEDevice::getScan();
-        pActiveScan->stop();
-        scanning = false;
-        vTaskDelay(pdMS_TO_TICKS(1500));  // 1,5 Sekunden warten
-    }
-    
-    String newAddress = address;
-    uint8_t newType = addressType;
-    bool found = false;
-    
-    NimBLEScan* pScan = NimBLEDevice::getScan();
-    pScan->setActiveScan(true);
-    pScan->setInterval(100);
-    pScan->setWindow(99);
-    
-    ESP_LOGI(TAG, "→ Starting BLOCKING re-discovery scan (10 seconds)...");
-    ESP_LOGI(TAG, "   This will wait for the scan to complete");
-    ESP_LOGI(TAG, "");
-    
-    // BLOCKING SCAN: true statt false!
-    bool scanSuccess = pScan->start(10, true);  // ← true = blocking!
-    
-    if (scanSuccess) {
-        NimBLEScanResults results = pScan->getResults();
-        ESP_LOGI(TAG, "→ Re-discovery scan completed");
-        ESP_LOGI(TAG, "  Found %d devices total", results.getCount());
-        ESP_LOGI(TAG, "");
-        
-        if (results.getCount() > 0) {
-            ESP_LOGI(TAG, "Scanning results:");
-            
-            for (int i = 0; i < results.getCount(); i++) {
-                const NimBLEAdvertisedDevice* dev = results.getDevice(i);
-                if (!dev) continue;
-                
-                String devName = String(dev->getName().c_str());
-                String devAddr = String(dev->getAddress().toString().c_str());
-                
-                ESP_LOGI(TAG, "  [%d] %s", i + 1, devName.c_str());
-                ESP_LOGI(TAG, "      Address: %s", devAddr.c_str());
-                ESP_LOGI(TAG, "      RSSI: %d dBm", dev->getRSSI());
-                
-                // Strategie 1: Suche nach gleichem Namen
-                if (devName == pairedDevice.name) {
-                    newAddress = devAddr;
-                    newType = dev->getAddress().getType();
-                    found = true;
-                    ESP_LOGI(TAG, "");
-                    ESP_LOGI(TAG, "✓ TARGET DEVICE FOUND by name!");
-                    ESP_LOGI(TAG, "  Name: %s", devName.c_str());
-                    ESP_LOGI(TAG, "  Address: %s", newAddress.c_str());
-                    ESP_LOGI(TAG, "  Type: %s", 
-                             newType == BLE_ADDR_PUBLIC ? "PUBLIC" : "RANDOM");
-                    break;
-                }
-                
-                // Strategie 2: Gleiche Adresse
-                if (devAddr.equalsIgnoreCase(address)) {
-                    newAddress = devAddr;
-                    newType = dev->getAddress().getType();
-                    found = true;
-                    ESP_LOGI(TAG, "");
-                    ESP_LOGI(TAG, "✓ TARGET DEVICE FOUND by address!");
-                    ESP_LOGI(TAG, "  Address: %s", newAddress.c_str());
-                    ESP_LOGI(TAG, "  Type: %s", 
-                             newType == BLE_ADDR_PUBLIC ? "PUBLIC" : "RANDOM");
-                    break;
-                }
-            }
-            
-            if (!found) {
-                ESP_LOGW(TAG, "");
-                ESP_LOGW(TAG, "⚠ Target device not in scan results");
-                ESP_LOGI(TAG, "  Looking for: %s", pairedDevice.name.c_str());
-            }
-        }
-        
-        pScan->clearResults();
-        
-    } else {
-        ESP_LOGE(TAG, "✗ Re-discovery scan failed to start or complete!");
-    }
+    ESP_LOGI(TAG, "");
     
-    if (!found) {
-        ESP_LOGW(TAG, "");
-        ESP_LOGW(TAG, "⚠ Device not found in re-discovery scan");
-        ESP_LOGI(TAG, "  Will try with original address anyway");
-        ESP_LOGI(TAG, "  Address: %s", address.c_str());
-        ESP_LOGI(TAG, "  Type: %s", addressType == BLE_ADDR_PUBLIC ? "PUBLIC" : "RANDOM");
-        ESP_LOGI(TAG, "");
-        ESP_LOGI(TAG, "Note: Device might still be rebooting");
-        ESP_LOGI(TAG, "      Or encryption is active (different advertisement)");
-        newAddress = address;
-        newType = addressType;
+    // Watchdog feed
+    esp_task_wdt_reset();
+    
+    // Write with Response bevorzugt, sonst Write without Response
+    if (!activeSession.write(GATT_UUID_PASSKEY, passkeyBytes, sizeof(passkeyBytes))) {
+        ESP_LOGE(TAG, "✗ Passkey write failed");
+        closeActiveConnection();
+        if (wasContinuous) startContinuousScan(); else if (wasScanning) startScan(30);
+        return false;
     }
     
+    savePasskey(passkey);
+    
+    // Watchdog feed
+    esp_task_wdt_reset();
+    
+    ESP_LOGI(TAG, "✓ Passkey written successfully!");
+    ESP_LOGI(TAG, "");
+    ESP_LOGI(TAG, "→ Device will reboot and enable encryption...");
+    ESP_LOGI(TAG, "");
+    
+    // ========================================================================
+    // DISCONNECT (Sensor trennt beim Reboot selbst)
+    // ========================================================================
+    
+    if (activeSession.waitForDisconnect(GATT_REBOOT_DISCONNECT_MS)) {
+        ESP_LOGI(TAG, "✓ Device dropped the link (rebooting)");
+    } else {
+        ESP_LOGI(TAG, "→ No disconnect from device - disconnecting");
+    }
+    closeActiveConnection();
     ESP_LOGI(TAG, "");
     
     // ========================================================================
-    // RECONNECT MIT MEHREREN VERSUCHEN
+    // RECONNECT NACH REBOOT
     // ========================================================================
+    //
+    // Kein fester Reboot-Wait: ein ausstehender Connect wird angenommen,
+    // sobald der Sensor wieder connectable advertised.
     
     ESP_LOGI(TAG, "╔═══════════════════════════════════╗");
     ESP_LOGI(TAG, "║   RECONNECT FOR BINDKEY READ      ║");
     ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
     ESP_LOGI(TAG, "");
     
-    NimBLEDevice::setSecurityAuth(true, false, true);
-    NimBLEDevice::setSecurityIOCap(BLE_HS_IO_NO_INPUT_OUTPUT);
+    if (scanning) {
+        ESP_LOGI(TAG, "→ Stopping active scan...");
+        stopScan(true);
+    }
     
+    ShellyBindkey bindkey;
+    uint8_t newType = addressType;
     bool connected = false;
-    int maxAttempts = 5;  // 5 Versuche!
+    int attempts = 0;
     
-    for (int attempt = 1; attempt <= maxAttempts && !connected; attempt++) {
-        ESP_LOGI(TAG, "→ Connection attempt %d/%d...", attempt, maxAttempts);
-        ESP_LOGI(TAG, "  Target: %s (%s)", 
-                 newAddress.c_str(),
-                 newType == BLE_ADDR_PUBLIC ? "PUBLIC" : "RANDOM");
+    prepareSession(activeSession);
+    
+    for (int attempt = 1; attempt <= GATT_REBOOT_ATTEMPTS && !bindkey.isSet(); attempt++) {
+        attempts = attempt;
+        esp_task_wdt_reset();
         
-        pClient = NimBLEDevice::createClient();
-        if (!pClient) {
-            ESP_LOGE(TAG, "  ✗ Failed to create client");
-            vTaskDelay(pdMS_TO_TICKS(2000));
+        ESP_LOGI(TAG, "→ Reconnect attempt %d/%d...", attempt, GATT_REBOOT_ATTEMPTS);
+        
+        if (!activeSession.open(address, newType, { GATT_REBOOT_CONNECT_MS, GATT_CONNECT_ATTEMPTS })) {
+            ESP_LOGI(TAG, "     (Device might still be rebooting)");
             continue;
         }
         
-        pClient->setConnectTimeout(1500);  // 15 Sekunden pro Versuch
-        
-        NimBLEAddress newBleAddr(newAddress.c_str(), newType);
-        connected = pClient->connect(newBleAddr, false);
+        connected = true;
+        newType = activeSession.addressType();
         
-        if (connected) {
-            ESP_LOGI(TAG, "  ✓ Connected with %s address!",
-                     newType == BLE_ADDR_PUBLIC ? "PUBLIC" : "RANDOM");
-        } else {
-            ESP_LOGW(TAG, "  ✗ Failed with %s address", 
-                     newType == BLE_ADDR_PUBLIC ? "PUBLIC" : "RANDOM");
-            
-            // Versuche alternativen Address Type
-            uint8_t altType = (newType == BLE_ADDR_PUBLIC) ? BLE_ADDR_RANDOM : BLE_ADDR_PUBLIC;
-            ESP_LOGI(TAG, "  → Trying %s address...",
-                     altType == BLE_ADDR_PUBLIC ? "PUBLIC" : "RANDOM");
-            
-            newBleAddr = NimBLEAddress(newAddress.c_str(), altType);
-            connected = pClient->connect(newBleAddr, false);
-            
-            if (connected) {
-                newType = altType;
-                ESP_LOGI(TAG, "  ✓ Connected with %s address!",
-                         altType == BLE_ADDR_PUBLIC ? "PUBLIC" : "RANDOM");
+        std::string val;
+        if (activeSession.read(GATT_UUID_ENCRYPTION_KEY, val)) {
+            if (val.length() == ShellyBindkey::SIZE) {
+                bindkey.set((const uint8_t*)val.data());
+                mbedtls_platform_zeroize(&val[0], val.length());
+                ESP_LOGI(TAG, "");
+                ESP_LOGI(TAG, "✓ Bindkey read successfully!");
+                ESP_LOGI(TAG, "  Bindkey: %s", bindkey.toHex().c_str());
+            } else {
+                ESP_LOGE(TAG, "✗ Invalid bindkey length: %d (expected 16)", val.length());
+                
+                String hexDump = "";
+                for (size_t i = 0; i < val.length(); i++) {
+                    char hex[3];
+                    snprintf(hex, sizeof(hex), "%02x", (uint8_t)val[i]);
+                    hexDump += hex;
+                    if (i < val.length() - 1) hexDump += " ";
+                }
+                ESP_LOGE(TAG, "  Received: %s", hexDump.c_str());
             }
         }
         
-        if (!connected) {
-            NimBLEDevice::deleteClient(pClient);
-            pClient = nullptr;
-            
-            if (attempt < maxAttempts) {
-                int waitTime = 3;  // 3 Sekunden zwischen Versuchen
-                ESP_LOGI(TAG, "  → Waiting %d seconds before retry...", waitTime);
-                ESP_LOGI(TAG, "     (Device might still be rebooting)");
-                vTaskDelay(pdMS_TO_TICKS(waitTime * 1000));
-            }
-        }
+        // Link vor dem Reboot erwischt oder Key ungültig → neu verbinden
+        closeActiveConnection();
     }
     
+    ESP_LOGI(TAG, "");
+    
     if (!connected) {
         ESP_LOGE(TAG, "");
         ESP_LOGE(TAG, "╔═══════════════════════════════════╗");
         ESP_LOGE(TAG, "║  ✗ ALL RECONNECT ATTEMPTS FAILED  ║");
         ESP_LOGE(TAG, "╚═══════════════════════════════════╝");
         ESP_LOGE(TAG, "");
-        ESP_LOGE(TAG, "Tried %d times with both address types", maxAttempts);
+        ESP_LOGE(TAG, "Tried %d times with both address types", GATT_REBOOT_ATTEMPTS);
         ESP_LOGE(TAG, "");
         ESP_LOGE(TAG, "Possible reasons:");
         ESP_LOGE(TAG, "  • Passkey was rejected (device reverted to unencrypted)");
         ESP_LOGE(TAG, "  • Device takes longer than expected to reboot");
-        ESP_LOGE(TAG, "  • Device address changed and scan didn't find it");
         ESP_LOGE(TAG, "  • Device is malfunctioning");
         ESP_LOGE(TAG, "");
         ESP_LOGE(TAG, "Next steps:");
@@ -2149,106 +3117,17 @@ bool ShellyBLEManager::connectDevice(const String& address) {
         if (wasContinuous) startContinuousScan(); else if (wasScanning) startScan(30);
         return false;
     }
-
-    ESP_LOGI(TAG, "");
-    ESP_LOGI(TAG, "✓ Reconnected successfully after %d attempt(s)!",
-             connected ? maxAttempts - (maxAttempts - 1) : maxAttempts);
-    ESP_LOGI(TAG, "  Final address: %s", newAddress.c_str());
-    ESP_LOGI(TAG, "  Final type: %s", newType == BLE_ADDR_PUBLIC ? "PUBLIC" : "RANDOM");
-    ESP_LOGI(TAG, "  MTU: %d bytes", pClient->getMTU());
-    ESP_LOGI(TAG, "");
-
-    // Service Discovery (neue Variable für zweiten Discovery)
-    std::vector<NimBLERemoteService*> services2 = pClient->getServices(true);
-
-    if (services2.empty()) {
-        ESP_LOGE(TAG, "✗ No services found");
-        pClient->disconnect();
-        NimBLEDevice::deleteClient(pClient);
-        if (wasContinuous) startContinuousScan(); else if (wasScanning) startScan(30);
-        return false;
-    }
-    
-    // ========================================================================
-    // BINDKEY AUSLESEN
-    // ========================================================================
-    
-    ESP_LOGI(TAG, "╔═══════════════════════════════════╗");
-    ESP_LOGI(TAG, "║   READ ENCRYPTION KEY (BINDKEY)   ║");
-    ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
-    ESP_LOGI(TAG, "");
-    
-    NimBLEUUID keyUUID(GATT_UUID_ENCRYPTION_KEY);
-    NimBLERemoteCharacteristic* pKeyChar = nullptr;
-    
-    for (auto* pService : services2) {
-        pKeyChar = pService->getCharacteristic(keyUUID);
-        if (pKeyChar) {
-            ESP_LOGI(TAG, "✓ Encryption Key characteristic found");
-            break;
-        }
-    }
-    
-    String bindkey = "";
-    
-    if (pKeyChar && pKeyChar->canRead()) {
-        ESP_LOGI(TAG, "→ Reading encryption key...");
-        
-        std::string val = pKeyChar->readValue();
-        
-        if (val.length() == 16) {
-            for (size_t i = 0; i < val.length(); i++) {
-                char hex[3];
-                snprintf(hex, sizeof(hex), "%02x", (uint8_t)val[i]);
-                bindkey += hex;
-            }
-            ESP_LOGI(TAG, "");
-            ESP_LOGI(TAG, "✓ Bindkey read successfully!");
-            ESP_LOGI(TAG, "  Bindkey: %s", bindkey.c_str());
-        } else {
-            ESP_LOGE(TAG, "✗ Invalid bindkey length: %d (expected 16)", val.length());
-            
-            if (val.length() > 0) {
-                String hexDump = "";
-                for (size_t i = 0; i < val.length(); i++) {
-                    char hex[3];
-                    snprintf(hex, sizeof(hex), "%02x", (uint8_t)val[i]);
-                    hexDump += hex;
-                    if (i < val.length() - 1) hexDump += " ";
-                }
-                ESP_LOGE(TAG, "  Received: %s", hexDump.c_str());
-            }
-        }
-    } else {
-        ESP_LOGE(TAG, "✗ Encryption Key characteristic not found or not readable!");
-    }
-    
-    ESP_LOGI(TAG, "");
-    
-    // ========================================================================
-    // DISCONNECT
-    // ========================================================================
-    
-    ESP_LOGI(TAG, "→ Disconnecting...");
-    pClient->disconnect();
-    
-    retries = 0;
-    while (pClient->isConnected() && retries < 20) {
-        vTaskDelay(pdMS_TO_TICKS(100));
-        retries++;
-    }
-    
-    NimBLEDevice::deleteClient(pClient);
-    ESP_LOGI(TAG, "✓ Disconnected");
-    ESP_LOGI(TAG, "");
     
     // ========================================================================
     // SPEICHERN & STATE UPDATE
     // ========================================================================
     
-    if (bindkey.length() == 32) {
-        pairedDevice.address = newAddress;
-        pairedDevice.bindkey = bindkey;
+    if (bindkey.isSet()) {
+        // add() mit neuem Bindkey verwirft CCM-Kontext und Replay-Fenster
+        PairedShellyDevice* dev = registry.find(address);
+        ShellySensorRole role = dev ? dev->role : roleFromName(targetName);
+        registry.add(address, targetName.length() > 0 ? targetName : String("Unknown"),
+                     bindkey, role, newType);
         savePairedDevice();
         
         updateDeviceState(STATE_CONNECTED_ENCRYPTED);
@@ -2258,9 +3137,10 @@ bool ShellyBLEManager::connectDevice(const String& address) {
         ESP_LOGI(TAG, "║  ✓ PHASE 2 COMPLETE               ║");
         ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
         ESP_LOGI(TAG, "");
-        ESP_LOGI(TAG, "Device: %s (%s)", pairedDevice.name.c_str(), newAddress.c_str());
-        ESP_LOGI(TAG, "Status: ENCRYPTED");
-        ESP_LOGI(TAG, "Bindkey: %s", bindkey.c_str());
+        ESP_LOGI(TAG, "Device: %s (%s)", targetName.c_str(), address.c_str());
+        ESP_LOGI(TAG, "Status: ENCRYPTED (%u ms, %d reconnect attempt(s))",
+                 millis() - flowStart, attempts);
+        ESP_LOGI(TAG, "Bindkey: %s", bindkey.toHex().c_str());
         ESP_LOGI(TAG, "");
         ESP_LOGI(TAG, "✓ Device is now sending ENCRYPTED BTHome v2 advertisements");
         ESP_LOGI(TAG, "  Advertisements have Device Info = 0x41 (encrypted flag set)");
@@ -2363,8 +3243,8 @@ bool ShellyBLEManager::factoryResetDevice(const String& address) {
     if (success) {
         ESP_LOGI(TAG, "✓ Factory reset successful");
         
-        if (isPaired() && pairedDevice.address == address) {
-            unpairDevice();
+        if (isPaired(address)) {
+            unpairDevice(address);
             ESP_LOGI(TAG, "  → Pairing removed from manager");
         }
     } else {
@@ -2381,15 +3261,16 @@ bool ShellyBLEManager::readDeviceConfig(const String& address, DeviceConfig& con
     
     config.valid = false;
     
-    uint8_t beaconMode = 0;
-    uint8_t angleThreshold = 0;
+    GattOp ops[] = {
+        GattOp::read(GATT_UUID_BEACON_MODE),
+        GattOp::read(GATT_UUID_ANGLE_THRESHOLD),
+    };
     
-    bool success = readGattCharacteristic(address, GATT_UUID_BEACON_MODE, beaconMode);
-    success &= readGattCharacteristic(address, GATT_UUID_ANGLE_THRESHOLD, angleThreshold);
+    bool success = runGattTransaction(address, ops, sizeof(ops) / sizeof(ops[0]));
     
     if (success) {
-        config.beaconModeEnabled = (beaconMode != 0);
-        config.angleThreshold = angleThreshold;
+        config.beaconModeEnabled = (ops[0].value != 0);
+        config.angleThreshold = ops[1].value;
         config.valid = true;
         
         ESP_LOGI(TAG, "✓ Configuration read successfully");
@@ -2402,128 +3283,98 @@ bool ShellyBLEManager::readDeviceConfig(const String& address, DeviceConfig& con
     return success;
 }
 
-// ============================================================================
-// GATT Helper Functions
-// ============================================================================
-
-bool ShellyBLEManager::writeGattCharacteristic(const String& address, const String& uuid, uint8_t value) {
-    ESP_LOGI(TAG, "→ Writing GATT characteristic...");
-    ESP_LOGI(TAG, "  UUID: %s", uuid.c_str());
-    ESP_LOGI(TAG, "  Value: %d", value);
-    
-    NimBLEClient* pClient = NimBLEDevice::createClient();
-    if (!pClient) {
-        ESP_LOGE(TAG, "✗ Failed to create BLE client");
-        return false;
-    }
-
-    pClient->setConnectTimeout(10000);
-    
-    std::string stdAddress = address.c_str();
-    NimBLEAddress bleAddr(stdAddress, BLE_ADDR_RANDOM);
-    if (!pClient->connect(bleAddr, false)) {
-        ESP_LOGE(TAG, "✗ Connection failed");
-        NimBLEDevice::deleteClient(pClient);
-        return false;
-    }
-    
-    ESP_LOGI(TAG, "✓ Connected");
-    
-    NimBLERemoteCharacteristic* pChar = nullptr;
-    NimBLEUUID targetUUID(uuid.c_str());
-
-    auto services = pClient->getServices(true);
-    
-    for (auto* service : services) {
-        pChar = service->getCharacteristic(targetUUID);
-        if (pChar) break;
-    }
-    
-    if (!pChar) {
-        ESP_LOGE(TAG, "✗ Characteristic not found");
-        pClient->disconnect();
-        NimBLEDevice::deleteClient(pClient);
-        return false;
-    }
+bool ShellyBLEManager::writeDeviceConfig(const String& address, const DeviceConfig& config) {
+    ESP_LOGI(TAG, "═══════════════════════════════════");
+    ESP_LOGI(TAG, "  WRITE DEVICE CONFIGURATION");
+    ESP_LOGI(TAG, "═══════════════════════════════════");
+    ESP_LOGI(TAG, "Target: %s", address.c_str());
     
-    if (!pChar->canWrite() && !pChar->canWriteNoResponse()) {
-        ESP_LOGE(TAG, "✗ Characteristic not writable");
-        pClient->disconnect();
-        NimBLEDevice::deleteClient(pClient);
+    if (config.angleThreshold > 180) {
+        ESP_LOGE(TAG, "✗ Invalid threshold: %d° (max: 180°)", config.angleThreshold);
         return false;
     }
     
-    bool success = pChar->writeValue(&value, 1, false);
+    GattOp ops[] = {
+        GattOp::write(GATT_UUID_BEACON_MODE, config.beaconModeEnabled ? 1 : 0),
+        GattOp::write(GATT_UUID_ANGLE_THRESHOLD, config.angleThreshold),
+    };
     
-    pClient->disconnect();
-    NimBLEDevice::deleteClient(pClient);
+    bool success = runGattTransaction(address, ops, sizeof(ops) / sizeof(ops[0]));
     
     if (success) {
-        ESP_LOGI(TAG, "✓ Write successful");
+        ESP_LOGI(TAG, "✓ Configuration written (one connection)");
+        ESP_LOGI(TAG, "  Beacon Mode: %s", config.beaconModeEnabled ? "ENABLED" : "DISABLED");
+        ESP_LOGI(TAG, "  Angle Threshold: %d°", config.angleThreshold);
     } else {
-        ESP_LOGE(TAG, "✗ Write failed");
+        ESP_LOGE(TAG, "✗ Failed to write configuration (beacon %s, angle %s)",
+                 ops[0].ok ? "OK" : "FAILED", ops[1].ok ? "OK" : "FAILED");
     }
     
     return success;
 }
 
+// ============================================================================
+// GATT Helper Functions
+// ============================================================================
+
+bool ShellyBLEManager::writeGattCharacteristic(const String& address, const String& uuid, uint8_t value) {
+    GattOp op = GattOp::write(uuid.c_str(), value);
+    return runGattTransaction(address, &op, 1);
+}
+
 bool ShellyBLEManager::readGattCharacteristic(const String& address, const String& uuid, uint8_t& value) {
-    ESP_LOGI(TAG, "→ Reading GATT characteristic...");
-    ESP_LOGI(TAG, "  UUID: %s", uuid.c_str());
-    
-    NimBLEClient* pClient = NimBLEDevice::createClient();
-    if (!pClient) {
-        ESP_LOGE(TAG, "✗ Failed to create BLE client");
+    GattOp op = GattOp::read(uuid.c_str());
+    if (!runGattTransaction(address, &op, 1)) {
         return false;
     }
+    value = op.value;
+    return true;
+}
 
-    pClient->setConnectTimeout(10000);
+bool ShellyBLEManager::runGattTransaction(const String& address, GattOp* ops, size_t count) {
+    ESP_LOGI(TAG, "→ GATT transaction: %s (%d ops)", address.c_str(), (int)count);
     
-    std::string stdAddress = address.c_str();
-    NimBLEAddress bleAddr(stdAddress, BLE_ADDR_RANDOM);
-    if (!pClient->connect(bleAddr, false)) {
-        ESP_LOGE(TAG, "✗ Connection failed");
-        NimBLEDevice::deleteClient(pClient);
-        return false;
+    if (count == 0) {
+        return true;
     }
     
-    NimBLERemoteCharacteristic* pChar = nullptr;
-    NimBLEUUID targetUUID(uuid.c_str());
-
-    auto services = pClient->getServices(true);
-    
-    for (auto* service : services) {
-        pChar = service->getCharacteristic(targetUUID);
-        if (pChar) break;
+    if (!ensureBLEStarted()) {
+        ESP_LOGE(TAG, "✗ BLE unavailable");
+        return false;
     }
     
-    if (!pChar) {
-        ESP_LOGE(TAG, "✗ Characteristic not found");
-        pClient->disconnect();
-        NimBLEDevice::deleteClient(pClient);
-        return false;
+    // Bestehende Verbindung (z.B. aus Phase 1) wiederverwenden - Discovery ist dort gecacht
+    if (activeSession.isConnectedTo(address)) {
+        ESP_LOGI(TAG, "  Using active connection (age: %u ms)", activeSession.age());
+        return activeSession.run(ops, count) == count;
     }
     
-    if (!pChar->canRead()) {
-        ESP_LOGE(TAG, "✗ Characteristic not readable");
-        pClient->disconnect();
-        NimBLEDevice::deleteClient(pClient);
-        return false;
+    // Scan stoppen: NimBLE kann nicht gleichzeitig scannen und verbinden.
+    // manualStop=true verhindert den Auto-Restart während der Transaktion.
+    bool wasContinuous = continuousScan;
+    bool wasScanning = scanning || (bleScanner && bleScanner->is_scanning());
+    if (wasScanning) {
+        stopScan(true);
     }
     
-    std::string data = pChar->readValue();
+    GattSession session;
+    prepareSession(session);
     
-    pClient->disconnect();
-    NimBLEDevice::deleteClient(pClient);
+    size_t succeeded = 0;
     
-    if (data.length() >= 1) {
-        value = (uint8_t)data[0];
-        ESP_LOGI(TAG, "✓ Read successful: %d", value);
-        return true;
+    if (session.open(address, lookupAddressType(address, BLE_ADDR_RANDOM))) {
+        succeeded = session.run(ops, count);
+        session.close();
     } else {
-        ESP_LOGE(TAG, "✗ Read failed: no data");
-        return false;
+        ESP_LOGE(TAG, "✗ Connection failed");
+        for (size_t i = 0; i < count; i++) {
+            ops[i].ok = false;
+        }
     }
+    
+    if (wasContinuous) startContinuousScan(); else if (wasScanning) startScan(30);
+    
+    return succeeded == count;
 }
 
 // ============================================================================
@@ -2539,38 +3390,36 @@ bool ShellyBLEManager::readSampleBTHomeData(const String& address, ShellyBLESens
     ESP_LOGI(TAG, "Target: %s", address.c_str());
     
     // Check if paired
-    if (!isPaired() || pairedDevice.address != address) {
+    if (!isPaired(address)) {
         ESP_LOGE(TAG, "✗ Device not paired or wrong address");
         ESP_LOGI(TAG, "");
         return false;
     }
     
+    if (!ensureBLEStarted()) {
+        ESP_LOGE(TAG, "✗ Failed to start BLE");
+        return false;
+    }
+    
     // Check if active connection exists
-    NimBLEClient* pClient = nullptr;
-    bool needsCleanup = false;
+    GattSession tempSession;
+    GattSession* session = nullptr;
     // Declare in outer scope so all exit paths (after connection block) can use them
     bool wasContinuous = false;
     bool wasScanning = false;
     
-    if (activeClient && activeClient->isConnected()) {
-        String connectedAddr = String(activeClient->getPeerAddress().toString().c_str());
-        if (connectedAddr.equalsIgnoreCase(address)) {
-            uint32_t age = millis() - activeClientTimestamp;
-            if (age < 60000) {  // Connection younger than 1 minute
-                pClient = activeClient;
-                ESP_LOGI(TAG, "✓ Using existing connection (age: %u ms)", age);
-            } else {
-                ESP_LOGW(TAG, "⚠ Connection too old, will reconnect");
-                closeActiveConnection();
-            }
+    if (activeSession.isOpen()) {
+        if (activeSession.isConnectedTo(address) && activeSession.age() < GATT_SESSION_REUSE_MS) {
+            session = &activeSession;
+            ESP_LOGI(TAG, "✓ Using existing connection (age: %u ms)", activeSession.age());
         } else {
-            ESP_LOGW(TAG, "⚠ Wrong device connected, disconnecting");
+            ESP_LOGW(TAG, "⚠ Active connection unusable (other device, lost or too old)");
             closeActiveConnection();
         }
     }
     
     // Create new connection if needed
-    if (!pClient) {
+    if (!session) {
         ESP_LOGI(TAG, "→ Creating new GATT connection...");
 
         // Stop scanning if active.
@@ -2581,136 +3430,44 @@ bool ShellyBLEManager::readSampleBTHomeData(const String& address, ShellyBLESens
         if (wasScanning) {
             ESP_LOGI(TAG, "  → Stopping scan...");
             stopScan(true);
-            vTaskDelay(pdMS_TO_TICKS(500));
         }
 
-        pClient = NimBLEDevice::createClient();
-        if (!pClient) {
-            ESP_LOGE(TAG, "✗ Failed to create client");
-            if (wasContinuous) startContinuousScan(); else if (wasScanning) startScan(30);
-            ESP_LOGI(TAG, "");
-            return false;
-        }
-        
-        pClient->setConnectTimeout(15000);
+        prepareSession(tempSession);
         
-        // Get address type from discovered devices
-        uint8_t addressType = BLE_ADDR_RANDOM;
-        for (const auto& dev : discoveredDevices) {
-            if (dev.address.equalsIgnoreCase(address)) {
-                addressType = dev.addressType;
-                break;
-            }
-        }
-        
-        ESP_LOGI(TAG, "  → Connecting to %s (%s)...", 
-                 address.c_str(),
-                 addressType == BLE_ADDR_PUBLIC ? "PUBLIC" : "RANDOM");
-        
-        NimBLEAddress bleAddr(address.c_str(), addressType);
-        bool connected = pClient->connect(bleAddr, false);
-        
-        if (!connected) {
-            // Try alternative address type
-            uint8_t altType = (addressType == BLE_ADDR_PUBLIC) ? BLE_ADDR_RANDOM : BLE_ADDR_PUBLIC;
-            ESP_LOGI(TAG, "  → Trying %s address...",
-                     altType == BLE_ADDR_PUBLIC ? "PUBLIC" : "RANDOM");
-            
-            bleAddr = NimBLEAddress(address.c_str(), altType);
-            connected = pClient->connect(bleAddr, false);
-        }
-        
-        if (!connected) {
+        if (!tempSession.open(address, lookupAddressType(address, BLE_ADDR_RANDOM),
+                              { 15000, GATT_CONNECT_ATTEMPTS })) {
             ESP_LOGE(TAG, "✗ Connection failed");
-            NimBLEDevice::deleteClient(pClient);
             if (wasContinuous) startContinuousScan(); else if (wasScanning) startScan(30);
             ESP_LOGI(TAG, "");
             return false;
         }
 
-        needsCleanup = true;
+        session = &tempSession;
         ESP_LOGI(TAG, "✓ Connected");
-        ESP_LOGI(TAG, "  MTU: %d bytes", pClient->getMTU());
-    }
-    
-    ESP_LOGI(TAG, "");
-    
-    // Get services
-    ESP_LOGI(TAG, "→ Discovering services...");
-    std::vector<NimBLERemoteService*> services = pClient->getServices(true);
-    
-    if (services.empty()) {
-        ESP_LOGE(TAG, "✗ No services found");
-        if (needsCleanup) {
-            pClient->disconnect();
-            NimBLEDevice::deleteClient(pClient);
-        }
-        if (wasContinuous) startContinuousScan(); else if (wasScanning) startScan(30);
-        ESP_LOGI(TAG, "");
-        return false;
+        ESP_LOGI(TAG, "  MTU: %d bytes", tempSession.mtu());
     }
     
-    ESP_LOGI(TAG, "✓ Found %d services", services.size());
     ESP_LOGI(TAG, "");
     
-    // Find "Sample BTHome data" characteristic
-    ESP_LOGI(TAG, "→ Looking for 'Sample BTHome data' characteristic...");
-    ESP_LOGI(TAG, "  UUID: d52246df-98ac-4d21-be1b-70d5f66a5ddb");
+    // Read "Sample BTHome data" characteristic (Discovery ist gecacht)
+    ESP_LOGI(TAG, "→ Reading 'Sample BTHome data' characteristic...");
+    ESP_LOGI(TAG, "  UUID: %s", GATT_UUID_SAMPLE_BTHOME_DATA);
     
-    NimBLEUUID sampleDataUUID("d52246df-98ac-4d21-be1b-70d5f66a5ddb");
-    NimBLERemoteCharacteristic* pChar = nullptr;
+    std::string rawData;
+    bool readSuccess = session->read(GATT_UUID_SAMPLE_BTHOME_DATA, rawData);
     
-    for (auto* pService : services) {
-        pChar = pService->getCharacteristic(sampleDataUUID);
-        if (pChar) {
-            ESP_LOGI(TAG, "✓ Characteristic found in service: %s", 
-                     pService->getUUID().toString().c_str());
-            break;
-        }
-    }
+    // Eigene Verbindung sofort freigeben; die Phase-1-Verbindung bleibt offen
+    tempSession.close();
+    if (wasContinuous) startContinuousScan(); else if (wasScanning) startScan(30);
     
-    if (!pChar) {
-        ESP_LOGE(TAG, "✗ 'Sample BTHome data' characteristic not found!");
+    if (!readSuccess) {
+        ESP_LOGE(TAG, "✗ 'Sample BTHome data' read failed (%s)",
+                 gattStepName(session->failedStep()));
         ESP_LOGE(TAG, "");
         ESP_LOGE(TAG, "Possible reasons:");
         ESP_LOGE(TAG, "  • Device not bonded (Phase 1 incomplete)");
         ESP_LOGE(TAG, "  • Firmware doesn't support this characteristic");
         ESP_LOGE(TAG, "  • Service discovery incomplete");
-
-        if (needsCleanup) {
-            pClient->disconnect();
-            NimBLEDevice::deleteClient(pClient);
-        }
-        if (wasContinuous) startContinuousScan(); else if (wasScanning) startScan(30);
-        ESP_LOGI(TAG, "");
-        return false;
-    }
-
-    // Check if readable
-    if (!pChar->canRead()) {
-        ESP_LOGE(TAG, "✗ Characteristic not readable!");
-        if (needsCleanup) {
-            pClient->disconnect();
-            NimBLEDevice::deleteClient(pClient);
-        }
-        if (wasContinuous) startContinuousScan(); else if (wasScanning) startScan(30);
-        ESP_LOGI(TAG, "");
-        return false;
-    }
-    
-    ESP_LOGI(TAG, "");
-    
-    // Read the data
-    ESP_LOGI(TAG, "→ Reading Sample BTHome data...");
-    std::string rawData = pChar->readValue();
-    
-    if (rawData.length() == 0) {
-        ESP_LOGW(TAG, "✗ No data received (length = 0)");
-        if (needsCleanup) {
-            pClient->disconnect();
-            NimBLEDevice::deleteClient(pClient);
-        }
-        if (wasContinuous) startContinuousScan(); else if (wasScanning) startScan(30);
         ESP_LOGI(TAG, "");
         return false;
     }
@@ -2734,7 +3491,7 @@ bool ShellyBLEManager::readSampleBTHomeData(const String& address, ShellyBLESens
     data.rssi = 0;  // RSSI not available in GATT read
     
     bool parseSuccess = parseBTHomePacket((uint8_t*)rawData.data(), rawData.length(),
-                                        "", address, data);  // Empty bindkey = unencrypted
+                                        nullptr, data);  // No device = unencrypted only
     
     if (parseSuccess) {
         ESP_LOGI(TAG, "");
@@ -2761,6 +3518,7 @@ bool ShellyBLEManager::readSampleBTHomeData(const String& address, ShellyBLESens
         
         data.dataValid = true;
         data.lastUpdate = millis();
+        data.confidence = SensorStateConfidence::LIVE;
         
     } else {
         ESP_LOGW(TAG, "");
@@ -2768,25 +3526,6 @@ bool ShellyBLEManager::readSampleBTHomeData(const String& address, ShellyBLESens
         ESP_LOGW(TAG, "  Raw data might not be in BTHome format");
     }
     
-    // Cleanup
-    if (needsCleanup) {
-        ESP_LOGI(TAG, "");
-        ESP_LOGI(TAG, "→ Disconnecting...");
-        pClient->disconnect();
-
-        uint8_t retries = 0;
-        while (pClient->isConnected() && retries < 20) {
-            vTaskDelay(pdMS_TO_TICKS(100));
-            retries++;
-        }
-
-        NimBLEDevice::deleteClient(pClient);
-        ESP_LOGI(TAG, "✓ Disconnected");
-    }
-
-    // Restore scan state after GATT operation
-    if (wasContinuous) startContinuousScan(); else if (wasScanning) startScan(30);
-
     ESP_LOGI(TAG, "");
 
     return parseSuccess;
@@ -2798,146 +3537,98 @@ bool ShellyBLEManager::readSampleBTHomeData(const String& address, ShellyBLESens
 // ═══════════════════════════════════════════════════════════════════════
 
 void ShellyBLEManager::updateDiscoveredDevice(
-    const String& address, 
-    const String& name, 
+    uint64_t mac,
+    const char* name, 
     int8_t rssi,
     bool isEncrypted,
-    uint64_t addressUint64,
     uint8_t addressType) {
     
-    bool found = false;
-    for (auto& dev : discoveredDevices) {
-        if (dev.address == address) {
-            dev.rssi = rssi;
-            dev.lastSeen = millis();
-            dev.isEncrypted = isEncrypted;
-            dev.addressType = addressType;
-            found = true;
-            break;
-        }
-    }
+    bool added = false;
+    discoveredDevices.update(mac, name, rssi, isEncrypted, addressType, &added);
     
-    if (!found) {
-        ShellyBLEDevice device;
-        device.address = address;
-        device.name = name;
-        device.rssi = rssi;
-        device.isEncrypted = isEncrypted;
-        device.lastSeen = millis();
-        device.addressType = addressType;
-        
-        discoveredDevices.push_back(device);
-        
-        ESP_LOGI(TAG, "✓ Added to discovered devices (total: %d)", 
-                 discoveredDevices.size());
+    if (added) {
+        ESP_LOGI(TAG, "✓ Added to discovered devices (total: %d/%d)", 
+                 (int)discoveredDevices.count(), BLE_MAX_DISCOVERED_DEVICES);
     }
 }
 
 
 void ShellyBLEManager::cleanupOldDiscoveries() {
-    uint32_t now = millis();
-    const uint32_t timeout = 300000;  // 5 minutes
-    
-    for (auto it = discoveredDevices.begin(); it != discoveredDevices.end(); ) {
-        if (now - it->lastSeen > timeout) {
-            ESP_LOGI(TAG, "Removing stale discovery: %s", it->address.c_str());
-            it = discoveredDevices.erase(it);
-        } else {
-            ++it;
-        }
-    }
-}
-
-NimBLERemoteCharacteristic* ShellyBLEManager::findCharacteristic(
-    std::vector<NimBLERemoteService*>& services,
-    const String& uuid) {
-    
-    NimBLEUUID targetUUID(uuid.c_str());
-    
-    for (auto* pService : services) {
-        NimBLERemoteCharacteristic* pChar = pService->getCharacteristic(targetUUID);
-        if (pChar) {
-            return pChar;
-        }
-    }
-    
-    return nullptr;
+    discoveredDevices.expire(BLE_DISCOVERY_TIMEOUT_MS);
 }
 
 // ═══════════════════════════════════════════════════════════════════════
 // Pairing (Simple)
 // ═══════════════════════════════════════════════════════════════════════
 
-bool ShellyBLEManager::pairDevice(const String& address, const String& bindkey) {
+bool ShellyBLEManager::pairDevice(const String& address, const ShellyBindkey& bindkey) {
+    // Rolle aus dem Gerätenamen ableiten (SBBT-* → Button, sonst Fensterkontakt)
+    const ShellyBLEDevice* dev = discoveredDevices.find(address);
+    String name = dev ? dev->name : "";
+    
+    return pairDevice(address, bindkey, roleFromName(name));
+}
+
+bool ShellyBLEManager::pairDevice(const String& address, const ShellyBindkey& bindkey,
+                                  ShellySensorRole role) {
     ESP_LOGI(TAG, "═══════════════════════════════════");
     ESP_LOGI(TAG, "    BLE PAIRING INITIATED");
     ESP_LOGI(TAG, "═══════════════════════════════════");
     
-    if (isPaired()) {
+    if (isPaired(address)) {
+        const PairedShellyDevice* existing = registry.find(address);
         ESP_LOGE(TAG, "✗ ABORT: Device already paired!");
         ESP_LOGE(TAG, "  Current device: %s (%s)", 
-                 pairedDevice.name.c_str(), pairedDevice.address.c_str());
-        ESP_LOGI(TAG, "  → Unpair first before pairing a new device");
+                 existing->name.c_str(), existing->address.c_str());
+        ESP_LOGI(TAG, "  → Unpair first before pairing it again");
         return false;
     }
     
-    ESP_LOGI(TAG, "Target device: %s", address.c_str());
-    
-    // Find device in discovered list
-    String name = "Unknown";
-    bool found = false;
-    for (const auto& dev : discoveredDevices) {
-        if (dev.address == address) {
-            name = dev.name;
-            found = true;
-            ESP_LOGI(TAG, "✓ Device found in scan results");
-            ESP_LOGI(TAG, "  Name: %s", name.c_str());
-            ESP_LOGI(TAG, "  RSSI: %d dBm", dev.rssi);
-            ESP_LOGI(TAG, "  Encrypted: %s", dev.isEncrypted ? "YES" : "NO");
-            break;
-        }
+    if (registry.isFull()) {
+        ESP_LOGE(TAG, "✗ ABORT: Sensor registry full (%d/%d)",
+                 (int)registry.count(), BLE_MAX_PAIRED_DEVICES);
+        ESP_LOGI(TAG, "  → Unpair a sensor before pairing a new one");
+        return false;
     }
     
-    if (!found) {
+    ESP_LOGI(TAG, "Target device: %s", address.c_str());
+    ESP_LOGI(TAG, "Role: %s", sensorRoleToString(role));
+    
+    // Find device in discovered list
+    String name = "Unknown";
+    const ShellyBLEDevice* discovered = discoveredDevices.find(address);
+    if (discovered) {
+        name = discovered->name;
+        ESP_LOGI(TAG, "✓ Device found in scan results");
+        ESP_LOGI(TAG, "  Name: %s", name.c_str());
+        ESP_LOGI(TAG, "  RSSI: %d dBm (avg %d)", discovered->rssi, discovered->rssiAvg);
+        ESP_LOGI(TAG, "  Encrypted: %s", discovered->isEncrypted ? "YES" : "NO");
+    } else {
         ESP_LOGW(TAG, "⚠ Device NOT found in recent scan");
         ESP_LOGW(TAG, "  Will pair anyway, but connection might fail");
     }
     
-    // Validate bindkey if provided
-    if (bindkey.length() > 0) {
-        if (bindkey.length() != 32) {
-            ESP_LOGE(TAG, "✗ INVALID BINDKEY LENGTH");
-            ESP_LOGE(TAG, "  Expected: 32 hex characters");
-            ESP_LOGE(TAG, "  Got: %d characters", bindkey.length());
-            return false;
-        }
-        
-        for (size_t i = 0; i < bindkey.length(); i++) {
-            char c = bindkey[i];
-            if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))) {
-                ESP_LOGE(TAG, "✗ INVALID BINDKEY CHARACTER at position %d: '%c'", i, c);
-                return false;
-            }
-        }
-        
-        ESP_LOGI(TAG, "✓ Bindkey validation passed");
-        ESP_LOGI(TAG, "  Bindkey: %s", bindkey.c_str());
+    // Hex-Validierung passiert beim Parsen (ShellyBindkey::fromHex)
+    if (bindkey.isSet()) {
+        ESP_LOGI(TAG, "✓ Bindkey provided (16 bytes)");
     } else {
         ESP_LOGI(TAG, "ℹ No bindkey provided (unencrypted device)");
     }
     
     // Store paired device
-    pairedDevice.address = address;
-    pairedDevice.name = name;
-    pairedDevice.bindkey = bindkey;
-    pairedDevice.sensorData = ShellyBLESensorData();
+    uint8_t addressType = discovered ? discovered->addressType : BLE_ADDR_RANDOM;
+    
+    if (!registry.add(address, name, bindkey, role, addressType)) {
+        ESP_LOGE(TAG, "✗ Invalid address: %s", address.c_str());
+        return false;
+    }
     
     savePairedDevice();
     
     ESP_LOGI(TAG, "═══════════════════════════════════");
     ESP_LOGI(TAG, "✓ PAIRING SUCCESSFUL");
     ESP_LOGI(TAG, "  Device: %s (%s)", name.c_str(), address.c_str());
-    ESP_LOGI(TAG, "  Encryption: %s", bindkey.length() > 0 ? "ENABLED" : "DISABLED");
+    ESP_LOGI(TAG, "  Encryption: %s", bindkey.isSet() ? "ENABLED" : "DISABLED");
     ESP_LOGI(TAG, "═══════════════════════════════════");
     
     return true;
@@ -2978,17 +3669,55 @@ bool ShellyBLEManager::unpairDevice() {
     ESP_LOGI(TAG, "✓ Device unpaired successfully");
     
     // ════════════════════════════════════════════════════════════════════
-    // OPTIONAL: BLE herunterfahren wenn kein Device mehr gepairt
+    // Kein Sensor mehr → NimBLE freigeben (nächster Scan startet ihn neu)
     // ════════════════════════════════════════════════════════════════════
     
     ESP_LOGI(TAG, "");
-    ESP_LOGI(TAG, "→ No paired device remaining");
-    ESP_LOGI(TAG, "  BLE will stay active (for future pairing)");
-    ESP_LOGI(TAG, "  To save power, restart device");
+    ESP_LOGI(TAG, "→ No paired device remaining - releasing BLE stack");
+    shutdownBLE();
+    ESP_LOGI(TAG, "");
+    
+    return true;
+}
+
+bool ShellyBLEManager::unpairDevice(const String& address) {
+    PairedShellyDevice* dev = registry.find(address);
+    if (!dev) {
+        ESP_LOGW(TAG, "Device %s not paired", address.c_str());
+        return false;
+    }
+    
+    // Letzter Sensor → kompletter Unpair-Pfad (Scan stoppen, NVS löschen)
+    if (registry.count() == 1) {
+        return unpairDevice();
+    }
+    
+    ESP_LOGI(TAG, "");
+    ESP_LOGI(TAG, "╔═══════════════════════════════════╗");
+    ESP_LOGI(TAG, "║      UNPAIRING SENSOR             ║");
+    ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
     ESP_LOGI(TAG, "");
+    ESP_LOGI(TAG, "Device: %s (%s)", dev->name.c_str(), dev->address.c_str());
+    
+    if (activeSession.isConnectedTo(address)) {
+        closeActiveConnection();
+    }
+    
+    // Whitelist kann nur bei gestopptem Scan geändert werden
+    bool wasContinuous = continuousScan;
+    if (scanning) {
+        stopScan(true);
+    }
+    
+    registry.remove(dev->mac);
+    savePairedDevice();
+    updateDeviceState(getDeviceState());
+    
+    ESP_LOGI(TAG, "✓ Sensor removed (%d remaining)", (int)registry.count());
     
-    // Alternative: BLE komplett herunterfahren
-    // shutdownBLE();
+    if (wasContinuous) {
+        startContinuousScan();
+    }
     
     return true;
 }
@@ -3003,7 +3732,7 @@ ShellyBLEManager::DeviceState ShellyBLEManager::getDeviceState() const {
         return STATE_NOT_PAIRED;
     }
     
-    if (pairedDevice.bindkey.length() > 0) {
+    if (getPairedDevice().bindkey.isSet()) {
         return STATE_CONNECTED_ENCRYPTED;
     }
     
@@ -3043,11 +3772,60 @@ const char* ShellyBLEManager::stateToString(DeviceState state) const {
 // ═══════════════════════════════════════════════════════════════════════
 
 bool ShellyBLEManager::getSensorData(ShellyBLESensorData& data) const {
-    if (!isPaired() || !pairedDevice.sensorData.dataValid) {
+    if (!isPaired()) {
+        return false;
+    }
+    
+    return getSensorData(getPairedDevice().address, data);
+}
+
+bool ShellyBLEManager::getSensorData(const String& address, ShellyBLESensorData& data) const {
+    const PairedShellyDevice* dev = registry.find(address);
+    if (!dev) {
+        return false;
+    }
+    
+    taskENTER_CRITICAL(&sensorDataLock);
+    ShellyBLESensorData copy = dev->sensorData;
+    taskEXIT_CRITICAL(&sensorDataLock);
+    
+    if (!copy.dataValid) {
+        return false;
+    }
+    
+    data = copy;
+    return true;
+}
+
+bool ShellyBLEManager::getSensorDataByRole(ShellySensorRole role, String& address,
+                                           ShellyBLESensorData& data) const {
+    const PairedShellyDevice* dev = registry.findByRole(role);
+    if (!dev || !getSensorData(dev->address, data)) {
+        return false;
+    }
+    
+    address = dev->address;
+    return true;
+}
+
+bool ShellyBLEManager::getRestoredSensorState(ShellySensorRole role, String& address,
+                                              ShellyBLESensorData& data) const {
+    const PairedShellyDevice* dev = registry.findByRole(role);
+    if (!dev) {
+        return false;
+    }
+    
+    taskENTER_CRITICAL(&sensorDataLock);
+    ShellyBLESensorData copy = dev->sensorData;
+    taskEXIT_CRITICAL(&sensorDataLock);
+    
+    if (copy.confidence != SensorStateConfidence::RESTORED &&
+        copy.confidence != SensorStateConfidence::UNCERTAIN) {
         return false;
     }
     
-    data = pairedDevice.sensorData;
+    address = dev->address;
+    data = copy;
     return true;
 }
 
@@ -3078,28 +3856,30 @@ uint32_t ShellyBLEManager::getPasskey() {
 // ═══════════════════════════════════════════════════════════════════════
 
 void ShellyBLEManager::closeActiveConnection() {
-    if (activeClient) {
+    if (activeSession.isOpen()) {
         ESP_LOGI(TAG, "→ Closing active GATT connection...");
-        
-        if (activeClient->isConnected()) {
-            activeClient->disconnect();
-            
-            uint32_t wait_start = millis();
-            while (activeClient->isConnected() && (millis() - wait_start < 2000)) {
-                vTaskDelay(pdMS_TO_TICKS(100));
-            }
-        }
-        
-        NimBLEDevice::deleteClient(activeClient);
-        activeClient = nullptr;
-        
+        activeSession.close();
         ESP_LOGI(TAG, "✓ Connection closed and cleaned up");
     }
+}
+
+void ShellyBLEManager::prepareSession(GattSession& session) {
+    // Bonding, kein MITM, Secure Connections - Just Works
+    NimBLEDevice::setSecurityAuth(true, false, true);
+    NimBLEDevice::setSecurityIOCap(BLE_HS_IO_NO_INPUT_OUTPUT);
     
-    if (activeClientCallbacks) {
-        delete activeClientCallbacks;
-        activeClientCallbacks = nullptr;
+    session.setDisconnectHook([this](const String& address, int /*reason*/) {
+        recentConnections[address] = millis();
+    });
+}
+
+uint8_t ShellyBLEManager::lookupAddressType(const String& address, uint8_t fallback) const {
+    if (const ShellyBLEDevice* dev = discoveredDevices.find(address)) {
+        return dev->addressType;
     }
+    
+    const PairedShellyDevice* paired = registry.find(address);
+    return paired ? paired->addressType : fallback;
 }
         
 // ============================================================================
@@ -3107,8 +3887,7 @@ void ShellyBLEManager::closeActiveConnection() {
 // ============================================================================
 
 bool ShellyBLEManager::parseBTHomePacket(const uint8_t* data, size_t length,
-                                         const String& bindkey, 
-                                         const String& macAddress,
+                                         PairedShellyDevice* device,
                                          ShellyBLESensorData& sensorData) {
     
     // ════════════════════════════════════════════════════════════════════
@@ -3116,7 +3895,8 @@ bool ShellyBLEManager::parseBTHomePacket(const uint8_t* data, size_t length,
     // ════════════════════════════════════════════════════════════════════
     
     if (length < 2) {
-        ESP_LOGW(TAG, "Packet too short: %d bytes", length);
+        ADV_LOGW("Packet too short: %d bytes", length);
+        if (device) device->advStats.parseFailures++;
         return false;
     }
     
@@ -3128,7 +3908,7 @@ bool ShellyBLEManager::parseBTHomePacket(const uint8_t* data, size_t length,
     bool encrypted = (deviceInfo & 0x01) != 0;
     uint8_t bthomeVersion = (deviceInfo >> 5) & 0x07;
     
-    ESP_LOGI(TAG, "BTHome Packet: %d bytes, %s, v%d", 
+    ADV_LOGI("BTHome Packet: %d bytes, %s, v%d", 
              length,
              encrypted ? "Encrypted" : "Unencrypted",
              bthomeVersion);
@@ -3142,20 +3922,24 @@ bool ShellyBLEManager::parseBTHomePacket(const uint8_t* data, size_t length,
     uint8_t decryptedBuffer[256];
     
     if (encrypted) {
-        if (bindkey.length() != 32) {
-            ESP_LOGW(TAG, "Encrypted packet but no valid bindkey (len=%d)", bindkey.length());
+        mbedtls_ccm_context* ccm = device ? registry.cryptoContext(*device) : nullptr;
+        if (!ccm) {
+            ADV_LOGW("Encrypted packet but no valid bindkey (%s)",
+                     device ? "CCM setup failed" : "unknown device");
+            if (device) device->advStats.decryptFailures++;
             return false;
         }
         
-        ESP_LOGI(TAG, "→ Decrypting...");
+        ADV_LOGI("→ Decrypting...");
         size_t decryptedLen = 0;
         
-        if (!decryptBTHome(data, length, bindkey, macAddress, decryptedBuffer, decryptedLen)) {
-            ESP_LOGE(TAG, "✗ Decryption failed");
+        if (!bthomeDecrypt(data, length, ccm, device->mac, decryptedBuffer, decryptedLen)) {
+            ADV_LOGE("✗ Decryption failed");
+            device->advStats.decryptFailures++;
             return false;
         }
         
-        ESP_LOGI(TAG, "✓ Decrypted: %d bytes", decryptedLen);
+        ADV_LOGI("✓ Decrypted: %d bytes", decryptedLen);
         payload = decryptedBuffer + 1;  // Skip device info byte
         payloadLength = decryptedLen - 1;
         
@@ -3169,74 +3953,8 @@ bool ShellyBLEManager::parseBTHomePacket(const uint8_t* data, size_t length,
     // Parse BTHome Objects
     // ════════════════════════════════════════════════════════════════════
     
-    size_t offset = 0;
-    bool hasData = false;
-    sensorData.hasButtonEvent = false;
-    
-    while (offset < payloadLength) {
-        if (offset >= payloadLength) break;
-        
-        uint8_t objectId = payload[offset++];
-        size_t objectLen = getBTHomeObjectLength(objectId);
-        
-        if (objectLen == 0) {
-            ESP_LOGW(TAG, "Unknown Object ID: 0x%02X at offset %d", objectId, offset - 1);
-            break;
-        }
-        
-        if (offset + objectLen > payloadLength) {
-            ESP_LOGW(TAG, "Insufficient data for Object 0x%02X", objectId);
-            break;
-        }
-        
-        // Parse specific objects
-        switch (objectId) {
-            case BTHOME_OBJ_PACKET_ID:
-                sensorData.packetId = payload[offset];
-                hasData = true;
-                break;
-                
-            case BTHOME_OBJ_BATTERY:
-                sensorData.battery = payload[offset];
-                hasData = true;
-                break;
-                
-            case BTHOME_OBJ_ILLUMINANCE: {
-                uint32_t lux_raw = payload[offset] | 
-                                  (payload[offset+1] << 8) | 
-                                  (payload[offset+2] << 16);
-                sensorData.illuminance = lux_raw / 100;
-                hasData = true;
-                break;
-            }
-            
-            case BTHOME_OBJ_WINDOW:
-                sensorData.windowOpen = (payload[offset] != 0);
-                hasData = true;
-                break;
-                
-            case BTHOME_OBJ_BUTTON: {
-                uint16_t btnValue = payload[offset] | (payload[offset+1] << 8);
-                sensorData.buttonEvent = static_cast<ShellyButtonEvent>(btnValue & 0xFF);
-                sensorData.hasButtonEvent = true;
-                hasData = true;
-                break;
-            }
-            
-            case BTHOME_OBJ_ROTATION: {
-                int16_t rot_raw = payload[offset] | (payload[offset+1] << 8);
-                sensorData.rotation = rot_raw / 10;
-                hasData = true;
-                break;
-            }
-            
-            default:
-                ESP_LOGD(TAG, "Skipping Object 0x%02X", objectId);
-                break;
-        }
-        
-        offset += objectLen;
-    }
+    // Tabellengesteuert: bthome_device_class.cpp kennt Längen + Ziel-Felder
+    bool hasData = bthomeDecodeObjects(payload, payloadLength, sensorData);
     
     // ════════════════════════════════════════════════════════════════════
     // Update Encryption Status & Store Results
@@ -3247,25 +3965,25 @@ bool ShellyBLEManager::parseBTHomePacket(const uint8_t* data, size_t length,
         sensorData.wasEncrypted = encrypted;
         
         // Update paired device encryption status
-        if (isPaired() && pairedDevice.address.equalsIgnoreCase(macAddress)) {
-            bool previousStatus = pairedDevice.isCurrentlyEncrypted;
-            pairedDevice.isCurrentlyEncrypted = encrypted;
+        if (device) {
+            bool previousStatus = device->isCurrentlyEncrypted;
+            device->isCurrentlyEncrypted = encrypted;
             
             // Log only if status changed
             if (previousStatus != encrypted) {
-                ESP_LOGI(TAG, "Encryption status changed: %s → %s",
+                ADV_LOGI("Encryption status changed: %s → %s",
                          previousStatus ? "Encrypted" : "Unencrypted",
                          encrypted ? "Encrypted" : "Unencrypted");
             }
             
             // Warn if mismatch detected
-            if (pairedDevice.bindkey.length() > 0 && !encrypted) {
-                ESP_LOGW(TAG, "⚠ Device has bindkey but sends unencrypted data!");
+            if (device->bindkey.isSet() && !encrypted) {
+                ADV_LOGW("⚠ Device has bindkey but sends unencrypted data!");
             }
         }
         
         // Log parsed data summary
-        ESP_LOGI(TAG, "✓ Parsed: Battery=%d%%, Window=%s, Illuminance=%dlux, Rotation=%d°",
+        ADV_LOGI("✓ Parsed: Battery=%d%%, Window=%s, Illuminance=%dlux, Rotation=%d°",
                  sensorData.battery,
                  sensorData.windowOpen ? "OPEN" : "CLOSED",
                  sensorData.illuminance,
@@ -3281,322 +3999,22 @@ bool ShellyBLEManager::parseBTHomePacket(const uint8_t* data, size_t length,
                 case BUTTON_HOLD: btnName = "HOLD"; break;
                 default: btnName = "UNKNOWN"; break;
             }
-            ESP_LOGI(TAG, "  Button: %s", btnName);
+            ADV_LOGI("  Button: %s", btnName);
         }
     } else {
-        ESP_LOGW(TAG, "No valid data parsed from packet");
+        ADV_LOGW("No valid data parsed from packet");
+        if (device) device->advStats.parseFailures++;
     }
     
     return hasData;
 }
 
-// ════════════════════════════════════════════════════════════════════════
-// BTHome Object Length Helper
-// ════════════════════════════════════════════════════════════════════════
-
-size_t ShellyBLEManager::getBTHomeObjectLength(uint8_t objectId) {
-    switch (objectId) {
-        case 0x00:  // Packet ID
-        case 0x01:  // Battery
-        case 0x2D:  // Window/Door
-            return 1;
-        
-        case 0x3A:  // Button
-        case 0x3F:  // Rotation
-            return 2;
-        
-        case 0x05:  // Illuminance
-            return 3;
-        
-        default:
-            return 0;  // Unknown object
-    }
-}
-
-
-// ============================================================================
-// AES-CCM Decryption (BTHome v2)
-// ============================================================================
-
-bool ShellyBLEManager::decryptBTHome(const uint8_t* encryptedData, size_t length,
-                                     const String& bindkey, 
-                                     const String& macAddress,
-                                     uint8_t* decrypted,
-                                     size_t& decryptedLen) {
-    
-    // ════════════════════════════════════════════════════════════════════
-    // Input Validation
-    // ════════════════════════════════════════════════════════════════════
-    
-    if (length < 13) {  // Min: 1 DevInfo + 4 Counter + 4 Payload + 4 MIC
-        ESP_LOGW(TAG, "Encrypted packet too short: %d bytes (min 13)", length);
-        return false;
-    }
-    
-    if (bindkey.length() != 32) {
-        ESP_LOGE(TAG, "Invalid bindkey length: %d (expected 32)", bindkey.length());
-        return false;
-    }
-    
-    // ════════════════════════════════════════════════════════════════════
-    // Parse Packet Structure
-    // ════════════════════════════════════════════════════════════════════
-    
-    uint8_t deviceInfo = encryptedData[0];
-    const uint8_t* counter = encryptedData + 1;
-    const uint8_t* payload = encryptedData + 5;
-    size_t payloadLen = length - 9;  // Total - (1 DevInfo + 4 Counter + 4 MIC)
-    const uint8_t* mic = encryptedData + length - 4;
-    
-    // ════════════════════════════════════════════════════════════════════
-    // Parse Bindkey (Hex String → Bytes)
-    // ════════════════════════════════════════════════════════════════════
-    
-    uint8_t key[16];
-    for (int i = 0; i < 16; i++) {
-        char hex[3] = {bindkey[i*2], bindkey[i*2+1], 0};
-        key[i] = (uint8_t)strtol(hex, NULL, 16);
-    }
-    
-    // ════════════════════════════════════════════════════════════════════
-    // Parse MAC Address
-    // ════════════════════════════════════════════════════════════════════
-    
-    uint8_t mac[6];
-    if (!parseMacAddress(macAddress, mac)) {
-        ESP_LOGE(TAG, "Invalid MAC address format: %s", macAddress.c_str());
-        return false;
-    }
-    
-    // ════════════════════════════════════════════════════════════════════
-    // Build Nonce (BTHome v2 Standard: 13 bytes)
-    // ════════════════════════════════════════════════════════════════════
-    
-    uint8_t nonce[13];
-    
-    // MAC reversed (Little-Endian)
-    for (int i = 0; i < 6; i++) {
-        nonce[i] = mac[5 - i];
-    }
-    
-    // UUID 0xFCD2 in Little-Endian
-    nonce[6] = 0xD2;
-    nonce[7] = 0xFC;
-    
-    // Device Info WITHOUT encryption flag
-    nonce[8] = deviceInfo & 0xFE;
-    
-    // Counter (already Little-Endian)
-    memcpy(nonce + 9, counter, 4);
-    
-    // ════════════════════════════════════════════════════════════════════
-    // AES-CCM Decryption (mbedTLS)
-    // ════════════════════════════════════════════════════════════════════
-    
-    mbedtls_ccm_context ctx;
-    mbedtls_ccm_init(&ctx);
-    
-    int ret = mbedtls_ccm_setkey(&ctx, MBEDTLS_CIPHER_ID_AES, key, 128);
-    if (ret != 0) {
-        ESP_LOGE(TAG, "CCM setkey failed: -0x%04X", -ret);
-        mbedtls_ccm_free(&ctx);
-        return false;
-    }
-    
-    // Decrypt with AAD (Additional Authenticated Data = Device Info byte)
-    ret = mbedtls_ccm_auth_decrypt(
-        &ctx,
-        payloadLen,              // Ciphertext length
-        nonce, 13,               // Nonce (13 bytes)
-        &deviceInfo, 1,          // AAD: Device Info byte WITH encryption flag
-        payload,                 // Input: encrypted payload
-        decrypted + 1,           // Output: decrypted payload (skip first byte)
-        mic, 4                   // MIC/Tag (4 bytes)
-    );
-    
-    mbedtls_ccm_free(&ctx);
-    
-    // ════════════════════════════════════════════════════════════════════
-    // Handle Result
-    // ════════════════════════════════════════════════════════════════════
-    
-    if (ret != 0) {
-        ESP_LOGE(TAG, "CCM decrypt failed: -0x%04X", -ret);
-        
-        if (ret == MBEDTLS_ERR_CCM_AUTH_FAILED) {
-            ESP_LOGE(TAG, "  → Authentication failed (MIC mismatch)");
-            ESP_LOGE(TAG, "  → Wrong bindkey or corrupted packet");
-        }
-        
-        return false;
-    }
-    
-    // Success: Build output (Device Info without encryption flag + decrypted payload)
-    decrypted[0] = deviceInfo & 0xFE;
-    decryptedLen = payloadLen + 1;
-    
-    return true;
-}
-
-
-bool ShellyBLEManager::parseMacAddress(const String& macStr, uint8_t* mac) {
-    if (macStr.length() != 17) {
-        ESP_LOGE(TAG, "Invalid MAC length: %d (expected 17)", macStr.length());
-        return false;
-    }
-    
-    for (int i = 0; i < 6; i++) {
-        if (i < 5 && macStr[i*3 + 2] != ':') {
-            ESP_LOGE(TAG, "Invalid MAC format at position %d (expected ':')", i*3 + 2);
-            return false;
-        }
-        
-        char hex[3] = {macStr[i*3], macStr[i*3+1], 0};
-        
-        for (int j = 0; j < 2; j++) {
-            char c = hex[j];
-            if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))) {
-                ESP_LOGE(TAG, "Invalid hex character in MAC: '%c' at position %d", c, i*3 + j);
-                return false;
-            }
-        }
-        
-        mac[i] = (uint8_t)strtol(hex, NULL, 16);
-    }
-    
-    return true;
-}
-
-// ═══════════════════════════════════════════════════════════════════════
-// PairingCallbacks Implementation
-// ═══════════════════════════════════════════════════════════════════════
-
-void ShellyBLEManager::PairingCallbacks::onConnect(NimBLEClient* pClient) {
-    ESP_LOGI(TAG, "");
-    ESP_LOGI(TAG, "╔═══════════════════════════════════╗");
-    ESP_LOGI(TAG, "║  CLIENT CONNECTED                 ║");
-    ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
-    ESP_LOGI(TAG, "");
-    ESP_LOGI(TAG, "Peer: %s", pClient->getPeerAddress().toString().c_str());
-    ESP_LOGI(TAG, "MTU: %d bytes", pClient->getMTU());
-    ESP_LOGI(TAG, "");
-    // NOTE: Do NOT call updateConnParams() here.
-    // Changing connection parameters during the initial setup phase (before MTU
-    // exchange and pairing are complete) causes the Shelly device to disconnect
-    // and makes connect() return false even though the link was physically established.
-}
-
-void ShellyBLEManager::PairingCallbacks::onDisconnect(NimBLEClient* pClient, int reason) {
-    String address = pClient->getPeerAddress().toString().c_str();
-    manager->recentConnections[address] = millis();
-    
-    ESP_LOGI(TAG, "");
-    ESP_LOGI(TAG, "╔═══════════════════════════════════╗");
-    ESP_LOGI(TAG, "║  CLIENT DISCONNECTED              ║");
-    ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
-    ESP_LOGI(TAG, "");
-    ESP_LOGI(TAG, "Reason: 0x%02X", reason);
-    
-    switch(reason) {
-        case 0x08: ESP_LOGI(TAG, "  Connection timeout"); break;
-        case 0x13: ESP_LOGI(TAG, "  Remote terminated"); break;
-        case 0x16: ESP_LOGI(TAG, "  Local terminated"); break;
-        case 0x3E: ESP_LOGI(TAG, "  Connection failed"); break;
-        default: ESP_LOGI(TAG, "  Other (0x%02X)", reason);
-    }
-    
-    ESP_LOGI(TAG, "");
-}
-
-bool ShellyBLEManager::PairingCallbacks::onConnParamsUpdateRequest(
-    NimBLEClient* pClient, const ble_gap_upd_params* params) {
-    
-    ESP_LOGI(TAG, "→ Conn params update request");
-    ESP_LOGI(TAG, "  Interval: %d-%d", params->itvl_min, params->itvl_max);
-    ESP_LOGI(TAG, "  Latency: %d", params->latency);
-    ESP_LOGI(TAG, "  Timeout: %d", params->supervision_timeout);
-    
-    return true;
-}
-
-void ShellyBLEManager::PairingCallbacks::onAuthenticationComplete(NimBLEConnInfo& connInfo) {
-    ESP_LOGI(TAG, "");
-    ESP_LOGI(TAG, "╔═══════════════════════════════════╗");
-    ESP_LOGI(TAG, "║  AUTHENTICATION COMPLETE          ║");
-    ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
-    ESP_LOGI(TAG, "");
-    
-    ESP_LOGI(TAG, "Security Status:");
-    ESP_LOGI(TAG, "  Encrypted:     %s", connInfo.isEncrypted() ? "YES ✓" : "NO ✗");
-    ESP_LOGI(TAG, "  Bonded:        %s", connInfo.isBonded() ? "YES ✓" : "NO ✗");
-    ESP_LOGI(TAG, "  Authenticated: %s", connInfo.isAuthenticated() ? "YES ✓" : "NO ✗");
-    ESP_LOGI(TAG, "  Key Size:      %d bytes", connInfo.getSecKeySize());
-    ESP_LOGI(TAG, "");
-    
-    pairingComplete = true;
-    pairingSuccess = connInfo.isBonded() && connInfo.isEncrypted();
-    
-    if (!connInfo.isAuthenticated()) {
-        ESP_LOGW(TAG, "⚠ BONDING INCOMPLETE!");
-        ESP_LOGW(TAG, "  → Not authenticated");
-    }
-    
-    ESP_LOGI(TAG, "");
-    ESP_LOGI(TAG, "✓ BONDING %s!", pairingSuccess ? "SUCCESSFUL" : "FAILED");
-    ESP_LOGI(TAG, "");
-}
-
-void ShellyBLEManager::PairingCallbacks::onPassKeyEntry(NimBLEConnInfo& connInfo) {
-    ESP_LOGW(TAG, "");
-    ESP_LOGW(TAG, "╔═══════════════════════════════════╗");
-    ESP_LOGW(TAG, "║  PASSKEY ENTRY REQUESTED          ║");
-    ESP_LOGW(TAG, "╚═══════════════════════════════════╝");
-    ESP_LOGW(TAG, "");
-    ESP_LOGW(TAG, "⚠ Should NOT happen with Just Works!");
-    ESP_LOGW(TAG, "");
-    ESP_LOGW(TAG, "→ Injecting passkey: 0");
-    
-    NimBLEDevice::injectPassKey(connInfo, 0);
-    
-    ESP_LOGW(TAG, "✓ Injected");
-    ESP_LOGW(TAG, "");
-}
-
-void ShellyBLEManager::PairingCallbacks::onConfirmPasskey(
-    NimBLEConnInfo& connInfo, uint32_t pass_key) {
-    
-    ESP_LOGI(TAG, "");
-    ESP_LOGI(TAG, "╔═══════════════════════════════════╗");
-    ESP_LOGI(TAG, "║  PASSKEY CONFIRMATION             ║");
-    ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
-    ESP_LOGI(TAG, "");
-    ESP_LOGI(TAG, "Passkey: %06u", pass_key);
-    ESP_LOGI(TAG, "");
-    ESP_LOGI(TAG, "⚠ Numeric Comparison mode");
-    ESP_LOGI(TAG, "  (Should NOT happen with Just Works)");
-    ESP_LOGI(TAG, "");
-    ESP_LOGI(TAG, "→ Confirming via injectConfirmPasskey()...");
-    
-    NimBLEDevice::injectConfirmPasskey(connInfo, true);
-    
-    ESP_LOGI(TAG, "✓ Confirmed");
-    ESP_LOGI(TAG, "");
-}
-
 // ════════════════════════════════════════════════════════════════════════
 // Static: Check if ANY Device is Paired (without starting BLE)
 // ════════════════════════════════════════════════════════════════════════
 
 bool ShellyBLEManager::hasAnyPairedDevice() {
-    Preferences prefs;
-    if (!prefs.begin("ShellyBLE", true)) {  // Read-only
-        return false;
-    }
-    
-    String address = prefs.getString("address", "");
-    prefs.end();
-    
-    bool hasPaired = (address.length() > 0);
+    bool hasPaired = ShellySensorRegistry::hasStoredDevices();
     
     ESP_LOGI(TAG, "Static check: %s device in NVS", 
              hasPaired ? "FOUND" : "NO");
@@ -3625,6 +4043,11 @@ void ShellyBLEManager::logMemoryStats(const char* location) {
     ESP_LOGI(TAG, "║ Min Free (ever):   %6u bytes    ║", min_free_heap);
     ESP_LOGI(TAG, "║ Largest Block:     %6u bytes    ║", largest_block);
     ESP_LOGI(TAG, "║ Total Allocated:   %6u bytes    ║", info.total_allocated_bytes);
+    if (NimBLEDevice::isInitialized()) {
+        ESP_LOGI(TAG, "║ NimBLE Stack:      %6u bytes    ║", bleStackHeapBytes);
+    } else {
+        ESP_LOGI(TAG, "║ NimBLE Stack:      released        ║");
+    }
     ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
     
     if (free_heap < 20000) {
@@ -19,10 +19,30 @@
 #include <NimBLEDevice.h>
 #include <NimBLEClient.h>
 
+// AES-CCM Kontext pro Sensor (BTHome v2 Decryption)
+#include <mbedtls/ccm.h>
+
+// Sensor-Record, Replay-Filter, AES-CCM (ohne Arduino/NimBLE, läuft auch auf dem Host)
+#include "bthome_packet.h"
+
+// Geräteklassen + BTHome Objekt-Tabelle
+#include "bthome_device_class.h"
+
+// Rohdaten-Capture der Advertisements (Diagnose, Download per HTTP)
+#include "ble_capture.h"
+
+// Ereignisgesteuerte GATT-Verbindung (Pairing, Konfiguration)
+#include "gatt_session.h"
+
 // Task Stack Sizes
 #define BLE_AUTOSTART_TASK_STACK_SIZE  (4096)   // 4KB — only calls startScan(), no NimBLE client ops
 #define BLE_RESTART_TASK_STACK_SIZE    (4096)   // 4KB — only calls startScan(), no NimBLE client ops
 
+// NimBLE Stack (lazy: erst beim ersten Scan/Pairing, freigegeben ohne gepairte Sensoren)
+#define BLE_DEVICE_NAME                "BeltWinder"
+#define BLE_STACK_MIN_FREE_HEAP        48000    // Controller + Host + Reserve
+#define BLE_SCANNER_MIN_FREE_HEAP      20000
+
 // BTHome Constants
 #define BTHOME_SERVICE_UUID "fcd2"
 #define BTHOME_UUID_UINT16  0xFCD2
@@ -35,13 +55,58 @@
 #define GATT_UUID_ANGLE_THRESHOLD       "86e7cc43-19f4-4f38-b5ad-1ae586237e2a"
 #define GATT_UUID_SAMPLE_BTHOME_DATA    "d52246df-98ac-4d21-be1b-70d5f66a5ddb"
 
-// BTHome Object IDs
-#define BTHOME_OBJ_PACKET_ID    0x00
-#define BTHOME_OBJ_BATTERY      0x01
-#define BTHOME_OBJ_ILLUMINANCE  0x05
-#define BTHOME_OBJ_WINDOW       0x2D
-#define BTHOME_OBJ_BUTTON       0x3A
-#define BTHOME_OBJ_ROTATION     0x3F
+// GATT Pairing Flow (obere Grenzen - es geht weiter, sobald das Ereignis kommt)
+#define GATT_WAKEUP_SCAN_MS             2500     // endet beim ersten ADV des Ziels
+#define GATT_SESSION_REUSE_MS           60000    // Phase-1-Verbindung für Phase 2 nutzbar
+#define GATT_REBOOT_DISCONNECT_MS       3000     // Sensor trennt nach Passkey-Write selbst
+#define GATT_REBOOT_CONNECT_MS          6000     // Connect pro Versuch (wartet auf ADV)
+#define GATT_REBOOT_ATTEMPTS            5
+
+// Sensor Registry
+#define BLE_MAX_PAIRED_DEVICES     4        // z.B. Tür + Fenster + BLU Button pro Rolladen
+#define BLE_REGISTRY_INDEX_SIZE    8        // Hash-Index (Zweierpotenz, > MAX_PAIRED_DEVICES)
+#define BLE_REGISTRY_NVS_KEY       "registry"
+#define BLE_REGISTRY_VERSION       1
+
+// Discovery-Tabelle (feste Größe, kein Heap während des Scans)
+#define BLE_MAX_DISCOVERED_DEVICES 16       // Älteste Einträge werden verdrängt
+#define BLE_DISCOVERY_INDEX_SIZE   32       // Hash-Index (Zweierpotenz, > MAX_DISCOVERED_DEVICES)
+#define BLE_DISCOVERY_NAME_LEN     24       // "SBDW-002C-XXXXXX" + Reserve
+#define BLE_DISCOVERY_TIMEOUT_MS   300000   // 5 Minuten ohne ADV → entfernen
+#define BLE_DISCOVERY_RSSI_SHIFT   2        // EWMA: avg += (rssi - avg) / 4
+
+// Scan Profiles
+// Discovery: aktiv (SCAN_REQ für Namen), ohne Filter - nur während Pairing/Suche
+// Paired:    passiv, Controller-Whitelist der gepairten MACs - Host sieht nur Sensoren
+#define BLE_DISCOVERY_SCAN_INTERVAL_MS  300
+#define BLE_DISCOVERY_SCAN_WINDOW_MS    100
+#define BLE_PAIRED_SCAN_INTERVAL_MS     160      // Window = Interval × adaptiver Duty Cycle
+#define BLE_SCAN_RATE_WINDOW_MS         60000    // Messfenster für Host-Events/min
+
+// Adaptive Duty Cycle (Paired-Profil)
+#define BLE_SCAN_TARGET_MISS_PERMILLE   20       // Ziel: < 2% verpasste BTHome-Pakete
+#define BLE_SCAN_DUTY_MIN_PERCENT       20
+#define BLE_SCAN_DUTY_MAX_PERCENT       90       // 10% bleiben immer für Wi-Fi/Matter
+#define BLE_SCAN_DUTY_STEP_UP           15       // Schnell hoch bei Verlusten
+#define BLE_SCAN_DUTY_STEP_DOWN         5        // Langsam runter
+#define BLE_SCAN_ADAPT_MIN_SAMPLES      16       // Neue Pakete pro Anpassungsschritt
+#define BLE_ADV_MAX_PACKET_ID_GAP       64       // Größere Lücke = Sensor-Neustart, kein Verlust
+
+// Link-Qualität / Stale-Alarm
+#define BLE_LINK_HIST_BUCKETS           8        // Inter-Arrival: <2s, <4s, … <128s, ≥128s
+#define BLE_LINK_STALE_FACTOR           3        // Heartbeat überfällig = 3× gelernte Kadenz
+#define BLE_LINK_STALE_MIN_MS           90000    // Untergrenze (Ereignis-Bursts drücken die Kadenz)
+#define BLE_LINK_STALE_DEFAULT_MS       900000   // Solange noch keine Kadenz gelernt ist
+#define BLE_LINK_STALE_CHECK_MS         5000
+
+// Letzter Sensorzustand über Reboots
+// RTC: überlebt Soft-Reset/Panic/WDT, Systemzeit läuft weiter → Alter bekannt
+// NVS: überlebt Stromausfall, Alter unbekannt (Systemzeit startet bei 0)
+#define BLE_STATE_NVS_KEY               "last_state"
+#define BLE_STATE_VERSION               1
+#define BLE_STATE_TRUST_MS              600000   // Restore jünger als 10 min gilt als gültig
+#define BLE_STATE_NVS_MIN_INTERVAL_MS   30000    // Fensterwechsel: max. alle 30 s ins Flash
+#define BLE_STATE_NVS_REFRESH_MS        3600000  // Sonstige Felder (Batterie, Lux): max. 1×/h
 
 // ═══════════════════════════════════════════════════════════════════════
 // RAII-KLASSEN FÜR NIMBLE CLIENT MANAGEMENT
@@ -141,57 +206,254 @@ private:
 // Data Structures
 // ═══════════════════════════════════════════════════════════════════════
 
-enum ShellyButtonEvent {
-    BUTTON_NONE = 0,
-    BUTTON_SINGLE_PRESS = 0x01,
-    BUTTON_DOUBLE_PRESS = 0x02,
-    BUTTON_TRIPLE_PRESS = 0x03,
-    BUTTON_LONG_PRESS = 0x04,
-    BUTTON_LONG_DOUBLE_PRESS = 0x05,
-    BUTTON_LONG_TRIPLE_PRESS = 0x06,
-    BUTTON_HOLD = 0x8001
-};
-
-struct ShellyBLESensorData {
-    uint8_t packetId;
-    uint8_t battery;
-    uint32_t illuminance;
-    bool windowOpen;
-    int16_t rotation;
-    int8_t rssi;
-    
-    bool hasButtonEvent;
-    ShellyButtonEvent buttonEvent;
-    
-    uint32_t lastUpdate;
-    bool dataValid;
-    bool wasEncrypted; 
-    
-    ShellyBLESensorData() : 
-        packetId(0), battery(0), illuminance(0), windowOpen(false),
-        rotation(0), rssi(0), hasButtonEvent(false),
-        buttonEvent(BUTTON_NONE), lastUpdate(0), dataValid(false), wasEncrypted(false) {}
-};
+const char* sensorStateConfidenceToString(SensorStateConfidence confidence);
 
+/**
+ * @brief Eintrag der Discovery-Tabelle (POD, inline MAC + Name)
+ */
 struct ShellyBLEDevice {
-    String address;
-    String name;
-    int8_t rssi;
+    uint64_t mac;                               // MSB zuerst, wie get_address_uint64()
+    char name[BLE_DISCOVERY_NAME_LEN + 1];
+    int8_t rssi;                                // letzter Wert
+    int8_t rssiAvg;                             // EWMA
     bool isEncrypted;
-    uint32_t lastSeen;
     uint8_t addressType;
-    ShellyBLESensorData sensorData;
+    uint32_t lastSeen;
+    
+    // "AA:BB:CC:DD:EE:FF" (out: mind. 18 Bytes)
+    void formatAddress(char* out) const;
+    String address() const;
+};
+
+/**
+ * @brief Gelernte Advertising-Kadenz eines Sensors
+ *
+ * Shelly BLU sendet pro Ereignis/Heartbeat einen Burst identischer Pakete
+ * mit derselben Packet ID. Lücken in der Packet ID = komplett verpasste Bursts.
+ */
+struct BTHomeAdvStats {
+    bool hasPacketId;
+    uint8_t lastPacketId;
+    uint32_t lastNewMs;
+    uint32_t avgIntervalMs;     // EWMA Abstand neuer Pakete (Heartbeat/Ereignisse)
+    uint16_t burstCopies;       // Kopien des aktuellen Pakets
+    uint16_t avgBurstX10;       // EWMA Kopien pro Paket × 10
+    
+    uint32_t received;
+    uint32_t missed;
+    uint32_t windowReceived;    // seit letztem Anpassungsschritt
+    uint32_t windowMissed;
+    
+    // Link-Qualität (O(1) pro Paket)
+    int32_t rssiAvgX16;         // EWMA RSSI × 16 über alle Kopien (α = 1/8)
+    uint32_t rssiVarX16;        // EWMA Varianz (dB² × 16)
+    uint32_t decryptFailures;
+    uint32_t parseFailures;
+    uint16_t intervalHist[BLE_LINK_HIST_BUCKETS];  // Abstand neuer Pakete, log2(s)
+    
+    // Stale-Alarm (gesetzt in loop(), gelöscht vom nächsten neuen Paket)
+    bool stale;
+    bool staleReported;
+    uint32_t staleAlarms;
+    
+    BTHomeAdvStats() :
+        hasPacketId(false), lastPacketId(0), lastNewMs(0), avgIntervalMs(0),
+        burstCopies(0), avgBurstX10(0),
+        received(0), missed(0), windowReceived(0), windowMissed(0),
+        rssiAvgX16(0), rssiVarX16(0), decryptFailures(0), parseFailures(0),
+        intervalHist{}, stale(false), staleReported(false), staleAlarms(0) {}
+    
+    int8_t rssiAvg() const { return (int8_t)(rssiAvgX16 / 16); }
+    float rssiStdDev() const { return sqrtf(rssiVarX16 / 16.0f); }
+    
+    // Nach so langer Stille gilt der Sensor als verschwunden
+    uint32_t staleAfterMs() const {
+        if (avgIntervalMs == 0) return BLE_LINK_STALE_DEFAULT_MS;
+        uint32_t ms = avgIntervalMs * BLE_LINK_STALE_FACTOR;
+        return ms < BLE_LINK_STALE_MIN_MS ? BLE_LINK_STALE_MIN_MS : ms;
+    }
+};
+
+const char* sensorRoleToString(ShellySensorRole role);
+bool sensorRoleFromString(const String& str, ShellySensorRole& role);
+
+/**
+ * @brief BTHome v2 Bindkey (AES-128), binär
+ *
+ * Hex nur an der Web-UI-Grenze (fromHex/toHex). Überschreiben, clear() und
+ * Destruktor nullen den Key per mbedtls_platform_zeroize.
+ */
+class ShellyBindkey {
+public:
+    static const size_t SIZE = 16;
+    static const size_t HEX_LEN = SIZE * 2;
+    
+    ShellyBindkey() : set_(false) { memset(bytes_, 0, SIZE); }
+    explicit ShellyBindkey(const uint8_t* key) : ShellyBindkey() { set(key); }
+    ShellyBindkey(const ShellyBindkey& other) : ShellyBindkey() { *this = other; }
+    ShellyBindkey& operator=(const ShellyBindkey& other);
+    ~ShellyBindkey() { clear(); }
+    
+    bool isSet() const { return set_; }
+    const uint8_t* data() const { return bytes_; }
+    
+    void set(const uint8_t* key);
+    void clear();
+    
+    // "" → leer (true), 32 Hex-Zeichen → gesetzt (true), sonst false (Key unverändert)
+    bool fromHex(const char* hex, size_t len);
+    bool fromHex(const String& hex) { return fromHex(hex.c_str(), hex.length()); }
+    
+    // out: mind. HEX_LEN + 1 Bytes, "" wenn nicht gesetzt
+    void toHex(char* out) const;
+    String toHex() const;
+    
+    // Konstante Laufzeit
+    bool operator==(const ShellyBindkey& other) const;
+    bool operator!=(const ShellyBindkey& other) const { return !(*this == other); }
+    
+private:
+    uint8_t bytes_[SIZE];
+    bool set_;
 };
 
 struct PairedShellyDevice {
     String address;
     String name;
-    String bindkey;
+    ShellyBindkey bindkey;
+    uint64_t mac;
     uint8_t addressType;
+    ShellySensorRole role;
     ShellyBLESensorData sensorData;
     bool isCurrentlyEncrypted;
+    BTHomePacketFilter packetFilter;
+    BTHomeAdvStats advStats;
+    
+    PairedShellyDevice() : mac(0), addressType(BLE_ADDR_RANDOM),
+        role(ShellySensorRole::WINDOW_CONTACT), isCurrentlyEncrypted(false) {}
+};
+
+// ═══════════════════════════════════════════════════════════════════════
+// Sensor Registry (feste Kapazität, MAC-indiziert)
+// ═══════════════════════════════════════════════════════════════════════
+
+/**
+ * @brief Registry aller gepairten Sensoren
+ *
+ * Slots sind dicht belegt (0..count-1, Pairing-Reihenfolge). Ein kleiner
+ * Open-Addressing-Index bildet die 48-Bit MAC auf den Slot ab, damit
+ * on_device_found() ohne String-Vergleiche auskommt. Jeder Slot hält einen
+ * eigenen AES-CCM Kontext, der nur bei Bindkey-Änderung neu aufgesetzt wird.
+ * Persistenz: ein einziger NVS-Blob.
+ */
+class ShellySensorRegistry {
+public:
+    ShellySensorRegistry();
+    ~ShellySensorRegistry();
+    
+    ShellySensorRegistry(const ShellySensorRegistry&) = delete;
+    ShellySensorRegistry& operator=(const ShellySensorRegistry&) = delete;
+    
+    size_t count() const { return count_; }
+    bool isFull() const { return count_ >= BLE_MAX_PAIRED_DEVICES; }
+    
+    // Iteration in Pairing-Reihenfolge
+    PairedShellyDevice& operator[](size_t i) { return slots_[i].device; }
+    const PairedShellyDevice& operator[](size_t i) const { return slots_[i].device; }
+    
+    // O(1) Lookup
+    PairedShellyDevice* find(uint64_t mac);
+    const PairedShellyDevice* find(uint64_t mac) const;
+    PairedShellyDevice* find(const String& address);
+    const PairedShellyDevice* find(const String& address) const;
+    const PairedShellyDevice* findByRole(ShellySensorRole role) const;
+    
+    // Insert or update (nullptr wenn voll oder Adresse ungültig)
+    PairedShellyDevice* add(const String& address, const String& name,
+                            const ShellyBindkey& bindkey, ShellySensorRole role,
+                            uint8_t addressType = BLE_ADDR_RANDOM);
+    bool remove(uint64_t mac);
+    void clear();
+    
+    // Bindkey ändern → Crypto-Kontext und Replay-Fenster verwerfen
+    void setBindkey(PairedShellyDevice& device, const ShellyBindkey& bindkey);
+    
+    // Lazily keyed AES-CCM Kontext (nullptr ohne gültigen Bindkey)
+    mbedtls_ccm_context* cryptoContext(const PairedShellyDevice& device);
+    
+    // Persistenz
+    bool load();
+    bool save() const;
+    static bool hasStoredDevices();
+    
+    static bool parseMac(const String& address, uint64_t& mac);
+    
+private:
+    struct Slot {
+        PairedShellyDevice device;
+        mbedtls_ccm_context ccm;
+        bool ccmReady;
+    };
+    
+    Slot slots_[BLE_MAX_PAIRED_DEVICES];
+    size_t count_;
+    int8_t index_[BLE_REGISTRY_INDEX_SIZE];
+    
+    int slotOf(uint64_t mac) const;
+    void rebuildIndex();
+    void resetCrypto(Slot& slot);
+    bool migrateLegacy();
+    
+    static size_t hashMac(uint64_t mac) {
+        uint32_t h = (uint32_t)mac ^ (uint32_t)(mac >> 24);
+        h *= 0x9E3779B1u;
+        return (h >> 24) & (BLE_REGISTRY_INDEX_SIZE - 1);
+    }
+};
+
+/**
+ * @brief Gefundene (noch nicht gepairte) Shelly BLU Geräte
+ *
+ * Feste Kapazität, dicht belegte Slots plus Open-Addressing-Index wie die
+ * Sensor Registry. Ist die Tabelle voll, verdrängt ein neues Gerät den am
+ * längsten nicht gesehenen Eintrag - der Speicherbedarf bleibt konstant,
+ * egal wie viele Geräte in der Umgebung advertisen.
+ */
+class ShellyDiscoveryTable {
+public:
+    ShellyDiscoveryTable();
     
-    PairedShellyDevice() : addressType(BLE_ADDR_RANDOM), isCurrentlyEncrypted(false) {}
+    size_t count() const { return count_; }
+    const ShellyBLEDevice& operator[](size_t i) const { return slots_[i]; }
+    const ShellyBLEDevice* begin() const { return slots_; }
+    const ShellyBLEDevice* end() const { return slots_ + count_; }
+    
+    // O(1) Lookup
+    const ShellyBLEDevice* find(uint64_t mac) const;
+    const ShellyBLEDevice* find(const String& address) const;
+    
+    // Update per MAC; neue Einträge nur mit Namen (name == "" → nur Update).
+    // Liefert nullptr, wenn nichts angelegt/aktualisiert wurde.
+    const ShellyBLEDevice* update(uint64_t mac, const char* name, int8_t rssi,
+                                  bool isEncrypted, uint8_t addressType, bool* added = nullptr);
+    
+    // Entfernt Einträge älter als maxAgeMs, liefert Anzahl
+    size_t expire(uint32_t maxAgeMs);
+    void clear();
+    
+private:
+    ShellyBLEDevice slots_[BLE_MAX_DISCOVERED_DEVICES];
+    size_t count_;
+    int8_t index_[BLE_DISCOVERY_INDEX_SIZE];
+    
+    int slotOf(uint64_t mac) const;
+    void rebuildIndex();
+    
+    static size_t hashMac(uint64_t mac) {
+        uint32_t h = (uint32_t)mac ^ (uint32_t)(mac >> 24);
+        h *= 0x9E3779B1u;
+        return (h >> 24) & (BLE_DISCOVERY_INDEX_SIZE - 1);
+    }
 };
 
 struct DeviceConfig {
@@ -217,6 +479,8 @@ public:
     // Callbacks
     using SensorDataCallback = std::function<void(const String&, const ShellyBLESensorData&)>;
     using StateChangeCallback = std::function<void(DeviceState, DeviceState)>;
+    using StaleSensorCallback = std::function<void(const String& address, bool stale, uint32_t silentMs)>;
+    using ButtonEventCallback = std::function<void(const String& address, ShellySensorRole role, ShellyButtonEvent event)>;
     
     ShellyBLEManager();
     ~ShellyBLEManager();
@@ -242,20 +506,52 @@ public:
     bool isContinuousScanActive() const { return continuousScan && isScanActive(); }
     bool isContinuousScanEnabled() const { return continuousScan; }
     bool isBLEStarted() const { return bleScanner != nullptr; }
+    
+    // Scan Profile (Discovery = offen/aktiv, Paired = Whitelist/passiv)
+    enum ScanProfile {
+        SCAN_PROFILE_DISCOVERY,
+        SCAN_PROFILE_PAIRED
+    };
+    ScanProfile getScanProfile() const { return scanProfile; }
+    const char* getScanProfileName() const {
+        return scanProfile == SCAN_PROFILE_PAIRED ? "paired" : "discovery";
+    }
+    // Advertisements die den Host erreichen (letztes volles Messfenster)
+    uint32_t getScanEventsPerMinute() const { return scanEventsPerMinute; }
+    
+    // Advertisement Capture (RAM-Ring, .bwcap)
+    BLECaptureRing& getCapture() { return capture; }
+    // Adaptiver Duty Cycle (Window/Interval) und gemessene Verlustrate
+    uint8_t getScanDutyPercent() const { return scanDutyPercent; }
+    uint16_t getScanMissRatePermille() const { return scanMissPermille; }
     static bool hasAnyPairedDevice();
     bool ensureBLEStarted();
+    // Scan stoppen, Verbindung schließen, NimBLE deinitialisieren (Speicher zurück)
+    void shutdownBLE();
+    // Heap, den der NimBLE Stack beim letzten Start belegt hat (0 = nicht aktiv)
+    uint32_t getBLEStackHeapBytes() const { return bleStackHeapBytes; }
     String getScanStatus() const;
     void updateDeviceState(DeviceState newState);
     
-    const std::vector<ShellyBLEDevice>& getDiscoveredDevices() const { 
+    const ShellyDiscoveryTable& getDiscoveredDevices() const { 
         return discoveredDevices; 
     }
     
     // Pairing
-    bool pairDevice(const String& address, const String& bindkey = "");
-    bool unpairDevice();
-    bool isPaired() const { return pairedDevice.address.length() > 0; }
-    const PairedShellyDevice& getPairedDevice() const { return pairedDevice; }
+    bool pairDevice(const String& address, const ShellyBindkey& bindkey = ShellyBindkey());
+    bool pairDevice(const String& address, const ShellyBindkey& bindkey, ShellySensorRole role);
+    bool unpairDevice();                         // Alle Sensoren
+    bool unpairDevice(const String& address);    // Einzelner Sensor
+    bool isPaired() const { return registry.count() > 0; }
+    bool isPaired(const String& address) const { return registry.find(address) != nullptr; }
+    
+    // Primärer Sensor: erster Fensterkontakt, sonst erster gepairter Sensor
+    const PairedShellyDevice& getPairedDevice() const;
+    size_t getPairedDeviceCount() const { return registry.count(); }
+    const PairedShellyDevice& getPairedDevice(size_t index) const { return registry[index]; }
+    const PairedShellyDevice* findPairedDevice(const String& address) const {
+        return registry.find(address);
+    }
     void loadPairedDevice();
     
     // Encryption Setup
@@ -266,17 +562,38 @@ public:
     // GATT Configuration
     bool setBeaconMode(const String& address, bool enabled);
     bool setAngleThreshold(const String& address, uint8_t degrees);
+    
+    // Beliebig viele Reads/Writes in EINER Verbindung (eine Discovery).
+    // Ergebnisse stehen in ops[i].ok / ops[i].value; true = alle erfolgreich.
+    bool runGattTransaction(const String& address, GattOp* ops, size_t count);
     bool factoryResetDevice(const String& address);
     bool readDeviceConfig(const String& address, DeviceConfig& config);
+    bool writeDeviceConfig(const String& address, const DeviceConfig& config);
     bool readSampleBTHomeData(const String& address, ShellyBLESensorData& data);
     
-    // Sensor Data
+    // Sensor Data (Kopie unter Lock - Schreiber ist der NimBLE Host Task)
     bool getSensorData(ShellyBLESensorData& data) const;
+    bool getSensorData(const String& address, ShellyBLESensorData& data) const;
+    bool getSensorDataByRole(ShellySensorRole role, String& address,
+                             ShellyBLESensorData& data) const;
+    
+    // Beim Boot wiederhergestellter Zustand - auch UNCERTAIN (dataValid = false),
+    // damit die Sicherheitslogik "zuletzt offen" konservativ übernehmen kann
+    bool getRestoredSensorState(ShellySensorRole role, String& address,
+                                ShellyBLESensorData& data) const;
     DeviceState getDeviceState() const;
     
+    // Link-Qualität aller Sensoren (RSSI, Verluste, Fehler, Inter-Arrival-Histogramm)
+    String getLinkStatsJson() const;
+    
     // Callbacks
     void setSensorDataCallback(SensorDataCallback cb) { sensorDataCallback = cb; }
     void setStateChangeCallback(StateChangeCallback cb) { stateChangeCallback = cb; }
+    // Aus loop(): Heartbeat überfällig (stale = true) bzw. wieder da (false)
+    void setStaleSensorCallback(StaleSensorCallback cb) { staleSensorCallback = cb; }
+    // NimBLE Task, direkt nach dem Decode (vor Logging, Persistenz und
+    // SensorDataCallback) - nur für neue, authentifizierte Pakete
+    void setButtonEventCallback(ButtonEventCallback cb) { buttonEventCallback = cb; }
     
     // Passkey Management
     void savePasskey(uint32_t passkey);
@@ -289,30 +606,13 @@ private:
     // BLE Components
     std::unique_ptr<esp32_ble_simple::SimpleBLEScanner> bleScanner;
     
-    NimBLEClient* activeClient;
-    uint32_t activeClientTimestamp;
+    // Bonded Verbindung aus Phase 1, bleibt für Phase 2 offen
+    GattSession activeSession;
     bool ble_manually_disabled;
     
-    // Pairing Callbacks (vollständige Klassen-Definition)
-    class PairingCallbacks : public NimBLEClientCallbacks {
-    public:
-        PairingCallbacks(ShellyBLEManager* mgr) : manager(mgr), 
-            pairingComplete(false), pairingSuccess(false) {}
-        
-        void onConnect(NimBLEClient* pClient) override;
-        void onDisconnect(NimBLEClient* pClient, int reason) override;
-        bool onConnParamsUpdateRequest(NimBLEClient* pClient, 
-            const ble_gap_upd_params* params) override;
-        void onAuthenticationComplete(NimBLEConnInfo& connInfo) override;
-        void onPassKeyEntry(NimBLEConnInfo& connInfo) override;
-        void onConfirmPasskey(NimBLEConnInfo& connInfo, uint32_t pass_key) override;
-        
-        ShellyBLEManager* manager;
-        bool pairingComplete;
-        bool pairingSuccess;
-    };
-    
-    PairingCallbacks* activeClientCallbacks;
+    // Wake-up Scan: on_device_found() meldet das erste ADV des Ziels
+    SemaphoreHandle_t wakeSignal;
+    volatile uint64_t wakeTargetMac;
     
     // State
     bool initialized;
@@ -320,27 +620,56 @@ private:
     bool continuousScan;
     bool stopOnFirstMatch;
     DeviceState deviceState;
+    ScanProfile scanProfile;
+    
+    // Host Event Rate (geschrieben vom NimBLE Host Task, gelesen in loop())
+    volatile uint32_t scanEventCount;
+    uint32_t scanEventsPerMinute;
+    uint32_t scanRateWindowStart;
+    
+    // Adaptiver Duty Cycle
+    uint8_t scanDutyPercent;
+    uint16_t scanMissPermille;
+    uint32_t lastStaleCheck;
+    
+    // Zustand-Persistenz (RTC sofort, NVS gedrosselt aus loop())
+    volatile bool stateNvsDirty;
+    volatile bool stateWindowChanged;
+    uint32_t lastStateNvsWrite;
+    
+    // Heap-Bilanz des NimBLE Stacks (ensureBLEStarted / shutdownBLE)
+    uint32_t bleStackHeapBytes;
     
     // Data
-    std::vector<ShellyBLEDevice> discoveredDevices;
-    PairedShellyDevice pairedDevice;
+    ShellyDiscoveryTable discoveredDevices;
+    ShellySensorRegistry registry;
+    mutable portMUX_TYPE sensorDataLock;
+    BLECaptureRing capture;
     std::map<String, uint32_t> recentConnections;
     
     // Callbacks
     SensorDataCallback sensorDataCallback;
     StateChangeCallback stateChangeCallback;
+    StaleSensorCallback staleSensorCallback;
+    ButtonEventCallback buttonEventCallback;
     
     // Helper Methods
     void updateDiscoveredDevice(
-        const String& address, 
-        const String& name, 
+        uint64_t mac,
+        const char* name, 
         int8_t rssi,
         bool isEncrypted,
-        uint64_t addressUint64,
         uint8_t addressType
     );
     
     void cleanupOldDiscoveries();
+    bool applyScanProfile(ScanProfile profile);
+    void recordAdvertisement(BTHomeAdvStats& stats, bool duplicate, uint8_t packetId, int8_t rssi);
+    void adaptScanDutyCycle();
+    void checkStaleSensors();
+    void persistSensorState(bool windowChanged);
+    void flushSensorState(bool force);
+    void restoreSensorState();
     const char* stateToString(DeviceState state) const;
     
     // Persistence
@@ -349,39 +678,24 @@ private:
     
     // Connection Management
     void closeActiveConnection();
+    void prepareSession(GattSession& session);
+    uint8_t lookupAddressType(const String& address, uint8_t fallback) const;
     
     // GATT Helpers
     bool writeGattCharacteristic(const String& address, const String& uuid, uint8_t value);
     bool readGattCharacteristic(const String& address, const String& uuid, uint8_t& value);
-    NimBLERemoteCharacteristic* findCharacteristic(
-        std::vector<NimBLERemoteService*>& services,
-        const String& uuid
-    );
     
-    // BTHome Parsing
+    // BTHome Parsing (device == nullptr → nur unverschlüsselte Pakete)
     bool parseBTHomePacket(
         const uint8_t* data, 
         size_t length,
-        const String& bindkey, 
-        const String& macAddress,
+        PairedShellyDevice* device,
         ShellyBLESensorData& sensorData
     );
     
-    size_t getBTHomeObjectLength(uint8_t objectId);
-    
-    // Encryption
-    bool decryptBTHome(
-        const uint8_t* encryptedData, 
-        size_t length,
-        const String& bindkey, 
-        const String& macAddress,
-        uint8_t* decrypted,
-        size_t& decryptedLen
-    );
     
-    bool parseMacAddress(const String& macStr, uint8_t* mac);
     
-    friend class PairingCallbacks;
+    static ShellySensorRole roleFromName(const String& name);
 };
 
 #endif // SHELLY_BLE_MANAGER_H
@@ -0,0 +1,156 @@
+// status_publisher.cpp
+
+#include "status_publisher.h"
+#include "rollershutter.h"
+#include "web_ui_handler.h"
+#include <esp_log.h>
+
+static const char* TAG = "StatusPub";
+
+static const char* window_state_name(WindowState ws) {
+    switch (ws) {
+        case WindowState::PENDING: return "pending";
+        case WindowState::TILTED:  return "tilted";
+        case WindowState::OPEN:    return "open";
+        default:                   return "closed";
+    }
+}
+
+static const char* ble_state_name(ShellyBLEManager::DeviceState state) {
+    switch (state) {
+        case ShellyBLEManager::STATE_CONNECTED_UNENCRYPTED: return "connected_unencrypted";
+        case ShellyBLEManager::STATE_CONNECTED_ENCRYPTED:   return "connected_encrypted";
+        default:                                            return "not_paired";
+    }
+}
+
+StatusPublisher::StatusPublisher(app_driver_handle_t handle, ShellyBLEManager* ble, WebUIHandler* webUI)
+    : handle_(handle),
+      ble_(ble),
+      webUI_(webUI),
+      published_{},
+      havePublished_(false),
+      lastPushMs_(0),
+      lastKeepaliveMs_(0) {
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// Snapshot + Format
+// ═══════════════════════════════════════════════════════════════════════
+
+StatusSnapshot StatusPublisher::sample(app_driver_handle_t handle, ShellyBLEManager* ble) {
+    StatusSnapshot s;
+    s.pos = shutter_driver_get_current_percent(handle);
+    s.cal = shutter_driver_is_calibrated(handle);
+    s.inv = shutter_driver_get_direction_inverted(handle);
+    s.moving = handle && shutter_driver_get_current_state(handle) != RollerShutter::State::STOPPED;
+    s.win = shutter_driver_get_window_state(handle);
+    s.ble = ble ? ble->getDeviceState() : ShellyBLEManager::STATE_NOT_PAIRED;
+    return s;
+}
+
+size_t StatusPublisher::format(char* buf, size_t size, const StatusSnapshot& s, uint8_t fields) {
+    int n = snprintf(buf, size, "{\"type\":\"status\"");
+
+    if (fields & STATUS_FIELD_POS) {
+        n += snprintf(buf + n, n < (int)size ? size - n : 0, ",\"pos\":%u", s.pos);
+    }
+    if (fields & STATUS_FIELD_CAL) {
+        n += snprintf(buf + n, n < (int)size ? size - n : 0, ",\"cal\":%s", s.cal ? "true" : "false");
+    }
+    if (fields & STATUS_FIELD_INV) {
+        n += snprintf(buf + n, n < (int)size ? size - n : 0, ",\"inv\":%s", s.inv ? "true" : "false");
+    }
+    if (fields & STATUS_FIELD_MOVING) {
+        n += snprintf(buf + n, n < (int)size ? size - n : 0, ",\"moving\":%s", s.moving ? "true" : "false");
+    }
+    if (fields & STATUS_FIELD_WIN) {
+        n += snprintf(buf + n, n < (int)size ? size - n : 0, ",\"win\":\"%s\"", window_state_name(s.win));
+    }
+    if (fields & STATUS_FIELD_BLE) {
+        n += snprintf(buf + n, n < (int)size ? size - n : 0, ",\"ble\":\"%s\"", ble_state_name(s.ble));
+    }
+    n += snprintf(buf + n, n < (int)size ? size - n : 0, "}");
+
+    return n < (int)size ? (size_t)n : 0;
+}
+
+void StatusPublisher::encode(WSBinStatus& out, const StatusSnapshot& s, uint8_t fields) {
+    out.version = WS_BIN_VERSION;
+    out.type = WS_BIN_STATUS;
+    out.fields = fields;
+    out.pos = s.pos;
+    out.flags = (s.cal ? WS_BIN_STATUS_CAL : 0) |
+                (s.inv ? WS_BIN_STATUS_INV : 0) |
+                (s.moving ? WS_BIN_STATUS_MOVING : 0);
+    out.win = (uint8_t)s.win;
+    out.ble = (uint8_t)s.ble;
+}
+
+uint8_t StatusPublisher::diff(const StatusSnapshot& now) const {
+    if (!havePublished_) return STATUS_FIELD_ALL;
+
+    uint8_t fields = 0;
+    if (now.pos != published_.pos)       fields |= STATUS_FIELD_POS;
+    if (now.cal != published_.cal)       fields |= STATUS_FIELD_CAL;
+    if (now.inv != published_.inv)       fields |= STATUS_FIELD_INV;
+    if (now.moving != published_.moving) fields |= STATUS_FIELD_MOVING;
+    if (now.win != published_.win)       fields |= STATUS_FIELD_WIN;
+    if (now.ble != published_.ble)       fields |= STATUS_FIELD_BLE;
+    return fields;
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// Main Loop
+// ═══════════════════════════════════════════════════════════════════════
+
+void StatusPublisher::loop() {
+    if (!webUI_ || !handle_) return;
+
+    // Ohne Clients nichts senden - der nächste Client fragt "status" selbst an
+    if (webUI_->get_client_count() == 0) {
+        havePublished_ = false;
+        return;
+    }
+
+    uint32_t now = millis();
+    StatusSnapshot current = sample(handle_, ble_);
+    uint8_t fields = diff(current);
+
+    bool keepalive = !havePublished_ || now - lastKeepaliveMs_ >= STATUS_KEEPALIVE_MS;
+    if (keepalive) {
+        fields = STATUS_FIELD_ALL;
+    } else if (fields == STATUS_FIELD_POS && current.moving &&
+               now - lastPushMs_ < STATUS_MOTION_INTERVAL_MS) {
+        // Nur die Position hat sich während der Fahrt geändert → drosseln
+        return;
+    }
+
+    if (fields == 0) return;
+
+    WSBinStatus bin;
+    encode(bin, current, fields);
+
+    // JSON nur formatieren, wenn ein Client kein Binärprotokoll spricht
+    char msg[STATUS_MSG_MAX];
+    const char* json = nullptr;
+    if (webUI_->has_json_clients()) {
+        if (format(msg, sizeof(msg), current, fields) == 0) {
+            ESP_LOGW(TAG, "Status message truncated (fields=0x%02X)", fields);
+            return;
+        }
+        json = msg;
+    }
+
+    ESP_LOGD(TAG, "→ %s fields=0x%02X%s", keepalive ? "keepalive" : "delta",
+             fields, json ? "" : " (binary only)");
+    // Noch nicht gesendete ältere Deltas dürfen ersetzt werden
+    webUI_->broadcast_frames(json, &bin, sizeof(bin), fields);
+
+    published_ = current;
+    havePublished_ = true;
+    lastPushMs_ = now;
+    if (keepalive) {
+        lastKeepaliveMs_ = now;
+    }
+}
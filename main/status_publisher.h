@@ -0,0 +1,84 @@
+// status_publisher.h
+
+#ifndef STATUS_PUBLISHER_H
+#define STATUS_PUBLISHER_H
+
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+#include "rollershutter_driver.h"
+#include "shelly_ble_manager.h"
+#include "ws_binary.h"
+
+class WebUIHandler;
+
+// ═══════════════════════════════════════════════════════════════════════
+// Status Publisher: änderungsgetriebener "status"-Push
+// ═══════════════════════════════════════════════════════════════════════
+//
+// Statt alle 2s den kompletten Status zu senden, vergleicht loop() den
+// aktuellen Zustand mit dem zuletzt gesendeten und schickt nur die
+// geänderten Felder:
+//
+//   Position während der Fahrt  → höchstens alle STATUS_MOTION_INTERVAL_MS
+//   alle anderen Änderungen     → sofort
+//   Keepalive (alle Felder)     → alle STATUS_KEEPALIVE_MS
+//
+// Nachrichtenformat (Felder nur wenn geändert, Keepalive = alle):
+//   {"type":"status","pos":42,"cal":true,"inv":false,"moving":true,
+//    "win":"closed","ble":"connected_encrypted"}
+
+#define STATUS_MOTION_INTERVAL_MS   250
+#define STATUS_KEEPALIVE_MS         30000
+#define STATUS_MSG_MAX              192
+
+enum StatusField : uint8_t {
+    STATUS_FIELD_POS    = 1 << 0,
+    STATUS_FIELD_CAL    = 1 << 1,
+    STATUS_FIELD_INV    = 1 << 2,
+    STATUS_FIELD_MOVING = 1 << 3,
+    STATUS_FIELD_WIN    = 1 << 4,
+    STATUS_FIELD_BLE    = 1 << 5,
+    STATUS_FIELD_ALL    = 0x3F
+};
+
+struct StatusSnapshot {
+    uint8_t pos;
+    bool cal;
+    bool inv;
+    bool moving;
+    WindowState win;
+    ShellyBLEManager::DeviceState ble;
+};
+
+class StatusPublisher {
+public:
+    StatusPublisher(app_driver_handle_t handle, ShellyBLEManager* ble, WebUIHandler* webUI);
+
+    // Main Loop: Änderungen erkennen und ggf. senden
+    void loop();
+
+    // Aktueller Zustand (auch für das "status"-Kommando)
+    static StatusSnapshot sample(app_driver_handle_t handle, ShellyBLEManager* ble);
+
+    // JSON mit den gewählten Feldern, liefert die Länge (0 = zu klein)
+    static size_t format(char* buf, size_t size, const StatusSnapshot& s, uint8_t fields);
+
+    // Binär (ws_binary.h), 7 Bytes
+    static void encode(WSBinStatus& out, const StatusSnapshot& s, uint8_t fields);
+
+private:
+    uint8_t diff(const StatusSnapshot& now) const;
+
+    app_driver_handle_t handle_;
+    ShellyBLEManager* ble_;
+    WebUIHandler* webUI_;
+
+    StatusSnapshot published_;
+    bool havePublished_;
+    uint32_t lastPushMs_;
+    uint32_t lastKeepaliveMs_;
+};
+
+#endif // STATUS_PUBLISHER_H
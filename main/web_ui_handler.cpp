@@ -1,6 +1,10 @@
 #include <Arduino.h>
 
 #include "web_ui_handler.h"
+#include "status_publisher.h"
+#include "ws_binary.h"
+#include "json_command.h"
+#include "ota_stream.h"
 #include "device_naming.h"
 #include "credentials.h"
 
@@ -15,6 +19,11 @@
 #include <esp_mac.h>
 #include <esp_task_wdt.h>
 #include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <esp_timer.h>
+#include <mbedtls/platform_util.h>
 #include <app/server/Server.h>
 #include <app/server/CommissioningWindowManager.h>
 #include <platform/PlatformManager.h>
@@ -34,7 +43,6 @@ using namespace esp_matter;
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
-#include <Update.h>
 
 extern uint16_t window_covering_endpoint_id;
 extern WebUIHandler* webUI;
@@ -43,16 +51,6 @@ static const char* TAG = "WebUI";
 
 extern class DeviceNaming* deviceNaming;
 
-#define CMD_MATCH(cmd_str, pattern) \
-    (strncmp(cmd_str, pattern, sizeof(pattern) - 1) == 0)
-
-struct BLETaskParams {
-    WebUIHandler* handler;
-    int fd;
-    String address;
-    uint32_t passkey;
-};
-
 static uint8_t failed_login_count = 0;
 static uint32_t last_failed_login = 0;
 static uint32_t lockout_until = 0;
@@ -387,7 +385,9 @@ static esp_err_t favicon_handler(httpd_req_t *req) {
     ESP_LOGD(TAG, "Favicon requested (no auth required)");
     
     // Option 1: 204 No Content (schnellste Lösung)
+    // Ändert sich nie → lange cachen, sonst fragt der Browser bei jedem Reload
     httpd_resp_set_status(req, "204 No Content");
+    httpd_resp_set_hdr(req, "Cache-Control", "public, max-age=31536000, immutable");
     httpd_resp_send(req, NULL, 0);
     return ESP_OK;
     
@@ -410,6 +410,7 @@ static esp_err_t apple_touch_icon_handler(httpd_req_t *req) {
     
     // 204 No Content - Browser gibt auf und zeigt Standardicon
     httpd_resp_set_status(req, "204 No Content");
+    httpd_resp_set_hdr(req, "Cache-Control", "public, max-age=31536000, immutable");
     httpd_resp_send(req, NULL, 0);
     return ESP_OK;
 }
@@ -441,7 +442,7 @@ static esp_err_t update_get_handler(httpd_req_t *req) {
             "  Running: %s (0x%x)\n"
             "  Boot:    %s (0x%x)\n"
             "  Type:    %s\n\n"
-            "Upload firmware.bin via POST to /update",
+            "Upload firmware.bin or firmware.bwz (compressed) via POST to /update",
             app_desc->version,
             app_desc->date,
             app_desc->time,
@@ -462,6 +463,22 @@ static esp_err_t update_get_handler(httpd_req_t *req) {
 // HTTP POST Handler für /update
 // ════════════════════════════════════════════════════════════════════════
 
+static bool ota_stream_sink(void* ctx, const uint8_t* data, size_t len) {
+    return static_cast<OtaStreamWriter*>(ctx)->write(data, len);
+}
+
+// "ab12..." (64 Hex-Zeichen) → 32 Bytes
+static bool parse_sha256_hex(const char* hex, uint8_t out[32]) {
+    if (strlen(hex) != 64) return false;
+    for (int i = 0; i < 32; i++) {
+        char byte[3] = { hex[i * 2], hex[i * 2 + 1], '\0' };
+        char* end;
+        out[i] = (uint8_t)strtoul(byte, &end, 16);
+        if (*end != '\0') return false;
+    }
+    return true;
+}
+
 static esp_err_t update_post_handler(httpd_req_t *req) {
 
     // AUTH CHECK
@@ -489,99 +506,100 @@ static esp_err_t update_post_handler(httpd_req_t *req) {
     }
     
     // ════════════════════════════════════════════════════════════════════
-    // Parse Multipart Form Data Header
+    // Parse Multipart Boundary + optionalen Hash
     // ════════════════════════════════════════════════════════════════════
     
-    char boundary[128] = {0};
-    size_t boundary_len = 0;
-    
-    // Lese Content-Type Header
+    char boundary[OTA_MULTIPART_BOUNDARY_MAX + 1];
     char content_type[256];
     if (httpd_req_get_hdr_value_str(req, "Content-Type", 
-                                    content_type, sizeof(content_type)) == ESP_OK) {
-        
-        ESP_LOGI(TAG, "Content-Type: %s", content_type);
-        
-        // Extrahiere Boundary (z.B. "----WebKitFormBoundary...")
-        char* boundary_start = strstr(content_type, "boundary=");
-        if (boundary_start) {
-            boundary_start += 9; // Skip "boundary="
-            
-            // Kopiere Boundary String
-            strncpy(boundary, boundary_start, sizeof(boundary) - 1);
-            boundary_len = strlen(boundary);
-            
-            ESP_LOGI(TAG, "Boundary: %s (len=%u)", boundary, boundary_len);
-        } else {
-            ESP_LOGE(TAG, "✗ No boundary found in Content-Type");
-            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, 
-                               "Missing boundary in multipart form");
-            return ESP_FAIL;
-        }
-    } else {
+                                    content_type, sizeof(content_type)) != ESP_OK) {
         ESP_LOGE(TAG, "✗ No Content-Type header");
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, 
                            "Missing Content-Type header");
         return ESP_FAIL;
     }
     
+    ESP_LOGI(TAG, "Content-Type: %s", content_type);
+    
+    if (!multipart_boundary(content_type, boundary, sizeof(boundary))) {
+        ESP_LOGE(TAG, "✗ No boundary found in Content-Type");
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, 
+                           "Missing boundary in multipart form");
+        return ESP_FAIL;
+    }
+    
+    ESP_LOGI(TAG, "Boundary: %s (len=%u)", boundary, strlen(boundary));
+    
+    // Optional: erwarteter SHA-256 der (entpackten) Firmware
+    // (curl -H "X-Firmware-SHA256: ...") - .bwz-Images tragen ihn zusätzlich im Header
+    uint8_t expected_sha[32];
+    bool have_expected_sha = false;
+    char sha_hex[72];
+    if (httpd_req_get_hdr_value_str(req, "X-Firmware-SHA256", 
+                                    sha_hex, sizeof(sha_hex)) == ESP_OK) {
+        if (!parse_sha256_hex(sha_hex, expected_sha)) {
+            ESP_LOGE(TAG, "✗ Invalid X-Firmware-SHA256 header");
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, 
+                               "X-Firmware-SHA256 must be 64 hex characters");
+            return ESP_FAIL;
+        }
+        have_expected_sha = true;
+        ESP_LOGI(TAG, "Expected SHA-256: %s", sha_hex);
+    }
+    
     // ════════════════════════════════════════════════════════════════════
-    // Initialize OTA Update
+    // Initialize OTA Stream (Writer-Task + Doppelpuffer)
     // ════════════════════════════════════════════════════════════════════
     
     ESP_LOGI(TAG, "→ Initializing OTA update...");
     
-    if (!Update.begin(UPDATE_SIZE_UNKNOWN)) {
-        ESP_LOGE(TAG, "✗ Update.begin() failed");
-        ESP_LOGE(TAG, "  Error: %s", Update.errorString());
-        
+    OtaStreamWriter writer;
+    esp_err_t err = writer.begin();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "✗ OTA init failed: %s (%s)", writer.error(), esp_err_to_name(err));
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, 
                            "OTA init failed");
         return ESP_FAIL;
     }
     
-    ESP_LOGI(TAG, "✓ OTA Update initialized");
-    ESP_LOGI(TAG, "");
-    
-    // ════════════════════════════════════════════════════════════════════
-    // Read and Flash Data in Chunks
-    // ════════════════════════════════════════════════════════════════════
-    
-    const size_t BUFFER_SIZE = 1024;
-    uint8_t* buffer = (uint8_t*)malloc(BUFFER_SIZE);
+    MultipartParser parser;
+    parser.begin(boundary, ota_stream_sink, &writer);
     
+    uint8_t* buffer = (uint8_t*)malloc(OTA_STREAM_RECV_SIZE);
     if (!buffer) {
         ESP_LOGE(TAG, "✗ Failed to allocate buffer");
-        Update.abort();
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, 
                            "Memory allocation failed");
         return ESP_FAIL;
     }
     
-    size_t total_received = 0;
-    size_t firmware_start = 0;
-    size_t firmware_end = 0;
-    bool firmware_started = false;
-    bool header_parsed = false;
+    ESP_LOGI(TAG, "✓ OTA Update initialized → %s", writer.partition()->label);
+    ESP_LOGI(TAG, "");
+    
+    // ════════════════════════════════════════════════════════════════════
+    // Receive → Parse → Writer (Flash schreibt parallel im Writer-Task)
+    // ════════════════════════════════════════════════════════════════════
     
     ESP_LOGI(TAG, "╔═══════════════════════════════════╗");
     ESP_LOGI(TAG, "║   RECEIVING & FLASHING DATA       ║");
     ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
     ESP_LOGI(TAG, "");
     
+    uint32_t start_ms = millis();
+    size_t total_received = 0;
     int last_percent = -1;
+    int timeouts = 0;
+    bool stream_ok = true;
     
     while (total_received < content_len) {
-        // Berechne wie viel wir noch empfangen können
         size_t remaining = content_len - total_received;
-        size_t to_recv = (remaining < BUFFER_SIZE) ? remaining : BUFFER_SIZE;
+        size_t to_recv = (remaining < OTA_STREAM_RECV_SIZE) ? remaining : OTA_STREAM_RECV_SIZE;
         
-        // Empfange Chunk
         int ret = httpd_req_recv(req, (char*)buffer, to_recv);
         
         if (ret <= 0) {
-            if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
-                ESP_LOGW(TAG, "⚠ Socket timeout - retrying...");
+            if (ret == HTTPD_SOCK_ERR_TIMEOUT && ++timeouts <= 5) {
+                ESP_LOGW(TAG, "⚠ Socket timeout - retrying (%d/5)...", timeouts);
                 continue;
             }
             
@@ -589,107 +607,20 @@ static esp_err_t update_post_handler(httpd_req_t *req) {
             break;
         }
         
+        timeouts = 0;
         total_received += ret;
         
-        // ════════════════════════════════════════════════════════════════
-        // Parse Multipart Header (einmalig am Anfang)
-        // ════════════════════════════════════════════════════════════════
-        
-        if (!header_parsed && total_received >= 200) {
-            // Suche nach doppeltem CRLF (Ende des Headers)
-            for (size_t i = 0; i < ret - 3; i++) {
-                if (buffer[i] == '\r' && buffer[i+1] == '\n' &&
-                    buffer[i+2] == '\r' && buffer[i+3] == '\n') {
-                    
-                    firmware_start = i + 4;
-                    firmware_started = true;
-                    header_parsed = true;
-                    
-                    ESP_LOGI(TAG, "✓ Multipart header parsed");
-                    ESP_LOGI(TAG, "  Firmware data starts at byte: %u", firmware_start);
-                    
-                    // Schreibe erste Firmware-Bytes
-                    size_t first_chunk_size = ret - firmware_start;
-                    
-                    if (first_chunk_size > 0) {
-                        size_t written = Update.write(buffer + firmware_start, first_chunk_size);
-                        
-                        if (written != first_chunk_size) {
-                            ESP_LOGE(TAG, "✗ Write failed: wrote %u of %u bytes", 
-                                     written, first_chunk_size);
-                            Update.abort();
-                            free(buffer);
-                            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, 
-                                               "Flash write error");
-                            return ESP_FAIL;
-                        }
-                        
-                        firmware_end += first_chunk_size;
-                    }
-                    
-                    break;
-                }
-            }
-            
-            if (!header_parsed) {
-                ESP_LOGW(TAG, "⚠ Header not found yet (received: %u bytes)", total_received);
-            }
-            
-        } else if (firmware_started) {
-            // ════════════════════════════════════════════════════════════
-            // Schreibe Firmware-Daten
-            // ════════════════════════════════════════════════════════════
-            
-            // Prüfe ob wir am Ende sind (Boundary Footer)
-            if (total_received >= content_len - 200) {
-                // Suche nach Boundary Ende Marker
-                // Format: "\r\n------WebKitFormBoundary...\r\n"
-                
-                bool found_end = false;
-                for (int i = ret - 1; i >= 0; i--) {
-                    if (buffer[i] == '-' && i >= 2) {
-                        // Prüfe ob das der Footer ist
-                        char test[64];
-                        snprintf(test, sizeof(test), "--%s", boundary);
-                        
-                        if (i + strlen(test) <= ret) {
-                            if (memcmp(buffer + i, test, strlen(test)) == 0) {
-                                // Footer gefunden - schneide ab
-                                ret = i - 2; // -2 für \r\n davor
-                                found_end = true;
-                                ESP_LOGI(TAG, "✓ Found boundary footer at byte %d", i);
-                                break;
-                            }
-                        }
-                    }
-                }
-            }
-            
-            if (ret > 0) {
-                size_t written = Update.write(buffer, ret);
-                
-                if (written != ret) {
-                    ESP_LOGE(TAG, "✗ Write failed: wrote %u of %u bytes", written, ret);
-                    Update.abort();
-                    free(buffer);
-                    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, 
-                                       "Flash write error");
-                    return ESP_FAIL;
-                }
-                
-                firmware_end += ret;
-            }
+        if (!parser.feed(buffer, ret)) {
+            stream_ok = false;
+            break;
         }
         
-        // ════════════════════════════════════════════════════════════════
-        // Progress Logging (alle 5%)
-        // ════════════════════════════════════════════════════════════════
-        
+        // Progress Logging (alle 10%)
         int percent = (total_received * 100) / content_len;
         
-        if (percent != last_percent && percent % 5 == 0) {
-            ESP_LOGI(TAG, "📊 Progress: %d%% (%u / %u bytes)", 
-                     percent, total_received, content_len);
+        if (percent / 10 != last_percent / 10) {
+            ESP_LOGI(TAG, "📊 Progress: %d%% (%u / %u bytes, flashed %u)", 
+                     percent, total_received, content_len, writer.written());
             last_percent = percent;
         }
         
@@ -699,31 +630,93 @@ static esp_err_t update_post_handler(httpd_req_t *req) {
     
     free(buffer);
     
+    // ════════════════════════════════════════════════════════════════════
+    // Stream-Fehler (Format, Flash, Verbindung)
+    // ════════════════════════════════════════════════════════════════════
+    
+    const char* stream_error = nullptr;
+    int stream_status = 400;
+    
+    if (!stream_ok) {
+        if (writer.error()) {
+            stream_error = writer.error();
+            stream_status = 500;
+        } else {
+            stream_error = parser.error();
+        }
+    } else if (total_received < content_len) {
+        stream_error = "upload incomplete";
+    } else if (!parser.done()) {
+        stream_error = "multipart footer missing";
+    }
+    
+    if (stream_error) {
+        ESP_LOGE(TAG, "✗ OTA stream failed: %s (received %u / %u bytes)", 
+                 stream_error, total_received, content_len);
+        writer.abort();
+        
+        char error_msg[128];
+        snprintf(error_msg, sizeof(error_msg), "Update failed: %s", stream_error);
+        httpd_resp_send_err(req, stream_status == 500 ? HTTPD_500_INTERNAL_SERVER_ERROR 
+                                                      : HTTPD_400_BAD_REQUEST, error_msg);
+        return ESP_FAIL;
+    }
+    
     ESP_LOGI(TAG, "");
     ESP_LOGI(TAG, "╔═══════════════════════════════════╗");
     ESP_LOGI(TAG, "║   FINALIZING OTA UPDATE           ║");
     ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
     ESP_LOGI(TAG, "");
-    ESP_LOGI(TAG, "Total received: %u bytes", total_received);
-    ESP_LOGI(TAG, "Firmware size:  %u bytes", firmware_end);
     
     // ════════════════════════════════════════════════════════════════════
     // Finalize and Verify OTA Update
     // ════════════════════════════════════════════════════════════════════
     
-    if (Update.end(true)) {
+    uint8_t sha[32];
+    err = writer.finish(sha);
+    
+    uint32_t duration_ms = millis() - start_ms;
+    char sha_str[65];
+    for (int i = 0; i < 32; i++) {
+        snprintf(sha_str + i * 2, 3, "%02x", sha[i]);
+    }
+    
+    if (err == ESP_OK && have_expected_sha && memcmp(sha, expected_sha, 32) != 0) {
+        ESP_LOGE(TAG, "✗ SHA-256 mismatch - boot partition unchanged");
+        ESP_LOGE(TAG, "  Expected: %s", sha_hex);
+        ESP_LOGE(TAG, "  Actual:   %s", sha_str);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Update failed: SHA-256 mismatch");
+        return ESP_FAIL;
+    }
+    
+    if (err == ESP_OK) {
+        err = esp_ota_set_boot_partition(writer.partition());
+    }
+    
+    if (err == ESP_OK) {
         ESP_LOGI(TAG, "");
         ESP_LOGI(TAG, "✓✓✓ OTA UPDATE SUCCESSFUL ✓✓✓");
         ESP_LOGI(TAG, "");
-        ESP_LOGI(TAG, "Written:  %u bytes", Update.progress());
-        ESP_LOGI(TAG, "Expected: %u bytes", firmware_end);
-        ESP_LOGI(TAG, "MD5 Hash: %s", Update.md5String().c_str());
+        ESP_LOGI(TAG, "Received: %u bytes%s", total_received, 
+                 writer.compressed() ? " (compressed image)" : "");
+        ESP_LOGI(TAG, "Written:  %u bytes → %s", writer.written(), writer.partition()->label);
+        if (writer.compressed()) {
+            ESP_LOGI(TAG, "Ratio:    %.1f%% of the uncompressed image", 
+                     writer.received() * 100.0f / writer.written());
+        }
+        ESP_LOGI(TAG, "Duration: %u ms (%.1f KB/s, waited %u ms for flash)", 
+                 duration_ms, duration_ms ? total_received / 1.024f / duration_ms : 0.0f,
+                 writer.stallMs());
+        ESP_LOGI(TAG, "SHA-256:  %s%s", sha_str, have_expected_sha ? " (verified)" : "");
         ESP_LOGI(TAG, "");
         
         // Send Success Response
+        char response[160];
+        snprintf(response, sizeof(response), 
+                 "Update successful! Rebooting...\nSHA-256: %s", sha_str);
         httpd_resp_set_status(req, "200 OK");
         httpd_resp_set_type(req, "text/plain");
-        httpd_resp_sendstr(req, "Update successful! Rebooting...");
+        httpd_resp_sendstr(req, response);
         
         // Short delay to send response
         vTaskDelay(pdMS_TO_TICKS(1000));
@@ -737,15 +730,13 @@ static esp_err_t update_post_handler(httpd_req_t *req) {
         ESP_LOGE(TAG, "");
         ESP_LOGE(TAG, "✗✗✗ OTA UPDATE FAILED ✗✗✗");
         ESP_LOGE(TAG, "");
-        ESP_LOGE(TAG, "Error Code: %d", Update.getError());
-        ESP_LOGE(TAG, "Error String: %s", Update.errorString());
+        ESP_LOGE(TAG, "Error Code: %s", esp_err_to_name(err));
+        ESP_LOGE(TAG, "Error String: %s", writer.error() ? writer.error() : "set boot partition failed");
         ESP_LOGI(TAG, "");
         
-        Update.abort();
-        
         char error_msg[128];
         snprintf(error_msg, sizeof(error_msg), 
-                "Update failed: %s", Update.errorString());
+                "Update failed: %s", writer.error() ? writer.error() : esp_err_to_name(err));
         
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, error_msg);
         return ESP_FAIL;
@@ -754,6 +745,54 @@ static esp_err_t update_post_handler(httpd_req_t *req) {
     return ESP_OK;
 }
 
+// ============================================================================
+// Paired Sensor List (JSON-Fragment für ble_status)
+// ============================================================================
+
+// Hängt ,"devices":[...] an - ein Eintrag pro gepairtem Sensor der Registry.
+static int append_paired_devices_json(ShellyBLEManager* mgr, char* buf, int size) {
+    int offset = snprintf(buf, size, ",\"devices\":[");
+    
+    for (size_t i = 0; i < mgr->getPairedDeviceCount() && offset < size; i++) {
+        const PairedShellyDevice& dev = mgr->getPairedDevice(i);
+        ShellyBLESensorData sd;
+        bool hasData = mgr->getSensorData(dev.address, sd);
+        
+        offset += snprintf(buf + offset, size - offset,
+                           "%s{\"address\":\"%s\",\"name\":\"%s\",\"role\":\"%s\","
+                           "\"encrypted\":%s,\"valid\":%s,\"battery\":%d,\"rssi\":%d,"
+                           "\"adv_interval_ms\":%u,\"missed\":%u,"
+                           "\"rssi_avg\":%d,\"rssi_sd\":%.1f,\"decrypt_fail\":%u,\"parse_fail\":%u,"
+                           "\"stale\":%s,"
+                           "\"dedup\":{\"accepted\":%u,\"duplicates\":%u,"
+                           "\"replays\":%u,\"resyncs\":%u}}",
+                           i > 0 ? "," : "",
+                           dev.address.c_str(),
+                           dev.name.c_str(),
+                           sensorRoleToString(dev.role),
+                           dev.bindkey.isSet() ? "true" : "false",
+                           hasData ? "true" : "false",
+                           hasData ? sd.battery : 0,
+                           hasData ? sd.rssi : 0,
+                           dev.advStats.avgIntervalMs,
+                           dev.advStats.missed,
+                           dev.advStats.rssiAvg(),
+                           dev.advStats.rssiStdDev(),
+                           dev.advStats.decryptFailures,
+                           dev.advStats.parseFailures,
+                           dev.advStats.stale ? "true" : "false",
+                           dev.packetFilter.accepted,
+                           dev.packetFilter.duplicates,
+                           dev.packetFilter.replays,
+                           dev.packetFilter.resyncs);
+    }
+    
+    if (offset < size) {
+        offset += snprintf(buf + offset, size - offset, "]");
+    }
+    return offset < size ? offset : size - 1;
+}
+
 // ============================================================================
 // Static Close Callback
 // ============================================================================
@@ -762,6 +801,74 @@ static void ws_close_callback(httpd_handle_t hd, int sockfd) {
     ESP_LOGI("WebUI", "Socket %d closed by HTTP server", sockfd);
 }
 
+// ============================================================================
+// HTTP Caching Helpers (ETag / Accept-Encoding)
+// ============================================================================
+
+#ifdef SERVE_COMPRESSED_HTML
+
+// Nächstes Listen-Element aus einem Header ("a, b;q=0, c") ohne Whitespace
+static bool next_header_token(const char*& p, const char*& start, size_t& len) {
+    while (*p == ' ' || *p == '\t' || *p == ',') p++;
+    if (*p == '\0') return false;
+
+    start = p;
+    while (*p && *p != ',') p++;
+    const char* end = p;
+    while (end > start && (end[-1] == ' ' || end[-1] == '\t')) end--;
+    len = end - start;
+    return true;
+}
+
+// If-None-Match: Liste von ETags oder "*", schwache Vergleiche (W/) zählen
+static bool etag_matches(httpd_req_t *req, const char* etag) {
+    char header[128];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", header, sizeof(header)) != ESP_OK) {
+        return false;   // fehlt oder zu lang → voll ausliefern
+    }
+
+    size_t etag_len = strlen(etag);
+    const char* p = header;
+    const char* token;
+    size_t len;
+    while (next_header_token(p, token, len)) {
+        if (len == 1 && token[0] == '*') return true;
+        if (len > 2 && token[0] == 'W' && token[1] == '/') {
+            token += 2;
+            len -= 2;
+        }
+        if (len == etag_len && memcmp(token, etag, len) == 0) return true;
+    }
+    return false;
+}
+
+#ifdef HTML_HAS_BROTLI
+// Accept-Encoding enthält coding (ohne q=0)
+static bool accepts_encoding(httpd_req_t *req, const char* coding) {
+    char header[128];
+    if (httpd_req_get_hdr_value_str(req, "Accept-Encoding", header, sizeof(header)) != ESP_OK) {
+        return false;
+    }
+
+    size_t coding_len = strlen(coding);
+    const char* p = header;
+    const char* token;
+    size_t len;
+    while (next_header_token(p, token, len)) {
+        size_t name_len = 0;
+        while (name_len < len && token[name_len] != ';' && token[name_len] != ' ') name_len++;
+        if (name_len != coding_len || strncasecmp(token, coding, coding_len) != 0) continue;
+
+        // "br;q=0" = ausdrücklich abgelehnt (strtof stoppt am Komma)
+        const char* q = (const char*)memchr(token, '=', len);
+        return !q || strtof(q + 1, nullptr) > 0.0f;
+    }
+    return false;
+}
+#endif
+
+#endif // SERVE_COMPRESSED_HTML
+
 // ============================================================================
 // HTTP Root Handler - Serves Web-UI
 // ============================================================================
@@ -777,23 +884,43 @@ esp_err_t WebUIHandler::root_handler(httpd_req_t *req) {
     
     #ifdef SERVE_COMPRESSED_HTML
         // ====================================================================
-        // Serve GZIP Compressed HTML
+        // Serve Precompressed HTML (Brotli wenn akzeptiert, sonst GZIP)
         // ====================================================================
         
-        httpd_resp_set_type(req, "text/html");
-        httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
-        httpd_resp_set_hdr(req, "Cache-Control", "public, max-age=3600");
+        const char* encoding = "gzip";
+        const char* etag = HTML_ETAG;
+        const uint8_t* body = index_html_gz;
+        size_t body_len = index_html_gz_len;
+        
+        #ifdef HTML_HAS_BROTLI
+            if (accepts_encoding(req, "br")) {
+                encoding = "br";
+                etag = HTML_ETAG_BR;
+                body = index_html_br;
+                body_len = index_html_br_len;
+            }
+        #endif
         
-        char etag[32];
-        snprintf(etag, sizeof(etag), "\"%08x\"", index_html_gz_len);
+        // "/" ist nicht versioniert: Browser darf cachen, muss aber per
+        // If-None-Match revalidieren. ETag = Content-Hash aus dem Build.
+        httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
         httpd_resp_set_hdr(req, "ETag", etag);
+        httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+        
+        if (etag_matches(req, etag)) {
+            httpd_resp_set_status(req, "304 Not Modified");
+            esp_err_t ret = httpd_resp_send(req, NULL, 0);
+            ESP_LOGI(TAG, "✓ UI not modified (304, ETag %s)", etag);
+            return ret;
+        }
+        
+        httpd_resp_set_type(req, "text/html");
+        httpd_resp_set_hdr(req, "Content-Encoding", encoding);
         
-        esp_err_t ret = httpd_resp_send(req, 
-                                       (const char*)index_html_gz, 
-                                       index_html_gz_len);
+        esp_err_t ret = httpd_resp_send(req, (const char*)body, body_len);
         
         if (ret == ESP_OK) {
-            ESP_LOGI(TAG, "✓ Served compressed UI (%d bytes)", index_html_gz_len);
+            ESP_LOGI(TAG, "✓ Served %s UI (%d bytes)", encoding, body_len);
         } else {
             ESP_LOGE(TAG, "✗ Failed to serve UI: %s", esp_err_to_name(ret));
         }
@@ -818,6 +945,534 @@ esp_err_t WebUIHandler::root_handler(httpd_req_t *req) {
 // WebSocket Handler
 // ============================================================================
 
+// ============================================================================
+// WebSocket Frame Pool
+// ============================================================================
+//
+// Ein Broadcast wird genau einmal in einen Pool-Slot kopiert und in die
+// Send-Queue jedes Clients gestellt (siehe unten); jeder Queue-Eintrag
+// hält eine Referenz, der letzte Send gibt den Slot zurück. Status-Push
+// und BLE Heartbeat kommen so ohne Heap aus. Nur zu große Nachrichten
+// oder ein erschöpfter Pool fallen auf malloc zurück.
+
+#define WS_FRAME_POOL_SLOTS   6
+#define WS_FRAME_SLOT_SIZE    768     // Sensor-Update (640) passt noch
+
+struct WSFrame {
+    std::atomic<uint8_t> refs;      // 0 = Slot frei
+    bool heap;                      // Überlauf-Frame (malloc)
+    httpd_ws_type_t type;           // TEXT (JSON) oder BINARY (ws_binary.h)
+    uint8_t coalesce;               // StatusField-Maske, 0 = nie ersetzen
+    char* data;
+    size_t len;
+};
+
+static WSFrame ws_frame_pool[WS_FRAME_POOL_SLOTS];
+static char ws_frame_storage[WS_FRAME_POOL_SLOTS][WS_FRAME_SLOT_SIZE];
+
+// Statistik - Erzeuger sind Main Loop, BLE Callbacks, ws_job Worker und httpd
+static std::atomic<uint32_t> ws_frames_pooled{0};
+static std::atomic<uint32_t> ws_frames_heap{0};
+static std::atomic<uint32_t> ws_frames_failed{0};
+
+// Liefert einen Frame mit einer Referenz (die des Erzeugers)
+static WSFrame* ws_frame_acquire(size_t len) {
+    if (len <= WS_FRAME_SLOT_SIZE) {
+        for (size_t i = 0; i < WS_FRAME_POOL_SLOTS; i++) {
+            uint8_t expected = 0;
+            if (ws_frame_pool[i].refs.compare_exchange_strong(expected, 1)) {
+                WSFrame* frame = &ws_frame_pool[i];
+                frame->heap = false;
+                frame->data = ws_frame_storage[i];
+                ws_frames_pooled++;
+                return frame;
+            }
+        }
+    }
+
+    // Überlauf: Frame + Payload in einem Block
+    void* mem = malloc(sizeof(WSFrame) + len);
+    if (!mem) {
+        ws_frames_failed++;
+        return nullptr;
+    }
+    WSFrame* frame = new (mem) WSFrame();
+    frame->refs.store(1);
+    frame->heap = true;
+    frame->data = (char*)(frame + 1);
+    ws_frames_heap++;
+    return frame;
+}
+
+static void ws_frame_release(WSFrame* frame) {
+    if (frame->refs.fetch_sub(1) == 1 && frame->heap) {
+        frame->~WSFrame();
+        free(frame);
+    }
+}
+
+// Frame anlegen und Payload einmal hineinkopieren
+static WSFrame* ws_frame_create(const void* payload, size_t len,
+                                httpd_ws_type_t type, uint8_t coalesce) {
+    WSFrame* frame = ws_frame_acquire(len);
+    if (!frame) {
+        ESP_LOGE(TAG, "✗ Failed to allocate %u bytes for broadcast", len);
+        return nullptr;
+    }
+    memcpy(frame->data, payload, len);
+    frame->len = len;
+    frame->type = type;
+    frame->coalesce = coalesce;
+    return frame;
+}
+
+static uint8_t ws_frames_in_use() {
+    uint8_t used = 0;
+    for (size_t i = 0; i < WS_FRAME_POOL_SLOTS; i++) {
+        if (ws_frame_pool[i].refs.load() != 0) used++;
+    }
+    return used;
+}
+
+// ============================================================================
+// WebSocket Client Send Queues
+// ============================================================================
+//
+// Jeder Client hat eine begrenzte Queue, die ein httpd_queue_work()-Job
+// im httpd-Task leert. Broadcasts stellen nur ein und kehren sofort
+// zurück - ein langsamer Client bremst weder den Aufrufer (Main Loop)
+// noch die anderen Clients.
+//
+//   Coalescing  Ein noch nicht gesendeter Status-Frame wird durch einen
+//               neueren ersetzt, wenn dieser mindestens dieselben Felder
+//               enthält (Positions-Deltas während der Fahrt).
+//   Backpressure Ist der Socket nicht schreibbar, bleibt die Queue
+//               stehen; ein One-Shot-Timer reiht den Drain nach
+//               WS_CLIENT_RETRY_MS erneut ein.
+//   Eviction    Bleibt die Queue bzw. der Socket WS_CLIENT_STALL_MS lang
+//               voll oder schlägt ein Send fehl, wird der Client geschlossen.
+
+#define WS_CLIENT_QUEUES      3       // >= WebUIHandler::MAX_CLIENTS
+#define WS_CLIENT_QUEUE_LEN   4
+#define WS_CLIENT_STALL_MS    5000
+#define WS_CLIENT_RETRY_MS    50
+
+struct WSClientQueue {
+    int fd;                         // -1 = frei
+    WebUIHandler* owner;
+    WSFrame* frames[WS_CLIENT_QUEUE_LEN];
+    uint8_t head;
+    uint8_t depth;
+    uint8_t maxDepth;
+    bool drainQueued;               // httpd_queue_work() oder Retry ausstehend
+    uint32_t fullSince;             // 0 = nicht voll
+    uint32_t blockedSince;          // 0 = Socket schreibbar
+    esp_timer_handle_t retryTimer;  // einmal pro Slot angelegt, bleibt bestehen
+    uint32_t sent;
+    uint32_t dropped;
+    uint32_t coalesced;
+};
+
+enum WSQueueResult : uint8_t {
+    WS_QUEUED,
+    WS_COALESCED,
+    WS_DROPPED,
+    WS_STALLED                      // voll seit > WS_CLIENT_STALL_MS
+};
+
+static WSClientQueue ws_client_queues[WS_CLIENT_QUEUES] = {
+    { -1 }, { -1 }, { -1 }
+};
+static portMUX_TYPE ws_queue_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static WSClientQueue* ws_queue_find(int fd) {
+    for (size_t i = 0; i < WS_CLIENT_QUEUES; i++) {
+        if (ws_client_queues[i].fd == fd) return &ws_client_queues[i];
+    }
+    return nullptr;
+}
+
+static void ws_queue_open(int fd, WebUIHandler* owner, esp_timer_cb_t retry_cb) {
+    taskENTER_CRITICAL(&ws_queue_lock);
+    WSClientQueue* q = ws_queue_find(-1);
+    if (q) {
+        esp_timer_handle_t timer = q->retryTimer;
+        *q = WSClientQueue{};
+        q->retryTimer = timer;
+        q->fd = fd;
+        q->owner = owner;
+    }
+    taskEXIT_CRITICAL(&ws_queue_lock);
+
+    if (q && !q->retryTimer) {
+        esp_timer_create_args_t args = {};
+        args.callback = retry_cb;
+        args.arg = q;
+        args.name = "ws_drain_retry";
+        if (esp_timer_create(&args, &q->retryTimer) != ESP_OK) {
+            ESP_LOGE(TAG, "✗ Failed to create drain retry timer");
+            q->retryTimer = nullptr;
+        }
+    }
+}
+
+// Gibt alle noch wartenden Frames frei
+static void ws_queue_close(int fd) {
+    WSFrame* pending[WS_CLIENT_QUEUE_LEN];
+    uint8_t count = 0;
+
+    taskENTER_CRITICAL(&ws_queue_lock);
+    WSClientQueue* q = ws_queue_find(fd);
+    if (q) {
+        while (q->depth > 0) {
+            pending[count++] = q->frames[q->head];
+            q->head = (q->head + 1) % WS_CLIENT_QUEUE_LEN;
+            q->depth--;
+        }
+        q->fd = -1;
+    }
+    taskEXIT_CRITICAL(&ws_queue_lock);
+
+    if (q && q->retryTimer) {
+        esp_timer_stop(q->retryTimer);      // ESP_ERR_INVALID_STATE = lief nicht
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        ws_frame_release(pending[i]);
+    }
+}
+
+// Nimmt bei WS_QUEUED / WS_COALESCED eine eigene Referenz auf frame.
+// start_drain = true → Aufrufer muss client_drain_work einreihen.
+static WSQueueResult ws_queue_push(int fd, WSFrame* frame, bool& start_drain) {
+    WSFrame* replaced = nullptr;
+    WSQueueResult result = WS_DROPPED;
+    uint32_t now = millis();
+    start_drain = false;
+
+    taskENTER_CRITICAL(&ws_queue_lock);
+    WSClientQueue* q = ws_queue_find(fd);
+    if (q) {
+        // Überholten Status-Frame ersetzen (gleiches Format, Obermenge der
+        // Felder). Nur der jüngste Eintrag - sonst könnte ein dazwischen
+        // liegender Frame einen älteren Wert erneut setzen.
+        if (frame->coalesce && q->depth > 0) {
+            uint8_t slot = (q->head + q->depth - 1) % WS_CLIENT_QUEUE_LEN;
+            WSFrame* old = q->frames[slot];
+            if (old->coalesce && old->type == frame->type &&
+                (frame->coalesce & old->coalesce) == old->coalesce) {
+                replaced = old;
+                q->frames[slot] = frame;
+                frame->refs.fetch_add(1);
+                q->coalesced++;
+                result = WS_COALESCED;
+            }
+        }
+
+        if (result != WS_COALESCED) {
+            if (q->depth < WS_CLIENT_QUEUE_LEN) {
+                q->frames[(q->head + q->depth) % WS_CLIENT_QUEUE_LEN] = frame;
+                frame->refs.fetch_add(1);
+                q->depth++;
+                if (q->depth > q->maxDepth) q->maxDepth = q->depth;
+                q->fullSince = 0;
+                result = WS_QUEUED;
+            } else {
+                q->dropped++;
+                if (!q->fullSince) {
+                    q->fullSince = now ? now : 1;
+                }
+                result = (now - q->fullSince > WS_CLIENT_STALL_MS) ? WS_STALLED : WS_DROPPED;
+            }
+        }
+
+        // Drain anstoßen, falls keiner aussteht (Retry-Timer zählt als ausstehend)
+        if (result != WS_STALLED && !q->drainQueued && q->depth > 0) {
+            q->drainQueued = true;
+            start_drain = true;
+        }
+    }
+    taskEXIT_CRITICAL(&ws_queue_lock);
+
+    if (replaced) {
+        ws_frame_release(replaced);
+    }
+    return result;
+}
+
+static bool ws_socket_writable(int fd) {
+    fd_set wfds;
+    FD_ZERO(&wfds);
+    FD_SET(fd, &wfds);
+    struct timeval tv = { 0, 0 };
+    return select(fd + 1, nullptr, &wfds, nullptr, &tv) > 0;
+}
+
+// ============================================================================
+// WebSocket Command Dispatch
+// ============================================================================
+//
+// Jedes Kommando wird einmal mit Namen, Handler und erlaubter Frame-Form
+// registriert, begin() sortiert die Tabelle, ws_handler() sucht binär über
+// den Namen:
+//   "status"                        → WS_COMMAND:      exakt, ohne Argument
+//   "pos:42"                        → WS_COMMAND_ARG:  Name + ':' + Argument (Pflicht)
+//   {"cmd":"ble_pair","address":…}  → WS_COMMAND_JSON: Wert von "cmd" (JsonCommand)
+// Frames in der falschen Form gelten als unbekannt. JSON-Frames zerlegt
+// ws_handler() genau einmal im Empfangspuffer; die Handler bekommen das
+// Ergebnis als JsonCommand (bei PLAIN/ARG leer).
+
+#define WS_COMMAND_NAME_MAX 40
+#define WS_FRAME_MAX        512     // Größter akzeptierter Text-Frame
+
+// Empfangspuffer für Text-Frames (nur httpd Task, ein Frame zur Zeit)
+static char ws_rx_buf[WS_FRAME_MAX + 1];
+
+// friend von WebUIHandler (Zugriff auf handle/bleManager/...)
+struct WSCommandHandlers {
+    static esp_err_t up(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t down(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t pos(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t stop(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t calibrate(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t calibrate_from_bottom(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t invert_on(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t invert_off(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t reset(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t get_device_name(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t status(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t matter_status(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t matter_open_commissioning(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t info(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t save_device_name(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t change_webui_password(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t restart(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t discover_devices(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t ble_scan(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t ble_status(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t ble_smart_connect(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t ble_connect(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t ble_encrypt(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t ble_enable_encryption(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t ble_pair_encrypted_known(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t ble_unpair(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t ble_pair(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t ble_start_continuous_scan(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t ble_stop_scan(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t contact_sensor_enable(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t contact_sensor_disable(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t read_sensor_data(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t contact_sensor_status(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t window_logic_status(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t window_logic_save(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t button_binding_status(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t button_binding_save(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t ws_stats(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t proto(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+    static esp_err_t job_cancel(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+
+    // Lang laufende Teile, laufen im Job-Worker (ws_jobs.h)
+    static bool reset_job(WSJob& job);
+    static bool restart_job(WSJob& job);
+    static bool disconnect_clients_job(WSJob& job);
+    static bool discover_devices_job(WSJob& job);
+    static bool ble_scan_monitor_job(WSJob& job);
+    static bool ble_smart_connect_job(WSJob& job);
+    static bool ble_connect_job(WSJob& job);
+    static bool ble_encrypt_job(WSJob& job);
+    static bool ble_enable_encryption_job(WSJob& job);
+    static bool ble_pair_encrypted_known_job(WSJob& job);
+    static bool read_sensor_data_job(WSJob& job);
+};
+
+typedef esp_err_t (*ws_command_fn)(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json);
+
+enum WSCommandForm : uint8_t {
+    WS_FORM_PLAIN = 1 << 0,
+    WS_FORM_ARG   = 1 << 1,
+    WS_FORM_JSON  = 1 << 2
+};
+
+struct WSCommand {
+    const char* name;
+    ws_command_fn fn;
+    uint8_t forms;              // WSCommandForm-Bitmaske
+    uint32_t count;
+    uint32_t maxUs;
+    uint64_t totalUs;
+};
+
+#define WS_COMMAND(name)      { #name, WSCommandHandlers::name, WS_FORM_PLAIN, 0, 0, 0 }
+#define WS_COMMAND_ARG(name)  { #name, WSCommandHandlers::name, WS_FORM_ARG,   0, 0, 0 }
+#define WS_COMMAND_JSON(name) { #name, WSCommandHandlers::name, WS_FORM_JSON,  0, 0, 0 }
+
+static WSCommand ws_commands[] = {
+    WS_COMMAND(up),
+    WS_COMMAND(down),
+    WS_COMMAND_ARG(pos),
+    WS_COMMAND(stop),
+    WS_COMMAND(calibrate),
+    WS_COMMAND(calibrate_from_bottom),
+    WS_COMMAND(invert_on),
+    WS_COMMAND(invert_off),
+    WS_COMMAND(reset),
+    WS_COMMAND(get_device_name),
+    WS_COMMAND(status),
+    WS_COMMAND(matter_status),
+    WS_COMMAND(matter_open_commissioning),
+    WS_COMMAND(info),
+    WS_COMMAND_JSON(save_device_name),
+    WS_COMMAND_JSON(change_webui_password),
+    WS_COMMAND(restart),
+    WS_COMMAND(discover_devices),
+    WS_COMMAND(ble_scan),
+    WS_COMMAND(ble_status),
+    WS_COMMAND_JSON(ble_smart_connect),
+    WS_COMMAND_JSON(ble_connect),
+    WS_COMMAND_JSON(ble_encrypt),
+    WS_COMMAND_JSON(ble_enable_encryption),
+    WS_COMMAND_JSON(ble_pair_encrypted_known),
+    WS_COMMAND_JSON(ble_unpair),
+    WS_COMMAND_JSON(ble_pair),
+    WS_COMMAND(ble_start_continuous_scan),
+    WS_COMMAND(ble_stop_scan),
+    WS_COMMAND(contact_sensor_enable),
+    WS_COMMAND(contact_sensor_disable),
+    WS_COMMAND(read_sensor_data),
+    WS_COMMAND(contact_sensor_status),
+    WS_COMMAND(window_logic_status),
+    WS_COMMAND_JSON(window_logic_save),
+    WS_COMMAND(button_binding_status),
+    WS_COMMAND_JSON(button_binding_save),
+    WS_COMMAND(ws_stats),
+    WS_COMMAND_ARG(proto),
+    WS_COMMAND_ARG(job_cancel),
+};
+
+static const size_t WS_COMMAND_COUNT = sizeof(ws_commands) / sizeof(ws_commands[0]);
+static bool ws_commands_sorted = false;
+static uint32_t ws_unknown_commands = 0;
+
+static void ws_commands_init() {
+    if (ws_commands_sorted) return;
+
+    std::sort(ws_commands, ws_commands + WS_COMMAND_COUNT,
+              [](const WSCommand& a, const WSCommand& b) { return strcmp(a.name, b.name) < 0; });
+
+    for (size_t i = 1; i < WS_COMMAND_COUNT; i++) {
+        if (strcmp(ws_commands[i - 1].name, ws_commands[i].name) == 0) {
+            ESP_LOGE(TAG, "✗ Duplicate WebSocket command: %s", ws_commands[i].name);
+        }
+    }
+
+    ws_commands_sorted = true;
+    ESP_LOGI(TAG, "✓ %u WebSocket commands registered", (unsigned)WS_COMMAND_COUNT);
+}
+
+static WSCommand* ws_command_find(const char* name) {
+    size_t lo = 0;
+    size_t hi = WS_COMMAND_COUNT;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        int c = strcmp(name, ws_commands[mid].name);
+        if (c == 0) return &ws_commands[mid];
+        if (c < 0) hi = mid;
+        else lo = mid + 1;
+    }
+    return nullptr;
+}
+
+// Kommando zum Frame; nullptr = unbekannt oder in falscher Form gesendet.
+// JSON-Frames müssen bereits in json geparst sein (nur "cmd" wird gelesen).
+static WSCommand* ws_command_match(const char* frame, size_t len, const JsonCommand& json) {
+    if (frame[0] == '{') {
+        const char* value = json.getString("cmd");
+        if (!value || value[0] == '\0') return nullptr;
+
+        WSCommand* command = ws_command_find(value);
+        return (command && (command->forms & WS_FORM_JSON)) ? command : nullptr;
+    }
+
+    char name[WS_COMMAND_NAME_MAX];
+    const char* colon = strchr(frame, ':');
+    size_t n = colon ? (size_t)(colon - frame) : len;
+    if (n == 0 || n >= sizeof(name)) return nullptr;
+    if (colon && colon[1] == '\0') return nullptr;  // "pos:" ohne Argument
+
+    memcpy(name, frame, n);
+    name[n] = '\0';
+    uint8_t form = colon ? WS_FORM_ARG : WS_FORM_PLAIN;
+
+    WSCommand* command = ws_command_find(name);
+    return (command && (command->forms & form)) ? command : nullptr;
+}
+
+// Fehler-Frame als Antwort an den anfragenden Client (über dessen Queue)
+static void ws_reply_error(WebUIHandler* self, int fd, const char* message) {
+    char error[128];
+    snprintf(error, sizeof(error), "{\"type\":\"error\",\"message\":\"%s\"}", message);
+    self->sendToClient(fd, error, strlen(error));
+}
+
+// Aufrufzähler + Handler-Latenz (nur httpd Task → ohne Lock)
+static String ws_command_stats_json(const WSJobPool& jobs) {
+    String json;
+    json.reserve(256 + WS_COMMAND_COUNT * 72);
+    json = "{\"type\":\"ws_stats\",\"unknown\":";
+    json += ws_unknown_commands;
+
+    char frames[112];
+    snprintf(frames, sizeof(frames),
+             ",\"frames\":{\"pooled\":%u,\"heap\":%u,\"failed\":%u,\"in_use\":%u,\"slots\":%u}",
+             (unsigned)ws_frames_pooled.load(), (unsigned)ws_frames_heap.load(),
+             (unsigned)ws_frames_failed.load(),
+             ws_frames_in_use(), (unsigned)WS_FRAME_POOL_SLOTS);
+    json += frames;
+
+    // Pro Client: Queue-Tiefe und Verluste
+    json += ",\"clients\":[";
+    bool first = true;
+    for (size_t i = 0; i < WS_CLIENT_QUEUES; i++) {
+        taskENTER_CRITICAL(&ws_queue_lock);
+        WSClientQueue q = ws_client_queues[i];
+        taskEXIT_CRITICAL(&ws_queue_lock);
+        if (q.fd < 0) continue;
+
+        char entry[128];
+        snprintf(entry, sizeof(entry),
+                 "%s{\"fd\":%d,\"depth\":%u,\"max_depth\":%u,\"sent\":%u,"
+                 "\"dropped\":%u,\"coalesced\":%u}",
+                 first ? "" : ",", q.fd, q.depth, q.maxDepth,
+                 (unsigned)q.sent, (unsigned)q.dropped, (unsigned)q.coalesced);
+        json += entry;
+        first = false;
+    }
+    json += "]";
+
+    char jobStats[112];
+    snprintf(jobStats, sizeof(jobStats),
+             ",\"jobs\":{\"pending\":%u,\"running\":%u,\"completed\":%u,\"rejected\":%u}",
+             jobs.pending(), jobs.running(),
+             (unsigned)jobs.completed(), (unsigned)jobs.rejected());
+    json += jobStats;
+
+    json += ",\"commands\":[";
+
+    for (size_t i = 0; i < WS_COMMAND_COUNT; i++) {
+        const WSCommand& c = ws_commands[i];
+        char entry[96];
+        snprintf(entry, sizeof(entry),
+                 "%s{\"cmd\":\"%s\",\"count\":%u,\"avg_us\":%u,\"max_us\":%u}",
+                 i ? "," : "", c.name, c.count,
+                 c.count ? (unsigned)(c.totalUs / c.count) : 0u, c.maxUs);
+        json += entry;
+    }
+
+    json += "]}";
+    return json;
+}
+
+
 esp_err_t WebUIHandler::ws_handler(httpd_req_t *req) {
     if (req->method == HTTP_GET) {
         // Auth Check beim Handshake
@@ -861,6 +1516,9 @@ esp_err_t WebUIHandler::ws_handler(httpd_req_t *req) {
         ESP_LOGE(TAG, "WebSocket: Failed to receive frame header");
         return ret;
     }
+
+    // Jeder empfangene Frame zählt als Aktivität (cleanup_idle_clients)
+    self->touch_client(fd);
     
     // WICHTIG: Close Frame behandeln
     if (ws_pkt.type == HTTPD_WS_TYPE_CLOSE) {
@@ -885,27 +1543,20 @@ esp_err_t WebUIHandler::ws_handler(httpd_req_t *req) {
 
     ESP_LOGI(TAG, "WebSocket: Receiving text frame...");
     
-    if (ws_pkt.len == 0 || ws_pkt.len > 512) {
+    if (ws_pkt.len == 0 || ws_pkt.len > WS_FRAME_MAX) {
         ESP_LOGE(TAG, "WebSocket: Invalid frame length: %d", ws_pkt.len);
         return ESP_ERR_INVALID_SIZE;
     }
     
-    uint8_t* buf = (uint8_t*)malloc(ws_pkt.len + 1);
-    if (!buf) {
-        ESP_LOGE(TAG, "WebSocket: Failed to allocate buffer");
-        return ESP_ERR_NO_MEM;
-    }
-    
-    ws_pkt.payload = buf;
-    ret = httpd_ws_recv_frame(req, &ws_pkt, ws_pkt.len);
+    ws_pkt.payload = (uint8_t*)ws_rx_buf;
+    ret = httpd_ws_recv_frame(req, &ws_pkt, WS_FRAME_MAX);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "WebSocket: Failed to receive frame payload: %s", esp_err_to_name(ret));
-        free(buf);
         return ret;
     }
     
-    buf[ws_pkt.len] = '\0';
-    char* cmd = (char*)buf;
+    ws_rx_buf[ws_pkt.len] = '\0';
+    char* cmd = ws_rx_buf;
 
     ESP_LOGI(TAG, "═══════════════════════════════════");
     ESP_LOGI(TAG, "COMMAND DEBUG");
@@ -914,202 +1565,261 @@ esp_err_t WebUIHandler::ws_handler(httpd_req_t *req) {
     ESP_LOGI(TAG, "Length: %d", strlen(cmd));
 
     // ========================================================================
-    // Command Handling (ERWEITERT MIT DEBUG)
+    // Command Dispatch
     // ========================================================================
 
-    // Shutter Commands
-    if (strcmp(cmd, "up") == 0) {
-        ESP_LOGI(TAG, "→ Command: UP (move to 0%%)");
-        esp_err_t result = shutter_driver_go_to_lift_percent(self->handle, 0);
-        ESP_LOGI(TAG, "← Result: %s", result == ESP_OK ? "SUCCESS" : "FAILED");
-    } 
-    else if (strcmp(cmd, "down") == 0) {
-        ESP_LOGI(TAG, "→ Command: DOWN (move to 100%%)");
-        esp_err_t result = shutter_driver_go_to_lift_percent(self->handle, 100);
-        ESP_LOGI(TAG, "← Result: %s", result == ESP_OK ? "SUCCESS" : "FAILED");
-    }
-    else if (strncmp(cmd, "pos:", 4) == 0) {
-        int target_pos = atoi(cmd + 4);
-        if (target_pos < 0) target_pos = 0;
-        if (target_pos > 100) target_pos = 100;
-        ESP_LOGI(TAG, "→ Command: SLIDER POSITION (move to %d%%)", target_pos);
-        esp_err_t result = shutter_driver_go_to_lift_percent(self->handle, target_pos);
-        ESP_LOGI(TAG, "← Result: %s", result == ESP_OK ? "SUCCESS" : "FAILED");
-    }
-    else if (strcmp(cmd, "stop") == 0) {
-        ESP_LOGI(TAG, "→ Command: STOP");
-        esp_err_t result = shutter_driver_stop_motion(self->handle);
-        uint8_t current_pos = shutter_driver_get_current_percent(self->handle);
-        ESP_LOGI(TAG, "← Stopped at %d%% | Result: %s", current_pos, 
-                result == ESP_OK ? "SUCCESS" : "FAILED");
-    } 
-    else if (strcmp(cmd, "calibrate") == 0) {
-        ESP_LOGI(TAG, "→ Command: START CALIBRATION (from top)");
-        bool was_calibrated = shutter_driver_is_calibrated(self->handle);
-        esp_err_t result = shutter_driver_start_calibration(self->handle);
-        ESP_LOGI(TAG, "← Calibration started | Previously calibrated: %s | Result: %s",
-                was_calibrated ? "YES" : "NO",
-                result == ESP_OK ? "SUCCESS" : "FAILED");
-    }
-    else if (strcmp(cmd, "calibrate_from_bottom") == 0) {
-        ESP_LOGI(TAG, "→ Command: START CALIBRATION (from bottom / DOWN first)");
-        bool was_calibrated = shutter_driver_is_calibrated(self->handle);
-        esp_err_t result = shutter_driver_start_calibration_from_bottom(self->handle);
-        ESP_LOGI(TAG, "← Calibration (from bottom) started | Previously calibrated: %s | Result: %s",
-                was_calibrated ? "YES" : "NO",
-                result == ESP_OK ? "SUCCESS" : "FAILED");
-    }
-    else if (strcmp(cmd, "invert_on") == 0) {
-            ESP_LOGI(TAG, "WebUI: Setting direction to INVERTED");
-        
-        // ════════════════════════════════════════════════════════════════
-        // 1. Update Mode Attribut in Matter
-        // ════════════════════════════════════════════════════════════════
-        
-        cluster_t* wc_cluster = cluster::get(window_covering_endpoint_id, 
-                                            chip::app::Clusters::WindowCovering::Id);
-        if (wc_cluster) {
-            attribute_t* mode_attr = attribute::get(wc_cluster, 
-                                                chip::app::Clusters::WindowCovering::Attributes::Mode::Id);
-            if (mode_attr) {
-                // Aktuellen Mode lesen
-                esp_matter_attr_val_t current_mode;
-                attribute::get_val(mode_attr, &current_mode);
-                
-                // Bit 0 setzen (MotorDirectionReversed)
-                uint8_t new_mode = current_mode.val.u8 | 0x01;
-                
-                esp_matter_attr_val_t new_val = esp_matter_bitmap8(new_mode);
-                
-                // Attribut updaten (triggert app_attribute_update_cb!)
-                attribute::update(window_covering_endpoint_id,
-                                chip::app::Clusters::WindowCovering::Id,
-                                chip::app::Clusters::WindowCovering::Attributes::Mode::Id,
-                                &new_val);
-                
-                ESP_LOGI(TAG, "✓ Mode attribute updated: 0x%02X → 0x%02X", 
-                        current_mode.val.u8, new_mode);
-            }
-        }
-        
-        // ════════════════════════════════════════════════════════════════
-        // 2. WebUI Response
-        // ════════════════════════════════════════════════════════════════
-        
-        vTaskDelay(pdMS_TO_TICKS(100));  // Kurz warten bis Update propagiert ist
-        
-        bool inverted = shutter_driver_get_direction_inverted(self->handle);
-        
-        // ✅ Response Buffer definieren
-        char response[128];
-        snprintf(response, sizeof(response), 
-                "{\"type\":\"direction\",\"inverted\":%s}",
-                inverted ? "true" : "false");
-        
-        // WebSocket Frame vorbereiten
-        httpd_ws_frame_t ws_pkt;
-        memset(&ws_pkt, 0, sizeof(httpd_ws_frame_t));
-        ws_pkt.payload = (uint8_t*)response;
-        ws_pkt.len = strlen(response);
-        ws_pkt.type = HTTPD_WS_TYPE_TEXT;
-        
-        httpd_ws_send_frame(req, &ws_pkt);
+    // JSON genau einmal, in place im Empfangspuffer
+    JsonCommand json;
+    if (cmd[0] == '{' && !json.parse(cmd, ws_pkt.len)) {
+        ESP_LOGW(TAG, "✗ Invalid JSON command: %s", json.error());
+
+        char error[64];
+        snprintf(error, sizeof(error), "Invalid command: %s", json.error());
+        ws_reply_error(self, fd, error);
+        return ESP_OK;
     }
-    else if (strcmp(cmd, "invert_off") == 0) {
-            ESP_LOGI(TAG, "WebUI: Setting direction to NORMAL");
-        
-        // ════════════════════════════════════════════════════════════════
-        // 1. Update Mode Attribut in Matter
-        // ════════════════════════════════════════════════════════════════
-        
-        cluster_t* wc_cluster = cluster::get(window_covering_endpoint_id, 
-                                            chip::app::Clusters::WindowCovering::Id);
-        if (wc_cluster) {
-            attribute_t* mode_attr = attribute::get(wc_cluster, 
-                                                chip::app::Clusters::WindowCovering::Attributes::Mode::Id);
-            if (mode_attr) {
-                // Aktuellen Mode lesen
-                esp_matter_attr_val_t current_mode;
-                attribute::get_val(mode_attr, &current_mode);
-                
-                // Bit 0 löschen (MotorDirectionReversed)
-                uint8_t new_mode = current_mode.val.u8 & ~0x01;
-                
-                esp_matter_attr_val_t new_val = esp_matter_bitmap8(new_mode);
-                
-                // Attribut updaten (triggert app_attribute_update_cb!)
-                attribute::update(window_covering_endpoint_id,
-                                chip::app::Clusters::WindowCovering::Id,
-                                chip::app::Clusters::WindowCovering::Attributes::Mode::Id,
-                                &new_val);
-                
-                ESP_LOGI(TAG, "✓ Mode attribute updated: 0x%02X → 0x%02X", 
-                        current_mode.val.u8, new_mode);
-            }
+
+    WSCommand* command = ws_command_match(cmd, ws_pkt.len, json);
+
+    if (!command) {
+        ws_unknown_commands++;
+        ESP_LOGW(TAG, "Unknown command: '%s'", cmd[0] == '{' ? json.getString("cmd", "") : cmd);
+        return ESP_OK;
+    }
+
+    int64_t startUs = esp_timer_get_time();
+    esp_err_t result = command->fn(self, req, fd, cmd, json);
+    uint32_t elapsedUs = (uint32_t)(esp_timer_get_time() - startUs);
+
+    command->count++;
+    command->totalUs += elapsedUs;
+    if (elapsedUs > command->maxUs) command->maxUs = elapsedUs;
+
+    ESP_LOGD(TAG, "WS command '%s' handled in %u us", command->name, elapsedUs);
+
+    return result;
+}
+
+// ============================================================================
+// WebSocket Command Handlers
+// ============================================================================
+//
+// cmd ist der komplette, nullterminierte Frame im Empfangspuffer des
+// Dispatchers (nur bis zum Ende des Handlers gültig). Bei JSON-Kommandos
+// ist er bereits in json zerlegt (in place entescaped) - Werte über
+// json.getString() usw. lesen, nicht mehr aus cmd.
+
+// Dezimalzahl ohne Vorzeichen/Leerzeichen, komplett bis zum Frame-Ende
+static bool ws_parse_uint(const char* arg, unsigned long max, unsigned long& out) {
+    if (!isdigit((unsigned char)arg[0])) return false;
+    char* end = nullptr;
+    unsigned long value = strtoul(arg, &end, 10);
+    if (*end != '\0' || value > max) return false;
+    out = value;
+    return true;
+}
+
+// Shutter Commands
+esp_err_t WSCommandHandlers::up(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
+    ESP_LOGI(TAG, "→ Command: UP (move to 0%%)");
+    esp_err_t result = shutter_driver_go_to_lift_percent(self->handle, 0);
+    ESP_LOGI(TAG, "← Result: %s", result == ESP_OK ? "SUCCESS" : "FAILED");
+    return ESP_OK;
+}
+
+esp_err_t WSCommandHandlers::down(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
+    ESP_LOGI(TAG, "→ Command: DOWN (move to 100%%)");
+    esp_err_t result = shutter_driver_go_to_lift_percent(self->handle, 100);
+    ESP_LOGI(TAG, "← Result: %s", result == ESP_OK ? "SUCCESS" : "FAILED");
+    return ESP_OK;
+}
+
+// "pos:<0..100>" - Dispatcher garantiert Präfix + nicht-leeres Argument
+esp_err_t WSCommandHandlers::pos(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
+    const char* arg = cmd + strlen("pos:");
+    unsigned long target_pos;
+    if (!ws_parse_uint(arg, 100, target_pos)) {
+        ESP_LOGW(TAG, "✗ Invalid position '%s' (expected pos:0..100)", arg);
+        ws_reply_error(self, fd, "Invalid position (expected pos:0..100)");
+        return ESP_OK;
+    }
+    ESP_LOGI(TAG, "→ Command: SLIDER POSITION (move to %lu%%)", target_pos);
+    esp_err_t result = shutter_driver_go_to_lift_percent(self->handle, (uint8_t)target_pos);
+    ESP_LOGI(TAG, "← Result: %s", result == ESP_OK ? "SUCCESS" : "FAILED");
+    return ESP_OK;
+}
+
+esp_err_t WSCommandHandlers::stop(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
+    ESP_LOGI(TAG, "→ Command: STOP");
+    esp_err_t result = shutter_driver_stop_motion(self->handle);
+    uint8_t current_pos = shutter_driver_get_current_percent(self->handle);
+    ESP_LOGI(TAG, "← Stopped at %d%% | Result: %s", current_pos, 
+            result == ESP_OK ? "SUCCESS" : "FAILED");
+    return ESP_OK;
+}
+
+esp_err_t WSCommandHandlers::calibrate(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
+    ESP_LOGI(TAG, "→ Command: START CALIBRATION (from top)");
+    bool was_calibrated = shutter_driver_is_calibrated(self->handle);
+    esp_err_t result = shutter_driver_start_calibration(self->handle);
+    ESP_LOGI(TAG, "← Calibration started | Previously calibrated: %s | Result: %s",
+            was_calibrated ? "YES" : "NO",
+            result == ESP_OK ? "SUCCESS" : "FAILED");
+    return ESP_OK;
+}
+
+esp_err_t WSCommandHandlers::calibrate_from_bottom(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
+    ESP_LOGI(TAG, "→ Command: START CALIBRATION (from bottom / DOWN first)");
+    bool was_calibrated = shutter_driver_is_calibrated(self->handle);
+    esp_err_t result = shutter_driver_start_calibration_from_bottom(self->handle);
+    ESP_LOGI(TAG, "← Calibration (from bottom) started | Previously calibrated: %s | Result: %s",
+            was_calibrated ? "YES" : "NO",
+            result == ESP_OK ? "SUCCESS" : "FAILED");
+    return ESP_OK;
+}
+
+esp_err_t WSCommandHandlers::invert_on(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
+        ESP_LOGI(TAG, "WebUI: Setting direction to INVERTED");
+
+    // ════════════════════════════════════════════════════════════════
+    // 1. Update Mode Attribut in Matter
+    // ════════════════════════════════════════════════════════════════
+
+    cluster_t* wc_cluster = cluster::get(window_covering_endpoint_id, 
+                                        chip::app::Clusters::WindowCovering::Id);
+    if (wc_cluster) {
+        attribute_t* mode_attr = attribute::get(wc_cluster, 
+                                            chip::app::Clusters::WindowCovering::Attributes::Mode::Id);
+        if (mode_attr) {
+            // Aktuellen Mode lesen
+            esp_matter_attr_val_t current_mode;
+            attribute::get_val(mode_attr, &current_mode);
+
+            // Bit 0 setzen (MotorDirectionReversed)
+            uint8_t new_mode = current_mode.val.u8 | 0x01;
+
+            esp_matter_attr_val_t new_val = esp_matter_bitmap8(new_mode);
+
+            // Attribut updaten (triggert app_attribute_update_cb!)
+            attribute::update(window_covering_endpoint_id,
+                            chip::app::Clusters::WindowCovering::Id,
+                            chip::app::Clusters::WindowCovering::Attributes::Mode::Id,
+                            &new_val);
+
+            ESP_LOGI(TAG, "✓ Mode attribute updated: 0x%02X → 0x%02X", 
+                    current_mode.val.u8, new_mode);
         }
-        
-        // ════════════════════════════════════════════════════════════════
-        // 2. WebUI Response
-        // ════════════════════════════════════════════════════════════════
-        
-        vTaskDelay(pdMS_TO_TICKS(100));
-        
-        bool inverted = shutter_driver_get_direction_inverted(self->handle);
-        
-        // ✅ Response Buffer definieren
-        char response[128];
-        snprintf(response, sizeof(response), 
-                "{\"type\":\"direction\",\"inverted\":%s}",
-                inverted ? "true" : "false");
-        
-        // WebSocket Frame vorbereiten
-        httpd_ws_frame_t ws_pkt;
-        memset(&ws_pkt, 0, sizeof(httpd_ws_frame_t));
-        ws_pkt.payload = (uint8_t*)response;
-        ws_pkt.len = strlen(response);
-        ws_pkt.type = HTTPD_WS_TYPE_TEXT;
-        
-        httpd_ws_send_frame(req, &ws_pkt);
     }
-    else if (strcmp(cmd, "reset") == 0) {
-        ESP_LOGW(TAG, "=== Factory Reset Initiated via WebUI ===");
-        
-        // send confirmation message to client
-        const char* confirm_msg = "{\"type\":\"info\",\"message\":\"Resetting device...\"}";
-        httpd_ws_frame_t confirm_frame = {
-            .type = HTTPD_WS_TYPE_TEXT,
-            .payload = (uint8_t*)confirm_msg,
-            .len = strlen(confirm_msg)
-        };
-        httpd_ws_send_frame_async(req->handle, fd, &confirm_frame);
-        
-        // wait a moment to ensure message is sent
-        vTaskDelay(pdMS_TO_TICKS(1000));
-        
-        // ✅ CALL COMPLETE FACTORY RESET
-        extern void performCompleteFactoryReset();
-        performCompleteFactoryReset();
-        
-        // will never reach here (factory_reset() makes esp_restart())
+
+    // ════════════════════════════════════════════════════════════════
+    // 2. WebUI Response
+    // ════════════════════════════════════════════════════════════════
+
+    vTaskDelay(pdMS_TO_TICKS(100));  // Kurz warten bis Update propagiert ist
+
+    bool inverted = shutter_driver_get_direction_inverted(self->handle);
+
+    // ✅ Response Buffer definieren
+    char response[128];
+    snprintf(response, sizeof(response), 
+            "{\"type\":\"direction\",\"inverted\":%s}",
+            inverted ? "true" : "false");
+
+    self->sendToClient(fd, response, strlen(response));
+    return ESP_OK;
+}
+
+esp_err_t WSCommandHandlers::invert_off(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
+        ESP_LOGI(TAG, "WebUI: Setting direction to NORMAL");
+
+    // ════════════════════════════════════════════════════════════════
+    // 1. Update Mode Attribut in Matter
+    // ════════════════════════════════════════════════════════════════
+
+    cluster_t* wc_cluster = cluster::get(window_covering_endpoint_id, 
+                                        chip::app::Clusters::WindowCovering::Id);
+    if (wc_cluster) {
+        attribute_t* mode_attr = attribute::get(wc_cluster, 
+                                            chip::app::Clusters::WindowCovering::Attributes::Mode::Id);
+        if (mode_attr) {
+            // Aktuellen Mode lesen
+            esp_matter_attr_val_t current_mode;
+            attribute::get_val(mode_attr, &current_mode);
+
+            // Bit 0 löschen (MotorDirectionReversed)
+            uint8_t new_mode = current_mode.val.u8 & ~0x01;
+
+            esp_matter_attr_val_t new_val = esp_matter_bitmap8(new_mode);
+
+            // Attribut updaten (triggert app_attribute_update_cb!)
+            attribute::update(window_covering_endpoint_id,
+                            chip::app::Clusters::WindowCovering::Id,
+                            chip::app::Clusters::WindowCovering::Attributes::Mode::Id,
+                            &new_val);
+
+            ESP_LOGI(TAG, "✓ Mode attribute updated: 0x%02X → 0x%02X", 
+                    current_mode.val.u8, new_mode);
+        }
+    }
+
+    // ════════════════════════════════════════════════════════════════
+    // 2. WebUI Response
+    // ════════════════════════════════════════════════════════════════
+
+    vTaskDelay(pdMS_TO_TICKS(100));
+
+    bool inverted = shutter_driver_get_direction_inverted(self->handle);
+
+    // ✅ Response Buffer definieren
+    char response[128];
+    snprintf(response, sizeof(response), 
+            "{\"type\":\"direction\",\"inverted\":%s}",
+            inverted ? "true" : "false");
+
+    self->sendToClient(fd, response, strlen(response));
+    return ESP_OK;
+}
+
+esp_err_t WSCommandHandlers::reset(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
+    ESP_LOGW(TAG, "=== Factory Reset Initiated via WebUI ===");
+
+    // send confirmation message to client
+    const char* confirm_msg = "{\"type\":\"info\",\"message\":\"Resetting device...\"}";
+    self->sendToClient(fd, confirm_msg, strlen(confirm_msg));
+
+    // Reset im Job-Worker - der httpd-Task bleibt frei
+    self->submit_job("reset", reset_job, fd);
+    return ESP_OK;
+}
+
+// Läuft im Job-Worker (ws_jobs.h)
+bool WSCommandHandlers::reset_job(WSJob& job) {
+    // wait a moment to ensure message is sent
+    if (!job.sleep(1000)) {
+        ESP_LOGW(TAG, "Factory reset cancelled");
+        return false;
     }
-    else if (strcmp(cmd, "get_device_name") == 0) {
+
+    // ✅ CALL COMPLETE FACTORY RESET
+    extern void performCompleteFactoryReset();
+    performCompleteFactoryReset();
+
+    // will never reach here (factory_reset() makes esp_restart())
+    return true;
+}
+
+esp_err_t WSCommandHandlers::get_device_name(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
     ESP_LOGI(TAG, "WebSocket: Get device name requested");
-    
+
     extern DeviceNaming* deviceNaming;
     if (!deviceNaming) {
         const char* error = "{\"type\":\"error\",\"message\":\"Device naming not initialized\"}";
-        httpd_ws_frame_t frame = {
-            .type = HTTPD_WS_TYPE_TEXT,
-            .payload = (uint8_t*)error,
-            .len = strlen(error)
-        };
-        httpd_ws_send_frame_async(req->handle, fd, &frame);
-        free(buf);
+        self->sendToClient(fd, error, strlen(error));
         return ESP_OK;
     }
-    
+
     DeviceNaming::DeviceName names = deviceNaming->getNames();
-    
+
     char json_buf[512];
     snprintf(json_buf, sizeof(json_buf),
             "{\"type\":\"device_name\","
@@ -1123,299 +1833,261 @@ esp_err_t WebUIHandler::ws_handler(httpd_req_t *req) {
             names.position.c_str(),
             names.hostname.c_str(),
             names.matterName.c_str());
-    
-    httpd_ws_frame_t frame = {
-        .type = HTTPD_WS_TYPE_TEXT,
-        .payload = (uint8_t*)json_buf,
-        .len = strlen(json_buf)
-    };
-    httpd_ws_send_frame(req, &frame);
+
+    self->sendToClient(fd, json_buf, strlen(json_buf));
+    return ESP_OK;
 }
-    else if (strcmp(cmd, "status") == 0) {
-        char status_buf[128];
-        snprintf(status_buf, sizeof(status_buf),
-                 "{\"type\":\"status\",\"pos\":%d,\"cal\":%s,\"inv\":%s}",
-                 shutter_driver_get_current_percent(self->handle),
-                 shutter_driver_is_calibrated(self->handle) ? "true" : "false",
-                 shutter_driver_get_direction_inverted(self->handle) ? "true" : "false");
-
-        httpd_ws_frame_t status_frame = {
-            .type = HTTPD_WS_TYPE_TEXT,
-            .payload = (uint8_t*)status_buf,
-            .len = strlen(status_buf)
-        };
-        httpd_ws_send_frame(req, &status_frame);
+
+esp_err_t WSCommandHandlers::status(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
+    // Vollständiger Status (gleiches Format wie StatusPublisher)
+    StatusSnapshot snapshot = StatusPublisher::sample(self->handle, self->bleManager);
+
+    if (self->is_binary_client(fd)) {
+        WSBinStatus bin;
+        StatusPublisher::encode(bin, snapshot, STATUS_FIELD_ALL);
+
+        self->sendToClient(fd, &bin, sizeof(bin), HTTPD_WS_TYPE_BINARY);
+        return ESP_OK;
     }
-    else if (strcmp(cmd, "matter_status") == 0) {
-        uint8_t fabric_count = chip::Server::GetInstance().GetFabricTable().FabricCount();
-        bool commissioned = Matter.isDeviceCommissioned() && (fabric_count > 0);
-        
-        String qrUrl = "";
-        String qrImageUrl = "";
-        String pairingCode = "";
-        
-        ESP_LOGI(TAG, "=== matter_status Command ===");
-        ESP_LOGI(TAG, "Commissioned: %s", commissioned ? "true" : "false");
-        ESP_LOGI(TAG, "Fabrics: %d", fabric_count);
-        
-        if (!commissioned) {
-            String fullUrl = Matter.getOnboardingQRCodeUrl();
-            pairingCode = Matter.getManualPairingCode();
-            
-            ESP_LOGI(TAG, "Full URL: %s", fullUrl.c_str());
-            ESP_LOGI(TAG, "Pairing Code: %s", pairingCode.c_str());
-            
-            qrUrl = fullUrl;
-            
-            int dataIdx = fullUrl.indexOf("data=");
-            if (dataIdx > 0) {
-                String payload = fullUrl.substring(dataIdx + 5);
-                
-                qrImageUrl = "https://quickchart.io/qr?text=" + payload + "&size=300";
-                
-                ESP_LOGI(TAG, "Payload: %s", payload.c_str());
-                ESP_LOGI(TAG, "Image URL: %s", qrImageUrl.c_str());
-            } else {
-                ESP_LOGW(TAG, "Could not find 'data=' in URL!");
-            }
-        }
-        
-        char matter_buf[768];
-        int len = snprintf(matter_buf, sizeof(matter_buf),
-                          "{\"type\":\"matter_status\","
-                          "\"commissioned\":%s,"
-                          "\"fabrics\":%d,"
-                          "\"qr_url\":\"%s\","
-                          "\"qr_image\":\"%s\","
-                          "\"pairing_code\":\"%s\"}",
-                          commissioned ? "true" : "false",
-                          fabric_count,
-                          qrUrl.c_str(),
-                          qrImageUrl.c_str(),
-                          pairingCode.c_str());
-        
-        ESP_LOGI(TAG, "Sending JSON (%d bytes): %s", len, matter_buf);
-        
-        httpd_ws_frame_t matter_frame = {
-            .type = HTTPD_WS_TYPE_TEXT,
-            .payload = (uint8_t*)matter_buf,
-            .len = (size_t)len
-        };
 
-        esp_err_t ret = httpd_ws_send_frame(req, &matter_frame);
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to send matter_status: %s", esp_err_to_name(ret));
+    char status_buf[STATUS_MSG_MAX];
+    size_t len = StatusPublisher::format(status_buf, sizeof(status_buf), snapshot, STATUS_FIELD_ALL);
+
+    self->sendToClient(fd, status_buf, len);
+    return ESP_OK;
+}
+
+esp_err_t WSCommandHandlers::matter_status(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
+    uint8_t fabric_count = chip::Server::GetInstance().GetFabricTable().FabricCount();
+    bool commissioned = Matter.isDeviceCommissioned() && (fabric_count > 0);
+
+    String qrUrl = "";
+    String qrImageUrl = "";
+    String pairingCode = "";
+
+    ESP_LOGI(TAG, "=== matter_status Command ===");
+    ESP_LOGI(TAG, "Commissioned: %s", commissioned ? "true" : "false");
+    ESP_LOGI(TAG, "Fabrics: %d", fabric_count);
+
+    if (!commissioned) {
+        String fullUrl = Matter.getOnboardingQRCodeUrl();
+        pairingCode = Matter.getManualPairingCode();
+
+        ESP_LOGI(TAG, "Full URL: %s", fullUrl.c_str());
+        ESP_LOGI(TAG, "Pairing Code: %s", pairingCode.c_str());
+
+        qrUrl = fullUrl;
+
+        int dataIdx = fullUrl.indexOf("data=");
+        if (dataIdx > 0) {
+            String payload = fullUrl.substring(dataIdx + 5);
+
+            qrImageUrl = "https://quickchart.io/qr?text=" + payload + "&size=300";
+
+            ESP_LOGI(TAG, "Payload: %s", payload.c_str());
+            ESP_LOGI(TAG, "Image URL: %s", qrImageUrl.c_str());
+        } else {
+            ESP_LOGW(TAG, "Could not find 'data=' in URL!");
         }
     }
-    else if (strcmp(cmd, "matter_open_commissioning") == 0) {
-        extern volatile bool matter_stack_started;
-        if (!matter_stack_started) {
-            const char* err = "{\"type\":\"error\",\"message\":\"Matter stack is not running. Enable Matter first.\"}";
-            httpd_ws_frame_t f = { .type = HTTPD_WS_TYPE_TEXT, .payload = (uint8_t*)err, .len = strlen(err) };
-            httpd_ws_send_frame_async(req->handle, fd, &f);
-        } else if (Matter.isDeviceCommissioned()) {
-            const char* err = "{\"type\":\"error\",\"message\":\"Device is already commissioned.\"}";
-            httpd_ws_frame_t f = { .type = HTTPD_WS_TYPE_TEXT, .payload = (uint8_t*)err, .len = strlen(err) };
-            httpd_ws_send_frame_async(req->handle, fd, &f);
-        } else {
-            // Release port 5353 before opening the commissioning window.
-            //
-            // Root cause of ERR_USE (0x3000008):
-            //   The Arduino ESP-IDF mDNS library (mdns_networking_lwip.c) creates its
-            //   UDP PCB via udp_new() WITHOUT SOF_REUSEADDR.  LwIP udp_bind() returns
-            //   ERR_USE whenever ANY existing PCB on the same port lacks SOF_REUSEADDR,
-            //   even if the new PCB has it.  Arduino MDNS starts in the 1-second window
-            //   after esp_matter::start(), binds port 5353 first, and permanently blocks
-            //   CHIP's minimal mDNS from ever binding.
-            //
-            // Fix: stop Arduino MDNS (releases the PCB), then stop CHIP's advertiser if
-            //   it somehow managed to initialize, so Init() gets a fully clean slate.
-            MDNS.end();
-
-            chip::DeviceLayer::PlatformMgr().LockChipStack();
-            if (chip::Dnssd::ServiceAdvertiser::Instance().IsInitialized()) {
-                chip::Dnssd::ServiceAdvertiser::Instance().Shutdown();
-            }
 
-            ESP_LOGI(TAG, "→ Opening commissioning window (DNS-SD, 900 s)...");
-            CHIP_ERROR cwErr = chip::Server::GetInstance()
-                .GetCommissioningWindowManager()
-                .OpenBasicCommissioningWindow(
-                    chip::System::Clock::Seconds32(900),
-                    chip::CommissioningWindowAdvertisement::kDnssdOnly);
-
-            // Generate QR code with kOnNetwork-only rendezvous so Apple Home (iOS)
-            // skips BLE discovery and commissions directly over WiFi/DNS-SD.
-            // Matter.getOnboardingQRCodeUrl() is hardcoded with kBLE set, which causes
-            // iOS to try BLE first, time out, and abort the commissioning session.
-            char qrCodeBuf[chip::QRCodeBasicSetupPayloadGenerator::kMaxQRCodeBase38RepresentationLength + 1] = {};
-            chip::MutableCharSpan qrCodeSpan(qrCodeBuf, sizeof(qrCodeBuf) - 1);
-            String qrUrl, qrMt;
-            if (GetQRCode(qrCodeSpan,
-                          chip::RendezvousInformationFlags(chip::RendezvousInformationFlag::kOnNetwork)) == CHIP_NO_ERROR) {
-                char urlBuf[192];
-                snprintf(urlBuf, sizeof(urlBuf),
-                         "https://project-chip.github.io/connectedhomeip/qrcode.html?data=%s",
-                         qrCodeBuf);
-                qrUrl = String(urlBuf);
-                qrMt  = String(qrCodeBuf);
-            } else {
-                // Fallback to hardcoded value (may include kBLE, but better than nothing)
-                qrUrl = Matter.getOnboardingQRCodeUrl();
-                int mtIdx = qrUrl.indexOf("MT:");
-                qrMt = (mtIdx >= 0) ? qrUrl.substring(mtIdx) : qrUrl;
-            }
-            String pairingCode = Matter.getManualPairingCode();
-            chip::DeviceLayer::PlatformMgr().UnlockChipStack();
-
-            if (cwErr == CHIP_NO_ERROR) {
-                ESP_LOGI(TAG, "✓ Commissioning window opened");
-                char okBuf[1024];
-                snprintf(okBuf, sizeof(okBuf),
-                         "{\"type\":\"matter_commissioning_ready\","
-                         "\"qr_url\":\"%s\","
-                         "\"qr_mt\":\"%s\","
-                         "\"pairing_code\":\"%s\"}",
-                         qrUrl.c_str(),
-                         qrMt.c_str(),
-                         pairingCode.c_str());
-                // Use synchronous send: okBuf is on the stack and must stay valid
-                // during send. httpd_ws_send_frame() sends immediately without queuing.
-                httpd_ws_frame_t f = { .type = HTTPD_WS_TYPE_TEXT, .payload = (uint8_t*)okBuf, .len = strlen(okBuf) };
-                httpd_ws_send_frame(req, &f);
-            } else {
-                char errBuf[256];
-                snprintf(errBuf, sizeof(errBuf),
-                         "{\"type\":\"error\",\"message\":\"Could not open commissioning window: %s\"}",
-                         chip::ErrorStr(cwErr));
-                httpd_ws_frame_t f = { .type = HTTPD_WS_TYPE_TEXT, .payload = (uint8_t*)errBuf, .len = strlen(errBuf) };
-                httpd_ws_send_frame(req, &f);
-            }
-        }
+    char matter_buf[768];
+    int len = snprintf(matter_buf, sizeof(matter_buf),
+                      "{\"type\":\"matter_status\","
+                      "\"commissioned\":%s,"
+                      "\"fabrics\":%d,"
+                      "\"qr_url\":\"%s\","
+                      "\"qr_image\":\"%s\","
+                      "\"pairing_code\":\"%s\"}",
+                      commissioned ? "true" : "false",
+                      fabric_count,
+                      qrUrl.c_str(),
+                      qrImageUrl.c_str(),
+                      pairingCode.c_str());
+
+    ESP_LOGI(TAG, "Sending JSON (%d bytes): %s", len, matter_buf);
+
+    if (!self->sendToClient(fd, matter_buf, (size_t)len)) {
+        ESP_LOGE(TAG, "Failed to queue matter_status for fd=%d", fd);
     }
-    else if (strcmp(cmd, "info") == 0) {
-        esp_chip_info_t chip;
-        esp_chip_info(&chip);
-        
-        uint8_t mac[6];
-        esp_read_mac(mac, ESP_MAC_WIFI_STA);
-        char chipid[18];
-        snprintf(chipid, 18, "%02X:%02X:%02X:%02X:%02X:%02X", 
-                 mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-        
-        const esp_app_desc_t* app = esp_app_get_description();
-        
-        const char* reset_reason_str;
-        switch (esp_reset_reason()) {
-            case ESP_RST_POWERON:   reset_reason_str = "Power On"; break;
-            case ESP_RST_SW:        reset_reason_str = "Software Reset"; break;
-            case ESP_RST_PANIC:     reset_reason_str = "Exception/Panic"; break;
-            case ESP_RST_INT_WDT:   reset_reason_str = "Interrupt WDT"; break;
-            case ESP_RST_TASK_WDT:  reset_reason_str = "Task WDT"; break;
-            case ESP_RST_WDT:       reset_reason_str = "Other WDT"; break;
-            case ESP_RST_DEEPSLEEP: reset_reason_str = "Deep Sleep"; break;
-            case ESP_RST_BROWNOUT:  reset_reason_str = "Brownout"; break;
-            default:                reset_reason_str = "Unknown"; break;
+    return ESP_OK;
+}
+
+esp_err_t WSCommandHandlers::matter_open_commissioning(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
+    extern volatile bool matter_stack_started;
+    if (!matter_stack_started) {
+        const char* err = "{\"type\":\"error\",\"message\":\"Matter stack is not running. Enable Matter first.\"}";
+        self->sendToClient(fd, err, strlen(err));
+    } else if (Matter.isDeviceCommissioned()) {
+        const char* err = "{\"type\":\"error\",\"message\":\"Device is already commissioned.\"}";
+        self->sendToClient(fd, err, strlen(err));
+    } else {
+        // Release port 5353 before opening the commissioning window.
+        //
+        // Root cause of ERR_USE (0x3000008):
+        //   The Arduino ESP-IDF mDNS library (mdns_networking_lwip.c) creates its
+        //   UDP PCB via udp_new() WITHOUT SOF_REUSEADDR.  LwIP udp_bind() returns
+        //   ERR_USE whenever ANY existing PCB on the same port lacks SOF_REUSEADDR,
+        //   even if the new PCB has it.  Arduino MDNS starts in the 1-second window
+        //   after esp_matter::start(), binds port 5353 first, and permanently blocks
+        //   CHIP's minimal mDNS from ever binding.
+        //
+        // Fix: stop Arduino MDNS (releases the PCB), then stop CHIP's advertiser if
+        //   it somehow managed to initialize, so Init() gets a fully clean slate.
+        MDNS.end();
+
+        chip::DeviceLayer::PlatformMgr().LockChipStack();
+        if (chip::Dnssd::ServiceAdvertiser::Instance().IsInitialized()) {
+            chip::Dnssd::ServiceAdvertiser::Instance().Shutdown();
         }
-        
-        uint32_t flash_size = 0;
-        esp_flash_get_size(NULL, &flash_size);
 
-        char version_str[32];
-        #ifdef APP_VERSION
-            snprintf(version_str, sizeof(version_str), "%s", APP_VERSION);
-        #else
-            snprintf(version_str, sizeof(version_str), "%s", app->version);
-        #endif
-        
-        char info_buf[512];
-        snprintf(info_buf, sizeof(info_buf),
-                 "{\"type\":\"info\","
-                 "\"chip\":\"%s\","
-                 "\"uptime\":%llu,"
-                 "\"heap\":%u,"
-                 "\"minheap\":%u,"
-                 "\"flash\":%u,"
-                 "\"ver\":\"%s\"," 
-                 "\"reset\":\"%s\"}",
-                 chipid,
-                 esp_timer_get_time() / 1000000,
-                 esp_get_free_heap_size(),
-                 esp_get_minimum_free_heap_size(),
-                 flash_size,
-                 version_str,
-                 reset_reason_str);
-        
-        httpd_ws_frame_t info_frame = {
-            .type = HTTPD_WS_TYPE_TEXT,
-            .payload = (uint8_t*)info_buf,
-            .len = strlen(info_buf)
-        };
-        httpd_ws_send_frame_async(req->handle, fd, &info_frame);
+        ESP_LOGI(TAG, "→ Opening commissioning window (DNS-SD, 900 s)...");
+        CHIP_ERROR cwErr = chip::Server::GetInstance()
+            .GetCommissioningWindowManager()
+            .OpenBasicCommissioningWindow(
+                chip::System::Clock::Seconds32(900),
+                chip::CommissioningWindowAdvertisement::kDnssdOnly);
+
+        // Generate QR code with kOnNetwork-only rendezvous so Apple Home (iOS)
+        // skips BLE discovery and commissions directly over WiFi/DNS-SD.
+        // Matter.getOnboardingQRCodeUrl() is hardcoded with kBLE set, which causes
+        // iOS to try BLE first, time out, and abort the commissioning session.
+        char qrCodeBuf[chip::QRCodeBasicSetupPayloadGenerator::kMaxQRCodeBase38RepresentationLength + 1] = {};
+        chip::MutableCharSpan qrCodeSpan(qrCodeBuf, sizeof(qrCodeBuf) - 1);
+        String qrUrl, qrMt;
+        if (GetQRCode(qrCodeSpan,
+                      chip::RendezvousInformationFlags(chip::RendezvousInformationFlag::kOnNetwork)) == CHIP_NO_ERROR) {
+            char urlBuf[192];
+            snprintf(urlBuf, sizeof(urlBuf),
+                     "https://project-chip.github.io/connectedhomeip/qrcode.html?data=%s",
+                     qrCodeBuf);
+            qrUrl = String(urlBuf);
+            qrMt  = String(qrCodeBuf);
+        } else {
+            // Fallback to hardcoded value (may include kBLE, but better than nothing)
+            qrUrl = Matter.getOnboardingQRCodeUrl();
+            int mtIdx = qrUrl.indexOf("MT:");
+            qrMt = (mtIdx >= 0) ? qrUrl.substring(mtIdx) : qrUrl;
+        }
+        String pairingCode = Matter.getManualPairingCode();
+        chip::DeviceLayer::PlatformMgr().UnlockChipStack();
+
+        if (cwErr == CHIP_NO_ERROR) {
+            ESP_LOGI(TAG, "✓ Commissioning window opened");
+            char okBuf[1024];
+            snprintf(okBuf, sizeof(okBuf),
+                     "{\"type\":\"matter_commissioning_ready\","
+                     "\"qr_url\":\"%s\","
+                     "\"qr_mt\":\"%s\","
+                     "\"pairing_code\":\"%s\"}",
+                     qrUrl.c_str(),
+                     qrMt.c_str(),
+                     pairingCode.c_str());
+            // sendToClient() kopiert okBuf in einen Frame (> Pool-Slot → Heap)
+            self->sendToClient(fd, okBuf, strlen(okBuf));
+        } else {
+            char errBuf[256];
+            snprintf(errBuf, sizeof(errBuf),
+                     "{\"type\":\"error\",\"message\":\"Could not open commissioning window: %s\"}",
+                     chip::ErrorStr(cwErr));
+            self->sendToClient(fd, errBuf, strlen(errBuf));
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t WSCommandHandlers::info(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
+    esp_chip_info_t chip;
+    esp_chip_info(&chip);
+
+    uint8_t mac[6];
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    char chipid[18];
+    snprintf(chipid, 18, "%02X:%02X:%02X:%02X:%02X:%02X", 
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+
+    const esp_app_desc_t* app = esp_app_get_description();
+
+    const char* reset_reason_str;
+    switch (esp_reset_reason()) {
+        case ESP_RST_POWERON:   reset_reason_str = "Power On"; break;
+        case ESP_RST_SW:        reset_reason_str = "Software Reset"; break;
+        case ESP_RST_PANIC:     reset_reason_str = "Exception/Panic"; break;
+        case ESP_RST_INT_WDT:   reset_reason_str = "Interrupt WDT"; break;
+        case ESP_RST_TASK_WDT:  reset_reason_str = "Task WDT"; break;
+        case ESP_RST_WDT:       reset_reason_str = "Other WDT"; break;
+        case ESP_RST_DEEPSLEEP: reset_reason_str = "Deep Sleep"; break;
+        case ESP_RST_BROWNOUT:  reset_reason_str = "Brownout"; break;
+        default:                reset_reason_str = "Unknown"; break;
     }
-    else if (CMD_MATCH(cmd, "{\"cmd\":\"save_device_name\"")) {
+
+    uint32_t flash_size = 0;
+    esp_flash_get_size(NULL, &flash_size);
+
+    char version_str[32];
+    #ifdef APP_VERSION
+        snprintf(version_str, sizeof(version_str), "%s", APP_VERSION);
+    #else
+        snprintf(version_str, sizeof(version_str), "%s", app->version);
+    #endif
+
+    char info_buf[512];
+    snprintf(info_buf, sizeof(info_buf),
+             "{\"type\":\"info\","
+             "\"chip\":\"%s\","
+             "\"uptime\":%llu,"
+             "\"heap\":%u,"
+             "\"minheap\":%u,"
+             "\"flash\":%u,"
+             "\"ver\":\"%s\"," 
+             "\"reset\":\"%s\"}",
+             chipid,
+             esp_timer_get_time() / 1000000,
+             esp_get_free_heap_size(),
+             esp_get_minimum_free_heap_size(),
+             flash_size,
+             version_str,
+             reset_reason_str);
+
+    self->sendToClient(fd, info_buf, strlen(info_buf));
+    return ESP_OK;
+}
+
+esp_err_t WSCommandHandlers::save_device_name(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
     ESP_LOGI(TAG, "");
     ESP_LOGI(TAG, "╔═══════════════════════════════════╗");
     ESP_LOGI(TAG, "║  SAVE DEVICE NAME COMMAND         ║");
     ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
     ESP_LOGI(TAG, "");
-    
-    ESP_LOGI(TAG, "Raw Command: %s", cmd);
-    ESP_LOGI(TAG, "Command Length: %d", strlen(cmd));
-    ESP_LOGI(TAG, "");
-    
+
     extern DeviceNaming* deviceNaming;
     if (!deviceNaming) {
         const char* error = "{\"type\":\"error\",\"message\":\"Device naming not initialized\"}";
-        httpd_ws_frame_t frame = {
-            .type = HTTPD_WS_TYPE_TEXT,
-            .payload = (uint8_t*)error,
-            .len = strlen(error)
-        };
-        httpd_ws_send_frame_async(req->handle, fd, &frame);
-        free(buf);
+        self->sendToClient(fd, error, strlen(error));
         return ESP_OK;
     }
-    
-    // Parse JSON
-    String json = String(cmd);
 
-    auto extractField = [&](const char* key, int keyLen) -> String {
-        int start = json.indexOf(key);
-        if (start < 0) return "";
-        start += keyLen;
-        int end = json.indexOf("\"", start);
-        if (end < start) return "";
-        return json.substring(start, end);
-    };
+    const char* room     = json.getString("room", "");
+    const char* type     = json.getString("type", "");
+    const char* position = json.getString("position", "");
+
+    ESP_LOGI(TAG, "  Room: %s", room);
+    ESP_LOGI(TAG, "  Type: %s", type);
+    ESP_LOGI(TAG, "  Position: %s", position);
 
-    String room     = extractField("\"room\":\"",     8);
-    String type     = extractField("\"type\":\"",     8);
-    String position = extractField("\"position\":\"", 12);
-    
-    ESP_LOGI(TAG, "  Room: %s", room.c_str());
-    ESP_LOGI(TAG, "  Type: %s", type.c_str());
-    ESP_LOGI(TAG, "  Position: %s", position.c_str());
-    
     // Validate and save
     if (!deviceNaming->save(room, type, position)) {
         const char* error = "{\"type\":\"error\",\"message\":\"Invalid device name parameters\"}";
-        httpd_ws_frame_t frame = {
-            .type = HTTPD_WS_TYPE_TEXT,
-            .payload = (uint8_t*)error,
-            .len = strlen(error)
-        };
-        httpd_ws_send_frame_async(req->handle, fd, &frame);
-        free(buf);
+        self->sendToClient(fd, error, strlen(error));
         return ESP_OK;
     }
-    
+
     // Apply to system (mDNS + Matter)
     deviceNaming->apply();
-    
+
     // Get updated names
     DeviceNaming::DeviceName names = deviceNaming->getNames();
-    
+
     // Send confirmation
     char success_msg[512];
     snprintf(success_msg, sizeof(success_msg),
@@ -1424,343 +2096,288 @@ esp_err_t WebUIHandler::ws_handler(httpd_req_t *req) {
             "\"matterName\":\"%s\"}",
             names.hostname.c_str(),
             names.matterName.c_str());
-    
-    httpd_ws_frame_t frame = {
-        .type = HTTPD_WS_TYPE_TEXT,
-        .payload = (uint8_t*)success_msg,
-        .len = strlen(success_msg)
-    };
-    httpd_ws_send_frame_async(req->handle, fd, &frame);
-    
+
+    self->sendToClient(fd, success_msg, strlen(success_msg));
+
     ESP_LOGI(TAG, "✓ Device name saved and applied");
+    return ESP_OK;
 }
-    else if (CMD_MATCH(cmd, "{\"cmd\":\"change_webui_password\"")) {
-    String json = String(cmd);
-    
+
+esp_err_t WSCommandHandlers::change_webui_password(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
     // Parse new username/password
-    int userStart = json.indexOf("\"username\":\"") + 12;
-    int userEnd = json.indexOf("\"", userStart);
-    String new_username = json.substring(userStart, userEnd);
-    
-    int passStart = json.indexOf("\"password\":\"") + 12;
-    int passEnd = json.indexOf("\"", passStart);
-    String new_password = json.substring(passStart, passEnd);
-    
+    const char* new_username = json.getString("username", "");
+    const char* new_password = json.getString("password", "");
+
     // Validate
-    if (new_username.length() < 3 || new_password.length() < 6) {
+    if (strlen(new_username) < 3 || strlen(new_password) < 6) {
         const char* error = "{\"type\":\"error\",\"message\":\"Username min 3 chars, password min 6 chars\"}";
-        httpd_ws_frame_t frame = {
-            .type = HTTPD_WS_TYPE_TEXT,
-            .payload = (uint8_t*)error,
-            .len = strlen(error)
-        };
-        httpd_ws_send_frame_async(req->handle, fd, &frame);
-        free(buf);
+        self->sendToClient(fd, error, strlen(error));
         return ESP_OK;
     }
-    
+
     // Save to NVS
-    if (saveAuthToNVS(new_username.c_str(), new_password.c_str())) {
+    if (saveAuthToNVS(new_username, new_password)) {
         ESP_LOGI(TAG, "✓ WebUI credentials changed");
-        ESP_LOGI(TAG, "  New username: %s", new_username.c_str());
-        
+        ESP_LOGI(TAG, "  New username: %s", new_username);
+
         const char* success = "{\"type\":\"success\",\"message\":\"Credentials updated! Please log in again.\"}";
-        httpd_ws_frame_t frame = {
-            .type = HTTPD_WS_TYPE_TEXT,
-            .payload = (uint8_t*)success,
-            .len = strlen(success)
-        };
-        httpd_ws_send_frame_async(req->handle, fd, &frame);
+        self->sendToClient(fd, success, strlen(success));
 
         // Disconnect all clients after a short delay so the success message
         // reaches the browser before the connection closes.
-        // Done in a separate task to avoid blocking the httpd task.
-        struct DisconnectParams { WebUIHandler* handler; };
-        auto* dp = new DisconnectParams{self};
-        xTaskCreate([](void* arg) {
-            auto* p = static_cast<DisconnectParams*>(arg);
-            vTaskDelay(pdMS_TO_TICKS(2000));
-            p->handler->disconnect_all_clients();
-            delete p;
-            vTaskDelete(NULL);
-        }, "ws_dc", 2048, dp, 1, NULL);
-        
+        // Done in a job worker to avoid blocking the httpd task.
+        self->submit_job("disconnect_clients", disconnect_clients_job, fd);
+
     } else {
         const char* error = "{\"type\":\"error\",\"message\":\"Failed to save credentials\"}";
-        httpd_ws_frame_t frame = {
-            .type = HTTPD_WS_TYPE_TEXT,
-            .payload = (uint8_t*)error,
-            .len = strlen(error)
-        };
-        httpd_ws_send_frame_async(req->handle, fd, &frame);
+        self->sendToClient(fd, error, strlen(error));
     }
+    return ESP_OK;
 }
 
-    else if (strcmp(cmd, "restart") == 0) {
-        ESP_LOGI(TAG, "");
-        ESP_LOGI(TAG, "╔═══════════════════════════════════╗");
-        ESP_LOGI(TAG, "║   DEVICE RESTART REQUESTED        ║");
-        ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
-        ESP_LOGI(TAG, "");
-        ESP_LOGI(TAG, "User triggered restart via WebUI");
-        ESP_LOGI(TAG, "");
-        
-        // Send confirmation to client
-        const char* confirm_msg = 
-            "{\"type\":\"info\",\"message\":\"Device restarting...\"}";
-        
-        httpd_ws_frame_t confirm_frame = {
-            .type = HTTPD_WS_TYPE_TEXT,
-            .payload = (uint8_t*)confirm_msg,
-            .len = strlen(confirm_msg)
-        };
-        httpd_ws_send_frame_async(req->handle, fd, &confirm_frame);
-        
-        // Wait a moment to ensure message is sent
-        vTaskDelay(pdMS_TO_TICKS(500));
-        
-        ESP_LOGI(TAG, "🔄 Restarting ESP32 in 2 seconds...");
-        ESP_LOGI(TAG, "");
-        
-        vTaskDelay(pdMS_TO_TICKS(2000));
-        
-        // Restart
-        esp_restart();
-        
-        // Never reached
-    }
+// Läuft im Job-Worker (ws_jobs.h)
+bool WSCommandHandlers::disconnect_clients_job(WSJob& job) {
+    WebUIHandler* self = (WebUIHandler*)job.args().ctx;
+    if (!job.sleep(2000)) return false;
+    self->disconnect_all_clients();
+    return true;
+}
 
-    else if (strcmp(cmd, "discover_devices") == 0) {
-    ESP_LOGI(TAG, "WebSocket: Device Discovery requested");
-    
-    WebUIHandler* handler = self;
-    
-    xTaskCreate([](void* param) {
-        WebUIHandler* h = (WebUIHandler*)param;
-        
-        ESP_LOGI(TAG, "Discovery task started");
-        
-        // Remove from Watchdog (scan kann lange dauern)
-        esp_task_wdt_delete(NULL);
-        
-        // Run discovery
-        h->broadcastDiscoveredDevices();
-        
-        ESP_LOGI(TAG, "Discovery task complete");
+esp_err_t WSCommandHandlers::restart(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
+    ESP_LOGI(TAG, "");
+    ESP_LOGI(TAG, "╔═══════════════════════════════════╗");
+    ESP_LOGI(TAG, "║   DEVICE RESTART REQUESTED        ║");
+    ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
+    ESP_LOGI(TAG, "");
+    ESP_LOGI(TAG, "User triggered restart via WebUI");
+    ESP_LOGI(TAG, "");
 
-        UBaseType_t highWater = uxTaskGetStackHighWaterMark(NULL);
-        ESP_LOGI(TAG, "Task -device_disc- Stack High Water Mark: %u bytes", highWater * sizeof(StackType_t));
+    // Send confirmation to client
+    const char* confirm_msg = 
+        "{\"type\":\"info\",\"message\":\"Device restarting...\"}";
 
-        if (highWater < 256) {  // < 1KB frei
-            ESP_LOGW(TAG, "⚠️ Stack critically low!");
-        }
-        
-        vTaskDelete(NULL);
-        
-    }, "device_disc", 8192, handler, 1, NULL); // Stack 8KB (broadcastDiscoveredDevices allocates 2KB json_buf + WiFi scan + mDNS query overhead)
+    self->sendToClient(fd, confirm_msg, strlen(confirm_msg));
+
+    // Wartezeit im Worker - der httpd-Task bleibt frei, Abbruch möglich
+    self->submit_job("restart", restart_job, fd);
+    return ESP_OK;
 }
-    
-    // ============================================================================
-    // BLE Commands
-    // ============================================================================
 
-    else if (strcmp(cmd, "ble_scan") == 0) {
-        if (self->bleManager) {
-            ESP_LOGI(TAG, "═══════════════════════════════════");
-            ESP_LOGI(TAG, "WebSocket: BLE DISCOVERY SCAN");
-            ESP_LOGI(TAG, "═══════════════════════════════════");
-            
-            // Ensure BLE is started BEFORE scanning
-            if (!self->bleManager->isBLEStarted()) {
-                ESP_LOGI(TAG, "");
-                ESP_LOGI(TAG, "→ BLE not started yet");
-                ESP_LOGI(TAG, "  Starting BLE for discovery scan...");
-                
-                if (!self->bleManager->ensureBLEStarted()) {
-                    ESP_LOGE(TAG, "✗ Failed to start BLE");
-                    
-                    const char* error = "{\"type\":\"error\",\"message\":\"Failed to start BLE\"}";
-                    httpd_ws_frame_t frame = {
-                        .type = HTTPD_WS_TYPE_TEXT,
-                        .payload = (uint8_t*)error,
-                        .len = strlen(error)
-                    };
-                    httpd_ws_send_frame_async(req->handle, fd, &frame);
-                    
-                    free(buf);
-                    return ESP_OK;
-                }
-                
-                ESP_LOGI(TAG, "✓ BLE started successfully");
-                ESP_LOGI(TAG, "");
-                
-                // Kurze Pause für BLE Stack
-                vTaskDelay(pdMS_TO_TICKS(1000));
+// Läuft im Job-Worker (ws_jobs.h)
+bool WSCommandHandlers::restart_job(WSJob& job) {
+    // Wait a moment to ensure message is sent
+    if (!job.sleep(500)) return false;
+
+    ESP_LOGI(TAG, "🔄 Restarting ESP32 in 2 seconds...");
+    ESP_LOGI(TAG, "");
+    job.progress(20, "Restarting in 2 seconds");
+
+    if (!job.sleep(2000)) {
+        ESP_LOGW(TAG, "Restart cancelled");
+        return false;
+    }
+
+    // Restart
+    esp_restart();
+
+    // Never reached
+    return true;
+}
+
+esp_err_t WSCommandHandlers::discover_devices(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
+    ESP_LOGI(TAG, "WebSocket: Device Discovery requested");
+
+    // Scan kann lange dauern → Worker (braucht den großen Stack, siehe WS_JOB_STACK_SIZE)
+    self->submit_job("discover_devices", discover_devices_job, fd);
+    return ESP_OK;
+}
+
+// Läuft im Job-Worker (ws_jobs.h)
+bool WSCommandHandlers::discover_devices_job(WSJob& job) {
+    WebUIHandler* self = (WebUIHandler*)job.args().ctx;
+
+    ESP_LOGI(TAG, "Discovery task started");
+
+    // Run discovery
+    self->broadcastDiscoveredDevices();
+
+    ESP_LOGI(TAG, "Discovery task complete");
+    return true;
+}
+
+// ============================================================================
+// BLE Commands
+// ============================================================================
+esp_err_t WSCommandHandlers::ble_scan(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
+    if (self->bleManager) {
+        ESP_LOGI(TAG, "═══════════════════════════════════");
+        ESP_LOGI(TAG, "WebSocket: BLE DISCOVERY SCAN");
+        ESP_LOGI(TAG, "═══════════════════════════════════");
+
+        // Ensure BLE is started BEFORE scanning
+        if (!self->bleManager->isBLEStarted()) {
+            ESP_LOGI(TAG, "");
+            ESP_LOGI(TAG, "→ BLE not started yet");
+            ESP_LOGI(TAG, "  Starting BLE for discovery scan...");
+
+            if (!self->bleManager->ensureBLEStarted()) {
+                ESP_LOGE(TAG, "✗ Failed to start BLE");
+
+                const char* error = "{\"type\":\"error\",\"message\":\"Failed to start BLE\"}";
+                self->sendToClient(fd, error, strlen(error));
+
+                return ESP_OK;
             }
-            
-            ESP_LOGI(TAG, "Starting 10-second discovery scan...");
-            ESP_LOGI(TAG, "Will stop on first Shelly BLU Door/Window found!");
-            
-            // Start Scan
-            self->bleManager->startScan(10, true);
-
-            // Task-Parameter für Scan-Monitoring
-            struct ScanMonitorParams {
-                WebUIHandler* handler;
-                ShellyBLEManager* bleManager;
-            };
-            
-            ScanMonitorParams* params = new ScanMonitorParams{
-                self,
-                self->bleManager
-            };
-            
-            // Memory Stats VOR Task-Erstellung
-            self->logMemoryStats("Before BLE Scan Monitor Task");
-            
-            BaseType_t taskRet = xTaskCreate([](void *param) {
-                // RAII-Pattern
-                std::unique_ptr<ScanMonitorParams> p(
-                    static_cast<ScanMonitorParams*>(param)
-                );
-                
-                ESP_LOGI(TAG, "📡 Scan monitor task started");
-                
-                // Watchdog entfernen (Scan kann bis zu 12 Sekunden dauern)
-                esp_task_wdt_delete(NULL);
-                
-                // Memory Stats VOR Scan
-                p->handler->logMemoryStats("Scan Monitor Start");
-
-                // Wait for scan completion
-                uint32_t elapsed = 0;
-                const uint32_t max_duration = 12000;
-                
-                while (elapsed < max_duration) {
-                    vTaskDelay(pdMS_TO_TICKS(100));
-                    elapsed += 100;
-                    
-                    if (p->bleManager && !p->bleManager->isScanActive()) {
-                        ESP_LOGI(TAG, "✓ Scan ended at %u ms", elapsed);
-                        break;
-                    }
-                }
-                
-                // Memory Stats NACH Scan
-                p->handler->logMemoryStats("Scan Monitor End");
-
-                // Send devices FIRST so the list is populated before the overlay
-                // is hidden (ble_scan_complete triggers hideLoading() in the JS).
-                if (p->bleManager) {
-                    const auto& discovered = p->bleManager->getDiscoveredDevices();
-
-                    if (discovered.size() > 0) {
-                        char json_buf[2048];
-
-                        int offset = snprintf(json_buf, sizeof(json_buf),
-                                            "{\"type\":\"ble_discovered\",\"devices\":[");
-
-                        for (size_t i = 0; i < discovered.size() && i < 10; i++) {
-                            offset += snprintf(json_buf + offset, sizeof(json_buf) - offset,
-                                            "%s{\"name\":\"%s\",\"address\":\"%s\",\"rssi\":%d,\"encrypted\":%s}",
-                                            i > 0 ? "," : "",
-                                            discovered[i].name.c_str(),
-                                            discovered[i].address.c_str(),
-                                            discovered[i].rssi,
-                                            discovered[i].isEncrypted ? "true" : "false");
-                        }
-                        snprintf(json_buf + offset, sizeof(json_buf) - offset, "]}");
-
-                        p->handler->broadcast_to_all_clients(json_buf);
-                        ESP_LOGI(TAG, "✓ Sent %d devices", discovered.size());
-                    } else {
-                        const char *empty = "{\"type\":\"ble_discovered\",\"devices\":[]}";
-                        p->handler->broadcast_to_all_clients(empty);
-                        ESP_LOGI(TAG, "ℹ No devices found");
-                    }
-                }
 
-                // Send completion AFTER devices — JS hides loading overlay on this message,
-                // revealing the already-populated device list.
-                const char *complete_msg = "{\"type\":\"ble_scan_complete\"}";
-                p->handler->broadcast_to_all_clients(complete_msg);
-                ESP_LOGI(TAG, "✓ Scan complete sent");
-                
-                // High Water Mark Logging
-                UBaseType_t highWater = uxTaskGetStackHighWaterMark(NULL);
-                ESP_LOGI(TAG, "Task Stack High Water Mark: %u bytes", 
-                        highWater * sizeof(StackType_t));
-                
-                if (highWater < 512) {
-                    ESP_LOGW(TAG, "⚠️ Stack critically low! Consider increasing size.");
-                }
+            ESP_LOGI(TAG, "✓ BLE started successfully");
+            ESP_LOGI(TAG, "");
+
+            // Kurze Pause für BLE Stack
+            vTaskDelay(pdMS_TO_TICKS(1000));
+        }
+
+        ESP_LOGI(TAG, "Starting 10-second discovery scan...");
+        ESP_LOGI(TAG, "Will stop on first Shelly BLU Door/Window found!");
+
+        // Start Scan
+        self->bleManager->startScan(10, true);
+
+        // Memory Stats VOR Job
+        self->logMemoryStats("Before BLE Scan Monitor Job");
+
+        if (!self->submit_job("ble_scan", ble_scan_monitor_job, fd)) {
+            // Ohne Monitor käme kein ble_scan_complete → Scan sofort beenden
+            self->bleManager->stopScan(true);
+        }
+    }
+    return ESP_OK;
+}
+
+// Läuft im Job-Worker (ws_jobs.h)
+bool WSCommandHandlers::ble_scan_monitor_job(WSJob& job) {
+    WebUIHandler* self = (WebUIHandler*)job.args().ctx;
 
-                ESP_LOGI(TAG, "✓ Scan monitor task complete");
-                
-                // unique_ptr wird automatisch freigegeben
-                vTaskDelete(NULL);
-                
-            }, "ble_scan_mon", 5120, params, 1, NULL);  // Stack: 5KB (has char json_buf[2048] inside)
-            if (taskRet != pdPASS) {
-                ESP_LOGE(TAG, "✗ Failed to create ble_scan_mon task");
-                delete params;
+    ESP_LOGI(TAG, "📡 Scan monitor task started");
+
+    // Memory Stats VOR Scan
+    self->logMemoryStats("Scan Monitor Start");
+
+    // Wait for scan completion
+    uint32_t elapsed = 0;
+    const uint32_t max_duration = 12000;
+
+    while (elapsed < max_duration) {
+        if (!job.sleep(100)) {
+            ESP_LOGI(TAG, "Scan cancelled at %u ms", elapsed);
+            self->bleManager->stopScan(true);
+            break;
+        }
+        elapsed += 100;
+
+        if (self->bleManager && !self->bleManager->isScanActive()) {
+            ESP_LOGI(TAG, "✓ Scan ended at %u ms", elapsed);
+            break;
+        }
+        if (elapsed % 2000 == 0) {
+            job.progress(elapsed * 100 / max_duration, "Scanning");
+        }
+    }
+
+    // Memory Stats NACH Scan
+    self->logMemoryStats("Scan Monitor End");
+
+    // Send devices FIRST so the list is populated before the overlay
+    // is hidden (ble_scan_complete triggers hideLoading() in the JS).
+    if (self->bleManager) {
+        const auto& discovered = self->bleManager->getDiscoveredDevices();
+
+        if (discovered.count() > 0) {
+            char json_buf[2048];
+
+            int offset = snprintf(json_buf, sizeof(json_buf),
+                                "{\"type\":\"ble_discovered\",\"devices\":[");
+
+            for (size_t i = 0; i < discovered.count() && i < 10; i++) {
+                char mac[18];
+                discovered[i].formatAddress(mac);
+                offset += snprintf(json_buf + offset, sizeof(json_buf) - offset,
+                                "%s{\"name\":\"%s\",\"address\":\"%s\",\"rssi\":%d,\"encrypted\":%s}",
+                                i > 0 ? "," : "",
+                                discovered[i].name,
+                                mac,
+                                discovered[i].rssiAvg,
+                                discovered[i].isEncrypted ? "true" : "false");
             }
+            snprintf(json_buf + offset, sizeof(json_buf) - offset, "]}");
+
+            self->broadcast_to_all_clients(json_buf);
+            ESP_LOGI(TAG, "✓ Sent %d devices", (int)discovered.count());
+        } else {
+            const char *empty = "{\"type\":\"ble_discovered\",\"devices\":[]}";
+            self->broadcast_to_all_clients(empty);
+            ESP_LOGI(TAG, "ℹ No devices found");
         }
     }
 
-    else if (strcmp(cmd, "ble_status") == 0) {
+    // Send completion AFTER devices — JS hides loading overlay on this message,
+    // revealing the already-populated device list.
+    const char *complete_msg = "{\"type\":\"ble_scan_complete\"}";
+    self->broadcast_to_all_clients(complete_msg);
+    ESP_LOGI(TAG, "✓ Scan complete sent");
+
+    ESP_LOGI(TAG, "✓ Scan monitor task complete");
+    return true;
+}
+
+esp_err_t WSCommandHandlers::ble_status(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
     if (self->bleManager) {
         ESP_LOGI(TAG, "BLE status requested");
-        
+
         // ════════════════════════════════════════════════════════════════
         // 1. Discovery List (bleibt unverändert)
         // ════════════════════════════════════════════════════════════════
-        
+
         const auto& discovered = self->bleManager->getDiscoveredDevices();
-        
+
         static const int BLE_BUF_SIZE = 2048;
         char* json_buf = (char*)malloc(BLE_BUF_SIZE);
         if (!json_buf) {
             ESP_LOGE(TAG, "ble_status: out of memory");
-            free(buf);
             return ESP_ERR_NO_MEM;
         }
         int offset = snprintf(json_buf, BLE_BUF_SIZE,
                               "{\"type\":\"ble_discovered\",\"devices\":[");
 
-        for (size_t i = 0; i < discovered.size(); i++) {
+        for (size_t i = 0; i < discovered.count(); i++) {
+            char mac[18];
+            discovered[i].formatAddress(mac);
             offset += snprintf(json_buf + offset, BLE_BUF_SIZE - offset,
                                "%s{\"name\":\"%s\",\"address\":\"%s\",\"rssi\":%d,\"encrypted\":%s}",
                                i > 0 ? "," : "",
-                               discovered[i].name.c_str(),
-                               discovered[i].address.c_str(),
-                               discovered[i].rssi,
+                               discovered[i].name,
+                               mac,
+                               discovered[i].rssiAvg,
                                discovered[i].isEncrypted ? "true" : "false");
         }
         snprintf(json_buf + offset, BLE_BUF_SIZE - offset, "]}");
 
-        httpd_ws_frame_t frame = {
-            .type = HTTPD_WS_TYPE_TEXT,
-            .payload = (uint8_t*)json_buf,
-            .len = strlen(json_buf)
-        };
-        httpd_ws_send_frame(req, &frame);
-        
+        self->sendToClient(fd, json_buf, strlen(json_buf));
+
         // ════════════════════════════════════════════════════════════════
         // 2. Paired Device Status
         // ════════════════════════════════════════════════════════════════
-        
+
         bool paired = self->bleManager->isPaired();
-        
+
         ShellyBLEManager::DeviceState state = self->bleManager->getDeviceState();
         const char* stateStr = "not_paired";
-        
+
         if (state == ShellyBLEManager::STATE_CONNECTED_UNENCRYPTED) {
             stateStr = "connected_unencrypted";
         } else if (state == ShellyBLEManager::STATE_CONNECTED_ENCRYPTED) {
             stateStr = "connected_encrypted";
         }
-        
+
         if (paired) {
             PairedShellyDevice device = self->bleManager->getPairedDevice();
             ShellyBLESensorData sensorData;
@@ -1768,7 +2385,7 @@ esp_err_t WebUIHandler::ws_handler(httpd_req_t *req) {
 
             // Passkey und Bindkey aus NVS laden
             String passkey = "Not set";
-            String bindkey = device.bindkey;
+            String bindkey = device.bindkey.toHex();
 
             Preferences prefs;
             if (prefs.begin("ShellyBLE", true)) {
@@ -1780,7 +2397,7 @@ esp_err_t WebUIHandler::ws_handler(httpd_req_t *req) {
                 }
                 prefs.end();
             }
-            
+
             if (bindkey.length() == 0) {
                 if (prefs.begin("ShellyBLE", true)) {
                     bindkey = prefs.getString("bindkey", "");
@@ -1789,7 +2406,7 @@ esp_err_t WebUIHandler::ws_handler(httpd_req_t *req) {
             }
 
             bool continuousScanActive = self->bleManager->isContinuousScanEnabled();
-            
+
             offset = snprintf(json_buf, BLE_BUF_SIZE,
                              "{\"type\":\"ble_status\","
                              "\"paired\":true,"
@@ -1806,44 +2423,44 @@ esp_err_t WebUIHandler::ws_handler(httpd_req_t *req) {
                              passkey.c_str(),
                              bindkey.c_str(),
                              continuousScanActive ? "true" : "false");
-            
+
             if (hasData) {
                 // ════════════════════════════════════════════════════════
                 // ✅ FIX: Verbesserte seconds_ago Berechnung mit Debug
                 // ════════════════════════════════════════════════════════
-                
+
                 uint32_t currentMillis = millis();
                 int32_t secondsAgoToSend = -1;  // Default: ungültig
-                
+
                 ESP_LOGD(TAG, "Time Calculation:");
                 ESP_LOGD(TAG, "  Current millis: %u", currentMillis);
                 ESP_LOGD(TAG, "  Last update:    %u", sensorData.lastUpdate);
                 ESP_LOGD(TAG, "  Has data:       %s", hasData ? "true" : "false");
                 ESP_LOGD(TAG, "  Data valid:     %s", sensorData.dataValid ? "true" : "false");
-                
+
                 // ✅ Prüfe ob lastUpdate gesetzt wurde
                 if (sensorData.lastUpdate > 0) {
                     uint32_t secondsAgo = 0;
-                    
+
                     // Prüfe auf millis() Overflow
                     if (currentMillis >= sensorData.lastUpdate) {
                         // Normal case
                         uint32_t diff = currentMillis - sensorData.lastUpdate;
                         secondsAgo = diff / 1000;
-                        
+
                         ESP_LOGD(TAG, "  Difference:     %u ms", diff);
                         ESP_LOGD(TAG, "  Seconds ago:    %u", secondsAgo);
-                        
+
                     } else {
                         // Overflow (nach ~49 Tagen Uptime)
                         uint32_t millisToOverflow = (0xFFFFFFFF - sensorData.lastUpdate);
                         uint32_t diff = millisToOverflow + currentMillis;
                         secondsAgo = diff / 1000;
-                        
+
                         ESP_LOGW(TAG, "  millis() overflow detected!");
                         ESP_LOGD(TAG, "  Calculated seconds: %u", secondsAgo);
                     }
-                    
+
                     // Sanity check: Nicht älter als 24 Stunden
                     if (secondsAgo <= 86400) {
                         secondsAgoToSend = (int32_t)secondsAgo;
@@ -1853,18 +2470,18 @@ esp_err_t WebUIHandler::ws_handler(httpd_req_t *req) {
                                  secondsAgo, secondsAgo / 3600.0f);
                         secondsAgoToSend = -1;
                     }
-                    
+
                 } else {
                     ESP_LOGW(TAG, "  ⚠ lastUpdate is 0 - no valid timestamp");
                     secondsAgoToSend = -1;
                 }
-                
+
                 ESP_LOGD(TAG, "  → Sending seconds_ago: %d", secondsAgoToSend);
-                
+
                 // ════════════════════════════════════════════════════════
                 // JSON mit allen Sensor-Daten
                 // ════════════════════════════════════════════════════════
-                
+
                 offset += snprintf(json_buf + offset, BLE_BUF_SIZE - offset,
                                   "\"valid\":true,"
                                   "\"packet_id\":%d,"
@@ -1883,7 +2500,7 @@ esp_err_t WebUIHandler::ws_handler(httpd_req_t *req) {
                                   sensorData.rotation,
                                   sensorData.rssi,
                                   sensorData.hasButtonEvent ? "true" : "false",
-                                  (int)sensorData.buttonEvent,
+                                  (int)wsButtonEventCode(sensorData.buttonEvent),
                                   secondsAgoToSend);
             } else {
                 // Keine Daten verfügbar
@@ -1894,7 +2511,10 @@ esp_err_t WebUIHandler::ws_handler(httpd_req_t *req) {
                                   "\"seconds_ago\":-1");  // ← Explizit -1
             }
 
-            snprintf(json_buf + offset, BLE_BUF_SIZE - offset, "}}");
+            offset += snprintf(json_buf + offset, BLE_BUF_SIZE - offset, "}");
+            offset += append_paired_devices_json(self->bleManager, json_buf + offset,
+                                                 BLE_BUF_SIZE - offset - 2);
+            snprintf(json_buf + offset, BLE_BUF_SIZE - offset, "}");
 
         } else {
             // Nicht gepairt
@@ -1907,34 +2527,22 @@ esp_err_t WebUIHandler::ws_handler(httpd_req_t *req) {
                     stateStr,
                     isScanActive ? "true" : "false");
         }
-        
-        // Sende zweite Message (ble_status) — synchronous send, then free heap buffer
-        frame.payload = (uint8_t*)json_buf;
-        frame.len = strlen(json_buf);
-        httpd_ws_send_frame(req, &frame);
+
+        // Zweite Message (ble_status) - sendToClient() kopiert, Puffer danach frei
+        self->sendToClient(fd, json_buf, strlen(json_buf));
         free(json_buf);
     }
+    return ESP_OK;
 }
 
 // ════════════════════════════════════════════════════════════════════════
 // BLE SMART CONNECT COMMAND (3-in-1 Workflow)
 // ════════════════════════════════════════════════════════════════════════
-else if (CMD_MATCH(cmd, "{\"cmd\":\"ble_smart_connect\"")) {
+esp_err_t WSCommandHandlers::ble_smart_connect(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
     if (self->bleManager) {
-        String json = String(cmd);
-        
-        // Parse address
-        int addrStart = json.indexOf("\"address\":\"") + 11;
-        int addrEnd = json.indexOf("\"", addrStart);
-        String address = json.substring(addrStart, addrEnd);
-        
-        // Parse passkey
-        int passkeyStart = json.indexOf("\"passkey\":") + 10;
-        int passkeyEnd = json.indexOf(",", passkeyStart);
-        if (passkeyEnd == -1) passkeyEnd = json.indexOf("}", passkeyStart);
-        String passkeyStr = json.substring(passkeyStart, passkeyEnd);
-        uint32_t passkey = passkeyStr.toInt();
-        
+        String address = json.getString("address", "");
+        uint32_t passkey = json.getUInt("passkey", 0);
+
         ESP_LOGI(TAG, "═══════════════════════════════════");
         ESP_LOGI(TAG, "SMART CONNECT");
         ESP_LOGI(TAG, "═══════════════════════════════════");
@@ -1943,7 +2551,7 @@ else if (CMD_MATCH(cmd, "{\"cmd\":\"ble_smart_connect\"")) {
         if (passkey > 0) {
             ESP_LOGI(TAG, "Passkey: %06u", passkey);
         }
-        
+
         // Button-Press Anleitung VORHER senden
         const char* instructions = 
             "{\"type\":\"info\",\"message\":\"<strong>📋 GET READY!</strong><br><br>"
@@ -1953,179 +2561,127 @@ else if (CMD_MATCH(cmd, "{\"cmd\":\"ble_smart_connect\"")) {
             "3. LED should flash rapidly<br><br>"
             "Starting connection in 5 seconds...<br>"
             "Keep holding the button!\"}";
-        
-        httpd_ws_frame_t frame = {
-            .type = HTTPD_WS_TYPE_TEXT,
-            .payload = (uint8_t*)instructions,
-            .len = strlen(instructions)
-        };
-        httpd_ws_send_frame_async(req->handle, fd, &frame);
-        
-        // Gib User 5 Sekunden
-        vTaskDelay(pdMS_TO_TICKS(5000));
-        
-        // Task-Parameter mit std::unique_ptr
-        struct SmartConnectParams {
-            ShellyBLEManager* bleManager;
-            WebUIHandler* handler;
-            int fd;
-            String address;
-            uint32_t passkey;
-        };
-        
-        SmartConnectParams* params = new SmartConnectParams{
-            self->bleManager,
-            self,
-            fd,
-            address,
-            passkey
-        };
-        
-        // Memory Stats VOR Task-Erstellung
-        self->logMemoryStats("Before Smart Connect Task");
-        
-        xTaskCreate([](void* pvParameters) {
-            // RAII-Pattern: unique_ptr garantiert Freigabe!
-            std::unique_ptr<SmartConnectParams> p(
-                static_cast<SmartConnectParams*>(pvParameters)
-            );
-            
-            ESP_LOGI(TAG, "🚀 Smart Connect Task started");
-            ESP_LOGI(TAG, "   Address: %s", p->address.c_str());
-            ESP_LOGI(TAG, "   Passkey: %s", p->passkey > 0 ? "SET" : "NONE");
-            
-            // Watchdog entfernen (kann lange dauern)
-            esp_task_wdt_delete(NULL);
-            
-            // Memory Stats VOR Operation
-            p->handler->logMemoryStats("Smart Connect Task Start");
-            
-            ESP_LOGI(TAG, "");
-            ESP_LOGI(TAG, "Pre-connection Scanner Status:");
-            if (p->bleManager->isScanActive()) {
-                ESP_LOGW(TAG, "  ⚠ Scanner is ACTIVE - will be stopped by connectDevice()");
-            } else {
-                ESP_LOGI(TAG, "  ✓ Scanner is IDLE - ready for GATT connection");
-            }
-            ESP_LOGI(TAG, "");
-            
-            // Smart Connect aufrufen (stoppt Scanner automatisch)
-            bool success = p->bleManager->smartConnectDevice(p->address, p->passkey);
-            
-            // Memory Stats NACH Operation
-            p->handler->logMemoryStats("Smart Connect Task End");
-            
-            if (success) {
-                PairedShellyDevice device = p->bleManager->getPairedDevice();
-                
-                char success_msg[1024];
-                
-                if (p->passkey > 0) {
-                    // Encrypted Mode Success
-                    snprintf(success_msg, sizeof(success_msg),
-                            "{\"type\":\"success\",\"message\":\"<strong>Encrypted Connection Complete!</strong><br><br>"
-                            "Your device is now:<br>"
-                            "✓ Bonded (trusted connection)<br>"
-                            "✓ Encrypted (passkey: %06u)<br>"
-                            "✓ Bindkey received: %s<br><br>"
-                            "<strong>⚠️ SAVE YOUR CREDENTIALS!</strong><br>"
-                            "You will need them for future connections.<br><br>"
-                            "Continuous scan is now active.\"}",
-                            p->passkey,
-                            device.bindkey.c_str());
-                } else {
-                    // Unencrypted Mode Success
-                    snprintf(success_msg, sizeof(success_msg),
-                            "{\"type\":\"success\",\"message\":\"<strong>✓ Device Connected!</strong><br><br>"
-                            "The device is bonded but NOT encrypted yet.<br><br>"
-                            "You can enable encryption later via the UI.<br><br>"
-                            "Continuous scan is now active.\"}");
-                }
-                
-                // Sende Success Message
-                if (xSemaphoreTake(p->handler->client_mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-                    httpd_ws_frame_t frame = {
-                        .type = HTTPD_WS_TYPE_TEXT,
-                        .payload = (uint8_t*)success_msg,
-                        .len = strlen(success_msg)
-                    };
-                    httpd_ws_send_frame_async(p->handler->server, p->fd, &frame);
-                    xSemaphoreGive(p->handler->client_mutex);
-                }
-                
-                // Modal schließen
-                vTaskDelay(pdMS_TO_TICKS(2000));
-                p->handler->sendModalClose(p->fd, "ble-connect-modal");
-                
-                ESP_LOGI(TAG, "✓ Smart Connect successful");
-
-                // Broadcast full status to ALL connected clients
-                vTaskDelay(pdMS_TO_TICKS(1000));
-                p->handler->broadcastBLEStatus();
-                
-            } else {
-                // Fehler
-                const char* error = 
-                    "{\"type\":\"error\",\"message\":\"<strong>✗ Connection Failed</strong><br><br>"
-                    "<strong>Most likely causes:</strong><br><br>"
-                    "1️⃣ <strong>Button not held long enough</strong><br>"
-                    "   → Must hold for FULL 15 seconds<br>"
-                    "   → LED must flash RAPIDLY<br><br>"
-                    "2️⃣ <strong>Device too far away</strong><br>"
-                    "   → Move within 2 meters<br><br>"
-                    "3️⃣ <strong>Wrong passkey</strong> (if encrypted)<br>"
-                    "   → Try factory reset first<br><br>"
-                    "<strong>Try again!</strong>\"}";
-                
-                if (xSemaphoreTake(p->handler->client_mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-                    httpd_ws_frame_t frame = {
-                        .type = HTTPD_WS_TYPE_TEXT,
-                        .payload = (uint8_t*)error,
-                        .len = strlen(error)
-                    };
-                    httpd_ws_send_frame_async(p->handler->server, p->fd, &frame);
-                    xSemaphoreGive(p->handler->client_mutex);
-                }
-                
-                ESP_LOGE(TAG, "✗ Smart Connect failed");
-            }
-            
-            // High Water Mark Logging
-            UBaseType_t highWater = uxTaskGetStackHighWaterMark(NULL);
-            ESP_LOGI(TAG, "Task Stack High Water Mark: %u bytes", 
-                     highWater * sizeof(StackType_t));
-            
-            if (highWater < 512) {
-                ESP_LOGW(TAG, "⚠️ Stack critically low! Consider increasing size.");
-            }
-            
-            ESP_LOGI(TAG, "✓ Smart Connect Task completed");
-            
-            // unique_ptr wird hier automatisch freigegeben!
-            vTaskDelete(NULL);
-            
-        }, "ble_smart", 6144, params, 5, NULL);  // Stack: 6KB (NimBLE client ops)
-        
-        ESP_LOGI(TAG, "✓ Smart Connect task created");
+
+        self->sendToClient(fd, instructions, strlen(instructions));
+
+        // Memory Stats VOR Job
+        self->logMemoryStats("Before Smart Connect Job");
+
+        if (self->submit_job("ble_smart_connect", ble_smart_connect_job, fd,
+                             address.c_str(), passkey)) {
+            ESP_LOGI(TAG, "✓ Smart Connect job queued");
+        }
     }
+    return ESP_OK;
+}
+
+// Läuft im Job-Worker (ws_jobs.h)
+bool WSCommandHandlers::ble_smart_connect_job(WSJob& job) {
+    WebUIHandler* self = (WebUIHandler*)job.args().ctx;
+    const char* address = job.args().address;
+    uint32_t passkey = job.args().passkey;
+
+    // Gib User 5 Sekunden (früher im httpd-Task, jetzt abbrechbar)
+    job.progress(0, "Hold the device button");
+    if (!job.sleep(5000)) return false;
+
+    ESP_LOGI(TAG, "🚀 Smart Connect Task started");
+    ESP_LOGI(TAG, "   Address: %s", address);
+    ESP_LOGI(TAG, "   Passkey: %s", passkey > 0 ? "SET" : "NONE");
+
+    // Memory Stats VOR Operation
+    self->logMemoryStats("Smart Connect Task Start");
+
+    ESP_LOGI(TAG, "");
+    ESP_LOGI(TAG, "Pre-connection Scanner Status:");
+    if (self->bleManager->isScanActive()) {
+        ESP_LOGW(TAG, "  ⚠ Scanner is ACTIVE - will be stopped by connectDevice()");
+    } else {
+        ESP_LOGI(TAG, "  ✓ Scanner is IDLE - ready for GATT connection");
+    }
+    ESP_LOGI(TAG, "");
+
+    // Smart Connect aufrufen (stoppt Scanner automatisch)
+    job.progress(30, "Connecting");
+    bool success = self->bleManager->smartConnectDevice(address, passkey);
+
+    // Memory Stats NACH Operation
+    self->logMemoryStats("Smart Connect Task End");
+
+    if (success) {
+        PairedShellyDevice device = self->bleManager->getPairedDevice();
+
+        char success_msg[1024];
+
+        if (passkey > 0) {
+            // Encrypted Mode Success
+            snprintf(success_msg, sizeof(success_msg),
+                    "{\"type\":\"success\",\"message\":\"<strong>Encrypted Connection Complete!</strong><br><br>"
+                    "Your device is now:<br>"
+                    "✓ Bonded (trusted connection)<br>"
+                    "✓ Encrypted (passkey: %06u)<br>"
+                    "✓ Bindkey received: %s<br><br>"
+                    "<strong>⚠️ SAVE YOUR CREDENTIALS!</strong><br>"
+                    "You will need them for future connections.<br><br>"
+                    "Continuous scan is now active.\"}",
+                    passkey,
+                    device.bindkey.toHex().c_str());
+        } else {
+            // Unencrypted Mode Success
+            snprintf(success_msg, sizeof(success_msg),
+                    "{\"type\":\"success\",\"message\":\"<strong>✓ Device Connected!</strong><br><br>"
+                    "The device is bonded but NOT encrypted yet.<br><br>"
+                    "You can enable encryption later via the UI.<br><br>"
+                    "Continuous scan is now active.\"}");
+        }
+
+        // Sende Success Message
+        job.send(success_msg);
+
+        // Modal schließen
+        vTaskDelay(pdMS_TO_TICKS(2000));
+        self->sendModalClose(job.fd(), "ble-connect-modal");
+
+        ESP_LOGI(TAG, "✓ Smart Connect successful");
+
+        // Broadcast full status to ALL connected clients
+        vTaskDelay(pdMS_TO_TICKS(1000));
+        self->broadcastBLEStatus();
+        return true;
+
+    } else {
+        // Fehler
+        const char* error = 
+            "{\"type\":\"error\",\"message\":\"<strong>✗ Connection Failed</strong><br><br>"
+            "<strong>Most likely causes:</strong><br><br>"
+            "1️⃣ <strong>Button not held long enough</strong><br>"
+            "   → Must hold for FULL 15 seconds<br>"
+            "   → LED must flash RAPIDLY<br><br>"
+            "2️⃣ <strong>Device too far away</strong><br>"
+            "   → Move within 2 meters<br><br>"
+            "3️⃣ <strong>Wrong passkey</strong> (if encrypted)<br>"
+            "   → Try factory reset first<br><br>"
+            "<strong>Try again!</strong>\"}";
+
+        job.send(error);
+
+        ESP_LOGE(TAG, "✗ Smart Connect failed");
+    }
+    return false;
 }
 
 // ============================================================================
 // BLE Connect Command (Phase 1) - Mit Smart Detection
 // ============================================================================
-else if (CMD_MATCH(cmd, "{\"cmd\":\"ble_connect\"")) {
+esp_err_t WSCommandHandlers::ble_connect(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
     if (self->bleManager) {
-        String json = String(cmd);
-        
-        int addrStart = json.indexOf("\"address\":\"") + 11;
-        int addrEnd = json.indexOf("\"", addrStart);
-        String address = json.substring(addrStart, addrEnd);
-        
+        String address = json.getString("address", "");
+
         ESP_LOGI(TAG, "═══════════════════════════════════");
         ESP_LOGI(TAG, "BLE CONNECT (Phase 1: Bonding)");
         ESP_LOGI(TAG, "═══════════════════════════════════");
         ESP_LOGI(TAG, "Address: %s", address.c_str());
-        
+
         // Sende Anweisungen VOR dem Connect-Versuch
         const char* instructions = 
             "{\"type\":\"info\",\"message\":\"<strong>📋 GET READY!</strong><br><br>"
@@ -2135,341 +2691,232 @@ else if (CMD_MATCH(cmd, "{\"cmd\":\"ble_connect\"")) {
             "3. LED should flash rapidly<br><br>"
             "Starting connection in 5 seconds...<br>"
             "Keep holding the button!\"}";
-        
-        httpd_ws_frame_t frame = {
-            .type = HTTPD_WS_TYPE_TEXT,
-            .payload = (uint8_t*)instructions,
-            .len = strlen(instructions)
-        };
-        httpd_ws_send_frame_async(req->handle, fd, &frame);
-        
-        // Gib User 5 Sekunden zum Lesen + Button drücken
-        vTaskDelay(pdMS_TO_TICKS(5000));
-        
-        // Jetzt verbinden
-        if (self->bleManager->connectDevice(address)) {
-            const char* success = 
-                "{\"type\":\"success\",\"message\":\"<strong>✓ Bonding Complete!</strong><br><br>"
-                "The device is now bonded and ready.<br><br>"
-                "<strong>Connection is ACTIVE</strong><br><br>"
-                "Next steps:<br>"
-                "• Click 'Enable Encryption' to set passkey<br>"
-                "• NO button press needed for encryption!<br><br>"
-                "Note: Device is bonded but NOT encrypted yet.\"}";
-            
-            httpd_ws_frame_t frame = {
-                .type = HTTPD_WS_TYPE_TEXT,
-                .payload = (uint8_t*)success,
-                .len = strlen(success)
-            };
-            httpd_ws_send_frame_async(req->handle, fd, &frame);
-
-            vTaskDelay(pdMS_TO_TICKS(2000));
-            self->sendModalClose(fd, "ble-connect-modal");
-            
-            ESP_LOGI(TAG, "✓ Bonding successful");
-            
-            // Status-Update
-            vTaskDelay(pdMS_TO_TICKS(1000));
-            
-            self->broadcastBLEStatus();
 
-        } else {
-            // BESSERE ERROR MESSAGE mit Troubleshooting
-            const char* error = 
-                "{\"type\":\"error\",\"message\":\"<strong>✗ Bonding Failed</strong><br><br>"
-                "<strong>Most likely causes:</strong><br><br>"
-                "1️⃣ <strong>Button not held long enough</strong><br>"
-                "   → Must hold for FULL 15 seconds<br>"
-                "   → LED must flash RAPIDLY (not slowly)<br><br>"
-                "2️⃣ <strong>Device too far away</strong><br>"
-                "   → Move device within 2 meters of ESP32<br><br>"
-                "3️⃣ <strong>Device already bonded elsewhere</strong><br>"
-                "   → Reset device first (hold button 30+ seconds)<br><br>"
-                "4️⃣ <strong>Wrong address type</strong><br>"
-                "   → Try scanning again<br><br>"
-                "<strong>Try again and follow timing exactly!</strong>\"}";
-            
-            httpd_ws_frame_t frame = {
-                .type = HTTPD_WS_TYPE_TEXT,
-                .payload = (uint8_t*)error,
-                .len = strlen(error)
-            };
-            httpd_ws_send_frame_async(req->handle, fd, &frame);
-            
-            ESP_LOGE(TAG, "✗ Bonding failed");
-        }
+        self->sendToClient(fd, instructions, strlen(instructions));
+
+        // Warten + Bonding im Job-Worker statt im httpd-Task
+        self->submit_job("ble_connect", ble_connect_job, fd, address.c_str());
+    }
+    return ESP_OK;
+}
+
+// Läuft im Job-Worker (ws_jobs.h)
+bool WSCommandHandlers::ble_connect_job(WSJob& job) {
+    WebUIHandler* self = (WebUIHandler*)job.args().ctx;
+    const char* address = job.args().address;
+    int fd = job.fd();
+
+    // Gib User 5 Sekunden zum Lesen + Button drücken
+    job.progress(0, "Hold the device button");
+    if (!job.sleep(5000)) return false;
+
+    // Jetzt verbinden
+    job.progress(30, "Bonding");
+    if (self->bleManager->connectDevice(address)) {
+        const char* success = 
+            "{\"type\":\"success\",\"message\":\"<strong>✓ Bonding Complete!</strong><br><br>"
+            "The device is now bonded and ready.<br><br>"
+            "<strong>Connection is ACTIVE</strong><br><br>"
+            "Next steps:<br>"
+            "• Click 'Enable Encryption' to set passkey<br>"
+            "• NO button press needed for encryption!<br><br>"
+            "Note: Device is bonded but NOT encrypted yet.\"}";
+
+        job.send(success);
+
+        vTaskDelay(pdMS_TO_TICKS(2000));
+        self->sendModalClose(fd, "ble-connect-modal");
+
+        ESP_LOGI(TAG, "✓ Bonding successful");
+
+        // Status-Update
+        vTaskDelay(pdMS_TO_TICKS(1000));
+
+        self->broadcastBLEStatus();
+        return true;
+
+    } else {
+        // BESSERE ERROR MESSAGE mit Troubleshooting
+        const char* error = 
+            "{\"type\":\"error\",\"message\":\"<strong>✗ Bonding Failed</strong><br><br>"
+            "<strong>Most likely causes:</strong><br><br>"
+            "1️⃣ <strong>Button not held long enough</strong><br>"
+            "   → Must hold for FULL 15 seconds<br>"
+            "   → LED must flash RAPIDLY (not slowly)<br><br>"
+            "2️⃣ <strong>Device too far away</strong><br>"
+            "   → Move device within 2 meters of ESP32<br><br>"
+            "3️⃣ <strong>Device already bonded elsewhere</strong><br>"
+            "   → Reset device first (hold button 30+ seconds)<br><br>"
+            "4️⃣ <strong>Wrong address type</strong><br>"
+            "   → Try scanning again<br><br>"
+            "<strong>Try again and follow timing exactly!</strong>\"}";
+
+        job.send(error);
+
+        ESP_LOGE(TAG, "✗ Bonding failed");
     }
+    return false;
 }
 
-else if (CMD_MATCH(cmd, "{\"cmd\":\"ble_encrypt\"")) {
+esp_err_t WSCommandHandlers::ble_encrypt(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
     if (self->bleManager) {
-        String json = String(cmd);
-        
-        // 1. Parameter manuell extrahieren (wie bei ble_connect)
-        int addrStart = json.indexOf("\"address\":\"") + 11;
-        int addrEnd = json.indexOf("\"", addrStart);
-        String address = json.substring(addrStart, addrEnd);
-
-        int passStart = json.indexOf("\"passkey\":") + 10;
-        // Suche das Ende der Zahl (entweder Komma oder schließende Klammer)
-        int passEnd = json.indexOf(",", passStart);
-        if (passEnd == -1) passEnd = json.indexOf("}", passStart);
-        uint32_t passkey = json.substring(passStart, passEnd).toInt();
-
-        // 2. Task-Parameter vorbereiten
-        BLETaskParams* params = new BLETaskParams{self, fd, address, passkey};
-
-        xTaskCreate([](void* pvParameters) {
-            BLETaskParams* p = (BLETaskParams*)pvParameters;
-            
-            ESP_LOGI(TAG, "Starting Encryption Task for %s with Passkey %u", p->address.c_str(), p->passkey);
-
-            // Info an UI senden
-            const char* info = "{\"type\":\"info\",\"message\":\"Enabling encryption... Device will reboot.\"}";
-            if (xSemaphoreTake(p->handler->client_mutex, pdMS_TO_TICKS(1000))) {
-                httpd_ws_frame_t frame = { .type = HTTPD_WS_TYPE_TEXT, .payload = (uint8_t*)info, .len = strlen(info) };
-                httpd_ws_send_frame_async(p->handler->server, p->fd, &frame);
-                xSemaphoreGive(p->handler->client_mutex);
-            }
+        // 1. Parameter
+        String address = json.getString("address", "");
+        uint32_t passkey = json.getUInt("passkey", 0);
 
-            // 3. Die eigentliche Verschlüsselung im Manager aufrufen
-            // Hier nutzen wir direkt den bleManager aus deinem 'self' (p->handler)
-            if (p->handler->bleManager->enableEncryption(p->address, p->passkey)) {
-                
-                const char* success = "{\"type\":\"info\",\"message\":\"Encryption successful!\"}";
-                if (xSemaphoreTake(p->handler->client_mutex, pdMS_TO_TICKS(1000))) {
-                    httpd_ws_frame_t frame = { .type = HTTPD_WS_TYPE_TEXT, .payload = (uint8_t*)success, .len = strlen(success) };
-                    httpd_ws_send_frame_async(p->handler->server, p->fd, &frame);
-                    xSemaphoreGive(p->handler->client_mutex);
-                }
+        // 2. Job einreihen (Parameter werden in den Job-Slot kopiert)
+        self->submit_job("ble_encrypt", ble_encrypt_job, fd, address.c_str(), passkey);
+    }
+    return ESP_OK;
+}
 
-                // Broadcast full status to ALL connected clients
-                p->handler->broadcastBLEStatus();
-            } else {
-                const char* error = "{\"type\":\"error\",\"message\":\"Encryption failed. Check passkey!\"}";
-                if (xSemaphoreTake(p->handler->client_mutex, pdMS_TO_TICKS(1000))) {
-                    httpd_ws_frame_t frame = { .type = HTTPD_WS_TYPE_TEXT, .payload = (uint8_t*)error, .len = strlen(error) };
-                    httpd_ws_send_frame_async(p->handler->server, p->fd, &frame);
-                    xSemaphoreGive(p->handler->client_mutex);
-                }
-            }
+// Läuft im Job-Worker (ws_jobs.h)
+bool WSCommandHandlers::ble_encrypt_job(WSJob& job) {
+    WebUIHandler* self = (WebUIHandler*)job.args().ctx;
+    const char* address = job.args().address;
+    uint32_t passkey = job.args().passkey;
 
-            UBaseType_t highWater = uxTaskGetStackHighWaterMark(NULL);
-            ESP_LOGI(TAG, "Task -ble_enc_task- Stack High Water Mark: %u bytes", highWater * sizeof(StackType_t));
+    ESP_LOGI(TAG, "Starting Encryption Task for %s with Passkey %u", address, passkey);
 
-            if (highWater < 256) {  // < 1KB frei
-                ESP_LOGW(TAG, "⚠️ Stack critically low!");
-            }
+    // Info an UI senden
+    const char* info = "{\"type\":\"info\",\"message\":\"Enabling encryption... Device will reboot.\"}";
+    job.send(info);
 
-            delete p;
-            vTaskDelete(NULL);
+    // 3. Die eigentliche Verschlüsselung im Manager aufrufen
+    if (self->bleManager->enableEncryption(address, passkey)) {
 
-        }, "ble_enc_task", 6144, params, 1, NULL);  // Stack: 6KB (AES + NimBLE client ops)
+        const char* success = "{\"type\":\"info\",\"message\":\"Encryption successful!\"}";
+        job.send(success);
+
+        // Broadcast full status to ALL connected clients
+        self->broadcastBLEStatus();
+        return true;
     }
+
+    const char* error = "{\"type\":\"error\",\"message\":\"Encryption failed. Check passkey!\"}";
+    job.send(error);
+    return false;
 }
 
 // ════════════════════════════════════════════════════════════════════════
 // BLE ENABLE ENCRYPTION (Phase 2)
 // ════════════════════════════════════════════════════════════════════════
-
-else if (CMD_MATCH(cmd, "{\"cmd\":\"ble_enable_encryption\"")) {
+esp_err_t WSCommandHandlers::ble_enable_encryption(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
     if (self->bleManager) {
-        String json = String(cmd);
-        
-        int addrStart = json.indexOf("\"address\":\"") + 11;
-        int addrEnd = json.indexOf("\"", addrStart);
-        String address = json.substring(addrStart, addrEnd);
-        
-        int passkeyStart = json.indexOf("\"passkey\":") + 10;
-        int passkeyEnd = json.indexOf(",", passkeyStart);
-        if (passkeyEnd == -1) passkeyEnd = json.indexOf("}", passkeyStart);
-        String passkeyStr = json.substring(passkeyStart, passkeyEnd);
-        uint32_t passkey = passkeyStr.toInt();
-        
+        String address = json.getString("address", "");
+        uint32_t passkey = json.getUInt("passkey", 0);
+
         ESP_LOGI(TAG, "═══════════════════════════════════");
         ESP_LOGI(TAG, "BLE ENABLE ENCRYPTION (Phase 2)");
         ESP_LOGI(TAG, "═══════════════════════════════════");
         ESP_LOGI(TAG, "Address: %s", address.c_str());
         ESP_LOGI(TAG, "Passkey: %06u", passkey);
-        
+
         // Info-Message an Client senden
         const char* info = 
             "{\"type\":\"info\",\"message\":\"<strong>🔐 Phase 2: Enabling Encryption</strong><br><br>"
             "Using ACTIVE connection from Phase 1.<br>"
             "<strong>NO button press needed!</strong><br><br>"
             "Writing passkey and reading bindkey...\"}";
-        
-        httpd_ws_frame_t frame = {
-            .type = HTTPD_WS_TYPE_TEXT,
-            .payload = (uint8_t*)info,
-            .len = strlen(info)
-        };
-        httpd_ws_send_frame_async(req->handle, fd, &frame);
-        
-        // Task-Parameter für non-blocking Execution
-        struct EncryptionTaskParams {
-            ShellyBLEManager* bleManager;
-            WebUIHandler* handler;
-            int fd;
-            String address;
-            uint32_t passkey;
-        };
-        
-        EncryptionTaskParams* params = new EncryptionTaskParams{
-            self->bleManager,
-            self,
-            fd,
-            address,
-            passkey
-        };
-        
-        // Memory Stats VOR Task-Erstellung
-        self->logMemoryStats("Before Enable Encryption Task");
-        
-        // Starte separaten Task für nicht-blockierende Ausführung!
-        xTaskCreate([](void* pvParameters) {
-            // RAII-Pattern
-            std::unique_ptr<EncryptionTaskParams> p(
-                static_cast<EncryptionTaskParams*>(pvParameters)
-            );
-            
-            ESP_LOGI(TAG, "🔐 Encryption Task started for %s", p->address.c_str());
-            
-            // Watchdog entfernen (kann bis zu 60s dauern)
-            esp_task_wdt_delete(NULL);
-            
-            // Memory Stats VOR Operation
-            p->handler->logMemoryStats("Enable Encryption Start");
-            
-            // Enable Encryption (mit internen Watchdog-Resets)
-            bool success = p->bleManager->enableEncryption(p->address, p->passkey);
-            
-            // Memory Stats NACH Operation
-            p->handler->logMemoryStats("Enable Encryption End");
-            
-            if (success) {
-                // Hole Device-Info für Success-Message
-                PairedShellyDevice device = p->bleManager->getPairedDevice();
-                
-                char success_msg[768];
-                snprintf(success_msg, sizeof(success_msg),
-                        "{\"type\":\"success\",\"message\":\"<strong>Encryption Enabled!</strong><br><br>"
-                        "Your device is now securely encrypted.<br><br>"
-                        "<strong>🔑 Bindkey:</strong> %s<br><br>"
-                        "⚠️ <strong>SAVE THIS BINDKEY!</strong><br>"
-                        "You will need it for:<br>"
-                        "• Re-pairing after factory reset<br>"
-                        "• Integration with other systems<br>"
-                        "• Backup and restore<br><br>"
-                        "Continuous scan will now pick up sensor data...\"}",
-                        device.bindkey.c_str());
-                
-                                // Sende Erfolgs-Nachricht
-                if (xSemaphoreTake(p->handler->client_mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-                    httpd_ws_frame_t frame = {
-                        .type = HTTPD_WS_TYPE_TEXT,
-                        .payload = (uint8_t*)success_msg,
-                        .len = strlen(success_msg)
-                    };
-                    httpd_ws_send_frame_async(p->handler->server, p->fd, &frame);
-                    xSemaphoreGive(p->handler->client_mutex);
-                }
-                
-                ESP_LOGI(TAG, "✓ Encryption enabled successfully");
-
-                vTaskDelay(pdMS_TO_TICKS(3000));
-    
-                char close_msg[128];
-                snprintf(close_msg, sizeof(close_msg),
-                        "{\"type\":\"modal_close\",\"modal_id\":\"enable-encryption-modal\"}");
-                
-                if (xSemaphoreTake(p->handler->client_mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-                    httpd_ws_frame_t frame = {
-                        .type = HTTPD_WS_TYPE_TEXT,
-                        .payload = (uint8_t*)close_msg,
-                        .len = strlen(close_msg)
-                    };
-                    httpd_ws_send_frame_async(p->handler->server, p->fd, &frame);
-                    xSemaphoreGive(p->handler->client_mutex);
-                }
-                
-                // Continuous Scan starten
-                ESP_LOGI(TAG, "→ Starting continuous scan for sensor data...");
-                p->bleManager->startContinuousScan();
-
-                // Broadcast full status to ALL connected clients
-                vTaskDelay(pdMS_TO_TICKS(1000));
-                p->handler->broadcastBLEStatus();
-                
-            } else {
-                const char* error = 
-                    "{\"type\":\"error\",\"message\":\"<strong>✗ Encryption Failed</strong><br><br>"
-                    "Could not enable encryption.<br><br>"
-                    "Possible reasons:<br>"
-                    "• Wrong passkey<br>"
-                    "• Device rejected passkey<br>"
-                    "• Connection timeout<br>"
-                    "• Bindkey not found in NVS<br><br>"
-                    "Please try again or re-pair the device.\"}";
-                
-                if (xSemaphoreTake(p->handler->client_mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-                    httpd_ws_frame_t frame = {
-                        .type = HTTPD_WS_TYPE_TEXT,
-                        .payload = (uint8_t*)error,
-                        .len = strlen(error)
-                    };
-                    httpd_ws_send_frame_async(p->handler->server, p->fd, &frame);
-                    xSemaphoreGive(p->handler->client_mutex);
-                }
-                
-                ESP_LOGE(TAG, "✗ Encryption failed");
-            }
-            
-            // High Water Mark Logging
-            UBaseType_t highWater = uxTaskGetStackHighWaterMark(NULL);
-            ESP_LOGI(TAG, "Task -ble_enc- Stack High Water Mark: %u bytes", 
-                     highWater * sizeof(StackType_t));
-            
-            if (highWater < 512) {
-                ESP_LOGW(TAG, "⚠️ Stack critically low! Consider increasing size.");
-            }
-            
-            ESP_LOGI(TAG, "✓ Encryption task completed");
-            
-            // unique_ptr wird automatisch freigegeben
-            vTaskDelete(NULL);
-            
-        }, "ble_enc", 6144, params, 5, NULL);  // Stack: 6KB (AES + NimBLE client ops)
-        
-        ESP_LOGI(TAG, "✓ Encryption task created");
+
+        self->sendToClient(fd, info, strlen(info));
+
+        // Memory Stats VOR Job
+        self->logMemoryStats("Before Enable Encryption Job");
+
+        // Job-Worker für nicht-blockierende Ausführung!
+        if (self->submit_job("ble_enable_encryption", ble_enable_encryption_job, fd,
+                             address.c_str(), passkey)) {
+            ESP_LOGI(TAG, "✓ Encryption job queued");
+        }
     }
+    return ESP_OK;
+}
+
+// Läuft im Job-Worker (ws_jobs.h)
+bool WSCommandHandlers::ble_enable_encryption_job(WSJob& job) {
+    WebUIHandler* self = (WebUIHandler*)job.args().ctx;
+    const char* address = job.args().address;
+    uint32_t passkey = job.args().passkey;
+
+    ESP_LOGI(TAG, "🔐 Encryption Task started for %s", address);
+
+    // Memory Stats VOR Operation
+    self->logMemoryStats("Enable Encryption Start");
+
+    // Enable Encryption (mit internen Watchdog-Resets)
+    job.progress(10, "Writing passkey");
+    bool success = self->bleManager->enableEncryption(address, passkey);
+
+    // Memory Stats NACH Operation
+    self->logMemoryStats("Enable Encryption End");
+
+    if (success) {
+        // Hole Device-Info für Success-Message
+        PairedShellyDevice device = self->bleManager->getPairedDevice();
+
+        char success_msg[768];
+        snprintf(success_msg, sizeof(success_msg),
+                "{\"type\":\"success\",\"message\":\"<strong>Encryption Enabled!</strong><br><br>"
+                "Your device is now securely encrypted.<br><br>"
+                "<strong>🔑 Bindkey:</strong> %s<br><br>"
+                "⚠️ <strong>SAVE THIS BINDKEY!</strong><br>"
+                "You will need it for:<br>"
+                "• Re-pairing after factory reset<br>"
+                "• Integration with other systems<br>"
+                "• Backup and restore<br><br>"
+                "Continuous scan will now pick up sensor data...\"}",
+                device.bindkey.toHex().c_str());
+
+        // Sende Erfolgs-Nachricht
+        job.send(success_msg);
+
+        ESP_LOGI(TAG, "✓ Encryption enabled successfully");
+
+        vTaskDelay(pdMS_TO_TICKS(3000));
+
+        char close_msg[128];
+        snprintf(close_msg, sizeof(close_msg),
+                "{\"type\":\"modal_close\",\"modal_id\":\"enable-encryption-modal\"}");
+
+        job.send(close_msg);
+
+        // Continuous Scan starten
+        ESP_LOGI(TAG, "→ Starting continuous scan for sensor data...");
+        self->bleManager->startContinuousScan();
+
+        // Broadcast full status to ALL connected clients
+        vTaskDelay(pdMS_TO_TICKS(1000));
+        self->broadcastBLEStatus();
+        return true;
+
+    } else {
+        const char* error = 
+            "{\"type\":\"error\",\"message\":\"<strong>✗ Encryption Failed</strong><br><br>"
+            "Could not enable encryption.<br><br>"
+            "Possible reasons:<br>"
+            "• Wrong passkey<br>"
+            "• Device rejected passkey<br>"
+            "• Connection timeout<br>"
+            "• Bindkey not found in NVS<br><br>"
+            "Please try again or re-pair the device.\"}";
+
+        job.send(error);
+
+        ESP_LOGE(TAG, "✗ Encryption failed");
+    }
+    return false;
 }
 
 // ════════════════════════════════════════════════════════════════════════
 // BLE PAIR ALREADY-ENCRYPTED DEVICE (Passkey + Bindkey Known)
 // ════════════════════════════════════════════════════════════════════════
-
-else if (CMD_MATCH(cmd, "{\"cmd\":\"ble_pair_encrypted_known\"")) {
+esp_err_t WSCommandHandlers::ble_pair_encrypted_known(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
     if (self->bleManager) {
-        String json = String(cmd);
-        
-        // Parse address
-        int addrStart = json.indexOf("\"address\":\"") + 11;
-        int addrEnd = json.indexOf("\"", addrStart);
-        String address = json.substring(addrStart, addrEnd);
-        
-        // Parse passkey
-        int passkeyStart = json.indexOf("\"passkey\":") + 10;
-        int passkeyEnd = json.indexOf(",", passkeyStart);
-        String passkeyStr = json.substring(passkeyStart, passkeyEnd);
-        uint32_t passkey = passkeyStr.toInt();
-        
-        // Parse bindkey
-        int bindkeyStart = json.indexOf("\"bindkey\":\"") + 11;
-        int bindkeyEnd = json.indexOf("\"", bindkeyStart);
-        String bindkey = json.substring(bindkeyStart, bindkeyEnd);
-        
+        String address = json.getString("address", "");
+        uint32_t passkey = json.getUInt("passkey", 0);
+        String bindkey = json.getString("bindkey", "");
+
         ESP_LOGI(TAG, "═══════════════════════════════════");
         ESP_LOGI(TAG, "PAIR ALREADY-ENCRYPTED DEVICE");
         ESP_LOGI(TAG, "═══════════════════════════════════");
@@ -2477,45 +2924,31 @@ else if (CMD_MATCH(cmd, "{\"cmd\":\"ble_pair_encrypted_known\"")) {
         ESP_LOGI(TAG, "Passkey: %06u", passkey);
         ESP_LOGI(TAG, "Bindkey: %s", bindkey.c_str());
         ESP_LOGI(TAG, "");
-        
-        // Validate inputs
-        if (bindkey.length() != 32) {
+
+        // Validate inputs (Hex → binär nur hier an der UI-Grenze)
+        ShellyBindkey key;
+        if (bindkey.length() != ShellyBindkey::HEX_LEN) {
             ESP_LOGE(TAG, "✗ Invalid bindkey length: %d (expected 32)", bindkey.length());
-            
+
             const char* error = "{\"type\":\"error\",\"message\":\"Invalid bindkey length\"}";
-            httpd_ws_frame_t frame = {
-                .type = HTTPD_WS_TYPE_TEXT,
-                .payload = (uint8_t*)error,
-                .len = strlen(error)
-            };
-            httpd_ws_send_frame_async(req->handle, fd, &frame);
-            
-            free(buf);
+            self->sendToClient(fd, error, strlen(error));
+
             return ESP_OK;
         }
-        
+
         // Validate hex characters
-        for (int i = 0; i < 32; i++) {
-            char c = bindkey[i];
-            if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))) {
-                ESP_LOGE(TAG, "✗ Invalid bindkey character at position %d: '%c'", i, c);
-                
-                const char* error = "{\"type\":\"error\",\"message\":\"Bindkey must contain only hex characters (0-9, a-f)\"}";
-                httpd_ws_frame_t frame = {
-                    .type = HTTPD_WS_TYPE_TEXT,
-                    .payload = (uint8_t*)error,
-                    .len = strlen(error)
-                };
-                httpd_ws_send_frame_async(req->handle, fd, &frame);
-                
-                free(buf);
-                return ESP_OK;
-            }
+        if (!key.fromHex(bindkey)) {
+            ESP_LOGE(TAG, "✗ Invalid bindkey: non-hex characters");
+
+            const char* error = "{\"type\":\"error\",\"message\":\"Bindkey must contain only hex characters (0-9, a-f)\"}";
+            self->sendToClient(fd, error, strlen(error));
+
+            return ESP_OK;
         }
-        
+
         ESP_LOGI(TAG, "✓ Input validation passed");
         ESP_LOGI(TAG, "");
-        
+
         // Info-Message an Client
         const char* info = 
             "{\"type\":\"info\",\"message\":\"<strong>🔐 Pairing with Encrypted Device</strong><br><br>"
@@ -2525,355 +2958,300 @@ else if (CMD_MATCH(cmd, "{\"cmd\":\"ble_pair_encrypted_known\"")) {
             "• Store passkey and bindkey<br>"
             "• Start decrypting broadcasts<br>"
             "• Begin continuous scanning\"}";
-        
-        httpd_ws_frame_t frame = {
-            .type = HTTPD_WS_TYPE_TEXT,
-            .payload = (uint8_t*)info,
-            .len = strlen(info)
-        };
-        httpd_ws_send_frame_async(req->handle, fd, &frame);
-        
-        // Task-Parameter vorbereiten
-        struct EncryptedKnownParams {
-            ShellyBLEManager* bleManager;
-            WebUIHandler* handler;
-            int fd;
-            String address;
-            uint32_t passkey;
-            String bindkey;
-        };
-        
-        EncryptedKnownParams* params = new EncryptedKnownParams{
-            self->bleManager,
-            self,
-            fd,
-            address,
-            passkey,
-            bindkey
-        };
-        
-        // Memory Stats VOR Task-Erstellung
-        self->logMemoryStats("Before Encrypted Known Pairing Task");
-        
-        // Task erstellen (non-blocking)
-        xTaskCreate([](void* pvParameters) {
-            // RAII-Pattern
-            std::unique_ptr<EncryptedKnownParams> p(
-                static_cast<EncryptedKnownParams*>(pvParameters)
-            );
-            
-            ESP_LOGI(TAG, "🔐 Already-Encrypted Pairing Task started");
-            ESP_LOGI(TAG, "   Address: %s", p->address.c_str());
-            
-            // Watchdog entfernen
-            esp_task_wdt_delete(NULL);
-            
-            // Memory Stats VOR Operation
-            p->handler->logMemoryStats("Encrypted Known Pairing Start");
-            
-            // ════════════════════════════════════════════════════════════════
-            // SCHRITT 1: Secure Bonding (OHNE Button-Press!)
-            // ════════════════════════════════════════════════════════════════
-            
-            ESP_LOGI(TAG, "");
-            ESP_LOGI(TAG, "╔═══════════════════════════════════╗");
-            ESP_LOGI(TAG, "║   STEP 1: SECURE BONDING          ║");
-            ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
-            ESP_LOGI(TAG, "");
-            ESP_LOGI(TAG, "→ Establishing bonded connection...");
-            ESP_LOGI(TAG, "  (No button press needed - already encrypted)");
-            ESP_LOGI(TAG, "");
-            
-            // Get device info from discovered list
-            uint8_t addressType = BLE_ADDR_RANDOM;  // Default für Shelly
-            
-            const auto& discovered = p->bleManager->getDiscoveredDevices();
-            for (const auto& dev : discovered) {
-                if (dev.address.equalsIgnoreCase(p->address)) {
-                    addressType = dev.addressType;
-                    break;
-                }
-            }
-            
-            // NimBLE Security Setup
-            NimBLEDevice::setSecurityAuth(true, false, true);  // Bonding, No MITM, SC
-            NimBLEDevice::setSecurityIOCap(BLE_HS_IO_NO_INPUT_OUTPUT);  // Just Works
-            
-            // Create client
-            NimBLEClient* pClient = NimBLEDevice::createClient();
-            if (!pClient) {
-                ESP_LOGE(TAG, "✗ Failed to create client");
-                
-                const char* error = "{\"type\":\"error\",\"message\":\"Failed to create BLE client\"}";
-                if (xSemaphoreTake(p->handler->client_mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-                    httpd_ws_frame_t frame = {
-                        .type = HTTPD_WS_TYPE_TEXT,
-                        .payload = (uint8_t*)error,
-                        .len = strlen(error)
-                    };
-                    httpd_ws_send_frame_async(p->handler->server, p->fd, &frame);
-                    xSemaphoreGive(p->handler->client_mutex);
-                }
-                // unique_ptr wird automatisch freigegeben
-                vTaskDelete(NULL);
-                return;
-            }
-            
-            pClient->setConnectTimeout(15000);
-            
-            // Connect
-            NimBLEAddress bleAddr(p->address.c_str(), addressType);
-            bool connected = pClient->connect(bleAddr, false);
-            
-            if (!connected) {
-                // Try alternative address type
-                uint8_t altType = (addressType == BLE_ADDR_PUBLIC) ? BLE_ADDR_RANDOM : BLE_ADDR_PUBLIC;
-                ESP_LOGI(TAG, "→ Trying alternative address type...");
-                
-                bleAddr = NimBLEAddress(p->address.c_str(), altType);
-                connected = pClient->connect(bleAddr, false);
-            }
-            
-            if (!connected) {
-                ESP_LOGE(TAG, "✗ Connection failed");
-                
-                const char* error = "{\"type\":\"error\",\"message\":\"Connection failed. Device not reachable.\"}";
-                if (xSemaphoreTake(p->handler->client_mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-                    httpd_ws_frame_t frame = {
-                        .type = HTTPD_WS_TYPE_TEXT,
-                        .payload = (uint8_t*)error,
-                        .len = strlen(error)
-                    };
-                    httpd_ws_send_frame_async(p->handler->server, p->fd, &frame);
-                    xSemaphoreGive(p->handler->client_mutex);
-                }
-                
-                NimBLEDevice::deleteClient(pClient);
-                // unique_ptr cleanup
-                vTaskDelete(NULL);
-                return;
-            }
-            
-            ESP_LOGI(TAG, "✓ Connected");
-            ESP_LOGI(TAG, "");
-            
-            // Request secure connection (bonding)
-            ESP_LOGI(TAG, "→ Requesting secure connection...");
-            bool secureResult = pClient->secureConnection();
-            
-            if (!secureResult) {
-                ESP_LOGE(TAG, "✗ Secure connection failed");
-                
-                pClient->disconnect();
-                NimBLEDevice::deleteClient(pClient);
-                
-                const char* error = "{\"type\":\"error\",\"message\":\"Bonding failed\"}";
-                if (xSemaphoreTake(p->handler->client_mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-                    httpd_ws_frame_t frame = {
-                        .type = HTTPD_WS_TYPE_TEXT,
-                        .payload = (uint8_t*)error,
-                        .len = strlen(error)
-                                            };
-                    httpd_ws_send_frame_async(p->handler->server, p->fd, &frame);
-                    xSemaphoreGive(p->handler->client_mutex);
-                }
-                
-                // unique_ptr cleanup
-                vTaskDelete(NULL);
-                return;
-            }
-            
-            ESP_LOGI(TAG, "✓ Bonding complete");
-            ESP_LOGI(TAG, "");
-            
-            // Disconnect (nicht mehr benötigt)
-            pClient->disconnect();
-            
-            uint8_t retries = 0;
-            while (pClient->isConnected() && retries < 20) {
-                vTaskDelay(pdMS_TO_TICKS(100));
-                retries++;
-            }
-            
-            NimBLEDevice::deleteClient(pClient);
-            
-            // ════════════════════════════════════════════════════════════════
-            // SCHRITT 2: Credentials speichern
-            // ════════════════════════════════════════════════════════════════
-            
-            ESP_LOGI(TAG, "");
-            ESP_LOGI(TAG, "╔═══════════════════════════════════╗");
-            ESP_LOGI(TAG, "║   STEP 2: STORE CREDENTIALS       ║");
-            ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
-            ESP_LOGI(TAG, "");
-            
-            // Find device name from discovered list
-            String deviceName = "Unknown";
-            for (const auto& dev : discovered) {
-                if (dev.address.equalsIgnoreCase(p->address)) {
-                    deviceName = dev.name;
-                    break;
-                }
-            }
-            
-            // Store in BLE Manager
-            Preferences prefs;
-            prefs.begin("ShellyBLE", false);
-            prefs.putString("address", p->address);
-            prefs.putString("name", deviceName);
-            prefs.putString("bindkey", p->bindkey);
-            prefs.putUInt("passkey", p->passkey);
-            prefs.end();
-            
-            ESP_LOGI(TAG, "✓ Stored in NVS:");
-            ESP_LOGI(TAG, "  Address: %s", p->address.c_str());
-            ESP_LOGI(TAG, "  Name: %s", deviceName.c_str());
-            ESP_LOGI(TAG, "  Passkey: %06u", p->passkey);
-            ESP_LOGI(TAG, "  Bindkey: %s", p->bindkey.c_str());
-            ESP_LOGI(TAG, "");
-            
-            // Update internal state (reload from NVS)
-            p->bleManager->loadPairedDevice();
-            p->bleManager->updateDeviceState(ShellyBLEManager::STATE_CONNECTED_ENCRYPTED);
-            
-            // ════════════════════════════════════════════════════════════════
-            // SCHRITT 3: Continuous Scan starten
-            // ════════════════════════════════════════════════════════════════
-            
-            ESP_LOGI(TAG, "");
-            ESP_LOGI(TAG, "╔═══════════════════════════════════╗");
-            ESP_LOGI(TAG, "║   STEP 3: START CONTINUOUS SCAN   ║");
-            ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
-            ESP_LOGI(TAG, "");
-            
-            vTaskDelay(pdMS_TO_TICKS(1000));
-            
-            p->bleManager->startContinuousScan();
-            
-            ESP_LOGI(TAG, "✓ Continuous scan started");
-            ESP_LOGI(TAG, "");
-            
-            // Memory Stats NACH Operation
-            p->handler->logMemoryStats("Encrypted Known Pairing End");
-            
-            // ════════════════════════════════════════════════════════════════
-            // SUCCESS MESSAGE
-            // ════════════════════════════════════════════════════════════════
-            
-            char success_msg[1024];
-            snprintf(success_msg, sizeof(success_msg),
-                    "{\"type\":\"success\",\"message\":\"<strong>Encrypted Device Paired!</strong><br><br>"
-                    "Your device is now connected:<br>"
-                    "✓ Secure bonded connection<br>"
-                    "✓ Passkey: %06u<br>"
-                    "✓ Bindkey: %s<br><br>"
-                    "Broadcasts will be decrypted automatically.<br>"
-                    "Continuous scan is now active.\"}",
-                    p->passkey,
-                    p->bindkey.c_str());
-            
-            if (xSemaphoreTake(p->handler->client_mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-                httpd_ws_frame_t frame = {
-                    .type = HTTPD_WS_TYPE_TEXT,
-                    .payload = (uint8_t*)success_msg,
-                    .len = strlen(success_msg)
-                };
-                httpd_ws_send_frame_async(p->handler->server, p->fd, &frame);
-                xSemaphoreGive(p->handler->client_mutex);
-            }
-            
-            ESP_LOGI(TAG, "✓ Pairing successful");
-            
-            // Modal schließen
-            vTaskDelay(pdMS_TO_TICKS(2000));
-            p->handler->sendModalClose(p->fd, "ble-encrypted-known-modal");
-            
-            // Broadcast full status to ALL connected clients
-            vTaskDelay(pdMS_TO_TICKS(1000));
-            p->handler->broadcastBLEStatus();
-            
-            // High Water Mark Logging
-            UBaseType_t highWater = uxTaskGetStackHighWaterMark(NULL);
-            ESP_LOGI(TAG, "Task -ble_enc_known- Stack High Water Mark: %u bytes", 
-                     highWater * sizeof(StackType_t));
-            
-            if (highWater < 512) {
-                ESP_LOGW(TAG, "⚠️ Stack critically low! Consider increasing size.");
-            }
-            
-            ESP_LOGI(TAG, "");
-            ESP_LOGI(TAG, "╔═══════════════════════════════════╗");
-            ESP_LOGI(TAG, "║  TASK COMPLETE                 ║");
-            ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
-            ESP_LOGI(TAG, "");
-            
-            // unique_ptr wird automatisch freigegeben
-            vTaskDelete(NULL);
-            
-        }, "ble_enc_known", 4086, params, 5, NULL);  // Stack: 4KB
-        
-        ESP_LOGI(TAG, "✓ Already-Encrypted pairing task created");
+
+        self->sendToClient(fd, info, strlen(info));
+
+        // Memory Stats VOR Job
+        self->logMemoryStats("Before Encrypted Known Pairing Job");
+
+        // Job einreihen (non-blocking, Bindkey binär im Job-Slot)
+        if (self->submit_job("ble_pair_encrypted_known", ble_pair_encrypted_known_job, fd,
+                             address.c_str(), passkey, &key)) {
+            ESP_LOGI(TAG, "✓ Already-Encrypted pairing job queued");
+        }
+    }
+    return ESP_OK;
+}
+
+// Läuft im Job-Worker (ws_jobs.h)
+bool WSCommandHandlers::ble_pair_encrypted_known_job(WSJob& job) {
+    WebUIHandler* self = (WebUIHandler*)job.args().ctx;
+    const char* address = job.args().address;
+    uint32_t passkey = job.args().passkey;
+    ShellyBindkey bindkey(job.args().bindkey);
+
+    ESP_LOGI(TAG, "🔐 Already-Encrypted Pairing Task started");
+    ESP_LOGI(TAG, "   Address: %s", address);
+
+    // Memory Stats VOR Operation
+    self->logMemoryStats("Encrypted Known Pairing Start");
+
+    // ════════════════════════════════════════════════════════════════
+    // SCHRITT 1: Secure Bonding (OHNE Button-Press!)
+    // ════════════════════════════════════════════════════════════════
+
+    ESP_LOGI(TAG, "");
+    ESP_LOGI(TAG, "╔═══════════════════════════════════╗");
+    ESP_LOGI(TAG, "║   STEP 1: SECURE BONDING          ║");
+    ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
+    ESP_LOGI(TAG, "");
+    ESP_LOGI(TAG, "→ Establishing bonded connection...");
+    ESP_LOGI(TAG, "  (No button press needed - already encrypted)");
+    ESP_LOGI(TAG, "");
+    job.progress(10, "Establishing bonded connection");
+
+    // Get device info from discovered list
+    uint8_t addressType = BLE_ADDR_RANDOM;  // Default für Shelly
+
+    const ShellyBLEDevice* dev = self->bleManager->getDiscoveredDevices().find(address);
+    if (dev) {
+        addressType = dev->addressType;
+    }
+
+    // NimBLE Stack ist lazy - ggf. erst jetzt starten
+    if (!self->bleManager->ensureBLEStarted()) {
+        ESP_LOGE(TAG, "✗ BLE could not be started");
+
+        const char* error = "{\"type\":\"error\",\"message\":\"BLE could not be started\"}";
+        job.send(error);
+        return false;
+    }
+
+    // NimBLE Security Setup
+    NimBLEDevice::setSecurityAuth(true, false, true);  // Bonding, No MITM, SC
+    NimBLEDevice::setSecurityIOCap(BLE_HS_IO_NO_INPUT_OUTPUT);  // Just Works
+
+    // Create client
+    NimBLEClient* pClient = NimBLEDevice::createClient();
+    if (!pClient) {
+        ESP_LOGE(TAG, "✗ Failed to create client");
+
+        const char* error = "{\"type\":\"error\",\"message\":\"Failed to create BLE client\"}";
+        job.send(error);
+        return false;
+    }
+
+    pClient->setConnectTimeout(15000);
+
+    // Connect
+    NimBLEAddress bleAddr(address, addressType);
+    bool connected = pClient->connect(bleAddr, false);
+
+    if (!connected) {
+        // Try alternative address type
+        uint8_t altType = (addressType == BLE_ADDR_PUBLIC) ? BLE_ADDR_RANDOM : BLE_ADDR_PUBLIC;
+        ESP_LOGI(TAG, "→ Trying alternative address type...");
+
+        bleAddr = NimBLEAddress(address, altType);
+        connected = pClient->connect(bleAddr, false);
     }
-}
 
+    if (!connected) {
+        ESP_LOGE(TAG, "✗ Connection failed");
+
+        const char* error = "{\"type\":\"error\",\"message\":\"Connection failed. Device not reachable.\"}";
+        job.send(error);
+
+        NimBLEDevice::deleteClient(pClient);
+        return false;
+    }
+
+    ESP_LOGI(TAG, "✓ Connected");
+    ESP_LOGI(TAG, "");
+
+    // Request secure connection (bonding)
+    ESP_LOGI(TAG, "→ Requesting secure connection...");
+    bool secureResult = pClient->secureConnection();
+
+    if (!secureResult) {
+        ESP_LOGE(TAG, "✗ Secure connection failed");
+
+        pClient->disconnect();
+        NimBLEDevice::deleteClient(pClient);
+
+        const char* error = "{\"type\":\"error\",\"message\":\"Bonding failed\"}";
+        job.send(error);
+
+        return false;
+    }
+
+    ESP_LOGI(TAG, "✓ Bonding complete");
+    ESP_LOGI(TAG, "");
+
+    // Disconnect (nicht mehr benötigt)
+    pClient->disconnect();
+
+    uint8_t retries = 0;
+    while (pClient->isConnected() && retries < 20) {
+        vTaskDelay(pdMS_TO_TICKS(100));
+        retries++;
+    }
+
+    NimBLEDevice::deleteClient(pClient);
+
+    // Letzter Abbruchpunkt vor dem Speichern
+    if (job.cancelled()) {
+        ESP_LOGW(TAG, "Pairing cancelled - credentials not stored");
+        return false;
+    }
+    job.progress(60, "Storing credentials");
+
+    // ════════════════════════════════════════════════════════════════
+    // SCHRITT 2: Credentials speichern
+    // ════════════════════════════════════════════════════════════════
+
+    ESP_LOGI(TAG, "");
+    ESP_LOGI(TAG, "╔═══════════════════════════════════╗");
+    ESP_LOGI(TAG, "║   STEP 2: STORE CREDENTIALS       ║");
+    ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
+    ESP_LOGI(TAG, "");
+
+    // Registry-Eintrag mit binärem Bindkey (Name/Address Type aus der Discovery)
+    self->bleManager->savePasskey(passkey);
+
+    if (!self->bleManager->pairDevice(address, bindkey)) {
+        ESP_LOGE(TAG, "✗ Storing credentials failed");
+
+        const char* error = "{\"type\":\"error\",\"message\":\"Storing credentials failed (already paired or registry full)\"}";
+        job.send(error);
+
+        return false;
+    }
+
+    ESP_LOGI(TAG, "✓ Stored in sensor registry:");
+    ESP_LOGI(TAG, "  Address: %s", address);
+    ESP_LOGI(TAG, "  Passkey: %06u", passkey);
+    ESP_LOGI(TAG, "");
+
+    self->bleManager->updateDeviceState(ShellyBLEManager::STATE_CONNECTED_ENCRYPTED);
+
+    // ════════════════════════════════════════════════════════════════
+    // SCHRITT 3: Continuous Scan starten
+    // ════════════════════════════════════════════════════════════════
+
+    ESP_LOGI(TAG, "");
+    ESP_LOGI(TAG, "╔═══════════════════════════════════╗");
+    ESP_LOGI(TAG, "║   STEP 3: START CONTINUOUS SCAN   ║");
+    ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
+    ESP_LOGI(TAG, "");
+
+    vTaskDelay(pdMS_TO_TICKS(1000));
+
+    self->bleManager->startContinuousScan();
+
+    ESP_LOGI(TAG, "✓ Continuous scan started");
+    ESP_LOGI(TAG, "");
+
+    // Memory Stats NACH Operation
+    self->logMemoryStats("Encrypted Known Pairing End");
+
+    // ════════════════════════════════════════════════════════════════
+    // SUCCESS MESSAGE
+    // ════════════════════════════════════════════════════════════════
+
+    char success_msg[1024];
+    snprintf(success_msg, sizeof(success_msg),
+            "{\"type\":\"success\",\"message\":\"<strong>Encrypted Device Paired!</strong><br><br>"
+            "Your device is now connected:<br>"
+            "✓ Secure bonded connection<br>"
+            "✓ Passkey: %06u<br>"
+            "✓ Bindkey: %s<br><br>"
+            "Broadcasts will be decrypted automatically.<br>"
+            "Continuous scan is now active.\"}",
+            passkey,
+            bindkey.toHex().c_str());
+
+    job.send(success_msg);
+
+    ESP_LOGI(TAG, "✓ Pairing successful");
 
+    // Modal schließen
+    vTaskDelay(pdMS_TO_TICKS(2000));
+    self->sendModalClose(job.fd(), "ble-encrypted-known-modal");
+
+    // Broadcast full status to ALL connected clients
+    vTaskDelay(pdMS_TO_TICKS(1000));
+    self->broadcastBLEStatus();
+
+    ESP_LOGI(TAG, "");
+    ESP_LOGI(TAG, "╔═══════════════════════════════════╗");
+    ESP_LOGI(TAG, "║  TASK COMPLETE                 ║");
+    ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
+    ESP_LOGI(TAG, "");
+    return true;
+}
 
-else if (CMD_MATCH(cmd, "{\"cmd\":\"ble_unpair\"")) {
+esp_err_t WSCommandHandlers::ble_unpair(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
     if (self->bleManager) {
+        // Optional: "address" → nur diesen Sensor entfernen, sonst alle
+        String address = json.getString("address", "");
+
         ESP_LOGI(TAG, "═══════════════════════════════════");
         ESP_LOGI(TAG, "BLE UNPAIRING");
         ESP_LOGI(TAG, "═══════════════════════════════════");
-        
-        if (self->bleManager->unpairDevice()) {
-            // ✓ Callback für Contact Sensor Endpoint Removal
-            if (self->remove_contact_sensor_callback) {
+        ESP_LOGI(TAG, "Target: %s", address.length() > 0 ? address.c_str() : "ALL");
+
+        bool ok = address.length() > 0 ? self->bleManager->unpairDevice(address)
+                                       : self->bleManager->unpairDevice();
+
+        if (ok) {
+            // ✓ Contact Sensor Endpoint nur entfernen, wenn kein Fensterkontakt mehr gepairt ist
+            bool contactLeft = false;
+            for (size_t i = 0; i < self->bleManager->getPairedDeviceCount(); i++) {
+                if (self->bleManager->getPairedDevice(i).role == ShellySensorRole::WINDOW_CONTACT) {
+                    contactLeft = true;
+                    break;
+                }
+            }
+
+            if (!contactLeft && self->remove_contact_sensor_callback) {
                 ESP_LOGI(TAG, "→ Removing Contact Sensor endpoint...");
                 self->remove_contact_sensor_callback();
             }
-            
+
             const char* success = "{\"type\":\"info\",\"message\":\"Device unpaired\"}";
-            httpd_ws_frame_t frame = {
-                .type = HTTPD_WS_TYPE_TEXT,
-                .payload = (uint8_t*)success,
-                .len = strlen(success)
-            };
-            httpd_ws_send_frame_async(req->handle, fd, &frame);
-            
+            self->sendToClient(fd, success, strlen(success));
+
             ESP_LOGI(TAG, "✓ Device unpaired");
             ESP_LOGI(TAG, "✓ Continuous scan stopped");
             // Notify ALL open browser tabs that the device is now unpaired
             self->broadcastBLEStatus();
         }
     }
+    return ESP_OK;
 }
 
-else if (CMD_MATCH(cmd, "{\"cmd\":\"ble_pair\"")) {
+esp_err_t WSCommandHandlers::ble_pair(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
     if (self->bleManager) {
-        String json = String(cmd);
-        
-        int addrStart = json.indexOf("\"address\":\"") + 11;
-        int addrEnd = json.indexOf("\"", addrStart);
-        String address = json.substring(addrStart, addrEnd);
-        
-        int bindStart = json.indexOf("\"bindkey\":\"") + 11;
-        int bindEnd = json.indexOf("\"", bindStart);
-        String bindkey = json.substring(bindStart, bindEnd);
-        
+        String address = json.getString("address", "");
+        String bindkey = json.getString("bindkey", "");
+
+        // Optional: "role" (window_contact | button | illuminance)
+        ShellySensorRole role = ShellySensorRole::WINDOW_CONTACT;
+        const char* roleStr = json.getString("role");
+        bool hasRole = roleStr && sensorRoleFromString(roleStr, role);
+
         ESP_LOGI(TAG, "═══════════════════════════════════");
         ESP_LOGI(TAG, "BLE PAIRING (Unencrypted)");
         ESP_LOGI(TAG, "═══════════════════════════════════");
         ESP_LOGI(TAG, "Address: %s", address.c_str());
         ESP_LOGI(TAG, "Bindkey: %s", bindkey.length() > 0 ? "[provided]" : "[empty]");
-        
-        if (self->bleManager->pairDevice(address, bindkey)) {
+        ESP_LOGI(TAG, "Role:    %s", hasRole ? sensorRoleToString(role) : "[auto]");
+
+        // Hex → binär nur hier an der UI-Grenze
+        ShellyBindkey key;
+        bool ok = key.fromHex(bindkey);
+        if (!ok) {
+            ESP_LOGE(TAG, "✗ Invalid bindkey (expected 32 hex characters)");
+        } else {
+            ok = hasRole ? self->bleManager->pairDevice(address, key, role)
+                         : self->bleManager->pairDevice(address, key);
+        }
+
+        if (ok) {
             const char* success = "{\"type\":\"info\",\"message\":\"Device paired successfully!\"}";
-            httpd_ws_frame_t frame = {
-                .type = HTTPD_WS_TYPE_TEXT,
-                .payload = (uint8_t*)success,
-                .len = strlen(success)
-            };
-            httpd_ws_send_frame_async(req->handle, fd, &frame);
-            
+            self->sendToClient(fd, success, strlen(success));
+
             ESP_LOGI(TAG, "✓ Pairing successful");
 
             // Continuous Scan starten
@@ -2885,19 +3263,15 @@ else if (CMD_MATCH(cmd, "{\"cmd\":\"ble_pair\"")) {
 
         } else {
             const char* error = "{\"type\":\"error\",\"message\":\"Failed to pair device\"}";
-            httpd_ws_frame_t frame = {
-                .type = HTTPD_WS_TYPE_TEXT,
-                .payload = (uint8_t*)error,
-                .len = strlen(error)
-            };
-            httpd_ws_send_frame_async(req->handle, fd, &frame);
-            
+            self->sendToClient(fd, error, strlen(error));
+
             ESP_LOGE(TAG, "✗ Pairing failed");
         }
     }
+    return ESP_OK;
 }
 
-else if (strcmp(cmd, "ble_start_continuous_scan") == 0) {
+esp_err_t WSCommandHandlers::ble_start_continuous_scan(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
     if (self->bleManager) {
         if (self->bleManager->isPaired()) {
             ESP_LOGI(TAG, "Starting continuous BLE scan (paired device exists)");
@@ -2905,322 +3279,368 @@ else if (strcmp(cmd, "ble_start_continuous_scan") == 0) {
             self->broadcastBLEStatus();
         } else {
             ESP_LOGW(TAG, "Cannot start continuous scan - no device paired");
-            
+
             const char* error = "{\"type\":\"error\",\"message\":\"No device paired\"}";
-            httpd_ws_frame_t frame = {
-                .type = HTTPD_WS_TYPE_TEXT,
-                .payload = (uint8_t*)error,
-                .len = strlen(error)
-            };
-            httpd_ws_send_frame_async(req->handle, fd, &frame);
+            self->sendToClient(fd, error, strlen(error));
         }
     }
+    return ESP_OK;
 }
 
-else if (strcmp(cmd, "ble_stop_scan") == 0) {
+esp_err_t WSCommandHandlers::ble_stop_scan(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
     if (self->bleManager) {
         ESP_LOGI(TAG, "");
         ESP_LOGI(TAG, "╔═══════════════════════════════════╗");
         ESP_LOGI(TAG, "║  USER: STOP CONTINUOUS SCAN       ║");
         ESP_LOGI(TAG, "╚═══════════════════════════════════╝");
         ESP_LOGI(TAG, "");
-        
+
         // KRITISCH: stopScan(true) = manueller Stop!
         // Dies verhindert Auto-Restart und setzt NVS auf false
         self->bleManager->stopScan(true);
-        
+
         const char* success = 
             "{\"type\":\"info\",\"message\":\"Continuous scanning stopped by user\"}";
-        httpd_ws_frame_t frame = {
-            .type = HTTPD_WS_TYPE_TEXT,
-            .payload = (uint8_t*)success,
-            .len = strlen(success)
-        };
-        httpd_ws_send_frame_async(req->handle, fd, &frame);
-        
+        self->sendToClient(fd, success, strlen(success));
+
         ESP_LOGI(TAG, "✓ Continuous scan stopped (manual)");
         ESP_LOGI(TAG, "  NVS updated: continuous_scan = false");
         ESP_LOGI(TAG, "  Will NOT auto-restart");
         ESP_LOGI(TAG, "");
-        
+
         // Broadcast full status to ALL connected clients
         vTaskDelay(pdMS_TO_TICKS(500));
         self->broadcastBLEStatus();
     } else {
         const char* error = "{\"type\":\"error\",\"message\":\"BLE Manager not available\"}";
-        httpd_ws_frame_t frame = {
-            .type = HTTPD_WS_TYPE_TEXT,
-            .payload = (uint8_t*)error,
-            .len = strlen(error)
-        };
-        httpd_ws_send_frame_async(req->handle, fd, &frame);
+        self->sendToClient(fd, error, strlen(error));
     }
+    return ESP_OK;
 }
 
-    // ============================================================================
-    // Contact Sensor Matter Toggle Commands
-    // ============================================================================
+// ============================================================================
+// Contact Sensor Matter Toggle Commands
+// ============================================================================
+esp_err_t WSCommandHandlers::contact_sensor_enable(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
+    ESP_LOGI(TAG, "WebSocket: Enable Contact Sensor for Matter");
 
-    else if (strcmp(cmd, "contact_sensor_enable") == 0) {
-        ESP_LOGI(TAG, "WebSocket: Enable Contact Sensor for Matter");
-        
-        extern void enableContactSensorMatter();
-        enableContactSensorMatter();
-        
-        const char* success = "{\"type\":\"info\",\"message\":\"Contact Sensor enabled for Matter\"}";
-        httpd_ws_frame_t frame = {
-            .type = HTTPD_WS_TYPE_TEXT,
-            .payload = (uint8_t*)success,
-            .len = strlen(success)
-        };
-        httpd_ws_send_frame_async(req->handle, fd, &frame);
-    }
-    else if (strcmp(cmd, "contact_sensor_disable") == 0) {
-        ESP_LOGI(TAG, "WebSocket: Disable Contact Sensor for Matter");
-        
-        extern void disableContactSensorMatter();
-        disableContactSensorMatter();
-        
-        const char* success = "{\"type\":\"info\",\"message\":\"Contact Sensor disabled for Matter\"}";
-        httpd_ws_frame_t frame = {
-            .type = HTTPD_WS_TYPE_TEXT,
-            .payload = (uint8_t*)success,
-            .len = strlen(success)
-        };
-        httpd_ws_send_frame_async(req->handle, fd, &frame);
-    }
+    extern void enableContactSensorMatter();
+    enableContactSensorMatter();
 
-    // ════════════════════════════════════════════════════════════════════════
-    // BLE READ SENSOR DATA (GATT)
-    // ════════════════════════════════════════════════════════════════════════
+    const char* success = "{\"type\":\"info\",\"message\":\"Contact Sensor enabled for Matter\"}";
+    self->sendToClient(fd, success, strlen(success));
+    return ESP_OK;
+}
 
-    else if (strcmp(cmd, "read_sensor_data") == 0) {
-        if (self->bleManager) {
-            if (!self->bleManager->isPaired()) {
-                const char* error = "{\"type\":\"error\",\"message\":\"No device paired\"}";
-                httpd_ws_frame_t frame = {
-                    .type = HTTPD_WS_TYPE_TEXT,
-                    .payload = (uint8_t*)error,
-                    .len = strlen(error)
-                };
-                httpd_ws_send_frame_async(req->handle, fd, &frame);
-                free(buf);
-                return ESP_OK;
-            }
-            
-            ESP_LOGI(TAG, "═══════════════════════════════════");
-            ESP_LOGI(TAG, "WebSocket: READ SENSOR DATA (GATT)");
-            ESP_LOGI(TAG, "═══════════════════════════════════");
-            
-            PairedShellyDevice device = self->bleManager->getPairedDevice();
-            
-            // GATT Read in separatem Task (non-blocking)
-            struct ReadTaskParams {
-                ShellyBLEManager* bleManager;
-                WebUIHandler* handler;
-                int fd;
-                String address;
-            };
-            
-            ReadTaskParams* params = new ReadTaskParams{
-                self->bleManager,
-                self,
-                fd,
-                device.address
-            };
-            
-            // Memory Stats VOR Task-Erstellung
-            self->logMemoryStats("Before Read Sensor Data Task");
-            
-            xTaskCreate([](void* pvParameters) {
-                // RAII-Pattern
-                std::unique_ptr<ReadTaskParams> p(
-                    static_cast<ReadTaskParams*>(pvParameters)
-                );
-                
-                ESP_LOGI(TAG, "📖 Read Task started for %s", p->address.c_str());
-                
-                // Watchdog für diesen Task entfernen (kann lange dauern)
-                esp_task_wdt_delete(NULL);
-                
-                // Memory Stats VOR Operation
-                p->handler->logMemoryStats("Read Sensor Data Start");
-                
-                ShellyBLESensorData data;
-                bool success = p->bleManager->readSampleBTHomeData(p->address, data);
-                
-                // Memory Stats NACH Operation
-                p->handler->logMemoryStats("Read Sensor Data End");
-                
-                if (success) {
-                    // Erfolg - Sende Daten an WebUI
-                    char json_buf[512];
-                    snprintf(json_buf, sizeof(json_buf),
-                            "{\"type\":\"sensor_data_result\","
-                            "\"success\":true,"
-                            "\"packet_id\":%d,"
-                            "\"battery\":%d,"
-                            "\"window_open\":%s,"
-                            "\"illuminance\":%u,"
-                            "\"rotation\":%d,"
-                            "\"rssi\":%d,"
-                            "\"valid\":true}",
-                            data.packetId,
-                            data.battery,
-                            data.windowOpen ? "true" : "false",
-                            data.illuminance,
-                            data.rotation,
-                            data.rssi);
-                    
-                    if (xSemaphoreTake(p->handler->client_mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-                        httpd_ws_frame_t frame = {
-                            .type = HTTPD_WS_TYPE_TEXT,
-                            .payload = (uint8_t*)json_buf,
-                            .len = strlen(json_buf)
-                        };
-                        httpd_ws_send_frame_async(p->handler->server, p->fd, &frame);
-                        xSemaphoreGive(p->handler->client_mutex);
-                    }
-                    
-                    ESP_LOGI(TAG, "✓ Sensor data sent to WebUI");
-                    
-                } else {
-                    // Fehler
-                    const char* error = "{\"type\":\"sensor_data_result\","
-                                    "\"success\":false,"
-                                    "\"error\":\"Failed to read sensor data\"}";
-                    
-                    if (xSemaphoreTake(p->handler->client_mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-                        httpd_ws_frame_t frame = {
-                            .type = HTTPD_WS_TYPE_TEXT,
-                            .payload = (uint8_t*)error,
-                            .len = strlen(error)
-                        };
-                        httpd_ws_send_frame_async(p->handler->server, p->fd, &frame);
-                        xSemaphoreGive(p->handler->client_mutex);
-                    }
-                    
-                    ESP_LOGE(TAG, "✗ Failed to read sensor data");
-                }
-                
-                // High Water Mark Logging
-                UBaseType_t highWater = uxTaskGetStackHighWaterMark(NULL);
-                ESP_LOGI(TAG, "Task -ble_read- Stack High Water Mark: %u bytes", 
-                        highWater * sizeof(StackType_t));
-                
-                if (highWater < 512) {
-                    ESP_LOGW(TAG, "⚠️ Stack critically low! Consider increasing size.");
-                }
-                
-                // unique_ptr wird automatisch freigegeben
-                vTaskDelete(NULL);
-                
-            }, "ble_read", 5120, params, 5, NULL);  // Stack: 5KB (GATT read + char json_buf[512])
-            
-            // Sofort Info an User senden
-            const char* info = "{\"type\":\"info\",\"message\":\"Reading sensor data via GATT...\"}";
-            httpd_ws_frame_t frame = {
-                .type = HTTPD_WS_TYPE_TEXT,
-                .payload = (uint8_t*)info,
-                .len = strlen(info)
-            };
-            httpd_ws_send_frame_async(req->handle, fd, &frame);
+esp_err_t WSCommandHandlers::contact_sensor_disable(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
+    ESP_LOGI(TAG, "WebSocket: Disable Contact Sensor for Matter");
+
+    extern void disableContactSensorMatter();
+    disableContactSensorMatter();
+
+    const char* success = "{\"type\":\"info\",\"message\":\"Contact Sensor disabled for Matter\"}";
+    self->sendToClient(fd, success, strlen(success));
+    return ESP_OK;
+}
+
+// ════════════════════════════════════════════════════════════════════════
+// BLE READ SENSOR DATA (GATT)
+// ════════════════════════════════════════════════════════════════════════
+esp_err_t WSCommandHandlers::read_sensor_data(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
+    if (self->bleManager) {
+        if (!self->bleManager->isPaired()) {
+            const char* error = "{\"type\":\"error\",\"message\":\"No device paired\"}";
+            self->sendToClient(fd, error, strlen(error));
+            return ESP_OK;
+        }
+
+        ESP_LOGI(TAG, "═══════════════════════════════════");
+        ESP_LOGI(TAG, "WebSocket: READ SENSOR DATA (GATT)");
+        ESP_LOGI(TAG, "═══════════════════════════════════");
+
+        PairedShellyDevice device = self->bleManager->getPairedDevice();
+
+        // Memory Stats VOR Job
+        self->logMemoryStats("Before Read Sensor Data Job");
+
+        // GATT Read im Job-Worker (non-blocking)
+        if (!self->submit_job("read_sensor_data", read_sensor_data_job, fd,
+                              device.address.c_str())) {
+            return ESP_OK;
         }
+
+        // Sofort Info an User senden
+        const char* info = "{\"type\":\"info\",\"message\":\"Reading sensor data via GATT...\"}";
+        self->sendToClient(fd, info, strlen(info));
     }
+    return ESP_OK;
+}
 
-    else if (strcmp(cmd, "contact_sensor_status") == 0) {
-        extern volatile bool contact_sensor_matter_enabled;
-        extern volatile bool contact_sensor_endpoint_active;
-        
-        char status_buf[128];
-        snprintf(status_buf, sizeof(status_buf),
-                "{\"type\":\"contact_sensor_status\","
-                "\"enabled\":%s,"
-                "\"active\":%s}",
-                contact_sensor_matter_enabled ? "true" : "false",
-                contact_sensor_endpoint_active ? "true" : "false");
-        
-        httpd_ws_frame_t frame = {
-            .type = HTTPD_WS_TYPE_TEXT,
-            .payload = (uint8_t*)status_buf,
-            .len = strlen(status_buf)
-        };
-        httpd_ws_send_frame_async(req->handle, fd, &frame);
+// Läuft im Job-Worker (ws_jobs.h)
+bool WSCommandHandlers::read_sensor_data_job(WSJob& job) {
+    WebUIHandler* self = (WebUIHandler*)job.args().ctx;
+    const char* address = job.args().address;
+
+    ESP_LOGI(TAG, "📖 Read Task started for %s", address);
+
+    // Memory Stats VOR Operation
+    self->logMemoryStats("Read Sensor Data Start");
+
+    ShellyBLESensorData data;
+    bool success = self->bleManager->readSampleBTHomeData(address, data);
+
+    // Memory Stats NACH Operation
+    self->logMemoryStats("Read Sensor Data End");
+
+    if (success) {
+        // Erfolg - Sende Daten an WebUI
+        char json_buf[512];
+        snprintf(json_buf, sizeof(json_buf),
+                "{\"type\":\"sensor_data_result\","
+                "\"success\":true,"
+                "\"packet_id\":%d,"
+                "\"battery\":%d,"
+                "\"window_open\":%s,"
+                "\"illuminance\":%u,"
+                "\"rotation\":%d,"
+                "\"rssi\":%d,"
+                "\"valid\":true}",
+                data.packetId,
+                data.battery,
+                data.windowOpen ? "true" : "false",
+                data.illuminance,
+                data.rotation,
+                data.rssi);
+
+        job.send(json_buf);
+
+        ESP_LOGI(TAG, "✓ Sensor data sent to WebUI");
+        return true;
+
+    } else {
+        // Fehler
+        const char* error = "{\"type\":\"sensor_data_result\","
+                        "\"success\":false,"
+                        "\"error\":\"Failed to read sensor data\"}";
+
+        job.send(error);
+
+        ESP_LOGE(TAG, "✗ Failed to read sensor data");
     }
-    else if (strcmp(cmd, "window_logic_status") == 0) {
-        WindowLogicConfig cfg = shutter_driver_get_window_logic_config(self->handle);
-        WindowState       ws  = shutter_driver_get_window_state(self->handle);
+    return false;
+}
 
-        const char* wsStr = "closed";
-        if      (ws == WindowState::PENDING) wsStr = "pending";
-        else if (ws == WindowState::TILTED)  wsStr = "tilted";
-        else if (ws == WindowState::OPEN)    wsStr = "open";
+esp_err_t WSCommandHandlers::contact_sensor_status(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
+    extern volatile bool contact_sensor_matter_enabled;
+    extern volatile bool contact_sensor_endpoint_active;
 
-        char buf2[200];
-        snprintf(buf2, sizeof(buf2),
-                 "{\"type\":\"window_logic_status\","
-                 "\"enabled\":%s,"
-                 "\"reed_delay\":%u,"
-                 "\"tilt_thresh\":%d,"
-                 "\"vent_pos\":%u,"
-                 "\"window_state\":\"%s\"}",
-                 cfg.enabled      ? "true" : "false",
-                 (unsigned)cfg.reedDelayMs,
-                 (int)cfg.tiltThreshold,
-                 (unsigned)cfg.ventPosition,
-                 wsStr);
-
-        httpd_ws_frame_t wl_frame = {
-            .type    = HTTPD_WS_TYPE_TEXT,
-            .payload = (uint8_t*)buf2,
-            .len     = strlen(buf2)
-        };
-        httpd_ws_send_frame_async(req->handle, fd, &wl_frame);
-    }
-    else if (CMD_MATCH(cmd, "{\"cmd\":\"window_logic_save\"")) {
-        String json = String(cmd);
-
-        auto readBool = [&](const char* key, bool def) -> bool {
-            String pattern = String("\"") + key + "\":";
-            int idx = json.indexOf(pattern);
-            if (idx < 0) return def;
-            idx += pattern.length();
-            while (idx < (int)json.length() && json[idx] == ' ') idx++;
-            return json.substring(idx, idx + 4) == "true";
-        };
-        auto readInt = [&](const char* key, int def) -> int {
-            String pattern = String("\"") + key + "\":";
-            int idx = json.indexOf(pattern);
-            if (idx < 0) return def;
-            idx += pattern.length();
-            while (idx < (int)json.length() && json[idx] == ' ') idx++;
-            return json.substring(idx).toInt();
-        };
+    char status_buf[128];
+    snprintf(status_buf, sizeof(status_buf),
+            "{\"type\":\"contact_sensor_status\","
+            "\"enabled\":%s,"
+            "\"active\":%s}",
+            contact_sensor_matter_enabled ? "true" : "false",
+            contact_sensor_endpoint_active ? "true" : "false");
 
-        WindowLogicConfig cfg = shutter_driver_get_window_logic_config(self->handle);
-        cfg.enabled       = readBool("enabled",    cfg.enabled);
-        cfg.reedDelayMs   = (uint16_t)readInt("reed_delay",  cfg.reedDelayMs);
-        cfg.tiltThreshold = (int16_t) readInt("tilt_thresh", cfg.tiltThreshold);
-        cfg.ventPosition  = (uint8_t) readInt("vent_pos",    cfg.ventPosition);
+    self->sendToClient(fd, status_buf, strlen(status_buf));
+    return ESP_OK;
+}
+
+esp_err_t WSCommandHandlers::window_logic_status(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
+    WindowLogicConfig cfg = shutter_driver_get_window_logic_config(self->handle);
+    WindowState       ws  = shutter_driver_get_window_state(self->handle);
+
+    const char* wsStr = "closed";
+    if      (ws == WindowState::PENDING) wsStr = "pending";
+    else if (ws == WindowState::TILTED)  wsStr = "tilted";
+    else if (ws == WindowState::OPEN)    wsStr = "open";
+
+    char buf2[200];
+    snprintf(buf2, sizeof(buf2),
+             "{\"type\":\"window_logic_status\","
+             "\"enabled\":%s,"
+             "\"reed_delay\":%u,"
+             "\"tilt_thresh\":%d,"
+             "\"vent_pos\":%u,"
+             "\"window_state\":\"%s\"}",
+             cfg.enabled      ? "true" : "false",
+             (unsigned)cfg.reedDelayMs,
+             (int)cfg.tiltThreshold,
+             (unsigned)cfg.ventPosition,
+             wsStr);
+
+    self->sendToClient(fd, buf2, strlen(buf2));
+    return ESP_OK;
+}
 
-        shutter_driver_set_window_logic_config(self->handle, cfg);
+esp_err_t WSCommandHandlers::window_logic_save(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
+    WindowLogicConfig cfg = shutter_driver_get_window_logic_config(self->handle);
+    cfg.enabled       = json.getBool("enabled", cfg.enabled);
+    cfg.reedDelayMs   = (uint16_t)json.getInt("reed_delay",  cfg.reedDelayMs);
+    cfg.tiltThreshold = (int16_t) json.getInt("tilt_thresh", cfg.tiltThreshold);
+    cfg.ventPosition  = (uint8_t) json.getInt("vent_pos",    cfg.ventPosition);
 
-        const char* ok = "{\"type\":\"info\",\"message\":\"Window logic settings saved\"}";
-        httpd_ws_frame_t ok_frame = {
-            .type    = HTTPD_WS_TYPE_TEXT,
-            .payload = (uint8_t*)ok,
-            .len     = strlen(ok)
-        };
-        httpd_ws_send_frame_async(req->handle, fd, &ok_frame);
+    shutter_driver_set_window_logic_config(self->handle, cfg);
+
+    const char* ok = "{\"type\":\"info\",\"message\":\"Window logic settings saved\"}";
+    self->sendToClient(fd, ok, strlen(ok));
+    return ESP_OK;
+}
+
+esp_err_t WSCommandHandlers::button_binding_status(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
+    ButtonBindingConfig cfg = shutter_driver_get_button_binding_config(self->handle);
+
+    char buf2[200];
+    snprintf(buf2, sizeof(buf2),
+             "{\"type\":\"button_binding_status\","
+             "\"enabled\":%s,"
+             "\"single\":\"%s\","
+             "\"double\":\"%s\","
+             "\"triple\":\"%s\","
+             "\"long\":\"%s\","
+             "\"hold\":\"%s\","
+             "\"preset\":%u}",
+             cfg.enabled ? "true" : "false",
+             shutter_action_to_string(cfg.actions[BUTTON_BIND_SINGLE]),
+             shutter_action_to_string(cfg.actions[BUTTON_BIND_DOUBLE]),
+             shutter_action_to_string(cfg.actions[BUTTON_BIND_TRIPLE]),
+             shutter_action_to_string(cfg.actions[BUTTON_BIND_LONG]),
+             shutter_action_to_string(cfg.actions[BUTTON_BIND_HOLD]),
+             (unsigned)cfg.presetPercent);
+
+    self->sendToClient(fd, buf2, strlen(buf2));
+    return ESP_OK;
+}
+
+esp_err_t WSCommandHandlers::button_binding_save(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
+    auto readAction = [&](const char* key, ShutterAction def) -> ShutterAction {
+        const char* value = json.getString(key);
+        ShutterAction action;
+        return value && shutter_action_from_string(value, action) ? action : def;
+    };
+
+    ButtonBindingConfig cfg = shutter_driver_get_button_binding_config(self->handle);
+
+    cfg.enabled = json.getBool("enabled", cfg.enabled);
+    cfg.actions[BUTTON_BIND_SINGLE] = readAction("single", cfg.actions[BUTTON_BIND_SINGLE]);
+    cfg.actions[BUTTON_BIND_DOUBLE] = readAction("double", cfg.actions[BUTTON_BIND_DOUBLE]);
+    cfg.actions[BUTTON_BIND_TRIPLE] = readAction("triple", cfg.actions[BUTTON_BIND_TRIPLE]);
+    cfg.actions[BUTTON_BIND_LONG]   = readAction("long",   cfg.actions[BUTTON_BIND_LONG]);
+    cfg.actions[BUTTON_BIND_HOLD]   = readAction("hold",   cfg.actions[BUTTON_BIND_HOLD]);
+
+    int32_t preset;
+    if (json.readInt("preset", preset)) {
+        cfg.presetPercent = (uint8_t)constrain(preset, 0, 100);
+    }
+
+    shutter_driver_set_button_binding_config(self->handle, cfg);
+
+    const char* ok = "{\"type\":\"info\",\"message\":\"Button binding saved\"}";
+    self->sendToClient(fd, ok, strlen(ok));
+    return ESP_OK;
+}
+
+esp_err_t WSCommandHandlers::ws_stats(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
+    String stats = ws_command_stats_json(self->jobs);
+    self->sendToClient(fd, stats.c_str(), stats.length());
+    return ESP_OK;
+}
+
+// "proto:bin" / "proto:json" - Protokollwahl nach dem Öffnen (ws_binary.h)
+esp_err_t WSCommandHandlers::proto(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
+    const char* arg = cmd + strlen("proto:");
+    bool binary = strcmp(arg, "bin") == 0;
+    if (!binary && strcmp(arg, "json") != 0) {
+        ws_reply_error(self, fd, "Unknown protocol (expected proto:bin or proto:json)");
+        return ESP_OK;
     }
-    else {
-        ESP_LOGW(TAG, "Unknown command: '%s'", cmd);
+
+    self->set_client_protocol(fd, binary);
+
+    char reply[64];
+    snprintf(reply, sizeof(reply),
+             "{\"type\":\"proto\",\"proto\":\"%s\",\"version\":%d}",
+             binary ? "bin" : "json", WS_BIN_VERSION);
+
+    self->sendToClient(fd, reply, strlen(reply));
+    return ESP_OK;
+}
+
+// "job_cancel:<id>" - Antwort kommt als {"type":"job",...,"state":"cancelled"}
+esp_err_t WSCommandHandlers::job_cancel(WebUIHandler* self, httpd_req_t* req, int fd, char* cmd, const JsonCommand& json) {
+    unsigned long value;
+    if (!ws_parse_uint(cmd + strlen("job_cancel:"), UINT16_MAX, value)) {
+        ws_reply_error(self, fd, "Invalid job id");
+        return ESP_OK;
     }
+    uint16_t id = (uint16_t)value;
 
-    free(buf);
+    if (!self->jobs.cancel(id)) {
+        char reply[96];
+        snprintf(reply, sizeof(reply),
+                 "{\"type\":\"error\",\"message\":\"Job %u not found or already finished\"}", id);
+        self->sendToClient(fd, reply, strlen(reply));
+    }
     return ESP_OK;
 }
 
+// ════════════════════════════════════════════════════════════════════════
+// Job-Worker Anbindung (ws_jobs.h)
+// ════════════════════════════════════════════════════════════════════════
+
+bool WebUIHandler::submit_job(const char* name, WSJobFn fn, int fd, const char* address,
+                              uint32_t passkey, const ShellyBindkey* bindkey) {
+    WSJobArgs args = {};
+    args.ctx = this;
+    args.fd = fd;
+    if (address) {
+        strlcpy(args.address, address, sizeof(args.address));
+    }
+    args.passkey = passkey;
+    if (bindkey && bindkey->isSet()) {
+        memcpy(args.bindkey, bindkey->data(), sizeof(args.bindkey));
+        args.hasBindkey = true;
+    }
+
+    uint16_t id = jobs.submit(name, fn, args);
+    mbedtls_platform_zeroize(&args, sizeof(args));
+    return id != 0;
+}
+
+void WebUIHandler::send_job_message(void* ctx, int fd, const char* json) {
+    WebUIHandler* self = (WebUIHandler*)ctx;
+    if (!self->server) return;
+
+    // Client kann während des Jobs gegangen sein - fd evtl. schon neu vergeben
+    bool connected = false;
+    if (xSemaphoreTake(self->client_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        ESP_LOGW(TAG, "Could not acquire mutex for job message (fd=%d)", fd);
+        return;
+    }
+    for (const auto& client : self->active_clients) {
+        if (client.fd == fd) {
+            connected = true;
+            break;
+        }
+    }
+    xSemaphoreGive(self->client_mutex);
+
+    if (!connected) {
+        ESP_LOGW(TAG, "Job message for fd=%d dropped - client gone", fd);
+        return;
+    }
+
+    // ✅ Gesendet wird wie beim Broadcast nur im httpd-Task (client_drain_work)
+    WSFrame* frame = ws_frame_create(json, strlen(json), HTTPD_WS_TYPE_TEXT, 0);
+    if (!frame) {
+        ESP_LOGW(TAG, "Job message for fd=%d dropped - no frame buffer", fd);
+        return;
+    }
+    self->enqueue_frame(fd, frame);
+    ws_frame_release(frame);
+}
+
+
 // ============================================================================
 // WebUIHandler Implementation
 // ============================================================================
@@ -3466,13 +3886,17 @@ esp_err_t WebUIHandler::handle_matter_status(httpd_req_t *req) {
 }
 
 void WebUIHandler::begin() {
+    ws_commands_init();
+    jobs.begin(send_job_message, this);
+
     httpd_config_t cfg = HTTPD_DEFAULT_CONFIG();
     
     cfg.max_open_sockets = 4;  // 3 WebSocket clients + 1 for pending HTTP requests
     cfg.lru_purge_enable = true;
-    cfg.max_uri_handlers = 12;  // 11 handlers registered: root, 3x icons, ws, 2x update, 2x matter, 2x drift
+    cfg.max_uri_handlers = 16;  // 15 handlers registered: root, 3x icons, ws, 2x update, 2x matter, 2x drift, 2x capture, link, ws stats
     cfg.stack_size = 8192;
     cfg.ctrl_port = 32768;
+    cfg.send_wait_timeout = 2;  // Sekunden - Obergrenze für einen hängenden Send im httpd-Task
     cfg.close_fn = ws_close_callback;
     cfg.close_fn = nullptr;
     cfg.uri_match_fn = nullptr;
@@ -3605,7 +4029,10 @@ void WebUIHandler::begin() {
         ESP_LOGI(TAG, "LRU purge: %s", cfg.lru_purge_enable ? "enabled" : "disabled");
         
         #ifdef SERVE_COMPRESSED_HTML
-            ESP_LOGI(TAG, "  Web-UI: GZIP compressed (%d bytes)", index_html_gz_len);
+            ESP_LOGI(TAG, "  Web-UI: GZIP compressed (%d bytes, ETag %s)", index_html_gz_len, HTML_ETAG);
+            #ifdef HTML_HAS_BROTLI
+                ESP_LOGI(TAG, "  Web-UI: Brotli variant (%d bytes)", index_html_br_len);
+            #endif
         #else
             ESP_LOGI(TAG, "  Web-UI: Uncompressed (fallback mode)");
         #endif
@@ -3620,8 +4047,19 @@ void WebUIHandler::begin() {
             bleManager->setStateChangeCallback([this](auto oldState, auto newState) {
                 broadcastBLEStateChange(oldState, newState);
             });
+            
+            // Läuft in bleManager->loop() (Main Loop)
+            bleManager->setStaleSensorCallback([this](const String& address, bool stale, uint32_t silentMs) {
+                char msg[128];
+                snprintf(msg, sizeof(msg),
+                         "{\"type\":\"ble_sensor_stale\",\"address\":\"%s\",\"stale\":%s,\"silent_s\":%u}",
+                         address.c_str(), stale ? "true" : "false", silentMs / 1000);
+                broadcast_to_all_clients(msg);
+                broadcastBLEStatus();
+            });
              
             ESP_LOGI(TAG, "✓ BLE State Callback registered");
+            ESP_LOGI(TAG, "✓ BLE Stale Sensor Callback registered");
             ESP_LOGI(TAG, "ℹ Sensor Data forwarded via Main Loop");
             ESP_LOGI(TAG, "═══════════════════════════════════");
         }
@@ -3649,6 +4087,50 @@ void WebUIHandler::begin() {
             .user_ctx  = this
         };
         httpd_register_uri_handler(server, &drift_reset);
+
+        // ════════════════════════════════════════════════════════════════
+        // 7. BLE Advertisement Capture (GET = Download, POST = Steuerung)
+        // ════════════════════════════════════════════════════════════════
+
+        httpd_uri_t capture_get = {
+            .uri       = "/api/ble/capture",
+            .method    = HTTP_GET,
+            .handler   = ble_capture_get_handler,
+            .user_ctx  = this
+        };
+        httpd_register_uri_handler(server, &capture_get);
+
+        httpd_uri_t capture_post = {
+            .uri       = "/api/ble/capture",
+            .method    = HTTP_POST,
+            .handler   = ble_capture_post_handler,
+            .user_ctx  = this
+        };
+        httpd_register_uri_handler(server, &capture_post);
+
+        // ════════════════════════════════════════════════════════════════
+        // 8. BLE Link-Qualität (GET)
+        // ════════════════════════════════════════════════════════════════
+
+        httpd_uri_t link_get = {
+            .uri       = "/api/ble/link",
+            .method    = HTTP_GET,
+            .handler   = ble_link_stats_handler,
+            .user_ctx  = this
+        };
+        httpd_register_uri_handler(server, &link_get);
+
+        // ════════════════════════════════════════════════════════════════
+        // 9. WebSocket Kommando-Statistik (GET)
+        // ════════════════════════════════════════════════════════════════
+
+        httpd_uri_t ws_stats_get = {
+            .uri       = "/api/ws/stats",
+            .method    = HTTP_GET,
+            .handler   = ws_stats_handler,
+            .user_ctx  = this
+        };
+        httpd_register_uri_handler(server, &ws_stats_get);
     } else {
         ESP_LOGE(TAG, "✗ Failed to start HTTP server");
     }
@@ -3696,6 +4178,124 @@ esp_err_t WebUIHandler::drift_reset_handler(httpd_req_t *req) {
     return ESP_OK;
 }
 
+// ============================================================================
+// BLE Capture API Endpoints
+// ============================================================================
+
+esp_err_t WebUIHandler::ble_capture_get_handler(httpd_req_t *req) {
+    if (!checkBasicAuth(req)) {
+        return ESP_FAIL;
+    }
+    
+    WebUIHandler* self = (WebUIHandler*)req->user_ctx;
+    
+    if (!self->bleManager) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, 
+                           "BLE manager not initialized");
+        return ESP_FAIL;
+    }
+    
+    return self->bleManager->getCapture().sendHttp(req);
+}
+
+// GET /api/ble/link - RSSI, Verluste, Fehlerzähler, Inter-Arrival-Histogramm
+esp_err_t WebUIHandler::ble_link_stats_handler(httpd_req_t *req) {
+    if (!checkBasicAuth(req)) {
+        return ESP_FAIL;
+    }
+    
+    WebUIHandler* self = (WebUIHandler*)req->user_ctx;
+    
+    if (!self->bleManager) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, 
+                           "BLE manager not initialized");
+        return ESP_FAIL;
+    }
+    
+    String json = self->bleManager->getLinkStatsJson();
+    
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    return httpd_resp_send(req, json.c_str(), json.length());
+}
+
+// GET /api/ws/stats - Aufrufe und Handler-Latenz pro WebSocket-Kommando
+esp_err_t WebUIHandler::ws_stats_handler(httpd_req_t *req) {
+    if (!checkBasicAuth(req)) {
+        return ESP_FAIL;
+    }
+    
+    WebUIHandler* self = (WebUIHandler*)req->user_ctx;
+    String json = ws_command_stats_json(self->jobs);
+    
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    return httpd_resp_send(req, json.c_str(), json.length());
+}
+
+// POST /api/ble/capture?action=start|stop|clear[&size=<bytes>]
+esp_err_t WebUIHandler::ble_capture_post_handler(httpd_req_t *req) {
+    if (!checkBasicAuth(req)) {
+        return ESP_FAIL;
+    }
+    
+    WebUIHandler* self = (WebUIHandler*)req->user_ctx;
+    
+    if (!self->bleManager) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, 
+                           "BLE manager not initialized");
+        return ESP_FAIL;
+    }
+    
+    char query[64] = {0};
+    char action[16] = {0};
+    char sizeStr[12] = {0};
+    
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "action", action, sizeof(action)) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing action");
+        return ESP_FAIL;
+    }
+    
+    BLECaptureRing& capture = self->bleManager->getCapture();
+    bool ok = true;
+    
+    if (strcmp(action, "start") == 0) {
+        size_t size = BLE_CAPTURE_DEFAULT_SIZE;
+        if (httpd_query_key_value(query, "size", sizeStr, sizeof(sizeStr)) == ESP_OK) {
+            size = strtoul(sizeStr, nullptr, 10);
+            if (size < 1024 || size > 256 * 1024) {
+                httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "size must be 1024..262144");
+                return ESP_FAIL;
+            }
+        }
+        ok = capture.start(size);
+    } else if (strcmp(action, "stop") == 0) {
+        capture.stop();
+    } else if (strcmp(action, "clear") == 0) {
+        capture.clear();
+    } else {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown action");
+        return ESP_FAIL;
+    }
+    
+    char json[160];
+    snprintf(json, sizeof(json),
+             "{\"success\":%s,\"active\":%s,\"capacity\":%u,\"used\":%u,"
+             "\"records\":%u,\"dropped\":%u}",
+             ok ? "true" : "false",
+             capture.isActive() ? "true" : "false",
+             (unsigned)capture.capacity(),
+             (unsigned)capture.bytesUsed(),
+             capture.recordCount(),
+             capture.droppedCount());
+    
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json);
+    
+    return ESP_OK;
+}
+
 
 // ============================================================================
 // Client Management
@@ -3715,8 +4315,10 @@ void WebUIHandler::register_client(int fd) {
         ClientInfo client;
         client.fd = fd;
         client.last_activity = millis();
+        client.binary = false;          // JSON bis "proto:bin"
         
         active_clients.push_back(client);
+        ws_queue_open(fd, this, client_drain_retry);
         ESP_LOGI(TAG, "═══════════════════════════════════");
         ESP_LOGI(TAG, "Client connected: fd=%d (total: %d)", fd, active_clients.size());
         ESP_LOGI(TAG, "═══════════════════════════════════");
@@ -3724,6 +4326,68 @@ void WebUIHandler::register_client(int fd) {
     }
 }
 
+void WebUIHandler::touch_client(int fd) {
+    if (xSemaphoreTake(client_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        for (auto& client : active_clients) {
+            if (client.fd == fd) {
+                client.last_activity = millis();
+                break;
+            }
+        }
+        xSemaphoreGive(client_mutex);
+    }
+}
+
+void WebUIHandler::set_client_protocol(int fd, bool binary) {
+    if (xSemaphoreTake(client_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        for (auto& client : active_clients) {
+            if (client.fd == fd) {
+                client.binary = binary;
+                break;
+            }
+        }
+        xSemaphoreGive(client_mutex);
+    }
+    ESP_LOGI(TAG, "Client fd=%d protocol: %s", fd, binary ? "binary" : "json");
+}
+
+bool WebUIHandler::is_binary_client(int fd) {
+    bool binary = false;
+    if (xSemaphoreTake(client_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        for (const auto& client : active_clients) {
+            if (client.fd == fd) {
+                binary = client.binary;
+                break;
+            }
+        }
+        xSemaphoreGive(client_mutex);
+    }
+    return binary;
+}
+
+int WebUIHandler::get_client_count() const {
+    int count = 0;
+    if (xSemaphoreTake(client_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        count = active_clients.size();
+        xSemaphoreGive(client_mutex);
+    }
+    return count;
+}
+
+bool WebUIHandler::has_json_clients() {
+    bool json = false;
+    if (xSemaphoreTake(client_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        for (const auto& client : active_clients) {
+            if (!client.binary) {
+                json = true;
+                break;
+            }
+        }
+        xSemaphoreGive(client_mutex);
+    }
+    return json;
+}
+
 void WebUIHandler::unregister_client(int fd) {
     if (xSemaphoreTake(client_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
         ESP_LOGI(TAG, "Closing socket fd=%d...", fd);
@@ -3739,94 +4403,243 @@ void WebUIHandler::unregister_client(int fd) {
         ESP_LOGI(TAG, "═══════════════════════════════════");
         xSemaphoreGive(client_mutex);
     }
+
+    // Wartende Frames freigeben (auch wenn der Mutex nicht zu bekommen war)
+    ws_queue_close(fd);
 }
 
 // ════════════════════════════════════════════════════════════════════════
-// WebSocket Broadcast mit Heap-Allokation
+// WebSocket Broadcast über gepoolte Frames und Client-Queues
 // ════════════════════════════════════════════════════════════════════════
 
 void WebUIHandler::broadcast_to_all_clients(const char* message) {
-    if (!server || !message) return;
+    broadcast_frames(message, nullptr, 0);
+}
 
-    if (xSemaphoreTake(client_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        size_t msg_len = strlen(message);
-        
-        // ✅ Heap-Allokation für async Send
-        char* msg_copy = (char*)malloc(msg_len + 1);
-        if (!msg_copy) {
-            ESP_LOGE(TAG, "✗ Failed to allocate %u bytes for broadcast", msg_len + 1);
-            xSemaphoreGive(client_mutex);
-            return;
+void WebUIHandler::broadcast_frames(const char* json, const void* bin, size_t bin_len,
+                                    uint8_t coalesce) {
+    static_assert(MAX_CLIENTS <= WS_CLIENT_QUEUES, "WS_CLIENT_QUEUES too small");
+
+    if (!server || (!json && !bin)) return;
+
+    // Kopie der Client-FDs (fest, ohne Heap)
+    int target_fds[WS_CLIENT_QUEUES];
+    bool target_bin[WS_CLIENT_QUEUES];
+    size_t target_count = 0;
+    size_t bin_count = 0;
+
+    if (xSemaphoreTake(client_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        ESP_LOGW(TAG, "Could not acquire mutex for broadcast");
+        return;
+    }
+    for (const auto& client : active_clients) {
+        bool use_bin = client.binary && bin;
+        if (target_count >= WS_CLIENT_QUEUES || (!use_bin && !json)) {
+            continue;
         }
-        strcpy(msg_copy, message);
-        
-        ESP_LOGI(TAG, "→ Broadcasting to %d clients (%u bytes)", 
-                 active_clients.size(), msg_len);
-        
-        httpd_ws_frame_t ws_pkt;
-        memset(&ws_pkt, 0, sizeof(httpd_ws_frame_t));
-        ws_pkt.type = HTTPD_WS_TYPE_TEXT;
-        ws_pkt.payload = (uint8_t*)msg_copy;
-        ws_pkt.len = msg_len;
-        
-        // Kopie der Client-FDs
-        std::vector<int> target_fds;
-        target_fds.reserve(active_clients.size());
-        for (const auto& client : active_clients) {
-            target_fds.push_back(client.fd);
+        target_fds[target_count] = client.fd;
+        target_bin[target_count] = use_bin;
+        target_count++;
+        if (use_bin) bin_count++;
+    }
+    xSemaphoreGive(client_mutex);
+
+    if (target_count == 0) return;
+
+    // Pro Format genau ein Frame
+    WSFrame* text_frame = nullptr;
+    WSFrame* bin_frame = nullptr;
+    if (target_count > bin_count) {
+        text_frame = ws_frame_create(json, strlen(json), HTTPD_WS_TYPE_TEXT, coalesce);
+    }
+    if (bin_count > 0) {
+        bin_frame = ws_frame_create(bin, bin_len, HTTPD_WS_TYPE_BINARY, coalesce);
+    }
+
+    ESP_LOGD(TAG, "→ Broadcasting to %u clients (%u json, %u binary)",
+             target_count, target_count - bin_count, bin_count);
+
+    // ✅ Nur einreihen - gesendet wird im httpd-Task (client_drain_work)
+    size_t queued = 0;
+    for (size_t i = 0; i < target_count; i++) {
+        WSFrame* frame = target_bin[i] ? bin_frame : text_frame;
+        if (!frame) continue;
+
+        if (enqueue_frame(target_fds[i], frame)) {
+            queued++;
         }
-        xSemaphoreGive(client_mutex);
-        
-        // ✅ Sende MIT TIMEOUT-KONTROLLE
-        int success_count = 0;
-        std::vector<int> dead_clients;  // Sammle tote Clients
-        
-        for (int fd : target_fds) {
-            // ✅ Watchdog Reset VOR jedem Send
-            esp_task_wdt_reset();
-            
-            // ✅ Send mit Timeout (max 500ms pro Client)
-            uint32_t send_start = millis();
-            esp_err_t ret = httpd_ws_send_frame_async(server, fd, &ws_pkt);
-            uint32_t send_duration = millis() - send_start;
-            
-            if (ret == ESP_OK) {
-                success_count++;
-                
-                if (send_duration > 100) {
-                    ESP_LOGW(TAG, "⚠ Slow client fd=%d (took %ums)", fd, send_duration);
-                }
-            } else {
-                ESP_LOGW(TAG, "Failed to send to fd=%d: %s", fd, esp_err_to_name(ret));
-                
-                // ✅ Markiere als tot wenn Fehler
-                if (ret == ESP_ERR_INVALID_ARG || ret == ESP_FAIL) {
-                    dead_clients.push_back(fd);
-                }
+    }
+
+    // Referenzen des Erzeugers abgeben - der letzte Send gibt den Frame frei
+    if (text_frame) ws_frame_release(text_frame);
+    if (bin_frame) ws_frame_release(bin_frame);
+
+    ESP_LOGD(TAG, "✓ Broadcast queued: %u/%u clients", queued, target_count);
+}
+
+void WebUIHandler::broadcast_frame(WSFrame* frame) {
+    int target_fds[WS_CLIENT_QUEUES];
+    size_t target_count = 0;
+
+    if (!server) return;
+    if (xSemaphoreTake(client_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        ESP_LOGW(TAG, "Could not acquire mutex for broadcast");
+        return;
+    }
+    for (const auto& client : active_clients) {
+        if (target_count < WS_CLIENT_QUEUES) {
+            target_fds[target_count++] = client.fd;
+        }
+    }
+    xSemaphoreGive(client_mutex);
+
+    for (size_t i = 0; i < target_count; i++) {
+        enqueue_frame(target_fds[i], frame);
+    }
+}
+
+bool WebUIHandler::enqueue_frame(int fd, WSFrame* frame) {
+    bool start_drain = false;
+    WSQueueResult result = ws_queue_push(fd, frame, start_drain);
+
+    if (result == WS_STALLED) {
+        ESP_LOGE(TAG, "✗ Client fd=%d queue full for >%ums - closing",
+                 fd, WS_CLIENT_STALL_MS);
+        evict_client(fd);
+        return false;
+    }
+    if (result == WS_DROPPED) {
+        ESP_LOGW(TAG, "⚠ Client fd=%d queue full - message dropped", fd);
+    }
+
+    if (start_drain) {
+        WSClientQueue* q = ws_queue_find(fd);
+        esp_err_t ret = q ? httpd_queue_work(server, client_drain_work, q) : ESP_ERR_NOT_FOUND;
+        if (ret != ESP_OK) {
+            // Nächster Frame versucht es erneut
+            taskENTER_CRITICAL(&ws_queue_lock);
+            if (q && q->fd == fd) q->drainQueued = false;
+            taskEXIT_CRITICAL(&ws_queue_lock);
+            ESP_LOGW(TAG, "Failed to queue drain for fd=%d: %s", fd, esp_err_to_name(ret));
+        }
+    }
+    return result != WS_DROPPED;
+}
+
+bool WebUIHandler::sendToClient(int fd, const void* payload, size_t len, httpd_ws_type_t type) {
+    WSFrame* frame = ws_frame_create(payload, len, type, 0);
+    if (!frame) {
+        ESP_LOGW(TAG, "Reply for fd=%d dropped - no frame buffer", fd);
+        return false;
+    }
+    bool queued = enqueue_frame(fd, frame);
+    ws_frame_release(frame);
+    return queued;
+}
+
+// esp_timer Task: Drain nach Backpressure-Pause erneut einreihen
+void WebUIHandler::client_drain_retry(void* arg) {
+    WSClientQueue* q = (WSClientQueue*)arg;
+
+    taskENTER_CRITICAL(&ws_queue_lock);
+    WebUIHandler* self = q->fd >= 0 ? q->owner : nullptr;
+    taskEXIT_CRITICAL(&ws_queue_lock);
+
+    esp_err_t ret = (self && self->server)
+        ? httpd_queue_work(self->server, client_drain_work, q) : ESP_ERR_INVALID_STATE;
+    if (ret != ESP_OK) {
+        taskENTER_CRITICAL(&ws_queue_lock);
+        q->drainQueued = false;
+        taskEXIT_CRITICAL(&ws_queue_lock);
+    }
+}
+
+void WebUIHandler::evict_client(int fd) {
+    // Socket schließen lassen (httpd räumt die Session auf) und sofort austragen
+    if (server) {
+        httpd_sess_trigger_close(server, fd);
+    }
+    unregister_client(fd);
+}
+
+void WebUIHandler::client_drain_work(void* arg) {
+    WSClientQueue* q = (WSClientQueue*)arg;
+
+    while (true) {
+        taskENTER_CRITICAL(&ws_queue_lock);
+        int fd = q->fd;
+        WebUIHandler* self = q->owner;
+        if (fd < 0 || q->depth == 0) {
+            q->drainQueued = false;
+            taskEXIT_CRITICAL(&ws_queue_lock);
+            return;
+        }
+        taskEXIT_CRITICAL(&ws_queue_lock);
+
+        // Backpressure: Socket-Puffer voll → Queue stehen lassen statt
+        // den httpd-Task in send() zu blockieren. drainQueued bleibt
+        // gesetzt, der Retry-Timer reiht den Drain wieder ein.
+        if (!ws_socket_writable(fd)) {
+            uint32_t now = millis();
+            taskENTER_CRITICAL(&ws_queue_lock);
+            if (!q->blockedSince) q->blockedSince = now ? now : 1;
+            uint32_t blockedMs = now - q->blockedSince;
+            taskEXIT_CRITICAL(&ws_queue_lock);
+
+            if (blockedMs > WS_CLIENT_STALL_MS) {
+                ESP_LOGE(TAG, "✗ Client fd=%d not writable for >%ums - closing",
+                         fd, WS_CLIENT_STALL_MS);
+                self->evict_client(fd);
+                return;
             }
-            
-            // ✅ Abbruch bei zu langer Verzögerung (verhindert Watchdog Timeout)
-            if (send_duration > 500) {
-                ESP_LOGE(TAG, "✗ Client fd=%d blocked for %ums - aborting broadcast!", 
-                         fd, send_duration);
-                dead_clients.push_back(fd);
-                break;  // Stop sending to other clients
+            if (!q->retryTimer ||
+                esp_timer_start_once(q->retryTimer, WS_CLIENT_RETRY_MS * 1000) != ESP_OK) {
+                // Kein Timer → nächster Frame stößt den Drain wieder an
+                taskENTER_CRITICAL(&ws_queue_lock);
+                q->drainQueued = false;
+                taskEXIT_CRITICAL(&ws_queue_lock);
             }
+            ESP_LOGD(TAG, "Client fd=%d not writable - deferring %u frames", fd, q->depth);
+            return;
         }
-        
-        ESP_LOGI(TAG, "✓ Broadcast complete: %d/%d clients", 
-                 success_count, target_fds.size());
-        
-        // ✅ Cleanup tote Clients
-        for (int fd : dead_clients) {
-            ESP_LOGW(TAG, "→ Removing dead client fd=%d", fd);
-            unregister_client(fd);
+
+        WSFrame* frame = nullptr;
+        taskENTER_CRITICAL(&ws_queue_lock);
+        if (q->fd == fd && q->depth > 0) {
+            frame = q->frames[q->head];
+            q->head = (q->head + 1) % WS_CLIENT_QUEUE_LEN;
+            q->depth--;
+            q->fullSince = 0;
+            q->blockedSince = 0;
         }
-        
-        free(msg_copy);
+        taskEXIT_CRITICAL(&ws_queue_lock);
+        if (!frame) continue;
 
-    } else {
-        ESP_LOGW(TAG, "Could not acquire mutex for broadcast");
+        httpd_ws_frame_t ws_pkt;
+        memset(&ws_pkt, 0, sizeof(httpd_ws_frame_t));
+        ws_pkt.type = frame->type;
+        ws_pkt.payload = (uint8_t*)frame->data;
+        ws_pkt.len = frame->len;
+
+        uint32_t send_start = millis();
+        esp_err_t ret = httpd_ws_send_frame_async(self->server, fd, &ws_pkt);
+        uint32_t send_duration = millis() - send_start;
+
+        ws_frame_release(frame);
+
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to send to fd=%d: %s - removing", fd, esp_err_to_name(ret));
+            self->evict_client(fd);
+            return;
+        }
+
+        taskENTER_CRITICAL(&ws_queue_lock);
+        if (q->fd == fd) q->sent++;
+        taskEXIT_CRITICAL(&ws_queue_lock);
+
+        if (send_duration > 100) {
+            ESP_LOGW(TAG, "⚠ Slow client fd=%d (took %ums)", fd, send_duration);
+        }
     }
 }
 
@@ -3887,7 +4700,15 @@ void WebUIHandler::broadcast_to_all_clients(const char* message) {
     if      (devState == ShellyBLEManager::STATE_CONNECTED_UNENCRYPTED) stateStr = "connected_unencrypted";
     else if (devState == ShellyBLEManager::STATE_CONNECTED_ENCRYPTED)   stateStr = "connected_encrypted";
 
-    char msg[512];
+    // Kein 2-KB-Puffer auf dem Stack: Aufrufer sind auch ws_job Worker und
+    // der NimBLE Callback-Kontext. Statischer Puffer unter client_mutex,
+    // gesendet wird eine Kopie im Frame-Pool.
+    static char msg[2048];
+
+    if (xSemaphoreTake(client_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        ESP_LOGW(TAG, "Could not acquire mutex for BLE status");
+        return;
+    }
 
     if (!paired) {
         snprintf(msg, sizeof(msg),
@@ -3920,9 +4741,13 @@ void WebUIHandler::broadcast_to_all_clients(const char* message) {
         }
 
         // bindkey mask
-        bool hasBindkey = dev.bindkey.length() == 32;
         char bindkeyMasked[8] = "None";
-        if (hasBindkey) snprintf(bindkeyMasked, sizeof(bindkeyMasked), "%.4s…", dev.bindkey.c_str());
+        if (dev.bindkey.isSet()) {
+            char hex[ShellyBindkey::HEX_LEN + 1];
+            dev.bindkey.toHex(hex);
+            snprintf(bindkeyMasked, sizeof(bindkeyMasked), "%.4s…", hex);
+            mbedtls_platform_zeroize(hex, sizeof(hex));
+        }
 
         snprintf(msg, sizeof(msg),
                  "{\"type\":\"ble_status\","
@@ -3939,7 +4764,12 @@ void WebUIHandler::broadcast_to_all_clients(const char* message) {
                    "\"rotation\":%d,"
                    "\"illuminance\":%u,"
                    "\"rssi\":%d,"
-                   "\"seconds_ago\":%d}}",
+                   "\"seconds_ago\":%d},"
+                 "\"scan\":{"
+                   "\"profile\":\"%s\","
+                   "\"events_per_min\":%u,"
+                   "\"duty\":%u,"
+                   "\"miss_permille\":%u}",
                  stateStr,
                  dev.name.c_str(),
                  dev.address.c_str(),
@@ -3951,10 +4781,23 @@ void WebUIHandler::broadcast_to_all_clients(const char* message) {
                  hasData ? sd.rotation : 0,
                  hasData ? sd.illuminance : 0u,
                  hasData ? sd.rssi : 0,
-                 secondsAgo);
+                 secondsAgo,
+                 bleManager->getScanProfileName(),
+                 bleManager->getScanEventsPerMinute(),
+                 bleManager->getScanDutyPercent(),
+                 bleManager->getScanMissRatePermille());
+
+        int len = strlen(msg);
+        len += append_paired_devices_json(bleManager, msg + len, sizeof(msg) - len - 2);
+        snprintf(msg + len, sizeof(msg) - len, "}");
     }
 
-    broadcast_to_all_clients(msg);
+    WSFrame* frame = ws_frame_create(msg, strlen(msg), HTTPD_WS_TYPE_TEXT, 0);
+    xSemaphoreGive(client_mutex);
+
+    if (!frame) return;
+    broadcast_frame(frame);
+    ws_frame_release(frame);
     ESP_LOGD(TAG, "broadcastBLEStatus: %s", paired ? "paired" : "not_paired");
   }
 
@@ -3985,16 +4828,45 @@ void WebUIHandler::broadcast_to_all_clients(const char* message) {
         }
 
         // Include granular window state from shutter driver
+        WindowState ws = handle ? shutter_driver_get_window_state(handle) : WindowState::CLOSED;
         const char* wsStr = "closed";
-        if (handle) {
-            WindowState ws = shutter_driver_get_window_state(handle);
-            if      (ws == WindowState::PENDING) wsStr = "pending";
-            else if (ws == WindowState::TILTED)  wsStr = "tilted";
-            else if (ws == WindowState::OPEN)    wsStr = "open";
+        if      (ws == WindowState::PENDING) wsStr = "pending";
+        else if (ws == WindowState::TILTED)  wsStr = "tilted";
+        else if (ws == WindowState::OPEN)    wsStr = "open";
+
+        // Binär (ws_binary.h): fester Struct, keine Formatierung
+        WSBinSensor bin = {};
+        bin.version = WS_BIN_VERSION;
+        bin.type = WS_BIN_SENSOR;
+        sscanf(address.c_str(), "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx",
+               &bin.mac[0], &bin.mac[1], &bin.mac[2], &bin.mac[3], &bin.mac[4], &bin.mac[5]);
+        if (data.windowOpen)                        bin.flags |= WS_BIN_SENSOR_WINDOW_OPEN;
+        if (data.hasButtonEvent)                    bin.flags |= WS_BIN_SENSOR_BUTTON;
+        if (data.fields & BTHOME_FIELD_TEMPERATURE) bin.flags |= WS_BIN_SENSOR_TEMPERATURE;
+        if (data.fields & BTHOME_FIELD_HUMIDITY)    bin.flags |= WS_BIN_SENSOR_HUMIDITY;
+        if (data.fields & BTHOME_FIELD_MOTION)      bin.flags |= WS_BIN_SENSOR_MOTION_VALID;
+        if (data.motion)                            bin.flags |= WS_BIN_SENSOR_MOTION;
+        bin.windowState = (uint8_t)ws;
+        bin.battery = data.battery;
+        bin.rssi = data.rssi;
+        bin.packetId = data.packetId;
+        bin.buttonEvent = wsButtonEventCode(data.buttonEvent);
+        bin.confidence = (uint8_t)data.confidence;
+        bin.humidity = data.humidity;
+        bin.rotation = data.rotation;
+        bin.temperature = data.temperature;
+        bin.illuminance = data.illuminance;
+        bin.secondsAgo = timeValid ? (int32_t)secondsAgo : -1;
+
+        // JSON nur wenn ein Client es braucht
+        if (!has_json_clients()) {
+            ESP_LOGD(TAG, "Sensor update: %s (binary only)", address.c_str());
+            broadcast_frames(nullptr, &bin, sizeof(bin));
+            return;
         }
 
-        char json_buf[560];
-        snprintf(json_buf, sizeof(json_buf),
+        char json_buf[640];
+        int len = snprintf(json_buf, sizeof(json_buf),
                 "{\"type\":\"ble_sensor_update\","
                 "\"address\":\"%s\","
                 "\"window_open\":%s,"
@@ -4006,7 +4878,8 @@ void WebUIHandler::broadcast_to_all_clients(const char* message) {
                 "\"packet_id\":%d,"
                 "\"has_button_event\":%s,"
                 "\"button_event\":%d,"
-                "\"seconds_ago\":%d}",
+                "\"confidence\":\"%s\","
+                "\"seconds_ago\":%d",
                 address.c_str(),
                 data.windowOpen ? "true" : "false",
                 wsStr,
@@ -4016,13 +4889,31 @@ void WebUIHandler::broadcast_to_all_clients(const char* message) {
                 data.rssi,
                 data.packetId,
                 data.hasButtonEvent ? "true" : "false",
-                (int)data.buttonEvent,
+                (int)wsButtonEventCode(data.buttonEvent),
+                sensorStateConfidenceToString(data.confidence),
                 timeValid ? (int)secondsAgo : -1);
 
+        // Felder weiterer Geräteklassen (H&T, Motion) nur wenn im Paket enthalten
+        if (data.fields & BTHOME_FIELD_TEMPERATURE) {
+            len += snprintf(json_buf + len, sizeof(json_buf) - len,
+                            ",\"temperature\":%s%d.%d",
+                            data.temperature < 0 ? "-" : "",
+                            abs(data.temperature) / 10, abs(data.temperature) % 10);
+        }
+        if (data.fields & BTHOME_FIELD_HUMIDITY) {
+            len += snprintf(json_buf + len, sizeof(json_buf) - len,
+                            ",\"humidity\":%u", data.humidity);
+        }
+        if (data.fields & BTHOME_FIELD_MOTION) {
+            len += snprintf(json_buf + len, sizeof(json_buf) - len,
+                            ",\"motion\":%s", data.motion ? "true" : "false");
+        }
+        snprintf(json_buf + len, sizeof(json_buf) - len, "}");
+
         ESP_LOGD(TAG, "Sensor update: %s bat=%d%% win=%s pkt=%d",
                  address.c_str(), data.battery,
                  data.windowOpen ? "open" : "closed", data.packetId);
-        broadcast_to_all_clients(json_buf);
+        broadcast_frames(json_buf, &bin, sizeof(bin));
     }
 
     // ============================================================================
@@ -4035,13 +4926,8 @@ void WebUIHandler::broadcast_to_all_clients(const char* message) {
                 "{\"type\":\"modal_close\",\"modal_id\":\"%s\"}",
                 modal_id);
         
-        httpd_ws_frame_t frame = {
-            .type = HTTPD_WS_TYPE_TEXT,
-            .payload = (uint8_t*)msg,
-            .len = strlen(msg)
-        };
-        
-        httpd_ws_send_frame_async(server, fd, &frame);
+        // Auch aus dem Job-Worker: prüft, ob fd noch verbunden ist, und reiht ein
+        send_job_message(this, fd, msg);
         ESP_LOGI(TAG, "→ Sent modal close command: %s", modal_id);
     }
 
@@ -4116,6 +5002,7 @@ void WebUIHandler::disconnect_all_clients() {
         ESP_LOGI(TAG, "Disconnecting all clients (%d)", active_clients.size());
         
         for (const auto& client : active_clients) {
+            ws_queue_close(client.fd);  // Ausstehende Frames freigeben, Slot wieder frei
             close(client.fd);
         }
         
@@ -10,6 +10,7 @@
 #include <ESPmDNS.h>
 #include "rollershutter_driver.h"
 #include "shelly_ble_manager.h"
+#include "ws_jobs.h"
 #include <vector>
 #include <memory>
 #include <freertos/FreeRTOS.h>
@@ -17,6 +18,9 @@
 
 typedef void (*endpoint_callback_t)();
 
+// Refcounted Send-Frame (web_ui_handler.cpp)
+struct WSFrame;
+
 // ════════════════════════════════════════════════════════════════════════
 // MATTER START RESULT STRUCTURE
 // ════════════════════════════════════════════════════════════════════════
@@ -58,6 +62,12 @@ public:
     
     void begin();
     void broadcast_to_all_clients(const char* message);
+    // Binär-Clients bekommen bin (falls vorhanden), alle anderen json (ws_binary.h).
+    // coalesce (StatusField-Maske) erlaubt, einen noch wartenden älteren
+    // Status-Frame mit einer Teilmenge dieser Felder zu ersetzen.
+    void broadcast_frames(const char* json, const void* bin, size_t bin_len,
+                          uint8_t coalesce = 0);
+    bool has_json_clients();
     static esp_err_t handle_start_matter(httpd_req_t *req);
     static esp_err_t handle_matter_status(httpd_req_t *req);
     
@@ -65,7 +75,7 @@ public:
     void disconnect_all_clients();
     void cleanup_idle_clients();
     void remove_client(int fd);
-    int get_client_count() const { return active_clients.size(); }
+    int get_client_count() const;
 
     void setRemoveContactSensorCallback(endpoint_callback_t cb) {
         remove_contact_sensor_callback = cb;
@@ -80,15 +90,26 @@ public:
     void broadcastSensorDataUpdate(const String& address,
                                     const ShellyBLESensorData& data);
     void sendModalClose(int fd, const char* modal_id);
+    // Antwort an einen Client: Payload wird kopiert und über dessen
+    // Send-Queue gesendet (client_drain_work), false = verworfen
+    bool sendToClient(int fd, const void* payload, size_t len,
+                      httpd_ws_type_t type = HTTPD_WS_TYPE_TEXT);
     void logMemoryStats(const char* location);
 
     static esp_err_t drift_stats_handler(httpd_req_t *req);
     static esp_err_t drift_reset_handler(httpd_req_t *req);
+    static esp_err_t ble_capture_get_handler(httpd_req_t *req);
+    static esp_err_t ble_capture_post_handler(httpd_req_t *req);
+    static esp_err_t ble_link_stats_handler(httpd_req_t *req);
+    static esp_err_t ws_stats_handler(httpd_req_t *req);
     
     static int discoverDevices(DiscoveredDevice* devices, int max_devices);
     void broadcastDiscoveredDevices();
 
 private:
+    // WebSocket-Kommandos (web_ui_handler.cpp) greifen auf die Member zu
+    friend struct WSCommandHandlers;
+
     app_driver_handle_t handle;
     ShellyBLEManager* bleManager;
     httpd_handle_t server;
@@ -97,44 +118,44 @@ private:
     struct ClientInfo {
         int fd;
         uint32_t last_activity;
+        bool binary;                    // "proto:bin" ausgehandelt
     };
 
     endpoint_callback_t remove_contact_sensor_callback = nullptr;
     
     std::vector<ClientInfo> active_clients;
+
+    // Worker für lang laufende WebSocket-Kommandos
+    WSJobPool jobs;
     
     static const int MAX_CLIENTS = 3;
     static const uint32_t WS_TIMEOUT_MS = 60000;
     
     void register_client(int fd);
+    void touch_client(int fd);
+    void set_client_protocol(int fd, bool binary);
+    bool is_binary_client(int fd);
     void unregister_client(int fd);
+    void evict_client(int fd);
+    // Reiht frame in die Send-Queue von fd ein (false = verworfen/geschlossen)
+    bool enqueue_frame(int fd, WSFrame* frame);
+    // Reiht einen fertigen Text-Frame bei allen Clients ein
+    void broadcast_frame(WSFrame* frame);
+
+    // false = Queue voll (Client hat "rejected" bekommen)
+    bool submit_job(const char* name, WSJobFn fn, int fd, const char* address = nullptr,
+                    uint32_t passkey = 0, const ShellyBindkey* bindkey = nullptr);
+    static void send_job_message(void* ctx, int fd, const char* json);
 
     bool check_basic_auth(httpd_req_t *req);
     
     static esp_err_t root_handler(httpd_req_t *req);
     static esp_err_t ws_handler(httpd_req_t *req);
 
-    struct WSMessageBuffer {
-        char* buffer;
-        size_t size;
-        
-        WSMessageBuffer(const char* msg) {
-            size = strlen(msg) + 1;
-            buffer = (char*)malloc(size);
-            if (buffer) {
-                strcpy(buffer, msg);
-            }
-        }
-        
-        ~WSMessageBuffer() {
-            if (buffer) {
-                free(buffer);
-            }
-        }
-        
-        WSMessageBuffer(const WSMessageBuffer&) = delete;
-        WSMessageBuffer& operator=(const WSMessageBuffer&) = delete;
-    };
+    // httpd_queue_work(): leert die Send-Queue eines Clients
+    static void client_drain_work(void* arg);
+    // esp_timer: reiht client_drain_work nach Backpressure erneut ein
+    static void client_drain_retry(void* arg);
 };
 
 #endif // WEB_UI_HANDLER_H
@@ -0,0 +1,105 @@
+// ws_binary.h
+
+#ifndef WS_BINARY_H
+#define WS_BINARY_H
+
+#pragma once
+
+#include <stdint.h>
+#include "bthome_packet.h"
+
+// ═══════════════════════════════════════════════════════════════════════
+// Binäres WebSocket-Protokoll (optional, neben JSON)
+// ═══════════════════════════════════════════════════════════════════════
+//
+// Der Client wählt das Protokoll direkt nach dem Öffnen:
+//   "proto:bin"  → Status + Sensor-Updates als Binary Frames
+//   "proto:json" → alles als JSON (Default, zum Debuggen)
+// Antwort immer als JSON: {"type":"proto","proto":"bin","version":1}
+//
+// Alle übrigen Nachrichten bleiben JSON-Text. Jeder Binary Frame beginnt
+// mit version + type, danach ein fester Struct, Little Endian, gepackt.
+// web_ui.html dekodiert mit DataView (decodeBinaryMessage) - Layout dort
+// mitpflegen!
+//
+//   WS_BIN_STATUS (7 Bytes)
+//     uint8_t  version, type
+//     uint8_t  fields        StatusField-Bitmaske: nur diese sind gültig
+//     uint8_t  pos           0..100
+//     uint8_t  flags         bit0 cal, bit1 inv, bit2 moving
+//     uint8_t  win           WindowState
+//     uint8_t  ble           ShellyBLEManager::DeviceState
+//
+//   WS_BIN_SENSOR (28 Bytes)
+//     uint8_t  version, type
+//     uint8_t  mac[6]        wie angezeigt (MSB zuerst)
+//     uint8_t  flags         WS_BIN_SENSOR_*
+//     uint8_t  window_state  WindowState
+//     uint8_t  battery
+//     int8_t   rssi
+//     uint8_t  packet_id
+//     uint8_t  button_event  BTHome-Code (wsButtonEventCode: 0x01..0x06, 0x80 = Hold)
+//     uint8_t  confidence    SensorStateConfidence
+//     uint8_t  humidity      nur mit WS_BIN_SENSOR_HUMIDITY
+//     int16_t  rotation      Grad
+//     int16_t  temperature   0.1 °C, nur mit WS_BIN_SENSOR_TEMPERATURE
+//     uint32_t illuminance
+//     int32_t  seconds_ago   -1 = unbekannt
+
+#define WS_BIN_VERSION      1
+
+enum WSBinType : uint8_t {
+    WS_BIN_STATUS = 0x01,
+    WS_BIN_SENSOR = 0x02
+};
+
+#define WS_BIN_STATUS_CAL           0x01
+#define WS_BIN_STATUS_INV           0x02
+#define WS_BIN_STATUS_MOVING        0x04
+
+#define WS_BIN_SENSOR_WINDOW_OPEN   0x01
+#define WS_BIN_SENSOR_BUTTON        0x02
+#define WS_BIN_SENSOR_TEMPERATURE   0x04
+#define WS_BIN_SENSOR_HUMIDITY      0x08
+#define WS_BIN_SENSOR_MOTION_VALID  0x10
+#define WS_BIN_SENSOR_MOTION        0x20
+
+struct __attribute__((packed)) WSBinStatus {
+    uint8_t version;
+    uint8_t type;
+    uint8_t fields;
+    uint8_t pos;
+    uint8_t flags;
+    uint8_t win;
+    uint8_t ble;
+};
+
+struct __attribute__((packed)) WSBinSensor {
+    uint8_t version;
+    uint8_t type;
+    uint8_t mac[6];
+    uint8_t flags;
+    uint8_t windowState;
+    uint8_t battery;
+    int8_t rssi;
+    uint8_t packetId;
+    uint8_t buttonEvent;
+    uint8_t confidence;
+    uint8_t humidity;
+    int16_t rotation;
+    int16_t temperature;
+    uint32_t illuminance;
+    int32_t secondsAgo;
+};
+
+// ShellyButtonEvent → BTHome-Code (0x3A) für JSON und WS_BIN_SENSOR.
+// BUTTON_HOLD (0x8001) passt nicht in ein Byte und würde zu 0x01 (Single) -
+// der UI-eventMap kennt 0x80.
+static inline uint8_t wsButtonEventCode(ShellyButtonEvent event) {
+    return event == BUTTON_HOLD ? 0x80 : (uint8_t)event;
+}
+
+static_assert(sizeof(WSBinStatus) == 7, "WSBinStatus layout changed");
+static_assert(sizeof(WSBinSensor) == 28, "WSBinSensor layout changed");
+
+#endif // WS_BINARY_H
@@ -0,0 +1,263 @@
+// ws_jobs.cpp
+
+#include "ws_jobs.h"
+#include "json_command.h"
+#include <esp_log.h>
+#include <mbedtls/platform_util.h>
+#include <string.h>
+
+static const char* TAG = "WSJobs";
+
+// ═══════════════════════════════════════════════════════════════════════
+// WSJob
+// ═══════════════════════════════════════════════════════════════════════
+
+bool WSJob::sleep(uint32_t ms) {
+    // In 100ms-Schritten, damit ein Cancel zeitnah greift
+    while (ms > 0) {
+        if (cancelled()) return false;
+        uint32_t step = ms > 100 ? 100 : ms;
+        vTaskDelay(pdMS_TO_TICKS(step));
+        ms -= step;
+    }
+    return !cancelled();
+}
+
+void WSJob::progress(uint8_t percent, const char* message) {
+    if (percent > 100) percent = 100;
+    ESP_LOGI(TAG, "Job #%u %s: %u%%%s%s", id_, name_, percent,
+             message ? " - " : "", message ? message : "");
+    pool_->report(*this, "running", percent, message);
+}
+
+void WSJob::send(const char* json) {
+    pool_->sendTo(args_.fd, json);
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// WSJobPool
+// ═══════════════════════════════════════════════════════════════════════
+
+WSJobPool::WSJobPool()
+    : queue_(nullptr),
+      workers_{},
+      send_(nullptr),
+      sendCtx_(nullptr),
+      nextId_(1),
+      completed_(0),
+      rejected_(0) {
+    portMUX_INITIALIZE(&lock_);
+    for (auto& slot : slots_) {
+        slot.pool_ = this;
+        slot.fn_ = nullptr;
+        slot.name_ = "";
+        slot.id_ = 0;
+        slot.state_ = WSJob::FREE;
+        slot.cancel_.store(false);
+    }
+}
+
+bool WSJobPool::begin(WSJobSendFn send, void* ctx) {
+    if (queue_) return true;
+
+    send_ = send;
+    sendCtx_ = ctx;
+
+    // Queue enthält Slot-Indizes (nur wartende Jobs)
+    queue_ = xQueueCreate(WS_JOB_QUEUE_LEN, sizeof(uint8_t));
+    if (!queue_) {
+        ESP_LOGE(TAG, "✗ Failed to create job queue");
+        return false;
+    }
+
+    for (int i = 0; i < WS_JOB_WORKERS; i++) {
+        char name[12];
+        snprintf(name, sizeof(name), "ws_job%d", i);
+        if (xTaskCreate(worker_task, name, WS_JOB_STACK_SIZE, this,
+                        WS_JOB_PRIORITY, &workers_[i]) != pdPASS) {
+            ESP_LOGE(TAG, "✗ Failed to start worker %s", name);
+            return false;
+        }
+    }
+
+    ESP_LOGI(TAG, "✓ %d job workers started (stack %u, queue %d)",
+             WS_JOB_WORKERS, WS_JOB_STACK_SIZE, WS_JOB_QUEUE_LEN);
+    return true;
+}
+
+uint16_t WSJobPool::submit(const char* name, WSJobFn fn, const WSJobArgs& args) {
+    if (!queue_ || !fn) return 0;
+
+    WSJob* job = nullptr;
+    uint8_t index = 0;
+    uint8_t queued = 0;
+
+    taskENTER_CRITICAL(&lock_);
+    for (uint8_t i = 0; i < sizeof(slots_) / sizeof(slots_[0]); i++) {
+        if (slots_[i].state_ == WSJob::QUEUED) queued++;
+        if (!job && slots_[i].state_ == WSJob::FREE) {
+            job = &slots_[i];
+            index = i;
+        }
+    }
+    if (job && queued < WS_JOB_QUEUE_LEN) {
+        job->state_ = WSJob::QUEUED;
+        job->fn_ = fn;
+        job->name_ = name;
+        job->args_ = args;
+        job->cancel_.store(false);
+        job->id_ = nextId_++;
+        if (nextId_ == 0) nextId_ = 1;          // 0 = "abgelehnt"
+    } else {
+        job = nullptr;
+    }
+    taskEXIT_CRITICAL(&lock_);
+
+    // "queued" vor dem Einreihen melden, sonst kann "running" überholen
+    if (job) {
+        report(*job, "queued");
+    }
+
+    if (!job || xQueueSend(queue_, &index, 0) != pdTRUE) {
+        if (job) {
+            taskENTER_CRITICAL(&lock_);
+            job->state_ = WSJob::FREE;
+            taskEXIT_CRITICAL(&lock_);
+        }
+        rejected_++;
+        ESP_LOGW(TAG, "✗ Job queue full - rejecting %s", name);
+
+        char escapedName[WS_JOB_NAME_ESCAPED];
+        json_escape(escapedName, sizeof(escapedName), name);
+
+        char msg[WS_JOB_MSG_MAX];
+        snprintf(msg, sizeof(msg),
+                 "{\"type\":\"job\",\"id\":0,\"name\":\"%s\",\"state\":\"rejected\","
+                 "\"message\":\"Device busy - try again in a moment\"}", escapedName);
+        sendTo(args.fd, msg);
+        return 0;
+    }
+
+    ESP_LOGI(TAG, "→ Job #%u %s queued (fd=%d)", job->id_, name, args.fd);
+    return job->id_;
+}
+
+bool WSJobPool::cancel(uint16_t id) {
+    if (id == 0) return false;
+
+    bool found = false;
+    taskENTER_CRITICAL(&lock_);
+    for (auto& slot : slots_) {
+        if (slot.state_ != WSJob::FREE && slot.id_ == id) {
+            slot.cancel_.store(true);
+            found = true;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&lock_);
+
+    ESP_LOGI(TAG, "Cancel job #%u: %s", id, found ? "requested" : "not found");
+    return found;
+}
+
+uint8_t WSJobPool::pending() const {
+    uint8_t count = 0;
+    for (const auto& slot : slots_) {
+        if (slot.state_ == WSJob::QUEUED) count++;
+    }
+    return count;
+}
+
+uint8_t WSJobPool::running() const {
+    uint8_t count = 0;
+    for (const auto& slot : slots_) {
+        if (slot.state_ == WSJob::RUNNING) count++;
+    }
+    return count;
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// Worker
+// ═══════════════════════════════════════════════════════════════════════
+
+void WSJobPool::worker_task(void* arg) {
+    WSJobPool* pool = static_cast<WSJobPool*>(arg);
+    uint8_t index;
+
+    while (true) {
+        if (xQueueReceive(pool->queue_, &index, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        pool->run(pool->slots_[index]);
+    }
+}
+
+void WSJobPool::run(WSJob& job) {
+    taskENTER_CRITICAL(&lock_);
+    job.state_ = WSJob::RUNNING;
+    taskEXIT_CRITICAL(&lock_);
+
+    const char* result;
+    if (job.cancelled()) {
+        result = "cancelled";
+    } else {
+        ESP_LOGI(TAG, "▶ Job #%u %s started on %s", job.id_, job.name_,
+                 pcTaskGetName(NULL));
+        report(job, "running", 0);
+
+        uint32_t start = millis();
+        bool ok = job.fn_(job);
+        uint32_t duration = millis() - start;
+
+        result = job.cancelled() ? "cancelled" : (ok ? "done" : "failed");
+        ESP_LOGI(TAG, "■ Job #%u %s %s after %u ms", job.id_, job.name_, result, duration);
+
+        UBaseType_t highWater = uxTaskGetStackHighWaterMark(NULL);
+        if (highWater < 512) {
+            ESP_LOGW(TAG, "⚠️ Worker stack low after %s: %u bytes free",
+                     job.name_, highWater * sizeof(StackType_t));
+        }
+    }
+    report(job, result, job.cancelled() ? -1 : 100);
+
+    // Schlüsselmaterial nicht im Slot liegen lassen
+    mbedtls_platform_zeroize(&job.args_, sizeof(job.args_));
+
+    taskENTER_CRITICAL(&lock_);
+    job.state_ = WSJob::FREE;
+    job.fn_ = nullptr;
+    taskEXIT_CRITICAL(&lock_);
+    completed_++;
+}
+
+void WSJobPool::report(const WSJob& job, const char* state, int progress,
+                       const char* message) {
+    // name/message sind Freitext (Job-Code, Fehlertexte) → escapen
+    char escapedName[WS_JOB_NAME_ESCAPED];
+    json_escape(escapedName, sizeof(escapedName), job.name_);
+
+    char msg[WS_JOB_MSG_MAX];
+    int n = snprintf(msg, sizeof(msg),
+                     "{\"type\":\"job\",\"id\":%u,\"name\":\"%s\",\"state\":\"%s\"",
+                     job.id_, escapedName, state);
+    if (progress >= 0 && n < (int)sizeof(msg)) {
+        n += snprintf(msg + n, sizeof(msg) - n, ",\"progress\":%d", progress);
+    }
+    if (message && n < (int)sizeof(msg)) {
+        char escapedMessage[WS_JOB_MSG_MAX];
+        json_escape(escapedMessage, sizeof(escapedMessage), message);
+        n += snprintf(msg + n, sizeof(msg) - n, ",\"message\":\"%s\"", escapedMessage);
+    }
+    if (n >= (int)sizeof(msg) - 1) {
+        ESP_LOGW(TAG, "Job report truncated (#%u)", job.id_);
+        return;
+    }
+    snprintf(msg + n, sizeof(msg) - n, "}");
+    sendTo(job.args_.fd, msg);
+}
+
+void WSJobPool::sendTo(int fd, const char* json) {
+    if (send_ && fd >= 0) {
+        send_(sendCtx_, fd, json);
+    }
+}
@@ -0,0 +1,135 @@
+// ws_jobs.h
+
+#ifndef WS_JOBS_H
+#define WS_JOBS_H
+
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+// ═══════════════════════════════════════════════════════════════════════
+// WebSocket Jobs: feste Worker-Tasks für lang laufende Kommandos
+// ═══════════════════════════════════════════════════════════════════════
+//
+// Statt pro Kommando einen Task mit new'ed Parametern zu starten, reihen
+// die Handler einen Job in eine begrenzte Queue ein. WS_JOB_WORKERS Tasks
+// laufen dauerhaft und arbeiten die Jobs ab; Parameter liegen im Job-Slot
+// (kein Heap).
+//
+// Jeder Job bekommt eine ID und meldet seinen Zustand an den Client, der
+// ihn gestartet hat:
+//   {"type":"job","id":7,"name":"ble_encrypt","state":"queued"}
+//   {"type":"job","id":7,"name":"ble_encrypt","state":"running","progress":40,
+//    "message":"Writing passkey"}
+//   state: queued | running | done | failed | cancelled | rejected
+//
+// Abbrechen per "job_cancel:<id>". Der Abbruch ist kooperativ: wartende
+// Jobs starten nicht mehr, laufende prüfen cancelled() bzw. sleep() an
+// ihren Wartepunkten. Blockierende BLE-Aufrufe laufen zu Ende.
+
+#define WS_JOB_WORKERS      2
+#define WS_JOB_QUEUE_LEN    4
+#define WS_JOB_STACK_SIZE   8192    // Discovery (2KB json_buf + mDNS) / NimBLE Client
+#define WS_JOB_PRIORITY     5
+#define WS_JOB_MSG_MAX      192
+#define WS_JOB_NAME_ESCAPED 64      // Job-Name nach json_escape()
+
+class WSJob;
+class WSJobPool;
+
+// true = erfolgreich ("done"), false = "failed"
+typedef bool (*WSJobFn)(WSJob& job);
+
+// Sendet einen JSON-Text an genau einen Client
+typedef void (*WSJobSendFn)(void* ctx, int fd, const char* json);
+
+// Parameter werden in den Job-Slot kopiert
+struct WSJobArgs {
+    void* ctx;                  // WebUIHandler*
+    int fd;                     // auslösender Client
+    char address[18];           // BLE-MAC "AA:BB:CC:DD:EE:FF"
+    uint32_t passkey;
+    uint8_t bindkey[16];        // wird nach dem Job gelöscht
+    bool hasBindkey;
+};
+
+class WSJob {
+public:
+    uint16_t id() const { return id_; }
+    const char* name() const { return name_; }
+    int fd() const { return args_.fd; }
+    const WSJobArgs& args() const { return args_; }
+
+    bool cancelled() const { return cancel_.load(); }
+
+    // Wartet ms, bricht bei Cancel vorzeitig ab (false = abgebrochen)
+    bool sleep(uint32_t ms);
+
+    // Fortschritt 0..100 an den auslösenden Client, message optional
+    // (reiner Text, wird beim Senden JSON-escaped)
+    void progress(uint8_t percent, const char* message = nullptr);
+
+    // Beliebige JSON-Nachricht an den auslösenden Client
+    void send(const char* json);
+
+private:
+    friend class WSJobPool;
+
+    enum State : uint8_t { FREE, QUEUED, RUNNING };
+
+    WSJobPool* pool_;
+    WSJobFn fn_;
+    const char* name_;
+    WSJobArgs args_;
+    uint16_t id_;
+    State state_;
+    std::atomic<bool> cancel_;
+};
+
+class WSJobPool {
+public:
+    WSJobPool();
+
+    // Startet die Worker-Tasks (einmalig)
+    bool begin(WSJobSendFn send, void* ctx);
+
+    // Liefert die Job-ID, 0 = Queue voll (Client bekommt "rejected")
+    uint16_t submit(const char* name, WSJobFn fn, const WSJobArgs& args);
+
+    // false = unbekannte oder bereits beendete ID
+    bool cancel(uint16_t id);
+
+    uint8_t pending() const;
+    uint8_t running() const;
+    uint32_t completed() const { return completed_.load(); }
+    uint32_t rejected() const { return rejected_.load(); }
+
+private:
+    friend class WSJob;
+
+    static void worker_task(void* arg);
+    void run(WSJob& job);
+    void report(const WSJob& job, const char* state, int progress = -1,
+                const char* message = nullptr);
+    void sendTo(int fd, const char* json);
+
+    WSJob slots_[WS_JOB_QUEUE_LEN + WS_JOB_WORKERS];
+    QueueHandle_t queue_;
+    TaskHandle_t workers_[WS_JOB_WORKERS];
+    portMUX_TYPE lock_;
+
+    WSJobSendFn send_;
+    void* sendCtx_;
+
+    uint16_t nextId_;
+    // Zähler: Worker-Tasks (completed_) und httpd Task (rejected_),
+    // gelesen von ws_stats
+    std::atomic<uint32_t> completed_;
+    std::atomic<uint32_t> rejected_;
+};
+
+#endif // WS_JOBS_H
@@ -0,0 +1,296 @@
+#!/usr/bin/env python3
+"""
+BeltWinder Matter - BLE Capture Replay
+Spielt .bwcap Captures (GET /api/ble/capture) auf dem Host ab und
+dekodiert sie mit dem Firmware-Code selbst.
+
+main/bthome_packet.cpp, main/bthome_device_class.cpp und der AD-Parser aus
+lib/esp32_ble_simple werden hinter scripts/ble_replay_host/replay_shim.cpp
+als Shared Library gebaut (c++, OpenSSL für AES-CCM) und per ctypes geladen.
+Der Build wird im Temp-Verzeichnis gecacht und bei Quelländerungen erneuert.
+
+Stufen (alle in C++):
+  1. AD-Parsing      (SimpleBLEDevice::parse_advertisement)
+  2. Dedup           (bthomeCheckPacketFilter / bthomeCommitPacketFilter)
+  3. Decryption      (bthomeDecrypt, nur mit --bindkey)
+  4. BTHome Decode   (bthomeDecodeObjects)
+
+Beispiele:
+  python3 scripts/ble_replay.py capture.bwcap
+  python3 scripts/ble_replay.py capture.bwcap --speed 50
+  python3 scripts/ble_replay.py capture.bwcap --bindkey AA:BB:CC:DD:EE:FF=00112233...
+  python3 scripts/ble_replay.py capture.bwcap --events-out events.jsonl
+
+--events-out schreibt ein Event pro Zeile; zwei Läufe vor/nach einer
+Parser-Änderung lassen sich direkt mit diff vergleichen.
+"""
+
+import argparse
+import ctypes
+import hashlib
+import json
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+from pathlib import Path
+
+MAGIC = b"BWAC"
+HEADER_FMT = "<4sBBHII"
+RECORD_FMT = "<I6sBbBB"
+RECORD_OVERHEAD = struct.calcsize(RECORD_FMT)
+
+ROOT = Path(__file__).resolve().parent.parent
+SHIM_DIR = ROOT / "scripts" / "ble_replay_host"
+
+SOURCES = [
+    SHIM_DIR / "replay_shim.cpp",
+    ROOT / "main" / "bthome_packet.cpp",
+    ROOT / "main" / "bthome_device_class.cpp",
+]
+INCLUDE_DIRS = [
+    SHIM_DIR / "include",
+    ROOT / "main",
+    ROOT / "lib" / "esp32_ble_simple",
+]
+
+# BWReplayStatus in replay_shim.cpp
+STATUS_NO_BTHOME = 0
+STATUS_DECODED = 1
+STATUS_DUPLICATE = 2
+STATUS_REPLAY = 3
+STATUS_NO_KEY = 4
+STATUS_DECRYPT_FAILED = 5
+STATUS_PARSE_FAILED = 6
+STATUS_RESYNC_PENDING = 7
+
+STAGE_NAMES = ["ad_parse", "dedup", "decrypt", "bthome"]
+
+
+class ReplayResult(ctypes.Structure):
+    """Layout wie BWReplayResult in replay_shim.cpp"""
+    _fields_ = [
+        ("status", ctypes.c_int32),
+        ("stage_ns", ctypes.c_uint32 * len(STAGE_NAMES)),
+        ("name", ctypes.c_char * 32),
+        ("json", ctypes.c_char * 320),
+    ]
+
+
+class Stage:
+    """Latenz-Statistik einer Verarbeitungsstufe (Mikrosekunden)"""
+
+    def __init__(self, name):
+        self.name = name
+        self.samples = []
+
+    def add_ns(self, ns):
+        self.samples.append(ns / 1000.0)
+
+    def report(self):
+        if not self.samples:
+            return f"  {self.name:<14} -"
+        s = sorted(self.samples)
+        p50 = s[len(s) // 2]
+        p99 = s[min(len(s) - 1, int(len(s) * 0.99))]
+        mean = sum(s) / len(s)
+        return (f"  {self.name:<14} n={len(s):<7} mean={mean:7.2f}us "
+                f"p50={p50:7.2f}us p99={p99:7.2f}us")
+
+
+def build_shim():
+    """Baut die Shared Library, falls sich Quellen oder Header geändert haben"""
+    cxx = os.environ.get("CXX", "c++")
+    cmd = [cxx, "-std=c++17", "-O2", "-shared", "-fPIC", "-Wall"]
+    cmd += [f"-I{d}" for d in INCLUDE_DIRS]
+
+    digest = hashlib.sha1(" ".join(cmd).encode())
+    inputs = list(SOURCES)
+    for d in INCLUDE_DIRS:
+        inputs += sorted(d.rglob("*.h"))
+    for path in inputs:
+        digest.update(path.read_bytes())
+
+    out_dir = Path(tempfile.gettempdir()) / "bw_ble_replay"
+    lib = out_dir / f"libbwreplay-{digest.hexdigest()[:12]}.so"
+    if lib.exists():
+        return lib
+
+    out_dir.mkdir(parents=True, exist_ok=True)
+    tmp = lib.with_suffix(f".{os.getpid()}.tmp")
+    full = cmd + [str(s) for s in SOURCES] + ["-o", str(tmp), "-lcrypto"]
+    print(f"Baue Replay-Shim: {lib.name}", file=sys.stderr)
+    result = subprocess.run(full, capture_output=True, text=True)
+    if result.returncode != 0:
+        sys.stderr.write(result.stderr)
+        raise SystemExit("Replay-Shim konnte nicht gebaut werden (c++ und libssl-dev nötig)")
+    tmp.replace(lib)
+    return lib
+
+
+def load_shim(log_level):
+    shim = ctypes.CDLL(str(build_shim()))
+    shim.bw_replay_set_log_level.argtypes = [ctypes.c_int]
+    shim.bw_replay_set_bindkey.argtypes = [ctypes.c_char_p, ctypes.c_char_p]
+    shim.bw_replay_set_bindkey.restype = ctypes.c_int
+    shim.bw_replay_process.argtypes = [
+        ctypes.c_uint32, ctypes.c_char_p, ctypes.c_uint8, ctypes.c_int8,
+        ctypes.c_uint8, ctypes.c_char_p, ctypes.c_uint8, ctypes.POINTER(ReplayResult),
+    ]
+    shim.bw_replay_process.restype = ctypes.c_int
+    shim.bw_replay_filter_stats.argtypes = [ctypes.POINTER(ctypes.c_uint32)] * 4
+    shim.bw_replay_set_log_level(log_level)
+    return shim
+
+
+def read_capture(path):
+    data = Path(path).read_bytes()
+    if len(data) < struct.calcsize(HEADER_FMT):
+        raise ValueError("Datei zu kurz")
+
+    magic, version, header_len, _, count, dropped = struct.unpack_from(HEADER_FMT, data)
+    if magic != MAGIC:
+        raise ValueError(f"Kein .bwcap (magic={magic!r})")
+    if version != 1:
+        raise ValueError(f"Unbekannte Version {version}")
+
+    records = []
+    pos = header_len
+    while pos + RECORD_OVERHEAD <= len(data):
+        ts, mac_le, addr_type, rssi, evt, dlen = struct.unpack_from(RECORD_FMT, data, pos)
+        pos += RECORD_OVERHEAD
+        if pos + dlen > len(data):
+            break
+        records.append({
+            "ts": ts,
+            "mac": ":".join(f"{b:02X}" for b in reversed(mac_le)),
+            "mac_le": mac_le,
+            "addr_type": addr_type,
+            "rssi": rssi,
+            "event_type": evt,
+            "data": data[pos:pos + dlen],
+        })
+        pos += dlen
+
+    if len(records) != count:
+        print(f"Warnung: Header meldet {count} Records, gelesen {len(records)}", file=sys.stderr)
+
+    return records, dropped
+
+
+def parse_bindkeys(items):
+    keys = {}
+    for item in items or []:
+        mac, _, key = item.partition("=")
+        if len(key) != 32:
+            raise SystemExit(f"Bindkey für {mac} muss 32 Hex-Zeichen haben")
+        keys[mac.upper()] = bytes.fromhex(key)
+    return keys
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Replay .bwcap BLE captures")
+    parser.add_argument("capture")
+    parser.add_argument("--speed", type=float, default=0,
+                        help="Zeitraffer-Faktor (0 = so schnell wie möglich)")
+    parser.add_argument("--bindkey", action="append", metavar="MAC=HEX",
+                        help="Bindkey für verschlüsselte Sensoren (mehrfach möglich)")
+    parser.add_argument("--mac", help="Nur diese MAC auswerten")
+    parser.add_argument("--events-out", help="Dekodierte Events als JSONL schreiben")
+    parser.add_argument("--log-level", type=int, default=0, choices=range(6),
+                        help="ESP_LOG Level der Firmware-Module auf stderr (0 = aus, 5 = verbose)")
+    parser.add_argument("--quiet", action="store_true", help="Events nicht ausgeben")
+    args = parser.parse_args()
+
+    records, dropped = read_capture(args.capture)
+    shim = load_shim(args.log_level)
+
+    for mac, key in parse_bindkeys(args.bindkey).items():
+        if shim.bw_replay_set_bindkey(mac.encode(), key) != 0:
+            raise SystemExit(f"Ungültige MAC für Bindkey: {mac}")
+
+    stages = [Stage(name) for name in STAGE_NAMES]
+    counts = {"records": len(records), "bthome": 0, "duplicates": 0, "replays": 0,
+              "resync_pending": 0, "encrypted_no_key": 0, "decrypt_failed": 0,
+              "parse_failed": 0, "decoded": 0}
+    status_counter = {
+        STATUS_DUPLICATE: "duplicates",
+        STATUS_REPLAY: "replays",
+        STATUS_RESYNC_PENDING: "resync_pending",
+        STATUS_NO_KEY: "encrypted_no_key",
+        STATUS_DECRYPT_FAILED: "decrypt_failed",
+        STATUS_PARSE_FAILED: "parse_failed",
+        STATUS_DECODED: "decoded",
+    }
+
+    events_file = open(args.events_out, "w") if args.events_out else None
+    wall_start = time.perf_counter()
+    first_ts = records[0]["ts"] if records else 0
+    result = ReplayResult()
+
+    for rec in records:
+        if args.mac and rec["mac"] != args.mac.upper():
+            continue
+
+        if args.speed > 0:
+            target = (rec["ts"] - first_ts) / 1000.0 / args.speed
+            delay = target - (time.perf_counter() - wall_start)
+            if delay > 0:
+                time.sleep(delay)
+
+        status = shim.bw_replay_process(rec["ts"], rec["mac_le"], rec["addr_type"],
+                                        rec["rssi"], rec["event_type"], rec["data"],
+                                        len(rec["data"]), ctypes.byref(result))
+
+        for stage, ns in zip(stages, result.stage_ns):
+            if ns:
+                stage.add_ns(ns)
+
+        if status == STATUS_NO_BTHOME:
+            continue
+        counts["bthome"] += 1
+        counts[status_counter[status]] += 1
+        if status != STATUS_DECODED:
+            continue
+
+        fields = json.loads(result.json.decode())
+        event = {"ts": rec["ts"], "mac": rec["mac"], "rssi": rec["rssi"], **fields}
+        name = result.name.decode("utf-8", "replace")
+        if name:
+            event["name"] = name
+        if events_file:
+            events_file.write(json.dumps(event, sort_keys=True) + "\n")
+        if not args.quiet:
+            print(f"{rec['ts']:>10} {rec['mac']} {json.dumps(fields, sort_keys=True)}")
+
+    elapsed = time.perf_counter() - wall_start
+    if events_file:
+        events_file.close()
+
+    stats = [ctypes.c_uint32() for _ in range(4)]
+    shim.bw_replay_filter_stats(*[ctypes.byref(s) for s in stats])
+    accepted, duplicates, replays, resyncs = (s.value for s in stats)
+
+    span = (records[-1]["ts"] - first_ts) / 1000.0 if records else 0
+    print("")
+    print("=" * 60)
+    print(f"Records:        {counts['records']} ({dropped} dropped on device)")
+    print(f"Capture span:   {span:.1f} s")
+    print(f"Replay time:    {elapsed:.3f} s "
+          f"({counts['records'] / elapsed if elapsed > 0 else 0:.0f} records/s)")
+    print(f"BTHome:         {counts['bthome']}  duplicates: {counts['duplicates']}  "
+          f"replays: {counts['replays']}  resync pending: {counts['resync_pending']}")
+    print(f"Decoded:        {counts['decoded']}  no key: {counts['encrypted_no_key']}  "
+          f"decrypt failed: {counts['decrypt_failed']}  parse failed: {counts['parse_failed']}")
+    print(f"Filter:         accepted={accepted} duplicates={duplicates} "
+          f"replays={replays} resyncs={resyncs}")
+    print("Stage latency:")
+    for stage in stages:
+        print(stage.report())
+    print("=" * 60)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,34 @@
+// esp_log.h - Host-Shim für scripts/ble_replay.py
+
+#ifndef BW_REPLAY_ESP_LOG_H
+#define BW_REPLAY_ESP_LOG_H
+
+#pragma once
+
+#include <cstdio>
+
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+// Gesetzt über bw_replay_set_log_level() (ble_replay.py --log-level)
+extern int bw_replay_log_level;
+
+#define ESP_LOG_LEVEL(level, tag, format, ...) do { \
+        if (bw_replay_log_level >= (level)) { \
+            fprintf(stderr, "[%s] " format "\n", tag, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_ERROR,   tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_WARN,    tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_INFO,    tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_DEBUG,   tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_VERBOSE, tag, format, ##__VA_ARGS__)
+
+#endif // BW_REPLAY_ESP_LOG_H
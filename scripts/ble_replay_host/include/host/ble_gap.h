@@ -0,0 +1,5 @@
+// host/ble_gap.h - Host-Shim für scripts/ble_replay.py (leer, siehe host/ble_hs.h)
+
+#pragma once
+
+#include "host/ble_hs.h"
@@ -0,0 +1,36 @@
+// host/ble_hs.h - Host-Shim für scripts/ble_replay.py
+//
+// Nur was esp32_ble_simple.h für SimpleBLEDevice::parse_advertisement() braucht.
+
+#ifndef BW_REPLAY_BLE_HS_H
+#define BW_REPLAY_BLE_HS_H
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+#define BLE_ADDR_PUBLIC                 0x00
+#define BLE_ADDR_RANDOM                 0x01
+
+#define BLE_HS_ADV_TYPE_INCOMP_NAME     0x08
+#define BLE_HS_ADV_TYPE_COMP_NAME       0x09
+#define BLE_HS_ADV_TYPE_SVC_DATA_UUID16 0x16
+
+typedef struct {
+    uint8_t type;
+    uint8_t val[6];
+} ble_addr_t;
+
+struct ble_gap_disc_desc {
+    uint8_t event_type;
+    uint8_t length_data;
+    ble_addr_t addr;
+    int8_t rssi;
+    const uint8_t* data;
+    ble_addr_t direct_addr;
+};
+
+struct ble_gap_event;
+
+#endif // BW_REPLAY_BLE_HS_H
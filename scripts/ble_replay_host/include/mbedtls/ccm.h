@@ -0,0 +1,37 @@
+// mbedtls/ccm.h - Host-Shim für scripts/ble_replay.py
+//
+// Nur die Teilmenge, die main/ nutzt. Implementiert in replay_shim.cpp
+// über OpenSSL (EVP aes-128-ccm), Semantik wie mbedTLS.
+
+#ifndef BW_REPLAY_MBEDTLS_CCM_H
+#define BW_REPLAY_MBEDTLS_CCM_H
+
+#pragma once
+
+#include <cstddef>
+
+#define MBEDTLS_ERR_CCM_BAD_INPUT       -0x000D
+#define MBEDTLS_ERR_CCM_AUTH_FAILED     -0x000F
+
+typedef enum {
+    MBEDTLS_CIPHER_ID_NONE = 0,
+    MBEDTLS_CIPHER_ID_NULL,
+    MBEDTLS_CIPHER_ID_AES
+} mbedtls_cipher_id_t;
+
+typedef struct {
+    unsigned char key[16];
+    int keySet;
+} mbedtls_ccm_context;
+
+void mbedtls_ccm_init(mbedtls_ccm_context* ctx);
+void mbedtls_ccm_free(mbedtls_ccm_context* ctx);
+int mbedtls_ccm_setkey(mbedtls_ccm_context* ctx, mbedtls_cipher_id_t cipher,
+                       const unsigned char* key, unsigned int keybits);
+int mbedtls_ccm_auth_decrypt(mbedtls_ccm_context* ctx, size_t length,
+                             const unsigned char* iv, size_t iv_len,
+                             const unsigned char* add, size_t add_len,
+                             const unsigned char* input, unsigned char* output,
+                             const unsigned char* tag, size_t tag_len);
+
+#endif // BW_REPLAY_MBEDTLS_CCM_H
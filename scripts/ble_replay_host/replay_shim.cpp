@@ -0,0 +1,336 @@
+// replay_shim.cpp - Host-Build des BTHome Paketpfads für scripts/ble_replay.py
+//
+// Wird zusammen mit main/bthome_packet.cpp und main/bthome_device_class.cpp
+// als Shared Library gebaut (ble_replay.py übernimmt das). Jeder Record läuft
+// durch denselben Code wie auf dem ESP32:
+//
+//   SimpleBLEDevice::parse_advertisement()   AD-Strukturen, Name, Service Data
+//   bthomeCheckPacketFilter()                Duplikat-/Replay-Filter
+//   bthomeDecrypt()                          AES-CCM (OpenSSL statt mbedTLS)
+//   bthomeDecodeObjects()                    Objekt-Tabelle
+//   bthomeCommitPacketFilter()               Fenster/Resync
+//
+// Nur der Ablauf dazwischen entspricht ShellyBLEManager::onDeviceFound() und
+// parseBTHomePacket() - ohne Registry, Callbacks und Logging.
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+
+#include <openssl/evp.h>
+
+#include <esp_log.h>
+#include "esp32_ble_simple.h"
+#include "bthome_packet.h"
+#include "bthome_device_class.h"
+
+#define BTHOME_SERVICE_UUID 0xFCD2
+
+int bw_replay_log_level = ESP_LOG_NONE;
+
+// ═══════════════════════════════════════════════════════════════════════
+// mbedtls/ccm.h über OpenSSL
+// ═══════════════════════════════════════════════════════════════════════
+
+void mbedtls_ccm_init(mbedtls_ccm_context* ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_ccm_free(mbedtls_ccm_context* ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+int mbedtls_ccm_setkey(mbedtls_ccm_context* ctx, mbedtls_cipher_id_t cipher,
+                       const unsigned char* key, unsigned int keybits) {
+    if (cipher != MBEDTLS_CIPHER_ID_AES || keybits != 128) {
+        return MBEDTLS_ERR_CCM_BAD_INPUT;
+    }
+    memcpy(ctx->key, key, sizeof(ctx->key));
+    ctx->keySet = 1;
+    return 0;
+}
+
+int mbedtls_ccm_auth_decrypt(mbedtls_ccm_context* ctx, size_t length,
+                             const unsigned char* iv, size_t iv_len,
+                             const unsigned char* add, size_t add_len,
+                             const unsigned char* input, unsigned char* output,
+                             const unsigned char* tag, size_t tag_len) {
+    if (!ctx->keySet) {
+        return MBEDTLS_ERR_CCM_BAD_INPUT;
+    }
+
+    EVP_CIPHER_CTX* evp = EVP_CIPHER_CTX_new();
+    if (!evp) {
+        return MBEDTLS_ERR_CCM_BAD_INPUT;
+    }
+
+    int outLen = 0;
+    bool ok =
+        EVP_DecryptInit_ex(evp, EVP_aes_128_ccm(), nullptr, nullptr, nullptr) == 1 &&
+        EVP_CIPHER_CTX_ctrl(evp, EVP_CTRL_CCM_SET_IVLEN, (int)iv_len, nullptr) == 1 &&
+        EVP_CIPHER_CTX_ctrl(evp, EVP_CTRL_CCM_SET_TAG, (int)tag_len, (void*)tag) == 1 &&
+        EVP_DecryptInit_ex(evp, nullptr, nullptr, ctx->key, iv) == 1 &&
+        EVP_DecryptUpdate(evp, nullptr, &outLen, nullptr, (int)length) == 1 &&
+        EVP_DecryptUpdate(evp, nullptr, &outLen, add, (int)add_len) == 1;
+
+    // CCM: Tag-Prüfung passiert im letzten Update-Aufruf
+    bool authentic = ok && EVP_DecryptUpdate(evp, output, &outLen, input, (int)length) == 1;
+    EVP_CIPHER_CTX_free(evp);
+
+    if (!authentic) {
+        memset(output, 0, length);
+        return ok ? MBEDTLS_ERR_CCM_AUTH_FAILED : MBEDTLS_ERR_CCM_BAD_INPUT;
+    }
+    return 0;
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// Replay State (pro MAC, wie PairedShellyDevice)
+// ═══════════════════════════════════════════════════════════════════════
+
+enum BWReplayStatus {
+    BW_REPLAY_NO_BTHOME      = 0,
+    BW_REPLAY_DECODED        = 1,
+    BW_REPLAY_DUPLICATE      = 2,
+    BW_REPLAY_REPLAY         = 3,
+    BW_REPLAY_NO_KEY         = 4,
+    BW_REPLAY_DECRYPT_FAILED = 5,
+    BW_REPLAY_PARSE_FAILED   = 6,
+    BW_REPLAY_RESYNC_PENDING = 7
+};
+
+enum BWReplayStage {
+    BW_STAGE_AD_PARSE,
+    BW_STAGE_DEDUP,
+    BW_STAGE_DECRYPT,
+    BW_STAGE_BTHOME,
+    BW_STAGE_COUNT
+};
+
+// Layout muss zu ReplayResult in scripts/ble_replay.py passen
+struct BWReplayResult {
+    int32_t status;
+    uint32_t stageNs[BW_STAGE_COUNT];       // 0 = Stufe nicht gelaufen
+    char name[32];
+    char json[320];                         // Dekodierte Felder als JSON-Objekt
+};
+
+struct ReplaySensor {
+    BTHomePacketFilter filter;
+    mbedtls_ccm_context ccm;
+    bool hasKey;
+
+    ReplaySensor() : hasKey(false) { mbedtls_ccm_init(&ccm); }
+};
+
+static std::map<uint64_t, ReplaySensor> sensors;
+
+static bool parseMac(const char* str, uint64_t& mac) {
+    unsigned int b[6];
+    if (sscanf(str, "%2x:%2x:%2x:%2x:%2x:%2x", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) != 6) {
+        return false;
+    }
+    mac = 0;
+    for (int i = 0; i < 6; i++) {
+        mac = (mac << 8) | b[i];
+    }
+    return true;
+}
+
+class StageTimer {
+public:
+    explicit StageTimer(uint32_t& out) : out_(out), start_(std::chrono::steady_clock::now()) {}
+    ~StageTimer() {
+        out_ = (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_).count();
+    }
+
+private:
+    uint32_t& out_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+static void formatFields(const ShellyBLESensorData& d, const BTHomeDeviceClass* cls,
+                         char* out, size_t size) {
+    size_t n = snprintf(out, size, "{");
+    auto add = [&](const char* fmt, auto value) {
+        if (n >= size) return;
+        n += snprintf(out + n, size - n, "%s", n > 1 ? "," : "");
+        if (n >= size) return;
+        n += snprintf(out + n, size - n, fmt, value);
+    };
+
+    if (d.fields & BTHOME_FIELD_PACKET_ID)   add("\"packet_id\":%u", (unsigned)d.packetId);
+    if (d.fields & BTHOME_FIELD_BATTERY)     add("\"battery\":%u", (unsigned)d.battery);
+    if (d.fields & BTHOME_FIELD_ILLUMINANCE) add("\"illuminance\":%u", (unsigned)d.illuminance);
+    if (d.fields & BTHOME_FIELD_WINDOW)      add("\"window\":%d", d.windowOpen ? 1 : 0);
+    if (d.fields & BTHOME_FIELD_ROTATION)    add("\"rotation\":%d", (int)d.rotation);
+    if (d.fields & BTHOME_FIELD_TEMPERATURE) add("\"temperature\":%.1f", d.temperature / 10.0);
+    if (d.fields & BTHOME_FIELD_HUMIDITY)    add("\"humidity\":%u", (unsigned)d.humidity);
+    if (d.fields & BTHOME_FIELD_MOTION)      add("\"motion\":%d", d.motion ? 1 : 0);
+    if (d.fields & BTHOME_FIELD_DEVICE_TYPE) add("\"device_type\":%u", (unsigned)d.deviceTypeId);
+    if (d.hasButtonEvent)                    add("\"button\":%u", (unsigned)d.buttonEvent);
+    if (cls)                                 add("\"class\":\"%s\"", cls->id);
+
+    if (n + 2 <= size) {
+        out[n++] = '}';
+        out[n] = '\0';
+    } else {
+        snprintf(out, size, "{\"_error\":\"fields truncated\"}");
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// C API (ctypes)
+// ═══════════════════════════════════════════════════════════════════════
+
+extern "C" {
+
+void bw_replay_set_log_level(int level) {
+    bw_replay_log_level = level;
+}
+
+void bw_replay_reset() {
+    for (auto& entry : sensors) {
+        mbedtls_ccm_free(&entry.second.ccm);
+    }
+    sensors.clear();
+}
+
+// mac: "AA:BB:CC:DD:EE:FF", key: 16 Bytes - wie ShellySensorRegistry::cryptoContext()
+int bw_replay_set_bindkey(const char* macStr, const uint8_t* key) {
+    uint64_t mac;
+    if (!parseMac(macStr, mac)) {
+        return -1;
+    }
+    ReplaySensor& sensor = sensors[mac];
+    if (mbedtls_ccm_setkey(&sensor.ccm, MBEDTLS_CIPHER_ID_AES, key, 128) != 0) {
+        return -1;
+    }
+    sensor.hasKey = true;
+    return 0;
+}
+
+// Ein .bwcap Record (mac wie ble_addr_t.val, LSB zuerst)
+int bw_replay_process(uint32_t timestampMs, const uint8_t* macLe, uint8_t addrType,
+                      int8_t rssi, uint8_t eventType, const uint8_t* data, uint8_t length,
+                      BWReplayResult* result) {
+    memset(result, 0, sizeof(*result));
+
+    // ─── AD-Parsing (SimpleBLEScanner) ───
+    esp32_ble_simple::SimpleBLEDevice device;
+    const esp32_ble_simple::SimpleBLEServiceData* bthome = nullptr;
+    {
+        StageTimer t(result->stageNs[BW_STAGE_AD_PARSE]);
+
+        ble_gap_disc_desc disc = {};
+        disc.event_type = eventType;
+        disc.length_data = length;
+        disc.addr.type = addrType;
+        memcpy(disc.addr.val, macLe, 6);
+        disc.rssi = rssi;
+        disc.data = data;
+        device.parse_advertisement(&disc);
+
+        for (const auto& sd : device.get_service_datas()) {
+            if (sd.uuid.get_uuid16() == BTHOME_SERVICE_UUID && !sd.data.empty()) {
+                bthome = &sd;
+                break;
+            }
+        }
+    }
+
+    snprintf(result->name, sizeof(result->name), "%s", device.get_name().c_str());
+
+    if (!bthome) {
+        return result->status = BW_REPLAY_NO_BTHOME;
+    }
+
+    const uint8_t* bthomeData = bthome->data.data();
+    size_t bthomeLen = bthome->data.size();
+    ReplaySensor& sensor = sensors[device.get_address_uint64()];
+
+    // ─── Duplicate / Replay Filter (ShellyBLEManager::onDeviceFound) ───
+    BTHomePacketVerdict verdict;
+    {
+        StageTimer t(result->stageNs[BW_STAGE_DEDUP]);
+        verdict = bthomeCheckPacketFilter(bthomeData, bthomeLen, sensor.filter, timestampMs);
+    }
+
+    if (verdict == PACKET_DUPLICATE) {
+        sensor.filter.duplicates++;
+        return result->status = BW_REPLAY_DUPLICATE;
+    }
+    if (verdict == PACKET_REPLAY) {
+        sensor.filter.replays++;
+        return result->status = BW_REPLAY_REPLAY;
+    }
+    if (bthomeLen < 2) {
+        return result->status = BW_REPLAY_PARSE_FAILED;
+    }
+
+    // ─── Decryption (ShellyBLEManager::parseBTHomePacket) ───
+    bool encrypted = (bthomeData[0] & 0x01) != 0;
+    const uint8_t* payload = bthomeData + 1;
+    size_t payloadLength = bthomeLen - 1;
+    uint8_t decryptedBuffer[256];
+
+    if (encrypted) {
+        if (!sensor.hasKey) {
+            return result->status = BW_REPLAY_NO_KEY;
+        }
+
+        size_t decryptedLen = 0;
+        bool ok;
+        {
+            StageTimer t(result->stageNs[BW_STAGE_DECRYPT]);
+            ok = bthomeDecrypt(bthomeData, bthomeLen, &sensor.ccm, device.get_address_uint64(),
+                               decryptedBuffer, decryptedLen);
+        }
+        if (!ok) {
+            return result->status = BW_REPLAY_DECRYPT_FAILED;
+        }
+        payload = decryptedBuffer + 1;
+        payloadLength = decryptedLen - 1;
+    }
+
+    // ─── BTHome Objekte ───
+    ShellyBLESensorData sensorData;
+    sensorData.rssi = rssi;
+    bool hasData;
+    {
+        StageTimer t(result->stageNs[BW_STAGE_BTHOME]);
+        hasData = bthomeDecodeObjects(payload, payloadLength, sensorData);
+    }
+    if (!hasData) {
+        return result->status = BW_REPLAY_PARSE_FAILED;
+    }
+    sensorData.wasEncrypted = encrypted;
+
+    if (!bthomeCommitPacketFilter(bthomeData, bthomeLen, verdict, sensor.filter, timestampMs)) {
+        return result->status = BW_REPLAY_RESYNC_PENDING;
+    }
+
+    const BTHomeDeviceClass* cls = bthomeMatchDeviceClass(result->name, bthomeData, bthomeLen);
+    if (!cls && (sensorData.fields & BTHOME_FIELD_DEVICE_TYPE)) {
+        cls = bthomeClassByTypeId(sensorData.deviceTypeId);
+    }
+    formatFields(sensorData, cls, result->json, sizeof(result->json));
+
+    return result->status = BW_REPLAY_DECODED;
+}
+
+// Filter-Statistik aller Sensoren (wie "dedup" im BLE-Status)
+void bw_replay_filter_stats(uint32_t* accepted, uint32_t* duplicates,
+                            uint32_t* replays, uint32_t* resyncs) {
+    *accepted = *duplicates = *replays = *resyncs = 0;
+    for (const auto& entry : sensors) {
+        *accepted += entry.second.filter.accepted;
+        *duplicates += entry.second.filter.duplicates;
+        *replays += entry.second.filter.replays;
+        *resyncs += entry.second.filter.resyncs;
+    }
+}
+
+} // extern "C"
@@ -1,6 +1,9 @@
 #!/usr/bin/env python3
 """
 BeltWinder Matter - Build Hook with Dedicated Generated Directory
+
+Pre-Build:  Web-UI komprimieren (compress_ui.py)
+Post-Build: komprimiertes OTA-Image firmware.bwz erzeugen (compress_ota.py)
 """
 
 import subprocess
@@ -44,6 +47,10 @@ def main():
     output_header = generated_dir / "index_html_gz.h"  # ← Im generated/ Unterordner!
     compress_script = project_dir / "scripts" / "compress_ui.py"
     build_hook_script = project_dir / "scripts" / "build_hook.py"
+    project_ini = project_dir / "platformio.ini"
+    
+    # Optionale Brotli-Variante (custom_ui_brotli = yes in platformio.ini)
+    use_brotli = env.GetProjectOption("custom_ui_brotli", "no").strip().lower() in ("yes", "true", "1")
     
     print(f"Project Dir:     {project_dir}")
     print(f"Build Dir:       {build_dir}")
@@ -52,6 +59,7 @@ def main():
     print(f"Input HTML:      {input_html}")
     print(f"Output Header:   {output_header}")
     print(f"Compress Script: {compress_script}")
+    print(f"Brotli Variant:  {'enabled' if use_brotli else 'disabled'}")
     print("")
     
     # Check if input file exists
@@ -79,6 +87,7 @@ def main():
         input_html,
         compress_script,
         build_hook_script,
+        project_ini,            # custom_ui_brotli geändert → neu generieren
     ]
     
     # Check if any source is missing
@@ -132,9 +141,13 @@ def main():
     print("Running UI compression...")
     print("")
     
+    compress_args = [sys.executable, str(compress_script), str(input_html), str(output_header)]
+    if use_brotli:
+        compress_args.append("--brotli")
+    
     try:
         result = subprocess.run(
-            [sys.executable, str(compress_script), str(input_html), str(output_header)],
+            compress_args,
             cwd=str(project_dir),
             check=True,
             capture_output=False,
@@ -181,4 +194,28 @@ def main():
         traceback.print_exc()
         env.Exit(1)
 
+def compress_firmware(source, target, env):
+    """Post-Action: firmware.bin → firmware.bwz (für POST /update)"""
+    project_dir = Path(env.subst("$PROJECT_DIR"))
+    compress_script = project_dir / "scripts" / "compress_ota.py"
+    firmware_bin = Path(str(target[0]))
+    firmware_bwz = firmware_bin.with_suffix(".bwz")
+    
+    print_section("BeltWinder Matter - Post-Build: Compressing OTA Image")
+    
+    try:
+        subprocess.run(
+            [sys.executable, str(compress_script), str(firmware_bin), str(firmware_bwz)],
+            cwd=str(project_dir),
+            check=True,
+        )
+    except subprocess.CalledProcessError as e:
+        # firmware.bin bleibt gültig - nur das komprimierte Image fehlt
+        print(f"WARNING: OTA image compression failed (return code {e.returncode})")
+        print("         Upload firmware.bin instead.")
+    
+    print("")
+
 main()
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.bin", compress_firmware)
@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+"""
+BeltWinder Matter - OTA Image Compression Script
+Packt firmware.bin in ein komprimiertes OTA-Image (.bwz) für POST /update
+
+Format (Little Endian, 48 Byte Header + Raw-Deflate-Stream):
+    0  char[4]   magic         "BWZ1"
+    4  uint8     version       1
+    5  uint8     algorithm     1 = Deflate (raw, ohne zlib-Header)
+    6  uint8     window_bits   Deflate-Fenster (Gerät: max. 13 = 8 KB)
+    7  uint8     reserved      0
+    8  uint32    raw_size      Größe von firmware.bin
+   12  uint32    packed_size   Größe des Deflate-Streams
+   16  uint8[32] raw_sha256    SHA-256 von firmware.bin
+
+Das Gerät entpackt beim Empfang mit dem tinfl aus dem ESP32-ROM und
+prüft Größe und SHA-256 des entpackten Images vor dem Umschalten.
+"""
+
+import hashlib
+import struct
+import sys
+import os
+import zlib
+
+MAGIC = b"BWZ1"
+VERSION = 1
+ALGO_DEFLATE = 1
+WINDOW_BITS = 13        # muss zu OTA_INFLATE_WINDOW_BITS in ota_stream.h passen
+HEADER_FORMAT = "<4sBBBBII32s"
+
+class Colors:
+    """ANSI Color Codes für schöne Ausgabe"""
+    OKGREEN = '\033[92m'
+    OKCYAN = '\033[96m'
+    FAIL = '\033[91m'
+    ENDC = '\033[0m'
+
+def print_success(text):
+    print(f"{Colors.OKGREEN}✓ {text}{Colors.ENDC}")
+
+def print_info(text):
+    print(f"{Colors.OKCYAN}→ {text}{Colors.ENDC}")
+
+def print_error(text):
+    print(f"{Colors.FAIL}✗ {text}{Colors.ENDC}")
+
+def pack_image(raw):
+    """Deflate (Level 9, kleines Fenster) + Header"""
+    if len(raw) == 0 or raw[0] != 0xE9:
+        raise ValueError("input is not an ESP32 firmware image (magic 0xE9 missing)")
+
+    compressor = zlib.compressobj(9, zlib.DEFLATED, -WINDOW_BITS, 9)
+    packed = compressor.compress(raw) + compressor.flush()
+
+    header = struct.pack(HEADER_FORMAT, MAGIC, VERSION, ALGO_DEFLATE, WINDOW_BITS, 0,
+                         len(raw), len(packed), hashlib.sha256(raw).digest())
+    return header + packed
+
+def verify_image(image, raw):
+    """Entpackt zur Kontrolle wieder (gleiche Fenstergröße wie das Gerät)"""
+    header_size = struct.calcsize(HEADER_FORMAT)
+    magic, _, _, window_bits, _, raw_size, packed_size, sha = \
+        struct.unpack(HEADER_FORMAT, image[:header_size])
+    unpacked = zlib.decompress(image[header_size:], -window_bits)
+    return (magic == MAGIC and raw_size == len(raw) and
+            packed_size == len(image) - header_size and
+            unpacked == raw and hashlib.sha256(unpacked).digest() == sha)
+
+def main():
+    if len(sys.argv) < 3:
+        print_error("Usage: python compress_ota.py <firmware.bin> <firmware.bwz>")
+        sys.exit(1)
+
+    input_file = sys.argv[1]
+    output_file = sys.argv[2]
+
+    print_info(f"Reading firmware from: {input_file}")
+    if not os.path.exists(input_file):
+        print_error(f"File not found: {input_file}")
+        sys.exit(1)
+
+    with open(input_file, 'rb') as f:
+        raw = f.read()
+
+    try:
+        image = pack_image(raw)
+    except ValueError as e:
+        print_error(str(e))
+        sys.exit(1)
+
+    if not verify_image(image, raw):
+        print_error("Verification of packed image failed")
+        sys.exit(1)
+
+    with open(output_file, 'wb') as f:
+        f.write(image)
+
+    ratio = (len(image) / len(raw)) * 100
+    print_success(f"Packed {len(raw):,} → {len(image):,} bytes ({ratio:.1f}%)")
+    print_info(f"SHA-256 (raw): {hashlib.sha256(raw).hexdigest()}")
+    print_info(f"Upload: {output_file}")
+
+if __name__ == "__main__":
+    main()
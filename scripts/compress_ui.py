@@ -2,9 +2,14 @@
 """
 BeltWinder Matter - Web UI GZIP Compression Script
 Komprimiert HTML/CSS/JS und generiert C-Header für ESP32
+
+Zusätzlich:
+- ETag aus SHA-256 des minifizierten HTML (für If-None-Match / 304)
+- Optional Brotli-Variante (--brotli, benötigt "pip install brotli")
 """
 
 import gzip
+import hashlib
 import sys
 import os
 from pathlib import Path
@@ -90,7 +95,8 @@ def compress_html(html):
     
     try:
         html_bytes = html.encode('utf-8')
-        compressed = gzip.compress(html_bytes, compresslevel=9)
+        # mtime=0: gleicher Input → identische Bytes (reproduzierbare Builds)
+        compressed = gzip.compress(html_bytes, compresslevel=9, mtime=0)
         
         original_size = len(html_bytes)
         compressed_size = len(compressed)
@@ -106,7 +112,50 @@ def compress_html(html):
         print_error(f"Compression failed: {e}")
         sys.exit(1)
 
-def generate_c_header(compressed_data, var_name="index_html_gz"):
+def compress_html_brotli(html):
+    """Komprimiert HTML mit Brotli (Quality 11) - None wenn Modul fehlt"""
+    print_info("Compressing with Brotli (quality 11)...")
+
+    try:
+        import brotli
+    except ImportError:
+        print_warning("Python module 'brotli' not installed - skipping Brotli variant")
+        print_info("Install with: pip install brotli")
+        return None
+
+    html_bytes = html.encode('utf-8')
+    compressed = brotli.compress(html_bytes, mode=brotli.MODE_TEXT, quality=11)
+
+    ratio = (len(compressed) / len(html_bytes)) * 100
+    print_success(f"Compressed to {len(compressed):,} bytes ({ratio:.1f}%)")
+
+    return compressed
+
+def compute_etag(html):
+    """ETag = erste 16 Hex-Zeichen des SHA-256 über das minifizierte HTML"""
+    digest = hashlib.sha256(html.encode('utf-8')).hexdigest()[:16]
+    print_info(f"Content hash (ETag): {digest}")
+    return digest
+
+def append_c_array(lines, data, var_name, comment):
+    """Hängt ein PROGMEM-Array plus _len an"""
+    lines.append(f"// {comment} ({len(data):,} bytes)")
+    lines.append(f"const uint8_t {var_name}[] PROGMEM = {{")
+
+    # 12 bytes per line for readability
+    bytes_per_line = 12
+    for i in range(0, len(data), bytes_per_line):
+        chunk = data[i:i+bytes_per_line]
+        hex_values = ', '.join(f'0x{b:02x}' for b in chunk)
+        lines.append(f"    {hex_values},")
+
+    lines.append("};")
+    lines.append("")
+    lines.append(f"const size_t {var_name}_len = sizeof({var_name});")
+    lines.append("")
+
+def generate_c_header(compressed_data, original_size, etag, brotli_data=None,
+                      var_name="index_html_gz"):
     """Generiert C-Header mit Array und Metadata"""
     print_info("Generating C header...")
     
@@ -127,24 +176,25 @@ def generate_c_header(compressed_data, var_name="index_html_gz"):
     # Metadata
     lines.append("// Metadata")
     lines.append(f"#define HTML_COMPRESSED_SIZE {len(compressed_data)}")
-    lines.append(f"#define HTML_COMPRESSION_RATIO {(len(compressed_data) / len(compressed_data)) * 100:.1f}")
+    lines.append(f"#define HTML_COMPRESSION_RATIO {(len(compressed_data) / original_size) * 100:.1f}")
     lines.append("")
-    
-    # Binary Array
-    lines.append(f"// Compressed HTML data ({len(compressed_data):,} bytes)")
-    lines.append(f"const uint8_t {var_name}[] PROGMEM = {{")
-    
-    # 12 bytes per line for readability
-    bytes_per_line = 12
-    for i in range(0, len(compressed_data), bytes_per_line):
-        chunk = compressed_data[i:i+bytes_per_line]
-        hex_values = ', '.join(f'0x{b:02x}' for b in chunk)
-        lines.append(f"    {hex_values},")
-    
-    lines.append("};")
-    lines.append("")
-    lines.append(f"const size_t {var_name}_len = sizeof({var_name});")
+
+    # ETag (Content-Hash, pro Encoding eindeutig)
+    lines.append("// Strong ETags - ändern sich nur, wenn sich das UI ändert")
+    lines.append(f"#define HTML_ETAG \"\\\"{etag}\\\"\"")
+    if brotli_data is not None:
+        lines.append(f"#define HTML_ETAG_BR \"\\\"{etag}-br\\\"\"")
     lines.append("")
+
+    # Binary Arrays
+    append_c_array(lines, compressed_data, var_name, "Compressed HTML data")
+
+    if brotli_data is not None:
+        lines.append("#define HTML_HAS_BROTLI 1")
+        lines.append(f"#define HTML_BROTLI_SIZE {len(brotli_data)}")
+        lines.append("")
+        append_c_array(lines, brotli_data, "index_html_br", "Brotli compressed HTML data")
+
     lines.append("#endif // INDEX_HTML_GZ_H")
     lines.append("")
     
@@ -174,13 +224,14 @@ def main():
     
     # Argument Parsing
     if len(sys.argv) < 3:
-        print_error("Usage: python compress_ui.py <input.html> <output.h> [--no-minify]")
+        print_error("Usage: python compress_ui.py <input.html> <output.h> [--no-minify] [--brotli]")
         print_info("Example: python compress_ui.py main/web_ui.html main/index_html_gz.h")
         sys.exit(1)
     
     input_file = sys.argv[1]
     output_file = sys.argv[2]
     enable_minify = "--no-minify" not in sys.argv
+    enable_brotli = "--brotli" in sys.argv
     
     # Step 1: Read HTML
     html = read_html_file(input_file)
@@ -191,9 +242,11 @@ def main():
     
     # Step 3: Compress
     compressed = compress_html(html)
+    brotli_data = compress_html_brotli(html) if enable_brotli else None
+    etag = compute_etag(html)
     
     # Step 4: Generate C Header
-    c_header = generate_c_header(compressed)
+    c_header = generate_c_header(compressed, len(html.encode('utf-8')), etag, brotli_data)
     
     # Step 5: Write Output
     write_output(output_file, c_header)
@@ -204,6 +257,9 @@ def main():
     print_info(f"Include in your code: #include \"{os.path.basename(output_file)}\"")
     print_info(f"Array name: index_html_gz")
     print_info(f"Array size: index_html_gz_len")
+    print_info(f"ETag: \"{etag}\"")
+    if brotli_data is not None:
+        print_info(f"Brotli array: index_html_br ({len(brotli_data):,} bytes)")
     print("")
 
 if __name__ == "__main__":
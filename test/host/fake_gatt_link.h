@@ -0,0 +1,235 @@
+// fake_gatt_link.h - GattLink ohne Radio für test_gatt_session.cpp
+//
+// FakeGattPeer beschreibt, wie sich das Gegenüber verhält (pro Connect-
+// Versuch, Bonding, Characteristics) und protokolliert die Aufrufe.
+// Ereignisse kommen synchron aus dem Aufruf oder - mit eventDelayMs -
+// aus einem eigenen Thread wie der NimBLE Host Task auf dem Gerät.
+
+#ifndef BW_FAKE_GATT_LINK_H
+#define BW_FAKE_GATT_LINK_H
+
+#pragma once
+
+#include "gatt_link.h"
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct FakeGattChar {
+    std::string service = "1234";
+    uint8_t props = GATT_PROP_READ | GATT_PROP_WRITE;
+    std::string value = "\x01";
+    int emptyReads = 0;             // so viele Reads liefern nichts
+    int rejectedWrites = 0;         // so viele Writes schlagen fehl (je Modus)
+    bool dropOnAccess = false;      // Peer trennt beim Zugriff
+    std::vector<std::string> written;
+};
+
+struct FakeGattPeer {
+    enum Connect { CONNECT_OK, CONNECT_FAIL, CONNECT_SILENT, CONNECT_NOT_STARTED };
+    enum Auth { AUTH_OK, AUTH_REJECTED, AUTH_SILENT, AUTH_DISCONNECT };
+
+    // Verhalten
+    std::vector<Connect> connects;          // pro Versuch, danach CONNECT_SILENT
+    bool sendMtu = true;
+    bool staleFailAfterCancel = false;      // Fail-Event des Abbruchs kommt erst im nächsten Versuch
+    bool peerStartsBonding = false;         // AUTH_DONE direkt nach dem Connect
+    Auth auth = AUTH_OK;
+    bool disconnectEvent = true;
+    uint32_t eventDelayMs = 0;              // > 0: Ereignisse asynchron
+    size_t services = 1;
+    std::map<std::string, FakeGattChar> chars;
+
+    // Protokoll
+    std::vector<uint8_t> connectTypes;
+    int linksCreated = 0;
+    int linksDeleted = 0;
+    int cancels = 0;
+    int secures = 0;
+    int disconnects = 0;
+    int reads = 0;
+    int writesWithResponse = 0;
+    int writesNoResponse = 0;
+};
+
+class FakeGattLink : public GattLink {
+public:
+    FakeGattLink(FakeGattPeer& peer, GattLinkListener& listener)
+        : peer_(peer), listener_(listener) {
+        peer_.linksCreated++;
+    }
+
+    ~FakeGattLink() override {
+        for (auto& t : threads_) {
+            t.join();
+        }
+        peer_.linksDeleted++;
+    }
+
+    static GattLinkFactory factory(FakeGattPeer& peer) {
+        return [&peer](GattLinkListener& listener) -> GattLink* {
+            return new FakeGattLink(peer, listener);
+        };
+    }
+
+    // ── GattLink ─────────────────────────────────────────────────────
+
+    bool connect(const char* address, uint8_t addressType, uint32_t timeoutMs) override {
+        size_t attempt = peer_.connectTypes.size();
+        peer_.connectTypes.push_back(addressType);
+        address_ = address;
+
+        FakeGattPeer::Connect result = attempt < peer_.connects.size()
+            ? peer_.connects[attempt] : FakeGattPeer::CONNECT_SILENT;
+        if (result == FakeGattPeer::CONNECT_NOT_STARTED) {
+            return false;
+        }
+
+        // Abbruch des vorigen Versuchs meldet sich erst jetzt
+        if (staleCancelPending_) {
+            staleCancelPending_ = false;
+            listener_.onLinkConnectFailed(0x202);
+        }
+
+        if (result == FakeGattPeer::CONNECT_OK) {
+            emit([this] {
+                connected_ = true;
+                listener_.onLinkConnected();
+                if (peer_.sendMtu) {
+                    listener_.onLinkMtu(185);
+                }
+                if (peer_.peerStartsBonding) {
+                    encrypted_ = true;
+                    listener_.onLinkAuthComplete(true, true);
+                }
+            });
+        } else if (result == FakeGattPeer::CONNECT_FAIL) {
+            emit([this] { listener_.onLinkConnectFailed(0x3E); });
+        }
+        return true;
+    }
+
+    void cancelConnect() override {
+        peer_.cancels++;
+        if (peer_.staleFailAfterCancel) {
+            staleCancelPending_ = true;
+        } else {
+            listener_.onLinkConnectFailed(0x202);
+        }
+    }
+
+    bool secure() override {
+        peer_.secures++;
+        switch (peer_.auth) {
+            case FakeGattPeer::AUTH_OK:
+                emit([this] {
+                    encrypted_ = true;
+                    listener_.onLinkAuthComplete(true, true);
+                });
+                break;
+            case FakeGattPeer::AUTH_REJECTED:
+                // z.B. falscher Passkey: Bonding endet ohne Verschlüsselung
+                emit([this] { listener_.onLinkAuthComplete(false, false); });
+                break;
+            case FakeGattPeer::AUTH_DISCONNECT:
+                emit([this] { drop(0x13); });
+                break;
+            case FakeGattPeer::AUTH_SILENT:
+                break;
+        }
+        return true;
+    }
+
+    void disconnect() override {
+        peer_.disconnects++;
+        connected_ = false;
+        if (peer_.disconnectEvent) {
+            emit([this] { listener_.onLinkDisconnected(address_, 0x16); });
+        }
+    }
+
+    bool isConnected() const override { return connected_; }
+    bool isEncrypted() const override { return connected_ && encrypted_; }
+    uint16_t mtu() const override { return connected_ ? 185 : 23; }
+    std::string peerAddress() const override { return address_; }
+
+    size_t discover() override {
+        return connected_ ? peer_.services : 0;
+    }
+
+    uint8_t properties(const char* uuid) override {
+        auto it = peer_.chars.find(uuid);
+        return it != peer_.chars.end() ? it->second.props : 0;
+    }
+
+    bool read(const char* uuid, std::string& value) override {
+        peer_.reads++;
+        FakeGattChar& ch = peer_.chars.at(uuid);
+        if (ch.dropOnAccess) {
+            drop(0x08);
+            return false;
+        }
+        if (ch.emptyReads > 0) {
+            ch.emptyReads--;
+            value.clear();
+            return false;
+        }
+        value = ch.value;
+        return true;
+    }
+
+    bool write(const char* uuid, const uint8_t* data, size_t length, bool response) override {
+        (response ? peer_.writesWithResponse : peer_.writesNoResponse)++;
+        FakeGattChar& ch = peer_.chars.at(uuid);
+        if (ch.dropOnAccess) {
+            drop(0x08);
+            return false;
+        }
+        if (ch.rejectedWrites > 0) {
+            ch.rejectedWrites--;
+            return false;
+        }
+        ch.written.emplace_back((const char*)data, length);
+        return true;
+    }
+
+    void visit(const GattCharVisitor& visitor) override {
+        for (const auto& entry : peer_.chars) {
+            visitor(entry.second.service, entry.first, entry.second.props);
+        }
+    }
+
+    // Peer trennt (Reboot, Reichweite)
+    void drop(int reason) {
+        connected_ = false;
+        listener_.onLinkDisconnected(address_, reason);
+    }
+
+private:
+    void emit(std::function<void()> event) {
+        if (peer_.eventDelayMs == 0) {
+            event();
+            return;
+        }
+        uint32_t delayMs = peer_.eventDelayMs;
+        threads_.emplace_back([event, delayMs] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+            event();
+        });
+    }
+
+    FakeGattPeer& peer_;
+    GattLinkListener& listener_;
+    std::string address_;
+    std::vector<std::thread> threads_;
+    volatile bool connected_ = false;
+    volatile bool encrypted_ = false;
+    bool staleCancelPending_ = false;
+};
+
+#endif // BW_FAKE_GATT_LINK_H
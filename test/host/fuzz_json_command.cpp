@@ -0,0 +1,238 @@
+// fuzz_json_command.cpp
+//
+// Fuzz-Target für JsonCommand (main/json_command.cpp), den In-Place-Tokenizer
+// der WebSocket-Kommandos.
+//
+//   libFuzzer (clang):  cmake -S test/host -B build-fuzz -DBW_HOST_FUZZ=ON \
+//                             -DCMAKE_CXX_COMPILER=clang++
+//                       build-fuzz/fuzz_json_command -max_len=512
+//   ctest:              eigener Treiber, mutiert deterministisch die Seeds
+//                       unten (Argument: Anzahl Iterationen, oder Dateien)
+//
+// Geprüft wird neben "kein Absturz / kein ASan-Fund":
+//   - alle Accessoren liefern Zeiger innerhalb des Puffers
+//   - der Token-Pool wird nach jedem Frame wieder frei
+//   - parse() liest/schreibt nie hinter len
+//   - json_escape() + parse() ergibt wieder den Eingabetext, auch gekürzt
+
+#include "json_command.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FUZZ_FRAME_MAX  512     // WS_FRAME_MAX in web_ui_handler.cpp
+
+static const char* const fuzz_keys[] = {
+    "cmd", "address", "passkey", "bindkey", "room", "type", "position",
+    "enabled", "value", "", "missing"
+};
+
+static void fuzz_fail(const char* what) {
+    fprintf(stderr, "fuzz_json_command: %s\n", what);
+    abort();
+}
+
+static void fuzz_check_ptr(const char* p, const char* buf, size_t len) {
+    if (p && (p < buf || p > buf + len)) {
+        fuzz_fail("accessor points outside the buffer");
+    }
+}
+
+static void fuzz_one(const uint8_t* data, size_t size) {
+    if (size > FUZZ_FRAME_MAX) {
+        return;             // ws_handler nimmt größere Frames nicht an
+    }
+
+    // Exakt große Kopie mit Wächter dahinter: ASan meldet Zugriffe hinter len
+    char* buf = (char*)malloc(size + 1);
+    memcpy(buf, data, size);
+    buf[size] = '\0';
+
+    {
+        JsonCommand json;
+        if (json.parse(buf, size)) {
+            for (const char* key : fuzz_keys) {
+                fuzz_check_ptr(json.getString(key), buf, size);
+                int32_t v = 0;
+                bool ok = json.readInt(key, v);
+                if (ok && json.getInt(key, v ^ 1) != v) {
+                    fuzz_fail("getInt disagrees with readInt");
+                }
+                (void)json.getUInt(key, 0);
+                (void)json.getBool(key, false);
+                if (json.isNull(key) && !json.has(key)) {
+                    fuzz_fail("isNull without has");
+                }
+            }
+        } else if (!json.error()) {
+            fuzz_fail("parse failed without error()");
+        }
+    }
+
+    // Pool muss wieder frei sein
+    {
+        char probe[] = "{\"cmd\":\"status\"}";
+        JsonCommand next;
+        if (!next.parse(probe, strlen(probe)) || strcmp(next.getString("cmd", ""), "status") != 0) {
+            fuzz_fail("token pool not released");
+        }
+    }
+
+    free(buf);
+
+    // Rückweg: Eingabe (bis zur ersten 0) escapen, als Wert parsen
+    char text[FUZZ_FRAME_MAX + 1];
+    memcpy(text, data, size);
+    text[size] = '\0';
+    size_t textLen = strlen(text);
+
+    static const size_t limits[] = { 6 * FUZZ_FRAME_MAX + 1, 17, 2, 1 };
+    for (size_t limit : limits) {
+        char escaped[6 * FUZZ_FRAME_MAX + 1];
+        size_t n = json_escape(escaped, limit, text);
+        if (n >= limit || escaped[n] != '\0') {
+            fuzz_fail("json_escape overflow");
+        }
+
+        char frame[sizeof(escaped) + 16];
+        int len = snprintf(frame, sizeof(frame), "{\"k\":\"%s\"}", escaped);
+        JsonCommand round;
+        if (!round.parse(frame, (size_t)len)) {
+            fuzz_fail("escaped string does not parse");
+        }
+        const char* value = round.getString("k", "");
+        size_t valueLen = strlen(value);
+        if (valueLen > textLen || memcmp(value, text, valueLen) != 0 ||
+            (limit > 6 * textLen && valueLen != textLen)) {
+            fuzz_fail("json_escape round trip mismatch");
+        }
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    fuzz_one(data, size);
+    return 0;
+}
+
+#ifndef BW_LIBFUZZER
+
+// ═══════════════════════════════════════════════════════════════════════
+// Standalone-Treiber (ctest)
+// ═══════════════════════════════════════════════════════════════════════
+
+static const char* const fuzz_seeds[] = {
+    "{\"cmd\":\"status\"}",
+    "{\"cmd\":\"ble_pair\",\"address\":\"aa:bb:cc:dd:ee:ff\"}",
+    "{\"cmd\":\"ble_smart_connect\",\"address\":\"AA:BB:CC:DD:EE:FF\",\"passkey\":\"123456\"}",
+    "{\"cmd\":\"ble_encrypt\",\"address\":\"aa:bb:cc:dd:ee:ff\",\"passkey\":123456}",
+    "{\"cmd\":\"save_device_name\",\"room\":\"K\\u00fcche\",\"type\":\"Rollo\",\"position\":\"links\"}",
+    "{\"cmd\":\"window_logic_save\",\"enabled\":true,\"value\":-12.5e+1,\"x\":null}",
+    "{\"cmd\":\"button_binding_save\",\"bindings\":[{\"a\":1},{\"b\":[2,3,[4]]}],\"n\":{}}",
+    "{\"a\":\"\\\"\\\\\\/\\b\\f\\n\\r\\t\"}",
+    "  {  \"cmd\" : \"up\" }  ",
+    "{}",
+    "[1,2]",
+    "{\"cmd\":\"\\ud83d\"}",
+};
+
+static uint32_t fuzz_rng = 0x2545F491u;
+
+static uint32_t fuzz_next() {
+    fuzz_rng ^= fuzz_rng << 13;
+    fuzz_rng ^= fuzz_rng >> 17;
+    fuzz_rng ^= fuzz_rng << 5;
+    return fuzz_rng;
+}
+
+// Zeichen, die den Tokenizer in möglichst viele Zweige bringen
+static const char fuzz_alphabet[] = "{}[]:,\"\\ -+.0123456789eEtrufalsnu\t\r\n\x01\x7f\xc3";
+
+static size_t fuzz_mutate(uint8_t* buf, size_t len, size_t max) {
+    unsigned rounds = 1 + fuzz_next() % 4;
+    for (unsigned r = 0; r < rounds; r++) {
+        uint8_t c = (fuzz_next() & 1)
+            ? (uint8_t)fuzz_alphabet[fuzz_next() % (sizeof(fuzz_alphabet) - 1)]
+            : (uint8_t)fuzz_next();
+        size_t at = len ? fuzz_next() % len : 0;
+
+        switch (fuzz_next() % 5) {
+            case 0:                                         // ersetzen
+                if (len) buf[at] = c;
+                break;
+            case 1:                                         // einfügen
+                if (len < max) {
+                    memmove(buf + at + 1, buf + at, len - at);
+                    buf[at] = c;
+                    len++;
+                }
+                break;
+            case 2:                                         // löschen
+                if (len) {
+                    memmove(buf + at, buf + at + 1, len - at - 1);
+                    len--;
+                }
+                break;
+            case 3:                                         // abschneiden
+                len = at;
+                break;
+            default: {                                      // Block duplizieren
+                size_t n = 1 + fuzz_next() % 16;
+                if (at + n > len) n = len - at;
+                if (len + n <= max) {
+                    memmove(buf + at + n, buf + at, len - at);
+                    len += n;
+                }
+                break;
+            }
+        }
+    }
+    return len;
+}
+
+static int fuzz_file(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return 1;
+    }
+    uint8_t buf[FUZZ_FRAME_MAX];
+    size_t n = fread(buf, 1, sizeof(buf), f);
+    fclose(f);
+    fuzz_one(buf, n);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    unsigned long iterations = 200000;
+    if (argc > 1) {
+        char* end = nullptr;
+        unsigned long n = strtoul(argv[1], &end, 10);
+        if (*end != '\0') {
+            int rc = 0;
+            for (int i = 1; i < argc; i++) rc |= fuzz_file(argv[i]);
+            return rc;
+        }
+        iterations = n;
+    }
+
+    const size_t seedCount = sizeof(fuzz_seeds) / sizeof(fuzz_seeds[0]);
+    for (size_t i = 0; i < seedCount; i++) {
+        fuzz_one((const uint8_t*)fuzz_seeds[i], strlen(fuzz_seeds[i]));
+    }
+
+    uint8_t buf[FUZZ_FRAME_MAX];
+    for (unsigned long i = 0; i < iterations; i++) {
+        const char* seed = fuzz_seeds[fuzz_next() % seedCount];
+        size_t len = strlen(seed);
+        memcpy(buf, seed, len);
+        len = fuzz_mutate(buf, len, sizeof(buf));
+        fuzz_one(buf, len);
+    }
+
+    printf("fuzz_json_command: %zu seeds, %lu mutations ok\n", seedCount, iterations);
+    return 0;
+}
+
+#endif // BW_LIBFUZZER
@@ -0,0 +1,64 @@
+// host_test.h - Minimal-Harness für die Host-Tests (test/host)
+//
+// Jede Datei test_*.cpp ist ein eigenes Executable (siehe CMakeLists.txt);
+// main() und die Log-Schwelle der ESP_LOG-Shims liefert host_test_main.cpp.
+
+#ifndef BW_HOST_TEST_H
+#define BW_HOST_TEST_H
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+struct HostTestCase {
+    const char* name;
+    void (*fn)();
+    HostTestCase* next;
+};
+
+// Registrierung per statischem Objekt (TEST_CASE)
+void hostTestRegister(HostTestCase* tc);
+// Fehlgeschlagene CHECKs im laufenden Test
+void hostTestFail(const char* file, int line, const char* expr);
+
+struct HostTestRegistrar {
+    HostTestCase tc;
+    HostTestRegistrar(const char* name, void (*fn)()) : tc{name, fn, nullptr} {
+        hostTestRegister(&tc);
+    }
+};
+
+#define TEST_CASE(name) \
+    static void name(); \
+    static HostTestRegistrar name##_registrar(#name, name); \
+    static void name()
+
+#define CHECK(expr) do { \
+        if (!(expr)) hostTestFail(__FILE__, __LINE__, #expr); \
+    } while (0)
+
+#define CHECK_EQ(a, b) do { \
+        long long _a = (long long)(a), _b = (long long)(b); \
+        if (_a != _b) { \
+            char _msg[160]; \
+            snprintf(_msg, sizeof(_msg), "%s == %s (%lld != %lld)", #a, #b, _a, _b); \
+            hostTestFail(__FILE__, __LINE__, _msg); \
+        } \
+    } while (0)
+
+#define CHECK_STR(a, b) do { \
+        const char* _a = (a); const char* _b = (b); \
+        if (!_a || !_b || strcmp(_a, _b) != 0) { \
+            char _msg[160]; \
+            snprintf(_msg, sizeof(_msg), "%s == \"%s\" (got \"%s\")", #a, \
+                     _b ? _b : "(null)", _a ? _a : "(null)"); \
+            hostTestFail(__FILE__, __LINE__, _msg); \
+        } \
+    } while (0)
+
+// "44 00 2A" → Bytes; liefert die Anzahl
+size_t hostTestHex(const char* hex, uint8_t* out, size_t max);
+
+#endif // BW_HOST_TEST_H
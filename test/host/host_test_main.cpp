@@ -0,0 +1,68 @@
+// host_test_main.cpp - Runner für die Host-Tests (test/host)
+
+#include "host_test.h"
+
+#include <cstdlib>
+#include <esp_log.h>
+
+// Log-Schwelle der ESP_LOG-Shims, BW_LOG_LEVEL=0..5 (Default: aus)
+int bw_replay_log_level = ESP_LOG_NONE;
+
+static HostTestCase* testHead = nullptr;
+static HostTestCase** testTail = &testHead;
+static int currentFailures = 0;
+
+void hostTestRegister(HostTestCase* tc) {
+    *testTail = tc;
+    testTail = &tc->next;
+}
+
+void hostTestFail(const char* file, int line, const char* expr) {
+    fprintf(stderr, "    %s:%d: CHECK(%s) failed\n", file, line, expr);
+    currentFailures++;
+}
+
+size_t hostTestHex(const char* hex, uint8_t* out, size_t max) {
+    size_t count = 0;
+    while (*hex && count < max) {
+        if (*hex == ' ' || *hex == ':') {
+            hex++;
+            continue;
+        }
+        unsigned value = 0;
+        if (sscanf(hex, "%2x", &value) != 1) {
+            break;
+        }
+        out[count++] = (uint8_t)value;
+        hex += 2;
+    }
+    return count;
+}
+
+int main(int argc, char** argv) {
+    const char* level = getenv("BW_LOG_LEVEL");
+    if (level) {
+        bw_replay_log_level = atoi(level);
+    }
+
+    // Optional: nur Tests, deren Name argv[1] enthält
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+    int run = 0;
+    int failed = 0;
+
+    for (HostTestCase* tc = testHead; tc; tc = tc->next) {
+        if (filter && !strstr(tc->name, filter)) {
+            continue;
+        }
+        currentFailures = 0;
+        tc->fn();
+        run++;
+        printf("[%s] %s\n", currentFailures ? "FAIL" : " OK ", tc->name);
+        if (currentFailures) {
+            failed++;
+        }
+    }
+
+    printf("%d/%d passed\n", run - failed, run);
+    return failed ? 1 : 0;
+}
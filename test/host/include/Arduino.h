@@ -0,0 +1,40 @@
+// Arduino.h - Host-Shim für test/host
+//
+// Nur String und millis(), soweit die getesteten Module sie brauchen.
+
+#ifndef BW_HOST_ARDUINO_H
+#define BW_HOST_ARDUINO_H
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <strings.h>
+
+inline uint32_t millis() {
+    using namespace std::chrono;
+    static const steady_clock::time_point start = steady_clock::now();
+    return (uint32_t)duration_cast<milliseconds>(steady_clock::now() - start).count();
+}
+
+class String {
+public:
+    String() {}
+    String(const char* s) : s_(s ? s : "") {}
+    String(const std::string& s) : s_(s) {}
+
+    const char* c_str() const { return s_.c_str(); }
+    size_t length() const { return s_.size(); }
+    bool isEmpty() const { return s_.empty(); }
+    bool equalsIgnoreCase(const String& other) const {
+        return strcasecmp(s_.c_str(), other.s_.c_str()) == 0;
+    }
+    bool operator==(const String& other) const { return s_ == other.s_; }
+    bool operator!=(const String& other) const { return s_ != other.s_; }
+
+private:
+    std::string s_;
+};
+
+#endif // BW_HOST_ARDUINO_H
@@ -0,0 +1,29 @@
+// freertos/FreeRTOS.h - Host-Shim für test/host (1 Tick = 1 ms)
+
+#ifndef BW_HOST_FREERTOS_H
+#define BW_HOST_FREERTOS_H
+
+#pragma once
+
+#include <cstdint>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+
+#define pdFALSE 0
+#define pdTRUE  1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portMAX_DELAY     ((TickType_t)0xFFFFFFFF)
+
+#ifndef BIT0
+#define BIT0 0x00000001
+#define BIT1 0x00000002
+#define BIT2 0x00000004
+#define BIT3 0x00000008
+#define BIT4 0x00000010
+#define BIT5 0x00000020
+#define BIT6 0x00000040
+#define BIT7 0x00000080
+#endif
+
+#endif // BW_HOST_FREERTOS_H
@@ -0,0 +1,71 @@
+// freertos/event_groups.h - Host-Shim für test/host
+//
+// Event Group über mutex + condition_variable; Callbacks dürfen wie auf dem
+// Gerät aus einem anderen Thread setzen.
+
+#ifndef BW_HOST_EVENT_GROUPS_H
+#define BW_HOST_EVENT_GROUPS_H
+
+#pragma once
+
+#include "FreeRTOS.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+typedef uint32_t EventBits_t;
+
+struct HostEventGroup {
+    std::mutex lock;
+    std::condition_variable changed;
+    EventBits_t bits = 0;
+};
+
+typedef HostEventGroup* EventGroupHandle_t;
+
+inline EventGroupHandle_t xEventGroupCreate() {
+    return new HostEventGroup();
+}
+
+inline void vEventGroupDelete(EventGroupHandle_t group) {
+    delete group;
+}
+
+inline EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> guard(group->lock);
+    group->bits |= bits;
+    group->changed.notify_all();
+    return group->bits;
+}
+
+inline EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> guard(group->lock);
+    EventBits_t before = group->bits;
+    group->bits &= ~bits;
+    return before;
+}
+
+inline EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+    std::lock_guard<std::mutex> guard(group->lock);
+    return group->bits;
+}
+
+inline EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits,
+                                       BaseType_t clearOnExit, BaseType_t waitForAll,
+                                       TickType_t ticks) {
+    std::unique_lock<std::mutex> guard(group->lock);
+    auto done = [&] {
+        EventBits_t set = group->bits & bits;
+        return waitForAll ? set == bits : set != 0;
+    };
+    group->changed.wait_for(guard, std::chrono::milliseconds(ticks), done);
+
+    EventBits_t result = group->bits;
+    if (clearOnExit && done()) {
+        group->bits &= ~bits;
+    }
+    return result;
+}
+
+#endif // BW_HOST_EVENT_GROUPS_H
@@ -0,0 +1,71 @@
+// miniz.h - Host-Shim für test/host
+//
+// tinfl-API wie im ESP32-ROM, intern zlib (Raw-Inflate). Nachgebildet
+// wird nur der Modus, den ota_stream.cpp nutzt: Raw-Deflate in einen
+// Ringpuffer (ohne TINFL_FLAG_PARSE_ZLIB_HEADER und
+// TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF).
+//
+// tinfl liest Rückverweise aus dem Ringpuffer des Aufrufers, zlib aus
+// einem eigenen Fenster. Damit ein Fehler im Ring-Handling des Aufrufers
+// trotzdem auffällt, prüft der Shim bei jedem Aufruf den tinfl-Vertrag
+// und bricht mit abort() ab:
+//   - Ringgröße (pOut_buf_next - pOut_buf_start + *pOut_buf_size) ist
+//     eine Zweierpotenz und ändert sich nicht
+//   - pOut_buf_next setzt genau hinter der letzten Ausgabe fort
+//   - der Ring enthält unverändert die letzten Ausgabe-Bytes
+// Das zlib-Fenster ist so groß wie der Ring: Rückverweise, die weiter
+// zurückreichen, scheitern wie auf dem Gerät (dort mit falschen Daten).
+
+#ifndef BW_HOST_MINIZ_H
+#define BW_HOST_MINIZ_H
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zlib.h>
+
+typedef uint8_t mz_uint8;
+typedef uint32_t mz_uint32;
+typedef unsigned int mz_uint;
+
+#define TINFL_LZ_DICT_SIZE      32768
+#define TINFL_HOST_ARENA        49152   // inflate_state + 32 KB Fenster
+
+enum {
+    TINFL_FLAG_PARSE_ZLIB_HEADER = 1,
+    TINFL_FLAG_HAS_MORE_INPUT = 2,
+    TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF = 4,
+    TINFL_FLAG_COMPUTE_ADLER32 = 8
+};
+
+typedef enum {
+    TINFL_STATUS_BAD_PARAM = -3,
+    TINFL_STATUS_ADLER32_MISMATCH = -2,
+    TINFL_STATUS_FAILED = -1,
+    TINFL_STATUS_DONE = 0,
+    TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+    TINFL_STATUS_HAS_MORE_OUTPUT = 2
+} tinfl_status;
+
+struct tinfl_decompressor_tag {
+    mz_uint32 m_state;          // 0 = tinfl_init(), 1 = läuft, 2 = fertig, 3 = Fehler
+    z_stream m_zs;
+    size_t m_ring;
+    size_t m_ofs;               // erwartetes pOut_buf_next - pOut_buf_start
+    size_t m_produced;
+    size_t m_arenaUsed;         // zlib-Speicher kommt aus m_arena (kein Leak ohne tinfl_free)
+    mz_uint8 m_shadow[TINFL_LZ_DICT_SIZE];
+    alignas(16) mz_uint8 m_arena[TINFL_HOST_ARENA];
+};
+
+typedef struct tinfl_decompressor_tag tinfl_decompressor;
+
+#define tinfl_init(r) do { (r)->m_state = 0; } while (0)
+
+tinfl_status tinfl_decompress(tinfl_decompressor* r,
+                              const mz_uint8* pIn_buf_next, size_t* pIn_buf_size,
+                              mz_uint8* pOut_buf_start, mz_uint8* pOut_buf_next,
+                              size_t* pOut_buf_size, const mz_uint32 decomp_flags);
+
+#endif // BW_HOST_MINIZ_H
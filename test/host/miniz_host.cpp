@@ -0,0 +1,114 @@
+// miniz_host.cpp - tinfl_decompress() auf zlib (siehe include/miniz.h)
+
+#include <miniz.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static void tinfl_host_violation(const char* what) {
+    fprintf(stderr, "miniz shim: %s\n", what);
+    abort();
+}
+
+static voidpf tinfl_host_alloc(voidpf opaque, uInt items, uInt size) {
+    tinfl_decompressor* r = static_cast<tinfl_decompressor*>(opaque);
+    size_t n = ((size_t)items * size + 15) & ~(size_t)15;
+    if (n > sizeof(r->m_arena) - r->m_arenaUsed) return Z_NULL;
+    voidpf p = r->m_arena + r->m_arenaUsed;
+    r->m_arenaUsed += n;
+    return p;
+}
+
+static void tinfl_host_free(voidpf, voidpf) {
+}
+
+static tinfl_status tinfl_host_end(tinfl_decompressor* r, mz_uint32 state, tinfl_status status) {
+    inflateEnd(&r->m_zs);
+    r->m_state = state;
+    return status;
+}
+
+tinfl_status tinfl_decompress(tinfl_decompressor* r,
+                              const mz_uint8* pIn_buf_next, size_t* pIn_buf_size,
+                              mz_uint8* pOut_buf_start, mz_uint8* pOut_buf_next,
+                              size_t* pOut_buf_size, const mz_uint32 decomp_flags) {
+    size_t inSize = *pIn_buf_size;
+    size_t outSize = *pOut_buf_size;
+    *pIn_buf_size = 0;
+    *pOut_buf_size = 0;
+
+    if (decomp_flags & (TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF |
+                        TINFL_FLAG_COMPUTE_ADLER32)) {
+        tinfl_host_violation("only raw deflate into a wrapping buffer is emulated");
+    }
+
+    // Wie tinfl: Ringgröße muss eine Zweierpotenz sein
+    if (pOut_buf_next < pOut_buf_start) return TINFL_STATUS_BAD_PARAM;
+    size_t ring = (size_t)(pOut_buf_next - pOut_buf_start) + outSize;
+    if (ring < 512 || ring > TINFL_LZ_DICT_SIZE || (ring & (ring - 1)) != 0) {
+        return TINFL_STATUS_BAD_PARAM;
+    }
+
+    if (r->m_state == 0) {
+        int bits = 0;
+        while (((size_t)1 << bits) < ring) bits++;
+
+        memset(&r->m_zs, 0, sizeof(r->m_zs));
+        r->m_zs.zalloc = tinfl_host_alloc;
+        r->m_zs.zfree = tinfl_host_free;
+        r->m_zs.opaque = r;
+        r->m_arenaUsed = 0;
+        if (inflateInit2(&r->m_zs, -bits) != Z_OK) {
+            tinfl_host_violation("inflateInit2 failed");
+        }
+        r->m_ring = ring;
+        r->m_ofs = 0;
+        r->m_produced = 0;
+        r->m_state = 1;
+    } else if (r->m_state == 2) {
+        return TINFL_STATUS_DONE;
+    } else if (r->m_state != 1) {
+        return TINFL_STATUS_FAILED;
+    }
+
+    // tinfl-Vertrag des Aufrufers
+    if (ring != r->m_ring) {
+        tinfl_host_violation("ring buffer size changed between calls");
+    }
+    if ((size_t)(pOut_buf_next - pOut_buf_start) != r->m_ofs) {
+        tinfl_host_violation("pOut_buf_next does not continue the previous output");
+    }
+    size_t history = r->m_produced < ring ? r->m_produced : ring;
+    if (memcmp(pOut_buf_start, r->m_shadow, history) != 0) {
+        tinfl_host_violation("ring buffer modified between calls");
+    }
+
+    r->m_zs.next_in = const_cast<mz_uint8*>(pIn_buf_next);
+    r->m_zs.avail_in = (uInt)inSize;
+    r->m_zs.next_out = pOut_buf_next;
+    r->m_zs.avail_out = (uInt)outSize;
+    int rc = inflate(&r->m_zs, Z_NO_FLUSH);
+
+    size_t consumed = inSize - r->m_zs.avail_in;
+    size_t produced = outSize - r->m_zs.avail_out;
+    memcpy(r->m_shadow + r->m_ofs, pOut_buf_next, produced);
+    r->m_ofs = (r->m_ofs + produced) & (ring - 1);
+    r->m_produced += produced;
+    *pIn_buf_size = consumed;
+    *pOut_buf_size = produced;
+
+    if (rc == Z_STREAM_END) {
+        return tinfl_host_end(r, 2, TINFL_STATUS_DONE);
+    }
+    if (rc != Z_OK && rc != Z_BUF_ERROR) {
+        return tinfl_host_end(r, 3, TINFL_STATUS_FAILED);
+    }
+    if (r->m_zs.avail_out == 0) {
+        return TINFL_STATUS_HAS_MORE_OUTPUT;
+    }
+    if (decomp_flags & TINFL_FLAG_HAS_MORE_INPUT) {
+        return TINFL_STATUS_NEEDS_MORE_INPUT;
+    }
+    return tinfl_host_end(r, 3, TINFL_STATUS_FAILED);
+}
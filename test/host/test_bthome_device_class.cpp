@@ -0,0 +1,269 @@
+// test_bthome_device_class.cpp - Objekt-Tabelle und Geräteklassen
+//
+// Payloads aus Captures (scripts/ble_replay.py --log-level 4), jeweils die
+// BTHome Service Data (UUID 0xFCD2) inkl. DevInfo-Byte.
+
+#include "host_test.h"
+#include "bthome_device_class.h"
+#include "bthome_packet.h"
+
+// Service Data hex → Objekte hinter dem DevInfo-Byte dekodieren
+static bool decode(const char* hex, ShellyBLESensorData& out) {
+    uint8_t buf[64];
+    size_t len = hostTestHex(hex, buf, sizeof(buf));
+    return bthomeDecodeObjects(buf + 1, len - 1, out);
+}
+
+static const BTHomeDeviceClass* match(const char* name, const char* hex) {
+    uint8_t buf[64];
+    size_t len = hex ? hostTestHex(hex, buf, sizeof(buf)) : 0;
+    return bthomeMatchDeviceClass(name, hex ? buf : nullptr, len);
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// Objekt-Tabelle
+// ═══════════════════════════════════════════════════════════════════════
+
+TEST_CASE(object_table_sorted_and_searchable) {
+    // Binärsuche setzt eine sortierte Tabelle voraus
+    int last = -1;
+    int found = 0;
+    for (int id = 0; id < 256; id++) {
+        const BTHomeObjectDef* def = bthomeObjectDef((uint8_t)id);
+        if (def) {
+            CHECK_EQ(def->id, id);
+            CHECK(def->id > last);
+            CHECK(def->length >= 1 && def->length <= 4);
+            CHECK(def->divisor >= 1);
+            last = def->id;
+            found++;
+        }
+    }
+    CHECK(found > 10);
+    CHECK(bthomeObjectDef(0x04) == nullptr);
+    CHECK(bthomeObjectDef(0xFF) == nullptr);
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// bthomeDecodeObjects
+// ═══════════════════════════════════════════════════════════════════════
+
+TEST_CASE(door_window_full_packet) {
+    // SBDW-002C: Packet ID 42, 100 %, 10.00 lx, offen, Rotation -90.5°
+    ShellyBLESensorData sd;
+    CHECK(decode("44 00 2A 01 64 05 E8 03 00 2D 01 3F 77 FC", sd));
+
+    CHECK_EQ(sd.packetId, 42);
+    CHECK_EQ(sd.battery, 100);
+    CHECK_EQ(sd.illuminance, 10);
+    CHECK(sd.windowOpen);
+    CHECK_EQ(sd.rotation, -90);         // -905 / 10, Sign-Extend 0x3F
+    CHECK_EQ(sd.fields, BTHOME_FIELD_PACKET_ID | BTHOME_FIELD_BATTERY |
+                        BTHOME_FIELD_ILLUMINANCE | BTHOME_FIELD_WINDOW |
+                        BTHOME_FIELD_ROTATION);
+    CHECK(!sd.hasButtonEvent);
+}
+
+TEST_CASE(rotation_sign_extension) {
+    ShellyBLESensorData sd;
+    CHECK(decode("44 3F 84 03", sd));   // +900 → 90°
+    CHECK_EQ(sd.rotation, 90);
+    CHECK(decode("44 3F 7C FC", sd));   // -900 → -90°
+    CHECK_EQ(sd.rotation, -90);
+    CHECK(decode("44 3F FF FF", sd));   // -1 → 0 (Ganzzahl-Division)
+    CHECK_EQ(sd.rotation, 0);
+    CHECK(decode("44 3F 00 80", sd));   // -32768 → -3276
+    CHECK_EQ(sd.rotation, -3276);
+}
+
+TEST_CASE(temperature_sign_extension_and_divisors) {
+    ShellyBLESensorData sd;
+
+    // 0x45: sint16, 0.1 °C, Divisor 1
+    CHECK(decode("44 45 38 FF", sd));   // -200 → -20.0 °C
+    CHECK_EQ(sd.temperature, -200);
+    CHECK(decode("44 45 E7 00", sd));   // 231 → 23.1 °C
+    CHECK_EQ(sd.temperature, 231);
+
+    // 0x02: sint16, 0.01 °C → 0.1 °C (Divisor 10)
+    CHECK(decode("44 02 30 F8", sd));   // -2000 → -200
+    CHECK_EQ(sd.temperature, -200);
+    CHECK(decode("44 02 06 09", sd));   // 2310 → 231
+    CHECK_EQ(sd.temperature, 231);
+
+    // 0x03: uint16, 0.01 % → % (Divisor 100); 0x2E: uint8 %
+    CHECK(decode("44 03 BF 13", sd));   // 5055 → 50
+    CHECK_EQ(sd.humidity, 50);
+    CHECK(decode("44 2E 37", sd));
+    CHECK_EQ(sd.humidity, 55);
+
+    // 0x05: uint24, 0.01 lx → lx; höchstes Bit ist kein Vorzeichen
+    CHECK(decode("44 05 FF FF FF", sd));
+    CHECK_EQ(sd.illuminance, 0xFFFFFF / 100);
+    CHECK_EQ(sd.fields, BTHOME_FIELD_ILLUMINANCE);
+}
+
+TEST_CASE(ht_packet_with_device_type) {
+    // SBHT-003C: Batterie 87 %, 21.5 °C, 48 %, Device Type 0x0003
+    ShellyBLESensorData sd;
+    CHECK(decode("44 00 11 01 57 2E 30 45 D7 00 F0 03 00", sd));
+    CHECK_EQ(sd.packetId, 0x11);
+    CHECK_EQ(sd.battery, 87);
+    CHECK_EQ(sd.humidity, 48);
+    CHECK_EQ(sd.temperature, 215);
+    CHECK_EQ(sd.deviceTypeId, 0x0003);
+    CHECK(sd.fields & BTHOME_FIELD_DEVICE_TYPE);
+}
+
+TEST_CASE(button_events) {
+    ShellyBLESensorData sd;
+
+    CHECK(decode("44 00 05 01 64 3A 01", sd));
+    CHECK(sd.hasButtonEvent);
+    CHECK_EQ(sd.buttonEvent, BUTTON_SINGLE_PRESS);
+
+    CHECK(decode("44 00 06 3A 04", sd));
+    CHECK_EQ(sd.buttonEvent, BUTTON_LONG_PRESS);
+
+    // 0x80 = Hold → eigener Enum-Wert (nicht 0x80 durchreichen)
+    CHECK(decode("44 00 07 3A 80", sd));
+    CHECK(sd.hasButtonEvent);
+    CHECK_EQ(sd.buttonEvent, BUTTON_HOLD);
+    CHECK(sd.fields & BTHOME_FIELD_BUTTON);
+
+    // 0x00 = Heartbeat ohne Event: Feld bleibt ungesetzt
+    CHECK(decode("44 00 08 01 64 3A 00", sd));
+    CHECK(!sd.hasButtonEvent);
+    CHECK(!(sd.fields & BTHOME_FIELD_BUTTON));
+}
+
+TEST_CASE(decode_resets_previous_packet) {
+    ShellyBLESensorData sd;
+    CHECK(decode("44 3A 02", sd));
+    CHECK(sd.hasButtonEvent);
+
+    CHECK(decode("44 01 50", sd));
+    CHECK(!sd.hasButtonEvent);
+    CHECK_EQ(sd.fields, BTHOME_FIELD_BATTERY);
+}
+
+TEST_CASE(skipped_objects_keep_alignment) {
+    // Spannung (0x0C), Generic Boolean (0x0F) und Firmware (0xF1/0xF2) haben
+    // kein Ziel-Feld, müssen aber mit ihrer Länge übersprungen werden
+    ShellyBLESensorData sd;
+    CHECK(decode("44 0C B8 0B 0F 01 F1 01 02 03 04 F2 05 06 07 01 5A", sd));
+    CHECK_EQ(sd.battery, 90);
+    CHECK_EQ(sd.fields, BTHOME_FIELD_BATTERY);
+}
+
+TEST_CASE(truncated_object_stops_parsing) {
+    ShellyBLESensorData sd;
+
+    // Illuminance braucht 3 Bytes, nur 2 vorhanden: Batterie davor bleibt
+    CHECK(decode("44 01 64 05 E8 03", sd));
+    CHECK_EQ(sd.battery, 100);
+    CHECK_EQ(sd.fields, BTHOME_FIELD_BATTERY);
+
+    // Rotation mit einem Byte
+    CHECK(decode("44 2D 01 3F 77", sd));
+    CHECK(sd.windowOpen);
+    CHECK(!(sd.fields & BTHOME_FIELD_ROTATION));
+
+    // Nur die Objekt-ID
+    CHECK(!decode("44 01", sd));
+    CHECK_EQ(sd.fields, BTHOME_FIELD_NONE);
+}
+
+TEST_CASE(unknown_object_stops_parsing) {
+    ShellyBLESensorData sd;
+
+    // 0x04 (Druck) fehlt in der Tabelle → Länge unbekannt, Rest verworfen
+    CHECK(decode("44 01 64 04 10 27 00 2D 01", sd));
+    CHECK_EQ(sd.battery, 100);
+    CHECK(!sd.windowOpen);
+    CHECK_EQ(sd.fields, BTHOME_FIELD_BATTERY);
+
+    CHECK(!decode("44 FF 01 02", sd));
+}
+
+TEST_CASE(empty_payload) {
+    ShellyBLESensorData sd;
+    CHECK(!bthomeDecodeObjects(nullptr, 0, sd));
+    CHECK_EQ(sd.fields, BTHOME_FIELD_NONE);
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// Geräteklassen
+// ═══════════════════════════════════════════════════════════════════════
+
+TEST_CASE(class_by_name_prefix) {
+    CHECK_STR(bthomeClassByName("SBDW-002C")->id, "door_window");
+    CHECK_STR(bthomeClassByName("SBW-002C-1A2B")->id, "door_window");
+    CHECK_STR(bthomeClassByName("SBBT-002C")->id, "button");
+    CHECK_STR(bthomeClassByName("SBHT-003C")->id, "ht");
+    CHECK_STR(bthomeClassByName("SBMO-003Z")->id, "motion");
+
+    CHECK(bthomeClassByName("SBDW") == nullptr);          // Präfix unvollständig
+    CHECK(bthomeClassByName("sbdw-002c") == nullptr);     // case-sensitiv
+    CHECK(bthomeClassByName("Shelly 1PM") == nullptr);
+    CHECK(bthomeClassByName("") == nullptr);
+    CHECK(bthomeClassByName(nullptr) == nullptr);
+}
+
+TEST_CASE(class_table_consistent) {
+    for (size_t i = 0; i < bthomeDeviceClassCount(); i++) {
+        const BTHomeDeviceClass& cls = bthomeDeviceClass(i);
+        CHECK(bthomeClassById(cls.id) == &cls);
+        CHECK(bthomeClassByTypeId(cls.deviceTypeId) == &cls);
+        CHECK(cls.namePrefixes[0] != nullptr);
+        CHECK(bthomeClassByName(cls.namePrefixes[0]) == &cls);
+    }
+    CHECK(bthomeClassById("nope") == nullptr);
+    CHECK(bthomeClassByTypeId(0) == nullptr);
+    CHECK(bthomeClassByTypeId(0x7FFF) == nullptr);
+    CHECK(&bthomeDeviceClass(999) == &bthomeDeviceClass(0));
+}
+
+TEST_CASE(match_prefers_name) {
+    // Name gewinnt auch gegen einen anderen Device Type im Payload
+    const BTHomeDeviceClass* cls = match("SBBT-002C", "44 F0 02 00");
+    CHECK(cls != nullptr);
+    CHECK_STR(cls->id, "button");
+    CHECK(cls->defaultRole == ShellySensorRole::BUTTON);
+}
+
+TEST_CASE(match_by_device_type) {
+    // Passiver Scan ohne Namen: Device Type 0xF0 aus Klartext-Payload
+    const BTHomeDeviceClass* cls = match(nullptr, "44 00 2A 01 64 F0 02 00");
+    CHECK(cls != nullptr);
+    CHECK_STR(cls->id, "door_window");
+    CHECK(cls->defaultRole == ShellySensorRole::WINDOW_CONTACT);
+
+    cls = match("", "40 F0 05 00");
+    CHECK(cls != nullptr);
+    CHECK_STR(cls->id, "motion");
+
+    // Unbekannter Name fällt auf den Device Type zurück
+    cls = match("Unknown", "44 F0 03 00");
+    CHECK(cls != nullptr);
+    CHECK_STR(cls->id, "ht");
+}
+
+TEST_CASE(match_rejects_unusable_payloads) {
+    // Verschlüsselt (DevInfo Bit 0): Objekte ohne Bindkey nicht lesbar,
+    // auch wenn die Bytes zufällig wie ein 0xF0-Objekt aussehen
+    CHECK(match(nullptr, "45 F0 02 00 11 22 33 44 55 66 77 88") == nullptr);
+    CHECK(match(nullptr, "41 F0 01 00") == nullptr);
+
+    // Kein Device Type, unbekannte ID, abgeschnitten, zu kurz
+    CHECK(match(nullptr, "44 00 2A 01 64") == nullptr);
+    CHECK(match(nullptr, "44 F0 7F 7F") == nullptr);
+    CHECK(match(nullptr, "44 F0 02") == nullptr);
+    CHECK(match(nullptr, "44") == nullptr);
+    CHECK(match(nullptr, nullptr) == nullptr);
+
+    // Verschlüsselt, aber Name bekannt → Name reicht
+    const BTHomeDeviceClass* cls = match("SBDW-002C", "45 F0 02 00 11 22 33 44");
+    CHECK(cls != nullptr);
+    CHECK_STR(cls->id, "door_window");
+}
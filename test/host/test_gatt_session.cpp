@@ -0,0 +1,348 @@
+// test_gatt_session.cpp - GattSession Schritte gegen FakeGattLink
+
+#include "host_test.h"
+#include "fake_gatt_link.h"
+#include "gatt_session.h"
+
+#include <host/ble_hs.h>
+
+static const char* PEER = "7c:c6:b6:61:2a:10";
+static const char* CHAR_A = "cb9e957e-952d-4761-a7e1-4416494a5bfa";
+static const char* CHAR_B = "86e7cc43-19f4-4f38-b5ad-1ae586237e2a";
+static const char* PASSKEY = "0ffb7104-860c-49ae-8989-1f946d5f6c03";
+
+// Kurze Deadlines, damit Timeout-Pfade schnell laufen
+static const GattStepPolicy FAST = { 40, GATT_CONNECT_ATTEMPTS };
+
+// ═══════════════════════════════════════════════════════════════════════
+// CONNECT
+// ═══════════════════════════════════════════════════════════════════════
+
+TEST_CASE(open_secure_discover_run) {
+    FakeGattPeer peer;
+    peer.connects = { FakeGattPeer::CONNECT_OK };
+    peer.chars[CHAR_A].value = "\x2A";
+    peer.chars[CHAR_B];
+
+    GattSession session(FakeGattLink::factory(peer));
+    CHECK(session.open(PEER, BLE_ADDR_RANDOM, FAST));
+    CHECK(session.isOpen());
+    CHECK(session.isConnectedTo("7C:C6:B6:61:2A:10"));
+    CHECK_EQ(session.step(), GATT_STEP_READY);
+    CHECK_EQ(session.addressType(), BLE_ADDR_RANDOM);
+    CHECK_EQ(session.mtu(), 185);
+
+    CHECK(session.secure());
+    CHECK(session.isEncrypted());
+
+    GattOp ops[] = { GattOp::read(CHAR_A), GattOp::write(CHAR_B, 5) };
+    CHECK_EQ(session.run(ops, 2), 2);
+    CHECK(ops[0].ok);
+    CHECK_EQ(ops[0].value, 0x2A);
+    CHECK(ops[1].ok);
+    CHECK_EQ(peer.chars[CHAR_B].written.size(), 1);
+    CHECK(peer.chars[CHAR_B].written[0] == "\x05");
+
+    session.close();
+    CHECK(!session.isOpen());
+    CHECK_EQ(session.step(), GATT_STEP_IDLE);
+    CHECK_EQ(peer.disconnects, 1);
+    CHECK_EQ(peer.linksDeleted, 1);
+}
+
+TEST_CASE(async_events) {
+    // Ereignisse aus einem anderen Thread, wie aus dem NimBLE Host Task
+    FakeGattPeer peer;
+    peer.connects = { FakeGattPeer::CONNECT_OK };
+    peer.eventDelayMs = 15;
+    peer.chars[CHAR_A];
+
+    GattSession session(FakeGattLink::factory(peer));
+    CHECK(session.open(PEER, BLE_ADDR_PUBLIC, { 500, 1 }));
+    CHECK(session.secure(500));
+
+    std::string value;
+    CHECK(session.read(CHAR_A, value));
+    session.close();
+    CHECK_EQ(peer.linksDeleted, 1);
+}
+
+TEST_CASE(connect_retry_switches_address_type) {
+    FakeGattPeer peer;
+    peer.connects = { FakeGattPeer::CONNECT_FAIL, FakeGattPeer::CONNECT_OK };
+
+    GattSession session(FakeGattLink::factory(peer));
+    CHECK(session.open(PEER, BLE_ADDR_RANDOM, FAST));
+    CHECK_EQ(peer.connectTypes.size(), 2);
+    CHECK_EQ(peer.connectTypes[0], BLE_ADDR_RANDOM);
+    CHECK_EQ(peer.connectTypes[1], BLE_ADDR_PUBLIC);
+    CHECK_EQ(session.addressType(), BLE_ADDR_PUBLIC);
+    CHECK_EQ(peer.cancels, 0);
+    CHECK_EQ(peer.linksCreated, 1);         // ein Link für alle Versuche
+}
+
+TEST_CASE(connect_not_started_tries_next) {
+    FakeGattPeer peer;
+    peer.connects = { FakeGattPeer::CONNECT_NOT_STARTED, FakeGattPeer::CONNECT_OK };
+
+    GattSession session(FakeGattLink::factory(peer));
+    CHECK(session.open(PEER, BLE_ADDR_RANDOM, FAST));
+    CHECK_EQ(peer.connectTypes.size(), 2);
+}
+
+TEST_CASE(connect_timeout_cancels_every_attempt) {
+    FakeGattPeer peer;                      // antwortet nie
+
+    GattSession session(FakeGattLink::factory(peer));
+    uint32_t start = millis();
+    CHECK(!session.open(PEER, BLE_ADDR_RANDOM, FAST));
+    uint32_t elapsed = millis() - start;
+
+    CHECK_EQ(session.step(), GATT_STEP_FAILED);
+    CHECK_EQ(session.failedStep(), GATT_STEP_CONNECT);
+    CHECK_EQ(peer.connectTypes.size(), GATT_CONNECT_ATTEMPTS);
+    CHECK_EQ(peer.cancels, GATT_CONNECT_ATTEMPTS);
+    CHECK(elapsed >= GATT_CONNECT_ATTEMPTS * FAST.deadlineMs);
+    CHECK(!session.isOpen());
+    CHECK_EQ(peer.linksDeleted, 1);
+}
+
+TEST_CASE(connect_failures_exhaust_attempts) {
+    FakeGattPeer peer;
+    peer.connects = { FakeGattPeer::CONNECT_FAIL, FakeGattPeer::CONNECT_FAIL };
+
+    GattSession session(FakeGattLink::factory(peer));
+    CHECK(!session.open(PEER, BLE_ADDR_RANDOM, FAST));
+    CHECK_EQ(session.failedStep(), GATT_STEP_CONNECT);
+    CHECK_EQ(session.lastReason(), 0x3E);
+    CHECK_EQ(peer.cancels, 0);
+}
+
+TEST_CASE(stale_cancel_failure_does_not_fail_next_attempt) {
+    // Versuch 1 läuft in den Timeout → cancelConnect(). Dessen Fail-Event
+    // kommt erst, nachdem Versuch 2 die Bits gelöscht hat; Versuch 2
+    // verbindet etwas später regulär.
+    FakeGattPeer peer;
+    peer.connects = { FakeGattPeer::CONNECT_SILENT, FakeGattPeer::CONNECT_OK };
+    peer.staleFailAfterCancel = true;
+    peer.eventDelayMs = 10;
+
+    GattSession session(FakeGattLink::factory(peer));
+    CHECK(session.open(PEER, BLE_ADDR_RANDOM, FAST));
+    CHECK_EQ(peer.cancels, 1);
+    CHECK_EQ(session.addressType(), BLE_ADDR_PUBLIC);
+    CHECK(session.lastReason() != 0x202);
+    session.close();
+}
+
+TEST_CASE(stale_cancel_failure_after_last_attempt) {
+    // Kein weiterer Versuch offen: das späte Event wird einfach verworfen
+    FakeGattPeer peer;
+    peer.connects = { FakeGattPeer::CONNECT_SILENT, FakeGattPeer::CONNECT_SILENT,
+                      FakeGattPeer::CONNECT_OK };
+    peer.staleFailAfterCancel = true;
+
+    GattSession session(FakeGattLink::factory(peer));
+    CHECK(!session.open(PEER, BLE_ADDR_RANDOM, FAST));
+
+    // Neuer open() beginnt mit frischen Zählern und neuem Link
+    CHECK(session.open(PEER, BLE_ADDR_RANDOM, { 40, 1 }));
+    CHECK_EQ(peer.linksCreated, 2);
+    session.close();
+}
+
+TEST_CASE(missing_factory_fails_connect) {
+    GattSession session([](GattLinkListener&) -> GattLink* { return nullptr; });
+    CHECK(!session.open(PEER, BLE_ADDR_RANDOM, FAST));
+    CHECK_EQ(session.failedStep(), GATT_STEP_CONNECT);
+    CHECK(!session.isOpen());
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// SECURE
+// ═══════════════════════════════════════════════════════════════════════
+
+TEST_CASE(secure_rejected_bonding) {
+    // Falscher Passkey / abgelehntes Pairing: AUTH_DONE ohne Bonding
+    FakeGattPeer peer;
+    peer.connects = { FakeGattPeer::CONNECT_OK };
+    peer.auth = FakeGattPeer::AUTH_REJECTED;
+
+    GattSession session(FakeGattLink::factory(peer));
+    CHECK(session.open(PEER, BLE_ADDR_RANDOM, FAST));
+    CHECK(!session.secure(200));
+    CHECK_EQ(session.failedStep(), GATT_STEP_SECURE);
+    CHECK(session.isConnected());
+    CHECK(!session.isEncrypted());
+}
+
+TEST_CASE(secure_timeout) {
+    FakeGattPeer peer;
+    peer.connects = { FakeGattPeer::CONNECT_OK };
+    peer.auth = FakeGattPeer::AUTH_SILENT;
+
+    GattSession session(FakeGattLink::factory(peer));
+    CHECK(session.open(PEER, BLE_ADDR_RANDOM, FAST));
+
+    uint32_t start = millis();
+    CHECK(!session.secure(40));
+    CHECK(millis() - start >= 40);
+    CHECK_EQ(session.failedStep(), GATT_STEP_SECURE);
+}
+
+TEST_CASE(secure_peer_disconnect) {
+    FakeGattPeer peer;
+    peer.connects = { FakeGattPeer::CONNECT_OK };
+    peer.auth = FakeGattPeer::AUTH_DISCONNECT;
+
+    String hookAddress;
+    int hookReason = 0;
+
+    GattSession session(FakeGattLink::factory(peer));
+    session.setDisconnectHook([&](const String& address, int reason) {
+        hookAddress = address;
+        hookReason = reason;
+    });
+
+    CHECK(session.open(PEER, BLE_ADDR_RANDOM, FAST));
+    CHECK(!session.secure(200));
+    CHECK_EQ(session.failedStep(), GATT_STEP_SECURE);
+    CHECK(!session.isConnected());
+    CHECK_STR(hookAddress.c_str(), PEER);
+    CHECK_EQ(hookReason, 0x13);
+    CHECK(session.waitForDisconnect(10));
+
+    // Nicht mehr verbunden → kein Secure-Versuch
+    CHECK(!session.secure(10));
+    CHECK_EQ(peer.secures, 1);
+}
+
+TEST_CASE(secure_bonding_started_by_peer) {
+    FakeGattPeer peer;
+    peer.connects = { FakeGattPeer::CONNECT_OK };
+    peer.peerStartsBonding = true;
+
+    GattSession session(FakeGattLink::factory(peer));
+    CHECK(session.open(PEER, BLE_ADDR_RANDOM, FAST));
+    CHECK(session.secure(200));
+    CHECK_EQ(peer.secures, 0);
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// DISCOVER / READ / WRITE
+// ═══════════════════════════════════════════════════════════════════════
+
+TEST_CASE(passkey_write_rejected) {
+    FakeGattPeer peer;
+    peer.connects = { FakeGattPeer::CONNECT_OK };
+    peer.chars[PASSKEY].props = GATT_PROP_WRITE;
+    peer.chars[PASSKEY].rejectedWrites = GATT_IO_ATTEMPTS;
+
+    GattSession session(FakeGattLink::factory(peer));
+    CHECK(session.open(PEER, BLE_ADDR_RANDOM, FAST));
+    CHECK(session.hasCharacteristic(PASSKEY));
+
+    const uint8_t passkey[4] = { 0x40, 0xE2, 0x01, 0x00 };
+    CHECK(!session.write(PASSKEY, passkey, sizeof(passkey)));
+    CHECK_EQ(session.failedStep(), GATT_STEP_WRITE);
+    CHECK_EQ(peer.writesWithResponse, GATT_IO_ATTEMPTS);
+    CHECK_EQ(peer.writesNoResponse, 0);
+}
+
+TEST_CASE(write_falls_back_to_no_response) {
+    FakeGattPeer peer;
+    peer.connects = { FakeGattPeer::CONNECT_OK };
+    peer.chars[PASSKEY].props = GATT_PROP_WRITE | GATT_PROP_WRITE_NR;
+    peer.chars[PASSKEY].rejectedWrites = 1;
+
+    GattSession session(FakeGattLink::factory(peer));
+    CHECK(session.open(PEER, BLE_ADDR_RANDOM, FAST));
+
+    const uint8_t passkey[4] = { 0x40, 0xE2, 0x01, 0x00 };
+    CHECK(session.write(PASSKEY, passkey, sizeof(passkey)));
+    CHECK_EQ(peer.writesWithResponse, 1);
+    CHECK_EQ(peer.writesNoResponse, 1);
+    CHECK_EQ(peer.chars[PASSKEY].written.size(), 1);
+    CHECK_EQ(peer.chars[PASSKEY].written[0].size(), 4);
+}
+
+TEST_CASE(read_retries_and_property_checks) {
+    FakeGattPeer peer;
+    peer.connects = { FakeGattPeer::CONNECT_OK };
+    peer.chars[CHAR_A].emptyReads = 1;
+    peer.chars[CHAR_B].props = GATT_PROP_WRITE;
+
+    GattSession session(FakeGattLink::factory(peer));
+    CHECK(session.open(PEER, BLE_ADDR_RANDOM, FAST));
+
+    std::string value;
+    CHECK(session.read(CHAR_A, value));
+    CHECK_EQ(peer.reads, 2);
+
+    peer.chars[CHAR_A].emptyReads = GATT_IO_ATTEMPTS;
+    CHECK(!session.read(CHAR_A, value));
+    CHECK_EQ(session.failedStep(), GATT_STEP_READ);
+
+    CHECK(!session.read(CHAR_B, value));        // nicht lesbar
+    CHECK(!session.read(PASSKEY, value));       // nicht vorhanden
+    CHECK(!session.hasCharacteristic(PASSKEY));
+    CHECK_EQ(peer.reads, 2 + GATT_IO_ATTEMPTS);
+}
+
+TEST_CASE(discover_without_services_fails) {
+    FakeGattPeer peer;
+    peer.connects = { FakeGattPeer::CONNECT_OK };
+    peer.services = 0;
+
+    GattSession session(FakeGattLink::factory(peer));
+    CHECK(session.open(PEER, BLE_ADDR_RANDOM, FAST));
+    CHECK(!session.discover());
+    CHECK_EQ(session.failedStep(), GATT_STEP_DISCOVER);
+}
+
+TEST_CASE(visit_lists_discovered_characteristics) {
+    FakeGattPeer peer;
+    peer.connects = { FakeGattPeer::CONNECT_OK };
+    peer.chars[CHAR_A];
+    peer.chars[PASSKEY].props = GATT_PROP_WRITE_NR;
+
+    GattSession session(FakeGattLink::factory(peer));
+    CHECK(session.open(PEER, BLE_ADDR_RANDOM, FAST));
+
+    int visited = 0;
+    session.visitCharacteristics([&](const std::string&, const std::string&, uint8_t) {
+        visited++;
+    });
+    CHECK_EQ(visited, 0);                       // vor der Discovery nichts
+
+    CHECK(session.discover());
+    session.visitCharacteristics([&](const std::string&, const std::string& uuid,
+                                     uint8_t props) {
+        visited++;
+        if (uuid == PASSKEY) {
+            CHECK_EQ(props, GATT_PROP_WRITE_NR);
+        }
+    });
+    CHECK_EQ(visited, 2);
+}
+
+TEST_CASE(run_stops_after_link_loss) {
+    FakeGattPeer peer;
+    peer.connects = { FakeGattPeer::CONNECT_OK };
+    peer.chars[CHAR_A].dropOnAccess = true;
+    peer.chars[CHAR_B];
+
+    GattSession session(FakeGattLink::factory(peer));
+    CHECK(session.open(PEER, BLE_ADDR_RANDOM, FAST));
+
+    GattOp ops[] = { GattOp::read(CHAR_A), GattOp::write(CHAR_B, 1), GattOp::read(CHAR_B) };
+    ops[1].ok = ops[2].ok = true;
+    CHECK_EQ(session.run(ops, 3), 0);
+    CHECK(!ops[0].ok && !ops[1].ok && !ops[2].ok);
+    CHECK_EQ(peer.reads, 1);
+    CHECK_EQ(peer.writesWithResponse, 0);
+
+    // Ohne Verbindung kein DISCONNECT-Warten
+    session.close();
+    CHECK_EQ(peer.disconnects, 0);
+}
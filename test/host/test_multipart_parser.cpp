@@ -0,0 +1,345 @@
+// test_multipart_parser.cpp - MultipartParser aus ota_stream.cpp
+//
+// Der Body wird an jeder Position (und an jedem Paar von Positionen) in
+// Chunks zerlegt - so liegen Boundary, Part-Header und das CRLF vor dem
+// Delimiter in irgendeinem Durchlauf auf einer recv()-Grenze.
+
+#include "host_test.h"
+#include "ota_stream.h"
+
+#include <string>
+#include <vector>
+
+static const char BOUNDARY[] = "----WebKitFormBoundary7MA4YWxkTrZu0gW";
+
+struct Sink {
+    std::string data;
+    size_t calls = 0;
+    size_t rejectAfter = SIZE_MAX;  // Bytes, ab denen der Sink ablehnt
+};
+
+static bool sink_fn(void* ctx, const uint8_t* data, size_t len) {
+    Sink* sink = (Sink*)ctx;
+    CHECK(len > 0);
+    if (sink->data.size() + len > sink->rejectAfter) return false;
+    sink->data.append((const char*)data, len);
+    sink->calls++;
+    return true;
+}
+
+// Browser-Form: ein Datei-Part, danach optional ein weiteres Feld
+static std::string make_body(const std::string& payload, bool second_part = false,
+                             const std::string& preamble = "") {
+    std::string body = preamble;
+    body += "--"; body += BOUNDARY; body += "\r\n";
+    body += "Content-Disposition: form-data; name=\"firmware\"; filename=\"firmware.bin\"\r\n";
+    body += "Content-Type: application/octet-stream\r\n\r\n";
+    body += payload;
+    body += "\r\n--"; body += BOUNDARY;
+    if (second_part) {
+        body += "\r\nContent-Disposition: form-data; name=\"sha\"\r\n\r\nabc\r\n--";
+        body += BOUNDARY;
+    }
+    body += "--\r\n";
+    return body;
+}
+
+// Payload mit allen Fallen: CR/LF, Beinahe-Delimiter, Nullbytes
+static std::string tricky_payload() {
+    std::string p;
+    p += std::string("\xE9\x05\x02\x20", 4);
+    p += std::string("\0\0\r\0", 4);
+    p += "\r\n";
+    p += "\r\n--";
+    p += "\r\n--" + std::string(BOUNDARY, sizeof(BOUNDARY) - 2);    // letztes Zeichen fehlt
+    p += "X\r\r\n-\r\n--\r";
+    for (int i = 0; i < 64; i++) p += (char)(i * 37);
+    p += "\r";
+    return p;
+}
+
+// Feed in Chunks an den Schnittpunkten cuts (aufsteigend)
+static bool feed_split(MultipartParser& parser, const std::string& body,
+                       const std::vector<size_t>& cuts) {
+    size_t start = 0;
+    for (size_t cut : cuts) {
+        if (!parser.feed((const uint8_t*)body.data() + start, cut - start)) return false;
+        start = cut;
+    }
+    return parser.feed((const uint8_t*)body.data() + start, body.size() - start);
+}
+
+static bool parse(const std::string& body, const std::vector<size_t>& cuts, Sink& sink,
+                  MultipartParser& parser) {
+    CHECK(parser.begin(BOUNDARY, sink_fn, &sink));
+    return feed_split(parser, body, cuts);
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// multipart_boundary
+// ═══════════════════════════════════════════════════════════════════════
+
+TEST_CASE(boundary_from_content_type) {
+    char out[OTA_MULTIPART_BOUNDARY_MAX + 1];
+
+    CHECK(multipart_boundary("multipart/form-data; boundary=abc123", out, sizeof(out)));
+    CHECK_STR(out, "abc123");
+
+    CHECK(multipart_boundary("multipart/form-data; BOUNDARY=\"a b;c\"; charset=x", out, sizeof(out)));
+    CHECK_STR(out, "a b;c");
+
+    CHECK(multipart_boundary("multipart/form-data; boundary=xyz; charset=utf-8", out, sizeof(out)));
+    CHECK_STR(out, "xyz");
+
+    CHECK(!multipart_boundary("multipart/form-data", out, sizeof(out)));
+    CHECK(!multipart_boundary("multipart/form-data; boundary=", out, sizeof(out)));
+    CHECK(!multipart_boundary("multipart/form-data; boundary=\"open", out, sizeof(out)));
+
+    std::string longType = "multipart/form-data; boundary=" +
+                           std::string(OTA_MULTIPART_BOUNDARY_MAX + 1, 'b');
+    CHECK(!multipart_boundary(longType.c_str(), out, sizeof(out)));
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// Zerteilte Eingaben
+// ═══════════════════════════════════════════════════════════════════════
+
+TEST_CASE(single_chunk) {
+    std::string payload = tricky_payload();
+    std::string body = make_body(payload);
+
+    Sink sink;
+    MultipartParser parser;
+    CHECK(parse(body, {}, sink, parser));
+    CHECK(parser.done());
+    CHECK(parser.error() == nullptr);
+    CHECK(sink.data == payload);
+    CHECK_EQ(parser.bodyBytes(), payload.size());
+}
+
+TEST_CASE(split_at_every_position) {
+    std::string payload = tricky_payload();
+    std::string body = make_body(payload);
+
+    for (size_t cut = 0; cut <= body.size(); cut++) {
+        Sink sink;
+        MultipartParser parser;
+        CHECK(parse(body, {cut}, sink, parser));
+        CHECK(parser.done());
+        if (sink.data != payload) {
+            char msg[64];
+            snprintf(msg, sizeof(msg), "payload mismatch, cut at %zu", cut);
+            hostTestFail(__FILE__, __LINE__, msg);
+            return;
+        }
+    }
+}
+
+TEST_CASE(split_at_every_pair_of_positions) {
+    // Kurzer Payload, damit die O(n²) Kombinationen schnell bleiben
+    std::string payload = "ab\r\ncd\r\n--" + std::string(BOUNDARY, 5) + "\r";
+    std::string body = make_body(payload);
+
+    for (size_t a = 0; a <= body.size(); a++) {
+        for (size_t b = a; b <= body.size(); b++) {
+            Sink sink;
+            MultipartParser parser;
+            CHECK(parse(body, {a, b}, sink, parser));
+            if (!parser.done() || sink.data != payload) {
+                char msg[64];
+                snprintf(msg, sizeof(msg), "payload mismatch, cuts at %zu/%zu", a, b);
+                hostTestFail(__FILE__, __LINE__, msg);
+                return;
+            }
+        }
+    }
+}
+
+TEST_CASE(byte_by_byte) {
+    std::string payload = tricky_payload();
+    std::string body = make_body(payload, true, "preamble text\r\n");
+
+    std::vector<size_t> cuts;
+    for (size_t i = 1; i < body.size(); i++) cuts.push_back(i);
+
+    Sink sink;
+    MultipartParser parser;
+    CHECK(parse(body, cuts, sink, parser));
+    CHECK(parser.done());
+    CHECK(sink.data == payload);
+}
+
+TEST_CASE(boundary_split_across_chunks) {
+    // Chunk endet mitten im End-Delimiter: die vorgehaltenen Zeichen
+    // dürfen weder im Sink landen noch verloren gehen
+    std::string payload = "firmware-bytes";
+    std::string body = make_body(payload);
+    size_t delim = body.find("\r\n--" + std::string(BOUNDARY));   // erstes "--" ohne CRLF
+    CHECK(delim == body.find(payload) + payload.size());
+
+    for (size_t into = 1; into < 4 + sizeof(BOUNDARY) - 1; into++) {
+        Sink sink;
+        MultipartParser parser;
+        CHECK(parser.begin(BOUNDARY, sink_fn, &sink));
+        CHECK(parser.feed((const uint8_t*)body.data(), delim + into));
+        CHECK(!parser.done());
+        CHECK(sink.data == payload);            // nichts vom Delimiter
+        CHECK(parser.feed((const uint8_t*)body.data() + delim + into,
+                          body.size() - delim - into));
+        CHECK(parser.done());
+        CHECK(sink.data == payload);
+    }
+}
+
+TEST_CASE(crlf_at_chunk_edge) {
+    std::string payload = "line1\r\nline2\r\n";
+    std::string body = make_body(payload);
+    size_t end = body.find("\r\n--" + std::string(BOUNDARY), body.find("line2"));
+
+    // Chunk endet auf '\r' des Delimiters, '\n' kommt im nächsten
+    {
+        Sink sink;
+        MultipartParser parser;
+        CHECK(parse(body, {end + 1}, sink, parser));
+        CHECK(parser.done());
+        CHECK(sink.data == payload);
+    }
+
+    // Chunk endet auf '\r' im Payload, der kein Delimiter wird
+    {
+        size_t cr = body.find("\r\nline2");
+        Sink sink;
+        MultipartParser parser;
+        CHECK(parser.begin(BOUNDARY, sink_fn, &sink));
+        CHECK(parser.feed((const uint8_t*)body.data(), cr + 1));
+        CHECK(sink.data == "line1");            // '\r' vorgehalten
+        CHECK(parser.feed((const uint8_t*)body.data() + cr + 1, body.size() - cr - 1));
+        CHECK(parser.done());
+        CHECK(sink.data == payload);
+    }
+
+    // Header-Ende "\r\n\r\n" auf zwei Chunks verteilt
+    {
+        size_t hdr = body.find("\r\n\r\n");
+        for (size_t k = 1; k < 4; k++) {
+            Sink sink;
+            MultipartParser parser;
+            CHECK(parse(body, {hdr + k}, sink, parser));
+            CHECK(parser.done());
+            CHECK(sink.data == payload);
+        }
+    }
+}
+
+TEST_CASE(random_chunking) {
+    std::string payload;
+    uint32_t rng = 0x9E3779B9u;
+    for (int i = 0; i < 4000; i++) {
+        rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+        // viele CR/LF/'-', damit Teil-Delimiter häufig sind
+        static const char alphabet[] = "\r\n--\r\n-abcWebKit";
+        payload += (rng & 3) ? alphabet[rng % (sizeof(alphabet) - 1)] : (char)(rng >> 8);
+    }
+    payload += "\r\n--" + std::string(BOUNDARY, 20);
+    std::string body = make_body(payload, true);
+
+    for (int round = 0; round < 200; round++) {
+        std::vector<size_t> cuts;
+        size_t pos = 0;
+        while (true) {
+            rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+            pos += 1 + rng % 97;
+            if (pos >= body.size()) break;
+            cuts.push_back(pos);
+        }
+        Sink sink;
+        MultipartParser parser;
+        CHECK(parse(body, cuts, sink, parser));
+        CHECK(parser.done());
+        if (sink.data != payload) {
+            hostTestFail(__FILE__, __LINE__, "payload mismatch with random chunks");
+            return;
+        }
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// Ende und Fehler
+// ═══════════════════════════════════════════════════════════════════════
+
+TEST_CASE(epilog_and_further_parts_ignored) {
+    std::string body = make_body("fw", true) + "epilog garbage";
+    Sink sink;
+    MultipartParser parser;
+    CHECK(parse(body, {}, sink, parser));
+    CHECK(parser.done());
+    CHECK(sink.data == "fw");
+    CHECK(parser.feed((const uint8_t*)"more", 4));       // nach DONE: ignoriert
+    CHECK(sink.data == "fw");
+}
+
+TEST_CASE(preamble_before_first_boundary) {
+    std::string body = make_body("fw", false, "This is a preamble\r\n-- not it\r\n");
+    Sink sink;
+    MultipartParser parser;
+    CHECK(parse(body, {7}, sink, parser));
+    CHECK(parser.done());
+    CHECK(sink.data == "fw");
+}
+
+TEST_CASE(empty_file_part) {
+    std::string body = make_body("");
+    Sink sink;
+    MultipartParser parser;
+    CHECK(parse(body, {}, sink, parser));
+    CHECK(parser.done());
+    CHECK(sink.data.empty());
+    CHECK_EQ(sink.calls, 0);
+}
+
+TEST_CASE(errors) {
+    MultipartParser parser;
+    Sink sink;
+    CHECK(!parser.feed((const uint8_t*)"x", 1));         // ohne begin()
+    CHECK(!parser.begin("", sink_fn, &sink));
+    CHECK(!parser.begin("a\r\nb", sink_fn, &sink));
+    CHECK(!parser.begin(std::string(OTA_MULTIPART_BOUNDARY_MAX + 1, 'b').c_str(),
+                        sink_fn, &sink));
+
+    // Kein Boundary in den ersten OTA_MULTIPART_HEADER_MAX Bytes
+    {
+        std::string junk(OTA_MULTIPART_HEADER_MAX + 1, 'x');
+        CHECK(parser.begin(BOUNDARY, sink_fn, &sink));
+        CHECK(!parser.feed((const uint8_t*)junk.data(), junk.size()));
+        CHECK_STR(parser.error(), "boundary not found");
+    }
+
+    // Schluss-Boundary ohne Part
+    {
+        std::string body = "--" + std::string(BOUNDARY) + "--\r\n";
+        CHECK(parser.begin(BOUNDARY, sink_fn, &sink));
+        CHECK(!parser.feed((const uint8_t*)body.data(), body.size()));
+        CHECK_STR(parser.error(), "no file part");
+    }
+
+    // Part-Header ohne Ende
+    {
+        std::string body = "--" + std::string(BOUNDARY) + "\r\n" +
+                           std::string(OTA_MULTIPART_HEADER_MAX + 1, 'h');
+        CHECK(parser.begin(BOUNDARY, sink_fn, &sink));
+        CHECK(!parser.feed((const uint8_t*)body.data(), body.size()));
+        CHECK_STR(parser.error(), "part header too long");
+    }
+
+    // Sink lehnt ab (Flash-Writer-Fehler) → danach keine Daten mehr
+    {
+        Sink rejecting;
+        rejecting.rejectAfter = 10;
+        std::string body = make_body(std::string(100, 'f'));
+        CHECK(parser.begin(BOUNDARY, sink_fn, &rejecting));
+        CHECK(!feed_split(parser, body, {60, 80}));
+        CHECK_STR(parser.error(), "write failed");
+        CHECK(!parser.done());
+        CHECK(!parser.feed((const uint8_t*)"x", 1));
+    }
+}
@@ -0,0 +1,394 @@
+// test_ota_inflate.cpp - OtaImageInflater aus ota_stream.cpp
+//
+// Round-Trip über scripts/compress_ota.py: ein synthetisches Image mit
+// Rückverweisen bis an den Fensterrand wird vom Skript gepackt und über
+// den tinfl-Ringpuffer (OTA_INFLATE_DICT, Fenster 2^13) wieder entpackt.
+// Bei ~200 KB wird der 8-KB-Ring über zwanzigmal voll, die Chunks
+// schneiden Header und Deflate-Blöcke an beliebigen Stellen. tinfl
+// liefert hier der zlib-Shim aus include/miniz.h, der den Ring-Vertrag
+// (Position, Größe, unveränderte Historie) bei jedem Aufruf prüft.
+
+#include "host_test.h"
+#include "ota_stream.h"
+
+#include <miniz.h>
+
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+typedef std::vector<uint8_t> Bytes;
+
+static const uint8_t FIRMWARE_MAGIC = 0xE9;        // ESP_IMAGE_HEADER_MAGIC
+
+static const size_t RAW_SIZE = 200 * 1024 + 123;   // kein Vielfaches des Rings
+
+static uint32_t rng_state;
+
+static uint32_t rng_next() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+// Firmware-ähnlich: Zufallsdaten, Wiederholungen bis knapp an die
+// Fenstergrenze (auch überlappend) und 0xFF-Padding
+static Bytes make_raw(size_t size, uint32_t seed) {
+    rng_state = seed;
+    Bytes raw;
+    raw.reserve(size);
+    raw.push_back(FIRMWARE_MAGIC);
+
+    while (raw.size() < size) {
+        switch (rng_next() % 4) {
+            case 0: {                                       // Literale
+                size_t n = 1 + rng_next() % 300;
+                for (size_t i = 0; i < n; i++) raw.push_back((uint8_t)rng_next());
+                break;
+            }
+            case 1:
+            case 2: {                                       // Rückverweis
+                size_t dist = 1 + rng_next() % (OTA_INFLATE_DICT - 300);
+                if (dist > raw.size()) break;
+                size_t n = 3 + rng_next() % 256;
+                size_t from = raw.size() - dist;
+                for (size_t i = 0; i < n; i++) raw.push_back(raw[from + i]);
+                break;
+            }
+            default: {                                      // Padding
+                size_t n = 1 + rng_next() % 2000;
+                raw.insert(raw.end(), n, 0xFF);
+                break;
+            }
+        }
+    }
+    raw.resize(size);
+    return raw;
+}
+
+static bool write_file(const std::string& path, const Bytes& data) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    return fclose(f) == 0 && ok;
+}
+
+static Bytes read_file(const std::string& path) {
+    Bytes data;
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return data;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+    fclose(f);
+    return data;
+}
+
+// firmware.bin → compress_ota.py → firmware.bwz
+static Bytes compress_ota(const Bytes& raw) {
+    std::string in = std::string(BW_TEST_DIR) + "/ota_inflate.bin";
+    std::string out = std::string(BW_TEST_DIR) + "/ota_inflate.bwz";
+    remove(out.c_str());
+    CHECK(write_file(in, raw));
+
+    std::string cmd = std::string("\"") + BW_PYTHON + "\" \"" + BW_COMPRESS_OTA + "\" \"" +
+                      in + "\" \"" + out + "\" > /dev/null";
+    CHECK_EQ(std::system(cmd.c_str()), 0);
+    return read_file(out);
+}
+
+static const Bytes& test_raw() {
+    static const Bytes raw = make_raw(RAW_SIZE, 0x9E3779B9u);
+    return raw;
+}
+
+static const Bytes& test_image() {
+    static const Bytes image = compress_ota(test_raw());
+    return image;
+}
+
+static OtaImageHeader* image_header(Bytes& image) {
+    return reinterpret_cast<OtaImageHeader*>(image.data());
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// Entpacken wie OtaStreamWriter: Decompressor + Ring vom Aufrufer
+// ═══════════════════════════════════════════════════════════════════════
+
+struct Inflate {
+    std::unique_ptr<tinfl_decompressor> decomp{new tinfl_decompressor};
+    Bytes dict = Bytes(OTA_INFLATE_DICT);
+    OtaImageInflater inflater;
+    Bytes out;
+    size_t calls = 0;
+    bool feedOk = true;
+
+    explicit Inflate(size_t maxRawSize = 4 * 1024 * 1024) {
+        inflater.begin(decomp.get(), dict.data(), maxRawSize, sink_fn, this);
+    }
+
+    static bool sink_fn(void* ctx, const uint8_t* data, size_t len) {
+        Inflate* self = (Inflate*)ctx;
+        // Sink bekommt Abschnitte direkt aus dem Ring
+        CHECK(len > 0);
+        CHECK(data >= self->dict.data());
+        CHECK(data + len <= self->dict.data() + self->dict.size());
+        self->out.insert(self->out.end(), data, data + len);
+        self->calls++;
+        return true;
+    }
+
+    // chunk(i) = Größe des i-ten Chunks
+    template <typename ChunkFn>
+    bool runChunks(const Bytes& image, ChunkFn chunk) {
+        size_t pos = 0;
+        for (size_t i = 0; pos < image.size() && feedOk; i++) {
+            size_t n = chunk(i);
+            if (n > image.size() - pos) n = image.size() - pos;
+            feedOk = inflater.feed(image.data() + pos, n);
+            pos += n;
+        }
+        return feedOk && inflater.finish();
+    }
+
+    bool run(const Bytes& image, size_t chunkSize) {
+        return runChunks(image, [chunkSize](size_t) { return chunkSize; });
+    }
+};
+
+// ═══════════════════════════════════════════════════════════════════════
+// Round-Trip
+// ═══════════════════════════════════════════════════════════════════════
+
+TEST_CASE(compress_ota_header_matches_device) {
+    Bytes image = test_image();
+    CHECK(image.size() > sizeof(OtaImageHeader));
+    const OtaImageHeader* header = image_header(image);
+
+    CHECK(memcmp(header->magic, OTA_IMAGE_MAGIC, 4) == 0);
+    CHECK_EQ(header->version, OTA_IMAGE_VERSION);
+    CHECK_EQ(header->algorithm, OTA_IMAGE_ALGO_DEFLATE);
+    CHECK_EQ(header->windowBits, OTA_INFLATE_WINDOW_BITS);
+    CHECK_EQ(header->rawSize, RAW_SIZE);
+    CHECK_EQ(header->packedSize, image.size() - sizeof(OtaImageHeader));
+    // Sonst prüft der Test keinen Ring-Überlauf
+    CHECK(RAW_SIZE > 16 * OTA_INFLATE_DICT);
+    CHECK(header->packedSize < RAW_SIZE);
+}
+
+TEST_CASE(roundtrip_single_feed) {
+    Inflate inf;
+    CHECK(inf.run(test_image(), test_image().size()));
+    CHECK(inf.inflater.error() == nullptr);
+    CHECK(inf.out == test_raw());
+    CHECK_EQ(inf.inflater.rawBytes(), RAW_SIZE);
+    CHECK_EQ(inf.inflater.packedBytes(), test_image().size() - sizeof(OtaImageHeader));
+    // Jeder Ring-Durchlauf endet an dict + OTA_INFLATE_DICT
+    CHECK(inf.calls >= RAW_SIZE / OTA_INFLATE_DICT);
+}
+
+TEST_CASE(roundtrip_fixed_chunks) {
+    // 1 Byte, Header-Grenze (48), recv()-Größe und Ring ± 1
+    static const size_t sizes[] = {
+        1, 7, sizeof(OtaImageHeader) - 1, sizeof(OtaImageHeader), sizeof(OtaImageHeader) + 1,
+        1000, OTA_STREAM_RECV_SIZE, OTA_INFLATE_DICT - 1, OTA_INFLATE_DICT + 1
+    };
+    for (size_t size : sizes) {
+        Inflate inf;
+        bool ok = inf.run(test_image(), size);
+        if (!ok || inf.out != test_raw()) {
+            fprintf(stderr, "  chunk size %zu: %s\n", size,
+                    inf.inflater.error() ? inf.inflater.error() : "output differs");
+        }
+        CHECK(ok);
+        CHECK(inf.out == test_raw());
+    }
+}
+
+TEST_CASE(roundtrip_random_chunks) {
+    for (uint32_t seed = 1; seed <= 8; seed++) {
+        rng_state = seed * 0x85EBCA6Bu;
+        Inflate inf;
+        CHECK(inf.runChunks(test_image(), [](size_t) { return (size_t)(1 + rng_next() % 5000); }));
+        CHECK(inf.out == test_raw());
+    }
+}
+
+TEST_CASE(roundtrip_small_image) {
+    // Kleiner als der Ring: kein Überlauf, Stream endet im ersten Chunk
+    Bytes raw = make_raw(3000, 42);
+    Bytes image = compress_ota(raw);
+    Inflate inf;
+    CHECK(inf.run(image, OTA_STREAM_RECV_SIZE));
+    CHECK(inf.out == raw);
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// packedSize
+// ═══════════════════════════════════════════════════════════════════════
+
+TEST_CASE(packed_size_smaller_than_stream) {
+    Bytes image = test_image();
+    image_header(image)->packedSize -= 1;
+
+    Inflate inf;
+    CHECK(!inf.run(image, OTA_STREAM_RECV_SIZE));
+    CHECK_STR(inf.inflater.error(), "compressed size mismatch");
+}
+
+TEST_CASE(packed_size_larger_than_stream) {
+    // Stream endet vor packedSize - erst finish() kann es erkennen
+    Bytes image = test_image();
+    image_header(image)->packedSize += 1;
+
+    Inflate inf;
+    CHECK(!inf.run(image, OTA_STREAM_RECV_SIZE));
+    CHECK(inf.feedOk);
+    CHECK(inf.out == test_raw());
+    CHECK_STR(inf.inflater.error(), "compressed size mismatch");
+}
+
+TEST_CASE(trailing_bytes_rejected) {
+    Bytes image = test_image();
+    image.push_back(0x00);
+    image.push_back(0x00);
+
+    Inflate inf;
+    CHECK(!inf.run(image, 1));
+    CHECK(!inf.feedOk);
+    CHECK_STR(inf.inflater.error(), "compressed size mismatch");
+
+    // Auch wenn der Header die Bytes mitzählt
+    image_header(image)->packedSize += 2;
+    Inflate counted;
+    CHECK(!counted.run(image, OTA_STREAM_RECV_SIZE));
+    CHECK(counted.feedOk);
+    CHECK_STR(counted.inflater.error(), "compressed size mismatch");
+}
+
+TEST_CASE(truncated_stream) {
+    Bytes image = test_image();
+    image.resize(image.size() - 10);
+
+    Inflate inf;
+    CHECK(!inf.run(image, OTA_STREAM_RECV_SIZE));
+    CHECK(inf.feedOk);
+    CHECK_STR(inf.inflater.error(), "compressed image truncated");
+
+    // Nur ein Teil des Headers
+    Inflate header;
+    CHECK(!header.run(Bytes(test_image().begin(), test_image().begin() + 20), 7));
+    CHECK_STR(header.inflater.error(), "compressed image truncated");
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+// Header
+// ═══════════════════════════════════════════════════════════════════════
+
+TEST_CASE(raw_size_mismatch) {
+    Bytes smaller = test_image();
+    image_header(smaller)->rawSize -= 1;
+    Inflate a;
+    CHECK(!a.run(smaller, OTA_STREAM_RECV_SIZE));
+    CHECK(!a.feedOk);
+    CHECK_STR(a.inflater.error(), "decompressed size mismatch");
+    CHECK(a.out.size() < RAW_SIZE);
+
+    Bytes larger = test_image();
+    image_header(larger)->rawSize += 1;
+    Inflate b;
+    CHECK(!b.run(larger, OTA_STREAM_RECV_SIZE));
+    CHECK(b.feedOk);
+    CHECK_STR(b.inflater.error(), "decompressed size mismatch");
+
+    Inflate c(RAW_SIZE - 1);
+    CHECK(!c.run(test_image(), OTA_STREAM_RECV_SIZE));
+    CHECK_STR(c.inflater.error(), "image too large for partition");
+    CHECK(c.out.empty());
+}
+
+TEST_CASE(invalid_header_fields) {
+    struct Case {
+        size_t offset;
+        uint8_t value;
+        const char* error;
+    };
+    static const Case cases[] = {
+        { 0, 'X', "not an ESP32 firmware image" },
+        { 4, OTA_IMAGE_VERSION + 1, "unsupported compressed image" },
+        { 5, 0, "unsupported compressed image" },
+        { 6, OTA_INFLATE_WINDOW_BITS + 2, "compression window too large" },
+    };
+    for (const Case& c : cases) {
+        Bytes image = test_image();
+        image[c.offset] = c.value;
+        Inflate inf;
+        CHECK(!inf.run(image, 5));
+        CHECK_STR(inf.inflater.error(), c.error);
+        CHECK(inf.out.empty());
+    }
+}
+
+TEST_CASE(stream_with_larger_window_fails) {
+    // Rückverweise über 8 KB hinaus passen nicht in den Ring: ein mit
+    // Fenster 2^15 gepackter Stream darf nicht als 2^13 durchgehen
+    Bytes raw(40000);
+    rng_state = 7;
+    for (size_t i = 0; i < 12000; i++) raw[i] = (uint8_t)rng_next();
+    for (size_t i = 12000; i < raw.size(); i++) raw[i] = raw[i - 12000];
+    raw[0] = FIRMWARE_MAGIC;
+
+    z_stream zs = {};
+    CHECK_EQ(deflateInit2(&zs, 9, Z_DEFLATED, -15, 9, Z_DEFAULT_STRATEGY), Z_OK);
+    Bytes packed(deflateBound(&zs, raw.size()));
+    zs.next_in = raw.data();
+    zs.avail_in = (uInt)raw.size();
+    zs.next_out = packed.data();
+    zs.avail_out = (uInt)packed.size();
+    CHECK_EQ(deflate(&zs, Z_FINISH), Z_STREAM_END);
+    packed.resize(zs.total_out);
+    deflateEnd(&zs);
+
+    OtaImageHeader header = {};
+    memcpy(header.magic, OTA_IMAGE_MAGIC, 4);
+    header.version = OTA_IMAGE_VERSION;
+    header.algorithm = OTA_IMAGE_ALGO_DEFLATE;
+    header.windowBits = OTA_INFLATE_WINDOW_BITS;
+    header.rawSize = (uint32_t)raw.size();
+    header.packedSize = (uint32_t)packed.size();
+
+    Bytes image((const uint8_t*)&header, (const uint8_t*)&header + sizeof(header));
+    image.insert(image.end(), packed.begin(), packed.end());
+
+    Inflate inf;
+    CHECK(!inf.run(image, OTA_STREAM_RECV_SIZE));
+    CHECK_STR(inf.inflater.error(), "decompression failed");
+    CHECK(inf.inflater.status() < TINFL_STATUS_DONE);
+
+    // Gegenprobe: compress_ota.py packt dieselben Daten passend zum Ring
+    Inflate ok;
+    CHECK(ok.run(compress_ota(raw), OTA_STREAM_RECV_SIZE));
+    CHECK(ok.out == raw);
+}
+
+TEST_CASE(sink_rejects) {
+    struct Reject {
+        static bool fn(void*, const uint8_t*, size_t) { return false; }
+    };
+    Inflate inf;
+    inf.inflater.begin(inf.decomp.get(), inf.dict.data(), RAW_SIZE, Reject::fn, nullptr);
+    CHECK(!inf.run(test_image(), OTA_STREAM_RECV_SIZE));
+    CHECK_STR(inf.inflater.error(), "write failed");
+}
+
+TEST_CASE(begin_without_buffers) {
+    OtaImageInflater inflater;
+    CHECK(!inflater.feed((const uint8_t*)"B", 1));
+    CHECK_STR(inflater.error(), "not started");
+
+    inflater.begin(nullptr, nullptr, RAW_SIZE, Inflate::sink_fn, nullptr);
+    CHECK(!inflater.feed((const uint8_t*)"B", 1));
+    CHECK_STR(inflater.error(), "out of memory");
+}